@@ -65,6 +65,12 @@ static void MinProfile( b2Profile* p1, const b2Profile* p2 )
 // Run benchmark 3 with 4 workers and run once. Disable continuous collision. Record the step times.
 // start /affinity 0x5555 .\build\bin\Release\benchmark.exe -t=4 -w=4 -b=3 -r=1 -nc -s
 
+// Compare the work stealing scheduler against the shared table scheduler with 8 workers.
+// start /affinity 0x5555 .\build\bin\Release\benchmark.exe -t=8 -w=8 -cs
+
+// Run benchmark 1 with 8 workers that never park. Prints the total time workers spent spinning and parked.
+// start /affinity 0x5555 .\build\bin\Release\benchmark.exe -t=8 -w=8 -b=1 -ip=2
+
 int main( int argc, char** argv )
 {
 #ifdef TRACY_ENABLE
@@ -77,6 +83,7 @@ int main( int argc, char** argv )
 		{ "junkyard", CreateJunkyard, StepJunkyard, 800 },
 		{ "large_pyramid", CreateLargePyramid, NULL, 500 },
 		{ "many_pyramids", CreateManyPyramids, NULL, 200 },
+		{ "platform", CreatePlatform, NULL, 500 },
 		{ "rain", CreateRain, StepRain, 1000 },
 		{ "smash", CreateSmash, NULL, 300 },
 		{ "spinner", CreateSpinner, StepSpinner, 500 },
@@ -131,6 +138,16 @@ int main( int argc, char** argv )
 	b2Counters counters = { 0 };
 	bool enableContinuous = true;
 	bool recordStepTimes = false;
+	bool compareSchedulers = false;
+	bool enablePipelinedStep = false;
+	bool enableParallelOverflow = false;
+	bool enableGraphRebalance = false;
+	bool enableContactSort = false;
+	bool countCacheMisses = false;
+	int contactSimdWidth = 0;
+	b2BroadPhaseType broadPhaseType = b2_treeBroadPhase;
+	b2IdlePolicy idlePolicy = b2_idleSpinThenPark;
+	const char* idlePolicyNames[] = { "spin then park", "spin then yield", "spin" };
 
 	for ( int i = 1; i < argc; ++i )
 	{
@@ -162,6 +179,49 @@ int main( int argc, char** argv )
 		{
 			recordStepTimes = true;
 		}
+		else if ( strcmp( arg, "-cs" ) == 0 )
+		{
+			compareSchedulers = true;
+			printf( "Comparing schedulers\n" );
+		}
+		else if ( strcmp( arg, "-ps" ) == 0 )
+		{
+			enablePipelinedStep = true;
+			printf( "Pipelined step enabled\n" );
+		}
+		else if ( strcmp( arg, "-po" ) == 0 )
+		{
+			enableParallelOverflow = true;
+			printf( "Parallel overflow enabled\n" );
+		}
+		else if ( strcmp( arg, "-rb" ) == 0 )
+		{
+			enableGraphRebalance = true;
+			printf( "Graph rebalance enabled\n" );
+		}
+		else if ( strcmp( arg, "-so" ) == 0 )
+		{
+			enableContactSort = true;
+			printf( "Contact sort enabled\n" );
+		}
+		else if ( strcmp( arg, "-cm" ) == 0 )
+		{
+			countCacheMisses = true;
+		}
+		else if ( strcmp( arg, "-gb" ) == 0 )
+		{
+			broadPhaseType = b2_gridBroadPhase;
+			printf( "Grid broad-phase enabled\n" );
+		}
+		else if ( strncmp( arg, "-simd=", 6 ) == 0 )
+		{
+			contactSimdWidth = atoi( arg + 6 );
+		}
+		else if ( strncmp( arg, "-ip=", 4 ) == 0 )
+		{
+			idlePolicy = (b2IdlePolicy)b2ClampInt( atoi( arg + 4 ), b2_idleSpinThenPark, b2_idleSpin );
+			printf( "Idle policy: %s\n", idlePolicyNames[idlePolicy] );
+		}
 		else if ( strcmp( arg, "-h" ) == 0 )
 		{
 			printf( "Usage\n"
@@ -169,7 +229,16 @@ int main( int argc, char** argv )
 					"-b=<integer>: run a single benchmark\n"
 					"-w=<integer>: run a single worker count\n"
 					"-r=<integer>: number of repeats (default is 4)\n"
-					"-s: record step times\n" );
+					"-s: record step times\n"
+					"-cs: compare the work stealing and shared table schedulers\n"
+					"-ip=<integer>: idle policy, 0 = spin then park (default), 1 = spin then yield, 2 = spin\n"
+					"-ps: enable the pipelined step\n"
+					"-po: solve the overflow constraints in parallel\n"
+					"-rb: rebalance the constraint graph colors\n"
+					"-so: sort the contacts within each graph color by body\n"
+					"-cm: count the cache misses of the main thread while stepping (Linux only)\n"
+					"-gb: use the grid broad-phase\n"
+					"-simd=<integer>: contact solver SIMD width, 4 or 8 (default is the widest the CPU supports)\n" );
 			exit( 0 );
 		}
 	}
@@ -179,9 +248,26 @@ int main( int argc, char** argv )
 		singleWorkerCount = b2ClampInt( singleWorkerCount, 1, maxThreadCount );
 	}
 
+	// Worker threads are not counted, so this is most useful with one thread
+	CacheMissCounter cacheMissCounter = { -1, -1 };
+	if ( countCacheMisses && CreateCacheMissCounter( &cacheMissCounter ) == false )
+	{
+		printf( "Cache miss counters are not available\n" );
+		countCacheMisses = false;
+	}
+
 	printf( "Starting Box2D benchmarks\n" );
 	printf( "======================================\n" );
 
+	// The width is selected at world creation, so report it using a throwaway world
+	{
+		b2WorldDef worldDef = b2DefaultWorldDef();
+		worldDef.contactSimdWidth = contactSimdWidth;
+		b2WorldId worldId = b2CreateWorld( &worldDef );
+		printf( "contact solver SIMD width: %d\n", b2World_GetContactSimdWidth( worldId ) );
+		b2DestroyWorld( worldId );
+	}
+
 	for ( int benchmarkIndex = 0; benchmarkIndex < benchmarkCount; ++benchmarkIndex )
 	{
 		if ( singleBenchmark != -1 && benchmarkIndex != singleBenchmark )
@@ -201,7 +287,9 @@ int main( int argc, char** argv )
 
 		printf( "benchmark: %s, steps = %d\n", benchmarks[benchmarkIndex].name, stepCount );
 
-		float minTime[B2_MAX_WORKERS] = { 0 };
+		// The second row holds the shared table scheduler times when comparing schedulers
+		float minTime[2][B2_MAX_WORKERS] = { 0 };
+		int schedulerCount = compareSchedulers ? 2 : 1;
 
 		for ( int threadCount = 1; threadCount <= maxThreadCount; ++threadCount )
 		{
@@ -212,64 +300,117 @@ int main( int argc, char** argv )
 
 			printf( "thread count: %d\n", threadCount );
 
-			for ( int runIndex = 0; runIndex < runCount; ++runIndex )
+			for ( int schedulerIndex = 0; schedulerIndex < schedulerCount; ++schedulerIndex )
 			{
-				b2WorldDef worldDef = b2DefaultWorldDef();
-				worldDef.enableContinuous = enableContinuous;
-				worldDef.workerCount = threadCount;
-				b2WorldId worldId = b2CreateWorld( &worldDef );
+				b2SchedulerType schedulerType = schedulerIndex == 0 ? b2_workStealingScheduler : b2_sharedTableScheduler;
+				if ( compareSchedulers )
+				{
+					printf( "scheduler: %s\n", schedulerIndex == 0 ? "work stealing" : "shared table" );
+				}
 
-				benchmark->createFcn( worldId );
+				for ( int runIndex = 0; runIndex < runCount; ++runIndex )
+				{
+					b2WorldDef worldDef = b2DefaultWorldDef();
+					worldDef.enableContinuous = enableContinuous;
+					worldDef.workerCount = threadCount;
+					worldDef.schedulerType = schedulerType;
+					worldDef.idlePolicy = idlePolicy;
+					worldDef.enablePipelinedStep = enablePipelinedStep;
+					worldDef.enableParallelOverflow = enableParallelOverflow;
+					worldDef.enableGraphRebalance = enableGraphRebalance;
+					worldDef.enableContactSort = enableContactSort;
+					worldDef.broadPhaseType = broadPhaseType;
+					worldDef.contactSimdWidth = contactSimdWidth;
+					b2WorldId worldId = b2CreateWorld( &worldDef );
+
+					benchmark->createFcn( worldId );
+
+					float timeStep = 1.0f / 60.0f;
+					int subStepCount = 4;
+
+					// Initial step can be expensive and skew benchmark
+					if ( benchmark->stepFcn != NULL )
+					{
+						stepResults[0] = benchmark->stepFcn( worldId, 0 );
+					}
 
-				float timeStep = 1.0f / 60.0f;
-				int subStepCount = 4;
+					assert( stepCount <= maxSteps );
 
-				// Initial step can be expensive and skew benchmark
-				if ( benchmark->stepFcn != NULL )
-				{
-					stepResults[0] = benchmark->stepFcn( worldId, 0 );
-				}
+					b2World_Step( worldId, timeStep, subStepCount );
 
-				assert( stepCount <= maxSteps );
+					b2Profile profile = b2World_GetProfile( worldId );
+					MinProfile( profiles + 0, &profile );
 
-				b2World_Step( worldId, timeStep, subStepCount );
+					uint64_t ticks = b2GetTicks();
 
-				b2Profile profile = b2World_GetProfile( worldId );
-				MinProfile( profiles + 0, &profile );
+					// Idle time summed over all workers and steps
+					float spinTime = 0.0f;
+					float parkTime = 0.0f;
 
-				uint64_t ticks = b2GetTicks();
+					// Constraint prepare time summed over steps
+					float prepareTime = 0.0f;
 
-				for ( int stepIndex = 1; stepIndex < stepCount; ++stepIndex )
-				{
-					if ( benchmark->stepFcn != NULL )
+					if ( countCacheMisses )
 					{
-						stepResults[stepIndex] = benchmark->stepFcn( worldId, stepIndex );
+						StartCacheMissCounter( &cacheMissCounter );
 					}
 
-					b2World_Step( worldId, timeStep, subStepCount );
-					profile = b2World_GetProfile( worldId );
-					MinProfile( profiles + stepIndex, &profile );
-				}
+					for ( int stepIndex = 1; stepIndex < stepCount; ++stepIndex )
+					{
+						if ( benchmark->stepFcn != NULL )
+						{
+							stepResults[stepIndex] = benchmark->stepFcn( worldId, stepIndex );
+						}
+
+						b2World_Step( worldId, timeStep, subStepCount );
+						profile = b2World_GetProfile( worldId );
+						MinProfile( profiles + stepIndex, &profile );
+						prepareTime += profile.prepareConstraints;
+
+						for ( int workerIndex = 0; workerIndex < threadCount; ++workerIndex )
+						{
+							spinTime += profile.workerSpin[workerIndex];
+							parkTime += profile.workerPark[workerIndex];
+						}
+					}
 
-				float ms = b2GetMilliseconds( ticks );
-				printf( "run %d : %g (ms)\n", runIndex, ms );
+					float ms = b2GetMilliseconds( ticks );
+					printf( "run %d : %g (ms), prepare %g (ms), idle spin %g (ms), idle park %g (ms)\n", runIndex, ms, prepareTime,
+							spinTime, parkTime );
 
-				if ( runIndex == 0 )
-				{
-					minTime[threadCount - 1] = ms;
-				}
-				else
-				{
-					minTime[threadCount - 1] = b2MinFloat( minTime[threadCount - 1], ms );
-				}
+					if ( countCacheMisses )
+					{
+						// -1 means the event is not available
+						long long l1Misses, lastLevelMisses;
+						StopCacheMissCounter( &cacheMissCounter, &l1Misses, &lastLevelMisses );
+						printf( "cache misses: L1 data %lld / last level %lld\n", l1Misses, lastLevelMisses );
+					}
 
-				if ( countersAcquired == false )
-				{
-					counters = b2World_GetCounters( worldId );
-					countersAcquired = true;
+					if ( runIndex == 0 )
+					{
+						minTime[schedulerIndex][threadCount - 1] = ms;
+					}
+					else
+					{
+						minTime[schedulerIndex][threadCount - 1] = b2MinFloat( minTime[schedulerIndex][threadCount - 1], ms );
+					}
+
+					if ( countersAcquired == false )
+					{
+						counters = b2World_GetCounters( worldId );
+						countersAcquired = true;
+					}
+
+					b2DestroyWorld( worldId );
 				}
+			}
 
-				b2DestroyWorld( worldId );
+			if ( compareSchedulers && threadCount > 1 )
+			{
+				float stealing = minTime[0][threadCount - 1];
+				float shared = minTime[1][threadCount - 1];
+				printf( "work stealing %g (ms), shared table %g (ms), speedup %.3f\n", stealing, shared,
+						stealing > 0.0f ? shared / stealing : 0.0f );
 			}
 
 			if ( recordStepTimes )
@@ -300,7 +441,9 @@ int main( int argc, char** argv )
 		{
 			printf( " %d", counters.colorCounts[c] );
 		}
-		printf( "\n\n" );
+		printf( "\n" );
+		printf( "overflow contacts %d / joints %d\n", counters.overflowContactCount, counters.overflowJointCount );
+		printf( "color imbalance %.2f / lane fill %.2f\n\n", counters.colorImbalance, counters.colorLaneFill );
 
 		char fileName[64] = { 0 };
 		snprintf( fileName, 64, "%s.csv", benchmarks[benchmarkIndex].name );
@@ -310,10 +453,21 @@ int main( int argc, char** argv )
 			continue;
 		}
 
-		fprintf( file, "threads,ms\n" );
-		for ( int threadIndex = 1; threadIndex <= maxThreadCount; ++threadIndex )
+		if ( compareSchedulers )
+		{
+			fprintf( file, "threads,ms,shared_ms\n" );
+			for ( int threadIndex = 1; threadIndex <= maxThreadCount; ++threadIndex )
+			{
+				fprintf( file, "%d,%g,%g\n", threadIndex, minTime[0][threadIndex - 1], minTime[1][threadIndex - 1] );
+			}
+		}
+		else
 		{
-			fprintf( file, "%d,%g\n", threadIndex, minTime[threadIndex - 1] );
+			fprintf( file, "threads,ms\n" );
+			for ( int threadIndex = 1; threadIndex <= maxThreadCount; ++threadIndex )
+			{
+				fprintf( file, "%d,%g\n", threadIndex, minTime[0][threadIndex - 1] );
+			}
 		}
 
 		fclose( file );
@@ -322,6 +476,8 @@ int main( int argc, char** argv )
 	printf( "======================================\n" );
 	printf( "All Box2D benchmarks complete!\n" );
 
+	DestroyCacheMissCounter( &cacheMissCounter );
+
 	free( profiles );
 	free( stepResults );
 
@@ -141,6 +141,9 @@ B2_API float b2GetMilliseconds( uint64_t ticks );
 /// value to the current tick value.
 B2_API float b2GetMillisecondsAndReset( uint64_t* ticks );
 
+/// Convert a tick interval to milliseconds.
+B2_API float b2TicksToMilliseconds( uint64_t ticks );
+
 /// Yield to be used in a busy loop.
 B2_API void b2Yield( void );
 
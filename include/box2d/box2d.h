@@ -64,6 +64,30 @@ B2_API b2TreeStats b2World_OverlapAABB( b2WorldId worldId, b2AABB aabb, b2QueryF
 B2_API b2TreeStats b2World_OverlapShape( b2WorldId worldId, const b2ShapeProxy* proxy, b2QueryFilter filter,
 										 b2OverlapResultFcn* fcn, void* context );
 
+/// Run a batch of AABB overlap queries. This finds the same shapes as b2World_OverlapAABB() but the
+/// queries are spread across the world's worker threads and the hits are returned in compact lists.
+/// The hits of query i are shapeIds[offsets[i]] up to (not including) shapeIds[offsets[i + 1]].
+/// @param worldId The world to query
+/// @param aabbs The query bounding boxes
+/// @param queryCount The number of queries
+/// @param filter Contains bit flags to filter unwanted shapes from the results
+/// @param offsets Receives the hit list offsets. Must hold queryCount + 1 elements.
+/// @param shapeIds Receives the hit lists
+/// @param shapeIdCapacity The number of elements in shapeIds
+/// @return the total number of hits. If this exceeds shapeIdCapacity then the hits beyond the capacity
+/// are dropped while the offsets still describe all hits, so you can grow the array and try again.
+/// @warning Batch queries use the world's task system and are not thread-safe. Do not run a batch
+/// concurrently with another batch or with b2World_Step. An overlapping batch is rejected and returns zero.
+B2_API int b2World_OverlapAABBBatch( b2WorldId worldId, const b2AABB* aabbs, int queryCount, b2QueryFilter filter,
+									 int* offsets, b2ShapeId* shapeIds, int shapeIdCapacity );
+
+/// Run a batch of shape proxy overlap queries. This finds the same shapes as b2World_OverlapShape().
+/// The results are laid out the same as b2World_OverlapAABBBatch().
+/// @warning Not thread-safe, the same as b2World_OverlapAABBBatch()
+///	@see b2World_OverlapAABBBatch
+B2_API int b2World_OverlapShapeBatch( b2WorldId worldId, const b2ShapeProxy* proxies, int queryCount, b2QueryFilter filter,
+									  int* offsets, b2ShapeId* shapeIds, int shapeIdCapacity );
+
 /// Cast a ray into the world to collect shapes in the path of the ray.
 /// Your callback function controls whether you get the closest point, any point, or n-points.
 /// @note The callback function may receive shapes in any order
@@ -81,6 +105,21 @@ B2_API b2TreeStats b2World_CastRay( b2WorldId worldId, b2Vec2 origin, b2Vec2 tra
 /// This is less general than b2World_CastRay() and does not allow for custom filtering.
 B2_API b2RayResult b2World_CastRayClosest( b2WorldId worldId, b2Vec2 origin, b2Vec2 translation, b2QueryFilter filter );
 
+/// Cast a batch of rays into the world and collect the closest hit of each ray. Ignores initial overlap.
+/// This gives the same results as calling b2World_CastRayClosest() for each ray. The rays are grouped
+/// into SIMD packets and the packets are spread across the world's worker threads. Coherent rays (nearby
+/// origins and similar directions) that are adjacent in the arrays benefit most.
+/// @param worldId The world to cast the rays against
+/// @param origins The start point of each ray
+/// @param translations The translation of each ray
+/// @param rayCount The number of rays
+/// @param filter Contains bit flags to filter unwanted shapes from the results
+/// @param results Receives the closest hit for each ray. The node visit count is shared by the rays of a packet.
+/// @warning Ray batches use the world's task system and are not thread-safe. Do not cast a batch concurrently
+/// with another batch or with b2World_Step. An overlapping batch is rejected and leaves the results untouched.
+B2_API void b2World_CastRayBatch( b2WorldId worldId, const b2Vec2* origins, const b2Vec2* translations, int rayCount,
+								  b2QueryFilter filter, b2RayResult* results );
+
 /// Cast a shape through the world. Similar to a cast ray except that a shape is cast instead of a point.
 ///	@see b2World_CastRay
 B2_API b2TreeStats b2World_CastShape( b2WorldId worldId, const b2ShapeProxy* proxy, b2Vec2 translation, b2QueryFilter filter,
@@ -184,6 +223,22 @@ B2_API b2Profile b2World_GetProfile( b2WorldId worldId );
 /// Get world counters and sizes
 B2_API b2Counters b2World_GetCounters( b2WorldId worldId );
 
+/// Get the most recent timeline events ordered by start tick. The timeline records every solver block
+/// and parallel-for block claimed by a worker, which shows load imbalance between workers.
+/// Requires b2WorldDef::timelineCapacity to be positive.
+/// @param worldId The world
+/// @param events Receives the events, may be NULL to get the number of available events
+/// @param capacity The capacity of the events array
+/// @return The number of events written, or the number available if events is NULL
+B2_API int b2World_GetTimeline( b2WorldId worldId, b2TimelineEvent* events, int capacity );
+
+/// Discard all recorded timeline events
+B2_API void b2World_ClearTimeline( b2WorldId worldId );
+
+/// Write the timeline in the Chrome trace event format. Open it with chrome://tracing or Perfetto.
+/// Returns false if the file could not be written.
+B2_API bool b2World_SaveTimelineToFile( b2WorldId worldId, const char* path );
+
 /// Get max capacity. This can be used with b2WorldDef to avoid run-time allocations and copies
 B2_API b2Capacity b2World_GetMaxCapacity( b2WorldId worldId );
 
@@ -205,6 +260,10 @@ B2_API void b2World_SetWorkerCount( b2WorldId worldId, int count );
 /// Get the worker count.
 B2_API int b2World_GetWorkerCount( b2WorldId worldId );
 
+/// Get the SIMD width used by the contact solver. This is selected when the world is created.
+/// @see b2WorldDef::contactSimdWidth
+B2_API int b2World_GetContactSimdWidth( b2WorldId worldId );
+
 /// Dump memory stats to box2d_memory.txt
 B2_API void b2World_DumpMemoryStats( b2WorldId worldId );
 
@@ -641,16 +700,49 @@ B2_API b2ShapeId b2CreateSegmentShape( b2BodyId bodyId, const b2ShapeDef* def, c
 /// @return the shape id, or b2_nullShapeId if the segment is too short.
 B2_API b2ShapeId b2CreateChainSegmentShape( b2BodyId bodyId, const b2ShapeDef* def, const b2ChainSegment* chainSegment );
 
+/// Create a static mesh shape and attach it to a body. The segments are cloned into a compact array with
+/// an internal bounding volume hierarchy. This uses one shape and one broad-phase proxy for the whole mesh,
+/// which is much cheaper than a chain shape for large static geometry. Meshes have no mass, cannot be sensors,
+/// and collide with circles, capsules, and polygons. Contacts are not created until the next time step.
+/// @note A shape touching two faces of a concave corner gets a second contact for the other face. Begin and
+/// end touch events are still reported once per shape pair, but the contact data of the shape and body
+/// may hold two entries for the pair, each with its own normal. This also applies to heightfields.
+/// @return the shape id, or b2_nullShapeId if the mesh is empty
+B2_API b2ShapeId b2CreateMeshShape( b2BodyId bodyId, const b2ShapeDef* def, const b2Mesh* mesh );
+
+/// Create a heightfield shape and attach it to a body. The heightfield uses a single broad-phase proxy
+/// and only collides with the cells covered by the other shape. Like meshes, heightfields have no mass,
+/// cannot be sensors, and collide with circles, capsules, and polygons. Contacts in concave corners
+/// behave like mesh contacts, see b2CreateMeshShape.
+/// @return the shape id, or b2_nullShapeId if the heightfield is invalid
+B2_API b2ShapeId b2CreateHeightFieldShape( b2BodyId bodyId, const b2ShapeDef* def, const b2HeightField* heightField );
+
 /// Create a capsule shape and attach it to a body. The shape definition and geometry are fully cloned.
 /// Contacts are not created until the next time step.
 /// @return the shape id for accessing the shape, this will be b2_nullShapeId if the length is too small.
 B2_API b2ShapeId b2CreateCapsuleShape( b2BodyId bodyId, const b2ShapeDef* def, const b2Capsule* capsule );
 
 /// Create a polygon shape and attach it to a body. The shape definition and geometry are fully cloned.
-/// Contacts are not created until the next time step.
+/// If b2ShapeDef::geometry is set the shape references that shared geometry instead and the polygon
+/// may be NULL. Contacts are not created until the next time step.
 /// @return the shape id for accessing the shape
 B2_API b2ShapeId b2CreatePolygonShape( b2BodyId bodyId, const b2ShapeDef* def, const b2Polygon* polygon );
 
+/// Create immutable polygon geometry that can be shared by many polygon shapes using b2ShapeDef::geometry.
+/// Shapes hold a reference, so the geometry lives until it is destroyed and the last shape using it is gone.
+/// This saves memory when many shapes have the same polygon, such as a pile of identical crates.
+/// @return the geometry id for use in shape definitions
+B2_API b2GeometryId b2CreateGeometry( b2WorldId worldId, const b2Polygon* polygon );
+
+/// Release the reference held by the geometry id. Shapes using the geometry are not affected.
+B2_API void b2DestroyGeometry( b2GeometryId geometryId );
+
+/// Geometry identifier validation. Provides validation for up to 64K allocations.
+B2_API bool b2Geometry_IsValid( b2GeometryId id );
+
+/// Get the number of shapes referencing the geometry
+B2_API int b2Geometry_GetShapeCount( b2GeometryId geometryId );
+
 /// Destroy a shape. You may defer the body mass update which can improve performance if several shapes on a
 ///	body are destroyed at once.
 ///	@see b2Body_ApplyMassFromShapes
@@ -767,6 +859,19 @@ B2_API b2Segment b2Shape_GetSegment( b2ShapeId shapeId );
 /// Asserts the type is correct.
 B2_API b2ChainSegment b2Shape_GetChainSegment( b2ShapeId shapeId );
 
+/// Get the number of segments in a mesh shape. Asserts the type is correct.
+B2_API int b2Shape_GetMeshSegmentCount( b2ShapeId shapeId );
+
+/// Get a copy of a mesh shape segment. The mesh order differs from the creation order.
+/// Asserts the type is correct.
+B2_API b2ChainSegment b2Shape_GetMeshSegment( b2ShapeId shapeId, int index );
+
+/// Get the number of cells in a heightfield shape. Asserts the type is correct.
+B2_API int b2Shape_GetHeightFieldCellCount( b2ShapeId shapeId );
+
+/// Get the chain segment for a heightfield cell, including ghost vertices. Asserts the type is correct.
+B2_API b2ChainSegment b2Shape_GetHeightFieldSegment( b2ShapeId shapeId, int cellIndex );
+
 /// Get a copy of the shape's capsule. Asserts the type is correct.
 B2_API b2Capsule b2Shape_GetCapsule( b2ShapeId shapeId );
 
@@ -177,6 +177,18 @@ typedef struct b2ChainSegment
 	int chainId;
 } b2ChainSegment;
 
+/// A soup of one-sided chain segments used to create a mesh shape. The segments may come from
+/// many polylines and need valid ghost vertices for smooth collision. A mesh shape uses a single
+/// broad-phase proxy for all of its segments.
+typedef struct b2Mesh
+{
+	/// The chain segments. These are cloned and may be reordered by the mesh shape.
+	const b2ChainSegment* segments;
+
+	/// The number of segments, must be positive
+	int count;
+} b2Mesh;
+
 /// Validate ray cast input data (NaN, etc)
 B2_API bool b2IsValidRay( const b2RayCastInput* input );
 
@@ -642,9 +654,11 @@ enum b2TreeNodeFlags
 	b2_allocatedNode = 0x0001,
 	b2_enlargedNode = 0x0002,
 	b2_leafNode = 0x0004,
+	b2_refitNode = 0x0008,
 };
 
-/// A node in the dynamic tree. For internal usage.
+/// A node in the dynamic tree. This holds the data touched by tree traversal so queries
+/// stream through a compact array. A leaf node has null children. For internal usage.
 typedef struct b2TreeNode
 {
 	/// The node bounding box
@@ -653,17 +667,18 @@ typedef struct b2TreeNode
 	/// Category bits for collision filtering
 	uint64_t categoryBits; // 8
 
-	union
+	/// Children (internal node), null for a leaf
+	struct
 	{
-		/// Children (internal node)
-		struct
-		{
-			int32_t child1, child2;
-		} children;
+		int32_t child1, child2;
+	} children; // 8
+} b2TreeNode;
 
-		/// User data (leaf node)
-		uint64_t userData;
-	}; // 8
+/// Tree node data that is not needed for traversal. Stored in a parallel array. For internal usage.
+typedef struct b2TreeNodeData
+{
+	/// User data (leaf node)
+	uint64_t userData; // 8
 
 	union
 	{
@@ -676,7 +691,30 @@ typedef struct b2TreeNode
 
 	uint16_t height; // 2
 	uint16_t flags;	 // 2
-} b2TreeNode;
+} b2TreeNodeData;
+
+/// A node of the 4-wide tree collapsed from the binary tree. The child boxes are stored in
+/// SoA form so all four can be tested at once using SIMD. For internal usage.
+typedef struct b2TreeNode4
+{
+	/// Child bounding boxes
+	float lowerX[4];
+	float lowerY[4];
+	float upperX[4];
+	float upperY[4]; // 64
+
+	/// Child category bits for collision filtering
+	uint64_t categoryBits[4]; // 32
+
+	/// Wide node index for an internal child and proxy id for a leaf child
+	int32_t children[4]; // 16
+
+	/// Bit i is set if child i is a leaf
+	uint32_t leafMask; // 4
+
+	/// Number of children in use
+	int32_t childCount; // 4
+} b2TreeNode4;
 
 /// The dynamic tree structure. This should be considered private data.
 /// It is placed here for performance reasons.
@@ -685,6 +723,9 @@ typedef struct b2DynamicTree
 	/// The tree nodes
 	struct b2TreeNode* nodes;
 
+	/// The tree node data, parallel to nodes
+	struct b2TreeNodeData* nodeData;
+
 	/// The root index
 	int32_t root;
 
@@ -714,6 +755,15 @@ typedef struct b2DynamicTree
 
 	/// Allocated space for rebuilding
 	int32_t rebuildCapacity;
+
+	/// Optional 4-wide nodes built by b2DynamicTree_BuildWide. The root is node 0.
+	struct b2TreeNode4* wideNodes;
+
+	/// The number of wide nodes. Zero if the wide tree is not built or the tree has changed since.
+	int32_t wideNodeCount;
+
+	/// The allocated wide node space
+	int32_t wideNodeCapacity;
 } b2DynamicTree;
 
 /// These are performance results returned by dynamic tree queries.
@@ -788,6 +838,30 @@ typedef float b2TreeRayCastCallbackFcn( const b2RayCastInput* input, int proxyId
 B2_API b2TreeStats b2DynamicTree_RayCast( const b2DynamicTree* tree, const b2RayCastInput* input, uint64_t maskBits,
 										  b2TreeRayCastCallbackFcn* callback, void* context );
 
+/// The maximum number of rays in a ray packet. See b2DynamicTree_RayCastPacket().
+#define B2_RAY_PACKET_SIZE 8
+
+/// This function receives clipped ray cast input for one ray of a packet. The function
+/// returns the new ray fraction for that ray only.
+/// - return a value of 0 to terminate the ray cast for this ray
+/// - return a value less than input->maxFraction to clip the ray
+/// - return a value of input->maxFraction to continue the ray cast without clipping
+typedef float b2TreeRayCastPacketCallbackFcn( const b2RayCastInput* input, int rayIndex, int proxyId, uint64_t userData,
+											  void* context );
+
+/// Ray cast a packet of rays against the proxies in the tree. The rays traverse the tree together and
+/// each node is tested against all rays of the packet at once using SIMD. This is faster than individual
+/// ray casts when the rays are coherent, such as rays with nearby origins and similar directions.
+/// @param tree the dynamic tree to ray cast
+/// @param inputs the ray cast input data for each ray
+/// @param rayCount the number of rays, at most B2_RAY_PACKET_SIZE
+/// @param maskBits mask bit hint: `bool accept = (maskBits & node->categoryBits) != 0;`
+/// @param callback a callback that is called for each proxy that is hit by one of the rays
+/// @param context user context that is passed to the callback
+///	@return performance data for the whole packet
+B2_API b2TreeStats b2DynamicTree_RayCastPacket( const b2DynamicTree* tree, const b2RayCastInput* inputs, int rayCount,
+												uint64_t maskBits, b2TreeRayCastPacketCallbackFcn* callback, void* context );
+
 /// This function receives clipped ray cast input for a proxy. The function
 /// returns the new ray fraction.
 /// - return a value of 0 to terminate the ray cast
@@ -824,6 +898,11 @@ B2_API int b2DynamicTree_GetProxyCount( const b2DynamicTree* tree );
 /// Rebuild the tree while retaining subtrees that haven't changed. Returns the number of boxes sorted.
 B2_API int b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild );
 
+/// Collapse the tree into a 4-wide tree. Queries, ray casts, and shape casts use the wide tree until
+/// the tree is modified. This is intended for trees that rarely change and should be called after
+/// b2DynamicTree_Rebuild. Ray cast packets still use the binary tree.
+B2_API void b2DynamicTree_BuildWide( b2DynamicTree* tree );
+
 /// Get the number of bytes used by this tree
 B2_API int b2DynamicTree_GetByteCount( const b2DynamicTree* tree );
 
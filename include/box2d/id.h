@@ -72,6 +72,14 @@ typedef struct b2JointId
 	uint16_t generation;
 } b2JointId;
 
+/// Geometry id references shared shape geometry. This should be treated as an opaque handle.
+typedef struct b2GeometryId
+{
+	int32_t index1;
+	uint16_t world0;
+	uint16_t generation;
+} b2GeometryId;
+
 /// Contact id references a contact instance. This should be treated as an opaque handled.
 typedef struct b2ContactId
 {
@@ -98,6 +106,7 @@ static const b2BodyId b2_nullBodyId = B2_NULL_ID;
 static const b2ShapeId b2_nullShapeId = B2_NULL_ID;
 static const b2ChainId b2_nullChainId = B2_NULL_ID;
 static const b2JointId b2_nullJointId = B2_NULL_ID;
+static const b2GeometryId b2_nullGeometryId = B2_NULL_ID;
 static const b2ContactId b2_nullContactId = B2_NULL_ID;
 
 /// Macro to determine if any id is null.
@@ -161,6 +170,19 @@ B2_ID_INLINE b2ChainId b2LoadChainId( uint64_t x )
 	return id;
 }
 
+/// Store a geometry id into a uint64_t.
+B2_ID_INLINE uint64_t b2StoreGeometryId( b2GeometryId id )
+{
+	return ( (uint64_t)id.index1 << 32 ) | ( (uint64_t)id.world0 ) << 16 | (uint64_t)id.generation;
+}
+
+/// Load a uint64_t into a geometry id.
+B2_ID_INLINE b2GeometryId b2LoadGeometryId( uint64_t x )
+{
+	b2GeometryId id = { (int32_t)( x >> 32 ), (uint16_t)( x >> 16 ), (uint16_t)( x ) };
+	return id;
+}
+
 /// Store a joint id into a uint64_t.
 B2_ID_INLINE uint64_t b2StoreJointId( b2JointId id )
 {
@@ -5,6 +5,7 @@
 
 #include "base.h"
 #include "collision.h"
+#include "constants.h"
 #include "id.h"
 #include "math_functions.h"
 
@@ -56,6 +57,46 @@ typedef struct b2RayResult
 	bool hit;
 } b2RayResult;
 
+/// The internal task scheduler used when the world is multithreaded without user task callbacks.
+/// @ingroup world
+typedef enum b2SchedulerType
+{
+	/// Each worker thread has its own task queue and steals from the other queues when its queue is empty.
+	b2_workStealingScheduler,
+
+	/// All worker threads wake on a single semaphore and scan one shared task table. Useful for comparison.
+	b2_sharedTableScheduler,
+} b2SchedulerType;
+
+/// How an idle worker thread of the internal scheduler waits for more work. Every policy first spins
+/// for b2WorldDef::idleSpinCount iterations. Spinning keeps wake latency low at the cost of burning
+/// CPU that other threads or processes could use.
+/// @ingroup world
+typedef enum b2IdlePolicy
+{
+	/// Spin, then sleep on a semaphore until new work is enqueued. This is the least wasteful policy.
+	b2_idleSpinThenPark,
+
+	/// Spin, then keep polling while yielding the time slice between polls.
+	b2_idleSpinThenYield,
+
+	/// Never give up the core. This has the lowest latency and is best when the workers have dedicated cores.
+	b2_idleSpin,
+} b2IdlePolicy;
+
+/// The algorithm the broad-phase uses to find new pairs for moving shapes. Static and kinematic shapes
+/// always use their dynamic trees and world queries always use the trees.
+/// @ingroup world
+typedef enum b2BroadPhaseType
+{
+	/// Query the dynamic tree of dynamic shapes. This works well for any scene.
+	b2_treeBroadPhase,
+
+	/// Bin the dynamic shapes into a uniform hash grid every step. This can be faster for dense scenes
+	/// with many shapes of similar size, such as piles of small circles.
+	b2_gridBroadPhase,
+} b2BroadPhaseType;
+
 /// Optional world capacities that can be used to avoid run-time allocations.
 /// @see b2World_GetMaxCapacity
 /// @ingroup world
@@ -122,6 +163,43 @@ typedef struct b2WorldDef
 	/// Contact softening when mass ratios are large. Experimental.
 	bool enableContactSoftening;
 
+	/// Pipeline the end of the time step. The broad-phase refit of enlarged proxies runs as a task that
+	/// overlaps island sleeping and sensor hit reporting. Results are identical to the non-pipelined step.
+	/// Only has an effect with multithreading.
+	bool enablePipelinedStep;
+
+	/// Collapse the static tree into a 4-wide tree in b2World_RebuildStaticTree. This speeds up queries
+	/// and ray casts against static shapes. Modifying static shapes falls back to the binary tree until
+	/// the next rebuild.
+	bool enableWideStaticTree;
+
+	/// Solve the overflow contacts in parallel. Overflow contacts don't fit in the constraint graph
+	/// coloring, which happens when a body touches many other bodies. The parallel solver uses Jacobi
+	/// iterations with the mass of each body split across its overflow contacts. Results are deterministic
+	/// for any worker count but differ from the serial overflow solver. Overflow joints are still solved serially.
+	bool enableParallelOverflow;
+
+	/// Incrementally move contacts between constraint graph colors to even out the color sizes.
+	/// Each color is a solver stage, so this reduces the number of nearly empty stages in long
+	/// running simulations. This changes the solver order so results differ from the default.
+	bool enableGraphRebalance;
+
+	/// Sort the contacts within each constraint graph color by body so the contact solver gathers body
+	/// state from nearby memory. One color is checked per step and sorted only when it is out of order.
+	/// Results are identical with and without sorting.
+	bool enableContactSort;
+
+	/// The algorithm used to find new pairs for moving shapes
+	b2BroadPhaseType broadPhaseType;
+
+	/// Cell size of the grid broad-phase, usually in meters. Zero uses twice the average size of the
+	/// dynamic shapes.
+	float gridCellSize;
+
+	/// SIMD width of the contact solver, 4 or 8. Zero uses the widest width supported by the build and the CPU.
+	/// Widths that are not available fall back to the default. Results do not depend on the width.
+	int contactSimdWidth;
+
 	/// Number of workers for multithreading. Box2D performs best when using performance cores and
 	/// accessing a single L3 cache (uniform memory). Efficiency cores and SMT provide
 	/// little benefit and may even harm performance.
@@ -131,6 +209,20 @@ typedef struct b2WorldDef
 	/// an internal scheduler.
 	int workerCount;
 
+	/// The internal scheduler to use when there are no task callbacks and workerCount is above 1
+	b2SchedulerType schedulerType;
+
+	/// How idle workers wait for work. Applies to the internal scheduler and to workers waiting
+	/// on solver stages (which never park because the stages are too short).
+	b2IdlePolicy idlePolicy;
+
+	/// The number of spin iterations an idle worker performs before yielding or parking
+	int idleSpinCount;
+
+	/// Number of timeline events kept per worker. Zero disables the timeline.
+	/// @see b2World_GetTimeline
+	int timelineCapacity;
+
 	/// Function to spawn tasks
 	b2EnqueueTaskCallback* enqueueTask;
 
@@ -357,6 +449,12 @@ typedef enum b2ShapeType
 	/// A line segment owned by a chain shape
 	b2_chainSegmentShape,
 
+	/// A static collection of chain segments with an internal bounding volume hierarchy
+	b2_meshShape,
+
+	/// A static terrain surface from uniformly spaced height samples
+	b2_heightFieldShape,
+
 	/// The number of shape types
 	b2_shapeTypeCount
 } b2ShapeType;
@@ -411,6 +509,9 @@ typedef struct b2ShapeDef
 	/// Collision filtering data.
 	b2Filter filter;
 
+	/// Optional shared polygon geometry from b2CreateGeometry. Only used by b2CreatePolygonShape.
+	b2GeometryId geometry;
+
 	/// Enable custom filtering. Only one of the two shapes needs to enable custom filtering. See b2WorldDef.
 	bool enableCustomFiltering;
 
@@ -505,6 +606,31 @@ typedef struct b2ChainDef
 /// @ingroup shape
 B2_API b2ChainDef b2DefaultChainDef( void );
 
+/// Terrain height samples used to create a heightfield shape. The samples are uniformly spaced along
+/// the local x-axis starting at the shape origin. The solid side is below the surface. Cell i spans
+/// samples i and i + 1. The arrays are cloned by b2CreateHeightFieldShape.
+/// @ingroup shape
+typedef struct b2HeightField
+{
+	/// The height samples, in meters
+	const float* heights;
+
+	/// The number of height samples, must be at least 2
+	int count;
+
+	/// The horizontal distance between samples, must be positive
+	float spacing;
+
+	/// Optional surface materials selected per cell. May be NULL to use the shape material.
+	const b2SurfaceMaterial* materials;
+
+	/// The number of materials
+	int materialCount;
+
+	/// Optional material index for each cell, count - 1 entries. Ignored if there are no materials.
+	const uint8_t* materialIndices;
+} b2HeightField;
+
 //! @cond
 /// Profiling data. Times are in milliseconds.
 typedef struct b2Profile
@@ -532,8 +658,59 @@ typedef struct b2Profile
 	float bullets;
 	float sleepIslands;
 	float sensors;
+
+	/// Per worker time spent spinning or yielding while waiting for work. Index 0 is the thread
+	/// calling b2World_Step. Solver stage waits are attributed to the solver worker index.
+	float workerSpin[B2_MAX_WORKERS];
+
+	/// Per worker time parked on a semaphore during the step. Only the internal scheduler parks.
+	float workerPark[B2_MAX_WORKERS];
 } b2Profile;
 
+/// The kind of parallel work recorded by a timeline event. The solver stages come first
+/// in solver order, followed by the parallel-for phases.
+typedef enum b2TimelineStage
+{
+	b2_timelinePrepareJoints,
+	b2_timelinePrepareContacts,
+	b2_timelineIntegrateVelocities,
+	b2_timelineWarmStart,
+	b2_timelineSolve,
+	b2_timelineIntegratePositions,
+	b2_timelineRelax,
+	b2_timelineRestitution,
+	b2_timelineStoreImpulses,
+	b2_timelineFindPairs,
+	b2_timelineCollide,
+	b2_timelineFinalizeBodies,
+	b2_timelineBullets,
+	b2_timelineSensors,
+	b2_timelineQueries,
+	b2_timelineRebuildTree,
+	b2_timelineContactState,
+	b2_timelineCreateContacts,
+	b2_timelineRefit,
+	b2_timelineStageCount
+} b2TimelineStage;
+
+/// One block of parallel work executed by a worker: a claimed solver block or a parallel-for block.
+/// @see b2World_GetTimeline
+typedef struct b2TimelineEvent
+{
+	/// Start and end of the block, see b2GetTicks
+	uint64_t startTicks;
+	uint64_t endTicks;
+
+	/// The worker that executed the block
+	int workerIndex;
+
+	/// The work performed
+	b2TimelineStage stage;
+
+	/// The number of items in the block, such as bodies, contacts, or constraint bundles
+	int itemCount;
+} b2TimelineEvent;
+
 /// Counters that give details of the simulation size.
 typedef struct b2Counters
 {
@@ -556,6 +733,22 @@ typedef struct b2Counters
 	// Number of contacts recycled in the most recent step.
 	int recycledContactCount;
 
+	// Number of awake constraints that don't fit in the graph coloring.
+	int overflowContactCount;
+	int overflowJointCount;
+
+	// Number of contacts moved between graph colors by the rebalancer in the most recent step.
+	int rebalancedContactCount;
+
+	// Number of contacts reordered within a graph color by the contact sort in the most recent step.
+	int sortedContactCount;
+
+	// Largest graph color contact count over the average of the non-empty colors. One is perfectly balanced.
+	float colorImbalance;
+
+	// Fraction of the wide contact solver lanes holding a real constraint.
+	float colorLaneFill;
+
 } b2Counters;
 //! @endcond
 
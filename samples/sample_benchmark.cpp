@@ -1033,6 +1033,29 @@ public:
 
 static int sampleSmash = RegisterSample( "Benchmark", "Smash", BenchmarkSmash::Create );
 
+class BenchmarkPlatform : public Sample
+{
+public:
+	explicit BenchmarkPlatform( SampleContext* context )
+		: Sample( context )
+	{
+		if ( m_context->restart == false )
+		{
+			m_context->camera.center = { 0.0f, 10.0f };
+			m_context->camera.zoom = 25.0f * 2.5f;
+		}
+
+		CreatePlatform( m_worldId );
+	}
+
+	static Sample* Create( SampleContext* context )
+	{
+		return new BenchmarkPlatform( context );
+	}
+};
+
+static int samplePlatform = RegisterSample( "Benchmark", "Platform", BenchmarkPlatform::Create );
+
 class BenchmarkLargeCompounds : public Sample
 {
 public:
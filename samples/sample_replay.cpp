@@ -44,6 +44,10 @@ static const char* ReplayShapeTypeName( b2ShapeType type )
 			return "polygon";
 		case b2_chainSegmentShape:
 			return "chain segment";
+		case b2_meshShape:
+			return "mesh";
+		case b2_heightFieldShape:
+			return "heightfield";
 		default:
 			return "?";
 	}
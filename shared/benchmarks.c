@@ -891,3 +891,64 @@ void CreateCompounds( b2WorldId worldId )
 		}
 	}
 }
+
+// A heavy platform carrying a pile of debris. The platform touches far more bodies than there are
+// graph colors, so most of its contacts land in the overflow color.
+void CreatePlatform( b2WorldId worldId )
+{
+	{
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		b2Polygon box = b2MakeOffsetBox( 80.0f, 1.0f, (b2Vec2){ 0.0f, -1.0f }, b2Rot_identity );
+		b2CreatePolygonShape( groundId, &shapeDef, &box );
+	}
+
+	float halfWidth = BENCHMARK_DEBUG ? 15.0f : 60.0f;
+
+	{
+		// The platform never sleeps so the debris island stays awake
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		bodyDef.type = b2_dynamicBody;
+		bodyDef.position = (b2Vec2){ 0.0f, 0.5f };
+		bodyDef.enableSleep = false;
+		b2BodyId platformId = b2CreateBody( worldId, &bodyDef );
+
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		shapeDef.density = 20.0f;
+		b2Polygon box = b2MakeBox( halfWidth, 0.5f );
+		b2CreatePolygonShape( platformId, &shapeDef, &box );
+	}
+
+	float d = 0.4f;
+	b2Polygon box = b2MakeSquare( 0.4f * d );
+	b2Circle circle = { { 0.0f, 0.0f }, 0.4f * d };
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	int columns = (int)( 2.0f * ( halfWidth - 1.0f ) / d );
+	int rows = BENCHMARK_DEBUG ? 4 : 10;
+
+	for ( int i = 0; i < columns; ++i )
+	{
+		for ( int j = 0; j < rows; ++j )
+		{
+			bodyDef.position.x = -halfWidth + 1.0f + i * d;
+			bodyDef.position.y = 1.0f + 0.5f * d + j * d;
+			b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+
+			if ( ( i + j ) % 3 == 0 )
+			{
+				b2CreateCircleShape( bodyId, &shapeDef, &circle );
+			}
+			else
+			{
+				b2CreatePolygonShape( bodyId, &shapeDef, &box );
+			}
+		}
+	}
+}
@@ -28,6 +28,7 @@ void CreateWasher( b2WorldId worldId );
 void CreateJunkyard( b2WorldId worldId );
 float StepJunkyard( b2WorldId worldId, int stepCount );
 void CreateCompounds( b2WorldId worldId );
+void CreatePlatform( b2WorldId worldId );
 
 #ifdef __cplusplus
 }
@@ -8,6 +8,10 @@
 #elif defined( __APPLE__ )
 #include <unistd.h>
 #elif defined( __linux__ )
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 #elif defined( __EMSCRIPTEN__ )
 #include <unistd.h>
@@ -49,3 +53,113 @@ int GetNumberOfCores( void )
 	return 1;
 #endif
 }
+
+#if defined( __linux__ )
+
+static int OpenPerfEvent( uint32_t type, uint64_t config )
+{
+	struct perf_event_attr attr;
+	memset( &attr, 0, sizeof( attr ) );
+	attr.size = sizeof( attr );
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	// This thread on any CPU
+	return (int)syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+
+static long long ReadPerfEvent( int handle )
+{
+	if ( handle < 0 )
+	{
+		return -1;
+	}
+
+	ioctl( handle, PERF_EVENT_IOC_DISABLE, 0 );
+
+	long long count = 0;
+	if ( read( handle, &count, sizeof( count ) ) != sizeof( count ) )
+	{
+		return -1;
+	}
+
+	return count;
+}
+
+bool CreateCacheMissCounter( CacheMissCounter* counter )
+{
+	uint64_t l1ReadMiss = PERF_COUNT_HW_CACHE_L1D | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) |
+						  ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+	counter->l1Handle = OpenPerfEvent( PERF_TYPE_HW_CACHE, l1ReadMiss );
+	counter->lastLevelHandle = OpenPerfEvent( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES );
+	return counter->l1Handle >= 0 || counter->lastLevelHandle >= 0;
+}
+
+void DestroyCacheMissCounter( CacheMissCounter* counter )
+{
+	if ( counter->l1Handle >= 0 )
+	{
+		close( counter->l1Handle );
+	}
+
+	if ( counter->lastLevelHandle >= 0 )
+	{
+		close( counter->lastLevelHandle );
+	}
+
+	counter->l1Handle = -1;
+	counter->lastLevelHandle = -1;
+}
+
+void StartCacheMissCounter( CacheMissCounter* counter )
+{
+	if ( counter->l1Handle >= 0 )
+	{
+		ioctl( counter->l1Handle, PERF_EVENT_IOC_RESET, 0 );
+		ioctl( counter->l1Handle, PERF_EVENT_IOC_ENABLE, 0 );
+	}
+
+	if ( counter->lastLevelHandle >= 0 )
+	{
+		ioctl( counter->lastLevelHandle, PERF_EVENT_IOC_RESET, 0 );
+		ioctl( counter->lastLevelHandle, PERF_EVENT_IOC_ENABLE, 0 );
+	}
+}
+
+void StopCacheMissCounter( CacheMissCounter* counter, long long* l1Misses, long long* lastLevelMisses )
+{
+	*l1Misses = ReadPerfEvent( counter->l1Handle );
+	*lastLevelMisses = ReadPerfEvent( counter->lastLevelHandle );
+}
+
+#else
+
+bool CreateCacheMissCounter( CacheMissCounter* counter )
+{
+	counter->l1Handle = -1;
+	counter->lastLevelHandle = -1;
+	return false;
+}
+
+void DestroyCacheMissCounter( CacheMissCounter* counter )
+{
+	counter->l1Handle = -1;
+	counter->lastLevelHandle = -1;
+}
+
+void StartCacheMissCounter( CacheMissCounter* counter )
+{
+	(void)counter;
+}
+
+void StopCacheMissCounter( CacheMissCounter* counter, long long* l1Misses, long long* lastLevelMisses )
+{
+	(void)counter;
+	*l1Misses = -1;
+	*lastLevelMisses = -1;
+}
+
+#endif
@@ -21,6 +21,22 @@ b2Polygon RandomPolygon( float extent );
 
 int GetNumberOfCores( void );
 
+// Hardware cache miss counters for the calling thread. These use the Linux perf events and are
+// unavailable on other platforms or when the kernel does not expose the hardware events.
+typedef struct CacheMissCounter
+{
+	int l1Handle;
+	int lastLevelHandle;
+} CacheMissCounter;
+
+// Returns false if neither counter is available
+bool CreateCacheMissCounter( CacheMissCounter* counter );
+void DestroyCacheMissCounter( CacheMissCounter* counter );
+
+// Counting is only enabled between start and stop. A miss count is -1 if the event is not available.
+void StartCacheMissCounter( CacheMissCounter* counter );
+void StopCacheMissCounter( CacheMissCounter* counter, long long* l1Misses, long long* lastLevelMisses );
+
 #ifdef __cplusplus
 }
 #endif
@@ -90,6 +90,17 @@ static inline int64_t b2AtomicFetchAddI64( b2AtomicI64* a, int64_t increment )
 #endif
 }
 
+static inline void b2AtomicStoreI64( b2AtomicI64* a, int64_t value )
+{
+#if defined( _MSC_VER )
+	(void)_InterlockedExchange64( (__int64*)&a->value, (__int64)value );
+#elif defined( __GNUC__ ) || defined( __clang__ )
+	__atomic_store_n( &a->value, value, __ATOMIC_SEQ_CST );
+#else
+#error "Unsupported platform"
+#endif
+}
+
 static inline int64_t b2AtomicLoadI64( b2AtomicI64* a )
 {
 #if defined( _MSC_VER )
@@ -100,3 +111,112 @@ static inline int64_t b2AtomicLoadI64( b2AtomicI64* a )
 #error "Unsupported platform"
 #endif
 }
+
+static inline uint64_t b2AtomicLoadU64( const b2AtomicU64* a )
+{
+#if defined( _MSC_VER )
+	// A locked read would make concurrent readers of the same cache line contend
+	return (uint64_t)__iso_volatile_load64( (const volatile __int64*)&a->value );
+#elif defined( __GNUC__ ) || defined( __clang__ )
+	return __atomic_load_n( &a->value, __ATOMIC_SEQ_CST );
+#else
+#error "Unsupported platform"
+#endif
+}
+
+// Returns the value before the exchange. The exchange happened if this equals expected.
+static inline uint64_t b2AtomicCompareExchangeU64( b2AtomicU64* a, uint64_t expected, uint64_t desired )
+{
+#if defined( _MSC_VER )
+	return (uint64_t)_InterlockedCompareExchange64( (__int64*)&a->value, (__int64)desired, (__int64)expected );
+#elif defined( __GNUC__ ) || defined( __clang__ )
+	__atomic_compare_exchange_n( &a->value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+	return expected;
+#else
+#error "Unsupported platform"
+#endif
+}
+
+static inline void b2AtomicStoreU64( b2AtomicU64* a, uint64_t value )
+{
+#if defined( _MSC_VER )
+	(void)_InterlockedExchange64( (__int64*)&a->value, (__int64)value );
+#elif defined( __GNUC__ ) || defined( __clang__ )
+	__atomic_store_n( &a->value, value, __ATOMIC_SEQ_CST );
+#else
+#error "Unsupported platform"
+#endif
+}
+
+static inline uint8_t b2AtomicLoadU8( const b2AtomicU8* a )
+{
+#if defined( _MSC_VER )
+	return (uint8_t)__iso_volatile_load8( (const volatile char*)&a->value );
+#elif defined( __GNUC__ ) || defined( __clang__ )
+	return __atomic_load_n( &a->value, __ATOMIC_SEQ_CST );
+#else
+#error "Unsupported platform"
+#endif
+}
+
+static inline void b2AtomicStoreU8( b2AtomicU8* a, uint8_t value )
+{
+#if defined( _MSC_VER )
+	(void)_InterlockedExchange8( (char*)&a->value, (char)value );
+#elif defined( __GNUC__ ) || defined( __clang__ )
+	__atomic_store_n( &a->value, value, __ATOMIC_SEQ_CST );
+#else
+#error "Unsupported platform"
+#endif
+}
+
+static inline bool b2AtomicCompareExchangeU8( b2AtomicU8* a, uint8_t expected, uint8_t desired )
+{
+#if defined( _MSC_VER )
+	return (uint8_t)_InterlockedCompareExchange8( (char*)&a->value, (char)desired, (char)expected ) == expected;
+#elif defined( __GNUC__ ) || defined( __clang__ )
+	// The value written to expected is ignored
+	return __atomic_compare_exchange_n( &a->value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+#else
+#error "Unsupported platform"
+#endif
+}
+
+// Returns the value before the or
+static inline uint16_t b2AtomicFetchOrU16( b2AtomicU16* a, uint16_t value )
+{
+#if defined( _MSC_VER )
+	return (uint16_t)_InterlockedOr16( (short*)&a->value, (short)value );
+#elif defined( __GNUC__ ) || defined( __clang__ )
+	return __atomic_fetch_or( &a->value, value, __ATOMIC_SEQ_CST );
+#else
+#error "Unsupported platform"
+#endif
+}
+
+// CPU hint used inside spin-wait loops
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+static inline void b2Pause( void )
+{
+	__asm__ __volatile__( "pause\n" );
+}
+#elif ( defined( __arm__ ) && defined( __ARM_ARCH ) && __ARM_ARCH >= 7 ) || defined( __aarch64__ )
+static inline void b2Pause( void )
+{
+	__asm__ __volatile__( "yield" ::: "memory" );
+}
+#elif defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+static inline void b2Pause( void )
+{
+	_mm_pause();
+}
+#elif defined( _MSC_VER ) && ( defined( _M_ARM ) || defined( _M_ARM64 ) )
+static inline void b2Pause( void )
+{
+	__yield();
+}
+#else
+static inline void b2Pause( void )
+{
+}
+#endif
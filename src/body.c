@@ -387,6 +387,7 @@ void b2DestroyBody( b2BodyId bodyId )
 		}
 
 		b2DestroyShapeProxy( shape, &world->broadPhase );
+		b2FreeShapeData( world, b2Array_Get( world->shapeSims, shapeId ) );
 
 		// Return shape to free list.
 		b2FreeId( &world->shapeIdPool, shapeId );
@@ -551,7 +552,7 @@ void b2UpdateBodyMassData( b2World* world, b2Body* body )
 			{
 				const b2Shape* s = b2Array_Get( world->shapes, shapeId );
 
-				b2ShapeExtent extent = b2ComputeShapeExtent( s, b2Vec2_zero );
+				b2ShapeExtent extent = b2ComputeShapeExtent( b2Array_Get( world->shapeSims, shapeId ), b2Vec2_zero );
 				bodySim->minExtent = b2MinFloat( bodySim->minExtent, extent.minExtent );
 				bodySim->maxExtent = b2MaxFloat( bodySim->maxExtent, extent.maxExtent );
 
@@ -581,7 +582,7 @@ void b2UpdateBodyMassData( b2World* world, b2Body* body )
 			continue;
 		}
 
-		b2MassData massData = b2ComputeShapeMass( s );
+		b2MassData massData = b2ComputeShapeMass( b2Array_Get( world->shapeSims, s->id ), s->density );
 		body->mass += massData.mass;
 		localCenter = b2MulAdd( localCenter, massData.mass, massData.center );
 
@@ -646,7 +647,7 @@ void b2UpdateBodyMassData( b2World* world, b2Body* body )
 	{
 		const b2Shape* s = b2Array_Get( world->shapes, shapeId );
 
-		b2ShapeExtent extent = b2ComputeShapeExtent( s, localCenter );
+		b2ShapeExtent extent = b2ComputeShapeExtent( b2Array_Get( world->shapeSims, shapeId ), localCenter );
 		bodySim->minExtent = b2MinFloat( bodySim->minExtent, extent.minExtent );
 		bodySim->maxExtent = b2MaxFloat( bodySim->maxExtent, extent.maxExtent );
 
@@ -738,14 +739,15 @@ void b2Body_SetTransform( b2BodyId bodyId, b2Vec2 position, b2Rot rotation )
 	while ( shapeId != B2_NULL_INDEX )
 	{
 		b2Shape* shape = b2Array_Get( world->shapes, shapeId );
-		b2AABB aabb = b2ComputeShapeAABB( shape, transform );
+		b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
+		b2AABB aabb = b2ComputeShapeAABB( shapeSim, transform );
 		aabb.lowerBound.x -= speculativeDistance;
 		aabb.lowerBound.y -= speculativeDistance;
 		aabb.upperBound.x += speculativeDistance;
 		aabb.upperBound.y += speculativeDistance;
 		shape->aabb = aabb;
 
-		if ( b2AABB_Contains( shape->fatAABB, aabb ) == false )
+		if ( b2AABB_Contains( shapeSim->fatAABB, aabb ) == false )
 		{
 			float margin = shape->aabbMargin;
 			b2AABB fatAABB;
@@ -753,7 +755,7 @@ void b2Body_SetTransform( b2BodyId bodyId, b2Vec2 position, b2Rot rotation )
 			fatAABB.lowerBound.y = aabb.lowerBound.y - margin;
 			fatAABB.upperBound.x = aabb.upperBound.x + margin;
 			fatAABB.upperBound.y = aabb.upperBound.y + margin;
-			shape->fatAABB = fatAABB;
+			shapeSim->fatAABB = fatAABB;
 
 			// They body could be disabled
 			if ( shape->proxyKey != B2_NULL_INDEX )
@@ -1282,7 +1284,7 @@ void b2Body_SetType( b2BodyId bodyId, b2BodyType type )
 		shapeId = shape->nextShapeId;
 		b2DestroyShapeProxy( shape, &world->broadPhase );
 		bool forcePairCreation = true;
-		b2CreateShapeProxy( shape, &world->broadPhase, type, transform, forcePairCreation );
+		b2CreateShapeProxy( world, shape, type, transform, forcePairCreation );
 	}
 
 	// Relink all joints
@@ -1571,8 +1573,8 @@ void b2Body_WakeTouching( b2BodyId bodyId )
 		int edgeIndex = contactKey & 1;
 
 		b2Contact* contact = b2Array_Get( world->contacts, contactId );
-		b2Shape* shapeA = b2Array_Get( world->shapes, contact->shapeIdA );
-		b2Shape* shapeB = b2Array_Get( world->shapes, contact->shapeIdB );
+		b2ShapeSim* shapeA = b2Array_Get( world->shapeSims, contact->shapeIdA );
+		b2ShapeSim* shapeB = b2Array_Get( world->shapeSims, contact->shapeIdB );
 
 		if ( shapeA->bodyId == bodyId.index1 - 1 )
 		{
@@ -1752,7 +1754,7 @@ void b2Body_Enable( b2BodyId bodyId )
 		b2Shape* shape = b2Array_Get( world->shapes, shapeId );
 		shapeId = shape->nextShapeId;
 
-		b2CreateShapeProxy( shape, &world->broadPhase, proxyType, transform, forcePairCreation );
+		b2CreateShapeProxy( world, shape, proxyType, transform, forcePairCreation );
 	}
 
 	if ( setId != b2_staticSet )
@@ -1954,7 +1956,7 @@ void b2Body_EnableHitEvents( b2BodyId bodyId, bool flag )
 	while ( shapeId != B2_NULL_INDEX )
 	{
 		b2Shape* shape = b2Array_Get( world->shapes, shapeId );
-		shape->enableHitEvents = flag;
+		b2Array_Get( world->shapeSims, shapeId )->enableHitEvents = flag;
 		shapeId = shape->nextShapeId;
 	}
 }
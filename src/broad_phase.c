@@ -13,6 +13,8 @@
 #include "body.h"
 #include "contact.h"
 #include "core.h"
+#include "ctz.h"
+#include "dynamic_tree.h"
 #include "parallel_for.h"
 #include "physics_world.h"
 #include "shape.h"
@@ -43,6 +45,11 @@ void b2CreateBroadPhase( b2BroadPhase* bp, const b2Capacity* capacity )
 	bp->movePairCapacity = 0;
 	b2AtomicStoreInt( &bp->movePairIndex, 0 );
 	bp->pairSet = b2CreateSet( b2MaxInt( 32, 2 * capacity->contactCount ) );
+	bp->newPairCount = 0;
+	bp->type = b2_treeBroadPhase;
+	bp->gridCellSize = 0.0f;
+	bp->grid = NULL;
+	b2Array_Create( bp->enlargeArray );
 
 	int staticCapacity = b2MaxInt( 16, capacity->staticShapeCount );
 	bp->trees[b2_staticBody] = b2DynamicTree_Create( staticCapacity );
@@ -67,6 +74,7 @@ void b2DestroyBroadPhase( b2BroadPhase* bp )
 	}
 	b2Array_Destroy( bp->moveArray );
 	b2DestroySet( &bp->pairSet );
+	b2Array_Destroy( bp->enlargeArray );
 
 	memset( bp, 0, sizeof( b2BroadPhase ) );
 
@@ -134,29 +142,215 @@ void b2BroadPhase_MoveProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb )
 	b2BufferMove( bp, proxyKey );
 }
 
-void b2BroadPhase_EnlargeProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb )
+void b2BroadPhase_DeferEnlargeProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb )
 {
 	B2_ASSERT( proxyKey != B2_NULL_INDEX );
-	int typeIndex = B2_PROXY_TYPE( proxyKey );
-	int proxyId = B2_PROXY_ID( proxyKey );
-
-	B2_ASSERT( typeIndex != b2_staticBody );
+	B2_ASSERT( B2_PROXY_TYPE( proxyKey ) != b2_staticBody );
 
-	b2DynamicTree_EnlargeProxy( bp->trees + typeIndex, proxyId, aabb );
+	b2ProxyEnlargement enlargement = { aabb, proxyKey };
+	b2Array_Push( bp->enlargeArray, enlargement );
 	b2BufferMove( bp, proxyKey );
 }
 
+void b2BroadPhase_ApplyEnlargements( b2BroadPhase* bp )
+{
+	int count = bp->enlargeArray.count;
+	b2ProxyEnlargement* enlargements = bp->enlargeArray.data;
+	for ( int i = 0; i < count; ++i )
+	{
+		int proxyKey = enlargements[i].proxyKey;
+		b2DynamicTree_EnlargeProxy( bp->trees + B2_PROXY_TYPE( proxyKey ), B2_PROXY_ID( proxyKey ), enlargements[i].aabb );
+	}
+
+	b2Array_Clear( bp->enlargeArray );
+}
+
+// Below this many enlarged proxies the serial refit is faster
+#define B2_PARALLEL_REFIT_THRESHOLD 256
+
+// Minimum nodes per block when refitting a level in parallel
+#define B2_PARALLEL_REFIT_LEVEL_RANGE 256
+
+// Bound on the tree height, the trees are balanced
+#define B2_MAX_TREE_HEIGHT 1024
+
+// The parallel refit sets the enlarged leaf boxes and flags their ancestors in parallel. Then it grows the
+// flagged nodes level by level, from the leaves to the root. Growing a box is order independent so the trees
+// are identical to the serial refit.
+typedef struct b2RefitContext
+{
+	b2BroadPhase* bp;
+	b2ProxyEnlargement* enlargements;
+
+	// Flagged internal nodes as proxy keys with their heights. The order depends on the workers.
+	int* flaggedKeys;
+	int* flaggedHeights;
+	b2AtomicInt flaggedCount;
+
+	// Flagged nodes sorted by height
+	int* sortedKeys;
+
+	// The level being refit
+	int levelStart;
+} b2RefitContext;
+
+static void b2FlagEnlargedProxiesTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( flag_enlarged, "Flag Enlarged", b2_colorFireBrick, true );
+
+	B2_UNUSED( workerIndex );
+
+	b2RefitContext* refitContext = context;
+	b2BroadPhase* bp = refitContext->bp;
+
+	int flaggedNodes[B2_MAX_TREE_HEIGHT];
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2ProxyEnlargement* enlargement = refitContext->enlargements + i;
+		b2BodyType proxyType = B2_PROXY_TYPE( enlargement->proxyKey );
+		b2DynamicTree* tree = bp->trees + proxyType;
+
+		int count = b2DynamicTree_FlagEnlargedProxy( tree, B2_PROXY_ID( enlargement->proxyKey ), enlargement->aabb,
+													 flaggedNodes, B2_MAX_TREE_HEIGHT );
+		if ( count == 0 )
+		{
+			continue;
+		}
+
+		int base = b2AtomicFetchAddInt( &refitContext->flaggedCount, count );
+		for ( int j = 0; j < count; ++j )
+		{
+			int nodeIndex = flaggedNodes[j];
+			refitContext->flaggedKeys[base + j] = B2_PROXY_KEY( nodeIndex, proxyType );
+			refitContext->flaggedHeights[base + j] = tree->nodeData[nodeIndex].height;
+		}
+	}
+
+	b2TracyCZoneEnd( flag_enlarged );
+}
+
+static void b2RefitLevelTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( refit_level, "Refit Level", b2_colorFireBrick, true );
+
+	B2_UNUSED( workerIndex );
+
+	b2RefitContext* refitContext = context;
+	b2BroadPhase* bp = refitContext->bp;
+	const int* keys = refitContext->sortedKeys + refitContext->levelStart;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		int key = keys[i];
+		b2DynamicTree_RefitNode( bp->trees + B2_PROXY_TYPE( key ), B2_PROXY_ID( key ) );
+	}
+
+	b2TracyCZoneEnd( refit_level );
+}
+
+void b2RefitBroadPhase( b2World* world )
+{
+	b2BroadPhase* bp = &world->broadPhase;
+	int enlargeCount = bp->enlargeArray.count;
+
+	// The parallel refit only pays off for many enlarged proxies. Both paths give the same trees.
+	if ( world->workerCount == 1 || enlargeCount < B2_PARALLEL_REFIT_THRESHOLD )
+	{
+		b2BroadPhase_ApplyEnlargements( bp );
+		return;
+	}
+
+	b2Stack* alloc = &world->stack;
+	b2DynamicTree* kinematicTree = bp->trees + b2_kinematicBody;
+	b2DynamicTree* dynamicTree = bp->trees + b2_dynamicBody;
+	kinematicTree->wideNodeCount = 0;
+	dynamicTree->wideNodeCount = 0;
+
+	// Every flagged node is an allocated internal node
+	int nodeCapacity = b2MaxInt( 1, kinematicTree->nodeCount + dynamicTree->nodeCount );
+
+	b2RefitContext context = { 0 };
+	context.bp = bp;
+	context.enlargements = bp->enlargeArray.data;
+	context.flaggedKeys = b2StackAlloc( alloc, nodeCapacity * sizeof( int ), "flagged keys" );
+	context.flaggedHeights = b2StackAlloc( alloc, nodeCapacity * sizeof( int ), "flagged heights" );
+	context.sortedKeys = b2StackAlloc( alloc, nodeCapacity * sizeof( int ), "sorted keys" );
+	b2AtomicStoreInt( &context.flaggedCount, 0 );
+
+	// Set the leaf boxes and flag the ancestors
+	b2ParallelFor( world, b2_timelineRefit, b2FlagEnlargedProxiesTask, enlargeCount, 64, &context );
+
+	int flaggedCount = b2AtomicLoadInt( &context.flaggedCount );
+	B2_ASSERT( flaggedCount <= nodeCapacity );
+
+	// Counting sort by height so the children of a node are refit before the node
+	int levelCount = 1 + b2MaxInt( kinematicTree->root == B2_NULL_INDEX ? 0 : kinematicTree->nodeData[kinematicTree->root].height,
+								   dynamicTree->root == B2_NULL_INDEX ? 0 : dynamicTree->nodeData[dynamicTree->root].height );
+	int* levelStarts = b2StackAlloc( alloc, ( levelCount + 1 ) * sizeof( int ), "level starts" );
+	memset( levelStarts, 0, ( levelCount + 1 ) * sizeof( int ) );
+
+	for ( int i = 0; i < flaggedCount; ++i )
+	{
+		B2_ASSERT( 0 < context.flaggedHeights[i] && context.flaggedHeights[i] < levelCount );
+		levelStarts[context.flaggedHeights[i] + 1] += 1;
+	}
+
+	for ( int i = 0; i < levelCount; ++i )
+	{
+		levelStarts[i + 1] += levelStarts[i];
+	}
+
+	for ( int i = 0; i < flaggedCount; ++i )
+	{
+		int index = levelStarts[context.flaggedHeights[i]]++;
+		context.sortedKeys[index] = context.flaggedKeys[i];
+	}
+
+	// Refit level by level. The upper levels are small so they are refit on this thread.
+	int start = 0;
+	for ( int height = 1; height < levelCount; ++height )
+	{
+		int end = levelStarts[height];
+		int count = end - start;
+		if ( count >= 2 * B2_PARALLEL_REFIT_LEVEL_RANGE )
+		{
+			context.levelStart = start;
+			b2ParallelFor( world, b2_timelineRefit, b2RefitLevelTask, count, B2_PARALLEL_REFIT_LEVEL_RANGE, &context );
+		}
+		else
+		{
+			for ( int i = start; i < end; ++i )
+			{
+				int key = context.sortedKeys[i];
+				b2DynamicTree_RefitNode( bp->trees + B2_PROXY_TYPE( key ), B2_PROXY_ID( key ) );
+			}
+		}
+
+		start = end;
+	}
+
+	b2StackFree( alloc, levelStarts );
+	b2StackFree( alloc, context.sortedKeys );
+	b2StackFree( alloc, context.flaggedHeights );
+	b2StackFree( alloc, context.flaggedKeys );
+
+	b2Array_Clear( bp->enlargeArray );
+}
+
 typedef struct b2MovePair
 {
 	int shapeIndexA;
 	int shapeIndexB;
 	b2MovePair* next;
 	bool heap;
+	bool keyAdded;
 } b2MovePair;
 
 typedef struct b2MoveResult
 {
 	b2MovePair* pairList;
+	int pairCount;
 } b2MoveResult;
 
 typedef struct b2QueryPairContext
@@ -219,7 +413,7 @@ static bool b2PairQueryCallback( int proxyId, uint64_t userData, void* context )
 	}
 
 	uint64_t pairKey = B2_SHAPE_PAIR_KEY( shapeId, queryContext->queryShapeIndex );
-	bool pairExists = b2ContainsKey( &broadPhase->pairSet, pairKey );
+	bool pairExists = b2ContainsKeyConcurrent( &broadPhase->pairSet, pairKey );
 	if ( pairExists )
 	{
 		// contact exists
@@ -242,9 +436,11 @@ static bool b2PairQueryCallback( int proxyId, uint64_t userData, void* context )
 
 	b2Shape* shapeA = b2Array_Get( world->shapes, shapeIdA );
 	b2Shape* shapeB = b2Array_Get( world->shapes, shapeIdB );
+	b2ShapeSim* shapeSimA = b2Array_Get( world->shapeSims, shapeIdA );
+	b2ShapeSim* shapeSimB = b2Array_Get( world->shapeSims, shapeIdB );
 
-	int bodyIdA = shapeA->bodyId;
-	int bodyIdB = shapeB->bodyId;
+	int bodyIdA = shapeSimA->bodyId;
+	int bodyIdB = shapeSimB->bodyId;
 
 	// Are the shapes on the same body?
 	if ( bodyIdA == bodyIdB )
@@ -263,7 +459,7 @@ static bool b2PairQueryCallback( int proxyId, uint64_t userData, void* context )
 		return true;
 	}
 
-	if ( b2CanCollide( shapeA->type, shapeB->type ) == false )
+	if ( b2CanCollide( shapeSimA->type, shapeSimB->type ) == false )
 	{
 		// For example, no segment vs segment collision
 		return true;
@@ -293,6 +489,21 @@ static bool b2PairQueryCallback( int proxyId, uint64_t userData, void* context )
 		}
 	}
 
+	// Claim the pair while there is room in the pair set. This saves adding the key serially
+	// when the contact is created.
+	bool keyAdded = false;
+	if ( b2AtomicFetchAddInt( &broadPhase->pairSetRoom, -1 ) > 0 )
+	{
+		bool alreadyAdded = b2AddKeyConcurrent( &broadPhase->pairSet, pairKey );
+		if ( alreadyAdded )
+		{
+			// Another worker found this pair
+			return true;
+		}
+
+		keyAdded = true;
+	}
+
 	int pairIndex = b2AtomicFetchAddInt( &broadPhase->movePairIndex, 1 );
 
 	b2MovePair* pair;
@@ -316,13 +527,274 @@ static bool b2PairQueryCallback( int proxyId, uint64_t userData, void* context )
 
 	pair->shapeIndexA = shapeIdA;
 	pair->shapeIndexB = shapeIdB;
+	pair->keyAdded = keyAdded;
 	pair->next = queryContext->moveResult->pairList;
 	queryContext->moveResult->pairList = pair;
+	queryContext->moveResult->pairCount += 1;
 
 	// continue the query
 	return true;
 }
 
+// The grid broad-phase bins the dynamic proxies into a uniform grid every step. Cells are hashed into a
+// fixed number of buckets so the grid is unbounded. The buckets are filled with a counting sort, so the
+// entries of a bucket follow the dynamic tree node order and the pairs are deterministic.
+typedef struct b2GridEntry
+{
+	b2AABB aabb;
+	int proxyId;
+	int shapeIndex;
+	int cellX;
+	int cellY;
+} b2GridEntry;
+
+typedef struct b2GridRange
+{
+	int lowerX, lowerY;
+	int upperX, upperY;
+} b2GridRange;
+
+typedef struct b2ProxyGrid
+{
+	// Dynamic proxies in tree node order
+	b2GridEntry* proxies;
+	int proxyCount;
+
+	// Proxies that cover too many cells are kept out of the buckets and tested by every query
+	b2GridEntry* largeProxies;
+	int largeCount;
+
+	// Entries of bucket i are in [bucketStarts[i], bucketStarts[i + 1])
+	b2GridEntry* entries;
+	int* bucketStarts;
+	int entryCount;
+	uint32_t bucketMask;
+
+	float invCellSize;
+} b2ProxyGrid;
+
+// A proxy that covers more cells goes in the large proxy list. This also bounds the cells scanned by
+// a query, larger queries fall back to the dynamic tree.
+#define B2_GRID_MAX_CELLS 16
+
+static int b2GridCoordinate( float x, float invCellSize )
+{
+	// Clamp to keep far away and invalid proxies in range
+	float c = b2ClampFloat( x * invCellSize, -1.0e9f, 1.0e9f );
+	int i = (int)c;
+	return (float)i > c ? i - 1 : i;
+}
+
+static b2GridRange b2GetGridRange( b2AABB aabb, float invCellSize )
+{
+	b2GridRange range = {
+		b2GridCoordinate( aabb.lowerBound.x, invCellSize ),
+		b2GridCoordinate( aabb.lowerBound.y, invCellSize ),
+		b2GridCoordinate( aabb.upperBound.x, invCellSize ),
+		b2GridCoordinate( aabb.upperBound.y, invCellSize ),
+	};
+	return range;
+}
+
+static bool b2IsSmallGridRange( b2GridRange range )
+{
+	int64_t countX = (int64_t)range.upperX - range.lowerX + 1;
+	int64_t countY = (int64_t)range.upperY - range.lowerY + 1;
+	return countX * countY <= B2_GRID_MAX_CELLS;
+}
+
+static uint32_t b2GridHash( int x, int y )
+{
+	uint32_t h = (uint32_t)x * 0x9E3779B1u + (uint32_t)y * 0x85EBCA77u;
+	return h ^ ( h >> 16 );
+}
+
+static b2ProxyGrid* b2BuildProxyGrid( b2BroadPhase* bp, b2Stack* alloc )
+{
+	b2TracyCZoneNC( build_grid, "Build Grid", b2_colorMediumSlateBlue, true );
+
+	const b2DynamicTree* tree = bp->trees + b2_dynamicBody;
+	const b2TreeNode* nodes = tree->nodes;
+	const b2TreeNodeData* nodeData = tree->nodeData;
+
+	b2ProxyGrid* grid = b2StackAlloc( alloc, sizeof( b2ProxyGrid ), "proxy grid" );
+	grid->proxies = b2StackAlloc( alloc, b2MaxInt( 1, tree->proxyCount ) * sizeof( b2GridEntry ), "grid proxies" );
+
+	// Gather the proxies that can pass the query mask
+	int proxyCount = 0;
+	float extentSum = 0.0f;
+	int nodeCapacity = tree->nodeCapacity;
+	for ( int i = 0; i < nodeCapacity; ++i )
+	{
+		if ( ( nodeData[i].flags & b2_leafNode ) == 0 || nodes[i].categoryBits == 0 )
+		{
+			continue;
+		}
+
+		b2AABB aabb = nodes[i].aabb;
+		grid->proxies[proxyCount] = (b2GridEntry){ aabb, i, (int)nodeData[i].userData, 0, 0 };
+		proxyCount += 1;
+
+		extentSum += b2MaxFloat( aabb.upperBound.x - aabb.lowerBound.x, aabb.upperBound.y - aabb.lowerBound.y );
+	}
+
+	// Twice the average size was the best trade-off between entries per proxy and proxies per cell
+	// in the rain, tumbler, and washer benchmarks
+	float cellSize = bp->gridCellSize;
+	if ( cellSize == 0.0f )
+	{
+		cellSize = proxyCount > 0 ? 2.0f * extentSum / proxyCount : 1.0f;
+	}
+
+	float invCellSize = cellSize > 0.0f ? 1.0f / cellSize : 1.0f;
+	grid->invCellSize = invCellSize;
+	grid->proxyCount = proxyCount;
+
+	int entryCount = 0;
+	int largeCount = 0;
+	for ( int i = 0; i < proxyCount; ++i )
+	{
+		b2GridRange range = b2GetGridRange( grid->proxies[i].aabb, invCellSize );
+		if ( b2IsSmallGridRange( range ) )
+		{
+			entryCount += ( range.upperX - range.lowerX + 1 ) * ( range.upperY - range.lowerY + 1 );
+		}
+		else
+		{
+			largeCount += 1;
+		}
+	}
+
+	grid->largeProxies = b2StackAlloc( alloc, b2MaxInt( 1, largeCount ) * sizeof( b2GridEntry ), "grid large proxies" );
+	grid->largeCount = largeCount;
+	grid->entryCount = entryCount;
+
+	int bucketCount = b2RoundUpPowerOf2( b2MaxInt( 16, entryCount ) );
+	grid->bucketMask = (uint32_t)( bucketCount - 1 );
+	grid->bucketStarts = b2StackAlloc( alloc, ( bucketCount + 1 ) * sizeof( int ), "grid buckets" );
+	grid->entries = b2StackAlloc( alloc, b2MaxInt( 1, entryCount ) * sizeof( b2GridEntry ), "grid entries" );
+
+	int* bucketStarts = grid->bucketStarts;
+	memset( bucketStarts, 0, ( bucketCount + 1 ) * sizeof( int ) );
+
+	largeCount = 0;
+	for ( int i = 0; i < proxyCount; ++i )
+	{
+		b2GridRange range = b2GetGridRange( grid->proxies[i].aabb, invCellSize );
+		if ( b2IsSmallGridRange( range ) == false )
+		{
+			grid->largeProxies[largeCount] = grid->proxies[i];
+			largeCount += 1;
+			continue;
+		}
+
+		for ( int y = range.lowerY; y <= range.upperY; ++y )
+		{
+			for ( int x = range.lowerX; x <= range.upperX; ++x )
+			{
+				bucketStarts[b2GridHash( x, y ) & grid->bucketMask] += 1;
+			}
+		}
+	}
+
+	// Bucket ends
+	int sum = 0;
+	for ( int i = 0; i < bucketCount; ++i )
+	{
+		sum += bucketStarts[i];
+		bucketStarts[i] = sum;
+	}
+	bucketStarts[bucketCount] = entryCount;
+
+	// Fill backwards so the bucket ends become the bucket starts and the entries keep the proxy order
+	for ( int i = proxyCount - 1; i >= 0; --i )
+	{
+		b2GridEntry entry = grid->proxies[i];
+		b2GridRange range = b2GetGridRange( entry.aabb, invCellSize );
+		if ( b2IsSmallGridRange( range ) == false )
+		{
+			continue;
+		}
+
+		for ( int y = range.upperY; y >= range.lowerY; --y )
+		{
+			for ( int x = range.upperX; x >= range.lowerX; --x )
+			{
+				entry.cellX = x;
+				entry.cellY = y;
+				int index = --bucketStarts[b2GridHash( x, y ) & grid->bucketMask];
+				grid->entries[index] = entry;
+			}
+		}
+	}
+
+	b2TracyCZoneEnd( build_grid );
+
+	return grid;
+}
+
+static void b2DestroyProxyGrid( b2ProxyGrid* grid, b2Stack* alloc )
+{
+	b2StackFree( alloc, grid->entries );
+	b2StackFree( alloc, grid->bucketStarts );
+	b2StackFree( alloc, grid->largeProxies );
+	b2StackFree( alloc, grid->proxies );
+	b2StackFree( alloc, grid );
+}
+
+// Reports each dynamic proxy overlapping the AABB once, like b2DynamicTree_Query
+static void b2QueryProxyGrid( const b2ProxyGrid* grid, const b2DynamicTree* tree, b2AABB aabb, b2QueryPairContext* context )
+{
+	float invCellSize = grid->invCellSize;
+	b2GridRange range = b2GetGridRange( aabb, invCellSize );
+	if ( b2IsSmallGridRange( range ) == false )
+	{
+		b2DynamicTree_Query( tree, aabb, B2_DEFAULT_MASK_BITS, b2PairQueryCallback, context );
+		return;
+	}
+
+	const b2GridEntry* entries = grid->entries;
+	const int* bucketStarts = grid->bucketStarts;
+
+	for ( int y = range.lowerY; y <= range.upperY; ++y )
+	{
+		for ( int x = range.lowerX; x <= range.upperX; ++x )
+		{
+			uint32_t bucket = b2GridHash( x, y ) & grid->bucketMask;
+			int endIndex = bucketStarts[bucket + 1];
+			for ( int i = bucketStarts[bucket]; i < endIndex; ++i )
+			{
+				const b2GridEntry* entry = entries + i;
+				if ( entry->cellX != x || entry->cellY != y || b2AABB_Overlaps( entry->aabb, aabb ) == false )
+				{
+					continue;
+				}
+
+				// Two proxies may share several cells. Only the cell holding the lower corner of the
+				// overlap reports the pair.
+				float lowerX = b2MaxFloat( entry->aabb.lowerBound.x, aabb.lowerBound.x );
+				float lowerY = b2MaxFloat( entry->aabb.lowerBound.y, aabb.lowerBound.y );
+				if ( b2GridCoordinate( lowerX, invCellSize ) != x || b2GridCoordinate( lowerY, invCellSize ) != y )
+				{
+					continue;
+				}
+
+				b2PairQueryCallback( entry->proxyId, (uint64_t)entry->shapeIndex, context );
+			}
+		}
+	}
+
+	int largeCount = grid->largeCount;
+	for ( int i = 0; i < largeCount; ++i )
+	{
+		const b2GridEntry* entry = grid->largeProxies + i;
+		if ( b2AABB_Overlaps( entry->aabb, aabb ) )
+		{
+			b2PairQueryCallback( entry->proxyId, (uint64_t)entry->shapeIndex, context );
+		}
+	}
+}
+
 // Warning: writing to these globals significantly slows multithreading performance
 #if B2_SNOOP_PAIR_COUNTERS
 b2TreeStats b2_dynamicStats;
@@ -347,6 +819,7 @@ static void b2FindPairsTask( int startIndex, int endIndex, int workerIndex, void
 		// Initialize move result for this moved proxy
 		queryContext.moveResult = bp->moveResults + i;
 		queryContext.moveResult->pairList = NULL;
+		queryContext.moveResult->pairCount = 0;
 
 		int proxyKey = bp->moveArray.data[i];
 		if ( proxyKey == B2_NULL_INDEX )
@@ -389,10 +862,17 @@ static void b2FindPairsTask( int startIndex, int endIndex, int workerIndex, void
 		// All proxies collide with dynamic proxies
 		// Using B2_DEFAULT_MASK_BITS so that b2Filter::groupIndex works.
 		queryContext.queryTreeType = b2_dynamicBody;
-		b2TreeStats statsDynamic =
-			b2DynamicTree_Query( bp->trees + b2_dynamicBody, fatAABB, B2_DEFAULT_MASK_BITS, b2PairQueryCallback, &queryContext );
-		stats.nodeVisits += statsDynamic.nodeVisits;
-		stats.leafVisits += statsDynamic.leafVisits;
+		if ( bp->grid != NULL )
+		{
+			b2QueryProxyGrid( bp->grid, bp->trees + b2_dynamicBody, fatAABB, &queryContext );
+		}
+		else
+		{
+			b2TreeStats statsDynamic = b2DynamicTree_Query( bp->trees + b2_dynamicBody, fatAABB, B2_DEFAULT_MASK_BITS,
+															b2PairQueryCallback, &queryContext );
+			stats.nodeVisits += statsDynamic.nodeVisits;
+			stats.leafVisits += statsDynamic.leafVisits;
+		}
 	}
 
 	b2TracyCZoneEnd( pair_task );
@@ -409,6 +889,60 @@ static void b2UpdateTreesTask( void* context )
 	b2TracyCZoneEnd( tree_task );
 }
 
+typedef struct b2CreateContactsContext
+{
+	b2World* world;
+	b2NewContact* newContacts;
+} b2CreateContactsContext;
+
+// Flattens the pair lists of the move results. The pair count of each result holds its offset.
+static void b2GatherPairsTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2CreateContactsContext* createContext = context;
+	b2World* world = createContext->world;
+	b2MoveResult* moveResults = world->broadPhase.moveResults;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2NewContact* newContact = createContext->newContacts + moveResults[i].pairCount;
+		b2MovePair* pair = moveResults[i].pairList;
+		while ( pair != NULL )
+		{
+			b2PrepareNewContact( world, newContact, pair->shapeIndexA, pair->shapeIndexB, 0 );
+			newContact->keyAdded = pair->keyAdded;
+			newContact += 1;
+
+			if ( pair->heap )
+			{
+				// Note: I tried adding to the pair set in parallel with contact creation
+				// but that didn't work with with pair heap allocation. I could make it
+				// work with a task context bump allocator with heap fallback. The perf
+				// gain was small or zero.
+				b2MovePair* temp = pair;
+				pair = pair->next;
+				b2Free( temp, sizeof( b2MovePair ) );
+			}
+			else
+			{
+				pair = pair->next;
+			}
+		}
+	}
+}
+
+static void b2InitializeContactsTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2CreateContactsContext* createContext = context;
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2InitializeContact( createContext->world, createContext->newContacts + i );
+	}
+}
+
 void b2UpdateBroadPhasePairs( b2World* world )
 {
 	b2BroadPhase* bp = &world->broadPhase;
@@ -434,13 +968,31 @@ void b2UpdateBroadPhasePairs( b2World* world )
 	bp->movePairs = b2StackAlloc( alloc, bp->movePairCapacity * sizeof( b2MovePair ), "move pairs" );
 	b2AtomicStoreInt( &bp->movePairIndex, 0 );
 
+	// Make room for about as many new pairs as last time. Most moved proxies find no new pair, and the
+	// pair set never shrinks. Pairs beyond the room are added serially when their contacts are created.
+	int reserveCount = b2MinInt( moveCount, bp->newPairCount + bp->newPairCount / 4 + 16 );
+	b2ReserveSet( &bp->pairSet, reserveCount );
+	b2AtomicStoreInt( &bp->pairSetRoom, b2GetSetRoom( &bp->pairSet ) );
+
 #if B2_SNOOP_TABLE_COUNTERS
 	extern b2AtomicInt b2_probeCount;
 	b2AtomicStoreInt( &b2_probeCount, 0 );
 #endif
 
+	if ( bp->type == b2_gridBroadPhase )
+	{
+		bp->grid = b2BuildProxyGrid( bp, alloc );
+	}
+
 	int minRange = 64;
-	b2ParallelFor( world, &b2FindPairsTask, moveCount, minRange, world );
+	b2ParallelFor( world, b2_timelineFindPairs, &b2FindPairsTask, moveCount, minRange, world );
+	bp->newPairCount = b2AtomicLoadInt( &bp->movePairIndex );
+
+	if ( bp->grid != NULL )
+	{
+		b2DestroyProxyGrid( bp->grid, alloc );
+		bp->grid = NULL;
+	}
 
 	b2TracyCZoneNC( create_contacts, "Create Contacts", b2_colorCoral, true );
 
@@ -458,56 +1010,46 @@ void b2UpdateBroadPhasePairs( b2World* world )
 		b2UpdateTreesTask( world );
 	}
 
-	// Single-threaded work
-	// - Clear move flags
-	// - Create contacts in deterministic order
-	// This is deterministic because the results follow the order of b2BroadPhase::moveArray.
+	// Create contacts in deterministic order. This is deterministic because the results follow the order
+	// of b2BroadPhase::moveArray. The pair lists are flattened and the contacts are filled in parallel.
+	// Ids, sim slots, and the body contact lists are handled serially in pair order. The pair set layout
+	// depends on the order the workers added keys, but it only answers membership queries.
+	int pairCount = 0;
 	for ( int i = 0; i < moveCount; ++i )
 	{
-		b2MoveResult* result = bp->moveResults + i;
-		b2MovePair* pair = result->pairList;
-		while ( pair != NULL )
-		{
-			int shapeIdA = pair->shapeIndexA;
-			int shapeIdB = pair->shapeIndexB;
+		int count = bp->moveResults[i].pairCount;
+		bp->moveResults[i].pairCount = pairCount;
+		pairCount += count;
+	}
 
-			// if (s_file != NULL)
-			//{
-			//	fprintf(s_file, "%d %d\n", shapeIdA, shapeIdB);
-			// }
+	if ( pairCount > 0 )
+	{
+		b2CreateContactsContext createContext = {
+			.world = world,
+			.newContacts = b2StackAlloc( alloc, pairCount * sizeof( b2NewContact ), "new contacts" ),
+		};
 
-			b2Shape* shapeA = b2Array_Get( world->shapes, shapeIdA );
-			b2Shape* shapeB = b2Array_Get( world->shapes, shapeIdB );
+		b2ParallelFor( world, b2_timelineCreateContacts, b2GatherPairsTask, moveCount, minRange, &createContext );
 
-			b2CreateContact( world, shapeA, shapeB );
+		int keyAddedCount = 0;
+		for ( int i = 0; i < pairCount; ++i )
+		{
+			b2ReserveContact( world, createContext.newContacts + i );
+			keyAddedCount += createContext.newContacts[i].keyAdded ? 1 : 0;
+		}
 
-			if ( pair->heap )
-			{
-				// Note: I tried adding to the pair set in parallel with contact creation
-				// but that didn't work with with pair heap allocation. I could make it
-				// work with a task context bump allocator with heap fallback. The perf
-				// gain was small or zero.
-				b2MovePair* temp = pair;
-				pair = pair->next;
-				b2Free( temp, sizeof( b2MovePair ) );
-			}
-			else
-			{
-				pair = pair->next;
-			}
+		b2FinishConcurrentAdds( &bp->pairSet, keyAddedCount );
+
+		b2ParallelFor( world, b2_timelineCreateContacts, b2InitializeContactsTask, pairCount, minRange, &createContext );
+
+		for ( int i = 0; i < pairCount; ++i )
+		{
+			b2AttachContact( world, createContext.newContacts + i );
 		}
 
-		// if (s_file != NULL)
-		//{
-		//	fprintf(s_file, "\n");
-		// }
+		b2StackFree( alloc, createContext.newContacts );
 	}
 
-	// if (s_file != NULL)
-	//{
-	//	fprintf(s_file, "count = %d\n\n", pairCount);
-	// }
-
 	// Reset move buffer: clear only the bits that were set this step.
 	// Invariant: bit set in movedProxies[type] iff proxyKey is present in moveArray.
 	for ( int i = 0; i < bp->moveArray.count; ++i )
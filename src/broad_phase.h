@@ -13,9 +13,19 @@
 typedef struct b2Shape b2Shape;
 typedef struct b2MovePair b2MovePair;
 typedef struct b2MoveResult b2MoveResult;
+typedef struct b2ProxyGrid b2ProxyGrid;
 typedef struct b2Stack b2Stack;
 typedef struct b2World b2World;
 
+// A proxy enlargement waiting to be applied to its tree
+typedef struct b2ProxyEnlargement
+{
+	b2AABB aabb;
+	int proxyKey;
+} b2ProxyEnlargement;
+
+b2DeclareArray( b2ProxyEnlargement );
+
 // Store the proxy type in the lower 2 bits of the proxy key. This leaves 30 bits for the id.
 #define B2_PROXY_TYPE( KEY ) ( (b2BodyType)( ( KEY ) & 3 ) )
 #define B2_PROXY_ID( KEY ) ( ( KEY ) >> 2 )
@@ -41,8 +51,25 @@ typedef struct b2BroadPhase
 	int movePairCapacity;
 	b2AtomicInt movePairIndex;
 
-	// Tracks shape pairs that have a b2Contact
+	// Tracks shape pairs that have a b2Contact. New pairs are added by the pair query workers until
+	// pairSetRoom runs out. The remaining pairs are added when their contacts are created.
 	b2HashSet pairSet;
+	b2AtomicInt pairSetRoom;
+
+	// The number of new pairs found by the last pair update. Used to size the pair set room.
+	int newPairCount;
+
+	// Algorithm used to find the pairs of the moved proxies with dynamic proxies
+	b2BroadPhaseType type;
+	float gridCellSize;
+
+	// Hash grid of the dynamic proxies used by the grid broad-phase. This only exists during
+	// b2UpdateBroadPhasePairs.
+	b2ProxyGrid* grid;
+
+	// Enlargements deferred by the pipelined step. These are applied by a task so the tree refit overlaps
+	// other step work. Empty between time steps.
+	b2Array( b2ProxyEnlargement ) enlargeArray;
 
 } b2BroadPhase;
 
@@ -54,7 +81,17 @@ int b2BroadPhase_CreateProxy( b2BroadPhase* bp, b2BodyType proxyType, b2AABB aab
 void b2BroadPhase_DestroyProxy( b2BroadPhase* bp, int proxyKey );
 
 void b2BroadPhase_MoveProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb );
-void b2BroadPhase_EnlargeProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb );
+
+// Queues a larger box for a proxy. The tree update waits for b2BroadPhase_ApplyEnlargements or
+// b2RefitBroadPhase. The move buffer is updated immediately to keep pair finding deterministic.
+void b2BroadPhase_DeferEnlargeProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb );
+
+// Applies the queued enlargements to the trees. Enlarging is order independent so the trees do not
+// depend on the queue order.
+void b2BroadPhase_ApplyEnlargements( b2BroadPhase* bp );
+
+// Same as b2BroadPhase_ApplyEnlargements but the tree refit is spread across the workers
+void b2RefitBroadPhase( b2World* world );
 
 int b2BroadPhase_GetShapeIndex( b2BroadPhase* bp, int proxyKey );
 
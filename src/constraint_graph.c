@@ -10,6 +10,8 @@
 #include "physics_world.h"
 #include "solver_set.h"
 
+#include <limits.h>
+#include <stdlib.h>
 #include <string.h>
 
 // Solver using graph coloring. Islands are only used for sleep.
@@ -55,6 +57,11 @@ void b2DestroyGraph( b2ConstraintGraph* graph )
 		// The bit set should never be used on the overflow color
 		B2_ASSERT( i != B2_OVERFLOW_INDEX || color->bodySet.bits == NULL );
 
+		if ( i != B2_OVERFLOW_INDEX && color->wideConstraintCapacity > 0 )
+		{
+			b2Free( color->wideConstraints, color->wideConstraintCapacity * graph->wideConstraintByteCount );
+		}
+
 		b2DestroyBitSet( &color->bodySet );
 		b2Array_Destroy( color->contactSims );
 		b2Array_Destroy( color->jointSims );
@@ -139,6 +146,7 @@ void b2AddContactToGraph( b2World* world, b2ContactSim* contactSim, b2Contact* c
 
 	b2ContactSim* newContact = b2Array_Emplace( color->contactSims );
 	memcpy( newContact, contactSim, sizeof( b2ContactSim ) );
+	newContact->simFlags |= b2_simPrepareDirty;
 
 	// todo perhaps skip this if the contact is already awake
 
@@ -198,8 +206,9 @@ void b2RemoveContactFromGraph( b2World* world, int bodyIdA, int bodyIdB, int col
 	int movedIndex = b2Array_RemoveSwap( color->contactSims, localIndex );
 	if ( movedIndex != B2_NULL_INDEX )
 	{
-		// Fix index on swapped contact
+		// Fix index on swapped contact. It now owns a different wide constraint lane.
 		b2ContactSim* movedContactSim = color->contactSims.data + localIndex;
+		movedContactSim->simFlags |= b2_simPrepareDirty;
 
 		// Fix moved contact
 		int movedId = movedContactSim->contactId;
@@ -211,6 +220,267 @@ void b2RemoveContactFromGraph( b2World* world, int bodyIdA, int bodyIdB, int col
 	}
 }
 
+// Rebalancing moves at most this many contacts per step so the cost is spread over several steps
+#define B2_REBALANCE_MOVE_LIMIT 64
+
+// Find the least occupied color that can take a contact between these bodies. Only colors with fewer than
+// maxCount contacts are considered. Returns B2_NULL_INDEX if no color qualifies.
+static int b2FindRebalanceColor( b2ConstraintGraph* graph, int bodyIdA, int bodyIdB, bool dynamicA, bool dynamicB,
+								 int sourceIndex, int minCount, int maxCount )
+{
+	// Keep the dynamic and static color ranges used by b2AddContactToGraph
+	int first = dynamicA && dynamicB ? 0 : 1;
+	int last = dynamicA && dynamicB ? B2_DYNAMIC_COLOR_COUNT : B2_OVERFLOW_INDEX;
+
+	int bestIndex = B2_NULL_INDEX;
+	int bestCount = maxCount;
+	for ( int i = first; i < last; ++i )
+	{
+		if ( i == sourceIndex )
+		{
+			continue;
+		}
+
+		b2GraphColor* color = graph->colors + i;
+		int count = color->contactSims.count;
+		if ( count < minCount || bestCount <= count )
+		{
+			continue;
+		}
+
+		if ( ( dynamicA && b2GetBit( &color->bodySet, bodyIdA ) ) || ( dynamicB && b2GetBit( &color->bodySet, bodyIdB ) ) )
+		{
+			continue;
+		}
+
+		bestIndex = i;
+		bestCount = count;
+	}
+
+	return bestIndex;
+}
+
+// Move contacts out of a color, last to first so the swap removal only disturbs contacts already visited.
+// When leveling, a target must stay at least two contacts smaller than the source so every move reduces
+// the spread and contacts cannot bounce between two colors. Returns the number of contacts moved.
+static int b2MigrateColor( b2World* world, int sourceIndex, int minCount, int maxCount, bool leveling, int moveLimit )
+{
+	b2ConstraintGraph* graph = &world->constraintGraph;
+	b2GraphColor* source = graph->colors + sourceIndex;
+
+	int moveCount = 0;
+	for ( int i = source->contactSims.count - 1; i >= 0 && moveCount < moveLimit; --i )
+	{
+		b2ContactSim* contactSim = source->contactSims.data + i;
+		b2Contact* contact = b2Array_Get( world->contacts, contactSim->contactId );
+		B2_ASSERT( contact->colorIndex == sourceIndex && contact->localIndex == i );
+
+		int bodyIdA = contact->edges[0].bodyId;
+		int bodyIdB = contact->edges[1].bodyId;
+		bool dynamicA = b2Array_Get( world->bodies, bodyIdA )->type == b2_dynamicBody;
+		bool dynamicB = b2Array_Get( world->bodies, bodyIdB )->type == b2_dynamicBody;
+
+		int limitCount = leveling ? source->contactSims.count - 1 : maxCount;
+		int targetIndex =
+			b2FindRebalanceColor( graph, bodyIdA, bodyIdB, dynamicA, dynamicB, sourceIndex, minCount, limitCount );
+		if ( targetIndex == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		// The body sim indices and masses stay valid, so the contact sim is copied as is
+		b2GraphColor* target = graph->colors + targetIndex;
+		b2ContactSim* newContact = b2Array_Emplace( target->contactSims );
+		memcpy( newContact, contactSim, sizeof( b2ContactSim ) );
+		newContact->simFlags |= b2_simPrepareDirty;
+
+		if ( dynamicA )
+		{
+			b2SetBitGrow( &target->bodySet, bodyIdA );
+		}
+
+		if ( dynamicB )
+		{
+			b2SetBitGrow( &target->bodySet, bodyIdB );
+		}
+
+		b2RemoveContactFromGraph( world, bodyIdA, bodyIdB, sourceIndex, i );
+
+		contact->colorIndex = targetIndex;
+		contact->localIndex = target->contactSims.count - 1;
+		moveCount += 1;
+	}
+
+	return moveCount;
+}
+
+// Colors keep their contacts until the contacts stop touching, so over time the greedy coloring leaves
+// a few large colors and a tail of tiny ones. Each color is a solver stage with a barrier, and a tiny
+// color mostly fills SIMD lanes with dummy constraints. This migrates a bounded number of contacts each
+// step:
+// - overflow contacts move into any color that has room, since overflow is solved serially
+// - the smallest color is drained into colors of at least average size so the stage can disappear
+// - the largest color sheds contacts into smaller colors that are not being drained
+int b2RebalanceGraph( b2World* world )
+{
+#if B2_FORCE_OVERFLOW == 0
+	b2ConstraintGraph* graph = &world->constraintGraph;
+
+	int moveCount = b2MigrateColor( world, B2_OVERFLOW_INDEX, 0, INT_MAX, false, B2_REBALANCE_MOVE_LIMIT );
+
+	int totalCount = 0;
+	int activeCount = 0;
+	int smallestIndex = B2_NULL_INDEX;
+	int largestIndex = B2_NULL_INDEX;
+	for ( int i = 0; i < B2_OVERFLOW_INDEX; ++i )
+	{
+		int count = graph->colors[i].contactSims.count;
+		if ( count == 0 )
+		{
+			continue;
+		}
+
+		totalCount += count;
+		activeCount += 1;
+
+		if ( smallestIndex == B2_NULL_INDEX || count < graph->colors[smallestIndex].contactSims.count )
+		{
+			smallestIndex = i;
+		}
+
+		if ( largestIndex == B2_NULL_INDEX || count > graph->colors[largestIndex].contactSims.count )
+		{
+			largestIndex = i;
+		}
+	}
+
+	if ( activeCount < 2 )
+	{
+		return moveCount;
+	}
+
+	int averageCount = totalCount / activeCount;
+
+	// A color under a quarter of the average is not worth its barrier
+	if ( 4 * graph->colors[smallestIndex].contactSims.count < averageCount )
+	{
+		int moveLimit = B2_REBALANCE_MOVE_LIMIT - moveCount;
+		moveCount += b2MigrateColor( world, smallestIndex, averageCount, INT_MAX, false, moveLimit );
+	}
+
+	// Level the largest color against smaller colors. Tiny colors are not targets because they are being drained.
+	int minCount = b2MaxInt( 1, ( averageCount + 3 ) / 4 );
+	int moveLimit = B2_REBALANCE_MOVE_LIMIT - moveCount;
+	moveCount += b2MigrateColor( world, largestIndex, minCount, INT_MAX, true, moveLimit );
+
+	return moveCount;
+#else
+	B2_UNUSED( world );
+	return 0;
+#endif
+}
+
+// A color is sorted when more than this fraction of neighboring contacts are out of order. A sorted color
+// slowly loses its order as contacts are added and removed, and each moved contact must be prepared again.
+#define B2_SORT_DISORDER_FRACTION 8
+
+typedef struct b2ContactSortItem
+{
+	uint32_t key;
+	int contactId;
+	int localIndex;
+} b2ContactSortItem;
+
+// The awake body sim index closest to the front of the body state array. A null index becomes the largest key.
+static uint32_t b2GetContactSortKey( const b2ContactSim* contactSim )
+{
+	uint32_t indexA = (uint32_t)contactSim->bodySimIndexA;
+	uint32_t indexB = (uint32_t)contactSim->bodySimIndexB;
+	return indexA < indexB ? indexA : indexB;
+}
+
+static int b2CompareContactSortItems( const void* a, const void* b )
+{
+	const b2ContactSortItem* sa = a;
+	const b2ContactSortItem* sb = b;
+
+	if ( sa->key != sb->key )
+	{
+		return sa->key < sb->key ? -1 : 1;
+	}
+
+	// Kinematic bodies may appear in several contacts of a color
+	return sa->contactId < sb->contactId ? -1 : 1;
+}
+
+// The contact solver gathers body states for each lane of a wide constraint. The greedy coloring
+// leaves the contacts of a color in arrival order, so neighboring lanes read scattered states. This
+// sorts one color per step by body sim index so neighboring lanes tend to share cache lines. Contacts
+// in a color don't share dynamic bodies, so the solver order within a color does not change results.
+int b2SortGraphColor( b2World* world )
+{
+	b2ConstraintGraph* graph = &world->constraintGraph;
+	int colorIndex = graph->sortColorIndex;
+	graph->sortColorIndex = ( colorIndex + 1 ) % B2_OVERFLOW_INDEX;
+
+	b2GraphColor* color = graph->colors + colorIndex;
+	int count = color->contactSims.count;
+	if ( count < 2 )
+	{
+		return 0;
+	}
+
+	int disorderCount = 0;
+	uint32_t previousKey = b2GetContactSortKey( color->contactSims.data + 0 );
+	for ( int i = 1; i < count; ++i )
+	{
+		uint32_t key = b2GetContactSortKey( color->contactSims.data + i );
+		disorderCount += key < previousKey ? 1 : 0;
+		previousKey = key;
+	}
+
+	if ( B2_SORT_DISORDER_FRACTION * disorderCount <= count )
+	{
+		return 0;
+	}
+
+	b2ContactSortItem* items = b2StackAlloc( &world->stack, count * sizeof( b2ContactSortItem ), "sort items" );
+	b2ContactSim* contactSims = b2StackAlloc( &world->stack, count * sizeof( b2ContactSim ), "sort contacts" );
+	memcpy( contactSims, color->contactSims.data, count * sizeof( b2ContactSim ) );
+
+	for ( int i = 0; i < count; ++i )
+	{
+		items[i] = (b2ContactSortItem){ b2GetContactSortKey( contactSims + i ), contactSims[i].contactId, i };
+	}
+
+	qsort( items, count, sizeof( b2ContactSortItem ), b2CompareContactSortItems );
+
+	int moveCount = 0;
+	for ( int i = 0; i < count; ++i )
+	{
+		int oldIndex = items[i].localIndex;
+		if ( oldIndex == i )
+		{
+			continue;
+		}
+
+		// The contact now owns a different wide constraint lane
+		b2ContactSim* contactSim = color->contactSims.data + i;
+		memcpy( contactSim, contactSims + oldIndex, sizeof( b2ContactSim ) );
+		contactSim->simFlags |= b2_simPrepareDirty;
+
+		b2Contact* contact = b2Array_Get( world->contacts, contactSim->contactId );
+		B2_ASSERT( contact->colorIndex == colorIndex && contact->localIndex == oldIndex );
+		contact->localIndex = i;
+		moveCount += 1;
+	}
+
+	b2StackFree( &world->stack, contactSims );
+	b2StackFree( &world->stack, items );
+
+	return moveCount;
+}
+
 // Notice that a joint cannot share the same color as a contact between the same two bodies. This means I can solve contacts and
 // joints in parallel with each other within each color.
 static int b2AssignJointColor( b2ConstraintGraph* graph, int bodyIdA, int bodyIdB, b2BodyType typeA, b2BodyType typeB )
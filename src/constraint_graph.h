@@ -39,7 +39,8 @@ typedef struct b2GraphColor
 	b2Array( b2ContactSim ) contactSims;
 	b2Array( b2JointSim ) jointSims;
 
-	// transient
+	// Wide constraints persist across steps for the regular colors. Lane i holds contact sim i.
+	// The overflow constraints are transient.
 	union
 	{
 		struct b2ContactConstraintWide* wideConstraints;
@@ -47,6 +48,13 @@ typedef struct b2GraphColor
 	};
 
 	int wideConstraintCount;
+	int wideConstraintCapacity;
+
+	// transient, see b2BuildWideJoints
+	struct b2JointConstraintWide* wideJoints;
+	struct b2JointSim** scalarJoints;
+	int wideJointCount;
+	int scalarJointCount;
 
 } b2GraphColor;
 
@@ -54,6 +62,20 @@ typedef struct b2ConstraintGraph
 {
 	// including overflow at the end
 	b2GraphColor colors[B2_GRAPH_COLOR_COUNT];
+
+	// Byte count of a wide contact constraint for the contact solver kernels of the world
+	int wideConstraintByteCount;
+
+	// Solver parameters baked into the persistent wide constraints. A change forces every lane to be
+	// prepared again. Zero until the first prepare.
+	float preparedH;
+	float preparedInvH;
+	float preparedContactHertz;
+	float preparedDampingRatio;
+	bool preparedSoftening;
+
+	// The next color checked by b2SortGraphColor
+	int sortColorIndex;
 } b2ConstraintGraph;
 
 void b2CreateGraph( b2ConstraintGraph* graph, const b2Capacity* capacity );
@@ -62,6 +84,12 @@ void b2DestroyGraph( b2ConstraintGraph* graph );
 void b2AddContactToGraph( b2World* world, b2ContactSim* contactSim, b2Contact* contact );
 void b2RemoveContactFromGraph( b2World* world, int bodyIdA, int bodyIdB, int colorIndex, int localIndex );
 
+// Incrementally move contacts between colors to even out the color sizes. Returns the number of contacts moved.
+int b2RebalanceGraph( b2World* world );
+
+// Sort the contacts of one color by body so the wide solver gathers from nearby memory. Returns the number of contacts moved.
+int b2SortGraphColor( b2World* world );
+
 b2JointSim* b2CreateJointInGraph( b2World* world, b2Joint* joint );
 void b2AddJointToGraph( b2World* world, b2JointSim* jointSim, b2Joint* joint );
 void b2RemoveJointFromGraph( b2World* world, int bodyIdA, int bodyIdB, int colorIndex, int localIndex );
@@ -5,7 +5,9 @@
 
 #include "body.h"
 #include "core.h"
+#include "height_field.h"
 #include "island.h"
+#include "mesh.h"
 #include "physics_world.h"
 #include "shape.h"
 #include "solver_set.h"
@@ -86,98 +88,323 @@ b2ContactData b2Contact_GetData( b2ContactId contactId )
 	return data;
 }
 
-typedef b2Manifold b2ManifoldFcn( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+typedef b2Manifold b2ManifoldFcn( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB, b2Transform xfB,
 								  b2SimplexCache* cache );
 
+// Shapes with many segments may have a child contact per normal group, each with its own manifold.
+// Also reports the number of groups found.
+typedef b2Manifold b2ChildManifoldFcn( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB, b2Transform xfB,
+									   int childIndex, int* groupCount );
+
 struct b2ContactRegister
 {
 	b2ManifoldFcn* fcn;
+	b2ChildManifoldFcn* childFcn;
 	bool primary;
 };
 
 static struct b2ContactRegister s_registers[b2_shapeTypeCount][b2_shapeTypeCount];
 static bool s_initialized = false;
 
-static b2Manifold b2CircleManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+static b2Manifold b2CircleManifold( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB, b2Transform xfB,
 									b2SimplexCache* cache )
 {
 	B2_UNUSED( cache );
 	return b2CollideCircles( &shapeA->circle, xfA, &shapeB->circle, xfB );
 }
 
-static b2Manifold b2CapsuleAndCircleManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+static b2Manifold b2CapsuleAndCircleManifold( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB, b2Transform xfB,
 											  b2SimplexCache* cache )
 {
 	B2_UNUSED( cache );
 	return b2CollideCapsuleAndCircle( &shapeA->capsule, xfA, &shapeB->circle, xfB );
 }
 
-static b2Manifold b2CapsuleManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+static b2Manifold b2CapsuleManifold( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB, b2Transform xfB,
 									 b2SimplexCache* cache )
 {
 	B2_UNUSED( cache );
 	return b2CollideCapsules( &shapeA->capsule, xfA, &shapeB->capsule, xfB );
 }
 
-static b2Manifold b2PolygonAndCircleManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+static b2Manifold b2PolygonAndCircleManifold( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB, b2Transform xfB,
 											  b2SimplexCache* cache )
 {
 	B2_UNUSED( cache );
-	return b2CollidePolygonAndCircle( &shapeA->polygon, xfA, &shapeB->circle, xfB );
+	return b2CollidePolygonAndCircle( b2GetShapePolygon( shapeA ), xfA, &shapeB->circle, xfB );
 }
 
-static b2Manifold b2PolygonAndCapsuleManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+static b2Manifold b2PolygonAndCapsuleManifold( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB, b2Transform xfB,
 											   b2SimplexCache* cache )
 {
 	B2_UNUSED( cache );
-	return b2CollidePolygonAndCapsule( &shapeA->polygon, xfA, &shapeB->capsule, xfB );
+	return b2CollidePolygonAndCapsule( b2GetShapePolygon( shapeA ), xfA, &shapeB->capsule, xfB );
 }
 
-static b2Manifold b2PolygonManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+static b2Manifold b2PolygonManifold( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB, b2Transform xfB,
 									 b2SimplexCache* cache )
 {
 	B2_UNUSED( cache );
-	return b2CollidePolygons( &shapeA->polygon, xfA, &shapeB->polygon, xfB );
+	return b2CollidePolygons( b2GetShapePolygon( shapeA ), xfA, b2GetShapePolygon( shapeB ), xfB );
 }
 
-static b2Manifold b2SegmentAndCircleManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+static b2Manifold b2SegmentAndCircleManifold( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB, b2Transform xfB,
 											  b2SimplexCache* cache )
 {
 	B2_UNUSED( cache );
 	return b2CollideSegmentAndCircle( &shapeA->segment, xfA, &shapeB->circle, xfB );
 }
 
-static b2Manifold b2SegmentAndCapsuleManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+static b2Manifold b2SegmentAndCapsuleManifold( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB, b2Transform xfB,
 											   b2SimplexCache* cache )
 {
 	B2_UNUSED( cache );
 	return b2CollideSegmentAndCapsule( &shapeA->segment, xfA, &shapeB->capsule, xfB );
 }
 
-static b2Manifold b2SegmentAndPolygonManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+static b2Manifold b2SegmentAndPolygonManifold( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB, b2Transform xfB,
 											   b2SimplexCache* cache )
 {
 	B2_UNUSED( cache );
-	return b2CollideSegmentAndPolygon( &shapeA->segment, xfA, &shapeB->polygon, xfB );
+	return b2CollideSegmentAndPolygon( &shapeA->segment, xfA, b2GetShapePolygon( shapeB ), xfB );
 }
 
-static b2Manifold b2ChainSegmentAndCircleManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+static b2Manifold b2ChainSegmentAndCircleManifold( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB, b2Transform xfB,
 												   b2SimplexCache* cache )
 {
 	B2_UNUSED( cache );
 	return b2CollideChainSegmentAndCircle( &shapeA->chainSegment, xfA, &shapeB->circle, xfB );
 }
 
-static b2Manifold b2ChainSegmentAndCapsuleManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB,
+static b2Manifold b2ChainSegmentAndCapsuleManifold( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB,
 													b2Transform xfB, b2SimplexCache* cache )
 {
 	return b2CollideChainSegmentAndCapsule( &shapeA->chainSegment, xfA, &shapeB->capsule, xfB, cache );
 }
 
-static b2Manifold b2ChainSegmentAndPolygonManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB,
+static b2Manifold b2ChainSegmentAndPolygonManifold( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB,
 													b2Transform xfB, b2SimplexCache* cache )
 {
-	return b2CollideChainSegmentAndPolygon( &shapeA->chainSegment, xfA, &shapeB->polygon, xfB, cache );
+	return b2CollideChainSegmentAndPolygon( &shapeA->chainSegment, xfA, b2GetShapePolygon( shapeB ), xfB, cache );
+}
+
+// A mesh or heightfield is collided segment by segment. A manifold only has a single normal and two points, so
+// the segment manifolds are grouped by normal. Like a chain, each group gets its own contact. This keeps the
+// contacts of both faces in a concave corner. The first child is created by the broad-phase and the second
+// child only exists while there is a second group, so a shape resting on flat ground runs a single query.
+#define B2_MESH_POINT_CAPACITY 16
+#define B2_MESH_NORMAL_TOLERANCE 0.995f
+
+// Chain segment feature ids use the low three bits of each byte. These are packed into six bits and the
+// low bits of the segment index go above them so warm starting can tell the segments apart. The points of
+// one manifold come from nearby segments, so a window of 1024 segments does not repeat within a manifold.
+#define B2_MESH_FEATURE_BITS 6
+#define B2_MESH_SEGMENT_MASK 0x3FF
+
+typedef struct b2MeshPoint
+{
+	b2ManifoldPoint point;
+	b2Vec2 normal;
+	float rollingImpulse;
+	int segmentIndex;
+	int groupIndex;
+} b2MeshPoint;
+
+typedef struct b2MeshManifoldContext
+{
+	const b2ShapeSim* shapeB;
+	b2Transform xfA;
+	b2Transform xfB;
+	b2MeshPoint points[B2_MESH_POINT_CAPACITY];
+	int pointCount;
+} b2MeshManifoldContext;
+
+static bool b2MeshManifoldCallback( const b2ChainSegment* segment, int segmentIndex, void* context )
+{
+	b2MeshManifoldContext* meshContext = context;
+	const b2ShapeSim* shapeB = meshContext->shapeB;
+
+	// The simplex cache is not persistent across mesh segments
+	b2SimplexCache cache = { 0 };
+	b2Manifold manifold;
+	switch ( shapeB->type )
+	{
+		case b2_capsuleShape:
+			manifold = b2CollideChainSegmentAndCapsule( segment, meshContext->xfA, &shapeB->capsule, meshContext->xfB, &cache );
+			break;
+
+		case b2_circleShape:
+			manifold = b2CollideChainSegmentAndCircle( segment, meshContext->xfA, &shapeB->circle, meshContext->xfB );
+			break;
+
+		case b2_polygonShape:
+			manifold = b2CollideChainSegmentAndPolygon( segment, meshContext->xfA, b2GetShapePolygon( shapeB ), meshContext->xfB,
+														&cache );
+			break;
+
+		default:
+			B2_ASSERT( false );
+			return false;
+	}
+
+	uint16_t key = (uint16_t)( ( segmentIndex & B2_MESH_SEGMENT_MASK ) << B2_MESH_FEATURE_BITS );
+
+	for ( int i = 0; i < manifold.pointCount; ++i )
+	{
+		b2MeshPoint meshPoint = { manifold.points[i], manifold.normal, manifold.rollingImpulse, segmentIndex, B2_NULL_INDEX };
+		uint16_t id = meshPoint.point.id;
+		meshPoint.point.id = (uint16_t)( key | ( ( id >> 5 ) & 0x38 ) | ( id & 0x7 ) );
+
+		if ( meshContext->pointCount < B2_MESH_POINT_CAPACITY )
+		{
+			meshContext->points[meshContext->pointCount] = meshPoint;
+			meshContext->pointCount += 1;
+			continue;
+		}
+
+		// Replace the shallowest point
+		int shallowIndex = 0;
+		for ( int j = 1; j < B2_MESH_POINT_CAPACITY; ++j )
+		{
+			if ( meshContext->points[j].point.separation > meshContext->points[shallowIndex].point.separation )
+			{
+				shallowIndex = j;
+			}
+		}
+
+		if ( meshPoint.point.separation < meshContext->points[shallowIndex].point.separation )
+		{
+			meshContext->points[shallowIndex] = meshPoint;
+		}
+	}
+
+	return true;
+}
+
+typedef struct b2MeshGroup
+{
+	int deepestIndex;
+	int firstSegment;
+} b2MeshGroup;
+
+static b2Manifold b2MeshManifold( const b2ShapeSim* shapeA, b2Transform xfA, const b2ShapeSim* shapeB, b2Transform xfB,
+								  int childIndex, int* groupCount )
+{
+	*groupCount = 0;
+
+	b2MeshManifoldContext context;
+	context.shapeB = shapeB;
+	context.xfA = xfA;
+	context.xfB = xfB;
+	context.pointCount = 0;
+
+	b2AABB box = b2InvTransformAABB( xfA, b2ComputeShapeAABB( shapeB, xfB ) );
+	b2Vec2 margin = { B2_SPECULATIVE_DISTANCE, B2_SPECULATIVE_DISTANCE };
+	box.lowerBound = b2Sub( box.lowerBound, margin );
+	box.upperBound = b2Add( box.upperBound, margin );
+
+	b2QueryShapeSegments( shapeA, box, b2MeshManifoldCallback, &context );
+
+	b2Manifold manifold = { 0 };
+	if ( context.pointCount == 0 )
+	{
+		return manifold;
+	}
+
+	// Sort deepest first so each group starts at its deepest point
+	b2MeshPoint* points = context.points;
+	int pointCount = context.pointCount;
+	for ( int i = 1; i < pointCount; ++i )
+	{
+		b2MeshPoint temp = points[i];
+		int j = i;
+		while ( j > 0 && temp.point.separation < points[j - 1].point.separation )
+		{
+			points[j] = points[j - 1];
+			j -= 1;
+		}
+		points[j] = temp;
+	}
+
+	// Group the points by normal. The groups are found in order of depth and only the deepest are kept.
+	b2MeshGroup groups[B2_MESH_CHILD_COUNT];
+	int count = 0;
+	for ( int i = 0; i < pointCount; ++i )
+	{
+		b2MeshPoint* point = points + i;
+		for ( int j = 0; j < count; ++j )
+		{
+			if ( b2Dot( point->normal, points[groups[j].deepestIndex].normal ) >= B2_MESH_NORMAL_TOLERANCE )
+			{
+				point->groupIndex = j;
+				groups[j].firstSegment = b2MinInt( groups[j].firstSegment, point->segmentIndex );
+				break;
+			}
+		}
+
+		if ( point->groupIndex == B2_NULL_INDEX && count < B2_MESH_CHILD_COUNT )
+		{
+			point->groupIndex = count;
+			groups[count] = (b2MeshGroup){ i, point->segmentIndex };
+			count += 1;
+		}
+	}
+
+	*groupCount = count;
+
+	// The children take the groups in segment order. Depth changes from step to step but the segments
+	// usually don't, so a group stays with the same child and keeps its warm starting.
+	if ( childIndex >= count )
+	{
+		return manifold;
+	}
+
+	int order[B2_MESH_CHILD_COUNT];
+	for ( int i = 0; i < count; ++i )
+	{
+		int j = i;
+		while ( j > 0 && groups[i].firstSegment < groups[order[j - 1]].firstSegment )
+		{
+			order[j] = order[j - 1];
+			j -= 1;
+		}
+		order[j] = i;
+	}
+
+	int groupIndex = order[childIndex];
+	const b2MeshPoint* deepest = points + groups[groupIndex].deepestIndex;
+	manifold.normal = deepest->normal;
+	manifold.rollingImpulse = deepest->rollingImpulse;
+	manifold.points[0] = deepest->point;
+	manifold.pointCount = 1;
+
+	// Choose the point of the group that is farthest from the deepest point along the surface
+	b2Vec2 tangent = b2LeftPerp( manifold.normal );
+	float baseOffset = b2Dot( tangent, deepest->point.anchorA );
+	float maxDistance = B2_LINEAR_SLOP;
+	int secondIndex = B2_NULL_INDEX;
+	for ( int i = 0; i < pointCount; ++i )
+	{
+		if ( points + i == deepest || points[i].groupIndex != groupIndex )
+		{
+			continue;
+		}
+
+		float distance = b2AbsFloat( b2Dot( tangent, points[i].point.anchorA ) - baseOffset );
+		if ( distance > maxDistance )
+		{
+			maxDistance = distance;
+			secondIndex = i;
+		}
+	}
+
+	if ( secondIndex != B2_NULL_INDEX )
+	{
+		manifold.points[1] = points[secondIndex].point;
+		manifold.pointCount = 2;
+	}
+
+	return manifold;
 }
 
 static void b2AddType( b2ManifoldFcn* fcn, b2ShapeType type1, b2ShapeType type2 )
@@ -185,16 +412,24 @@ static void b2AddType( b2ManifoldFcn* fcn, b2ShapeType type1, b2ShapeType type2
 	B2_ASSERT( 0 <= type1 && type1 < b2_shapeTypeCount );
 	B2_ASSERT( 0 <= type2 && type2 < b2_shapeTypeCount );
 
-	s_registers[type1][type2].fcn = fcn;
-	s_registers[type1][type2].primary = true;
+	s_registers[type1][type2] = (struct b2ContactRegister){ fcn, NULL, true };
 
 	if ( type1 != type2 )
 	{
-		s_registers[type2][type1].fcn = fcn;
-		s_registers[type2][type1].primary = false;
+		s_registers[type2][type1] = (struct b2ContactRegister){ fcn, NULL, false };
 	}
 }
 
+static void b2AddChildType( b2ChildManifoldFcn* fcn, b2ShapeType type1, b2ShapeType type2 )
+{
+	B2_ASSERT( 0 <= type1 && type1 < b2_shapeTypeCount );
+	B2_ASSERT( 0 <= type2 && type2 < b2_shapeTypeCount );
+	B2_ASSERT( type1 != type2 );
+
+	s_registers[type1][type2] = (struct b2ContactRegister){ NULL, fcn, true };
+	s_registers[type2][type1] = (struct b2ContactRegister){ NULL, fcn, false };
+}
+
 void b2InitializeContactRegisters( void )
 {
 	if ( s_initialized == false )
@@ -211,74 +446,103 @@ void b2InitializeContactRegisters( void )
 		b2AddType( b2ChainSegmentAndCircleManifold, b2_chainSegmentShape, b2_circleShape );
 		b2AddType( b2ChainSegmentAndCapsuleManifold, b2_chainSegmentShape, b2_capsuleShape );
 		b2AddType( b2ChainSegmentAndPolygonManifold, b2_chainSegmentShape, b2_polygonShape );
+		b2AddChildType( b2MeshManifold, b2_meshShape, b2_circleShape );
+		b2AddChildType( b2MeshManifold, b2_meshShape, b2_capsuleShape );
+		b2AddChildType( b2MeshManifold, b2_meshShape, b2_polygonShape );
+		b2AddChildType( b2MeshManifold, b2_heightFieldShape, b2_circleShape );
+		b2AddChildType( b2MeshManifold, b2_heightFieldShape, b2_capsuleShape );
+		b2AddChildType( b2MeshManifold, b2_heightFieldShape, b2_polygonShape );
 		s_initialized = true;
 	}
 }
 
 bool b2CanCollide( b2ShapeType typeA, b2ShapeType typeB )
 {
-	return s_registers[typeA][typeB].fcn != NULL;
+	return s_registers[typeA][typeB].fcn != NULL || s_registers[typeA][typeB].childFcn != NULL;
 }
 
-// WARNING: this should never fail to create a contact because the pair already exists in the pairSet.
-void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
+void b2PrepareNewContact( b2World* world, b2NewContact* newContact, int shapeIdA, int shapeIdB, int childIndex )
 {
+	const b2ShapeSim* shapeA = b2Array_Get( world->shapeSims, shapeIdA );
+	const b2ShapeSim* shapeB = b2Array_Get( world->shapeSims, shapeIdB );
+
 	b2ShapeType type1 = shapeA->type;
 	b2ShapeType type2 = shapeB->type;
 
 	B2_ASSERT( 0 <= type1 && type1 < b2_shapeTypeCount );
 	B2_ASSERT( 0 <= type2 && type2 < b2_shapeTypeCount );
 
-	if ( s_registers[type1][type2].fcn == NULL )
-	{
-		// For example, no segment vs segment collision
-		return;
-	}
+	// The broad-phase only reports pairs that can collide
+	B2_ASSERT( b2CanCollide( type1, type2 ) );
 
 	if ( s_registers[type1][type2].primary == false )
 	{
 		// flip order
-		b2CreateContact( world, shapeB, shapeA );
-		return;
+		int temp = shapeIdA;
+		shapeIdA = shapeIdB;
+		shapeIdB = temp;
 	}
 
-	b2Body* bodyA = b2Array_Get( world->bodies,shapeA->bodyId );
-	b2Body* bodyB = b2Array_Get( world->bodies,shapeB->bodyId );
+	const b2Body* bodyA = b2Array_Get( world->bodies, shapeA->bodyId );
+	const b2Body* bodyB = b2Array_Get( world->bodies, shapeB->bodyId );
 
 	B2_ASSERT( bodyA->setIndex != b2_disabledSet && bodyB->setIndex != b2_disabledSet );
 	B2_ASSERT( bodyA->setIndex != b2_staticSet || bodyB->setIndex != b2_staticSet );
 
-	int setIndex;
 	if ( bodyA->setIndex == b2_awakeSet || bodyB->setIndex == b2_awakeSet )
 	{
-		setIndex = b2_awakeSet;
+		newContact->setIndex = b2_awakeSet;
 	}
 	else
 	{
 		// sleeping and non-touching contacts live in the disabled set
 		// later if this set is found to be touching then the sleeping
 		// islands will be linked and the contact moved to the merged island
-		setIndex = b2_disabledSet;
+		newContact->setIndex = b2_disabledSet;
 	}
 
-	b2SolverSet* set = b2Array_Get( world->solverSets,setIndex );
+	newContact->shapeIdA = shapeIdA;
+	newContact->shapeIdB = shapeIdB;
+	newContact->childIndex = childIndex;
+	newContact->contactId = B2_NULL_INDEX;
+	newContact->localIndex = B2_NULL_INDEX;
+	newContact->keyAdded = false;
+}
 
-	// Create contact key and contact
+void b2ReserveContact( b2World* world, b2NewContact* newContact )
+{
 	int contactId = b2AllocId( &world->contactIdPool );
 	if ( contactId == world->contacts.count )
 	{
-		b2Array_Push( world->contacts,(b2Contact){ 0 } );
+		b2Array_Push( world->contacts, (b2Contact){ 0 } );
 	}
 
-	int shapeIdA = shapeA->id;
-	int shapeIdB = shapeB->id;
+	// Contacts are created as non-touching. Later if they are found to be touching
+	// they will link islands and be moved into the constraint graph.
+	b2SolverSet* set = b2Array_Get( world->solverSets, newContact->setIndex );
+	newContact->contactId = contactId;
+	newContact->localIndex = set->contactSims.count;
+	b2Array_Emplace( set->contactSims );
+}
 
-	b2Contact* contact = b2Array_Get( world->contacts,contactId );
+void b2InitializeContact( b2World* world, const b2NewContact* newContact )
+{
+	int contactId = newContact->contactId;
+	int shapeIdA = newContact->shapeIdA;
+	int shapeIdB = newContact->shapeIdB;
+	const b2Shape* shapeA = world->shapes.data + shapeIdA;
+	const b2Shape* shapeB = world->shapes.data + shapeIdB;
+	const b2ShapeSim* shapeSimA = world->shapeSims.data + shapeIdA;
+	const b2ShapeSim* shapeSimB = world->shapeSims.data + shapeIdB;
+	const b2Body* bodyA = world->bodies.data + shapeSimA->bodyId;
+	const b2Body* bodyB = world->bodies.data + shapeSimB->bodyId;
+
+	b2Contact* contact = world->contacts.data + contactId;
 	contact->contactId = contactId;
 	contact->generation += 1;
-	contact->setIndex = setIndex;
+	contact->setIndex = newContact->setIndex;
 	contact->colorIndex = B2_NULL_INDEX;
-	contact->localIndex = set->contactSims.count;
+	contact->localIndex = newContact->localIndex;
 	contact->islandId = B2_NULL_INDEX;
 	contact->islandIndex = B2_NULL_INDEX;
 	contact->shapeIdA = shapeIdA;
@@ -293,11 +557,64 @@ void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
 
 	B2_ASSERT( shapeA->sensorIndex == B2_NULL_INDEX && shapeB->sensorIndex == B2_NULL_INDEX );
 
-	if ( shapeA->enableContactEvents || shapeB->enableContactEvents )
+	// Contact events are reported once per pair, by the first child
+	if ( newContact->childIndex > 0 )
+	{
+		contact->flags |= b2_contactChildFlag;
+	}
+	else if ( shapeA->enableContactEvents || shapeB->enableContactEvents )
 	{
 		contact->flags |= b2_contactEnableContactEvents;
 	}
 
+	b2SolverSet* set = world->solverSets.data + newContact->setIndex;
+	b2ContactSim* contactSim = set->contactSims.data + newContact->localIndex;
+	contactSim->contactId = contactId;
+
+#if B2_ENABLE_VALIDATION
+	contactSim->bodyIdA = shapeSimA->bodyId;
+	contactSim->bodyIdB = shapeSimB->bodyId;
+#endif
+
+	contactSim->bodySimIndexA = B2_NULL_INDEX;
+	contactSim->bodySimIndexB = B2_NULL_INDEX;
+	contactSim->invMassA = 0.0f;
+	contactSim->invIA = 0.0f;
+	contactSim->invMassB = 0.0f;
+	contactSim->invIB = 0.0f;
+	contactSim->shapeIdA = shapeIdA;
+	contactSim->shapeIdB = shapeIdB;
+	contactSim->childIndex = newContact->childIndex;
+	contactSim->cache = b2_emptySimplexCache;
+	contactSim->manifold = (b2Manifold){ 0 };
+
+	// These get updated in the narrow phase, but these are needed for first touch
+	contactSim->friction = world->frictionCallback( shapeSimA->material.friction, shapeSimA->material.userMaterialId,
+													shapeSimB->material.friction, shapeSimB->material.userMaterialId );
+	contactSim->restitution = world->restitutionCallback( shapeSimA->material.restitution, shapeSimA->material.userMaterialId,
+														  shapeSimB->material.restitution, shapeSimB->material.userMaterialId );
+
+	contactSim->tangentSpeed = 0.0f;
+	contactSim->simFlags = contact->flags;
+
+	if ( shapeA->enablePreSolveEvents || shapeB->enablePreSolveEvents )
+	{
+		contactSim->simFlags |= b2_simEnablePreSolveEvents;
+	}
+}
+
+// WARNING: this should never fail to create a contact because the pair already exists in the pairSet.
+void b2AttachContact( b2World* world, const b2NewContact* newContact )
+{
+	int contactId = newContact->contactId;
+	int shapeIdA = newContact->shapeIdA;
+	int shapeIdB = newContact->shapeIdB;
+	b2Contact* contact = b2Array_Get( world->contacts, contactId );
+	const b2ShapeSim* shapeA = b2Array_Get( world->shapeSims, shapeIdA );
+	const b2ShapeSim* shapeB = b2Array_Get( world->shapeSims, shapeIdB );
+	b2Body* bodyA = b2Array_Get( world->bodies, shapeA->bodyId );
+	b2Body* bodyB = b2Array_Get( world->bodies, shapeB->bodyId );
+
 	// Connect to body A
 	{
 		contact->edges[0].bodyId = shapeA->bodyId;
@@ -308,7 +625,7 @@ void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
 		int headContactKey = bodyA->headContactKey;
 		if ( headContactKey != B2_NULL_INDEX )
 		{
-			b2Contact* headContact = b2Array_Get( world->contacts,headContactKey >> 1 );
+			b2Contact* headContact = b2Array_Get( world->contacts, headContactKey >> 1 );
 			headContact->edges[headContactKey & 1].prevKey = keyA;
 		}
 		bodyA->headContactKey = keyA;
@@ -325,65 +642,31 @@ void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
 		int headContactKey = bodyB->headContactKey;
 		if ( bodyB->headContactKey != B2_NULL_INDEX )
 		{
-			b2Contact* headContact = b2Array_Get( world->contacts,headContactKey >> 1 );
+			b2Contact* headContact = b2Array_Get( world->contacts, headContactKey >> 1 );
 			headContact->edges[headContactKey & 1].prevKey = keyB;
 		}
 		bodyB->headContactKey = keyB;
 		bodyB->contactCount += 1;
 	}
 
-	// Add to pair set for fast lookup.
-	uint64_t pairKey = B2_SHAPE_PAIR_KEY( shapeIdA, shapeIdB );
-	b2AddKey( &world->broadPhase.pairSet, pairKey );
-
-	// Contacts are created as non-touching. Later if they are found to be touching
-	// they will link islands and be moved into the constraint graph.
-	b2ContactSim* contactSim = b2Array_Emplace( set->contactSims );
-	contactSim->contactId = contactId;
-
-#if B2_ENABLE_VALIDATION
-	contactSim->bodyIdA = shapeA->bodyId;
-	contactSim->bodyIdB = shapeB->bodyId;
-#endif
-
-	contactSim->bodySimIndexA = B2_NULL_INDEX;
-	contactSim->bodySimIndexB = B2_NULL_INDEX;
-	contactSim->invMassA = 0.0f;
-	contactSim->invIA = 0.0f;
-	contactSim->invMassB = 0.0f;
-	contactSim->invIB = 0.0f;
-	contactSim->shapeIdA = shapeIdA;
-	contactSim->shapeIdB = shapeIdB;
-	contactSim->cache = b2_emptySimplexCache;
-	contactSim->manifold = (b2Manifold){ 0 };
-
-	// These get updated in the narrow phase, but these are needed for first touch
-	contactSim->friction = world->frictionCallback( shapeA->material.friction, shapeA->material.userMaterialId,
-													shapeB->material.friction, shapeB->material.userMaterialId );
-	contactSim->restitution = world->restitutionCallback( shapeA->material.restitution, shapeA->material.userMaterialId,
-														  shapeB->material.restitution, shapeB->material.userMaterialId );
-
-	contactSim->tangentSpeed = 0.0f;
-	contactSim->simFlags = contact->flags;
-
-	if ( shapeA->enablePreSolveEvents || shapeB->enablePreSolveEvents )
+	// Add to pair set for fast lookup. Child contacts share the key of the first child.
+	if ( newContact->keyAdded == false )
 	{
-		contactSim->simFlags |= b2_simEnablePreSolveEvents;
+		uint64_t pairKey = B2_SHAPE_PAIR_KEY( shapeIdA, shapeIdB );
+		bool alreadyAdded = b2AddKey( &world->broadPhase.pairSet, pairKey );
+		B2_ASSERT( alreadyAdded == false );
+		B2_UNUSED( alreadyAdded );
 	}
 }
 
-// A contact is destroyed when:
-// - broad-phase proxies stop overlapping
-// - a body is destroyed
-// - a body is disabled
-// - a body changes type from dynamic to kinematic or static
-// - a shape is destroyed
-// - contact filtering is modified
 void b2DestroyContact( b2World* world, b2Contact* contact, bool wakeBodies )
 {
-	// Remove pair from set
-	uint64_t pairKey = B2_SHAPE_PAIR_KEY( contact->shapeIdA, contact->shapeIdB );
-	b2RemoveKey( &world->broadPhase.pairSet, pairKey );
+	// Remove pair from set. A child contact does not own the key.
+	if ( ( contact->flags & b2_contactChildFlag ) == 0 )
+	{
+		uint64_t pairKey = B2_SHAPE_PAIR_KEY( contact->shapeIdA, contact->shapeIdB );
+		b2RemoveKey( &world->broadPhase.pairSet, pairKey );
+	}
 
 	b2ContactEdge* edgeA = contact->edges + 0;
 	b2ContactEdge* edgeB = contact->edges + 1;
@@ -524,46 +807,144 @@ b2ContactSim* b2GetContactSim( b2World* world, b2Contact* contact )
 	return b2Array_Get( set->contactSims,contact->localIndex );
 }
 
+// Walks the contact list of the body with fewer contacts. This only runs when the second normal group
+// of a mesh pair appears or disappears.
+static b2Contact* b2FindChildContact( b2World* world, const b2Contact* contact )
+{
+	b2Body* bodyA = b2Array_Get( world->bodies, contact->edges[0].bodyId );
+	b2Body* bodyB = b2Array_Get( world->bodies, contact->edges[1].bodyId );
+	int contactKey = bodyA->contactCount < bodyB->contactCount ? bodyA->headContactKey : bodyB->headContactKey;
+
+	while ( contactKey != B2_NULL_INDEX )
+	{
+		b2Contact* other = b2Array_Get( world->contacts, contactKey >> 1 );
+		if ( ( other->flags & b2_contactChildFlag ) != 0 && other->shapeIdA == contact->shapeIdA &&
+			 other->shapeIdB == contact->shapeIdB )
+		{
+			return other;
+		}
+
+		contactKey = other->edges[contactKey & 1].nextKey;
+	}
+
+	return NULL;
+}
+
+void b2UpdateChildContact( b2World* world, int contactId )
+{
+	b2Contact* contact = b2Array_Get( world->contacts, contactId );
+	b2ContactSim* contactSim = b2GetContactSim( world, contact );
+	uint32_t simFlags = contactSim->simFlags;
+	contactSim->simFlags &= ~( b2_simAddChild | b2_simRemoveChild );
+
+	if ( simFlags & b2_simAddChild )
+	{
+		B2_ASSERT( ( simFlags & b2_simHasChild ) == 0 );
+
+		// The pair key already exists
+		b2NewContact newContact;
+		b2PrepareNewContact( world, &newContact, contact->shapeIdA, contact->shapeIdB, 1 );
+		newContact.keyAdded = true;
+		b2ReserveContact( world, &newContact );
+		b2InitializeContact( world, &newContact );
+		b2AttachContact( world, &newContact );
+
+		// The contact arrays may have grown
+		contact = b2Array_Get( world->contacts, contactId );
+		contactSim = b2GetContactSim( world, contact );
+		contactSim->simFlags |= b2_simHasChild;
+	}
+	else if ( simFlags & b2_simRemoveChild )
+	{
+		B2_ASSERT( ( simFlags & b2_simHasChild ) != 0 );
+
+		b2Contact* child = b2FindChildContact( world, contact );
+		B2_ASSERT( child != NULL );
+		if ( child != NULL )
+		{
+			b2DestroyContact( world, child, false );
+		}
+
+		// The contact sim may have moved
+		contactSim = b2GetContactSim( world, contact );
+		contactSim->simFlags &= ~b2_simHasChild;
+	}
+}
+
 // Update the contact manifold and touching status.
 // Note: do not assume the shape AABBs are overlapping or are valid.
-bool b2UpdateContact( b2World* world, b2ContactSim* contactSim, b2Shape* shapeA, b2Transform transformA, b2Vec2 centerOffsetA,
-					  b2Shape* shapeB, b2Transform transformB, b2Vec2 centerOffsetB )
+bool b2UpdateContact( b2World* world, b2ContactSim* contactSim, b2ShapeSim* shapeA, b2Transform transformA, b2Vec2 centerOffsetA,
+					  b2ShapeSim* shapeB, b2Transform transformB, b2Vec2 centerOffsetB )
 {
 	// Save old manifold
 	b2Manifold oldManifold = contactSim->manifold;
 
 	// Compute new manifold
-	b2ManifoldFcn* fcn = s_registers[shapeA->type][shapeB->type].fcn;
-	contactSim->manifold = fcn( shapeA, transformA, shapeB, transformB, &contactSim->cache );
+	const struct b2ContactRegister* reg = &s_registers[shapeA->type][shapeB->type];
+	if ( reg->childFcn != NULL )
+	{
+		int groupCount;
+		contactSim->manifold = reg->childFcn( shapeA, transformA, shapeB, transformB, contactSim->childIndex, &groupCount );
+
+		// The first child asks for the second child when a second normal group shows up and gives it back
+		// when the group is gone. The contact state pass does the work, see b2UpdateChildContact.
+		if ( contactSim->childIndex == 0 )
+		{
+			bool hasChild = ( contactSim->simFlags & b2_simHasChild ) != 0;
+			if ( groupCount > 1 && hasChild == false )
+			{
+				contactSim->simFlags |= b2_simAddChild;
+			}
+			else if ( groupCount < 2 && hasChild == true )
+			{
+				contactSim->simFlags |= b2_simRemoveChild;
+			}
+		}
+	}
+	else
+	{
+		contactSim->manifold = reg->fcn( shapeA, transformA, shapeB, transformB, &contactSim->cache );
+	}
+
+	// A heightfield may have a material per cell. Use the cell under the deepest point. The anchor is
+	// still relative to the shape origin here.
+	const b2SurfaceMaterial* materialA = &shapeA->material;
+	if ( shapeA->type == b2_heightFieldShape && contactSim->manifold.pointCount > 0 )
+	{
+		b2Vec2 localPoint = b2InvRotateVector( transformA.q, contactSim->manifold.points[0].anchorA );
+		const b2SurfaceMaterial* cellMaterial = b2GetHeightFieldMaterial( shapeA->heightField, localPoint );
+		materialA = cellMaterial != NULL ? cellMaterial : materialA;
+	}
+
+	const b2SurfaceMaterial* materialB = &shapeB->material;
 
 	// Keep these updated in case the values on the shapes are modified
-	contactSim->friction = world->frictionCallback( shapeA->material.friction, shapeA->material.userMaterialId,
-													shapeB->material.friction, shapeB->material.userMaterialId );
-	contactSim->restitution = world->restitutionCallback( shapeA->material.restitution, shapeA->material.userMaterialId,
-														  shapeB->material.restitution, shapeB->material.userMaterialId );
+	contactSim->friction =
+		world->frictionCallback( materialA->friction, materialA->userMaterialId, materialB->friction, materialB->userMaterialId );
+	contactSim->restitution = world->restitutionCallback( materialA->restitution, materialA->userMaterialId,
+														  materialB->restitution, materialB->userMaterialId );
 
-	if ( shapeA->material.rollingResistance > 0.0f || shapeB->material.rollingResistance > 0.0f )
+	if ( materialA->rollingResistance > 0.0f || materialB->rollingResistance > 0.0f )
 	{
-		float radiusA = b2GetShapeRadius( shapeA );
-		float radiusB = b2GetShapeRadius( shapeB );
-		float maxRadius = b2MaxFloat( radiusA, radiusB );
-		contactSim->rollingResistance =
-			b2MaxFloat( shapeA->material.rollingResistance, shapeB->material.rollingResistance ) * maxRadius;
+		float maxRadius = b2MaxFloat( shapeA->radius, shapeB->radius );
+		contactSim->rollingResistance = b2MaxFloat( materialA->rollingResistance, materialB->rollingResistance ) * maxRadius;
 	}
 	else
 	{
 		contactSim->rollingResistance = 0.0f;
 	}
 
-	contactSim->tangentSpeed = shapeA->material.tangentSpeed + shapeB->material.tangentSpeed;
+	contactSim->tangentSpeed = materialA->tangentSpeed + materialB->tangentSpeed;
 
 	int pointCount = contactSim->manifold.pointCount;
 	bool touching = pointCount > 0;
 
 	if ( touching && world->preSolveFcn != NULL && ( contactSim->simFlags & b2_simEnablePreSolveEvents ) != 0 )
 	{
-		b2ShapeId shapeIdA = { shapeA->id + 1, world->worldId, shapeA->generation };
-		b2ShapeId shapeIdB = { shapeB->id + 1, world->worldId, shapeB->generation };
+		int idA = contactSim->shapeIdA;
+		int idB = contactSim->shapeIdB;
+		b2ShapeId shapeIdA = { idA + 1, world->worldId, world->shapes.data[idA].generation };
+		b2ShapeId shapeIdB = { idB + 1, world->worldId, world->shapes.data[idB].generation };
 
 		b2Manifold* manifold = &contactSim->manifold;
 		float bestSeparation = manifold->points[0].separation;
@@ -9,7 +9,7 @@
 #include "box2d/collision.h"
 #include "box2d/types.h"
 
-typedef struct b2Shape b2Shape;
+typedef struct b2ShapeSim b2ShapeSim;
 typedef struct b2World b2World;
 
 enum b2ContactFlags
@@ -25,6 +25,9 @@ enum b2ContactFlags
 
 	b2_contactRecycleFlag = 0x00000008,
 
+	// The second contact of a mesh pair. It does not own the pair key and has no contact events.
+	b2_contactChildFlag = 0x00000010,
+
 	// Set when the shapes are touching
 	b2_simTouchingFlag = 0x00010000,
 
@@ -45,6 +48,19 @@ enum b2ContactFlags
 
 	// This contact has a cached relative transform
 	b2_simRelativeTransformValid = 0x00400000,
+
+	// The wide constraint lane of this contact must be fully prepared. Set when the manifold is
+	// rebuilt or the contact moves to a different graph slot.
+	b2_simPrepareDirty = 0x00800000,
+
+	// This mesh contact has a second child contact
+	b2_simHasChild = 0x01000000,
+
+	// The narrow phase found a second normal group, create the second child contact
+	b2_simAddChild = 0x02000000,
+
+	// The second normal group is gone, destroy the second child contact
+	b2_simRemoveChild = 0x04000000,
 };
 
 // A contact edge is used to connect bodies and contacts together
@@ -119,6 +135,9 @@ typedef struct b2ContactSim
 	int shapeIdA;
 	int shapeIdB;
 
+	// A mesh pair may have a second child contact, see B2_MESH_CHILD_COUNT
+	int childIndex;
+
 	float invMassA;
 	float invIA;
 
@@ -142,13 +161,49 @@ typedef struct b2ContactSim
 void b2InitializeContactRegisters( void );
 bool b2CanCollide( b2ShapeType typeA, b2ShapeType typeB );
 
-void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB );
+// Meshes and heightfields get a contact per normal group so both faces of a concave corner are
+// solved. The broad-phase creates the first child. The second child is only created while the
+// narrow phase finds a second normal group, see b2UpdateChildContact. It shares the pair key.
+#define B2_MESH_CHILD_COUNT 2
+
+// A contact being created from a broad-phase pair. Creation is split into steps so that a batch of
+// contacts can be initialized in parallel. Ids and sims are reserved in pair order and the body contact
+// lists are linked in pair order, so the result matches creating the contacts one at a time.
+typedef struct b2NewContact
+{
+	int shapeIdA;
+	int shapeIdB;
+	int childIndex;
+	int setIndex;
+	int contactId;
+	int localIndex;
+
+	// The pair key was added to the pair set by the pair query
+	bool keyAdded;
+} b2NewContact;
+
+// Orders the shapes and picks the solver set. Thread safe.
+void b2PrepareNewContact( b2World* world, b2NewContact* newContact, int shapeIdA, int shapeIdB, int childIndex );
+
+// Allocates the contact id and the contact sim slot. Not thread safe.
+void b2ReserveContact( b2World* world, b2NewContact* newContact );
+
+// Fills in a reserved contact and contact sim. Thread safe for distinct contacts.
+void b2InitializeContact( b2World* world, const b2NewContact* newContact );
+
+// Links the contact into the body contact lists and adds the pair key unless the pair query already
+// added it. Not thread safe.
+void b2AttachContact( b2World* world, const b2NewContact* newContact );
+
 void b2DestroyContact( b2World* world, b2Contact* contact, bool wakeBodies );
 
+// Creates or destroys the second child of a mesh contact as requested by the narrow phase. Not thread safe.
+void b2UpdateChildContact( b2World* world, int contactId );
+
 b2ContactSim* b2GetContactSim( b2World* world, b2Contact* contact );
 
-bool b2UpdateContact( b2World* world, b2ContactSim* contactSim, b2Shape* shapeA, b2Transform transformA, b2Vec2 centerOffsetA,
-					  b2Shape* shapeB, b2Transform transformB, b2Vec2 centerOffsetB );
+bool b2UpdateContact( b2World* world, b2ContactSim* contactSim, b2ShapeSim* shapeA, b2Transform transformA, b2Vec2 centerOffsetA,
+					  b2ShapeSim* shapeB, b2Transform transformB, b2Vec2 centerOffsetB );
 
 b2DeclareArray( b2Contact );
 b2DeclareArray( b2ContactSim );
@@ -36,10 +36,13 @@ typedef struct b2ContactConstraint
 	float rollingImpulse;
 	b2Softness softness;
 	int pointCount;
-} b2ContactConstraint;
 
-// This function allows hiding SIMD intrinsics in the source file to improve compilation performance.
-int b2GetWideContactConstraintByteCount( void );
+	// Parallel overflow solver. The velocity change of each body from the last pass and the reciprocal
+	// of the number of overflow contacts that share the body.
+	b2Vec2 linearDeltaA, linearDeltaB;
+	float angularDeltaA, angularDeltaB;
+	float splitScaleA, splitScaleB;
+} b2ContactConstraint;
 
 // Overflow contacts don't fit into the constraint graph coloring
 void b2PrepareContacts_Overflow( b2StepContext* context );
@@ -48,9 +51,37 @@ void b2SolveContacts_Overflow( b2StepContext* context, bool useBias );
 void b2ApplyRestitution_Overflow( b2StepContext* context );
 void b2StoreImpulses_Overflow( b2StepContext* context );
 
-// Contacts that live within the constraint graph coloring
-void b2PrepareContactsTask( b2SolverBlock block, b2StepContext* context );
-void b2WarmStartContactsTask( b2SolverBlock block, b2StepContext* context );
-void b2SolveContactsTask( b2SolverBlock block, b2StepContext* context, bool useBias );
-void b2ApplyRestitutionTask( b2SolverBlock block, b2StepContext* context );
-void b2StoreImpulsesTask( b2SolverBlock block, b2StepContext* context, int workerIndex );
+// Parallel Jacobi passes over the overflow contacts. Each contact solves against a copy of the body states
+// with the body mass split across the overflow contacts that share the body. The velocity changes are
+// then averaged into the bodies by b2ApplyOverflowContactDeltas, which is serial and deterministic.
+void b2WarmStartOverflowContactsTask( b2SolverBlock block, b2StepContext* context );
+void b2SolveOverflowContactsTask( b2SolverBlock block, b2StepContext* context, bool useBias );
+void b2ApplyOverflowRestitutionTask( b2SolverBlock block, b2StepContext* context );
+void b2ApplyOverflowContactDeltas( b2StepContext* context );
+
+// Kernels for the contacts that live within the constraint graph coloring. The kernels are compiled
+// for each supported SIMD width and the world picks one set when it is created. The wide constraint
+// layout depends on the width, so the graph color packing must use the width of the kernels.
+typedef struct b2ContactSolverKernels
+{
+	int simdWidth;
+	int simdShift;
+	int constraintByteCount;
+	void ( *prepare )( b2SolverBlock block, b2StepContext* context );
+	void ( *warmStart )( b2SolverBlock block, b2StepContext* context );
+	void ( *solve )( b2SolverBlock block, b2StepContext* context, bool useBias );
+	void ( *applyRestitution )( b2SolverBlock block, b2StepContext* context );
+	void ( *storeImpulses )( b2SolverBlock block, b2StepContext* context, int workerIndex );
+} b2ContactSolverKernels;
+
+// Kernels compiled for the instruction set of the library
+extern const b2ContactSolverKernels b2_contactSolverKernels;
+
+#if defined( BOX2D_SIMD_DISPATCH )
+// 8-wide kernels that require AVX2 at runtime
+extern const b2ContactSolverKernels b2_contactSolverKernelsAVX2;
+#endif
+
+// Select the kernels for a SIMD width. Zero selects the widest kernels supported by the CPU.
+// Widths that are not available fall back to the default.
+const b2ContactSolverKernels* b2SelectContactSolverKernels( int simdWidth );
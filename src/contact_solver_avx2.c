@@ -0,0 +1,8 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+// 8-wide contact solver kernels compiled with AVX2 code generation. The rest of the library may
+// target SSE2, so these are only used when the CPU reports AVX2 support.
+#define BOX2D_AVX2
+#define B2_CONTACT_SOLVER_KERNELS b2_contactSolverKernelsAVX2
+#include "contact_solver_wide.inl"
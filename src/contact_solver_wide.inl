@@ -0,0 +1,916 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+// Wide contact solver kernels. This is compiled once per instruction set so the SIMD width can be
+// chosen when the world is created. Include with B2_CONTACT_SOLVER_KERNELS defined as the name of
+// the kernel table.
+
+#include "body.h"
+#include "constraint_graph.h"
+#include "contact.h"
+#include "contact_solver.h"
+#include "core.h"
+#include "physics_world.h"
+#include "simd.h"
+#include "solver_set.h"
+
+// Soft contact constraints with sub-stepping support
+// Uses fixed anchors for Jacobians for better behavior on rolling shapes (circles & capsules)
+// http://mmacklin.com/smallsteps.pdf
+// https://box2d.org/files/ErinCatto_SoftConstraints_GDC2011.pdf
+
+typedef struct b2ContactConstraintWide
+{
+	int indexA[B2_SIMD_WIDTH];
+	int indexB[B2_SIMD_WIDTH];
+
+	b2FloatW invMassA, invMassB;
+	b2FloatW invIA, invIB;
+	b2Vec2W normal;
+	b2FloatW friction;
+	b2FloatW tangentSpeed;
+	b2FloatW rollingResistance;
+	b2FloatW rollingMass;
+	b2FloatW rollingImpulse;
+	b2FloatW biasRate;
+	b2FloatW massScale;
+	b2FloatW impulseScale;
+	b2Vec2W anchorA1, anchorB1;
+	b2FloatW normalMass1, tangentMass1;
+	b2FloatW baseSeparation1;
+	b2FloatW normalImpulse1;
+	b2FloatW totalNormalImpulse1;
+	b2FloatW tangentImpulse1;
+	b2Vec2W anchorA2, anchorB2;
+	b2FloatW baseSeparation2;
+	b2FloatW normalImpulse2;
+	b2FloatW totalNormalImpulse2;
+	b2FloatW tangentImpulse2;
+	b2FloatW normalMass2, tangentMass2;
+	b2FloatW restitution;
+	b2FloatW relativeVelocity1, relativeVelocity2;
+} b2ContactConstraintWide;
+
+// Solver setup clears lanes by treating the constraint as rows of lanes, see b2ClearWideLanes
+_Static_assert( sizeof( b2ContactConstraintWide ) % ( B2_SIMD_WIDTH * sizeof( float ) ) == 0, "wide constraint lane rows" );
+
+// The warm start and solve loops prefetch the body states of the wide constraint this many steps
+// ahead. The gather is latency bound on large scenes because the body indices are scattered.
+#define B2_CONTACT_PREFETCH_DISTANCE 2
+
+static inline void b2PrefetchConstraintBodies( const b2BodyState* states, const b2ContactConstraintWide* constraint )
+{
+	b2PrefetchBodies( states, constraint->indexA );
+	b2PrefetchBodies( states, constraint->indexB );
+}
+
+// Refresh the lane of a recycled contact. This must match the full prepare in b2PrepareContactsTask.
+static void b2PrepareRecycledLane( b2ContactConstraintWide* constraint, int lane, const b2Manifold* manifold,
+								   float warmStartScale, b2Vec2 vA, float wA, b2Vec2 vB, float wB )
+{
+	b2Vec2 normal = manifold->normal;
+	( (float*)&constraint->rollingImpulse )[lane] = warmStartScale * manifold->rollingImpulse;
+
+	{
+		const b2ManifoldPoint* mp = manifold->points + 0;
+		b2Vec2 rA = mp->anchorA;
+		b2Vec2 rB = mp->anchorB;
+
+		( (float*)&constraint->baseSeparation1 )[lane] = mp->separation - b2Dot( b2Sub( rB, rA ), normal );
+		( (float*)&constraint->normalImpulse1 )[lane] = warmStartScale * mp->normalImpulse;
+		( (float*)&constraint->tangentImpulse1 )[lane] = warmStartScale * mp->tangentImpulse;
+		( (float*)&constraint->totalNormalImpulse1 )[lane] = 0.0f;
+
+		b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
+		b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
+		( (float*)&constraint->relativeVelocity1 )[lane] = b2Dot( normal, b2Sub( vrB, vrA ) );
+	}
+
+	if ( manifold->pointCount == 2 )
+	{
+		const b2ManifoldPoint* mp = manifold->points + 1;
+		b2Vec2 rA = mp->anchorA;
+		b2Vec2 rB = mp->anchorB;
+
+		( (float*)&constraint->baseSeparation2 )[lane] = mp->separation - b2Dot( b2Sub( rB, rA ), normal );
+		( (float*)&constraint->normalImpulse2 )[lane] = warmStartScale * mp->normalImpulse;
+		( (float*)&constraint->tangentImpulse2 )[lane] = warmStartScale * mp->tangentImpulse;
+		( (float*)&constraint->totalNormalImpulse2 )[lane] = 0.0f;
+
+		b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
+		b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
+		( (float*)&constraint->relativeVelocity2 )[lane] = b2Dot( normal, b2Sub( vrB, vrA ) );
+	}
+}
+
+// Note: Dirk suggested preparing contacts in the narrow phase. I tried this but it made Box2D slower.
+// The contact preparation is extremely fast in Box2D due to the data layout (b2ContactSim).
+//
+// Runs as a flat parallel-for over the whole wide constraint range. Per-color contact sims
+// are looked up through the prepareSpans cursor rather than the block's colorIndex, so
+// blocks can be uniformly sized without honoring color boundaries. Dead lanes in each
+// color's tail wide slot were all zeroed in solver setup.
+//
+// The wide constraints persist across steps. A recycled contact keeps its anchors, normal, and
+// material, so its lane only needs the separation, warm starting impulses, and relative velocity.
+// Lanes are fully prepared when the contact is new to the lane, the manifold was rebuilt, or the
+// body masses changed.
+static void b2PrepareContactsTask( b2SolverBlock block, b2StepContext* context )
+{
+	b2TracyCZoneNC( prepare_contact, "Prepare Contact", b2_colorYellow, true );
+	b2World* world = context->world;
+	b2BodyState* states = context->states;
+#if B2_ENABLE_VALIDATION
+	b2Body* bodies = world->bodies.data;
+#endif
+	b2ContactPrepareSpan* spans = context->contactPrepareSpans;
+	bool fullPrepare = context->fullContactPrepare;
+
+	// Stiffer for static contacts to avoid bodies getting pushed through the ground
+	b2Softness contactSoftness = context->contactSoftness;
+	b2Softness staticSoftness = context->staticSoftness;
+	bool enableSoftening = world->enableContactSoftening;
+
+	float warmStartScale = world->enableWarmStarting ? 1.0f : 0.0f;
+
+	int wideIndex = block.startIndex;
+	int endWideIndex = block.startIndex + block.count;
+
+	// Find color for start index. Linear search but fast.
+	int colorIndex = 0;
+	while ( spans[colorIndex + 1].start <= wideIndex )
+	{
+		colorIndex += 1;
+	}
+
+	// Loop over block
+	while ( wideIndex < endWideIndex )
+	{
+		int colorWideStart = spans[colorIndex].start;
+		int colorWideEndIndex = b2MinInt( spans[colorIndex + 1].start, endWideIndex );
+		int colorContactCount = spans[colorIndex].count;
+		b2ContactSim* contactSims = spans[colorIndex].contacts;
+		b2ContactConstraintWide* constraints = spans[colorIndex].constraints;
+
+#if B2_ENABLE_VALIDATION
+		int expectedWide = colorContactCount > 0 ? ( ( colorContactCount - 1 ) >> B2_SIMD_SHIFT ) + 1 : 0;
+		B2_ASSERT( spans[colorIndex + 1].start - spans[colorIndex].start == expectedWide );
+#endif
+
+		// Loop over color
+		for ( ; wideIndex < colorWideEndIndex; ++wideIndex )
+		{
+			int localWideIndex = wideIndex - colorWideStart;
+			b2ContactConstraintWide* constraint = constraints + localWideIndex;
+
+			for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+			{
+				int contactIndex = B2_SIMD_WIDTH * localWideIndex + lane;
+				if ( contactIndex >= colorContactCount )
+				{
+					// Remainder lanes were zeroed in solver setup.
+					break;
+				}
+
+				b2ContactSim* contactSim = contactSims + contactIndex;
+				const b2Manifold* manifold = &contactSim->manifold;
+
+				int indexA = contactSim->bodySimIndexA;
+				int indexB = contactSim->bodySimIndexB;
+
+#if B2_ENABLE_VALIDATION
+				b2Body* bodyA = bodies + contactSim->bodyIdA;
+				int validIndexA = bodyA->setIndex == b2_awakeSet ? bodyA->localIndex : B2_NULL_INDEX;
+				b2Body* bodyB = bodies + contactSim->bodyIdB;
+				int validIndexB = bodyB->setIndex == b2_awakeSet ? bodyB->localIndex : B2_NULL_INDEX;
+				B2_ASSERT( indexA == validIndexA );
+				B2_ASSERT( indexB == validIndexB );
+#endif
+
+				float mA = contactSim->invMassA;
+				float iA = contactSim->invIA;
+				float mB = contactSim->invMassB;
+				float iB = contactSim->invIB;
+
+				// Static bodies use the stiffer softness, so the lane must also keep its static bodies
+				bool prepared = fullPrepare == false && ( contactSim->simFlags & b2_simPrepareDirty ) == 0 &&
+								( constraint->indexA[lane] == 0 ) == ( indexA == B2_NULL_INDEX ) &&
+								( constraint->indexB[lane] == 0 ) == ( indexB == B2_NULL_INDEX ) &&
+								( (float*)&constraint->invMassA )[lane] == mA && ( (float*)&constraint->invIA )[lane] == iA &&
+								( (float*)&constraint->invMassB )[lane] == mB && ( (float*)&constraint->invIB )[lane] == iB;
+
+				// 0 for null
+				constraint->indexA[lane] = indexA + 1;
+				constraint->indexB[lane] = indexB + 1;
+
+				b2Vec2 vA = b2Vec2_zero;
+				float wA = 0.0f;
+				if ( indexA != B2_NULL_INDEX )
+				{
+					b2BodyState* stateA = states + indexA;
+					vA = stateA->linearVelocity;
+					wA = stateA->angularVelocity;
+				}
+
+				b2Vec2 vB = b2Vec2_zero;
+				float wB = 0.0f;
+				if ( indexB != B2_NULL_INDEX )
+				{
+					b2BodyState* stateB = states + indexB;
+					vB = stateB->linearVelocity;
+					wB = stateB->angularVelocity;
+				}
+
+				if ( prepared )
+				{
+					b2PrepareRecycledLane( constraint, lane, manifold, warmStartScale, vA, wA, vB, wB );
+					continue;
+				}
+
+				contactSim->simFlags &= ~b2_simPrepareDirty;
+
+				( (float*)&constraint->invMassA )[lane] = mA;
+				( (float*)&constraint->invMassB )[lane] = mB;
+				( (float*)&constraint->invIA )[lane] = iA;
+				( (float*)&constraint->invIB )[lane] = iB;
+
+				{
+					float k = iA + iB;
+					( (float*)&constraint->rollingMass )[lane] = k > 0.0f ? 1.0f / k : 0.0f;
+				}
+
+				b2Softness soft = contactSoftness;
+				if ( indexA == B2_NULL_INDEX || indexB == B2_NULL_INDEX )
+				{
+					soft = staticSoftness;
+				}
+				else if ( enableSoftening )
+				{
+					// todo experimental feature
+					float contactHertz = b2MinFloat( world->contactHertz, 0.125f * context->inv_h );
+					float ratio = 1.0f;
+					if ( mA < mB )
+					{
+						ratio = b2MaxFloat( 0.5f, mA / mB );
+					}
+					else if ( mB < mA )
+					{
+						ratio = b2MaxFloat( 0.5f, mB / mA );
+					}
+					soft = b2MakeSoft( ratio * contactHertz, ratio * world->contactDampingRatio, context->h );
+				}
+
+				b2Vec2 normal = manifold->normal;
+				( (float*)&constraint->normal.X )[lane] = normal.x;
+				( (float*)&constraint->normal.Y )[lane] = normal.y;
+
+				( (float*)&constraint->friction )[lane] = contactSim->friction;
+				( (float*)&constraint->tangentSpeed )[lane] = contactSim->tangentSpeed;
+				( (float*)&constraint->restitution )[lane] = contactSim->restitution;
+				( (float*)&constraint->rollingResistance )[lane] = contactSim->rollingResistance;
+				( (float*)&constraint->rollingImpulse )[lane] = warmStartScale * manifold->rollingImpulse;
+
+				( (float*)&constraint->biasRate )[lane] = soft.biasRate;
+				( (float*)&constraint->massScale )[lane] = soft.massScale;
+				( (float*)&constraint->impulseScale )[lane] = soft.impulseScale;
+
+				b2Vec2 tangent = b2RightPerp( normal );
+
+				{
+					const b2ManifoldPoint* mp = manifold->points + 0;
+
+					b2Vec2 rA = mp->anchorA;
+					b2Vec2 rB = mp->anchorB;
+
+					( (float*)&constraint->anchorA1.X )[lane] = rA.x;
+					( (float*)&constraint->anchorA1.Y )[lane] = rA.y;
+					( (float*)&constraint->anchorB1.X )[lane] = rB.x;
+					( (float*)&constraint->anchorB1.Y )[lane] = rB.y;
+
+					( (float*)&constraint->baseSeparation1 )[lane] = mp->separation - b2Dot( b2Sub( rB, rA ), normal );
+
+					( (float*)&constraint->normalImpulse1 )[lane] = warmStartScale * mp->normalImpulse;
+					( (float*)&constraint->tangentImpulse1 )[lane] = warmStartScale * mp->tangentImpulse;
+					( (float*)&constraint->totalNormalImpulse1 )[lane] = 0.0f;
+
+					float rnA = b2Cross( rA, normal );
+					float rnB = b2Cross( rB, normal );
+					float kNormal = mA + mB + iA * rnA * rnA + iB * rnB * rnB;
+					( (float*)&constraint->normalMass1 )[lane] = kNormal > 0.0f ? 1.0f / kNormal : 0.0f;
+
+					float rtA = b2Cross( rA, tangent );
+					float rtB = b2Cross( rB, tangent );
+					float kTangent = mA + mB + iA * rtA * rtA + iB * rtB * rtB;
+					( (float*)&constraint->tangentMass1 )[lane] = kTangent > 0.0f ? 1.0f / kTangent : 0.0f;
+
+					// relative velocity for restitution
+					b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
+					b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
+					( (float*)&constraint->relativeVelocity1 )[lane] = b2Dot( normal, b2Sub( vrB, vrA ) );
+				}
+
+				int pointCount = manifold->pointCount;
+				B2_ASSERT( 0 < pointCount && pointCount <= 2 );
+
+				if ( pointCount == 2 )
+				{
+					const b2ManifoldPoint* mp = manifold->points + 1;
+
+					b2Vec2 rA = mp->anchorA;
+					b2Vec2 rB = mp->anchorB;
+
+					( (float*)&constraint->anchorA2.X )[lane] = rA.x;
+					( (float*)&constraint->anchorA2.Y )[lane] = rA.y;
+					( (float*)&constraint->anchorB2.X )[lane] = rB.x;
+					( (float*)&constraint->anchorB2.Y )[lane] = rB.y;
+
+					( (float*)&constraint->baseSeparation2 )[lane] = mp->separation - b2Dot( b2Sub( rB, rA ), normal );
+
+					( (float*)&constraint->normalImpulse2 )[lane] = warmStartScale * mp->normalImpulse;
+					( (float*)&constraint->tangentImpulse2 )[lane] = warmStartScale * mp->tangentImpulse;
+					( (float*)&constraint->totalNormalImpulse2 )[lane] = 0.0f;
+
+					float rnA = b2Cross( rA, normal );
+					float rnB = b2Cross( rB, normal );
+					float kNormal = mA + mB + iA * rnA * rnA + iB * rnB * rnB;
+					( (float*)&constraint->normalMass2 )[lane] = kNormal > 0.0f ? 1.0f / kNormal : 0.0f;
+
+					float rtA = b2Cross( rA, tangent );
+					float rtB = b2Cross( rB, tangent );
+					float kTangent = mA + mB + iA * rtA * rtA + iB * rtB * rtB;
+					( (float*)&constraint->tangentMass2 )[lane] = kTangent > 0.0f ? 1.0f / kTangent : 0.0f;
+
+					// relative velocity for restitution
+					b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
+					b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
+					( (float*)&constraint->relativeVelocity2 )[lane] = b2Dot( normal, b2Sub( vrB, vrA ) );
+				}
+				else
+				{
+					// dummy data that has no effect
+					( (float*)&constraint->baseSeparation2 )[lane] = 0.0f;
+					( (float*)&constraint->normalImpulse2 )[lane] = 0.0f;
+					( (float*)&constraint->tangentImpulse2 )[lane] = 0.0f;
+					( (float*)&constraint->totalNormalImpulse2 )[lane] = 0.0f;
+					( (float*)&constraint->anchorA2.X )[lane] = 0.0f;
+					( (float*)&constraint->anchorA2.Y )[lane] = 0.0f;
+					( (float*)&constraint->anchorB2.X )[lane] = 0.0f;
+					( (float*)&constraint->anchorB2.Y )[lane] = 0.0f;
+					( (float*)&constraint->normalMass2 )[lane] = 0.0f;
+					( (float*)&constraint->tangentMass2 )[lane] = 0.0f;
+					( (float*)&constraint->relativeVelocity2 )[lane] = 0.0f;
+				}
+			}
+		}
+
+		// Advance to next color
+		colorIndex += 1;
+	}
+
+	b2TracyCZoneEnd( prepare_contact );
+}
+
+static void b2WarmStartContactsTask( b2SolverBlock block, b2StepContext* context )
+{
+	b2TracyCZoneNC( warm_start_contact, "Warm Start", b2_colorGreen, true );
+
+	b2BodyState* states = context->states;
+	b2ContactConstraintWide* constraints = context->graph->colors[block.colorIndex].wideConstraints;
+
+	int endIndex = block.startIndex + block.count;
+	for ( int i = block.startIndex; i < endIndex; ++i )
+	{
+		if ( i + B2_CONTACT_PREFETCH_DISTANCE < endIndex )
+		{
+			b2PrefetchConstraintBodies( states, constraints + i + B2_CONTACT_PREFETCH_DISTANCE );
+		}
+
+		b2ContactConstraintWide* c = constraints + i;
+		b2BodyStateW bA = b2GatherBodies( states, c->indexA );
+		b2BodyStateW bB = b2GatherBodies( states, c->indexB );
+
+		b2FloatW tangentX = c->normal.Y;
+		b2FloatW tangentY = b2SubW( b2ZeroW(), c->normal.X );
+
+		{
+			// fixed anchors
+			b2Vec2W rA = c->anchorA1;
+			b2Vec2W rB = c->anchorB1;
+
+			b2Vec2W P;
+			P.X = b2AddW( b2MulW( c->normalImpulse1, c->normal.X ), b2MulW( c->tangentImpulse1, tangentX ) );
+			P.Y = b2AddW( b2MulW( c->normalImpulse1, c->normal.Y ), b2MulW( c->tangentImpulse1, tangentY ) );
+			bA.w = b2MulSubW( bA.w, c->invIA, b2CrossW( rA, P ) );
+			bA.v.X = b2MulSubW( bA.v.X, c->invMassA, P.X );
+			bA.v.Y = b2MulSubW( bA.v.Y, c->invMassA, P.Y );
+			bB.w = b2MulAddW( bB.w, c->invIB, b2CrossW( rB, P ) );
+			bB.v.X = b2MulAddW( bB.v.X, c->invMassB, P.X );
+			bB.v.Y = b2MulAddW( bB.v.Y, c->invMassB, P.Y );
+
+			c->totalNormalImpulse1 = b2AddW( c->totalNormalImpulse1, c->normalImpulse1 );
+		}
+
+		{
+			// fixed anchors
+			b2Vec2W rA = c->anchorA2;
+			b2Vec2W rB = c->anchorB2;
+
+			b2Vec2W P;
+			P.X = b2AddW( b2MulW( c->normalImpulse2, c->normal.X ), b2MulW( c->tangentImpulse2, tangentX ) );
+			P.Y = b2AddW( b2MulW( c->normalImpulse2, c->normal.Y ), b2MulW( c->tangentImpulse2, tangentY ) );
+			bA.w = b2MulSubW( bA.w, c->invIA, b2CrossW( rA, P ) );
+			bA.v.X = b2MulSubW( bA.v.X, c->invMassA, P.X );
+			bA.v.Y = b2MulSubW( bA.v.Y, c->invMassA, P.Y );
+			bB.w = b2MulAddW( bB.w, c->invIB, b2CrossW( rB, P ) );
+			bB.v.X = b2MulAddW( bB.v.X, c->invMassB, P.X );
+			bB.v.Y = b2MulAddW( bB.v.Y, c->invMassB, P.Y );
+
+			c->totalNormalImpulse2 = b2AddW( c->totalNormalImpulse2, c->normalImpulse2 );
+		}
+
+		bA.w = b2MulSubW( bA.w, c->invIA, c->rollingImpulse );
+		bB.w = b2MulAddW( bB.w, c->invIB, c->rollingImpulse );
+
+		b2ScatterBodies( states, c->indexA, &bA );
+		b2ScatterBodies( states, c->indexB, &bB );
+	}
+
+	b2TracyCZoneEnd( warm_start_contact );
+}
+
+static void b2SolveContactsTask( b2SolverBlock block, b2StepContext* context, bool useBias )
+{
+	b2TracyCZoneNC( solve_contact, "Solve Contact", b2_colorAliceBlue, true );
+
+	b2BodyState* states = context->states;
+	b2GraphColor* color = context->graph->colors + block.colorIndex;
+	b2ContactConstraintWide* constraints = color->wideConstraints;
+	b2FloatW inv_h = b2SplatW( context->inv_h );
+	b2FloatW contactSpeed = b2SplatW( -context->world->contactSpeed );
+	b2FloatW oneW = b2SplatW( 1.0f );
+
+	int endIndex = block.startIndex + block.count;
+	for ( int wideIndex = block.startIndex; wideIndex < endIndex; ++wideIndex )
+	{
+		if ( wideIndex + B2_CONTACT_PREFETCH_DISTANCE < endIndex )
+		{
+			b2PrefetchConstraintBodies( states, constraints + wideIndex + B2_CONTACT_PREFETCH_DISTANCE );
+		}
+
+		b2ContactConstraintWide* c = constraints + wideIndex;
+
+		b2BodyStateW bA = b2GatherBodies( states, c->indexA );
+		b2BodyStateW bB = b2GatherBodies( states, c->indexB );
+
+		b2FloatW biasRate, massScale, impulseScale;
+		if ( useBias )
+		{
+			biasRate = b2MulW( c->massScale, c->biasRate );
+			massScale = c->massScale;
+			impulseScale = c->impulseScale;
+		}
+		else
+		{
+			biasRate = b2ZeroW();
+			massScale = oneW;
+			impulseScale = b2ZeroW();
+		}
+
+		b2FloatW totalNormalImpulse = b2ZeroW();
+
+		b2Vec2W dp = { b2SubW( bB.dp.X, bA.dp.X ), b2SubW( bB.dp.Y, bA.dp.Y ) };
+
+		// point1 non-penetration constraint
+		{
+			// Fixed anchors for impulses
+			b2Vec2W rA = c->anchorA1;
+			b2Vec2W rB = c->anchorB1;
+
+			// Moving anchors for current separation
+			b2Vec2W rsA = b2RotateVectorW( bA.dq, rA );
+			b2Vec2W rsB = b2RotateVectorW( bB.dq, rB );
+
+			// compute current separation
+			// this is subject to round-off error if the anchor is far from the body center of mass
+			b2Vec2W ds = { b2AddW( dp.X, b2SubW( rsB.X, rsA.X ) ), b2AddW( dp.Y, b2SubW( rsB.Y, rsA.Y ) ) };
+			b2FloatW s = b2AddW( b2DotW( c->normal, ds ), c->baseSeparation1 );
+
+			// Apply speculative bias if separation is greater than zero, otherwise apply soft constraint bias
+			// The contactSpeed is meant to limit stiffness, not increase it.
+			b2FloatW mask = b2GreaterThanW( s, b2ZeroW() );
+			b2FloatW specBias = b2MulW( s, inv_h );
+			b2FloatW softBias = b2MaxW( b2MulW( biasRate, s ), contactSpeed );
+
+			// todo try b2MaxW(softBias, specBias);
+			b2FloatW bias = b2BlendW( softBias, specBias, mask );
+
+			b2FloatW pointMassScale = b2BlendW( massScale, oneW, mask );
+			b2FloatW pointImpulseScale = b2BlendW( impulseScale, b2ZeroW(), mask );
+
+			// Relative velocity at contact
+			b2FloatW dvx = b2SubW( b2SubW( bB.v.X, b2MulW( bB.w, rB.Y ) ), b2SubW( bA.v.X, b2MulW( bA.w, rA.Y ) ) );
+			b2FloatW dvy = b2SubW( b2AddW( bB.v.Y, b2MulW( bB.w, rB.X ) ), b2AddW( bA.v.Y, b2MulW( bA.w, rA.X ) ) );
+			b2FloatW vn = b2AddW( b2MulW( dvx, c->normal.X ), b2MulW( dvy, c->normal.Y ) );
+
+			// Compute normal impulse
+			b2FloatW negImpulse = b2AddW( b2MulW( c->normalMass1, b2AddW( b2MulW( pointMassScale, vn ), bias ) ),
+										  b2MulW( pointImpulseScale, c->normalImpulse1 ) );
+
+			// Clamp the accumulated impulse
+			b2FloatW newImpulse = b2MaxW( b2SubW( c->normalImpulse1, negImpulse ), b2ZeroW() );
+			b2FloatW impulse = b2SubW( newImpulse, c->normalImpulse1 );
+			c->normalImpulse1 = newImpulse;
+			c->totalNormalImpulse1 = b2AddW( c->totalNormalImpulse1, impulse );
+
+			totalNormalImpulse = b2AddW( totalNormalImpulse, newImpulse );
+
+			// Apply contact impulse
+			b2FloatW Px = b2MulW( impulse, c->normal.X );
+			b2FloatW Py = b2MulW( impulse, c->normal.Y );
+
+			bA.v.X = b2MulSubW( bA.v.X, c->invMassA, Px );
+			bA.v.Y = b2MulSubW( bA.v.Y, c->invMassA, Py );
+			bA.w = b2MulSubW( bA.w, c->invIA, b2SubW( b2MulW( rA.X, Py ), b2MulW( rA.Y, Px ) ) );
+
+			bB.v.X = b2MulAddW( bB.v.X, c->invMassB, Px );
+			bB.v.Y = b2MulAddW( bB.v.Y, c->invMassB, Py );
+			bB.w = b2MulAddW( bB.w, c->invIB, b2SubW( b2MulW( rB.X, Py ), b2MulW( rB.Y, Px ) ) );
+		}
+
+		// second point non-penetration constraint
+		{
+			// moving anchors for current separation
+			b2Vec2W rsA = b2RotateVectorW( bA.dq, c->anchorA2 );
+			b2Vec2W rsB = b2RotateVectorW( bB.dq, c->anchorB2 );
+
+			// compute current separation
+			b2Vec2W ds = { b2AddW( dp.X, b2SubW( rsB.X, rsA.X ) ), b2AddW( dp.Y, b2SubW( rsB.Y, rsA.Y ) ) };
+			b2FloatW s = b2AddW( b2DotW( c->normal, ds ), c->baseSeparation2 );
+
+			b2FloatW mask = b2GreaterThanW( s, b2ZeroW() );
+			b2FloatW specBias = b2MulW( s, inv_h );
+			b2FloatW softBias = b2MaxW( b2MulW( biasRate, s ), contactSpeed );
+			b2FloatW bias = b2BlendW( softBias, specBias, mask );
+
+			b2FloatW pointMassScale = b2BlendW( massScale, oneW, mask );
+			b2FloatW pointImpulseScale = b2BlendW( impulseScale, b2ZeroW(), mask );
+
+			// fixed anchors for Jacobians
+			b2Vec2W rA = c->anchorA2;
+			b2Vec2W rB = c->anchorB2;
+
+			// Relative velocity at contact
+			b2FloatW dvx = b2SubW( b2SubW( bB.v.X, b2MulW( bB.w, rB.Y ) ), b2SubW( bA.v.X, b2MulW( bA.w, rA.Y ) ) );
+			b2FloatW dvy = b2SubW( b2AddW( bB.v.Y, b2MulW( bB.w, rB.X ) ), b2AddW( bA.v.Y, b2MulW( bA.w, rA.X ) ) );
+			b2FloatW vn = b2AddW( b2MulW( dvx, c->normal.X ), b2MulW( dvy, c->normal.Y ) );
+
+			// Compute normal impulse
+			b2FloatW negImpulse = b2AddW( b2MulW( c->normalMass2, b2AddW( b2MulW( pointMassScale, vn ), bias ) ),
+										  b2MulW( pointImpulseScale, c->normalImpulse2 ) );
+
+			// Clamp the accumulated impulse
+			b2FloatW newImpulse = b2MaxW( b2SubW( c->normalImpulse2, negImpulse ), b2ZeroW() );
+			b2FloatW impulse = b2SubW( newImpulse, c->normalImpulse2 );
+			c->normalImpulse2 = newImpulse;
+			c->totalNormalImpulse2 = b2AddW( c->totalNormalImpulse2, impulse );
+
+			totalNormalImpulse = b2AddW( totalNormalImpulse, newImpulse );
+
+			// Apply contact impulse
+			b2FloatW Px = b2MulW( impulse, c->normal.X );
+			b2FloatW Py = b2MulW( impulse, c->normal.Y );
+
+			bA.v.X = b2MulSubW( bA.v.X, c->invMassA, Px );
+			bA.v.Y = b2MulSubW( bA.v.Y, c->invMassA, Py );
+			bA.w = b2MulSubW( bA.w, c->invIA, b2SubW( b2MulW( rA.X, Py ), b2MulW( rA.Y, Px ) ) );
+
+			bB.v.X = b2MulAddW( bB.v.X, c->invMassB, Px );
+			bB.v.Y = b2MulAddW( bB.v.Y, c->invMassB, Py );
+			bB.w = b2MulAddW( bB.w, c->invIB, b2SubW( b2MulW( rB.X, Py ), b2MulW( rB.Y, Px ) ) );
+		}
+
+		if (useBias == false)
+		{
+			// Rolling resistance
+			if ( b2AllZeroW( c->rollingResistance ) == false )
+			{
+				b2FloatW deltaLambda = b2MulW( c->rollingMass, b2SubW( bA.w, bB.w ) );
+				b2FloatW lambda = c->rollingImpulse;
+				b2FloatW maxLambda = b2MulW( c->rollingResistance, totalNormalImpulse );
+				c->rollingImpulse = b2SymClampW( b2AddW( lambda, deltaLambda ), maxLambda );
+				deltaLambda = b2SubW( c->rollingImpulse, lambda );
+
+				bA.w = b2MulSubW( bA.w, c->invIA, deltaLambda );
+				bB.w = b2MulAddW( bB.w, c->invIB, deltaLambda );
+			}
+
+			b2FloatW tangentX = c->normal.Y;
+			b2FloatW tangentY = b2SubW( b2ZeroW(), c->normal.X );
+
+			// point 1 friction constraint
+			{
+				// Fixed anchor points for applying impulses
+				b2Vec2W rA = c->anchorA1;
+				b2Vec2W rB = c->anchorB1;
+
+				// Relative velocity at contact
+				b2FloatW dvx = b2SubW( b2SubW( bB.v.X, b2MulW( bB.w, rB.Y ) ), b2SubW( bA.v.X, b2MulW( bA.w, rA.Y ) ) );
+				b2FloatW dvy = b2SubW( b2AddW( bB.v.Y, b2MulW( bB.w, rB.X ) ), b2AddW( bA.v.Y, b2MulW( bA.w, rA.X ) ) );
+				b2FloatW vt = b2AddW( b2MulW( dvx, tangentX ), b2MulW( dvy, tangentY ) );
+
+				// Tangent speed (conveyor belt)
+				vt = b2SubW( vt, c->tangentSpeed );
+
+				// Compute tangent force
+				b2FloatW negImpulse = b2MulW( c->tangentMass1, vt );
+
+				// Clamp the accumulated force
+				b2FloatW maxFriction = b2MulW( c->friction, c->normalImpulse1 );
+				b2FloatW newImpulse = b2SubW( c->tangentImpulse1, negImpulse );
+				newImpulse = b2MaxW( b2SubW( b2ZeroW(), maxFriction ), b2MinW( newImpulse, maxFriction ) );
+				b2FloatW impulse = b2SubW( newImpulse, c->tangentImpulse1 );
+				c->tangentImpulse1 = newImpulse;
+
+				// Apply contact impulse
+				b2FloatW Px = b2MulW( impulse, tangentX );
+				b2FloatW Py = b2MulW( impulse, tangentY );
+
+				bA.v.X = b2MulSubW( bA.v.X, c->invMassA, Px );
+				bA.v.Y = b2MulSubW( bA.v.Y, c->invMassA, Py );
+				bA.w = b2MulSubW( bA.w, c->invIA, b2SubW( b2MulW( rA.X, Py ), b2MulW( rA.Y, Px ) ) );
+
+				bB.v.X = b2MulAddW( bB.v.X, c->invMassB, Px );
+				bB.v.Y = b2MulAddW( bB.v.Y, c->invMassB, Py );
+				bB.w = b2MulAddW( bB.w, c->invIB, b2SubW( b2MulW( rB.X, Py ), b2MulW( rB.Y, Px ) ) );
+			}
+
+			// second point friction constraint
+			{
+				// fixed anchors for Jacobians
+				b2Vec2W rA = c->anchorA2;
+				b2Vec2W rB = c->anchorB2;
+
+				// Relative velocity at contact
+				b2FloatW dvx = b2SubW( b2SubW( bB.v.X, b2MulW( bB.w, rB.Y ) ), b2SubW( bA.v.X, b2MulW( bA.w, rA.Y ) ) );
+				b2FloatW dvy = b2SubW( b2AddW( bB.v.Y, b2MulW( bB.w, rB.X ) ), b2AddW( bA.v.Y, b2MulW( bA.w, rA.X ) ) );
+				b2FloatW vt = b2AddW( b2MulW( dvx, tangentX ), b2MulW( dvy, tangentY ) );
+
+				// Tangent speed (conveyor belt)
+				vt = b2SubW( vt, c->tangentSpeed );
+
+				// Compute tangent force
+				b2FloatW negImpulse = b2MulW( c->tangentMass2, vt );
+
+				// Clamp the accumulated force
+				b2FloatW maxFriction = b2MulW( c->friction, c->normalImpulse2 );
+				b2FloatW newImpulse = b2SubW( c->tangentImpulse2, negImpulse );
+				newImpulse = b2MaxW( b2SubW( b2ZeroW(), maxFriction ), b2MinW( newImpulse, maxFriction ) );
+				b2FloatW impulse = b2SubW( newImpulse, c->tangentImpulse2 );
+				c->tangentImpulse2 = newImpulse;
+
+				// Apply contact impulse
+				b2FloatW Px = b2MulW( impulse, tangentX );
+				b2FloatW Py = b2MulW( impulse, tangentY );
+
+				bA.v.X = b2MulSubW( bA.v.X, c->invMassA, Px );
+				bA.v.Y = b2MulSubW( bA.v.Y, c->invMassA, Py );
+				bA.w = b2MulSubW( bA.w, c->invIA, b2SubW( b2MulW( rA.X, Py ), b2MulW( rA.Y, Px ) ) );
+
+				bB.v.X = b2MulAddW( bB.v.X, c->invMassB, Px );
+				bB.v.Y = b2MulAddW( bB.v.Y, c->invMassB, Py );
+				bB.w = b2MulAddW( bB.w, c->invIB, b2SubW( b2MulW( rB.X, Py ), b2MulW( rB.Y, Px ) ) );
+			}
+		}
+
+		b2ScatterBodies( states, c->indexA, &bA );
+		b2ScatterBodies( states, c->indexB, &bB );
+	}
+
+	b2TracyCZoneEnd( solve_contact );
+}
+
+static void b2ApplyRestitutionTask( b2SolverBlock block, b2StepContext* context )
+{
+	b2TracyCZoneNC( restitution, "Restitution", b2_colorDodgerBlue, true );
+
+	b2BodyState* states = context->states;
+	b2ContactConstraintWide* constraints = context->graph->colors[block.colorIndex].wideConstraints;
+	b2FloatW threshold = b2SplatW( context->world->restitutionThreshold );
+	b2FloatW zero = b2ZeroW();
+
+	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
+	{
+		b2ContactConstraintWide* c = constraints + i;
+
+		if ( b2AllZeroW( c->restitution ) )
+		{
+			// No lanes have restitution. Common case.
+			continue;
+		}
+
+		// Create a mask based on restitution so that lanes with no restitution are not affected
+		// by the calculations below.
+		b2FloatW restitutionMask = b2EqualsW( c->restitution, zero );
+
+		b2BodyStateW bA = b2GatherBodies( states, c->indexA );
+		b2BodyStateW bB = b2GatherBodies( states, c->indexB );
+
+		// first point non-penetration constraint
+		{
+			// Set effective mass to zero if restitution should not be applied
+			b2FloatW mask1 = b2GreaterThanW( b2AddW( c->relativeVelocity1, threshold ), zero );
+			b2FloatW mask2 = b2EqualsW( c->totalNormalImpulse1, zero );
+			b2FloatW mask = b2OrW( b2OrW( mask1, mask2 ), restitutionMask );
+			b2FloatW mass = b2BlendW( c->normalMass1, zero, mask );
+
+			// Fixed anchors for impulses
+			b2Vec2W rA = c->anchorA1;
+			b2Vec2W rB = c->anchorB1;
+
+			// Relative velocity at contact
+			b2FloatW dvx = b2SubW( b2SubW( bB.v.X, b2MulW( bB.w, rB.Y ) ), b2SubW( bA.v.X, b2MulW( bA.w, rA.Y ) ) );
+			b2FloatW dvy = b2SubW( b2AddW( bB.v.Y, b2MulW( bB.w, rB.X ) ), b2AddW( bA.v.Y, b2MulW( bA.w, rA.X ) ) );
+			b2FloatW vn = b2AddW( b2MulW( dvx, c->normal.X ), b2MulW( dvy, c->normal.Y ) );
+
+			// Compute normal impulse
+			b2FloatW negImpulse = b2MulW( mass, b2AddW( vn, b2MulW( c->restitution, c->relativeVelocity1 ) ) );
+
+			// Clamp the accumulated impulse
+			b2FloatW newImpulse = b2MaxW( b2SubW( c->normalImpulse1, negImpulse ), b2ZeroW() );
+			b2FloatW deltaImpulse = b2SubW( newImpulse, c->normalImpulse1 );
+			c->normalImpulse1 = newImpulse;
+			c->totalNormalImpulse1 = b2AddW( c->totalNormalImpulse1, deltaImpulse );
+
+			// Apply contact impulse
+			b2FloatW Px = b2MulW( deltaImpulse, c->normal.X );
+			b2FloatW Py = b2MulW( deltaImpulse, c->normal.Y );
+
+			bA.v.X = b2MulSubW( bA.v.X, c->invMassA, Px );
+			bA.v.Y = b2MulSubW( bA.v.Y, c->invMassA, Py );
+			bA.w = b2MulSubW( bA.w, c->invIA, b2SubW( b2MulW( rA.X, Py ), b2MulW( rA.Y, Px ) ) );
+
+			bB.v.X = b2MulAddW( bB.v.X, c->invMassB, Px );
+			bB.v.Y = b2MulAddW( bB.v.Y, c->invMassB, Py );
+			bB.w = b2MulAddW( bB.w, c->invIB, b2SubW( b2MulW( rB.X, Py ), b2MulW( rB.Y, Px ) ) );
+		}
+
+		// second point non-penetration constraint
+		{
+			// Set effective mass to zero if restitution should not be applied
+			b2FloatW mask1 = b2GreaterThanW( b2AddW( c->relativeVelocity2, threshold ), zero );
+			b2FloatW mask2 = b2EqualsW( c->totalNormalImpulse2, zero );
+			b2FloatW mask = b2OrW( b2OrW( mask1, mask2 ), restitutionMask );
+			b2FloatW mass = b2BlendW( c->normalMass2, zero, mask );
+
+			// fixed anchors for Jacobians
+			b2Vec2W rA = c->anchorA2;
+			b2Vec2W rB = c->anchorB2;
+
+			// Relative velocity at contact
+			b2FloatW dvx = b2SubW( b2SubW( bB.v.X, b2MulW( bB.w, rB.Y ) ), b2SubW( bA.v.X, b2MulW( bA.w, rA.Y ) ) );
+			b2FloatW dvy = b2SubW( b2AddW( bB.v.Y, b2MulW( bB.w, rB.X ) ), b2AddW( bA.v.Y, b2MulW( bA.w, rA.X ) ) );
+			b2FloatW vn = b2AddW( b2MulW( dvx, c->normal.X ), b2MulW( dvy, c->normal.Y ) );
+
+			// Compute normal impulse
+			b2FloatW negImpulse = b2MulW( mass, b2AddW( vn, b2MulW( c->restitution, c->relativeVelocity2 ) ) );
+
+			// Clamp the accumulated impulse
+			b2FloatW newImpulse = b2MaxW( b2SubW( c->normalImpulse2, negImpulse ), b2ZeroW() );
+			b2FloatW deltaImpulse = b2SubW( newImpulse, c->normalImpulse2 );
+			c->normalImpulse2 = newImpulse;
+
+			c->totalNormalImpulse2 = b2AddW( c->totalNormalImpulse2, deltaImpulse );
+
+			// Apply contact impulse
+			b2FloatW Px = b2MulW( deltaImpulse, c->normal.X );
+			b2FloatW Py = b2MulW( deltaImpulse, c->normal.Y );
+
+			bA.v.X = b2MulSubW( bA.v.X, c->invMassA, Px );
+			bA.v.Y = b2MulSubW( bA.v.Y, c->invMassA, Py );
+			bA.w = b2MulSubW( bA.w, c->invIA, b2SubW( b2MulW( rA.X, Py ), b2MulW( rA.Y, Px ) ) );
+
+			bB.v.X = b2MulAddW( bB.v.X, c->invMassB, Px );
+			bB.v.Y = b2MulAddW( bB.v.Y, c->invMassB, Py );
+			bB.w = b2MulAddW( bB.w, c->invIB, b2SubW( b2MulW( rB.X, Py ), b2MulW( rB.Y, Px ) ) );
+		}
+
+		b2ScatterBodies( states, c->indexA, &bA );
+		b2ScatterBodies( states, c->indexB, &bB );
+	}
+
+	b2TracyCZoneEnd( restitution );
+}
+
+// I tried adding this to the last relax iterations but it was slower.
+//
+// Runs as a flat parallel-for over the whole wide constraint range. Per-color
+// contact sims are looked up through the prepareSpans cursor rather than the
+// block's colorIndex, matching the layout of b2PrepareContactsTask.
+//
+// Note: I could store the manifold pointer in the b2ContactConstraintWide to simplify
+// this.
+static void b2StoreImpulsesTask( b2SolverBlock block, b2StepContext* context, int workerIndex )
+{
+	b2TracyCZoneNC( store_impulses, "Store", b2_colorFireBrick, true );
+
+	b2World* world = context->world;
+	const b2ContactPrepareSpan* spans = context->contactPrepareSpans;
+	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
+	b2BitSet* hitEventBitSet = &taskContext->hitEventBitSet;
+	bool hasHitEvents = taskContext->hasHitEvents;
+	float negHitThreshold = -world->hitEventThreshold;
+
+	int wideIndex = block.startIndex;
+	int endWideIndex = block.startIndex + block.count;
+
+	// Find color for start index
+	int colorIndex = 0;
+	while ( spans[colorIndex + 1].start <= wideIndex )
+	{
+		colorIndex += 1;
+	}
+
+	while ( wideIndex < endWideIndex )
+	{
+		int colorWideEndIndex = b2MinInt( spans[colorIndex + 1].start, endWideIndex );
+		int colorWideStart = spans[colorIndex].start;
+		int colorContactCount = spans[colorIndex].count;
+		b2ContactSim* contactSims = spans[colorIndex].contacts;
+		const b2ContactConstraintWide* constraints = spans[colorIndex].constraints;
+
+		for ( ; wideIndex < colorWideEndIndex; ++wideIndex )
+		{
+			const b2ContactConstraintWide* c = constraints + ( wideIndex - colorWideStart );
+			const float* rollingImpulse = (float*)&c->rollingImpulse;
+			const float* normalImpulse1 = (float*)&c->normalImpulse1;
+			const float* normalImpulse2 = (float*)&c->normalImpulse2;
+			const float* tangentImpulse1 = (float*)&c->tangentImpulse1;
+			const float* tangentImpulse2 = (float*)&c->tangentImpulse2;
+			const float* totalNormalImpulse1 = (float*)&c->totalNormalImpulse1;
+			const float* totalNormalImpulse2 = (float*)&c->totalNormalImpulse2;
+			const float* normalVelocity1 = (float*)&c->relativeVelocity1;
+			const float* normalVelocity2 = (float*)&c->relativeVelocity2;
+
+			int localWideIndex = wideIndex - colorWideStart;
+			int baseIndex = B2_SIMD_WIDTH * localWideIndex;
+
+			for ( int laneIndex = 0; laneIndex < B2_SIMD_WIDTH; ++laneIndex )
+			{
+				int contactIndex = baseIndex + laneIndex;
+				if ( contactIndex >= colorContactCount )
+				{
+					break;
+				}
+
+				b2ContactSim* contactSim = contactSims + contactIndex;
+				b2Manifold* m = &contactSim->manifold;
+				m->rollingImpulse = rollingImpulse[laneIndex];
+
+				m->points[0].normalImpulse = normalImpulse1[laneIndex];
+				m->points[0].tangentImpulse = tangentImpulse1[laneIndex];
+				m->points[0].totalNormalImpulse = totalNormalImpulse1[laneIndex];
+				m->points[0].normalVelocity = normalVelocity1[laneIndex];
+
+				m->points[1].normalImpulse = normalImpulse2[laneIndex];
+				m->points[1].tangentImpulse = tangentImpulse2[laneIndex];
+				m->points[1].totalNormalImpulse = totalNormalImpulse2[laneIndex];
+				m->points[1].normalVelocity = normalVelocity2[laneIndex];
+
+				// Check for hit events to speed up serial processing later in the step
+				if ( ( contactSim->simFlags & b2_simEnableHitEvent ) != 0 )
+				{
+					for (int k = 0; k < contactSim->manifold.pointCount; ++k)
+					{
+						b2ManifoldPoint* mp = m->points + k;
+
+						// Need to check total impulse because the point may be speculative and not colliding
+						if ( mp->normalVelocity < negHitThreshold && mp->totalNormalImpulse > 0.0f )
+						{
+							b2SetBit( hitEventBitSet, contactSim->contactId );
+							hasHitEvents = true;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		// Advance to next color
+		colorIndex += 1;
+	}
+
+	taskContext->hasHitEvents = hasHitEvents;
+
+	b2TracyCZoneEnd( store_impulses );
+}
+
+const b2ContactSolverKernels B2_CONTACT_SOLVER_KERNELS = {
+	.simdWidth = B2_SIMD_WIDTH,
+	.simdShift = B2_SIMD_SHIFT,
+	.constraintByteCount = sizeof( b2ContactConstraintWide ),
+	.prepare = b2PrepareContactsTask,
+	.warmStart = b2WarmStartContactsTask,
+	.solve = b2SolveContactsTask,
+	.applyRestitution = b2ApplyRestitutionTask,
+	.storeImpulses = b2StoreImpulsesTask,
+};
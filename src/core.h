@@ -83,6 +83,16 @@
 	#define B2_COMPILER_MSVC
 #endif
 
+// Cache prefetch hint with write intent. This never faults, so it can be issued ahead of a gather.
+#if defined( B2_COMPILER_CLANG ) || defined( B2_COMPILER_GCC )
+	#define B2_PREFETCH( ptr ) __builtin_prefetch( ( ptr ), 1, 3 )
+#elif defined( B2_COMPILER_MSVC ) && defined( B2_CPU_X86_X64 )
+	#include <xmmintrin.h>
+	#define B2_PREFETCH( ptr ) _mm_prefetch( (const char*)( ptr ), _MM_HINT_T0 )
+#else
+	#define B2_PREFETCH( ptr ) ( (void)( ptr ) )
+#endif
+
 /// Tracy profiler instrumentation
 /// https://github.com/wolfpld/tracy
 #ifdef BOX2D_PROFILE
@@ -154,6 +164,21 @@ typedef struct b2AtomicI64
 	int64_t value;
 } b2AtomicI64;
 
+typedef struct b2AtomicU64
+{
+	uint64_t value;
+} b2AtomicU64;
+
+typedef struct b2AtomicU8
+{
+	uint8_t value;
+} b2AtomicU8;
+
+typedef struct b2AtomicU16
+{
+	uint16_t value;
+} b2AtomicU16;
+
 void* b2Alloc( size_t size );
 void* b2AllocZeroInit( size_t size );
 #define B2_ALLOC_STRUCT( type ) b2Alloc(sizeof(type))
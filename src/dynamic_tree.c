@@ -1,8 +1,12 @@
 // SPDX-FileCopyrightText: 2023 Erin Catto
 // SPDX-License-Identifier: MIT
 
+#include "dynamic_tree.h"
+
 #include "aabb.h"
+#include "atomic.h"
 #include "core.h"
+#include "ctz.h"
 
 #include "box2d/collision.h"
 #include "box2d/constants.h"
@@ -11,6 +15,14 @@
 #include <float.h>
 #include <string.h>
 
+#if defined( B2_SIMD_AVX2 )
+#include <immintrin.h>
+#elif defined( B2_SIMD_NEON )
+#include <arm_neon.h>
+#elif defined( B2_SIMD_SSE2 )
+#include <emmintrin.h>
+#endif
+
 #define B2_TREE_STACK_SIZE 1024
 
 static b2TreeNode b2_defaultTreeNode = {
@@ -21,19 +33,24 @@ static b2TreeNode b2_defaultTreeNode = {
 			.child1 = B2_NULL_INDEX,
 			.child2 = B2_NULL_INDEX,
 		},
+};
+
+static b2TreeNodeData b2_defaultTreeNodeData = {
+	.userData = UINT64_MAX,
 	.parent = B2_NULL_INDEX,
 	.height = 0,
 	.flags = b2_allocatedNode,
 };
 
+// This only reads the hot node so traversal doesn't touch the node data
 static bool b2IsLeaf( const b2TreeNode* node )
 {
-	return node->flags & b2_leafNode;
+	return node->children.child1 == B2_NULL_INDEX;
 }
 
-static bool b2IsAllocated( const b2TreeNode* node )
+static bool b2IsAllocated( const b2TreeNodeData* data )
 {
-	return node->flags & b2_allocatedNode;
+	return data->flags & b2_allocatedNode;
 }
 
 static uint16_t b2MaxUInt16( uint16_t a, uint16_t b )
@@ -56,18 +73,20 @@ b2DynamicTree b2DynamicTree_Create( int proxyCapacity )
 	tree.nodeCapacity = 2 * capacity - 1;
 	tree.nodeCount = 0;
 	tree.nodes = (b2TreeNode*)b2Alloc( tree.nodeCapacity * sizeof( b2TreeNode ) );
+	tree.nodeData = (b2TreeNodeData*)b2Alloc( tree.nodeCapacity * sizeof( b2TreeNodeData ) );
 
 	// todo eliminate this memset
 	memset( tree.nodes, 0, tree.nodeCapacity * sizeof( b2TreeNode ) );
+	memset( tree.nodeData, 0, tree.nodeCapacity * sizeof( b2TreeNodeData ) );
 
 	// Build a linked list for the free list.
 	// todo use a bump allocation scheme to avoid this work
 	for ( int i = 0; i < tree.nodeCapacity - 1; ++i )
 	{
-		tree.nodes[i].next = i + 1;
+		tree.nodeData[i].next = i + 1;
 	}
 
-	tree.nodes[tree.nodeCapacity - 1].next = B2_NULL_INDEX;
+	tree.nodeData[tree.nodeCapacity - 1].next = B2_NULL_INDEX;
 	tree.freeList = 0;
 
 	tree.proxyCount = 0;
@@ -78,16 +97,22 @@ b2DynamicTree b2DynamicTree_Create( int proxyCapacity )
 	tree.binIndices = NULL;
 	tree.rebuildCapacity = 0;
 
+	tree.wideNodes = NULL;
+	tree.wideNodeCount = 0;
+	tree.wideNodeCapacity = 0;
+
 	return tree;
 }
 
 void b2DynamicTree_Destroy( b2DynamicTree* tree )
 {
 	b2Free( tree->nodes, tree->nodeCapacity * sizeof( b2TreeNode ) );
+	b2Free( tree->nodeData, tree->nodeCapacity * sizeof( b2TreeNodeData ) );
 	b2Free( tree->leafIndices, tree->rebuildCapacity * sizeof( int32_t ) );
 	b2Free( tree->leafBoxes, tree->rebuildCapacity * sizeof( b2AABB ) );
 	b2Free( tree->leafCenters, tree->rebuildCapacity * sizeof( b2Vec2 ) );
 	b2Free( tree->binIndices, tree->rebuildCapacity * sizeof( int32_t ) );
+	b2Free( tree->wideNodes, tree->wideNodeCapacity * sizeof( b2TreeNode4 ) );
 
 	memset( tree, 0, sizeof( b2DynamicTree ) );
 }
@@ -102,33 +127,38 @@ static int b2AllocateNode( b2DynamicTree* tree )
 
 		// The free list is empty. Rebuild a bigger pool.
 		b2TreeNode* oldNodes = tree->nodes;
+		b2TreeNodeData* oldData = tree->nodeData;
 		int oldCapacity = tree->nodeCapacity;
 		tree->nodeCapacity += oldCapacity >> 1;
 		tree->nodes = (b2TreeNode*)b2Alloc( tree->nodeCapacity * sizeof( b2TreeNode ) );
+		tree->nodeData = (b2TreeNodeData*)b2Alloc( tree->nodeCapacity * sizeof( b2TreeNodeData ) );
 		B2_ASSERT( oldNodes != NULL );
 		memcpy( tree->nodes, oldNodes, tree->nodeCount * sizeof( b2TreeNode ) );
+		memcpy( tree->nodeData, oldData, tree->nodeCount * sizeof( b2TreeNodeData ) );
 
 		// todo eliminate this memset
 		memset( tree->nodes + tree->nodeCount, 0, ( tree->nodeCapacity - tree->nodeCount ) * sizeof( b2TreeNode ) );
+		memset( tree->nodeData + tree->nodeCount, 0, ( tree->nodeCapacity - tree->nodeCount ) * sizeof( b2TreeNodeData ) );
 
 		b2Free( oldNodes, oldCapacity * sizeof( b2TreeNode ) );
+		b2Free( oldData, oldCapacity * sizeof( b2TreeNodeData ) );
 
 		// Build a linked list for the free list. The parent pointer becomes the "next" pointer.
 		// todo avoid building freelist using bump allocator
 		for ( int i = tree->nodeCount; i < tree->nodeCapacity - 1; ++i )
 		{
-			tree->nodes[i].next = i + 1;
+			tree->nodeData[i].next = i + 1;
 		}
 
-		tree->nodes[tree->nodeCapacity - 1].next = B2_NULL_INDEX;
+		tree->nodeData[tree->nodeCapacity - 1].next = B2_NULL_INDEX;
 		tree->freeList = tree->nodeCount;
 	}
 
 	// Peel a node off the free list.
 	int nodeIndex = tree->freeList;
-	b2TreeNode* node = tree->nodes + nodeIndex;
-	tree->freeList = node->next;
-	*node = b2_defaultTreeNode;
+	tree->freeList = tree->nodeData[nodeIndex].next;
+	tree->nodes[nodeIndex] = b2_defaultTreeNode;
+	tree->nodeData[nodeIndex] = b2_defaultTreeNodeData;
 	++tree->nodeCount;
 	return nodeIndex;
 }
@@ -138,8 +168,8 @@ static void b2FreeNode( b2DynamicTree* tree, int nodeId )
 {
 	B2_ASSERT( 0 <= nodeId && nodeId < tree->nodeCapacity );
 	B2_ASSERT( 0 < tree->nodeCount );
-	tree->nodes[nodeId].next = tree->freeList;
-	tree->nodes[nodeId].flags = 0;
+	tree->nodeData[nodeId].next = tree->freeList;
+	tree->nodeData[nodeId].flags = 0;
 	tree->freeList = nodeId;
 	--tree->nodeCount;
 }
@@ -183,7 +213,7 @@ static int b2FindBestSibling( const b2DynamicTree* tree, b2AABB boxD )
 
 	// Descend the tree from root, following a single greedy path.
 	int index = rootIndex;
-	while ( nodes[index].height > 0 )
+	while ( b2IsLeaf( nodes + index ) == false )
 	{
 		int child1 = nodes[index].children.child1;
 		int child2 = nodes[index].children.child2;
@@ -202,8 +232,8 @@ static int b2FindBestSibling( const b2DynamicTree* tree, b2AABB boxD )
 		// Inheritance cost seen by children
 		inheritedCost += directCost - areaBase;
 
-		bool leaf1 = nodes[child1].height == 0;
-		bool leaf2 = nodes[child2].height == 0;
+		bool leaf1 = b2IsLeaf( nodes + child1 );
+		bool leaf2 = b2IsLeaf( nodes + child2 );
 
 		// Cost of descending into child 1
 		float lowerCost1 = FLT_MAX;
@@ -295,7 +325,7 @@ static int b2FindBestSibling( const b2DynamicTree* tree, b2AABB boxD )
 			directCost = directCost2;
 		}
 
-		B2_ASSERT( nodes[index].height > 0 );
+		B2_ASSERT( b2IsLeaf( nodes + index ) == false );
 	}
 
 	return bestSibling;
@@ -317,9 +347,10 @@ static void b2RotateNodes( b2DynamicTree* tree, int iA )
 	B2_ASSERT( iA != B2_NULL_INDEX );
 
 	b2TreeNode* nodes = tree->nodes;
+	b2TreeNodeData* data = tree->nodeData;
 
 	b2TreeNode* A = nodes + iA;
-	if ( A->height < 2 )
+	if ( data[iA].height < 2 )
 	{
 		return;
 	}
@@ -332,10 +363,10 @@ static void b2RotateNodes( b2DynamicTree* tree, int iA )
 	b2TreeNode* B = nodes + iB;
 	b2TreeNode* C = nodes + iC;
 
-	if ( B->height == 0 )
+	if ( data[iB].height == 0 )
 	{
 		// B is a leaf and C is internal
-		B2_ASSERT( C->height > 0 );
+		B2_ASSERT( data[iC].height > 0 );
 
 		int iF = C->children.child1;
 		int iG = C->children.child2;
@@ -367,17 +398,17 @@ static void b2RotateNodes( b2DynamicTree* tree, int iA )
 			A->children.child1 = iF;
 			C->children.child1 = iB;
 
-			B->parent = iC;
-			F->parent = iA;
+			data[iB].parent = iC;
+			data[iF].parent = iA;
 
 			C->aabb = aabbBG;
 
-			C->height = 1 + b2MaxUInt16( B->height, G->height );
-			A->height = 1 + b2MaxUInt16( C->height, F->height );
+			data[iC].height = 1 + b2MaxUInt16( data[iB].height, data[iG].height );
+			data[iA].height = 1 + b2MaxUInt16( data[iC].height, data[iF].height );
 			C->categoryBits = B->categoryBits | G->categoryBits;
 			A->categoryBits = C->categoryBits | F->categoryBits;
-			C->flags |= ( B->flags | G->flags ) & b2_enlargedNode;
-			A->flags |= ( C->flags | F->flags ) & b2_enlargedNode;
+			data[iC].flags |= ( data[iB].flags | data[iG].flags ) & b2_enlargedNode;
+			data[iA].flags |= ( data[iC].flags | data[iF].flags ) & b2_enlargedNode;
 		}
 		else
 		{
@@ -385,23 +416,23 @@ static void b2RotateNodes( b2DynamicTree* tree, int iA )
 			A->children.child1 = iG;
 			C->children.child2 = iB;
 
-			B->parent = iC;
-			G->parent = iA;
+			data[iB].parent = iC;
+			data[iG].parent = iA;
 
 			C->aabb = aabbBF;
 
-			C->height = 1 + b2MaxUInt16( B->height, F->height );
-			A->height = 1 + b2MaxUInt16( C->height, G->height );
+			data[iC].height = 1 + b2MaxUInt16( data[iB].height, data[iF].height );
+			data[iA].height = 1 + b2MaxUInt16( data[iC].height, data[iG].height );
 			C->categoryBits = B->categoryBits | F->categoryBits;
 			A->categoryBits = C->categoryBits | G->categoryBits;
-			C->flags |= ( B->flags | F->flags ) & b2_enlargedNode;
-			A->flags |= ( C->flags | G->flags ) & b2_enlargedNode;
+			data[iC].flags |= ( data[iB].flags | data[iF].flags ) & b2_enlargedNode;
+			data[iA].flags |= ( data[iC].flags | data[iG].flags ) & b2_enlargedNode;
 		}
 	}
-	else if ( C->height == 0 )
+	else if ( data[iC].height == 0 )
 	{
 		// C is a leaf and B is internal
-		B2_ASSERT( B->height > 0 );
+		B2_ASSERT( data[iB].height > 0 );
 
 		int iD = B->children.child1;
 		int iE = B->children.child2;
@@ -433,17 +464,17 @@ static void b2RotateNodes( b2DynamicTree* tree, int iA )
 			A->children.child2 = iD;
 			B->children.child1 = iC;
 
-			C->parent = iB;
-			D->parent = iA;
+			data[iC].parent = iB;
+			data[iD].parent = iA;
 
 			B->aabb = aabbCE;
 
-			B->height = 1 + b2MaxUInt16( C->height, E->height );
-			A->height = 1 + b2MaxUInt16( B->height, D->height );
+			data[iB].height = 1 + b2MaxUInt16( data[iC].height, data[iE].height );
+			data[iA].height = 1 + b2MaxUInt16( data[iB].height, data[iD].height );
 			B->categoryBits = C->categoryBits | E->categoryBits;
 			A->categoryBits = B->categoryBits | D->categoryBits;
-			B->flags |= ( C->flags | E->flags ) & b2_enlargedNode;
-			A->flags |= ( B->flags | D->flags ) & b2_enlargedNode;
+			data[iB].flags |= ( data[iC].flags | data[iE].flags ) & b2_enlargedNode;
+			data[iA].flags |= ( data[iB].flags | data[iD].flags ) & b2_enlargedNode;
 		}
 		else
 		{
@@ -451,16 +482,16 @@ static void b2RotateNodes( b2DynamicTree* tree, int iA )
 			A->children.child2 = iE;
 			B->children.child2 = iC;
 
-			C->parent = iB;
-			E->parent = iA;
+			data[iC].parent = iB;
+			data[iE].parent = iA;
 
 			B->aabb = aabbCD;
-			B->height = 1 + b2MaxUInt16( C->height, D->height );
-			A->height = 1 + b2MaxUInt16( B->height, E->height );
+			data[iB].height = 1 + b2MaxUInt16( data[iC].height, data[iD].height );
+			data[iA].height = 1 + b2MaxUInt16( data[iB].height, data[iE].height );
 			B->categoryBits = C->categoryBits | D->categoryBits;
 			A->categoryBits = B->categoryBits | E->categoryBits;
-			B->flags |= ( C->flags | D->flags ) & b2_enlargedNode;
-			A->flags |= ( B->flags | E->flags ) & b2_enlargedNode;
+			data[iB].flags |= ( data[iC].flags | data[iD].flags ) & b2_enlargedNode;
+			data[iA].flags |= ( data[iB].flags | data[iE].flags ) & b2_enlargedNode;
 		}
 	}
 	else
@@ -532,64 +563,64 @@ static void b2RotateNodes( b2DynamicTree* tree, int iA )
 				A->children.child1 = iF;
 				C->children.child1 = iB;
 
-				B->parent = iC;
-				F->parent = iA;
+				data[iB].parent = iC;
+				data[iF].parent = iA;
 
 				C->aabb = aabbBG;
-				C->height = 1 + b2MaxUInt16( B->height, G->height );
-				A->height = 1 + b2MaxUInt16( C->height, F->height );
+				data[iC].height = 1 + b2MaxUInt16( data[iB].height, data[iG].height );
+				data[iA].height = 1 + b2MaxUInt16( data[iC].height, data[iF].height );
 				C->categoryBits = B->categoryBits | G->categoryBits;
 				A->categoryBits = C->categoryBits | F->categoryBits;
-				C->flags |= ( B->flags | G->flags ) & b2_enlargedNode;
-				A->flags |= ( C->flags | F->flags ) & b2_enlargedNode;
+				data[iC].flags |= ( data[iB].flags | data[iG].flags ) & b2_enlargedNode;
+				data[iA].flags |= ( data[iC].flags | data[iF].flags ) & b2_enlargedNode;
 				break;
 
 			case b2_rotateBG:
 				A->children.child1 = iG;
 				C->children.child2 = iB;
 
-				B->parent = iC;
-				G->parent = iA;
+				data[iB].parent = iC;
+				data[iG].parent = iA;
 
 				C->aabb = aabbBF;
-				C->height = 1 + b2MaxUInt16( B->height, F->height );
-				A->height = 1 + b2MaxUInt16( C->height, G->height );
+				data[iC].height = 1 + b2MaxUInt16( data[iB].height, data[iF].height );
+				data[iA].height = 1 + b2MaxUInt16( data[iC].height, data[iG].height );
 				C->categoryBits = B->categoryBits | F->categoryBits;
 				A->categoryBits = C->categoryBits | G->categoryBits;
-				C->flags |= ( B->flags | F->flags ) & b2_enlargedNode;
-				A->flags |= ( C->flags | G->flags ) & b2_enlargedNode;
+				data[iC].flags |= ( data[iB].flags | data[iF].flags ) & b2_enlargedNode;
+				data[iA].flags |= ( data[iC].flags | data[iG].flags ) & b2_enlargedNode;
 				break;
 
 			case b2_rotateCD:
 				A->children.child2 = iD;
 				B->children.child1 = iC;
 
-				C->parent = iB;
-				D->parent = iA;
+				data[iC].parent = iB;
+				data[iD].parent = iA;
 
 				B->aabb = aabbCE;
-				B->height = 1 + b2MaxUInt16( C->height, E->height );
-				A->height = 1 + b2MaxUInt16( B->height, D->height );
+				data[iB].height = 1 + b2MaxUInt16( data[iC].height, data[iE].height );
+				data[iA].height = 1 + b2MaxUInt16( data[iB].height, data[iD].height );
 				B->categoryBits = C->categoryBits | E->categoryBits;
 				A->categoryBits = B->categoryBits | D->categoryBits;
-				B->flags |= ( C->flags | E->flags ) & b2_enlargedNode;
-				A->flags |= ( B->flags | D->flags ) & b2_enlargedNode;
+				data[iB].flags |= ( data[iC].flags | data[iE].flags ) & b2_enlargedNode;
+				data[iA].flags |= ( data[iB].flags | data[iD].flags ) & b2_enlargedNode;
 				break;
 
 			case b2_rotateCE:
 				A->children.child2 = iE;
 				B->children.child2 = iC;
 
-				C->parent = iB;
-				E->parent = iA;
+				data[iC].parent = iB;
+				data[iE].parent = iA;
 
 				B->aabb = aabbCD;
-				B->height = 1 + b2MaxUInt16( C->height, D->height );
-				A->height = 1 + b2MaxUInt16( B->height, E->height );
+				data[iB].height = 1 + b2MaxUInt16( data[iC].height, data[iD].height );
+				data[iA].height = 1 + b2MaxUInt16( data[iB].height, data[iE].height );
 				B->categoryBits = C->categoryBits | D->categoryBits;
 				A->categoryBits = B->categoryBits | E->categoryBits;
-				B->flags |= ( C->flags | D->flags ) & b2_enlargedNode;
-				A->flags |= ( B->flags | E->flags ) & b2_enlargedNode;
+				data[iB].flags |= ( data[iC].flags | data[iD].flags ) & b2_enlargedNode;
+				data[iA].flags |= ( data[iB].flags | data[iE].flags ) & b2_enlargedNode;
 				break;
 
 			default:
@@ -604,7 +635,7 @@ static void b2InsertLeaf( b2DynamicTree* tree, int leaf, bool shouldRotate )
 	if ( tree->root == B2_NULL_INDEX )
 	{
 		tree->root = leaf;
-		tree->nodes[tree->root].parent = B2_NULL_INDEX;
+		tree->nodeData[tree->root].parent = B2_NULL_INDEX;
 		return;
 	}
 
@@ -613,20 +644,20 @@ static void b2InsertLeaf( b2DynamicTree* tree, int leaf, bool shouldRotate )
 	int sibling = b2FindBestSibling( tree, leafAABB );
 
 	// Stage 2: create a new parent for the leaf and sibling
-	int oldParent = tree->nodes[sibling].parent;
+	int oldParent = tree->nodeData[sibling].parent;
 	int newParent = b2AllocateNode( tree );
 
 	// Warning: node pointer can change after allocation
 	b2TreeNode* nodes = tree->nodes;
-	nodes[newParent].parent = oldParent;
-	nodes[newParent].userData = UINT64_MAX;
+	b2TreeNodeData* data = tree->nodeData;
+	data[newParent].parent = oldParent;
 	nodes[newParent].aabb = b2AABB_Union( leafAABB, nodes[sibling].aabb );
 	nodes[newParent].categoryBits = nodes[leaf].categoryBits | nodes[sibling].categoryBits;
-	nodes[newParent].height = nodes[sibling].height + 1;
+	data[newParent].height = data[sibling].height + 1;
 	nodes[newParent].children.child1 = sibling;
 	nodes[newParent].children.child2 = leaf;
-	nodes[sibling].parent = newParent;
-	nodes[leaf].parent = newParent;
+	data[sibling].parent = newParent;
+	data[leaf].parent = newParent;
 
 	// Fix grandparent links
 	if ( oldParent != B2_NULL_INDEX )
@@ -649,7 +680,7 @@ static void b2InsertLeaf( b2DynamicTree* tree, int leaf, bool shouldRotate )
 	}
 
 	// Stage 3: walk back up the tree fixing heights and AABBs
-	int index = nodes[leaf].parent;
+	int index = data[leaf].parent;
 	while ( index != B2_NULL_INDEX )
 	{
 		int child1 = nodes[index].children.child1;
@@ -660,15 +691,15 @@ static void b2InsertLeaf( b2DynamicTree* tree, int leaf, bool shouldRotate )
 
 		nodes[index].aabb = b2AABB_Union( nodes[child1].aabb, nodes[child2].aabb );
 		nodes[index].categoryBits = nodes[child1].categoryBits | nodes[child2].categoryBits;
-		nodes[index].height = 1 + b2MaxUInt16( nodes[child1].height, nodes[child2].height );
-		nodes[index].flags |= ( nodes[child1].flags | nodes[child2].flags ) & b2_enlargedNode;
+		data[index].height = 1 + b2MaxUInt16( data[child1].height, data[child2].height );
+		data[index].flags |= ( data[child1].flags | data[child2].flags ) & b2_enlargedNode;
 
 		if ( shouldRotate )
 		{
 			b2RotateNodes( tree, index );
 		}
 
-		index = nodes[index].parent;
+		index = data[index].parent;
 	}
 }
 
@@ -681,9 +712,10 @@ static void b2RemoveLeaf( b2DynamicTree* tree, int leaf )
 	}
 
 	b2TreeNode* nodes = tree->nodes;
+	b2TreeNodeData* data = tree->nodeData;
 
-	int parent = nodes[leaf].parent;
-	int grandParent = nodes[parent].parent;
+	int parent = data[leaf].parent;
+	int grandParent = data[parent].parent;
 	int sibling;
 	if ( nodes[parent].children.child1 == leaf )
 	{
@@ -705,7 +737,7 @@ static void b2RemoveLeaf( b2DynamicTree* tree, int leaf )
 		{
 			nodes[grandParent].children.child2 = sibling;
 		}
-		nodes[sibling].parent = grandParent;
+		data[sibling].parent = grandParent;
 		b2FreeNode( tree, parent );
 
 		// Adjust ancestor bounds.
@@ -713,8 +745,8 @@ static void b2RemoveLeaf( b2DynamicTree* tree, int leaf )
 		while ( index != B2_NULL_INDEX )
 		{
 			b2TreeNode* node = nodes + index;
-			b2TreeNode* child1 = nodes + node->children.child1;
-			b2TreeNode* child2 = nodes + node->children.child2;
+			int child1 = node->children.child1;
+			int child2 = node->children.child2;
 
 			// Fast union using SSE
 			//__m128 aabb1 = _mm_load_ps(&child1->aabb.lowerBound.x);
@@ -724,17 +756,17 @@ static void b2RemoveLeaf( b2DynamicTree* tree, int leaf )
 			//__m128 aabb = _mm_shuffle_ps(lower, upper, _MM_SHUFFLE(3, 2, 1, 0));
 			//_mm_store_ps(&node->aabb.lowerBound.x, aabb);
 
-			node->aabb = b2AABB_Union( child1->aabb, child2->aabb );
-			node->categoryBits = child1->categoryBits | child2->categoryBits;
-			node->height = 1 + b2MaxUInt16( child1->height, child2->height );
+			node->aabb = b2AABB_Union( nodes[child1].aabb, nodes[child2].aabb );
+			node->categoryBits = nodes[child1].categoryBits | nodes[child2].categoryBits;
+			data[index].height = 1 + b2MaxUInt16( data[child1].height, data[child2].height );
 
-			index = node->parent;
+			index = data[index].parent;
 		}
 	}
 	else
 	{
 		tree->root = sibling;
-		tree->nodes[sibling].parent = B2_NULL_INDEX;
+		data[sibling].parent = B2_NULL_INDEX;
 		b2FreeNode( tree, parent );
 	}
 }
@@ -750,17 +782,19 @@ int b2DynamicTree_CreateProxy( b2DynamicTree* tree, b2AABB aabb, uint64_t catego
 
 	int proxyId = b2AllocateNode( tree );
 	b2TreeNode* node = tree->nodes + proxyId;
+	b2TreeNodeData* data = tree->nodeData + proxyId;
 
 	node->aabb = aabb;
-	node->userData = userData;
 	node->categoryBits = categoryBits;
-	node->height = 0;
-	node->flags = b2_allocatedNode | b2_leafNode;
+	data->userData = userData;
+	data->height = 0;
+	data->flags = b2_allocatedNode | b2_leafNode;
 
 	bool shouldRotate = true;
 	b2InsertLeaf( tree, proxyId, shouldRotate );
 
 	tree->proxyCount += 1;
+	tree->wideNodeCount = 0;
 
 	return proxyId;
 }
@@ -775,6 +809,7 @@ void b2DynamicTree_DestroyProxy( b2DynamicTree* tree, int proxyId )
 
 	B2_ASSERT( tree->proxyCount > 0 );
 	tree->proxyCount -= 1;
+	tree->wideNodeCount = 0;
 }
 
 int b2DynamicTree_GetProxyCount( const b2DynamicTree* tree )
@@ -796,11 +831,14 @@ void b2DynamicTree_MoveProxy( b2DynamicTree* tree, int proxyId, b2AABB aabb )
 
 	bool shouldRotate = false;
 	b2InsertLeaf( tree, proxyId, shouldRotate );
+
+	tree->wideNodeCount = 0;
 }
 
 void b2DynamicTree_EnlargeProxy( b2DynamicTree* tree, int proxyId, b2AABB aabb )
 {
 	b2TreeNode* nodes = tree->nodes;
+	b2TreeNodeData* data = tree->nodeData;
 
 	B2_VALIDATE( b2IsValidAABB( aabb ) );
 	B2_VALIDATE( aabb.upperBound.x - aabb.lowerBound.x < B2_HUGE );
@@ -812,13 +850,14 @@ void b2DynamicTree_EnlargeProxy( b2DynamicTree* tree, int proxyId, b2AABB aabb )
 	B2_VALIDATE( b2AABB_Contains( nodes[proxyId].aabb, aabb ) == false );
 
 	nodes[proxyId].aabb = aabb;
+	tree->wideNodeCount = 0;
 
-	int parentIndex = nodes[proxyId].parent;
+	int parentIndex = data[proxyId].parent;
 	while ( parentIndex != B2_NULL_INDEX )
 	{
 		bool changed = b2EnlargeAABB( &nodes[parentIndex].aabb, aabb );
-		nodes[parentIndex].flags |= b2_enlargedNode;
-		parentIndex = nodes[parentIndex].parent;
+		data[parentIndex].flags |= b2_enlargedNode;
+		parentIndex = data[parentIndex].parent;
 
 		if ( changed == false )
 		{
@@ -828,29 +867,85 @@ void b2DynamicTree_EnlargeProxy( b2DynamicTree* tree, int proxyId, b2AABB aabb )
 
 	while ( parentIndex != B2_NULL_INDEX )
 	{
-		if ( nodes[parentIndex].flags & b2_enlargedNode )
+		if ( data[parentIndex].flags & b2_enlargedNode )
 		{
 			// early out because this ancestor was previously ascended and marked as enlarged
 			break;
 		}
 
-		nodes[parentIndex].flags |= b2_enlargedNode;
-		parentIndex = nodes[parentIndex].parent;
+		data[parentIndex].flags |= b2_enlargedNode;
+		parentIndex = data[parentIndex].parent;
+	}
+}
+
+int b2DynamicTree_FlagEnlargedProxy( b2DynamicTree* tree, int proxyId, b2AABB aabb, int* flaggedNodes, int capacity )
+{
+	b2TreeNode* nodes = tree->nodes;
+	b2TreeNodeData* data = tree->nodeData;
+
+	B2_VALIDATE( b2IsValidAABB( aabb ) );
+	B2_ASSERT( 0 <= proxyId && proxyId < tree->nodeCapacity );
+	B2_ASSERT( b2IsLeaf( tree->nodes + proxyId ) );
+	B2_VALIDATE( b2AABB_Contains( nodes[proxyId].aabb, aabb ) == false );
+	B2_UNUSED( capacity );
+
+	nodes[proxyId].aabb = aabb;
+
+	// The first caller to claim an ancestor continues up, so every ancestor is reported once. Ancestors
+	// may already be flagged as enlarged, for example when the tree was not rebuilt last step, so the
+	// claim uses its own flag.
+	int count = 0;
+	int parentIndex = data[proxyId].parent;
+	while ( parentIndex != B2_NULL_INDEX )
+	{
+		uint16_t flags = b2AtomicFetchOrU16( (b2AtomicU16*)&data[parentIndex].flags, b2_enlargedNode | b2_refitNode );
+		if ( flags & b2_refitNode )
+		{
+			break;
+		}
+
+		B2_ASSERT( count < capacity );
+		flaggedNodes[count] = parentIndex;
+		count += 1;
+		parentIndex = data[parentIndex].parent;
 	}
+
+	return count;
+}
+
+void b2DynamicTree_RefitNode( b2DynamicTree* tree, int nodeIndex )
+{
+	b2TreeNode* node = tree->nodes + nodeIndex;
+	B2_ASSERT( b2IsLeaf( node ) == false );
+
+	int child1 = node->children.child1;
+	int child2 = node->children.child2;
+	B2_ASSERT( tree->nodeData[child1].height < tree->nodeData[nodeIndex].height );
+	B2_ASSERT( tree->nodeData[child2].height < tree->nodeData[nodeIndex].height );
+
+	// Grow rather than fit so the box matches b2DynamicTree_EnlargeProxy
+	b2EnlargeAABB( &node->aabb, tree->nodes[child1].aabb );
+	b2EnlargeAABB( &node->aabb, tree->nodes[child2].aabb );
+
+	// Release the claim from b2DynamicTree_FlagEnlargedProxy
+	B2_ASSERT( tree->nodeData[nodeIndex].flags & b2_refitNode );
+	tree->nodeData[nodeIndex].flags &= ~b2_refitNode;
 }
 
 void b2DynamicTree_SetCategoryBits( b2DynamicTree* tree, int proxyId, uint64_t categoryBits )
 {
 	b2TreeNode* nodes = tree->nodes;
+	b2TreeNodeData* data = tree->nodeData;
 
 	B2_ASSERT( nodes[proxyId].children.child1 == B2_NULL_INDEX );
 	B2_ASSERT( nodes[proxyId].children.child2 == B2_NULL_INDEX );
-	B2_ASSERT( ( nodes[proxyId].flags & b2_leafNode ) == b2_leafNode );
+	B2_ASSERT( ( data[proxyId].flags & b2_leafNode ) == b2_leafNode );
 
 	nodes[proxyId].categoryBits = categoryBits;
+	tree->wideNodeCount = 0;
 
 	// Fix up category bits in ancestor internal nodes
-	int nodeIndex = nodes[proxyId].parent;
+	int nodeIndex = data[proxyId].parent;
 	while ( nodeIndex != B2_NULL_INDEX )
 	{
 		b2TreeNode* node = nodes + nodeIndex;
@@ -860,7 +955,7 @@ void b2DynamicTree_SetCategoryBits( b2DynamicTree* tree, int proxyId, uint64_t c
 		B2_ASSERT( child2 != B2_NULL_INDEX );
 		node->categoryBits = nodes[child1].categoryBits | nodes[child2].categoryBits;
 
-		nodeIndex = node->parent;
+		nodeIndex = data[nodeIndex].parent;
 	}
 }
 
@@ -877,7 +972,7 @@ int b2DynamicTree_GetHeight( const b2DynamicTree* tree )
 		return 0;
 	}
 
-	return tree->nodes[tree->root].height;
+	return tree->nodeData[tree->root].height;
 }
 
 float b2DynamicTree_GetAreaRatio( const b2DynamicTree* tree )
@@ -894,7 +989,7 @@ float b2DynamicTree_GetAreaRatio( const b2DynamicTree* tree )
 	for ( int i = 0; i < tree->nodeCapacity; ++i )
 	{
 		const b2TreeNode* node = tree->nodes + i;
-		if ( b2IsAllocated( node ) == false || b2IsLeaf( node ) || i == tree->root )
+		if ( b2IsAllocated( tree->nodeData + i ) == false || b2IsLeaf( node ) || i == tree->root )
 		{
 			continue;
 		}
@@ -942,16 +1037,22 @@ static void b2ValidateStructure( const b2DynamicTree* tree, int index )
 
 	if ( index == tree->root )
 	{
-		B2_ASSERT( tree->nodes[index].parent == B2_NULL_INDEX );
+		B2_ASSERT( tree->nodeData[index].parent == B2_NULL_INDEX );
 	}
 
 	const b2TreeNode* node = tree->nodes + index;
+	const b2TreeNodeData* data = tree->nodeData + index;
+
+	B2_ASSERT( data->flags == 0 || ( data->flags & b2_allocatedNode ) != 0 );
+	B2_ASSERT( b2IsLeaf( node ) == ( ( data->flags & b2_leafNode ) != 0 ) );
 
-	B2_ASSERT( node->flags == 0 || ( node->flags & b2_allocatedNode ) != 0 );
+	// The parallel refit releases every node it claims
+	B2_ASSERT( ( data->flags & b2_refitNode ) == 0 );
 
 	if ( b2IsLeaf( node ) )
 	{
-		B2_ASSERT( node->height == 0 );
+		B2_ASSERT( data->height == 0 );
+		B2_ASSERT( node->children.child2 == B2_NULL_INDEX );
 		return;
 	}
 
@@ -961,12 +1062,12 @@ static void b2ValidateStructure( const b2DynamicTree* tree, int index )
 	B2_ASSERT( 0 <= child1 && child1 < tree->nodeCapacity );
 	B2_ASSERT( 0 <= child2 && child2 < tree->nodeCapacity );
 
-	B2_ASSERT( tree->nodes[child1].parent == index );
-	B2_ASSERT( tree->nodes[child2].parent == index );
+	B2_ASSERT( tree->nodeData[child1].parent == index );
+	B2_ASSERT( tree->nodeData[child2].parent == index );
 
-	if ( ( tree->nodes[child1].flags | tree->nodes[child2].flags ) & b2_enlargedNode )
+	if ( ( tree->nodeData[child1].flags | tree->nodeData[child2].flags ) & b2_enlargedNode )
 	{
-		B2_ASSERT( node->flags & b2_enlargedNode );
+		B2_ASSERT( data->flags & b2_enlargedNode );
 	}
 
 	b2ValidateStructure( tree, child1 );
@@ -984,7 +1085,7 @@ static void b2ValidateMetrics( const b2DynamicTree* tree, int index )
 
 	if ( b2IsLeaf( node ) )
 	{
-		B2_ASSERT( node->height == 0 );
+		B2_ASSERT( tree->nodeData[index].height == 0 );
 		return;
 	}
 
@@ -994,10 +1095,10 @@ static void b2ValidateMetrics( const b2DynamicTree* tree, int index )
 	B2_ASSERT( 0 <= child1 && child1 < tree->nodeCapacity );
 	B2_ASSERT( 0 <= child2 && child2 < tree->nodeCapacity );
 
-	int height1 = tree->nodes[child1].height;
-	int height2 = tree->nodes[child2].height;
+	int height1 = tree->nodeData[child1].height;
+	int height2 = tree->nodeData[child2].height;
 	int height = 1 + b2MaxInt( height1, height2 );
-	B2_ASSERT( node->height == height );
+	B2_ASSERT( tree->nodeData[index].height == height );
 
 	// b2AABB aabb = b2AABB_Union(tree->nodes[child1].aabb, tree->nodes[child2].aabb);
 
@@ -1033,7 +1134,7 @@ void b2DynamicTree_Validate( const b2DynamicTree* tree )
 	while ( freeIndex != B2_NULL_INDEX )
 	{
 		B2_ASSERT( 0 <= freeIndex && freeIndex < tree->nodeCapacity );
-		freeIndex = tree->nodes[freeIndex].next;
+		freeIndex = tree->nodeData[freeIndex].next;
 		++freeCount;
 	}
 
@@ -1051,13 +1152,12 @@ void b2DynamicTree_ValidateNoEnlarged( const b2DynamicTree* tree )
 {
 #if B2_ENABLE_VALIDATION == 1
 	int capacity = tree->nodeCapacity;
-	const b2TreeNode* nodes = tree->nodes;
+	const b2TreeNodeData* data = tree->nodeData;
 	for ( int i = 0; i < capacity; ++i )
 	{
-		const b2TreeNode* node = nodes + i;
-		if ( node->flags & b2_allocatedNode )
+		if ( data[i].flags & b2_allocatedNode )
 		{
-			B2_ASSERT( ( node->flags & b2_enlargedNode ) == 0 );
+			B2_ASSERT( ( data[i].flags & b2_enlargedNode ) == 0 );
 		}
 	}
 #else
@@ -1067,8 +1167,9 @@ void b2DynamicTree_ValidateNoEnlarged( const b2DynamicTree* tree )
 
 int b2DynamicTree_GetByteCount( const b2DynamicTree* tree )
 {
-	size_t size = sizeof( b2DynamicTree ) + sizeof( b2TreeNode ) * tree->nodeCapacity +
-				  tree->rebuildCapacity * ( sizeof( int ) + sizeof( b2AABB ) + sizeof( b2Vec2 ) + sizeof( int ) );
+	size_t size = sizeof( b2DynamicTree ) + ( sizeof( b2TreeNode ) + sizeof( b2TreeNodeData ) ) * tree->nodeCapacity +
+				  tree->rebuildCapacity * ( sizeof( int ) + sizeof( b2AABB ) + sizeof( b2Vec2 ) + sizeof( int ) ) +
+				  tree->wideNodeCapacity * sizeof( b2TreeNode4 );
 
 	return (int)size;
 }
@@ -1076,7 +1177,7 @@ int b2DynamicTree_GetByteCount( const b2DynamicTree* tree )
 uint64_t b2DynamicTree_GetUserData( const b2DynamicTree* tree, int proxyId )
 {
 	B2_ASSERT( 0 <= proxyId && proxyId < tree->nodeCapacity );
-	return tree->nodes[proxyId].userData;
+	return tree->nodeData[proxyId].userData;
 }
 
 b2AABB b2DynamicTree_GetAABB( const b2DynamicTree* tree, int proxyId )
@@ -1085,84 +1186,332 @@ b2AABB b2DynamicTree_GetAABB( const b2DynamicTree* tree, int proxyId )
 	return tree->nodes[proxyId].aabb;
 }
 
-b2TreeStats b2DynamicTree_Query( const b2DynamicTree* tree, b2AABB aabb, uint64_t maskBits, b2TreeQueryCallbackFcn* callback,
-								 void* context )
+// Temporary data used to collapse a binary node into a wide node
+struct b2WideBuildItem
 {
-	b2TreeStats result = { 0 };
+	int nodeIndex;
+	int wideIndex;
+};
 
-	if ( tree->nodeCount == 0 )
+void b2DynamicTree_BuildWide( b2DynamicTree* tree )
+{
+	tree->wideNodeCount = 0;
+
+	if ( tree->root == B2_NULL_INDEX )
 	{
-		return result;
+		return;
 	}
 
-	int stack[B2_TREE_STACK_SIZE];
+	// Every wide node collapses a distinct internal node, except a root that is a leaf
+	int capacity = b2MaxInt( tree->nodeCount, 1 );
+	if ( capacity > tree->wideNodeCapacity )
+	{
+		b2Free( tree->wideNodes, tree->wideNodeCapacity * sizeof( b2TreeNode4 ) );
+		tree->wideNodeCapacity = capacity + capacity / 2;
+		tree->wideNodes = b2Alloc( tree->wideNodeCapacity * sizeof( b2TreeNode4 ) );
+	}
+
+	const b2TreeNode* nodes = tree->nodes;
+	b2TreeNode4* wideNodes = tree->wideNodes;
+	int wideCount = 1;
+
+	struct b2WideBuildItem stack[B2_TREE_STACK_SIZE];
 	int stackCount = 0;
-	stack[stackCount++] = tree->root;
+	stack[stackCount++] = ( struct b2WideBuildItem ){ tree->root, 0 };
 
 	while ( stackCount > 0 )
 	{
-		int nodeId = stack[--stackCount];
-
-		const b2TreeNode* node = tree->nodes + nodeId;
-		result.nodeVisits += 1;
+		struct b2WideBuildItem item = stack[--stackCount];
+		const b2TreeNode* node = nodes + item.nodeIndex;
 
-		if ( b2AABB_Overlaps( node->aabb, aabb ) && ( node->categoryBits & maskBits ) != 0 )
+		int children[4];
+		int childCount;
+		if ( b2IsLeaf( node ) )
 		{
-			if ( b2IsLeaf( node ) )
+			// Only the root can get here
+			children[0] = item.nodeIndex;
+			childCount = 1;
+		}
+		else
+		{
+			children[0] = node->children.child1;
+			children[1] = node->children.child2;
+			childCount = 2;
+
+			// Open the internal child with the largest perimeter until there are four children
+			while ( childCount < 4 )
 			{
-				// callback to user code with proxy id
-				bool proceed = callback( nodeId, node->userData, context );
-				result.leafVisits += 1;
+				int bestChild = B2_NULL_INDEX;
+				float bestArea = -1.0f;
+				for ( int i = 0; i < childCount; ++i )
+				{
+					const b2TreeNode* child = nodes + children[i];
+					if ( b2IsLeaf( child ) )
+					{
+						continue;
+					}
+
+					float area = b2Perimeter( child->aabb );
+					if ( area > bestArea )
+					{
+						bestChild = i;
+						bestArea = area;
+					}
+				}
 
-				if ( proceed == false )
+				if ( bestChild == B2_NULL_INDEX )
 				{
-					return result;
+					break;
 				}
+
+				const b2TreeNode* child = nodes + children[bestChild];
+				children[bestChild] = child->children.child1;
+				children[childCount] = child->children.child2;
+				childCount += 1;
+			}
+		}
+
+		b2TreeNode4* wideNode = wideNodes + item.wideIndex;
+		wideNode->leafMask = 0;
+		wideNode->childCount = childCount;
+
+		for ( int lane = 0; lane < 4; ++lane )
+		{
+			if ( lane >= childCount )
+			{
+				// Inverted box so an unused lane never overlaps
+				wideNode->lowerX[lane] = FLT_MAX;
+				wideNode->lowerY[lane] = FLT_MAX;
+				wideNode->upperX[lane] = -FLT_MAX;
+				wideNode->upperY[lane] = -FLT_MAX;
+				wideNode->categoryBits[lane] = 0;
+				wideNode->children[lane] = B2_NULL_INDEX;
+				continue;
+			}
+
+			int childIndex = children[lane];
+			const b2TreeNode* child = nodes + childIndex;
+			wideNode->lowerX[lane] = child->aabb.lowerBound.x;
+			wideNode->lowerY[lane] = child->aabb.lowerBound.y;
+			wideNode->upperX[lane] = child->aabb.upperBound.x;
+			wideNode->upperY[lane] = child->aabb.upperBound.y;
+			wideNode->categoryBits[lane] = child->categoryBits;
+
+			if ( b2IsLeaf( child ) )
+			{
+				wideNode->children[lane] = childIndex;
+				wideNode->leafMask |= 1u << lane;
 			}
 			else
 			{
-				if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+				B2_ASSERT( wideCount < tree->wideNodeCapacity );
+				int wideIndex = wideCount++;
+				wideNode->children[lane] = wideIndex;
+
+				if ( stackCount < B2_TREE_STACK_SIZE )
 				{
-					stack[stackCount++] = node->children.child1;
-					stack[stackCount++] = node->children.child2;
+					stack[stackCount++] = ( struct b2WideBuildItem ){ childIndex, wideIndex };
 				}
 				else
 				{
-					B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+					B2_ASSERT( stackCount < B2_TREE_STACK_SIZE );
 				}
 			}
 		}
 	}
 
-	return result;
+	tree->wideNodeCount = wideCount;
 }
 
-b2TreeStats b2DynamicTree_QueryAll( const b2DynamicTree* tree, b2AABB aabb, b2TreeQueryCallbackFcn* callback, void* context )
+// Returns a bit mask of the children of a wide node that overlap the box. Same as b2AABB_Overlaps.
+static uint32_t b2WideNodeOverlaps( const b2TreeNode4* node, b2AABB box )
 {
-	b2TreeStats result = { 0 };
+	uint32_t mask;
+
+#if defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+	__m128 overlap = _mm_cmple_ps( _mm_loadu_ps( node->lowerX ), _mm_set1_ps( box.upperBound.x ) );
+	overlap = _mm_and_ps( overlap, _mm_cmple_ps( _mm_loadu_ps( node->lowerY ), _mm_set1_ps( box.upperBound.y ) ) );
+	overlap = _mm_and_ps( overlap, _mm_cmple_ps( _mm_set1_ps( box.lowerBound.x ), _mm_loadu_ps( node->upperX ) ) );
+	overlap = _mm_and_ps( overlap, _mm_cmple_ps( _mm_set1_ps( box.lowerBound.y ), _mm_loadu_ps( node->upperY ) ) );
+	mask = (uint32_t)_mm_movemask_ps( overlap );
+#elif defined( B2_SIMD_NEON )
+	uint32x4_t overlap = vcleq_f32( vld1q_f32( node->lowerX ), vdupq_n_f32( box.upperBound.x ) );
+	overlap = vandq_u32( overlap, vcleq_f32( vld1q_f32( node->lowerY ), vdupq_n_f32( box.upperBound.y ) ) );
+	overlap = vandq_u32( overlap, vcleq_f32( vdupq_n_f32( box.lowerBound.x ), vld1q_f32( node->upperX ) ) );
+	overlap = vandq_u32( overlap, vcleq_f32( vdupq_n_f32( box.lowerBound.y ), vld1q_f32( node->upperY ) ) );
+
+	static const uint32_t laneBits[4] = { 1, 2, 4, 8 };
+	uint32x4_t laneMask = vandq_u32( overlap, vld1q_u32( laneBits ) );
+#if defined( _M_ARM64 ) || defined( __aarch64__ )
+	mask = vaddvq_u32( laneMask );
+#else
+	mask = vgetq_lane_u32( laneMask, 0 ) | vgetq_lane_u32( laneMask, 1 ) | vgetq_lane_u32( laneMask, 2 ) |
+		   vgetq_lane_u32( laneMask, 3 );
+#endif
+#else
+	mask = 0;
+	for ( int lane = 0; lane < 4; ++lane )
+	{
+		if ( node->lowerX[lane] <= box.upperBound.x && node->lowerY[lane] <= box.upperBound.y &&
+			 box.lowerBound.x <= node->upperX[lane] && box.lowerBound.y <= node->upperY[lane] )
+		{
+			mask |= 1u << lane;
+		}
+	}
+#endif
 
-	if ( tree->nodeCount == 0 )
+	return mask & ( ( 1u << node->childCount ) - 1 );
+}
+
+// Returns a bit mask of the children of a wide node that a swept segment may hit. This is the test used
+// by b2DynamicTree_RayCast and b2DynamicTree_ShapeCast: segment bounding box overlap and the segment
+// separating axis with the child extents grown by the extension.
+// |dot(v, p1 - c)| > dot(|v|, h)
+static uint32_t b2WideNodeSegmentOverlaps( const b2TreeNode4* node, b2AABB segmentBox, b2Vec2 p1, b2Vec2 v, b2Vec2 absV,
+										   b2Vec2 extension )
+{
+	uint32_t mask = b2WideNodeOverlaps( node, segmentBox );
+	if ( mask == 0 )
 	{
-		return result;
+		return 0;
+	}
+
+#if defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+	__m128 half = _mm_set1_ps( 0.5f );
+	__m128 lowerX = _mm_loadu_ps( node->lowerX );
+	__m128 lowerY = _mm_loadu_ps( node->lowerY );
+	__m128 upperX = _mm_loadu_ps( node->upperX );
+	__m128 upperY = _mm_loadu_ps( node->upperY );
+	__m128 cx = _mm_mul_ps( half, _mm_add_ps( lowerX, upperX ) );
+	__m128 cy = _mm_mul_ps( half, _mm_add_ps( lowerY, upperY ) );
+	__m128 hx = _mm_add_ps( _mm_mul_ps( half, _mm_sub_ps( upperX, lowerX ) ), _mm_set1_ps( extension.x ) );
+	__m128 hy = _mm_add_ps( _mm_mul_ps( half, _mm_sub_ps( upperY, lowerY ) ), _mm_set1_ps( extension.y ) );
+	__m128 dx = _mm_sub_ps( _mm_set1_ps( p1.x ), cx );
+	__m128 dy = _mm_sub_ps( _mm_set1_ps( p1.y ), cy );
+	__m128 term1 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( v.x ), dx ), _mm_mul_ps( _mm_set1_ps( v.y ), dy ) );
+	term1 = _mm_andnot_ps( _mm_set1_ps( -0.0f ), term1 );
+	__m128 term2 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( absV.x ), hx ), _mm_mul_ps( _mm_set1_ps( absV.y ), hy ) );
+	mask &= (uint32_t)_mm_movemask_ps( _mm_cmple_ps( term1, term2 ) );
+#elif defined( B2_SIMD_NEON )
+	float32x4_t half = vdupq_n_f32( 0.5f );
+	float32x4_t lowerX = vld1q_f32( node->lowerX );
+	float32x4_t lowerY = vld1q_f32( node->lowerY );
+	float32x4_t upperX = vld1q_f32( node->upperX );
+	float32x4_t upperY = vld1q_f32( node->upperY );
+	float32x4_t cx = vmulq_f32( half, vaddq_f32( lowerX, upperX ) );
+	float32x4_t cy = vmulq_f32( half, vaddq_f32( lowerY, upperY ) );
+	float32x4_t hx = vaddq_f32( vmulq_f32( half, vsubq_f32( upperX, lowerX ) ), vdupq_n_f32( extension.x ) );
+	float32x4_t hy = vaddq_f32( vmulq_f32( half, vsubq_f32( upperY, lowerY ) ), vdupq_n_f32( extension.y ) );
+	float32x4_t dx = vsubq_f32( vdupq_n_f32( p1.x ), cx );
+	float32x4_t dy = vsubq_f32( vdupq_n_f32( p1.y ), cy );
+	float32x4_t term1 = vabsq_f32( vaddq_f32( vmulq_f32( vdupq_n_f32( v.x ), dx ), vmulq_f32( vdupq_n_f32( v.y ), dy ) ) );
+	float32x4_t term2 = vaddq_f32( vmulq_f32( vdupq_n_f32( absV.x ), hx ), vmulq_f32( vdupq_n_f32( absV.y ), hy ) );
+
+	static const uint32_t laneBits[4] = { 1, 2, 4, 8 };
+	uint32x4_t laneMask = vandq_u32( vcleq_f32( term1, term2 ), vld1q_u32( laneBits ) );
+#if defined( _M_ARM64 ) || defined( __aarch64__ )
+	mask &= vaddvq_u32( laneMask );
+#else
+	mask &= vgetq_lane_u32( laneMask, 0 ) | vgetq_lane_u32( laneMask, 1 ) | vgetq_lane_u32( laneMask, 2 ) |
+			vgetq_lane_u32( laneMask, 3 );
+#endif
+#else
+	for ( int lane = 0; lane < 4; ++lane )
+	{
+		float cx = 0.5f * ( node->lowerX[lane] + node->upperX[lane] );
+		float cy = 0.5f * ( node->lowerY[lane] + node->upperY[lane] );
+		float hx = 0.5f * ( node->upperX[lane] - node->lowerX[lane] ) + extension.x;
+		float hy = 0.5f * ( node->upperY[lane] - node->lowerY[lane] ) + extension.y;
+		float term1 = b2AbsFloat( v.x * ( p1.x - cx ) + v.y * ( p1.y - cy ) );
+		float term2 = absV.x * hx + absV.y * hy;
+		if ( term2 < term1 )
+		{
+			mask &= ~( 1u << lane );
+		}
+	}
+#endif
+
+	return mask;
+}
+
+// Returns a bit mask of the children of a wide node that pass the category filter
+static uint32_t b2WideNodeCategoryMask( const b2TreeNode4* node, uint64_t maskBits )
+{
+	uint32_t mask = 0;
+	for ( int lane = 0; lane < node->childCount; ++lane )
+	{
+		if ( ( node->categoryBits[lane] & maskBits ) != 0 )
+		{
+			mask |= 1u << lane;
+		}
+	}
+
+	return mask;
+}
+
+// Sorts the children in the hit mask by distance from a point. Returns the number of children.
+static int b2SortWideNodeChildren( const b2TreeNode4* node, uint32_t hitMask, b2Vec2 point, int lanes[4] )
+{
+	float distances[4];
+	int count = 0;
+	while ( hitMask != 0 )
+	{
+		int lane = (int)b2CTZ32( hitMask );
+		hitMask &= hitMask - 1;
+
+		b2Vec2 center = { 0.5f * ( node->lowerX[lane] + node->upperX[lane] ), 0.5f * ( node->lowerY[lane] + node->upperY[lane] ) };
+		float distance = b2DistanceSquared( center, point );
+
+		// Insertion sort
+		int i = count;
+		while ( i > 0 && distances[i - 1] > distance )
+		{
+			distances[i] = distances[i - 1];
+			lanes[i] = lanes[i - 1];
+			i -= 1;
+		}
+
+		distances[i] = distance;
+		lanes[i] = lane;
+		count += 1;
 	}
 
+	return count;
+}
+
+static b2TreeStats b2QueryWide( const b2DynamicTree* tree, b2AABB aabb, uint64_t maskBits, bool useMaskBits,
+								b2TreeQueryCallbackFcn* callback, void* context )
+{
+	b2TreeStats result = { 0 };
+
+	const b2TreeNode4* wideNodes = tree->wideNodes;
+	const b2TreeNodeData* nodeData = tree->nodeData;
+
 	int stack[B2_TREE_STACK_SIZE];
 	int stackCount = 0;
-	stack[stackCount++] = tree->root;
+	stack[stackCount++] = 0;
 
 	while ( stackCount > 0 )
 	{
-		int nodeId = stack[--stackCount];
-
-		const b2TreeNode* node = tree->nodes + nodeId;
+		const b2TreeNode4* node = wideNodes + stack[--stackCount];
 		result.nodeVisits += 1;
 
-		if ( b2AABB_Overlaps( node->aabb, aabb ) )
+		uint32_t hitMask = b2WideNodeOverlaps( node, aabb );
+		if ( useMaskBits )
 		{
-			if ( b2IsLeaf( node ) )
+			hitMask &= b2WideNodeCategoryMask( node, maskBits );
+		}
+
+		while ( hitMask != 0 )
+		{
+			int lane = (int)b2CTZ32( hitMask );
+			hitMask &= hitMask - 1;
+
+			int child = node->children[lane];
+			if ( node->leafMask & ( 1u << lane ) )
 			{
 				// callback to user code with proxy id
-				bool proceed = callback( nodeId, node->userData, context );
+				bool proceed = callback( child, nodeData[child].userData, context );
 				result.leafVisits += 1;
 
 				if ( proceed == false )
@@ -1170,17 +1519,13 @@ b2TreeStats b2DynamicTree_QueryAll( const b2DynamicTree* tree, b2AABB aabb, b2Tr
 					return result;
 				}
 			}
+			else if ( stackCount < B2_TREE_STACK_SIZE )
+			{
+				stack[stackCount++] = child;
+			}
 			else
 			{
-				if ( stackCount < B2_TREE_STACK_SIZE - 1 )
-				{
-					stack[stackCount++] = node->children.child1;
-					stack[stackCount++] = node->children.child2;
-				}
-				else
-				{
-					B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
-				}
+				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE );
 			}
 		}
 	}
@@ -1188,16 +1533,11 @@ b2TreeStats b2DynamicTree_QueryAll( const b2DynamicTree* tree, b2AABB aabb, b2Tr
 	return result;
 }
 
-b2TreeStats b2DynamicTree_RayCast( const b2DynamicTree* tree, const b2RayCastInput* input, uint64_t maskBits,
-								   b2TreeRayCastCallbackFcn* callback, void* context )
+static b2TreeStats b2RayCastWide( const b2DynamicTree* tree, const b2RayCastInput* input, uint64_t maskBits,
+								  b2TreeRayCastCallbackFcn* callback, void* context )
 {
 	b2TreeStats result = { 0 };
 
-	if ( tree->nodeCount == 0 )
-	{
-		return result;
-	}
-
 	b2Vec2 p1 = input->origin;
 	b2Vec2 d = input->translation;
 
@@ -1207,9 +1547,6 @@ b2TreeStats b2DynamicTree_RayCast( const b2DynamicTree* tree, const b2RayCastInp
 	b2Vec2 v = b2CrossSV( 1.0f, r );
 	b2Vec2 abs_v = b2Abs( v );
 
-	// Separating axis for segment (Gino, p80).
-	// |dot(v, p1 - c)| > dot(|v|, h)
-
 	float maxFraction = input->maxFraction;
 
 	b2Vec2 p2 = b2MulAdd( p1, maxFraction, d );
@@ -1217,51 +1554,43 @@ b2TreeStats b2DynamicTree_RayCast( const b2DynamicTree* tree, const b2RayCastInp
 	// Build a bounding box for the segment.
 	b2AABB segmentAABB = { b2Min( p1, p2 ), b2Max( p1, p2 ) };
 
+	const b2TreeNode4* wideNodes = tree->wideNodes;
+	const b2TreeNodeData* nodeData = tree->nodeData;
+
 	int stack[B2_TREE_STACK_SIZE];
 	int stackCount = 0;
-	stack[stackCount++] = tree->root;
-
-	const b2TreeNode* nodes = tree->nodes;
+	stack[stackCount++] = 0;
 
 	b2RayCastInput subInput = *input;
 
 	while ( stackCount > 0 )
 	{
-		int nodeId = stack[--stackCount];
-		if ( nodeId == B2_NULL_INDEX )
-		{
-			// todo is this possible?
-			B2_ASSERT( false );
-			continue;
-		}
-
-		const b2TreeNode* node = nodes + nodeId;
+		const b2TreeNode4* node = wideNodes + stack[--stackCount];
 		result.nodeVisits += 1;
 
-		b2AABB nodeAABB = node->aabb;
-
-		if ( ( node->categoryBits & maskBits ) == 0 || b2AABB_Overlaps( nodeAABB, segmentAABB ) == false )
+		uint32_t hitMask = b2WideNodeSegmentOverlaps( node, segmentAABB, p1, v, abs_v, b2Vec2_zero );
+		hitMask &= b2WideNodeCategoryMask( node, maskBits );
+		if ( hitMask == 0 )
 		{
 			continue;
 		}
 
-		// Separating axis for segment (Gino, p80).
-		// |dot(v, p1 - c)| > dot(|v|, h)
-		// radius extension is added to the node in this case
-		b2Vec2 c = b2AABB_Center( nodeAABB );
-		b2Vec2 h = b2AABB_Extents( nodeAABB );
-		float term1 = b2AbsFloat( b2Dot( v, b2Sub( p1, c ) ) );
-		float term2 = b2Dot( abs_v, h );
-		if ( term2 < term1 )
-		{
-			continue;
-		}
+		int lanes[4];
+		int count = b2SortWideNodeChildren( node, hitMask, p1, lanes );
 
-		if ( b2IsLeaf( node ) )
+		// Report leaves near to far so the ray gets clipped early
+		for ( int i = 0; i < count; ++i )
 		{
+			int lane = lanes[i];
+			if ( ( node->leafMask & ( 1u << lane ) ) == 0 )
+			{
+				continue;
+			}
+
+			int proxyId = node->children[lane];
 			subInput.maxFraction = maxFraction;
 
-			float value = callback( &subInput, nodeId, node->userData, context );
+			float value = callback( &subInput, proxyId, nodeData[proxyId].userData, context );
 			result.leafVisits += 1;
 
 			// The user may return -1 to indicate this shape should be skipped
@@ -1281,26 +1610,23 @@ b2TreeStats b2DynamicTree_RayCast( const b2DynamicTree* tree, const b2RayCastInp
 				segmentAABB.upperBound = b2Max( p1, p2 );
 			}
 		}
-		else
+
+		// Push internal children far to near so the nearest is visited first
+		for ( int i = count - 1; i >= 0; --i )
 		{
-			if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+			int lane = lanes[i];
+			if ( node->leafMask & ( 1u << lane ) )
 			{
-				b2Vec2 c1 = b2AABB_Center( nodes[node->children.child1].aabb );
-				b2Vec2 c2 = b2AABB_Center( nodes[node->children.child2].aabb );
-				if ( b2DistanceSquared( c1, p1 ) < b2DistanceSquared( c2, p1 ) )
-				{
-					stack[stackCount++] = node->children.child2;
-					stack[stackCount++] = node->children.child1;
-				}
-				else
-				{
-					stack[stackCount++] = node->children.child1;
-					stack[stackCount++] = node->children.child2;
-				}
+				continue;
+			}
+
+			if ( stackCount < B2_TREE_STACK_SIZE )
+			{
+				stack[stackCount++] = node->children[lane];
 			}
 			else
 			{
-				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE );
 			}
 		}
 	}
@@ -1308,16 +1634,11 @@ b2TreeStats b2DynamicTree_RayCast( const b2DynamicTree* tree, const b2RayCastInp
 	return result;
 }
 
-b2TreeStats b2DynamicTree_ShapeCast( const b2DynamicTree* tree, const b2ShapeCastInput* input, uint64_t maskBits,
-									 b2TreeShapeCastCallbackFcn* callback, void* context )
+static b2TreeStats b2ShapeCastWide( const b2DynamicTree* tree, const b2ShapeCastInput* input, uint64_t maskBits,
+									b2TreeShapeCastCallbackFcn* callback, void* context )
 {
 	b2TreeStats stats = { 0 };
 
-	if ( tree->nodeCount == 0 || input->proxy.count == 0 )
-	{
-		return stats;
-	}
-
 	b2AABB originAABB = { input->proxy.points[0], input->proxy.points[0] };
 	for ( int i = 1; i < input->proxy.count; ++i )
 	{
@@ -1338,9 +1659,6 @@ b2TreeStats b2DynamicTree_ShapeCast( const b2DynamicTree* tree, const b2ShapeCas
 	b2Vec2 v = b2CrossSV( 1.0f, r );
 	b2Vec2 abs_v = b2Abs( v );
 
-	// Separating axis for segment (Gino, p80).
-	// |dot(v, p1 - c)| > dot(|v|, h)
-
 	float maxFraction = input->maxFraction;
 
 	// Build total box for the shape cast
@@ -1351,38 +1669,716 @@ b2TreeStats b2DynamicTree_ShapeCast( const b2DynamicTree* tree, const b2ShapeCas
 	};
 
 	b2ShapeCastInput subInput = *input;
-	const b2TreeNode* nodes = tree->nodes;
+	const b2TreeNode4* wideNodes = tree->wideNodes;
+	const b2TreeNodeData* nodeData = tree->nodeData;
 
 	int stack[B2_TREE_STACK_SIZE];
 	int stackCount = 0;
-	stack[stackCount++] = tree->root;
+	stack[stackCount++] = 0;
 
 	while ( stackCount > 0 )
 	{
-		int nodeId = stack[--stackCount];
-		if ( nodeId == B2_NULL_INDEX )
-		{
-			// todo is this possible?
-			B2_ASSERT( false );
-			continue;
-		}
-
-		const b2TreeNode* node = nodes + nodeId;
+		const b2TreeNode4* node = wideNodes + stack[--stackCount];
 		stats.nodeVisits += 1;
 
-		if ( ( node->categoryBits & maskBits ) == 0 || b2AABB_Overlaps( node->aabb, totalAABB ) == false )
+		uint32_t hitMask = b2WideNodeSegmentOverlaps( node, totalAABB, p1, v, abs_v, extension );
+		hitMask &= b2WideNodeCategoryMask( node, maskBits );
+		if ( hitMask == 0 )
 		{
 			continue;
 		}
 
-		// Separating axis for segment (Gino, p80).
-		// |dot(v, p1 - c)| > dot(|v|, h)
-		// radius extension is added to the node in this case
-		b2Vec2 c = b2AABB_Center( node->aabb );
-		b2Vec2 h = b2Add( b2AABB_Extents( node->aabb ), extension );
-		float term1 = b2AbsFloat( b2Dot( v, b2Sub( p1, c ) ) );
-		float term2 = b2Dot( abs_v, h );
-		if ( term2 < term1 )
+		int lanes[4];
+		int count = b2SortWideNodeChildren( node, hitMask, p1, lanes );
+
+		// Report leaves near to far so the cast gets clipped early
+		for ( int i = 0; i < count; ++i )
+		{
+			int lane = lanes[i];
+			if ( ( node->leafMask & ( 1u << lane ) ) == 0 )
+			{
+				continue;
+			}
+
+			int proxyId = node->children[lane];
+			subInput.maxFraction = maxFraction;
+
+			float value = callback( &subInput, proxyId, nodeData[proxyId].userData, context );
+			stats.leafVisits += 1;
+
+			if ( value == 0.0f )
+			{
+				// The client has terminated the ray cast.
+				return stats;
+			}
+
+			if ( 0.0f < value && value < maxFraction )
+			{
+				// Update segment bounding box.
+				maxFraction = value;
+				t = b2MulSV( maxFraction, input->translation );
+				totalAABB.lowerBound = b2Min( originAABB.lowerBound, b2Add( originAABB.lowerBound, t ) );
+				totalAABB.upperBound = b2Max( originAABB.upperBound, b2Add( originAABB.upperBound, t ) );
+			}
+		}
+
+		// Push internal children far to near so the nearest is visited first
+		for ( int i = count - 1; i >= 0; --i )
+		{
+			int lane = lanes[i];
+			if ( node->leafMask & ( 1u << lane ) )
+			{
+				continue;
+			}
+
+			if ( stackCount < B2_TREE_STACK_SIZE )
+			{
+				stack[stackCount++] = node->children[lane];
+			}
+			else
+			{
+				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE );
+			}
+		}
+	}
+
+	return stats;
+}
+
+b2TreeStats b2DynamicTree_Query( const b2DynamicTree* tree, b2AABB aabb, uint64_t maskBits, b2TreeQueryCallbackFcn* callback,
+								 void* context )
+{
+	b2TreeStats result = { 0 };
+
+	if ( tree->nodeCount == 0 )
+	{
+		return result;
+	}
+
+	if ( tree->wideNodeCount > 0 )
+	{
+		bool useMaskBits = true;
+		return b2QueryWide( tree, aabb, maskBits, useMaskBits, callback, context );
+	}
+
+	int stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = tree->root;
+
+	while ( stackCount > 0 )
+	{
+		int nodeId = stack[--stackCount];
+
+		const b2TreeNode* node = tree->nodes + nodeId;
+		result.nodeVisits += 1;
+
+		if ( b2AABB_Overlaps( node->aabb, aabb ) && ( node->categoryBits & maskBits ) != 0 )
+		{
+			if ( b2IsLeaf( node ) )
+			{
+				// callback to user code with proxy id
+				bool proceed = callback( nodeId, tree->nodeData[nodeId].userData, context );
+				result.leafVisits += 1;
+
+				if ( proceed == false )
+				{
+					return result;
+				}
+			}
+			else
+			{
+				if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+				{
+					stack[stackCount++] = node->children.child1;
+					stack[stackCount++] = node->children.child2;
+				}
+				else
+				{
+					B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+b2TreeStats b2DynamicTree_QueryAll( const b2DynamicTree* tree, b2AABB aabb, b2TreeQueryCallbackFcn* callback, void* context )
+{
+	b2TreeStats result = { 0 };
+
+	if ( tree->nodeCount == 0 )
+	{
+		return result;
+	}
+
+	if ( tree->wideNodeCount > 0 )
+	{
+		bool useMaskBits = false;
+		return b2QueryWide( tree, aabb, B2_DEFAULT_MASK_BITS, useMaskBits, callback, context );
+	}
+
+	int stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = tree->root;
+
+	while ( stackCount > 0 )
+	{
+		int nodeId = stack[--stackCount];
+
+		const b2TreeNode* node = tree->nodes + nodeId;
+		result.nodeVisits += 1;
+
+		if ( b2AABB_Overlaps( node->aabb, aabb ) )
+		{
+			if ( b2IsLeaf( node ) )
+			{
+				// callback to user code with proxy id
+				bool proceed = callback( nodeId, tree->nodeData[nodeId].userData, context );
+				result.leafVisits += 1;
+
+				if ( proceed == false )
+				{
+					return result;
+				}
+			}
+			else
+			{
+				if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+				{
+					stack[stackCount++] = node->children.child1;
+					stack[stackCount++] = node->children.child2;
+				}
+				else
+				{
+					B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+b2TreeStats b2DynamicTree_RayCast( const b2DynamicTree* tree, const b2RayCastInput* input, uint64_t maskBits,
+								   b2TreeRayCastCallbackFcn* callback, void* context )
+{
+	b2TreeStats result = { 0 };
+
+	if ( tree->nodeCount == 0 )
+	{
+		return result;
+	}
+
+	if ( tree->wideNodeCount > 0 )
+	{
+		return b2RayCastWide( tree, input, maskBits, callback, context );
+	}
+
+	b2Vec2 p1 = input->origin;
+	b2Vec2 d = input->translation;
+
+	b2Vec2 r = b2Normalize( d );
+
+	// v is perpendicular to the segment.
+	b2Vec2 v = b2CrossSV( 1.0f, r );
+	b2Vec2 abs_v = b2Abs( v );
+
+	// Separating axis for segment (Gino, p80).
+	// |dot(v, p1 - c)| > dot(|v|, h)
+
+	float maxFraction = input->maxFraction;
+
+	b2Vec2 p2 = b2MulAdd( p1, maxFraction, d );
+
+	// Build a bounding box for the segment.
+	b2AABB segmentAABB = { b2Min( p1, p2 ), b2Max( p1, p2 ) };
+
+	int stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = tree->root;
+
+	const b2TreeNode* nodes = tree->nodes;
+
+	b2RayCastInput subInput = *input;
+
+	while ( stackCount > 0 )
+	{
+		int nodeId = stack[--stackCount];
+		if ( nodeId == B2_NULL_INDEX )
+		{
+			// todo is this possible?
+			B2_ASSERT( false );
+			continue;
+		}
+
+		const b2TreeNode* node = nodes + nodeId;
+		result.nodeVisits += 1;
+
+		b2AABB nodeAABB = node->aabb;
+
+		if ( ( node->categoryBits & maskBits ) == 0 || b2AABB_Overlaps( nodeAABB, segmentAABB ) == false )
+		{
+			continue;
+		}
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		// radius extension is added to the node in this case
+		b2Vec2 c = b2AABB_Center( nodeAABB );
+		b2Vec2 h = b2AABB_Extents( nodeAABB );
+		float term1 = b2AbsFloat( b2Dot( v, b2Sub( p1, c ) ) );
+		float term2 = b2Dot( abs_v, h );
+		if ( term2 < term1 )
+		{
+			continue;
+		}
+
+		if ( b2IsLeaf( node ) )
+		{
+			subInput.maxFraction = maxFraction;
+
+			float value = callback( &subInput, nodeId, tree->nodeData[nodeId].userData, context );
+			result.leafVisits += 1;
+
+			// The user may return -1 to indicate this shape should be skipped
+
+			if ( value == 0.0f )
+			{
+				// The client has terminated the ray cast.
+				return result;
+			}
+
+			if ( 0.0f < value && value <= maxFraction )
+			{
+				// Update segment bounding box.
+				maxFraction = value;
+				p2 = b2MulAdd( p1, maxFraction, d );
+				segmentAABB.lowerBound = b2Min( p1, p2 );
+				segmentAABB.upperBound = b2Max( p1, p2 );
+			}
+		}
+		else
+		{
+			if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+			{
+				b2Vec2 c1 = b2AABB_Center( nodes[node->children.child1].aabb );
+				b2Vec2 c2 = b2AABB_Center( nodes[node->children.child2].aabb );
+				if ( b2DistanceSquared( c1, p1 ) < b2DistanceSquared( c2, p1 ) )
+				{
+					stack[stackCount++] = node->children.child2;
+					stack[stackCount++] = node->children.child1;
+				}
+				else
+				{
+					stack[stackCount++] = node->children.child1;
+					stack[stackCount++] = node->children.child2;
+				}
+			}
+			else
+			{
+				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+			}
+		}
+	}
+
+	return result;
+}
+
+_Static_assert( B2_RAY_PACKET_SIZE % B2_SIMD_WIDTH == 0, "ray packet must hold a whole number of SIMD lanes" );
+
+// Ray packet in SoA form so a node can be tested against all rays of the packet with SIMD.
+// Each lane holds the segment bounding box and the perpendicular separating axis of one ray.
+// Unused and finished lanes get an inverted bounding box so they never overlap a node.
+typedef struct b2RayPacket
+{
+	float originX[B2_RAY_PACKET_SIZE];
+	float originY[B2_RAY_PACKET_SIZE];
+	float perpX[B2_RAY_PACKET_SIZE];
+	float perpY[B2_RAY_PACKET_SIZE];
+	float absPerpX[B2_RAY_PACKET_SIZE];
+	float absPerpY[B2_RAY_PACKET_SIZE];
+	float lowerX[B2_RAY_PACKET_SIZE];
+	float lowerY[B2_RAY_PACKET_SIZE];
+	float upperX[B2_RAY_PACKET_SIZE];
+	float upperY[B2_RAY_PACKET_SIZE];
+} b2RayPacket;
+
+static void b2SetPacketSegment( b2RayPacket* packet, int lane, const b2RayCastInput* input, float maxFraction )
+{
+	b2Vec2 p1 = input->origin;
+	b2Vec2 p2 = b2MulAdd( p1, maxFraction, input->translation );
+	packet->lowerX[lane] = b2MinFloat( p1.x, p2.x );
+	packet->lowerY[lane] = b2MinFloat( p1.y, p2.y );
+	packet->upperX[lane] = b2MaxFloat( p1.x, p2.x );
+	packet->upperY[lane] = b2MaxFloat( p1.y, p2.y );
+}
+
+static void b2DisablePacketLane( b2RayPacket* packet, int lane )
+{
+	packet->lowerX[lane] = FLT_MAX;
+	packet->lowerY[lane] = FLT_MAX;
+	packet->upperX[lane] = -FLT_MAX;
+	packet->upperY[lane] = -FLT_MAX;
+}
+
+// Returns a bit mask of the lanes that overlap the box. This is the same test used by
+// b2DynamicTree_RayCast: segment bounding box overlap and the segment separating axis.
+// |dot(v, p1 - c)| > dot(|v|, h)
+static uint32_t b2RayPacketOverlaps( const b2RayPacket* packet, int laneCount, b2AABB box )
+{
+	b2Vec2 c = b2AABB_Center( box );
+	b2Vec2 h = b2AABB_Extents( box );
+	uint32_t mask = 0;
+
+#if defined( B2_SIMD_AVX2 )
+	__m256 boxLowerX = _mm256_set1_ps( box.lowerBound.x );
+	__m256 boxLowerY = _mm256_set1_ps( box.lowerBound.y );
+	__m256 boxUpperX = _mm256_set1_ps( box.upperBound.x );
+	__m256 boxUpperY = _mm256_set1_ps( box.upperBound.y );
+	__m256 cx = _mm256_set1_ps( c.x );
+	__m256 cy = _mm256_set1_ps( c.y );
+	__m256 hx = _mm256_set1_ps( h.x );
+	__m256 hy = _mm256_set1_ps( h.y );
+	__m256 signBit = _mm256_set1_ps( -0.0f );
+
+	for ( int base = 0; base < laneCount; base += 8 )
+	{
+		__m256 overlap = _mm256_cmp_ps( _mm256_loadu_ps( packet->lowerX + base ), boxUpperX, _CMP_LE_OQ );
+		overlap = _mm256_and_ps( overlap, _mm256_cmp_ps( _mm256_loadu_ps( packet->lowerY + base ), boxUpperY, _CMP_LE_OQ ) );
+		overlap = _mm256_and_ps( overlap, _mm256_cmp_ps( boxLowerX, _mm256_loadu_ps( packet->upperX + base ), _CMP_LE_OQ ) );
+		overlap = _mm256_and_ps( overlap, _mm256_cmp_ps( boxLowerY, _mm256_loadu_ps( packet->upperY + base ), _CMP_LE_OQ ) );
+
+		__m256 dx = _mm256_sub_ps( _mm256_loadu_ps( packet->originX + base ), cx );
+		__m256 dy = _mm256_sub_ps( _mm256_loadu_ps( packet->originY + base ), cy );
+		__m256 term1 = _mm256_add_ps( _mm256_mul_ps( _mm256_loadu_ps( packet->perpX + base ), dx ),
+									  _mm256_mul_ps( _mm256_loadu_ps( packet->perpY + base ), dy ) );
+		term1 = _mm256_andnot_ps( signBit, term1 );
+		__m256 term2 = _mm256_add_ps( _mm256_mul_ps( _mm256_loadu_ps( packet->absPerpX + base ), hx ),
+									  _mm256_mul_ps( _mm256_loadu_ps( packet->absPerpY + base ), hy ) );
+		overlap = _mm256_and_ps( overlap, _mm256_cmp_ps( term1, term2, _CMP_LE_OQ ) );
+
+		mask |= (uint32_t)_mm256_movemask_ps( overlap ) << base;
+	}
+#elif defined( B2_SIMD_NEON )
+	float32x4_t boxLowerX = vdupq_n_f32( box.lowerBound.x );
+	float32x4_t boxLowerY = vdupq_n_f32( box.lowerBound.y );
+	float32x4_t boxUpperX = vdupq_n_f32( box.upperBound.x );
+	float32x4_t boxUpperY = vdupq_n_f32( box.upperBound.y );
+	float32x4_t cx = vdupq_n_f32( c.x );
+	float32x4_t cy = vdupq_n_f32( c.y );
+	float32x4_t hx = vdupq_n_f32( h.x );
+	float32x4_t hy = vdupq_n_f32( h.y );
+	static const uint32_t laneBits[4] = { 1, 2, 4, 8 };
+	uint32x4_t bits = vld1q_u32( laneBits );
+
+	for ( int base = 0; base < laneCount; base += 4 )
+	{
+		uint32x4_t overlap = vcleq_f32( vld1q_f32( packet->lowerX + base ), boxUpperX );
+		overlap = vandq_u32( overlap, vcleq_f32( vld1q_f32( packet->lowerY + base ), boxUpperY ) );
+		overlap = vandq_u32( overlap, vcleq_f32( boxLowerX, vld1q_f32( packet->upperX + base ) ) );
+		overlap = vandq_u32( overlap, vcleq_f32( boxLowerY, vld1q_f32( packet->upperY + base ) ) );
+
+		float32x4_t dx = vsubq_f32( vld1q_f32( packet->originX + base ), cx );
+		float32x4_t dy = vsubq_f32( vld1q_f32( packet->originY + base ), cy );
+		float32x4_t term1 =
+			vaddq_f32( vmulq_f32( vld1q_f32( packet->perpX + base ), dx ), vmulq_f32( vld1q_f32( packet->perpY + base ), dy ) );
+		term1 = vabsq_f32( term1 );
+		float32x4_t term2 = vaddq_f32( vmulq_f32( vld1q_f32( packet->absPerpX + base ), hx ),
+									   vmulq_f32( vld1q_f32( packet->absPerpY + base ), hy ) );
+		overlap = vandq_u32( overlap, vcleq_f32( term1, term2 ) );
+
+		uint32x4_t laneMask = vandq_u32( overlap, bits );
+#if defined( _M_ARM64 ) || defined( __aarch64__ )
+		mask |= vaddvq_u32( laneMask ) << base;
+#else
+		uint32_t sum = vgetq_lane_u32( laneMask, 0 ) | vgetq_lane_u32( laneMask, 1 ) | vgetq_lane_u32( laneMask, 2 ) |
+					   vgetq_lane_u32( laneMask, 3 );
+		mask |= sum << base;
+#endif
+	}
+#elif defined( B2_SIMD_SSE2 )
+	__m128 boxLowerX = _mm_set1_ps( box.lowerBound.x );
+	__m128 boxLowerY = _mm_set1_ps( box.lowerBound.y );
+	__m128 boxUpperX = _mm_set1_ps( box.upperBound.x );
+	__m128 boxUpperY = _mm_set1_ps( box.upperBound.y );
+	__m128 cx = _mm_set1_ps( c.x );
+	__m128 cy = _mm_set1_ps( c.y );
+	__m128 hx = _mm_set1_ps( h.x );
+	__m128 hy = _mm_set1_ps( h.y );
+	__m128 signBit = _mm_set1_ps( -0.0f );
+
+	for ( int base = 0; base < laneCount; base += 4 )
+	{
+		__m128 overlap = _mm_cmple_ps( _mm_loadu_ps( packet->lowerX + base ), boxUpperX );
+		overlap = _mm_and_ps( overlap, _mm_cmple_ps( _mm_loadu_ps( packet->lowerY + base ), boxUpperY ) );
+		overlap = _mm_and_ps( overlap, _mm_cmple_ps( boxLowerX, _mm_loadu_ps( packet->upperX + base ) ) );
+		overlap = _mm_and_ps( overlap, _mm_cmple_ps( boxLowerY, _mm_loadu_ps( packet->upperY + base ) ) );
+
+		__m128 dx = _mm_sub_ps( _mm_loadu_ps( packet->originX + base ), cx );
+		__m128 dy = _mm_sub_ps( _mm_loadu_ps( packet->originY + base ), cy );
+		__m128 term1 =
+			_mm_add_ps( _mm_mul_ps( _mm_loadu_ps( packet->perpX + base ), dx ), _mm_mul_ps( _mm_loadu_ps( packet->perpY + base ), dy ) );
+		term1 = _mm_andnot_ps( signBit, term1 );
+		__m128 term2 = _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( packet->absPerpX + base ), hx ),
+								   _mm_mul_ps( _mm_loadu_ps( packet->absPerpY + base ), hy ) );
+		overlap = _mm_and_ps( overlap, _mm_cmple_ps( term1, term2 ) );
+
+		mask |= (uint32_t)_mm_movemask_ps( overlap ) << base;
+	}
+#else
+	for ( int lane = 0; lane < laneCount; ++lane )
+	{
+		if ( packet->lowerX[lane] > box.upperBound.x || packet->lowerY[lane] > box.upperBound.y ||
+			 box.lowerBound.x > packet->upperX[lane] || box.lowerBound.y > packet->upperY[lane] )
+		{
+			continue;
+		}
+
+		float term1 = b2AbsFloat( packet->perpX[lane] * ( packet->originX[lane] - c.x ) +
+								  packet->perpY[lane] * ( packet->originY[lane] - c.y ) );
+		float term2 = packet->absPerpX[lane] * h.x + packet->absPerpY[lane] * h.y;
+		if ( term2 < term1 )
+		{
+			continue;
+		}
+
+		mask |= 1u << lane;
+	}
+#endif
+
+	return mask;
+}
+
+b2TreeStats b2DynamicTree_RayCastPacket( const b2DynamicTree* tree, const b2RayCastInput* inputs, int rayCount,
+										 uint64_t maskBits, b2TreeRayCastPacketCallbackFcn* callback, void* context )
+{
+	b2TreeStats result = { 0 };
+
+	B2_ASSERT( 0 <= rayCount && rayCount <= B2_RAY_PACKET_SIZE );
+	if ( tree->nodeCount == 0 || rayCount <= 0 )
+	{
+		return result;
+	}
+
+	rayCount = b2MinInt( rayCount, B2_RAY_PACKET_SIZE );
+
+	// Round up to whole SIMD lanes. The padding lanes stay disabled.
+	int laneCount = ( ( rayCount + B2_SIMD_WIDTH - 1 ) / B2_SIMD_WIDTH ) * B2_SIMD_WIDTH;
+
+	b2RayPacket packet;
+	float maxFractions[B2_RAY_PACKET_SIZE];
+	uint32_t activeMask = 0;
+
+	// Children are ordered using the packet centroid. This works well for coherent rays.
+	b2Vec2 centroid = b2Vec2_zero;
+
+	for ( int lane = 0; lane < laneCount; ++lane )
+	{
+		if ( lane >= rayCount )
+		{
+			packet.originX[lane] = 0.0f;
+			packet.originY[lane] = 0.0f;
+			packet.perpX[lane] = 0.0f;
+			packet.perpY[lane] = 0.0f;
+			packet.absPerpX[lane] = 0.0f;
+			packet.absPerpY[lane] = 0.0f;
+			b2DisablePacketLane( &packet, lane );
+			continue;
+		}
+
+		const b2RayCastInput* input = inputs + lane;
+		b2Vec2 r = b2Normalize( input->translation );
+
+		// v is perpendicular to the segment.
+		b2Vec2 v = b2CrossSV( 1.0f, r );
+
+		packet.originX[lane] = input->origin.x;
+		packet.originY[lane] = input->origin.y;
+		packet.perpX[lane] = v.x;
+		packet.perpY[lane] = v.y;
+		packet.absPerpX[lane] = b2AbsFloat( v.x );
+		packet.absPerpY[lane] = b2AbsFloat( v.y );
+
+		maxFractions[lane] = input->maxFraction;
+		b2SetPacketSegment( &packet, lane, input, input->maxFraction );
+		activeMask |= 1u << lane;
+
+		centroid = b2Add( centroid, input->origin );
+	}
+
+	centroid = b2MulSV( 1.0f / (float)rayCount, centroid );
+
+	int stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = tree->root;
+
+	const b2TreeNode* nodes = tree->nodes;
+
+	while ( stackCount > 0 )
+	{
+		int nodeId = stack[--stackCount];
+		if ( nodeId == B2_NULL_INDEX )
+		{
+			B2_ASSERT( false );
+			continue;
+		}
+
+		const b2TreeNode* node = nodes + nodeId;
+		result.nodeVisits += 1;
+
+		if ( ( node->categoryBits & maskBits ) == 0 )
+		{
+			continue;
+		}
+
+		uint32_t hitMask = b2RayPacketOverlaps( &packet, laneCount, node->aabb );
+		if ( hitMask == 0 )
+		{
+			continue;
+		}
+
+		if ( b2IsLeaf( node ) )
+		{
+			while ( hitMask != 0 )
+			{
+				int lane = (int)b2CTZ32( hitMask );
+				hitMask &= hitMask - 1;
+
+				b2RayCastInput subInput = inputs[lane];
+				subInput.maxFraction = maxFractions[lane];
+
+				float value = callback( &subInput, lane, nodeId, tree->nodeData[nodeId].userData, context );
+				result.leafVisits += 1;
+
+				// The user may return -1 to indicate this shape should be skipped
+
+				if ( value == 0.0f )
+				{
+					// The client has terminated the ray cast for this ray.
+					b2DisablePacketLane( &packet, lane );
+					activeMask &= ~( 1u << lane );
+				}
+				else if ( 0.0f < value && value <= maxFractions[lane] )
+				{
+					// Update segment bounding box.
+					maxFractions[lane] = value;
+					b2SetPacketSegment( &packet, lane, inputs + lane, value );
+				}
+			}
+
+			if ( activeMask == 0 )
+			{
+				return result;
+			}
+		}
+		else
+		{
+			if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+			{
+				b2Vec2 c1 = b2AABB_Center( nodes[node->children.child1].aabb );
+				b2Vec2 c2 = b2AABB_Center( nodes[node->children.child2].aabb );
+				if ( b2DistanceSquared( c1, centroid ) < b2DistanceSquared( c2, centroid ) )
+				{
+					stack[stackCount++] = node->children.child2;
+					stack[stackCount++] = node->children.child1;
+				}
+				else
+				{
+					stack[stackCount++] = node->children.child1;
+					stack[stackCount++] = node->children.child2;
+				}
+			}
+			else
+			{
+				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+			}
+		}
+	}
+
+	return result;
+}
+
+b2TreeStats b2DynamicTree_ShapeCast( const b2DynamicTree* tree, const b2ShapeCastInput* input, uint64_t maskBits,
+									 b2TreeShapeCastCallbackFcn* callback, void* context )
+{
+	b2TreeStats stats = { 0 };
+
+	if ( tree->nodeCount == 0 || input->proxy.count == 0 )
+	{
+		return stats;
+	}
+
+	if ( tree->wideNodeCount > 0 )
+	{
+		return b2ShapeCastWide( tree, input, maskBits, callback, context );
+	}
+
+	b2AABB originAABB = { input->proxy.points[0], input->proxy.points[0] };
+	for ( int i = 1; i < input->proxy.count; ++i )
+	{
+		originAABB.lowerBound = b2Min( originAABB.lowerBound, input->proxy.points[i] );
+		originAABB.upperBound = b2Max( originAABB.upperBound, input->proxy.points[i] );
+	}
+
+	b2Vec2 radius = { input->proxy.radius, input->proxy.radius };
+
+	originAABB.lowerBound = b2Sub( originAABB.lowerBound, radius );
+	originAABB.upperBound = b2Add( originAABB.upperBound, radius );
+
+	b2Vec2 p1 = b2AABB_Center( originAABB );
+	b2Vec2 extension = b2AABB_Extents( originAABB );
+
+	// v is perpendicular to the segment.
+	b2Vec2 r = input->translation;
+	b2Vec2 v = b2CrossSV( 1.0f, r );
+	b2Vec2 abs_v = b2Abs( v );
+
+	// Separating axis for segment (Gino, p80).
+	// |dot(v, p1 - c)| > dot(|v|, h)
+
+	float maxFraction = input->maxFraction;
+
+	// Build total box for the shape cast
+	b2Vec2 t = b2MulSV( maxFraction, input->translation );
+	b2AABB totalAABB = {
+		b2Min( originAABB.lowerBound, b2Add( originAABB.lowerBound, t ) ),
+		b2Max( originAABB.upperBound, b2Add( originAABB.upperBound, t ) ),
+	};
+
+	b2ShapeCastInput subInput = *input;
+	const b2TreeNode* nodes = tree->nodes;
+
+	int stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = tree->root;
+
+	while ( stackCount > 0 )
+	{
+		int nodeId = stack[--stackCount];
+		if ( nodeId == B2_NULL_INDEX )
+		{
+			// todo is this possible?
+			B2_ASSERT( false );
+			continue;
+		}
+
+		const b2TreeNode* node = nodes + nodeId;
+		stats.nodeVisits += 1;
+
+		if ( ( node->categoryBits & maskBits ) == 0 || b2AABB_Overlaps( node->aabb, totalAABB ) == false )
+		{
+			continue;
+		}
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		// radius extension is added to the node in this case
+		b2Vec2 c = b2AABB_Center( node->aabb );
+		b2Vec2 h = b2Add( b2AABB_Extents( node->aabb ), extension );
+		float term1 = b2AbsFloat( b2Dot( v, b2Sub( p1, c ) ) );
+		float term2 = b2Dot( abs_v, h );
+		if ( term2 < term1 )
 		{
 			continue;
 		}
@@ -1391,7 +2387,7 @@ b2TreeStats b2DynamicTree_ShapeCast( const b2DynamicTree* tree, const b2ShapeCas
 		{
 			subInput.maxFraction = maxFraction;
 
-			float value = callback( &subInput, nodeId, node->userData, context );
+			float value = callback( &subInput, nodeId, tree->nodeData[nodeId].userData, context );
 			stats.leafVisits += 1;
 
 			if ( value == 0.0f )
@@ -1731,38 +2727,43 @@ struct b2RebuildItem
 	int endIndex;
 };
 
-// Returns root node index
-static int b2BuildTree( b2DynamicTree* tree, int leafCount )
+// Partition the leaves [startIndex, startIndex + count). Returns the split index.
+static int b2PartitionLeaves( b2DynamicTree* tree, int startIndex, int count )
+{
+#if B2_TREE_HEURISTIC == 0
+	return startIndex + b2PartitionMid( tree->leafIndices + startIndex, tree->leafCenters + startIndex, count );
+#else
+	return startIndex +
+		   b2PartitionSAH( tree->leafIndices + startIndex, tree->binIndices + startIndex, tree->leafBoxes + startIndex, count );
+#endif
+}
+
+// Builds a tree over the leaves [startIndex, startIndex + leafCount) and returns the root node index.
+// Internal nodes are allocated in depth first order. If nodeIndices is not null the internal nodes
+// are taken from it in the same order instead. This lets subtrees be built independently.
+static int b2BuildTree( b2DynamicTree* tree, int startIndex, int leafCount, const int* nodeIndices )
 {
 	b2TreeNode* nodes = tree->nodes;
+	b2TreeNodeData* data = tree->nodeData;
 	int* leafIndices = tree->leafIndices;
 
 	if ( leafCount == 1 )
 	{
-		nodes[leafIndices[0]].parent = B2_NULL_INDEX;
-		return leafIndices[0];
+		data[leafIndices[startIndex]].parent = B2_NULL_INDEX;
+		return leafIndices[startIndex];
 	}
 
-#if B2_TREE_HEURISTIC == 0
-	b2Vec2* leafCenters = tree->leafCenters;
-#else
-	b2AABB* leafBoxes = tree->leafBoxes;
-	int* binIndices = tree->binIndices;
-#endif
+	int nodeCursor = 0;
 
 	// todo large stack item
 	struct b2RebuildItem stack[B2_TREE_STACK_SIZE];
 	int top = 0;
 
-	stack[0].nodeIndex = b2AllocateNode( tree );
+	stack[0].nodeIndex = nodeIndices != NULL ? nodeIndices[nodeCursor++] : b2AllocateNode( tree );
 	stack[0].childCount = -1;
-	stack[0].startIndex = 0;
-	stack[0].endIndex = leafCount;
-#if B2_TREE_HEURISTIC == 0
-	stack[0].splitIndex = b2PartitionMid( leafIndices, leafCenters, leafCount );
-#else
-	stack[0].splitIndex = b2PartitionSAH( leafIndices, binIndices, leafBoxes, leafCount );
-#endif
+	stack[0].startIndex = startIndex;
+	stack[0].endIndex = startIndex + leafCount;
+	stack[0].splitIndex = b2PartitionLeaves( tree, startIndex, leafCount );
 
 	while ( true )
 	{
@@ -1795,43 +2796,44 @@ static int b2BuildTree( b2DynamicTree* tree, int leafCount )
 				parentNode->children.child2 = item->nodeIndex;
 			}
 
-			b2TreeNode* node = nodes + item->nodeIndex;
+			int nodeIndex = item->nodeIndex;
+			b2TreeNode* node = nodes + nodeIndex;
 
-			B2_ASSERT( node->parent == B2_NULL_INDEX );
-			node->parent = parentItem->nodeIndex;
+			B2_ASSERT( data[nodeIndex].parent == B2_NULL_INDEX );
+			data[nodeIndex].parent = parentItem->nodeIndex;
 
-			B2_ASSERT( node->children.child1 != B2_NULL_INDEX );
-			B2_ASSERT( node->children.child2 != B2_NULL_INDEX );
-			b2TreeNode* child1 = nodes + node->children.child1;
-			b2TreeNode* child2 = nodes + node->children.child2;
+			int child1 = node->children.child1;
+			int child2 = node->children.child2;
+			B2_ASSERT( child1 != B2_NULL_INDEX );
+			B2_ASSERT( child2 != B2_NULL_INDEX );
 
-			node->aabb = b2AABB_Union( child1->aabb, child2->aabb );
-			node->height = 1 + b2MaxUInt16( child1->height, child2->height );
-			node->categoryBits = child1->categoryBits | child2->categoryBits;
+			node->aabb = b2AABB_Union( nodes[child1].aabb, nodes[child2].aabb );
+			data[nodeIndex].height = 1 + b2MaxUInt16( data[child1].height, data[child2].height );
+			node->categoryBits = nodes[child1].categoryBits | nodes[child2].categoryBits;
 
 			// Pop stack
 			top -= 1;
 		}
 		else
 		{
-			int startIndex, endIndex;
+			int childStart, childEnd;
 			if ( item->childCount == 0 )
 			{
-				startIndex = item->startIndex;
-				endIndex = item->splitIndex;
+				childStart = item->startIndex;
+				childEnd = item->splitIndex;
 			}
 			else
 			{
 				B2_ASSERT( item->childCount == 1 );
-				startIndex = item->splitIndex;
-				endIndex = item->endIndex;
+				childStart = item->splitIndex;
+				childEnd = item->endIndex;
 			}
 
-			int count = endIndex - startIndex;
+			int count = childEnd - childStart;
 
 			if ( count == 1 )
 			{
-				int childIndex = leafIndices[startIndex];
+				int childIndex = leafIndices[childStart];
 				b2TreeNode* node = nodes + item->nodeIndex;
 
 				if ( item->childCount == 0 )
@@ -1846,9 +2848,9 @@ static int b2BuildTree( b2DynamicTree* tree, int leafCount )
 					node->children.child2 = childIndex;
 				}
 
-				b2TreeNode* childNode = nodes + childIndex;
-				B2_ASSERT( childNode->parent == B2_NULL_INDEX );
-				childNode->parent = item->nodeIndex;
+				b2TreeNodeData* childData = data + childIndex;
+				B2_ASSERT( childData->parent == B2_NULL_INDEX );
+				childData->parent = item->nodeIndex;
 			}
 			else
 			{
@@ -1857,44 +2859,38 @@ static int b2BuildTree( b2DynamicTree* tree, int leafCount )
 
 				top += 1;
 				struct b2RebuildItem* newItem = stack + top;
-				newItem->nodeIndex = b2AllocateNode( tree );
+				newItem->nodeIndex = nodeIndices != NULL ? nodeIndices[nodeCursor++] : b2AllocateNode( tree );
 				newItem->childCount = -1;
-				newItem->startIndex = startIndex;
-				newItem->endIndex = endIndex;
-#if B2_TREE_HEURISTIC == 0
-				newItem->splitIndex = b2PartitionMid( leafIndices + startIndex, leafCenters + startIndex, count );
-#else
-				newItem->splitIndex =
-					b2PartitionSAH( leafIndices + startIndex, binIndices + startIndex, leafBoxes + startIndex, count );
-#endif
-				newItem->splitIndex += startIndex;
+				newItem->startIndex = childStart;
+				newItem->endIndex = childEnd;
+				newItem->splitIndex = b2PartitionLeaves( tree, childStart, count );
 			}
 		}
 	}
 
-	b2TreeNode* rootNode = nodes + stack[0].nodeIndex;
-	B2_ASSERT( rootNode->parent == B2_NULL_INDEX );
+	B2_ASSERT( nodeIndices == NULL || nodeCursor == leafCount - 1 );
+
+	int rootIndex = stack[0].nodeIndex;
+	b2TreeNode* rootNode = nodes + rootIndex;
+	B2_ASSERT( data[rootIndex].parent == B2_NULL_INDEX );
 	B2_ASSERT( rootNode->children.child1 != B2_NULL_INDEX );
 	B2_ASSERT( rootNode->children.child2 != B2_NULL_INDEX );
 
-	b2TreeNode* child1 = nodes + rootNode->children.child1;
-	b2TreeNode* child2 = nodes + rootNode->children.child2;
+	int child1 = rootNode->children.child1;
+	int child2 = rootNode->children.child2;
 
-	rootNode->aabb = b2AABB_Union( child1->aabb, child2->aabb );
-	rootNode->height = 1 + b2MaxUInt16( child1->height, child2->height );
-	rootNode->categoryBits = child1->categoryBits | child2->categoryBits;
+	rootNode->aabb = b2AABB_Union( nodes[child1].aabb, nodes[child2].aabb );
+	data[rootIndex].height = 1 + b2MaxUInt16( data[child1].height, data[child2].height );
+	rootNode->categoryBits = nodes[child1].categoryBits | nodes[child2].categoryBits;
 
-	return stack[0].nodeIndex;
+	return rootIndex;
 }
 
-// Not safe to access tree during this operation because it may grow
-int b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild )
+// Gather the leaves of a rebuild into the rebuild arrays and free the internal nodes being rebuilt.
+// Returns the number of leaves.
+static int b2CollectLeaves( b2DynamicTree* tree, bool fullBuild )
 {
 	int proxyCount = tree->proxyCount;
-	if ( proxyCount == 0 )
-	{
-		return 0;
-	}
 
 	// Ensure capacity for rebuild space
 	if ( proxyCount > tree->rebuildCapacity )
@@ -1922,6 +2918,7 @@ int b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild )
 
 	int nodeIndex = tree->root;
 	b2TreeNode* nodes = tree->nodes;
+	b2TreeNodeData* data = tree->nodeData;
 	b2TreeNode* node = nodes + nodeIndex;
 
 	// These are the nodes that get sorted to rebuild the tree.
@@ -1941,7 +2938,7 @@ int b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild )
 	// this should be weighed against B2_AABB_MARGIN
 	while ( true )
 	{
-		if ( node->height == 0 || ( ( node->flags & b2_enlargedNode ) == 0 && fullBuild == false ) )
+		if ( b2IsLeaf( node ) || ( ( data[nodeIndex].flags & b2_enlargedNode ) == 0 && fullBuild == false ) )
 		{
 			leafIndices[leafCount] = nodeIndex;
 #if B2_TREE_HEURISTIC == 0
@@ -1952,7 +2949,7 @@ int b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild )
 			leafCount += 1;
 
 			// Detach
-			node->parent = B2_NULL_INDEX;
+			data[nodeIndex].parent = B2_NULL_INDEX;
 		}
 		else
 		{
@@ -1991,18 +2988,251 @@ int b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild )
 	int capacity = tree->nodeCapacity;
 	for ( int i = 0; i < capacity; ++i )
 	{
-		if ( nodes[i].flags & b2_allocatedNode )
+		if ( data[i].flags & b2_allocatedNode )
 		{
-			B2_ASSERT( ( nodes[i].flags & b2_enlargedNode ) == 0 );
+			B2_ASSERT( ( data[i].flags & b2_enlargedNode ) == 0 );
 		}
 	}
 #endif
 
 	B2_ASSERT( leafCount <= proxyCount );
 
-	tree->root = b2BuildTree( tree, leafCount );
+	return leafCount;
+}
+
+// Not safe to access tree during this operation because it may grow
+int b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild )
+{
+	tree->wideNodeCount = 0;
+
+	if ( tree->proxyCount == 0 )
+	{
+		return 0;
+	}
+
+	int leafCount = b2CollectLeaves( tree, fullBuild );
+
+	tree->root = b2BuildTree( tree, 0, leafCount, NULL );
 
 	b2DynamicTree_Validate( tree );
 
 	return leafCount;
 }
+
+b2TreeRebuild b2DynamicTree_BeginRebuild( b2DynamicTree* tree, bool fullBuild, int subtreeLeafCount )
+{
+	B2_ASSERT( subtreeLeafCount >= 2 );
+
+	b2TreeRebuild rebuild = { 0 };
+	rebuild.tree = tree;
+	rebuild.rootIndex = B2_NULL_INDEX;
+
+	tree->wideNodeCount = 0;
+
+	if ( tree->proxyCount == 0 )
+	{
+		return rebuild;
+	}
+
+	int leafCount = b2CollectLeaves( tree, fullBuild );
+	rebuild.leafCount = leafCount;
+
+	int* leafIndices = tree->leafIndices;
+	if ( leafCount == 1 )
+	{
+		rebuild.rootIndex = leafIndices[0];
+		tree->nodeData[rebuild.rootIndex].parent = B2_NULL_INDEX;
+		return rebuild;
+	}
+
+	// Reserve the internal nodes in the order b2BuildTree allocates them. The free list is consumed
+	// in the same order, so the parallel build uses exactly the nodes of the serial build.
+	int internalCount = leafCount - 1;
+	rebuild.nodeIndices = b2Alloc( internalCount * sizeof( int ) );
+	rebuild.topNodes = b2Alloc( internalCount * sizeof( int ) );
+	rebuild.subtrees = b2Alloc( leafCount * sizeof( b2TreeSubtree ) );
+
+	for ( int i = 0; i < internalCount; ++i )
+	{
+		rebuild.nodeIndices[i] = b2AllocateNode( tree );
+	}
+
+	if ( leafCount <= subtreeLeafCount )
+	{
+		rebuild.subtrees[0] = (b2TreeSubtree){ 0, leafCount, 0, B2_NULL_INDEX, B2_NULL_INDEX };
+		rebuild.subtreeCount = 1;
+		rebuild.rootIndex = rebuild.nodeIndices[0];
+		return rebuild;
+	}
+
+	// Build the top of the tree like b2BuildTree. Child ranges that are small enough become subtrees
+	// that skip ahead in the node order by the number of internal nodes they need. The node bounds are
+	// computed in b2DynamicTree_EndRebuild once the subtrees are built.
+	b2TreeNode* nodes = tree->nodes;
+	b2TreeNodeData* data = tree->nodeData;
+	const int* nodeIndices = rebuild.nodeIndices;
+	int nodeCursor = 0;
+
+	struct b2RebuildItem stack[B2_TREE_STACK_SIZE];
+	int top = 0;
+
+	stack[0].nodeIndex = nodeIndices[nodeCursor++];
+	stack[0].childCount = -1;
+	stack[0].startIndex = 0;
+	stack[0].endIndex = leafCount;
+	stack[0].splitIndex = b2PartitionLeaves( tree, 0, leafCount );
+	rebuild.topNodes[rebuild.topNodeCount++] = stack[0].nodeIndex;
+
+	while ( true )
+	{
+		struct b2RebuildItem* item = stack + top;
+
+		item->childCount += 1;
+
+		if ( item->childCount == 2 )
+		{
+			if ( top == 0 )
+			{
+				break;
+			}
+
+			struct b2RebuildItem* parentItem = stack + ( top - 1 );
+			b2TreeNode* parentNode = nodes + parentItem->nodeIndex;
+
+			if ( parentItem->childCount == 0 )
+			{
+				parentNode->children.child1 = item->nodeIndex;
+			}
+			else
+			{
+				parentNode->children.child2 = item->nodeIndex;
+			}
+
+			data[item->nodeIndex].parent = parentItem->nodeIndex;
+
+			top -= 1;
+			continue;
+		}
+
+		int childStart, childEnd;
+		if ( item->childCount == 0 )
+		{
+			childStart = item->startIndex;
+			childEnd = item->splitIndex;
+		}
+		else
+		{
+			childStart = item->splitIndex;
+			childEnd = item->endIndex;
+		}
+
+		int count = childEnd - childStart;
+		int childIndex;
+
+		if ( count == 1 )
+		{
+			childIndex = leafIndices[childStart];
+			data[childIndex].parent = item->nodeIndex;
+		}
+		else if ( count <= subtreeLeafCount )
+		{
+			// The subtree root is the first node it takes
+			childIndex = nodeIndices[nodeCursor];
+			rebuild.subtrees[rebuild.subtreeCount++] = (b2TreeSubtree){
+				.startIndex = childStart,
+				.leafCount = count,
+				.nodeOffset = nodeCursor,
+				.parentIndex = item->nodeIndex,
+				.rootIndex = B2_NULL_INDEX,
+			};
+			nodeCursor += count - 1;
+		}
+		else
+		{
+			B2_ASSERT( top < B2_TREE_STACK_SIZE - 1 );
+
+			top += 1;
+			struct b2RebuildItem* newItem = stack + top;
+			newItem->nodeIndex = nodeIndices[nodeCursor++];
+			newItem->childCount = -1;
+			newItem->startIndex = childStart;
+			newItem->endIndex = childEnd;
+			newItem->splitIndex = b2PartitionLeaves( tree, childStart, count );
+			rebuild.topNodes[rebuild.topNodeCount++] = newItem->nodeIndex;
+			continue;
+		}
+
+		b2TreeNode* node = nodes + item->nodeIndex;
+		if ( item->childCount == 0 )
+		{
+			node->children.child1 = childIndex;
+		}
+		else
+		{
+			node->children.child2 = childIndex;
+		}
+	}
+
+	B2_ASSERT( nodeCursor == internalCount );
+
+	rebuild.rootIndex = stack[0].nodeIndex;
+	return rebuild;
+}
+
+void b2DynamicTree_BuildSubtrees( b2TreeRebuild* rebuild, int startIndex, int endIndex )
+{
+	b2DynamicTree* tree = rebuild->tree;
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2TreeSubtree* subtree = rebuild->subtrees + i;
+		subtree->rootIndex =
+			b2BuildTree( tree, subtree->startIndex, subtree->leafCount, rebuild->nodeIndices + subtree->nodeOffset );
+		B2_ASSERT( subtree->rootIndex == rebuild->nodeIndices[subtree->nodeOffset] );
+	}
+}
+
+int b2DynamicTree_EndRebuild( b2TreeRebuild* rebuild )
+{
+	b2DynamicTree* tree = rebuild->tree;
+	b2TreeNode* nodes = tree->nodes;
+	b2TreeNodeData* data = tree->nodeData;
+
+	for ( int i = 0; i < rebuild->subtreeCount; ++i )
+	{
+		const b2TreeSubtree* subtree = rebuild->subtrees + i;
+		B2_ASSERT( subtree->rootIndex != B2_NULL_INDEX );
+		data[subtree->rootIndex].parent = subtree->parentIndex;
+	}
+
+	// Children come after their parent in build order, so a reverse pass computes the bounds bottom up
+	for ( int i = rebuild->topNodeCount - 1; i >= 0; --i )
+	{
+		int nodeIndex = rebuild->topNodes[i];
+		b2TreeNode* node = nodes + nodeIndex;
+		int child1 = node->children.child1;
+		int child2 = node->children.child2;
+		B2_ASSERT( child1 != B2_NULL_INDEX );
+		B2_ASSERT( child2 != B2_NULL_INDEX );
+
+		node->aabb = b2AABB_Union( nodes[child1].aabb, nodes[child2].aabb );
+		data[nodeIndex].height = 1 + b2MaxUInt16( data[child1].height, data[child2].height );
+		node->categoryBits = nodes[child1].categoryBits | nodes[child2].categoryBits;
+	}
+
+	if ( rebuild->leafCount > 0 )
+	{
+		tree->root = rebuild->rootIndex;
+	}
+
+	int internalCount = b2MaxInt( rebuild->leafCount - 1, 0 );
+	b2Free( rebuild->nodeIndices, internalCount * sizeof( int ) );
+	b2Free( rebuild->topNodes, internalCount * sizeof( int ) );
+	b2Free( rebuild->subtrees, rebuild->leafCount * sizeof( b2TreeSubtree ) );
+	rebuild->nodeIndices = NULL;
+	rebuild->topNodes = NULL;
+	rebuild->subtrees = NULL;
+
+	b2DynamicTree_Validate( tree );
+
+	return rebuild->leafCount;
+}
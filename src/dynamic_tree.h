@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "box2d/collision.h"
+
+// A range of leaves that is built into a subtree on its own
+typedef struct b2TreeSubtree
+{
+	// Leaves in the tree rebuild arrays
+	int startIndex;
+	int leafCount;
+
+	// First reserved internal node used by this subtree
+	int nodeOffset;
+
+	int parentIndex;
+	int rootIndex;
+} b2TreeSubtree;
+
+// State of a tree rebuild that is split into subtrees. The result is identical to b2DynamicTree_Rebuild,
+// including the node indices.
+typedef struct b2TreeRebuild
+{
+	b2DynamicTree* tree;
+	int leafCount;
+	int rootIndex;
+
+	// Internal nodes reserved in build order
+	int* nodeIndices;
+
+	// Internal nodes above the subtrees in build order
+	int* topNodes;
+	int topNodeCount;
+
+	b2TreeSubtree* subtrees;
+	int subtreeCount;
+} b2TreeRebuild;
+
+// Partition the top of the tree until the child ranges have at most subtreeLeafCount leaves
+b2TreeRebuild b2DynamicTree_BeginRebuild( b2DynamicTree* tree, bool fullBuild, int subtreeLeafCount );
+
+// Build the subtrees [startIndex, endIndex). Disjoint ranges can be built in parallel.
+void b2DynamicTree_BuildSubtrees( b2TreeRebuild* rebuild, int startIndex, int endIndex );
+
+// Link the subtrees and finish the top of the tree. Returns the number of leaves sorted.
+int b2DynamicTree_EndRebuild( b2TreeRebuild* rebuild );
+
+// Sets the box of an enlarged proxy and flags its ancestors as enlarged without growing their boxes.
+// Different proxies of the same tree can be flagged concurrently. Every ancestor is claimed by exactly one
+// call, even if it was already flagged as enlarged. The ancestors claimed by this call are written to
+// flaggedNodes and the count is returned. The capacity must exceed the tree height.
+int b2DynamicTree_FlagEnlargedProxy( b2DynamicTree* tree, int proxyId, b2AABB aabb, int* flaggedNodes, int capacity );
+
+// Grows the box of a flagged internal node to contain its children. Refitting the flagged nodes in
+// order of increasing height gives the same boxes as b2DynamicTree_EnlargeProxy. Nodes of the same
+// height can be refit concurrently. This releases the claim of b2DynamicTree_FlagEnlargedProxy.
+void b2DynamicTree_RefitNode( b2DynamicTree* tree, int nodeIndex );
@@ -0,0 +1,296 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "height_field.h"
+
+#include "core.h"
+
+#include "box2d/math_functions.h"
+
+#include <float.h>
+#include <stddef.h>
+
+b2HeightFieldShape* b2AllocHeightFieldShapeData( int count, int materialCount )
+{
+	B2_ASSERT( count >= 2 && materialCount >= 0 );
+
+	// Materials directly after the header so the 64-bit material ids stay aligned for any sample count.
+	// The heights follow and the byte sized indices go last.
+	int alignment = (int)_Alignof( b2SurfaceMaterial );
+	int materialOffset = ( (int)sizeof( b2HeightFieldShape ) + alignment - 1 ) & ~( alignment - 1 );
+	int heightOffset = materialOffset + materialCount * (int)sizeof( b2SurfaceMaterial );
+	int indexOffset = heightOffset + count * (int)sizeof( float );
+
+	int cellCount = count - 1;
+	int byteCount = indexOffset + ( materialCount > 0 ? cellCount : 0 );
+
+	b2HeightFieldShape* heightField = b2Alloc( byteCount );
+	uint8_t* bytes = (uint8_t*)heightField;
+	heightField->heights = (float*)( bytes + heightOffset );
+	heightField->materials = materialCount > 0 ? (b2SurfaceMaterial*)( bytes + materialOffset ) : NULL;
+	heightField->materialIndices = materialCount > 0 ? bytes + indexOffset : NULL;
+	B2_ASSERT( ( (uintptr_t)( bytes + materialOffset ) & ( alignment - 1 ) ) == 0 );
+	heightField->count = count;
+	heightField->materialCount = materialCount;
+	heightField->spacing = 0.0f;
+	heightField->inverseSpacing = 0.0f;
+	heightField->minHeight = 0.0f;
+	heightField->maxHeight = 0.0f;
+	heightField->byteCount = byteCount;
+	return heightField;
+}
+
+b2HeightFieldShape* b2CreateHeightFieldShapeData( const b2HeightField* def )
+{
+	B2_ASSERT( def->count >= 2 && def->spacing > 0.0f );
+
+	// Cell materials need both the materials and the indices
+	int materialCount = def->materials != NULL && def->materialIndices != NULL ? def->materialCount : 0;
+	B2_ASSERT( materialCount <= 256 );
+
+	b2HeightFieldShape* heightField = b2AllocHeightFieldShapeData( def->count, materialCount );
+	heightField->spacing = def->spacing;
+	heightField->inverseSpacing = 1.0f / def->spacing;
+
+	float minHeight = FLT_MAX;
+	float maxHeight = -FLT_MAX;
+	for ( int i = 0; i < def->count; ++i )
+	{
+		float height = def->heights[i];
+		B2_ASSERT( b2IsValidFloat( height ) );
+		heightField->heights[i] = height;
+		minHeight = b2MinFloat( minHeight, height );
+		maxHeight = b2MaxFloat( maxHeight, height );
+	}
+
+	heightField->minHeight = minHeight;
+	heightField->maxHeight = maxHeight;
+
+	for ( int i = 0; i < materialCount; ++i )
+	{
+		heightField->materials[i] = def->materials[i];
+	}
+
+	if ( materialCount > 0 )
+	{
+		int cellCount = def->count - 1;
+		for ( int i = 0; i < cellCount; ++i )
+		{
+			int index = def->materialIndices[i];
+			B2_ASSERT( index < materialCount );
+			heightField->materialIndices[i] = (uint8_t)( index < materialCount ? index : 0 );
+		}
+	}
+
+	return heightField;
+}
+
+void b2DestroyHeightFieldShapeData( b2HeightFieldShape* heightField )
+{
+	if ( heightField != NULL )
+	{
+		b2Free( heightField, heightField->byteCount );
+	}
+}
+
+static b2Vec2 b2GetHeightFieldPoint( const b2HeightFieldShape* heightField, int index )
+{
+	return (b2Vec2){ index * heightField->spacing, heightField->heights[index] };
+}
+
+// The segment runs right to left so the solid side is below
+static b2Segment b2GetCellSegment( const b2HeightFieldShape* heightField, int cellIndex )
+{
+	b2Segment segment = { b2GetHeightFieldPoint( heightField, cellIndex + 1 ), b2GetHeightFieldPoint( heightField, cellIndex ) };
+	return segment;
+}
+
+b2ChainSegment b2GetHeightFieldSegment( const b2HeightFieldShape* heightField, int cellIndex )
+{
+	B2_ASSERT( 0 <= cellIndex && cellIndex < heightField->count - 1 );
+
+	b2ChainSegment chainSegment;
+	chainSegment.segment = b2GetCellSegment( heightField, cellIndex );
+
+	b2Vec2 p1 = chainSegment.segment.point1;
+	b2Vec2 p2 = chainSegment.segment.point2;
+
+	if ( cellIndex + 2 < heightField->count )
+	{
+		chainSegment.ghost1 = b2GetHeightFieldPoint( heightField, cellIndex + 2 );
+	}
+	else
+	{
+		chainSegment.ghost1 = b2Add( p1, b2Sub( p1, p2 ) );
+	}
+
+	if ( cellIndex > 0 )
+	{
+		chainSegment.ghost2 = b2GetHeightFieldPoint( heightField, cellIndex - 1 );
+	}
+	else
+	{
+		chainSegment.ghost2 = b2Add( p2, b2Sub( p2, p1 ) );
+	}
+
+	chainSegment.chainId = B2_NULL_INDEX;
+	return chainSegment;
+}
+
+// Find the cells covering an x interval in constant time. Returns false if the interval misses the heightfield.
+static bool b2GetCellRange( const b2HeightFieldShape* heightField, float lowerX, float upperX, int* first, int* last )
+{
+	int cellCount = heightField->count - 1;
+	float width = cellCount * heightField->spacing;
+	if ( upperX < 0.0f || width < lowerX )
+	{
+		return false;
+	}
+
+	// Clamp before converting so large coordinates cannot overflow
+	lowerX = b2MaxFloat( lowerX, 0.0f );
+	upperX = b2MinFloat( upperX, width );
+
+	*first = b2MinInt( (int)( lowerX * heightField->inverseSpacing ), cellCount - 1 );
+	*last = b2MinInt( (int)( upperX * heightField->inverseSpacing ), cellCount - 1 );
+	return true;
+}
+
+static bool b2CellOverlaps( const b2Segment* segment, b2AABB aabb )
+{
+	float lowerY = b2MinFloat( segment->point1.y, segment->point2.y );
+	float upperY = b2MaxFloat( segment->point1.y, segment->point2.y );
+	return lowerY <= aabb.upperBound.y && aabb.lowerBound.y <= upperY;
+}
+
+void b2QueryHeightField( const b2HeightFieldShape* heightField, b2AABB aabb, b2MeshQueryFcn* fcn, void* context )
+{
+	int first, last;
+	if ( b2GetCellRange( heightField, aabb.lowerBound.x, aabb.upperBound.x, &first, &last ) == false )
+	{
+		return;
+	}
+
+	for ( int i = first; i <= last; ++i )
+	{
+		b2Segment segment = b2GetCellSegment( heightField, i );
+		if ( b2CellOverlaps( &segment, aabb ) == false )
+		{
+			continue;
+		}
+
+		b2ChainSegment chainSegment = b2GetHeightFieldSegment( heightField, i );
+		if ( fcn( &chainSegment, i, context ) == false )
+		{
+			return;
+		}
+	}
+}
+
+b2CastOutput b2RayCastHeightField( const b2HeightFieldShape* heightField, const b2RayCastInput* input )
+{
+	b2CastOutput output = { 0 };
+
+	b2Vec2 p1 = input->origin;
+	b2Vec2 p2 = b2MulAdd( p1, input->maxFraction, input->translation );
+
+	int first, last;
+	if ( b2GetCellRange( heightField, b2MinFloat( p1.x, p2.x ), b2MaxFloat( p1.x, p2.x ), &first, &last ) == false )
+	{
+		return output;
+	}
+
+	b2AABB rayBox = { b2Min( p1, p2 ), b2Max( p1, p2 ) };
+
+	// The ray moves monotonically in x, so visiting the cells in the ray direction finds the closest hit first
+	int step = input->translation.x >= 0.0f ? 1 : -1;
+	int begin = step > 0 ? first : last;
+	int end = step > 0 ? last + 1 : first - 1;
+	for ( int i = begin; i != end; i += step )
+	{
+		b2Segment segment = b2GetCellSegment( heightField, i );
+		if ( b2CellOverlaps( &segment, rayBox ) == false )
+		{
+			continue;
+		}
+
+		output = b2RayCastSegment( &segment, input, true );
+		if ( output.hit )
+		{
+			return output;
+		}
+	}
+
+	return output;
+}
+
+b2CastOutput b2ShapeCastHeightField( const b2HeightFieldShape* heightField, const b2ShapeCastInput* input )
+{
+	b2CastOutput result = { 0 };
+
+	const b2ShapeProxy* proxy = &input->proxy;
+	if ( proxy->count == 0 )
+	{
+		return result;
+	}
+
+	b2AABB box = { proxy->points[0], proxy->points[0] };
+	b2Vec2 centroid = proxy->points[0];
+	for ( int i = 1; i < proxy->count; ++i )
+	{
+		box.lowerBound = b2Min( box.lowerBound, proxy->points[i] );
+		box.upperBound = b2Max( box.upperBound, proxy->points[i] );
+		centroid = b2Add( centroid, proxy->points[i] );
+	}
+
+	centroid = b2MulSV( 1.0f / proxy->count, centroid );
+
+	b2Vec2 radius = { proxy->radius, proxy->radius };
+	b2Vec2 delta = b2MulSV( input->maxFraction, input->translation );
+	b2AABB sweptBox = {
+		b2Sub( b2Min( box.lowerBound, b2Add( box.lowerBound, delta ) ), radius ),
+		b2Add( b2Max( box.upperBound, b2Add( box.upperBound, delta ) ), radius ),
+	};
+
+	int first, last;
+	if ( b2GetCellRange( heightField, sweptBox.lowerBound.x, sweptBox.upperBound.x, &first, &last ) == false )
+	{
+		return result;
+	}
+
+	b2ShapeCastInput cellInput = *input;
+	for ( int i = first; i <= last; ++i )
+	{
+		b2Segment segment = b2GetCellSegment( heightField, i );
+		if ( b2CellOverlaps( &segment, sweptBox ) == false )
+		{
+			continue;
+		}
+
+		b2CastOutput output = b2ShapeCastOneSidedSegment( &segment, &cellInput, centroid );
+		if ( output.hit && ( result.hit == false || output.fraction < cellInput.maxFraction ) )
+		{
+			result = output;
+			cellInput.maxFraction = output.fraction;
+		}
+	}
+
+	return result;
+}
+
+const b2SurfaceMaterial* b2GetHeightFieldMaterial( const b2HeightFieldShape* heightField, b2Vec2 localPoint )
+{
+	if ( heightField->materialIndices == NULL )
+	{
+		return NULL;
+	}
+
+	int first, last;
+	if ( b2GetCellRange( heightField, localPoint.x, localPoint.x, &first, &last ) == false )
+	{
+		// Beyond the ends, use the end cells
+		first = localPoint.x < 0.0f ? 0 : heightField->count - 2;
+	}
+
+	return heightField->materials + heightField->materialIndices[first];
+}
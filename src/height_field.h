@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "mesh.h"
+
+#include "box2d/types.h"
+
+// Heightfield geometry owned by a heightfield shape. Sample i is at x = i * spacing in the shape frame
+// and cell i spans samples i and i + 1. The arrays share a single allocation.
+typedef struct b2HeightFieldShape
+{
+	float* heights;
+	b2SurfaceMaterial* materials;
+
+	// material index per cell, NULL if the shape material is used for all cells
+	uint8_t* materialIndices;
+
+	int count;
+	int materialCount;
+	float spacing;
+	float inverseSpacing;
+	float minHeight;
+	float maxHeight;
+	int byteCount;
+} b2HeightFieldShape;
+
+b2HeightFieldShape* b2CreateHeightFieldShapeData( const b2HeightField* heightField );
+b2HeightFieldShape* b2AllocHeightFieldShapeData( int count, int materialCount );
+void b2DestroyHeightFieldShapeData( b2HeightFieldShape* heightField );
+
+// The one-sided segment of a cell with ghost vertices from the neighboring samples. The end cells
+// extend the surface linearly.
+b2ChainSegment b2GetHeightFieldSegment( const b2HeightFieldShape* heightField, int cellIndex );
+
+// Visit the cells whose bounds overlap the local AABB. The cell range is found directly from the AABB.
+void b2QueryHeightField( const b2HeightFieldShape* heightField, b2AABB aabb, b2MeshQueryFcn* fcn, void* context );
+
+// These are in the heightfield local frame and report the closest hit
+b2CastOutput b2RayCastHeightField( const b2HeightFieldShape* heightField, const b2RayCastInput* input );
+b2CastOutput b2ShapeCastHeightField( const b2HeightFieldShape* heightField, const b2ShapeCastInput* input );
+
+// The material of the cell below a local point, or NULL if the heightfield has no cell materials
+const b2SurfaceMaterial* b2GetHeightFieldMaterial( const b2HeightFieldShape* heightField, b2Vec2 localPoint );
+
+static inline b2AABB b2GetHeightFieldBounds( const b2HeightFieldShape* heightField )
+{
+	b2AABB bounds = { { 0.0f, heightField->minHeight },
+					  { ( heightField->count - 1 ) * heightField->spacing, heightField->maxHeight } };
+	return bounds;
+}
@@ -1459,94 +1459,6 @@ void b2SolveJoints_Overflow( b2StepContext* context, bool useBias )
 	b2TracyCZoneEnd( solve_joints );
 }
 
-void b2PrepareJointsTask( b2SolverBlock block, b2StepContext* context )
-{
-	b2TracyCZoneNC( prepare_joints, "PrepJoints", b2_colorOldLace, true );
-
-	b2JointPrepareSpan* spans = context->jointPrepareSpans;
-
-	int index = block.startIndex;
-	int endIndex = block.startIndex + block.count;
-
-	// Find color for start index. Linear search but fast.
-	int colorIndex = 0;
-	while ( spans[colorIndex + 1].start <= index )
-	{
-		colorIndex += 1;
-	}
-
-	// Loop over block
-	while ( index < endIndex )
-	{
-		int colorStart = spans[colorIndex].start;
-		int colorEndIndex = b2MinInt( spans[colorIndex + 1].start, endIndex );
-		b2JointSim* joints = spans[colorIndex].joints;
-
-		// Loop over color
-		for ( ; index < colorEndIndex; ++index )
-		{
-			B2_ASSERT( 0 <= index - colorStart && index - colorStart < spans[colorIndex].count );
-			b2JointSim* joint = joints + ( index - colorStart );
-			b2PrepareJoint( joint, context );
-		}
-
-		// Advance to next color
-		colorIndex += 1;
-	}
-
-	b2TracyCZoneEnd( prepare_joints );
-}
-
-void b2WarmStartJointsTask( b2SolverBlock block, b2StepContext* context )
-{
-	b2TracyCZoneNC( warm_joints, "WarmJoints", b2_colorGold, true );
-
-	b2GraphColor* color = context->graph->colors + block.colorIndex;
-	b2JointSim* joints = color->jointSims.data;
-
-	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
-	{
-		b2JointSim* joint = joints + i;
-		b2WarmStartJoint( joint, context );
-	}
-
-	b2TracyCZoneEnd( warm_joints );
-}
-
-void b2SolveJointsTask( b2SolverBlock block, b2StepContext* context, bool useBias, int workerIndex )
-{
-	b2TracyCZoneNC( solve_joints, "SolveJoints", b2_colorLemonChiffon, true );
-
-	b2GraphColor* color = context->graph->colors + block.colorIndex;
-	b2JointSim* joints = color->jointSims.data;
-
-	B2_ASSERT( 0 <= block.startIndex && block.startIndex + block.count <= color->jointSims.count );
-
-	b2BitSet* jointStateBitSet = &context->world->taskContexts.data[workerIndex].jointStateBitSet;
-
-	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
-	{
-		b2JointSim* joint = joints + i;
-		b2SolveJoint( joint, context, useBias );
-
-		if ( useBias && ( joint->forceThreshold < FLT_MAX || joint->torqueThreshold < FLT_MAX ) &&
-			 b2GetBit( jointStateBitSet, joint->jointId ) == false )
-		{
-			float force, torque;
-			b2GetJointReaction( joint, context->inv_h, &force, &torque );
-
-			// Check thresholds. A zero threshold means all awake joints get reported.
-			if ( force >= joint->forceThreshold || torque >= joint->torqueThreshold )
-			{
-				// Flag this joint for processing.
-				b2SetBit( jointStateBitSet, joint->jointId );
-			}
-		}
-	}
-
-	b2TracyCZoneEnd( solve_joints );
-}
-
 void b2DrawJoint( b2DebugDraw* draw, b2World* world, b2Joint* joint )
 {
 	b2Body* bodyA = b2Array_Get( world->bodies,joint->edges[0].bodyId );
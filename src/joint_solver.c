@@ -0,0 +1,1290 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "joint_solver.h"
+
+#include "body.h"
+#include "constraint_graph.h"
+#include "core.h"
+#include "joint.h"
+#include "physics_world.h"
+#include "simd.h"
+
+#include <float.h>
+#include <stddef.h>
+#include <string.h>
+
+// Graph colored joints of the same type are packed into wide constraints and solved B2_SIMD_WIDTH
+// at a time, the same way as contacts. Joints within a color share no dynamic bodies so the order
+// they are solved in does not matter.
+//
+// The wide solvers mirror the scalar joint solvers operation for operation. Every lane performs the
+// same float operations in the same order as the scalar code, no FMA, so a joint gives bit identical
+// results whether it is solved wide or alone. This keeps cross-platform determinism independent of
+// the SIMD width. Optional features such as motors and limits are computed for all lanes and blended
+// into the lanes that have them enabled.
+//
+// Joints that need per-joint work during the solve stay scalar:
+// - joints with force or torque thresholds report events from the solve
+// - revolute springs need b2UnwindAngle
+// Wide impulses are written back to the joint sims in the store impulses stage.
+
+typedef struct b2RevoluteConstraintW
+{
+	b2Vec2W linearImpulse;
+	b2FloatW springImpulse;
+	b2FloatW motorImpulse;
+	b2FloatW lowerImpulse;
+	b2FloatW upperImpulse;
+	b2FloatW axialMass;
+	b2FloatW motorSpeed;
+	b2FloatW maxMotorImpulse;
+	b2FloatW lowerAngle;
+	b2FloatW upperAngle;
+
+	// lane masks
+	b2FloatW enableMotor;
+	b2FloatW enableLimit;
+} b2RevoluteConstraintW;
+
+typedef struct b2WeldConstraintW
+{
+	b2Vec2W linearImpulse;
+	b2FloatW angularImpulse;
+	b2FloatW axialMass;
+	b2FloatW linearBiasRate, linearMassScale, linearImpulseScale;
+	b2FloatW angularBiasRate, angularMassScale, angularImpulseScale;
+
+	// lane masks, set when the spring is active during relax
+	b2FloatW linearSpring;
+	b2FloatW angularSpring;
+} b2WeldConstraintW;
+
+typedef struct b2PrismaticConstraintW
+{
+	b2Vec2W impulse;
+	b2FloatW springImpulse;
+	b2FloatW motorImpulse;
+	b2FloatW lowerImpulse;
+	b2FloatW upperImpulse;
+	b2Vec2W axis;
+	b2FloatW springBiasRate, springMassScale, springImpulseScale;
+	b2FloatW targetTranslation;
+	b2FloatW motorSpeed;
+	b2FloatW maxMotorImpulse;
+	b2FloatW lowerTranslation;
+	b2FloatW upperTranslation;
+	b2FloatW speculativeDistance;
+
+	// lane masks
+	b2FloatW enableSpring;
+	b2FloatW enableMotor;
+	b2FloatW enableLimit;
+} b2PrismaticConstraintW;
+
+typedef struct b2JointConstraintWide
+{
+	// null for unused lanes, lanes are filled in order
+	b2JointSim* joints[B2_SIMD_WIDTH];
+	b2JointType type;
+
+	// any lane has the feature enabled
+	bool anySpring;
+	bool anyMotor;
+	bool anyLimit;
+
+	// Everything from here on is zeroed for partially filled constraints
+	// base-1, 0 for null
+	int indexA[B2_SIMD_WIDTH];
+	int indexB[B2_SIMD_WIDTH];
+
+	b2FloatW invMassA, invMassB;
+	b2FloatW invIA, invIB;
+	b2Vec2W anchorA, anchorB;
+	b2RotW frameA, frameB;
+	b2Vec2W deltaCenter;
+	b2FloatW biasRate;
+	b2FloatW massScale;
+	b2FloatW impulseScale;
+
+	union
+	{
+		b2RevoluteConstraintW revolute;
+		b2WeldConstraintW weld;
+		b2PrismaticConstraintW prismatic;
+	};
+} b2JointConstraintWide;
+
+int b2GetWideJointConstraintByteCount( void )
+{
+	return sizeof( b2JointConstraintWide );
+}
+
+int b2GetWideJointCapacity( int jointCount )
+{
+	// Each wide joint type may leave one partially filled constraint
+	return ( jointCount >> B2_SIMD_SHIFT ) + 3;
+}
+
+static inline void b2SetLaneW( b2FloatW* a, int lane, float value )
+{
+	( (float*)a )[lane] = value;
+}
+
+static inline float b2GetLaneW( const b2FloatW* a, int lane )
+{
+	return ( (const float*)a )[lane];
+}
+
+// The helpers below match the scalar float functions exactly, including the sign of zero.
+// The min/max intrinsics and SSE negation do not all agree with the scalar code on signed zeros.
+
+static inline b2FloatW b2NegW( b2FloatW a )
+{
+	return b2MulW( a, b2SplatW( -1.0f ) );
+}
+
+// a < b
+static inline b2FloatW b2LessThanW( b2FloatW a, b2FloatW b )
+{
+	return b2GreaterThanW( b, a );
+}
+
+// b2MaxFloat
+static inline b2FloatW b2MaxFloatW( b2FloatW a, b2FloatW b )
+{
+	return b2BlendW( b, a, b2GreaterThanW( a, b ) );
+}
+
+// b2MinFloat
+static inline b2FloatW b2MinFloatW( b2FloatW a, b2FloatW b )
+{
+	return b2BlendW( b, a, b2LessThanW( a, b ) );
+}
+
+// b2AbsFloat
+static inline b2FloatW b2AbsFloatW( b2FloatW a )
+{
+	return b2BlendW( a, b2NegW( a ), b2LessThanW( a, b2ZeroW() ) );
+}
+
+// b2ClampFloat
+static inline b2FloatW b2ClampFloatW( b2FloatW a, b2FloatW lower, b2FloatW upper )
+{
+	b2FloatW r = b2BlendW( a, upper, b2GreaterThanW( a, upper ) );
+	return b2BlendW( r, lower, b2LessThanW( a, lower ) );
+}
+
+// b2Atan2
+static inline b2FloatW b2Atan2W( b2FloatW y, b2FloatW x )
+{
+	b2FloatW zero = b2ZeroW();
+	b2FloatW ax = b2AbsFloatW( x );
+	b2FloatW ay = b2AbsFloatW( y );
+	b2FloatW mx = b2MaxFloatW( ay, ax );
+	b2FloatW mn = b2MinFloatW( ay, ax );
+	b2FloatW a = b2DivW( mn, mx );
+
+	// Minimax polynomial approximation to atan(a) on [0,1]
+	b2FloatW s = b2MulW( a, a );
+	b2FloatW c = b2MulW( s, a );
+	b2FloatW q = b2MulW( s, s );
+	b2FloatW r = b2AddW( b2MulW( b2SplatW( 0.024840285f ), q ), b2SplatW( 0.18681418f ) );
+	b2FloatW t = b2SubW( b2MulW( b2SplatW( -0.094097948f ), q ), b2SplatW( 0.33213072f ) );
+	r = b2AddW( b2MulW( r, s ), t );
+	r = b2AddW( b2MulW( r, c ), a );
+
+	// Map to full circle
+	r = b2BlendW( r, b2SubW( b2SplatW( 1.57079637f ), r ), b2GreaterThanW( ay, ax ) );
+	r = b2BlendW( r, b2SubW( b2SplatW( 3.14159274f ), r ), b2LessThanW( x, zero ) );
+	r = b2BlendW( r, b2NegW( r ), b2LessThanW( y, zero ) );
+
+	// (0,0) gives zero to match atan2f and avoid NaN
+	b2FloatW origin = b2AndW( b2EqualsW( x, zero ), b2EqualsW( y, zero ) );
+	return b2BlendW( r, zero, origin );
+}
+
+// b2MulRot
+static inline b2RotW b2MulRotW( b2RotW q, b2RotW r )
+{
+	b2RotW qr;
+	qr.S = b2AddW( b2MulW( q.S, r.C ), b2MulW( q.C, r.S ) );
+	qr.C = b2SubW( b2MulW( q.C, r.C ), b2MulW( q.S, r.S ) );
+	return qr;
+}
+
+// b2InvMulRot
+static inline b2RotW b2InvMulRotW( b2RotW a, b2RotW b )
+{
+	b2RotW r;
+	r.S = b2SubW( b2MulW( a.C, b.S ), b2MulW( a.S, b.C ) );
+	r.C = b2AddW( b2MulW( a.C, b.C ), b2MulW( a.S, b.S ) );
+	return r;
+}
+
+static inline b2Vec2W b2AddVW( b2Vec2W a, b2Vec2W b )
+{
+	return (b2Vec2W){ b2AddW( a.X, b.X ), b2AddW( a.Y, b.Y ) };
+}
+
+static inline b2Vec2W b2SubVW( b2Vec2W a, b2Vec2W b )
+{
+	return (b2Vec2W){ b2SubW( a.X, b.X ), b2SubW( a.Y, b.Y ) };
+}
+
+// b2Solve22 with K = [a11 a12; a21 a22]
+static inline b2Vec2W b2Solve22W( b2FloatW a11, b2FloatW a12, b2FloatW a21, b2FloatW a22, b2Vec2W b )
+{
+	b2FloatW det = b2SubW( b2MulW( a11, a22 ), b2MulW( a12, a21 ) );
+	det = b2BlendW( b2DivW( b2SplatW( 1.0f ), det ), det, b2EqualsW( det, b2ZeroW() ) );
+	b2Vec2W x = {
+		b2MulW( det, b2SubW( b2MulW( a22, b.X ), b2MulW( a12, b.Y ) ) ),
+		b2MulW( det, b2SubW( b2MulW( a11, b.Y ), b2MulW( a21, b.X ) ) ),
+	};
+	return x;
+}
+
+// Relative velocity of the anchor points: (vB + cross(wB, rB)) - (vA + cross(wA, rA))
+static inline b2Vec2W b2RelativeVelocityW( b2Vec2W vA, b2FloatW wA, b2Vec2W rA, b2Vec2W vB, b2FloatW wB, b2Vec2W rB )
+{
+	b2Vec2W dv;
+	dv.X = b2SubW( b2SubW( vB.X, b2MulW( wB, rB.Y ) ), b2SubW( vA.X, b2MulW( wA, rA.Y ) ) );
+	dv.Y = b2SubW( b2AddW( vB.Y, b2MulW( wB, rB.X ) ), b2AddW( vA.Y, b2MulW( wA, rA.X ) ) );
+	return dv;
+}
+
+static int b2GetWideJointSlot( const b2JointSim* joint )
+{
+	// Joint events are checked per joint during the solve
+	if ( joint->forceThreshold < FLT_MAX || joint->torqueThreshold < FLT_MAX )
+	{
+		return B2_NULL_INDEX;
+	}
+
+	switch ( joint->type )
+	{
+		case b2_revoluteJoint:
+			// The spring uses b2UnwindAngle which has no wide version
+			return joint->revoluteJoint.enableSpring ? B2_NULL_INDEX : 0;
+
+		case b2_weldJoint:
+			return 1;
+
+		case b2_prismaticJoint:
+			return 2;
+
+		default:
+			return B2_NULL_INDEX;
+	}
+}
+
+int b2BuildWideJoints( b2GraphColor* color, b2JointConstraintWide* wideJoints, b2JointSim** scalarJoints )
+{
+	int jointCount = color->jointSims.count;
+	b2JointSim* joints = color->jointSims.data;
+
+	int wideCount = 0;
+	int scalarCount = 0;
+
+	// The wide constraint being filled for each joint type
+	b2JointConstraintWide* open[3] = { NULL, NULL, NULL };
+	int openLaneCount[3] = { 0, 0, 0 };
+
+	for ( int i = 0; i < jointCount; ++i )
+	{
+		b2JointSim* joint = joints + i;
+		int slot = b2GetWideJointSlot( joint );
+		if ( slot == B2_NULL_INDEX )
+		{
+			scalarJoints[scalarCount] = joint;
+			scalarCount += 1;
+			continue;
+		}
+
+		b2JointConstraintWide* constraint = open[slot];
+		if ( constraint == NULL )
+		{
+			constraint = wideJoints + wideCount;
+			wideCount += 1;
+
+			for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+			{
+				constraint->joints[lane] = NULL;
+			}
+			constraint->type = joint->type;
+
+			open[slot] = constraint;
+			openLaneCount[slot] = 0;
+		}
+
+		constraint->joints[openLaneCount[slot]] = joint;
+		openLaneCount[slot] += 1;
+
+		if ( openLaneCount[slot] == B2_SIMD_WIDTH )
+		{
+			open[slot] = NULL;
+		}
+	}
+
+	B2_ASSERT( wideCount <= b2GetWideJointCapacity( jointCount ) );
+
+	color->wideJoints = wideJoints;
+	color->wideJointCount = wideCount;
+	color->scalarJoints = scalarJoints;
+	color->scalarJointCount = scalarCount;
+
+	return wideCount + scalarCount;
+}
+
+static void b2PrepareWideJoint( b2JointConstraintWide* c, b2StepContext* context )
+{
+	if ( c->joints[B2_SIMD_WIDTH - 1] == NULL )
+	{
+		// Unused lanes get null bodies and zero mass
+		size_t offset = offsetof( b2JointConstraintWide, indexA );
+		memset( (uint8_t*)c + offset, 0, sizeof( b2JointConstraintWide ) - offset );
+	}
+
+	float h = context->h;
+	bool anySpring = false;
+	bool anyMotor = false;
+	bool anyLimit = false;
+
+	for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+	{
+		b2JointSim* base = c->joints[lane];
+		if ( base == NULL )
+		{
+			break;
+		}
+
+		b2PrepareJoint( base, context );
+
+		b2SetLaneW( &c->invMassA, lane, base->invMassA );
+		b2SetLaneW( &c->invMassB, lane, base->invMassB );
+		b2SetLaneW( &c->invIA, lane, base->invIA );
+		b2SetLaneW( &c->invIB, lane, base->invIB );
+		b2SetLaneW( &c->biasRate, lane, base->constraintSoftness.biasRate );
+		b2SetLaneW( &c->massScale, lane, base->constraintSoftness.massScale );
+		b2SetLaneW( &c->impulseScale, lane, base->constraintSoftness.impulseScale );
+
+		int indexA, indexB;
+		b2Transform frameA, frameB;
+		b2Vec2 deltaCenter;
+
+		switch ( c->type )
+		{
+			case b2_revoluteJoint:
+			{
+				b2RevoluteJoint* joint = &base->revoluteJoint;
+				b2RevoluteConstraintW* w = &c->revolute;
+				indexA = joint->indexA;
+				indexB = joint->indexB;
+				frameA = joint->frameA;
+				frameB = joint->frameB;
+				deltaCenter = joint->deltaCenter;
+
+				bool fixedRotation = ( base->invIA + base->invIB == 0.0f );
+				bool enableMotor = joint->enableMotor && fixedRotation == false;
+				bool enableLimit = joint->enableLimit && fixedRotation == false;
+				anyMotor = anyMotor || enableMotor;
+				anyLimit = anyLimit || enableLimit;
+
+				b2SetLaneW( &w->linearImpulse.X, lane, joint->linearImpulse.x );
+				b2SetLaneW( &w->linearImpulse.Y, lane, joint->linearImpulse.y );
+				b2SetLaneW( &w->springImpulse, lane, joint->springImpulse );
+				b2SetLaneW( &w->motorImpulse, lane, joint->motorImpulse );
+				b2SetLaneW( &w->lowerImpulse, lane, joint->lowerImpulse );
+				b2SetLaneW( &w->upperImpulse, lane, joint->upperImpulse );
+				b2SetLaneW( &w->axialMass, lane, joint->axialMass );
+				b2SetLaneW( &w->motorSpeed, lane, joint->motorSpeed );
+				b2SetLaneW( &w->maxMotorImpulse, lane, h * joint->maxMotorTorque );
+				b2SetLaneW( &w->lowerAngle, lane, joint->lowerAngle );
+				b2SetLaneW( &w->upperAngle, lane, joint->upperAngle );
+				b2SetLaneW( &w->enableMotor, lane, enableMotor ? 1.0f : 0.0f );
+				b2SetLaneW( &w->enableLimit, lane, enableLimit ? 1.0f : 0.0f );
+			}
+			break;
+
+			case b2_weldJoint:
+			{
+				b2WeldJoint* joint = &base->weldJoint;
+				b2WeldConstraintW* w = &c->weld;
+				indexA = joint->indexA;
+				indexB = joint->indexB;
+				frameA = joint->frameA;
+				frameB = joint->frameB;
+				deltaCenter = joint->deltaCenter;
+
+				b2SetLaneW( &w->linearImpulse.X, lane, joint->linearImpulse.x );
+				b2SetLaneW( &w->linearImpulse.Y, lane, joint->linearImpulse.y );
+				b2SetLaneW( &w->angularImpulse, lane, joint->angularImpulse );
+				b2SetLaneW( &w->axialMass, lane, joint->axialMass );
+				b2SetLaneW( &w->linearBiasRate, lane, joint->linearSpring.biasRate );
+				b2SetLaneW( &w->linearMassScale, lane, joint->linearSpring.massScale );
+				b2SetLaneW( &w->linearImpulseScale, lane, joint->linearSpring.impulseScale );
+				b2SetLaneW( &w->angularBiasRate, lane, joint->angularSpring.biasRate );
+				b2SetLaneW( &w->angularMassScale, lane, joint->angularSpring.massScale );
+				b2SetLaneW( &w->angularImpulseScale, lane, joint->angularSpring.impulseScale );
+				b2SetLaneW( &w->linearSpring, lane, joint->linearHertz > 0.0f ? 1.0f : 0.0f );
+				b2SetLaneW( &w->angularSpring, lane, joint->angularHertz > 0.0f ? 1.0f : 0.0f );
+			}
+			break;
+
+			case b2_prismaticJoint:
+			{
+				b2PrismaticJoint* joint = &base->prismaticJoint;
+				b2PrismaticConstraintW* w = &c->prismatic;
+				indexA = joint->indexA;
+				indexB = joint->indexB;
+				frameA = joint->frameA;
+				frameB = joint->frameB;
+				deltaCenter = joint->deltaCenter;
+
+				anySpring = anySpring || joint->enableSpring;
+				anyMotor = anyMotor || joint->enableMotor;
+				anyLimit = anyLimit || joint->enableLimit;
+
+				b2Vec2 axis = b2RotateVector( frameA.q, (b2Vec2){ 1.0f, 0.0f } );
+
+				b2SetLaneW( &w->impulse.X, lane, joint->impulse.x );
+				b2SetLaneW( &w->impulse.Y, lane, joint->impulse.y );
+				b2SetLaneW( &w->springImpulse, lane, joint->springImpulse );
+				b2SetLaneW( &w->motorImpulse, lane, joint->motorImpulse );
+				b2SetLaneW( &w->lowerImpulse, lane, joint->lowerImpulse );
+				b2SetLaneW( &w->upperImpulse, lane, joint->upperImpulse );
+				b2SetLaneW( &w->axis.X, lane, axis.x );
+				b2SetLaneW( &w->axis.Y, lane, axis.y );
+				b2SetLaneW( &w->springBiasRate, lane, joint->springSoftness.biasRate );
+				b2SetLaneW( &w->springMassScale, lane, joint->springSoftness.massScale );
+				b2SetLaneW( &w->springImpulseScale, lane, joint->springSoftness.impulseScale );
+				b2SetLaneW( &w->targetTranslation, lane, joint->targetTranslation );
+				b2SetLaneW( &w->motorSpeed, lane, joint->motorSpeed );
+				b2SetLaneW( &w->maxMotorImpulse, lane, h * joint->maxMotorForce );
+				b2SetLaneW( &w->lowerTranslation, lane, joint->lowerTranslation );
+				b2SetLaneW( &w->upperTranslation, lane, joint->upperTranslation );
+				b2SetLaneW( &w->speculativeDistance, lane, 0.25f * ( joint->upperTranslation - joint->lowerTranslation ) );
+				b2SetLaneW( &w->enableSpring, lane, joint->enableSpring ? 1.0f : 0.0f );
+				b2SetLaneW( &w->enableMotor, lane, joint->enableMotor ? 1.0f : 0.0f );
+				b2SetLaneW( &w->enableLimit, lane, joint->enableLimit ? 1.0f : 0.0f );
+			}
+			break;
+
+			default:
+				B2_ASSERT( false );
+				return;
+		}
+
+		// 0 for null
+		c->indexA[lane] = indexA + 1;
+		c->indexB[lane] = indexB + 1;
+
+		b2SetLaneW( &c->anchorA.X, lane, frameA.p.x );
+		b2SetLaneW( &c->anchorA.Y, lane, frameA.p.y );
+		b2SetLaneW( &c->anchorB.X, lane, frameB.p.x );
+		b2SetLaneW( &c->anchorB.Y, lane, frameB.p.y );
+		b2SetLaneW( &c->frameA.C, lane, frameA.q.c );
+		b2SetLaneW( &c->frameA.S, lane, frameA.q.s );
+		b2SetLaneW( &c->frameB.C, lane, frameB.q.c );
+		b2SetLaneW( &c->frameB.S, lane, frameB.q.s );
+		b2SetLaneW( &c->deltaCenter.X, lane, deltaCenter.x );
+		b2SetLaneW( &c->deltaCenter.Y, lane, deltaCenter.y );
+	}
+
+	c->anySpring = anySpring;
+	c->anyMotor = anyMotor;
+	c->anyLimit = anyLimit;
+
+	// Convert the lane flags to blend masks
+	b2FloatW zero = b2ZeroW();
+	if ( c->type == b2_revoluteJoint )
+	{
+		c->revolute.enableMotor = b2GreaterThanW( c->revolute.enableMotor, zero );
+		c->revolute.enableLimit = b2GreaterThanW( c->revolute.enableLimit, zero );
+	}
+	else if ( c->type == b2_weldJoint )
+	{
+		c->weld.linearSpring = b2GreaterThanW( c->weld.linearSpring, zero );
+		c->weld.angularSpring = b2GreaterThanW( c->weld.angularSpring, zero );
+	}
+	else
+	{
+		c->prismatic.enableSpring = b2GreaterThanW( c->prismatic.enableSpring, zero );
+		c->prismatic.enableMotor = b2GreaterThanW( c->prismatic.enableMotor, zero );
+		c->prismatic.enableLimit = b2GreaterThanW( c->prismatic.enableLimit, zero );
+	}
+}
+
+// Matches b2WarmStartRevoluteJoint and b2WarmStartWeldJoint which only differ in the axial impulse
+static void b2WarmStartPointJointW( b2JointConstraintWide* c, b2BodyStateW* bA, b2BodyStateW* bB, b2Vec2W linearImpulse,
+									b2FloatW axialImpulse )
+{
+	b2Vec2W rA = b2RotateVectorW( bA->dq, c->anchorA );
+	b2Vec2W rB = b2RotateVectorW( bB->dq, c->anchorB );
+
+	bA->v.X = b2MulSubW( bA->v.X, c->invMassA, linearImpulse.X );
+	bA->v.Y = b2MulSubW( bA->v.Y, c->invMassA, linearImpulse.Y );
+	bA->w = b2MulSubW( bA->w, c->invIA, b2AddW( b2CrossW( rA, linearImpulse ), axialImpulse ) );
+
+	bB->v.X = b2MulAddW( bB->v.X, c->invMassB, linearImpulse.X );
+	bB->v.Y = b2MulAddW( bB->v.Y, c->invMassB, linearImpulse.Y );
+	bB->w = b2MulAddW( bB->w, c->invIB, b2AddW( b2CrossW( rB, linearImpulse ), axialImpulse ) );
+}
+
+// Matches b2WarmStartPrismaticJoint
+static void b2WarmStartPrismaticJointW( b2JointConstraintWide* c, b2BodyStateW* bA, b2BodyStateW* bB )
+{
+	b2PrismaticConstraintW* joint = &c->prismatic;
+
+	b2Vec2W rA = b2RotateVectorW( bA->dq, c->anchorA );
+	b2Vec2W rB = b2RotateVectorW( bB->dq, c->anchorB );
+
+	b2Vec2W d = b2AddVW( b2AddVW( b2SubVW( bB->dp, bA->dp ), c->deltaCenter ), b2SubVW( rB, rA ) );
+	b2Vec2W axisA = b2RotateVectorW( bA->dq, joint->axis );
+
+	// impulse is applied at anchor point on body B
+	b2Vec2W rAd = b2AddVW( rA, d );
+	b2FloatW a1 = b2CrossW( rAd, axisA );
+	b2FloatW a2 = b2CrossW( rB, axisA );
+	b2FloatW axialImpulse =
+		b2SubW( b2AddW( b2AddW( joint->springImpulse, joint->motorImpulse ), joint->lowerImpulse ), joint->upperImpulse );
+
+	// perpendicular constraint
+	b2Vec2W perpA = { b2NegW( axisA.Y ), axisA.X };
+	b2FloatW s1 = b2CrossW( rAd, perpA );
+	b2FloatW s2 = b2CrossW( rB, perpA );
+	b2FloatW perpImpulse = joint->impulse.X;
+	b2FloatW angleImpulse = joint->impulse.Y;
+
+	b2Vec2W P;
+	P.X = b2AddW( b2MulW( axialImpulse, axisA.X ), b2MulW( perpImpulse, perpA.X ) );
+	P.Y = b2AddW( b2MulW( axialImpulse, axisA.Y ), b2MulW( perpImpulse, perpA.Y ) );
+	b2FloatW LA = b2AddW( b2AddW( b2MulW( axialImpulse, a1 ), b2MulW( perpImpulse, s1 ) ), angleImpulse );
+	b2FloatW LB = b2AddW( b2AddW( b2MulW( axialImpulse, a2 ), b2MulW( perpImpulse, s2 ) ), angleImpulse );
+
+	bA->v.X = b2MulSubW( bA->v.X, c->invMassA, P.X );
+	bA->v.Y = b2MulSubW( bA->v.Y, c->invMassA, P.Y );
+	bA->w = b2MulSubW( bA->w, c->invIA, LA );
+
+	bB->v.X = b2MulAddW( bB->v.X, c->invMassB, P.X );
+	bB->v.Y = b2MulAddW( bB->v.Y, c->invMassB, P.Y );
+	bB->w = b2MulAddW( bB->w, c->invIB, LB );
+}
+
+static void b2WarmStartWideJoint( b2JointConstraintWide* c, b2BodyState* states )
+{
+	b2BodyStateW bA = b2GatherBodies( states, c->indexA );
+	b2BodyStateW bB = b2GatherBodies( states, c->indexB );
+
+	switch ( c->type )
+	{
+		case b2_revoluteJoint:
+		{
+			b2RevoluteConstraintW* joint = &c->revolute;
+			b2FloatW axialImpulse =
+				b2SubW( b2AddW( b2AddW( joint->springImpulse, joint->motorImpulse ), joint->lowerImpulse ), joint->upperImpulse );
+			b2WarmStartPointJointW( c, &bA, &bB, joint->linearImpulse, axialImpulse );
+		}
+		break;
+
+		case b2_weldJoint:
+			b2WarmStartPointJointW( c, &bA, &bB, c->weld.linearImpulse, c->weld.angularImpulse );
+			break;
+
+		case b2_prismaticJoint:
+			b2WarmStartPrismaticJointW( c, &bA, &bB );
+			break;
+
+		default:
+			B2_ASSERT( false );
+	}
+
+	b2ScatterBodies( states, c->indexA, &bA );
+	b2ScatterBodies( states, c->indexB, &bB );
+}
+
+// Solves the 2D point constraint shared by revolute and weld joints and returns the impulse
+static b2Vec2W b2SolvePointConstraintW( b2JointConstraintWide* c, b2Vec2W* vA, b2FloatW* wA, b2Vec2W* vB, b2FloatW* wB,
+										const b2BodyStateW* bA, const b2BodyStateW* bB, b2Vec2W accumulatedImpulse,
+										b2FloatW biasRate, b2FloatW massScale, b2FloatW impulseScale, b2FloatW useBiasMask )
+{
+	b2FloatW mA = c->invMassA;
+	b2FloatW mB = c->invMassB;
+	b2FloatW iA = c->invIA;
+	b2FloatW iB = c->invIB;
+
+	// current anchors
+	b2Vec2W rA = b2RotateVectorW( bA->dq, c->anchorA );
+	b2Vec2W rB = b2RotateVectorW( bB->dq, c->anchorB );
+
+	b2Vec2W Cdot = b2RelativeVelocityW( *vA, *wA, rA, *vB, *wB, rB );
+
+	b2FloatW zero = b2ZeroW();
+	b2Vec2W separation = b2AddVW( b2AddVW( b2SubVW( bB->dp, bA->dp ), b2SubVW( rB, rA ) ), c->deltaCenter );
+	b2Vec2W bias;
+	bias.X = b2BlendW( zero, b2MulW( biasRate, separation.X ), useBiasMask );
+	bias.Y = b2BlendW( zero, b2MulW( biasRate, separation.Y ), useBiasMask );
+	massScale = b2BlendW( b2SplatW( 1.0f ), massScale, useBiasMask );
+	impulseScale = b2BlendW( zero, impulseScale, useBiasMask );
+
+	b2FloatW mAB = b2AddW( mA, mB );
+	b2FloatW k11 = b2AddW( b2AddW( mAB, b2MulW( b2MulW( rA.Y, rA.Y ), iA ) ), b2MulW( b2MulW( rB.Y, rB.Y ), iB ) );
+	b2FloatW k12 = b2SubW( b2NegW( b2MulW( b2MulW( rA.Y, rA.X ), iA ) ), b2MulW( b2MulW( rB.Y, rB.X ), iB ) );
+	b2FloatW k22 = b2AddW( b2AddW( mAB, b2MulW( b2MulW( rA.X, rA.X ), iA ) ), b2MulW( b2MulW( rB.X, rB.X ), iB ) );
+	b2Vec2W b = b2Solve22W( k11, k12, k12, k22, b2AddVW( Cdot, bias ) );
+
+	b2FloatW negMassScale = b2NegW( massScale );
+	b2Vec2W impulse;
+	impulse.X = b2SubW( b2MulW( negMassScale, b.X ), b2MulW( impulseScale, accumulatedImpulse.X ) );
+	impulse.Y = b2SubW( b2MulW( negMassScale, b.Y ), b2MulW( impulseScale, accumulatedImpulse.Y ) );
+
+	vA->X = b2MulSubW( vA->X, mA, impulse.X );
+	vA->Y = b2MulSubW( vA->Y, mA, impulse.Y );
+	*wA = b2MulSubW( *wA, iA, b2CrossW( rA, impulse ) );
+	vB->X = b2MulAddW( vB->X, mB, impulse.X );
+	vB->Y = b2MulAddW( vB->Y, mB, impulse.Y );
+	*wB = b2MulAddW( *wB, iB, b2CrossW( rB, impulse ) );
+
+	return impulse;
+}
+
+// Matches b2SolveRevoluteJoint without the spring
+static void b2SolveRevoluteJointW( b2JointConstraintWide* c, b2BodyStateW* bA, b2BodyStateW* bB, b2FloatW inv_h, bool useBias )
+{
+	b2RevoluteConstraintW* joint = &c->revolute;
+
+	b2FloatW iA = c->invIA;
+	b2FloatW iB = c->invIB;
+
+	b2Vec2W vA = bA->v;
+	b2FloatW wA = bA->w;
+	b2Vec2W vB = bB->v;
+	b2FloatW wB = bB->w;
+
+	b2FloatW zero = b2ZeroW();
+	b2FloatW one = b2SplatW( 1.0f );
+
+	// Solve motor constraint.
+	if ( c->anyMotor )
+	{
+		b2FloatW mask = joint->enableMotor;
+		b2FloatW Cdot = b2SubW( b2SubW( wB, wA ), joint->motorSpeed );
+		b2FloatW impulse = b2MulW( b2NegW( joint->axialMass ), Cdot );
+		b2FloatW oldImpulse = joint->motorImpulse;
+		b2FloatW maxImpulse = joint->maxMotorImpulse;
+		b2FloatW newImpulse = b2ClampFloatW( b2AddW( oldImpulse, impulse ), b2NegW( maxImpulse ), maxImpulse );
+		impulse = b2SubW( newImpulse, oldImpulse );
+
+		joint->motorImpulse = b2BlendW( oldImpulse, newImpulse, mask );
+		wA = b2BlendW( wA, b2MulSubW( wA, iA, impulse ), mask );
+		wB = b2BlendW( wB, b2MulAddW( wB, iB, impulse ), mask );
+	}
+
+	if ( c->anyLimit )
+	{
+		b2FloatW mask = joint->enableLimit;
+
+		b2RotW qA = b2MulRotW( bA->dq, c->frameA );
+		b2RotW qB = b2MulRotW( bB->dq, c->frameB );
+		b2RotW relQ = b2InvMulRotW( qA, qB );
+		b2FloatW jointAngle = b2Atan2W( relQ.S, relQ.C );
+
+		// Lower limit
+		{
+			b2FloatW C = b2SubW( jointAngle, joint->lowerAngle );
+			b2FloatW bias = zero;
+			b2FloatW massScale = one;
+			b2FloatW impulseScale = zero;
+			if ( useBias )
+			{
+				bias = b2MulW( c->biasRate, C );
+				massScale = c->massScale;
+				impulseScale = c->impulseScale;
+			}
+
+			// speculation
+			b2FloatW positive = b2GreaterThanW( C, zero );
+			bias = b2BlendW( bias, b2MulW( C, inv_h ), positive );
+			massScale = b2BlendW( massScale, one, positive );
+			impulseScale = b2BlendW( impulseScale, zero, positive );
+
+			b2FloatW Cdot = b2SubW( wB, wA );
+			b2FloatW oldImpulse = joint->lowerImpulse;
+			b2FloatW impulse = b2SubW( b2MulW( b2MulW( b2NegW( massScale ), joint->axialMass ), b2AddW( Cdot, bias ) ),
+										b2MulW( impulseScale, oldImpulse ) );
+			b2FloatW newImpulse = b2MaxFloatW( b2AddW( oldImpulse, impulse ), zero );
+			impulse = b2SubW( newImpulse, oldImpulse );
+
+			joint->lowerImpulse = b2BlendW( oldImpulse, newImpulse, mask );
+			wA = b2BlendW( wA, b2MulSubW( wA, iA, impulse ), mask );
+			wB = b2BlendW( wB, b2MulAddW( wB, iB, impulse ), mask );
+		}
+
+		// Upper limit
+		// Note: signs are flipped to keep C positive when the constraint is satisfied.
+		// This also keeps the impulse positive when the limit is active.
+		{
+			b2FloatW C = b2SubW( joint->upperAngle, jointAngle );
+			b2FloatW bias = zero;
+			b2FloatW massScale = one;
+			b2FloatW impulseScale = zero;
+			if ( useBias )
+			{
+				bias = b2MulW( c->biasRate, C );
+				massScale = c->massScale;
+				impulseScale = c->impulseScale;
+			}
+
+			// speculation
+			b2FloatW positive = b2GreaterThanW( C, zero );
+			bias = b2BlendW( bias, b2MulW( C, inv_h ), positive );
+			massScale = b2BlendW( massScale, one, positive );
+			impulseScale = b2BlendW( impulseScale, zero, positive );
+
+			// sign flipped on Cdot
+			b2FloatW Cdot = b2SubW( wA, wB );
+			b2FloatW oldImpulse = joint->upperImpulse;
+			b2FloatW impulse = b2SubW( b2MulW( b2MulW( b2NegW( massScale ), joint->axialMass ), b2AddW( Cdot, bias ) ),
+										b2MulW( impulseScale, oldImpulse ) );
+			b2FloatW newImpulse = b2MaxFloatW( b2AddW( oldImpulse, impulse ), zero );
+			impulse = b2SubW( newImpulse, oldImpulse );
+
+			// sign flipped on applied impulse
+			joint->upperImpulse = b2BlendW( oldImpulse, newImpulse, mask );
+			wA = b2BlendW( wA, b2MulAddW( wA, iA, impulse ), mask );
+			wB = b2BlendW( wB, b2MulSubW( wB, iB, impulse ), mask );
+		}
+	}
+
+	// Solve point-to-point constraint
+	{
+		b2FloatW useBiasMask = useBias ? b2EqualsW( zero, zero ) : zero;
+		b2Vec2W impulse = b2SolvePointConstraintW( c, &vA, &wA, &vB, &wB, bA, bB, joint->linearImpulse, c->biasRate,
+												   c->massScale, c->impulseScale, useBiasMask );
+		joint->linearImpulse = b2AddVW( joint->linearImpulse, impulse );
+	}
+
+	bA->v = vA;
+	bA->w = wA;
+	bB->v = vB;
+	bB->w = wB;
+}
+
+// Matches b2SolveWeldJoint
+static void b2SolveWeldJointW( b2JointConstraintWide* c, b2BodyStateW* bA, b2BodyStateW* bB, bool useBias )
+{
+	b2WeldConstraintW* joint = &c->weld;
+
+	b2FloatW iA = c->invIA;
+	b2FloatW iB = c->invIB;
+
+	b2Vec2W vA = bA->v;
+	b2FloatW wA = bA->w;
+	b2Vec2W vB = bB->v;
+	b2FloatW wB = bB->w;
+
+	b2FloatW zero = b2ZeroW();
+	b2FloatW allSet = b2EqualsW( zero, zero );
+
+	// angular constraint
+	{
+		b2RotW qA = b2MulRotW( bA->dq, c->frameA );
+		b2RotW qB = b2MulRotW( bB->dq, c->frameB );
+		b2RotW relQ = b2InvMulRotW( qA, qB );
+		b2FloatW jointAngle = b2Atan2W( relQ.S, relQ.C );
+
+		b2FloatW mask = useBias ? allSet : joint->angularSpring;
+		b2FloatW bias = b2BlendW( zero, b2MulW( joint->angularBiasRate, jointAngle ), mask );
+		b2FloatW massScale = b2BlendW( b2SplatW( 1.0f ), joint->angularMassScale, mask );
+		b2FloatW impulseScale = b2BlendW( zero, joint->angularImpulseScale, mask );
+
+		b2FloatW Cdot = b2SubW( wB, wA );
+		b2FloatW impulse = b2SubW( b2MulW( b2MulW( b2NegW( massScale ), joint->axialMass ), b2AddW( Cdot, bias ) ),
+									b2MulW( impulseScale, joint->angularImpulse ) );
+		joint->angularImpulse = b2AddW( joint->angularImpulse, impulse );
+
+		wA = b2MulSubW( wA, iA, impulse );
+		wB = b2MulAddW( wB, iB, impulse );
+	}
+
+	// linear constraint
+	{
+		b2FloatW mask = useBias ? allSet : joint->linearSpring;
+		b2Vec2W impulse = b2SolvePointConstraintW( c, &vA, &wA, &vB, &wB, bA, bB, joint->linearImpulse, joint->linearBiasRate,
+												   joint->linearMassScale, joint->linearImpulseScale, mask );
+		joint->linearImpulse = b2AddVW( joint->linearImpulse, impulse );
+	}
+
+	bA->v = vA;
+	bA->w = wA;
+	bB->v = vB;
+	bB->w = wB;
+}
+
+// Applies an axial impulse of a prismatic joint to the lanes in mask. The sign is flipped for the upper limit.
+static void b2ApplyAxialImpulseW( b2JointConstraintWide* c, b2Vec2W* vA, b2FloatW* wA, b2Vec2W* vB, b2FloatW* wB, b2Vec2W axisA,
+								  b2FloatW a1, b2FloatW a2, b2FloatW impulse, b2FloatW mask, bool flip )
+{
+	b2Vec2W P = { b2MulW( impulse, axisA.X ), b2MulW( impulse, axisA.Y ) };
+	b2FloatW LA = b2MulW( impulse, a1 );
+	b2FloatW LB = b2MulW( impulse, a2 );
+
+	b2Vec2W newVA, newVB;
+	b2FloatW newWA, newWB;
+	if ( flip == false )
+	{
+		newVA = (b2Vec2W){ b2MulSubW( vA->X, c->invMassA, P.X ), b2MulSubW( vA->Y, c->invMassA, P.Y ) };
+		newWA = b2MulSubW( *wA, c->invIA, LA );
+		newVB = (b2Vec2W){ b2MulAddW( vB->X, c->invMassB, P.X ), b2MulAddW( vB->Y, c->invMassB, P.Y ) };
+		newWB = b2MulAddW( *wB, c->invIB, LB );
+	}
+	else
+	{
+		newVA = (b2Vec2W){ b2MulAddW( vA->X, c->invMassA, P.X ), b2MulAddW( vA->Y, c->invMassA, P.Y ) };
+		newWA = b2MulAddW( *wA, c->invIA, LA );
+		newVB = (b2Vec2W){ b2MulSubW( vB->X, c->invMassB, P.X ), b2MulSubW( vB->Y, c->invMassB, P.Y ) };
+		newWB = b2MulSubW( *wB, c->invIB, LB );
+	}
+
+	vA->X = b2BlendW( vA->X, newVA.X, mask );
+	vA->Y = b2BlendW( vA->Y, newVA.Y, mask );
+	*wA = b2BlendW( *wA, newWA, mask );
+	vB->X = b2BlendW( vB->X, newVB.X, mask );
+	vB->Y = b2BlendW( vB->Y, newVB.Y, mask );
+	*wB = b2BlendW( *wB, newWB, mask );
+}
+
+// Matches b2SolvePrismaticJoint
+static void b2SolvePrismaticJointW( b2JointConstraintWide* c, b2BodyStateW* bA, b2BodyStateW* bB, b2FloatW inv_h, bool useBias )
+{
+	b2PrismaticConstraintW* joint = &c->prismatic;
+
+	b2FloatW mA = c->invMassA;
+	b2FloatW mB = c->invMassB;
+	b2FloatW iA = c->invIA;
+	b2FloatW iB = c->invIB;
+
+	b2Vec2W vA = bA->v;
+	b2FloatW wA = bA->w;
+	b2Vec2W vB = bB->v;
+	b2FloatW wB = bB->w;
+
+	b2FloatW zero = b2ZeroW();
+	b2FloatW one = b2SplatW( 1.0f );
+
+	// current anchors
+	b2Vec2W rA = b2RotateVectorW( bA->dq, c->anchorA );
+	b2Vec2W rB = b2RotateVectorW( bB->dq, c->anchorB );
+
+	b2Vec2W d = b2AddVW( b2AddVW( b2SubVW( bB->dp, bA->dp ), c->deltaCenter ), b2SubVW( rB, rA ) );
+	b2Vec2W axisA = b2RotateVectorW( bA->dq, joint->axis );
+	b2FloatW translation = b2DotW( axisA, d );
+
+	// These scalars are for torques generated by axial forces
+	b2FloatW a1 = b2CrossW( b2AddVW( rA, d ), axisA );
+	b2FloatW a2 = b2CrossW( rB, axisA );
+
+	b2FloatW k = b2AddW( b2AddW( b2AddW( mA, mB ), b2MulW( b2MulW( iA, a1 ), a1 ) ), b2MulW( b2MulW( iB, a2 ), a2 ) );
+	b2FloatW axialMass = b2BlendW( zero, b2DivW( one, k ), b2GreaterThanW( k, zero ) );
+
+	// spring constraint
+	if ( c->anySpring )
+	{
+		// This is a real spring and should be applied even during relax
+		b2FloatW C = b2SubW( translation, joint->targetTranslation );
+		b2FloatW bias = b2MulW( joint->springBiasRate, C );
+		b2FloatW massScale = joint->springMassScale;
+		b2FloatW impulseScale = joint->springImpulseScale;
+
+		b2FloatW Cdot = b2SubW( b2AddW( b2DotW( axisA, b2SubVW( vB, vA ) ), b2MulW( a2, wB ) ), b2MulW( a1, wA ) );
+		b2FloatW deltaImpulse = b2SubW( b2MulW( b2MulW( b2NegW( massScale ), axialMass ), b2AddW( Cdot, bias ) ),
+										 b2MulW( impulseScale, joint->springImpulse ) );
+
+		b2FloatW mask = joint->enableSpring;
+		joint->springImpulse = b2BlendW( joint->springImpulse, b2AddW( joint->springImpulse, deltaImpulse ), mask );
+		b2ApplyAxialImpulseW( c, &vA, &wA, &vB, &wB, axisA, a1, a2, deltaImpulse, mask, false );
+	}
+
+	// Solve motor constraint
+	if ( c->anyMotor )
+	{
+		b2FloatW Cdot = b2SubW( b2AddW( b2DotW( axisA, b2SubVW( vB, vA ) ), b2MulW( a2, wB ) ), b2MulW( a1, wA ) );
+		b2FloatW impulse = b2MulW( axialMass, b2SubW( joint->motorSpeed, Cdot ) );
+		b2FloatW oldImpulse = joint->motorImpulse;
+		b2FloatW maxImpulse = joint->maxMotorImpulse;
+		b2FloatW newImpulse = b2ClampFloatW( b2AddW( oldImpulse, impulse ), b2NegW( maxImpulse ), maxImpulse );
+		impulse = b2SubW( newImpulse, oldImpulse );
+
+		b2FloatW mask = joint->enableMotor;
+		joint->motorImpulse = b2BlendW( oldImpulse, newImpulse, mask );
+		b2ApplyAxialImpulseW( c, &vA, &wA, &vB, &wB, axisA, a1, a2, impulse, mask, false );
+	}
+
+	if ( c->anyLimit )
+	{
+		b2FloatW safe = b2SplatW( b2GetLengthUnitsPerMeter() );
+		b2FloatW speculativeDistance = joint->speculativeDistance;
+
+		// Lower limit
+		{
+			b2FloatW C = b2SubW( translation, joint->lowerTranslation );
+			b2FloatW active = b2LessThanW( C, speculativeDistance );
+
+			b2FloatW bias = zero;
+			b2FloatW massScale = one;
+			b2FloatW impulseScale = zero;
+			if ( useBias )
+			{
+				bias = b2MulW( c->biasRate, C );
+				massScale = c->massScale;
+				impulseScale = c->impulseScale;
+			}
+
+			// speculation
+			b2FloatW positive = b2GreaterThanW( C, zero );
+			bias = b2BlendW( bias, b2MulW( b2MinFloatW( C, safe ), inv_h ), positive );
+			massScale = b2BlendW( massScale, one, positive );
+			impulseScale = b2BlendW( impulseScale, zero, positive );
+
+			b2FloatW oldImpulse = joint->lowerImpulse;
+			b2FloatW Cdot = b2SubW( b2AddW( b2DotW( axisA, b2SubVW( vB, vA ) ), b2MulW( a2, wB ) ), b2MulW( a1, wA ) );
+			b2FloatW deltaImpulse = b2SubW( b2MulW( b2MulW( b2NegW( axialMass ), massScale ), b2AddW( Cdot, bias ) ),
+											 b2MulW( impulseScale, oldImpulse ) );
+			b2FloatW newImpulse = b2MaxFloatW( b2AddW( oldImpulse, deltaImpulse ), zero );
+			deltaImpulse = b2SubW( newImpulse, oldImpulse );
+
+			// inactive limits drop their impulse
+			b2FloatW mask = b2AndW( joint->enableLimit, active );
+			joint->lowerImpulse = b2BlendW( oldImpulse, b2BlendW( zero, newImpulse, active ), joint->enableLimit );
+			b2ApplyAxialImpulseW( c, &vA, &wA, &vB, &wB, axisA, a1, a2, deltaImpulse, mask, false );
+		}
+
+		// Upper limit
+		// Note: signs are flipped to keep C positive when the constraint is satisfied.
+		// This also keeps the impulse positive when the limit is active.
+		{
+			// sign flipped
+			b2FloatW C = b2SubW( joint->upperTranslation, translation );
+			b2FloatW active = b2LessThanW( C, speculativeDistance );
+
+			b2FloatW bias = zero;
+			b2FloatW massScale = one;
+			b2FloatW impulseScale = zero;
+			if ( useBias )
+			{
+				bias = b2MulW( c->biasRate, C );
+				massScale = c->massScale;
+				impulseScale = c->impulseScale;
+			}
+
+			// speculation
+			b2FloatW positive = b2GreaterThanW( C, zero );
+			bias = b2BlendW( bias, b2MulW( b2MinFloatW( C, safe ), inv_h ), positive );
+			massScale = b2BlendW( massScale, one, positive );
+			impulseScale = b2BlendW( impulseScale, zero, positive );
+
+			b2FloatW oldImpulse = joint->upperImpulse;
+
+			// sign flipped
+			b2FloatW Cdot = b2SubW( b2AddW( b2DotW( axisA, b2SubVW( vA, vB ) ), b2MulW( a1, wA ) ), b2MulW( a2, wB ) );
+			b2FloatW deltaImpulse = b2SubW( b2MulW( b2MulW( b2NegW( axialMass ), massScale ), b2AddW( Cdot, bias ) ),
+											 b2MulW( impulseScale, oldImpulse ) );
+			b2FloatW newImpulse = b2MaxFloatW( b2AddW( oldImpulse, deltaImpulse ), zero );
+			deltaImpulse = b2SubW( newImpulse, oldImpulse );
+
+			b2FloatW mask = b2AndW( joint->enableLimit, active );
+			joint->upperImpulse = b2BlendW( oldImpulse, b2BlendW( zero, newImpulse, active ), joint->enableLimit );
+			b2ApplyAxialImpulseW( c, &vA, &wA, &vB, &wB, axisA, a1, a2, deltaImpulse, mask, true );
+		}
+	}
+
+	// Solve the prismatic constraint in block form
+	{
+		b2Vec2W perpA = { b2NegW( axisA.Y ), axisA.X };
+
+		// These scalars are for torques generated by the perpendicular constraint force
+		b2FloatW s1 = b2CrossW( b2AddVW( d, rA ), perpA );
+		b2FloatW s2 = b2CrossW( rB, perpA );
+
+		b2Vec2W Cdot;
+		Cdot.X = b2SubW( b2AddW( b2DotW( perpA, b2SubVW( vB, vA ) ), b2MulW( s2, wB ) ), b2MulW( s1, wA ) );
+		Cdot.Y = b2SubW( wB, wA );
+
+		b2Vec2W bias = { zero, zero };
+		b2FloatW massScale = one;
+		b2FloatW impulseScale = zero;
+		if ( useBias )
+		{
+			b2RotW qA = b2MulRotW( bA->dq, c->frameA );
+			b2RotW qB = b2MulRotW( bB->dq, c->frameB );
+			b2RotW relQ = b2InvMulRotW( qA, qB );
+
+			bias.X = b2MulW( c->biasRate, b2DotW( perpA, d ) );
+			bias.Y = b2MulW( c->biasRate, b2Atan2W( relQ.S, relQ.C ) );
+			massScale = c->massScale;
+			impulseScale = c->impulseScale;
+		}
+
+		b2FloatW k11 = b2AddW( b2AddW( b2AddW( mA, mB ), b2MulW( b2MulW( iA, s1 ), s1 ) ), b2MulW( b2MulW( iB, s2 ), s2 ) );
+		b2FloatW k12 = b2AddW( b2MulW( iA, s1 ), b2MulW( iB, s2 ) );
+		b2FloatW k22 = b2AddW( iA, iB );
+
+		// For bodies with fixed rotation.
+		k22 = b2BlendW( k22, one, b2EqualsW( k22, zero ) );
+
+		b2Vec2W b = b2Solve22W( k11, k12, k12, k22, b2AddVW( Cdot, bias ) );
+
+		b2FloatW negMassScale = b2NegW( massScale );
+		b2Vec2W deltaImpulse;
+		deltaImpulse.X = b2SubW( b2MulW( negMassScale, b.X ), b2MulW( impulseScale, joint->impulse.X ) );
+		deltaImpulse.Y = b2SubW( b2MulW( negMassScale, b.Y ), b2MulW( impulseScale, joint->impulse.Y ) );
+
+		joint->impulse = b2AddVW( joint->impulse, deltaImpulse );
+
+		b2Vec2W P = { b2MulW( deltaImpulse.X, perpA.X ), b2MulW( deltaImpulse.X, perpA.Y ) };
+		b2FloatW LA = b2AddW( b2MulW( deltaImpulse.X, s1 ), deltaImpulse.Y );
+		b2FloatW LB = b2AddW( b2MulW( deltaImpulse.X, s2 ), deltaImpulse.Y );
+
+		vA.X = b2MulSubW( vA.X, mA, P.X );
+		vA.Y = b2MulSubW( vA.Y, mA, P.Y );
+		wA = b2MulSubW( wA, iA, LA );
+		vB.X = b2MulAddW( vB.X, mB, P.X );
+		vB.Y = b2MulAddW( vB.Y, mB, P.Y );
+		wB = b2MulAddW( wB, iB, LB );
+	}
+
+	bA->v = vA;
+	bA->w = wA;
+	bB->v = vB;
+	bB->w = wB;
+}
+
+static void b2SolveWideJoint( b2JointConstraintWide* c, b2BodyState* states, b2FloatW inv_h, bool useBias )
+{
+	b2BodyStateW bA = b2GatherBodies( states, c->indexA );
+	b2BodyStateW bB = b2GatherBodies( states, c->indexB );
+
+	switch ( c->type )
+	{
+		case b2_revoluteJoint:
+			b2SolveRevoluteJointW( c, &bA, &bB, inv_h, useBias );
+			break;
+
+		case b2_weldJoint:
+			b2SolveWeldJointW( c, &bA, &bB, useBias );
+			break;
+
+		case b2_prismaticJoint:
+			b2SolvePrismaticJointW( c, &bA, &bB, inv_h, useBias );
+			break;
+
+		default:
+			B2_ASSERT( false );
+	}
+
+	b2ScatterBodies( states, c->indexA, &bA );
+	b2ScatterBodies( states, c->indexB, &bB );
+}
+
+static void b2StoreWideJointImpulses( const b2JointConstraintWide* c )
+{
+	for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+	{
+		b2JointSim* base = c->joints[lane];
+		if ( base == NULL )
+		{
+			break;
+		}
+
+		switch ( c->type )
+		{
+			case b2_revoluteJoint:
+			{
+				b2RevoluteJoint* joint = &base->revoluteJoint;
+				const b2RevoluteConstraintW* w = &c->revolute;
+				joint->linearImpulse.x = b2GetLaneW( &w->linearImpulse.X, lane );
+				joint->linearImpulse.y = b2GetLaneW( &w->linearImpulse.Y, lane );
+				joint->motorImpulse = b2GetLaneW( &w->motorImpulse, lane );
+				joint->lowerImpulse = b2GetLaneW( &w->lowerImpulse, lane );
+				joint->upperImpulse = b2GetLaneW( &w->upperImpulse, lane );
+			}
+			break;
+
+			case b2_weldJoint:
+			{
+				b2WeldJoint* joint = &base->weldJoint;
+				const b2WeldConstraintW* w = &c->weld;
+				joint->linearImpulse.x = b2GetLaneW( &w->linearImpulse.X, lane );
+				joint->linearImpulse.y = b2GetLaneW( &w->linearImpulse.Y, lane );
+				joint->angularImpulse = b2GetLaneW( &w->angularImpulse, lane );
+			}
+			break;
+
+			case b2_prismaticJoint:
+			{
+				b2PrismaticJoint* joint = &base->prismaticJoint;
+				const b2PrismaticConstraintW* w = &c->prismatic;
+				joint->impulse.x = b2GetLaneW( &w->impulse.X, lane );
+				joint->impulse.y = b2GetLaneW( &w->impulse.Y, lane );
+				joint->springImpulse = b2GetLaneW( &w->springImpulse, lane );
+				joint->motorImpulse = b2GetLaneW( &w->motorImpulse, lane );
+				joint->lowerImpulse = b2GetLaneW( &w->lowerImpulse, lane );
+				joint->upperImpulse = b2GetLaneW( &w->upperImpulse, lane );
+			}
+			break;
+
+			default:
+				B2_ASSERT( false );
+		}
+	}
+}
+
+// Runs as a flat parallel-for over the joint work items of all colors, like b2PrepareContactsTask.
+void b2PrepareJointsTask( b2SolverBlock block, b2StepContext* context )
+{
+	b2TracyCZoneNC( prepare_joints, "PrepJoints", b2_colorOldLace, true );
+
+	b2JointPrepareSpan* spans = context->jointPrepareSpans;
+
+	int index = block.startIndex;
+	int endIndex = block.startIndex + block.count;
+
+	// Find color for start index. Linear search but fast.
+	int colorIndex = 0;
+	while ( spans[colorIndex + 1].start <= index )
+	{
+		colorIndex += 1;
+	}
+
+	// Loop over block
+	while ( index < endIndex )
+	{
+		int colorStart = spans[colorIndex].start;
+		int colorEndIndex = b2MinInt( spans[colorIndex + 1].start, endIndex );
+		b2GraphColor* color = spans[colorIndex].color;
+		int wideCount = color->wideJointCount;
+
+		// Loop over color
+		for ( ; index < colorEndIndex; ++index )
+		{
+			int localIndex = index - colorStart;
+			B2_ASSERT( 0 <= localIndex && localIndex < spans[colorIndex].count );
+
+			if ( localIndex < wideCount )
+			{
+				b2PrepareWideJoint( color->wideJoints + localIndex, context );
+			}
+			else
+			{
+				b2PrepareJoint( color->scalarJoints[localIndex - wideCount], context );
+			}
+		}
+
+		// Advance to next color
+		colorIndex += 1;
+	}
+
+	b2TracyCZoneEnd( prepare_joints );
+}
+
+void b2WarmStartJointsTask( b2SolverBlock block, b2StepContext* context )
+{
+	b2TracyCZoneNC( warm_joints, "WarmJoints", b2_colorGold, true );
+
+	b2GraphColor* color = context->graph->colors + block.colorIndex;
+	int wideCount = color->wideJointCount;
+	b2BodyState* states = context->states;
+
+	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
+	{
+		if ( i < wideCount )
+		{
+			b2WarmStartWideJoint( color->wideJoints + i, states );
+		}
+		else
+		{
+			b2WarmStartJoint( color->scalarJoints[i - wideCount], context );
+		}
+	}
+
+	b2TracyCZoneEnd( warm_joints );
+}
+
+void b2SolveJointsTask( b2SolverBlock block, b2StepContext* context, bool useBias, int workerIndex )
+{
+	b2TracyCZoneNC( solve_joints, "SolveJoints", b2_colorLemonChiffon, true );
+
+	b2GraphColor* color = context->graph->colors + block.colorIndex;
+	int wideCount = color->wideJointCount;
+	b2BodyState* states = context->states;
+	b2FloatW inv_h = b2SplatW( context->inv_h );
+
+	B2_ASSERT( 0 <= block.startIndex && block.startIndex + block.count <= wideCount + color->scalarJointCount );
+
+	b2BitSet* jointStateBitSet = &context->world->taskContexts.data[workerIndex].jointStateBitSet;
+
+	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
+	{
+		if ( i < wideCount )
+		{
+			b2SolveWideJoint( color->wideJoints + i, states, inv_h, useBias );
+			continue;
+		}
+
+		b2JointSim* joint = color->scalarJoints[i - wideCount];
+		b2SolveJoint( joint, context, useBias );
+
+		if ( useBias && ( joint->forceThreshold < FLT_MAX || joint->torqueThreshold < FLT_MAX ) &&
+			 b2GetBit( jointStateBitSet, joint->jointId ) == false )
+		{
+			float force, torque;
+			b2GetJointReaction( joint, context->inv_h, &force, &torque );
+
+			// Check thresholds. A zero threshold means all awake joints get reported.
+			if ( force >= joint->forceThreshold || torque >= joint->torqueThreshold )
+			{
+				// Flag this joint for processing.
+				b2SetBit( jointStateBitSet, joint->jointId );
+			}
+		}
+	}
+
+	b2TracyCZoneEnd( solve_joints );
+}
+
+// Copies the wide joint impulses back to the joint sims for warm starting and joint queries.
+// Uses the same flat blocks as b2PrepareJointsTask.
+void b2StoreJointImpulsesTask( b2SolverBlock block, b2StepContext* context )
+{
+	b2TracyCZoneNC( store_joints, "Store Joints", b2_colorFireBrick, true );
+
+	b2JointPrepareSpan* spans = context->jointPrepareSpans;
+
+	int index = block.startIndex;
+	int endIndex = block.startIndex + block.count;
+
+	int colorIndex = 0;
+	while ( spans[colorIndex + 1].start <= index )
+	{
+		colorIndex += 1;
+	}
+
+	while ( index < endIndex )
+	{
+		int colorStart = spans[colorIndex].start;
+		int colorEndIndex = b2MinInt( spans[colorIndex + 1].start, endIndex );
+		b2GraphColor* color = spans[colorIndex].color;
+
+		// Scalar joints store their impulses directly
+		int wideEndIndex = b2MinInt( colorStart + color->wideJointCount, colorEndIndex );
+		for ( ; index < wideEndIndex; ++index )
+		{
+			b2StoreWideJointImpulses( color->wideJoints + ( index - colorStart ) );
+		}
+
+		index = colorEndIndex;
+		colorIndex += 1;
+	}
+
+	b2TracyCZoneEnd( store_joints );
+}
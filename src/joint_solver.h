@@ -0,0 +1,27 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "solver.h"
+
+typedef struct b2GraphColor b2GraphColor;
+typedef struct b2JointConstraintWide b2JointConstraintWide;
+typedef struct b2JointSim b2JointSim;
+
+// This function allows hiding SIMD intrinsics in the source file to improve compilation performance.
+int b2GetWideJointConstraintByteCount( void );
+
+// Upper bound on the number of wide joint constraints for a color holding this many joints
+int b2GetWideJointCapacity( int jointCount );
+
+// Packs the revolute, weld, and prismatic joints of a graph color into wide constraints of a single
+// joint type. The other joints are listed in scalarJoints and solved one at a time. Returns the number
+// of joint work items in the color: the wide constraints followed by the scalar joints.
+int b2BuildWideJoints( b2GraphColor* color, b2JointConstraintWide* wideJoints, b2JointSim** scalarJoints );
+
+// Joints that live within the constraint graph coloring
+void b2PrepareJointsTask( b2SolverBlock block, b2StepContext* context );
+void b2WarmStartJointsTask( b2SolverBlock block, b2StepContext* context );
+void b2SolveJointsTask( b2SolverBlock block, b2StepContext* context, bool useBias, int workerIndex );
+void b2StoreJointImpulsesTask( b2SolverBlock block, b2StepContext* context );
@@ -0,0 +1,388 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "mesh.h"
+
+#include "core.h"
+
+#include "box2d/math_functions.h"
+
+#include <stddef.h>
+
+// Maximum number of segments in a mesh leaf
+#define B2_MESH_LEAF_SIZE 4
+
+// The mesh hierarchy is built with median splits so the depth is logarithmic
+#define B2_MESH_STACK_SIZE 64
+
+static float b2GetSegmentKey( const b2ChainSegment* segment, int axis )
+{
+	// Twice the center, the scale doesn't matter for sorting
+	if ( axis == 0 )
+	{
+		return segment->segment.point1.x + segment->segment.point2.x;
+	}
+
+	return segment->segment.point1.y + segment->segment.point2.y;
+}
+
+// Partially sort the segments so that the segment at index k is in sorted position along the axis.
+// Segments before k are not above it and segments after k are not below it.
+static void b2SelectMeshSegments( b2ChainSegment* segments, int count, int k, int axis )
+{
+	int left = 0;
+	int right = count - 1;
+	while ( left < right )
+	{
+		float pivot = b2GetSegmentKey( segments + ( left + right ) / 2, axis );
+		int i = left;
+		int j = right;
+		while ( i <= j )
+		{
+			while ( b2GetSegmentKey( segments + i, axis ) < pivot )
+			{
+				i += 1;
+			}
+
+			while ( pivot < b2GetSegmentKey( segments + j, axis ) )
+			{
+				j -= 1;
+			}
+
+			if ( i <= j )
+			{
+				b2ChainSegment temp = segments[i];
+				segments[i] = segments[j];
+				segments[j] = temp;
+				i += 1;
+				j -= 1;
+			}
+		}
+
+		if ( k <= j )
+		{
+			right = j;
+		}
+		else if ( i <= k )
+		{
+			left = i;
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+static int b2BuildMeshNode( b2MeshShape* mesh, int start, int count, int capacity )
+{
+	B2_ASSERT( count > 0 );
+
+	int nodeIndex = mesh->nodeCount;
+	B2_ASSERT( nodeIndex < capacity );
+	B2_UNUSED( capacity );
+	mesh->nodeCount += 1;
+
+	b2ChainSegment* segments = mesh->segments + start;
+
+	b2AABB aabb = { b2Min( segments[0].segment.point1, segments[0].segment.point2 ),
+					b2Max( segments[0].segment.point1, segments[0].segment.point2 ) };
+	b2Vec2 center = b2Lerp( segments[0].segment.point1, segments[0].segment.point2, 0.5f );
+	b2AABB centerBounds = { center, center };
+
+	for ( int i = 1; i < count; ++i )
+	{
+		b2Vec2 p1 = segments[i].segment.point1;
+		b2Vec2 p2 = segments[i].segment.point2;
+		aabb.lowerBound = b2Min( aabb.lowerBound, b2Min( p1, p2 ) );
+		aabb.upperBound = b2Max( aabb.upperBound, b2Max( p1, p2 ) );
+
+		center = b2Lerp( p1, p2, 0.5f );
+		centerBounds.lowerBound = b2Min( centerBounds.lowerBound, center );
+		centerBounds.upperBound = b2Max( centerBounds.upperBound, center );
+	}
+
+	b2MeshNode* node = mesh->nodes + nodeIndex;
+	node->aabb = aabb;
+
+	if ( count <= B2_MESH_LEAF_SIZE )
+	{
+		node->index = start;
+		node->count = count;
+		return nodeIndex;
+	}
+
+	// Split at the median of the segment centers along the longest axis
+	b2Vec2 spread = b2Sub( centerBounds.upperBound, centerBounds.lowerBound );
+	int axis = spread.x >= spread.y ? 0 : 1;
+	int half = count / 2;
+	b2SelectMeshSegments( segments, count, half, axis );
+
+	// The first child follows this node
+	b2BuildMeshNode( mesh, start, half, capacity );
+	int child2 = b2BuildMeshNode( mesh, start + half, count - half, capacity );
+
+	node = mesh->nodes + nodeIndex;
+	node->index = child2;
+	node->count = 0;
+	return nodeIndex;
+}
+
+b2MeshShape* b2AllocMeshShapeData( int segmentCount, int nodeCount )
+{
+	B2_ASSERT( segmentCount > 0 && nodeCount > 0 );
+
+	int byteCount = (int)sizeof( b2MeshShape ) + segmentCount * (int)sizeof( b2ChainSegment ) +
+					nodeCount * (int)sizeof( b2MeshNode );
+	b2MeshShape* mesh = b2Alloc( byteCount );
+	mesh->segments = (b2ChainSegment*)( mesh + 1 );
+	mesh->nodes = (b2MeshNode*)( mesh->segments + segmentCount );
+	mesh->segmentCount = segmentCount;
+	mesh->nodeCount = nodeCount;
+	mesh->byteCount = byteCount;
+	return mesh;
+}
+
+b2MeshShape* b2CreateMeshShapeData( const b2Mesh* mesh )
+{
+	int segmentCount = mesh->count;
+	B2_ASSERT( segmentCount > 0 );
+
+	// A median split tree has fewer than two nodes per segment
+	int capacity = 2 * segmentCount - 1;
+	b2MeshShape* data = b2AllocMeshShapeData( segmentCount, capacity );
+
+	for ( int i = 0; i < segmentCount; ++i )
+	{
+		b2ChainSegment segment = mesh->segments[i];
+		B2_ASSERT( b2IsValidVec2( segment.ghost1 ) && b2IsValidVec2( segment.ghost2 ) );
+		B2_ASSERT( b2IsValidVec2( segment.segment.point1 ) && b2IsValidVec2( segment.segment.point2 ) );
+
+		// Mesh segments don't belong to a chain shape
+		segment.chainId = B2_NULL_INDEX;
+		data->segments[i] = segment;
+	}
+
+	data->nodeCount = 0;
+	b2BuildMeshNode( data, 0, segmentCount, capacity );
+	return data;
+}
+
+void b2DestroyMeshShapeData( b2MeshShape* mesh )
+{
+	if ( mesh != NULL )
+	{
+		b2Free( mesh, mesh->byteCount );
+	}
+}
+
+void b2QueryMesh( const b2MeshShape* mesh, b2AABB aabb, b2MeshQueryFcn* fcn, void* context )
+{
+	const b2MeshNode* nodes = mesh->nodes;
+	const b2ChainSegment* segments = mesh->segments;
+
+	int stack[B2_MESH_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = 0;
+
+	while ( stackCount > 0 )
+	{
+		const b2MeshNode* node = nodes + stack[--stackCount];
+		if ( b2AABB_Overlaps( node->aabb, aabb ) == false )
+		{
+			continue;
+		}
+
+		if ( node->count > 0 )
+		{
+			int end = node->index + node->count;
+			for ( int i = node->index; i < end; ++i )
+			{
+				b2Vec2 p1 = segments[i].segment.point1;
+				b2Vec2 p2 = segments[i].segment.point2;
+				b2AABB segmentAABB = { b2Min( p1, p2 ), b2Max( p1, p2 ) };
+				if ( b2AABB_Overlaps( aabb, segmentAABB ) == false )
+				{
+					continue;
+				}
+
+				if ( fcn( segments + i, i, context ) == false )
+				{
+					return;
+				}
+			}
+		}
+		else
+		{
+			B2_ASSERT( stackCount < B2_MESH_STACK_SIZE - 1 );
+			int nodeIndex = (int)( node - nodes );
+			stack[stackCount++] = node->index;
+			stack[stackCount++] = nodeIndex + 1;
+		}
+	}
+}
+
+typedef b2CastOutput b2MeshCastFcn( const b2ChainSegment* segment, float maxFraction, const void* input );
+
+// Sweep a box with half-widths extension from p1 along d and report the closest segment hit
+static b2CastOutput b2CastMesh( const b2MeshShape* mesh, b2Vec2 p1, b2Vec2 extension, b2Vec2 d, float maxFraction,
+								b2MeshCastFcn* fcn, const void* input )
+{
+	b2CastOutput result = { 0 };
+
+	// v is perpendicular to the segment.
+	b2Vec2 v = b2CrossSV( 1.0f, b2Normalize( d ) );
+	b2Vec2 abs_v = b2Abs( v );
+
+	b2Vec2 p2 = b2MulAdd( p1, maxFraction, d );
+	b2AABB sweptBox = { b2Sub( b2Min( p1, p2 ), extension ), b2Add( b2Max( p1, p2 ), extension ) };
+
+	const b2MeshNode* nodes = mesh->nodes;
+	const b2ChainSegment* segments = mesh->segments;
+
+	int stack[B2_MESH_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = 0;
+
+	while ( stackCount > 0 )
+	{
+		int nodeIndex = stack[--stackCount];
+		const b2MeshNode* node = nodes + nodeIndex;
+
+		if ( b2AABB_Overlaps( node->aabb, sweptBox ) == false )
+		{
+			continue;
+		}
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		b2Vec2 c = b2AABB_Center( node->aabb );
+		b2Vec2 h = b2Add( b2AABB_Extents( node->aabb ), extension );
+		float term1 = b2AbsFloat( b2Dot( v, b2Sub( p1, c ) ) );
+		float term2 = b2Dot( abs_v, h );
+		if ( term2 < term1 )
+		{
+			continue;
+		}
+
+		if ( node->count > 0 )
+		{
+			int end = node->index + node->count;
+			for ( int i = node->index; i < end; ++i )
+			{
+				b2CastOutput output = fcn( segments + i, maxFraction, input );
+				if ( output.hit && ( result.hit == false || output.fraction < maxFraction ) )
+				{
+					result = output;
+					maxFraction = output.fraction;
+					p2 = b2MulAdd( p1, maxFraction, d );
+					sweptBox.lowerBound = b2Sub( b2Min( p1, p2 ), extension );
+					sweptBox.upperBound = b2Add( b2Max( p1, p2 ), extension );
+				}
+			}
+		}
+		else
+		{
+			B2_ASSERT( stackCount < B2_MESH_STACK_SIZE - 1 );
+
+			// Visit the closer child first to shrink the sweep sooner
+			int child1 = nodeIndex + 1;
+			int child2 = node->index;
+			b2Vec2 c1 = b2AABB_Center( nodes[child1].aabb );
+			b2Vec2 c2 = b2AABB_Center( nodes[child2].aabb );
+			if ( b2DistanceSquared( c1, p1 ) < b2DistanceSquared( c2, p1 ) )
+			{
+				stack[stackCount++] = child2;
+				stack[stackCount++] = child1;
+			}
+			else
+			{
+				stack[stackCount++] = child1;
+				stack[stackCount++] = child2;
+			}
+		}
+	}
+
+	return result;
+}
+
+static b2CastOutput b2RayCastMeshSegment( const b2ChainSegment* segment, float maxFraction, const void* context )
+{
+	b2RayCastInput input = *(const b2RayCastInput*)context;
+	input.maxFraction = maxFraction;
+	return b2RayCastSegment( &segment->segment, &input, true );
+}
+
+b2CastOutput b2RayCastMesh( const b2MeshShape* mesh, const b2RayCastInput* input )
+{
+	return b2CastMesh( mesh, input->origin, b2Vec2_zero, input->translation, input->maxFraction, b2RayCastMeshSegment, input );
+}
+
+typedef struct b2MeshShapeCastInput
+{
+	const b2ShapeCastInput* input;
+	b2Vec2 centroid;
+} b2MeshShapeCastInput;
+
+static b2CastOutput b2ShapeCastMeshSegment( const b2ChainSegment* segment, float maxFraction, const void* context )
+{
+	const b2MeshShapeCastInput* castInput = context;
+	b2ShapeCastInput input = *castInput->input;
+	input.maxFraction = maxFraction;
+	return b2ShapeCastOneSidedSegment( &segment->segment, &input, castInput->centroid );
+}
+
+b2CastOutput b2ShapeCastMesh( const b2MeshShape* mesh, const b2ShapeCastInput* input )
+{
+	const b2ShapeProxy* proxy = &input->proxy;
+	if ( proxy->count == 0 )
+	{
+		return (b2CastOutput){ 0 };
+	}
+
+	b2AABB box = { proxy->points[0], proxy->points[0] };
+	b2Vec2 centroid = proxy->points[0];
+	for ( int i = 1; i < proxy->count; ++i )
+	{
+		box.lowerBound = b2Min( box.lowerBound, proxy->points[i] );
+		box.upperBound = b2Max( box.upperBound, proxy->points[i] );
+		centroid = b2Add( centroid, proxy->points[i] );
+	}
+
+	b2MeshShapeCastInput castInput;
+	castInput.input = input;
+	castInput.centroid = b2MulSV( 1.0f / proxy->count, centroid );
+
+	b2Vec2 radius = { proxy->radius, proxy->radius };
+	b2Vec2 extension = b2Add( b2AABB_Extents( box ), radius );
+
+	return b2CastMesh( mesh, b2AABB_Center( box ), extension, input->translation, input->maxFraction, b2ShapeCastMeshSegment,
+					   &castInput );
+}
+
+b2CastOutput b2ShapeCastOneSidedSegment( const b2Segment* segment, const b2ShapeCastInput* input, b2Vec2 centroid )
+{
+	// Check for back side collision
+	b2Vec2 edge = b2Sub( segment->point2, segment->point1 );
+	b2Vec2 r = b2Sub( centroid, segment->point1 );
+	if ( b2Cross( r, edge ) < 0.0f )
+	{
+		// Shape cast starts behind
+		return (b2CastOutput){ 0 };
+	}
+
+	return b2ShapeCastSegment( segment, input );
+}
+
+b2AABB b2InvTransformAABB( b2Transform transform, b2AABB aabb )
+{
+	b2Vec2 center = b2InvTransformPoint( transform, b2AABB_Center( aabb ) );
+	b2Vec2 extents = b2AABB_Extents( aabb );
+
+	float c = b2AbsFloat( transform.q.c );
+	float s = b2AbsFloat( transform.q.s );
+	b2Vec2 localExtents = { c * extents.x + s * extents.y, s * extents.x + c * extents.y };
+
+	b2AABB result = { b2Sub( center, localExtents ), b2Add( center, localExtents ) };
+	return result;
+}
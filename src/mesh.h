@@ -0,0 +1,56 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "box2d/collision.h"
+
+// A mesh node covers a contiguous range of segments. Nodes are stored depth first so the first child
+// of an internal node immediately follows it. Internal nodes store the index of the second child.
+typedef struct b2MeshNode
+{
+	b2AABB aabb;
+
+	// second child index for internal nodes, first segment index for leaves
+	int index;
+
+	// number of segments in a leaf, zero for internal nodes
+	int count;
+} b2MeshNode;
+
+// Static mesh geometry owned by a mesh shape. The segments are reordered by the build so each
+// leaf references a contiguous range. The segments and nodes share a single allocation.
+typedef struct b2MeshShape
+{
+	b2ChainSegment* segments;
+	b2MeshNode* nodes;
+	int segmentCount;
+	int nodeCount;
+	int byteCount;
+} b2MeshShape;
+
+// Return false to terminate the query
+typedef bool b2MeshQueryFcn( const b2ChainSegment* segment, int segmentIndex, void* context );
+
+b2MeshShape* b2CreateMeshShapeData( const b2Mesh* mesh );
+b2MeshShape* b2AllocMeshShapeData( int segmentCount, int nodeCount );
+void b2DestroyMeshShapeData( b2MeshShape* mesh );
+
+// Visit the segments whose bounds overlap the local AABB
+void b2QueryMesh( const b2MeshShape* mesh, b2AABB aabb, b2MeshQueryFcn* fcn, void* context );
+
+// These are in the mesh local frame and report the closest hit. Segments are one-sided.
+b2CastOutput b2RayCastMesh( const b2MeshShape* mesh, const b2RayCastInput* input );
+b2CastOutput b2ShapeCastMesh( const b2MeshShape* mesh, const b2ShapeCastInput* input );
+
+// Shape cast against the front side of a one-sided segment. The centroid of the cast proxy is used
+// to reject casts that start behind the segment.
+b2CastOutput b2ShapeCastOneSidedSegment( const b2Segment* segment, const b2ShapeCastInput* input, b2Vec2 centroid );
+
+// Bounding box of an AABB after an inverse transform. Used to find the mesh segments near another shape.
+b2AABB b2InvTransformAABB( b2Transform transform, b2AABB aabb );
+
+static inline b2AABB b2GetMeshBounds( const b2MeshShape* mesh )
+{
+	return mesh->nodes[0].aabb;
+}
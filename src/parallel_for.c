@@ -6,6 +6,7 @@
 #include "atomic.h"
 #include "core.h"
 #include "physics_world.h"
+#include "timeline.h"
 
 #include "box2d/base.h"
 #include "box2d/constants.h"
@@ -22,6 +23,8 @@ typedef struct b2ParallelForShared
 	int itemCount;
 	b2ParallelForCallback* callback;
 	void* context;
+	b2World* world;
+	b2TimelineStage stage;
 } b2ParallelForShared;
 
 typedef struct b2ParallelForTask
@@ -41,6 +44,7 @@ static void b2ParallelForTrampoline( void* taskContext )
 	int blockCount = shared->blockCount;
 	int blockSize = shared->blockSize;
 	int itemCount = shared->itemCount;
+	bool recordTimeline = shared->world->timelineCapacity > 0;
 
 	for ( ;; )
 	{
@@ -57,11 +61,21 @@ static void b2ParallelForTrampoline( void* taskContext )
 			end = itemCount;
 		}
 
-		callback( start, end, workerIndex, context );
+		if ( recordTimeline )
+		{
+			uint64_t startTicks = b2GetTicks();
+			callback( start, end, workerIndex, context );
+			b2AddTimelineEvent( shared->world, workerIndex, shared->stage, startTicks, end - start );
+		}
+		else
+		{
+			callback( start, end, workerIndex, context );
+		}
 	}
 }
 
-void b2ParallelFor( b2World* world, b2ParallelForCallback* callback, int itemCount, int minRange, void* context )
+void b2ParallelFor( b2World* world, b2TimelineStage stage, b2ParallelForCallback* callback, int itemCount, int minRange,
+					void* context )
 {
 	if ( itemCount <= 0 )
 	{
@@ -103,6 +117,8 @@ void b2ParallelFor( b2World* world, b2ParallelForCallback* callback, int itemCou
 	shared.itemCount = itemCount;
 	shared.callback = callback;
 	shared.context = context;
+	shared.world = world;
+	shared.stage = stage;
 	b2AtomicStoreInt( &shared.nextBlock, 0 );
 
 	b2ParallelForTask tasks[B2_MAX_WORKERS];
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include "box2d/types.h"
+
 typedef struct b2World b2World;
 
 // Callback invoked by b2ParallelFor to process a range of items. May be called
@@ -18,5 +20,6 @@ typedef void b2ParallelForCallback( int startIndex, int endIndex, int workerInde
 // claiming the next unclaimed block until the range is drained. Blocks the
 // caller until all work is complete. minRange is the minimum block size; block
 // size grows once itemCount exceeds 4 * workerCount * minRange so block count
-// stays bounded.
-void b2ParallelFor( b2World* world, b2ParallelForCallback* callback, int itemCount, int minRange, void* context );
+// stays bounded. Each block is recorded as a timeline event of the given stage when the timeline is enabled.
+void b2ParallelFor( b2World* world, b2TimelineStage stage, b2ParallelForCallback* callback, int itemCount, int minRange,
+					void* context );
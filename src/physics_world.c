@@ -10,21 +10,27 @@
 #include "recording.h"
 
 #include "arena_allocator.h"
+#include "atomic.h"
 #include "bitset.h"
 #include "body.h"
 #include "broad_phase.h"
 #include "constraint_graph.h"
 #include "contact.h"
+#include "contact_solver.h"
 #include "core.h"
 #include "ctz.h"
+#include "dynamic_tree.h"
+#include "height_field.h"
 #include "island.h"
 #include "joint.h"
+#include "mesh.h"
 #include "parallel_for.h"
 #include "scheduler.h"
 #include "sensor.h"
 #include "shape.h"
 #include "solver.h"
 #include "solver_set.h"
+#include "timeline.h"
 
 #include "box2d/box2d.h"
 #include "box2d/constants.h"
@@ -119,6 +125,7 @@ static void b2CreateWorkerContexts( b2World* world )
 	for ( int i = 0; i < world->workerCount; ++i )
 	{
 		b2Array_CreateN( world->taskContexts.data[i].sensorHits, 8 );
+		b2Array_Create( world->taskContexts.data[i].queryHits );
 		world->taskContexts.data[i].contactStateBitSet = b2CreateBitSet( 1024 );
 		world->taskContexts.data[i].hitEventBitSet = b2CreateBitSet( 1024 );
 		world->taskContexts.data[i].hasHitEvents = false;
@@ -127,6 +134,11 @@ static void b2CreateWorkerContexts( b2World* world )
 		world->taskContexts.data[i].awakeIslandBitSet = b2CreateBitSet( 256 );
 		world->taskContexts.data[i].splitIslandId = B2_NULL_INDEX;
 
+		if ( world->timelineCapacity > 0 )
+		{
+			world->taskContexts.data[i].timelineEvents = B2_ALLOC_ARRAY( world->timelineCapacity, b2TimelineEvent );
+		}
+
 		world->sensorTaskContexts.data[i].eventBits = b2CreateBitSet( 128 );
 	}
 }
@@ -136,12 +148,18 @@ static void b2DestroyWorkerContexts( b2World* world )
 	for ( int i = 0; i < world->workerCount; ++i )
 	{
 		b2Array_Destroy( world->taskContexts.data[i].sensorHits );
+		b2Array_Destroy( world->taskContexts.data[i].queryHits );
 		b2DestroyBitSet( &world->taskContexts.data[i].contactStateBitSet );
 		b2DestroyBitSet( &world->taskContexts.data[i].hitEventBitSet );
 		b2DestroyBitSet( &world->taskContexts.data[i].jointStateBitSet );
 		b2DestroyBitSet( &world->taskContexts.data[i].enlargedSimBitSet );
 		b2DestroyBitSet( &world->taskContexts.data[i].awakeIslandBitSet );
 
+		if ( world->taskContexts.data[i].timelineEvents != NULL )
+		{
+			B2_FREE_ARRAY( world->taskContexts.data[i].timelineEvents, world->timelineCapacity, b2TimelineEvent );
+		}
+
 		b2DestroyBitSet( &world->sensorTaskContexts.data[i].eventBits );
 	}
 
@@ -182,6 +200,8 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 
 	world->stack = b2CreateStack( 2048 );
 	b2CreateBroadPhase( &world->broadPhase, &def->capacity );
+	world->broadPhase.type = def->broadPhaseType;
+	world->broadPhase.gridCellSize = b2MaxFloat( def->gridCellSize, 0.0f );
 	b2CreateGraph( &world->constraintGraph, &def->capacity );
 
 	// pools
@@ -218,10 +238,15 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 
 	int shapeCapacity = b2MaxInt( 16, def->capacity.staticShapeCount + def->capacity.dynamicShapeCount );
 	b2Array_CreateN( world->shapes, shapeCapacity );
+	b2Array_CreateN( world->shapeSims, shapeCapacity );
 
 	world->chainIdPool = b2CreateIdPool();
 	b2Array_CreateN( world->chainShapes, 4 );
 
+	world->geometryIdPool = b2CreateIdPool();
+	b2Array_CreateN( world->geometries, 4 );
+	b2Array_CreateN( world->polygons, 4 );
+
 	world->contactIdPool = b2CreateIdPool();
 	b2Array_CreateN( world->contacts, b2MaxInt( 16, def->capacity.contactCount ) );
 
@@ -280,6 +305,16 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 	world->enableWarmStarting = true;
 	world->enableContactSoftening = def->enableContactSoftening;
 	world->enableContinuous = def->enableContinuous;
+	world->enablePipelinedStep = def->enablePipelinedStep;
+	world->enableWideStaticTree = def->enableWideStaticTree;
+	world->enableParallelOverflow = def->enableParallelOverflow;
+	world->enableGraphRebalance = def->enableGraphRebalance;
+	world->enableContactSort = def->enableContactSort;
+	world->contactSolverKernels = b2SelectContactSolverKernels( def->contactSimdWidth );
+	world->constraintGraph.wideConstraintByteCount = world->contactSolverKernels->constraintByteCount;
+	world->idlePolicy = def->idlePolicy;
+	world->idleSpinCount = b2MaxInt( def->idleSpinCount, 0 );
+	world->timelineCapacity = b2MaxInt( def->timelineCapacity, 0 );
 	world->enableSpeculative = true;
 	world->userTreeTask = NULL;
 	world->userData = def->userData;
@@ -297,7 +332,7 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 	{
 		// Built-in scheduler
 		world->workerCount = b2MinInt( def->workerCount, B2_MAX_WORKERS );
-		world->scheduler = b2CreateScheduler( world->workerCount );
+		world->scheduler = b2CreateScheduler( world->workerCount, def->schedulerType, world->idlePolicy, world->idleSpinCount );
 		world->enqueueTaskFcn = b2SchedulerEnqueueTask;
 		world->finishTaskFcn = b2SchedulerFinishTask;
 		world->userTaskContext = world->scheduler;
@@ -371,6 +406,20 @@ void b2DestroyWorld( b2WorldId worldId )
 		}
 	}
 
+	int shapeCapacity = world->shapes.count;
+	for ( int i = 0; i < shapeCapacity; ++i )
+	{
+		b2Shape* shape = world->shapes.data + i;
+		if ( shape->id != B2_NULL_INDEX )
+		{
+			b2FreeShapeData( world, world->shapeSims.data + i );
+		}
+	}
+
+	// Shared geometry may outlive its shapes
+	b2Array_Destroy( world->geometries );
+	b2Array_Destroy( world->polygons );
+
 	int sensorCount = world->sensors.count;
 	for ( int i = 0; i < sensorCount; ++i )
 	{
@@ -383,6 +432,7 @@ void b2DestroyWorld( b2WorldId worldId )
 
 	b2Array_Destroy( world->bodies );
 	b2Array_Destroy( world->shapes );
+	b2Array_Destroy( world->shapeSims );
 	b2Array_Destroy( world->chainShapes );
 	b2Array_Destroy( world->contacts );
 	b2Array_Destroy( world->joints );
@@ -414,6 +464,7 @@ void b2DestroyWorld( b2WorldId worldId )
 	b2DestroyIdPool( &world->bodyIdPool );
 	b2DestroyIdPool( &world->shapeIdPool );
 	b2DestroyIdPool( &world->chainIdPool );
+	b2DestroyIdPool( &world->geometryIdPool );
 	b2DestroyIdPool( &world->contactIdPool );
 	b2DestroyIdPool( &world->jointIdPool );
 	b2DestroyIdPool( &world->islandIdPool );
@@ -441,7 +492,7 @@ static void b2CollideTask( int startIndex, int endIndex, int workerIndex, void*
 	b2World* world = stepContext->world;
 	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
 	b2ContactSim** contactSims = stepContext->contactSims;
-	b2Shape* shapes = world->shapes.data;
+	b2ShapeSim* shapes = world->shapeSims.data;
 	b2Body* bodies = world->bodies.data;
 
 	B2_ASSERT( startIndex < endIndex );
@@ -456,8 +507,8 @@ static void b2CollideTask( int startIndex, int endIndex, int workerIndex, void*
 
 		int contactId = contactSim->contactId;
 
-		b2Shape* shapeA = shapes + contactSim->shapeIdA;
-		b2Shape* shapeB = shapes + contactSim->shapeIdB;
+		b2ShapeSim* shapeA = shapes + contactSim->shapeIdA;
+		b2ShapeSim* shapeB = shapes + contactSim->shapeIdB;
 
 		// Do proxies still overlap?
 		bool overlap = b2AABB_Overlaps( shapeA->fatAABB, shapeB->fatAABB );
@@ -540,10 +591,10 @@ static void b2CollideTask( int startIndex, int endIndex, int workerIndex, void*
 				}
 			}
 
-			// Caching for contact recycling.
+			// Caching for contact recycling. The new manifold needs a full prepare.
 			contactSim->cachedTransformA = transformA;
 			contactSim->cachedTransformB = transformB;
-			contactSim->simFlags |= b2_simRelativeTransformValid;
+			contactSim->simFlags |= b2_simRelativeTransformValid | b2_simPrepareDirty;
 
 			b2Vec2 centerOffsetA = b2RotateVector( transformA.q, bodySimA->localCenter );
 			b2Vec2 centerOffsetB = b2RotateVector( transformB.q, bodySimB->localCenter );
@@ -564,6 +615,12 @@ static void b2CollideTask( int startIndex, int endIndex, int workerIndex, void*
 				b2SetBit( &taskContext->contactStateBitSet, contactId );
 			}
 
+			// A mesh contact wants its second child created or destroyed
+			if ( contactSim->simFlags & ( b2_simAddChild | b2_simRemoveChild ) )
+			{
+				b2SetBit( &taskContext->contactStateBitSet, contactId );
+			}
+
 			for ( int i = 0; i < contactSim->manifold.pointCount; ++i )
 			{
 				b2ManifoldPoint* mp = contactSim->manifold.points + i;
@@ -614,6 +671,111 @@ static void b2RemoveNonTouchingContact( b2World* world, int setIndex, int localI
 	}
 }
 
+// A contact that changed state during the narrow phase. The event ids are resolved while classifying
+// so the serial state update only touches the contact and its sim.
+typedef struct b2ContactStateChange
+{
+	b2ShapeId shapeIdA;
+	b2ShapeId shapeIdB;
+	b2ContactId contactId;
+	uint32_t simFlags;
+	bool enableContactEvents;
+} b2ContactStateChange;
+
+typedef struct b2ContactStateContext
+{
+	b2World* world;
+	b2BitSet* bitSet;
+
+	// Number of changed contacts in each bit set block, then the offset of each block in changes
+	int* blockOffsets;
+	b2ContactStateChange* changes;
+} b2ContactStateContext;
+
+static void b2MergeContactStateTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2ContactStateContext* stateContext = context;
+	b2World* world = stateContext->world;
+	uint64_t* bits = stateContext->bitSet->bits;
+	int* blockOffsets = stateContext->blockOffsets;
+	int workerCount = world->workerCount;
+
+	for ( int k = startIndex; k < endIndex; ++k )
+	{
+		uint64_t block = bits[k];
+		for ( int i = 1; i < workerCount; ++i )
+		{
+			block |= world->taskContexts.data[i].contactStateBitSet.bits[k];
+		}
+
+		bits[k] = block;
+		blockOffsets[k] = b2PopCount64( block );
+	}
+}
+
+static void b2ClassifyContactStateTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2ContactStateContext* stateContext = context;
+	b2World* world = stateContext->world;
+	const uint64_t* bits = stateContext->bitSet->bits;
+	const int* blockOffsets = stateContext->blockOffsets;
+	b2ContactStateChange* changes = stateContext->changes;
+
+	const b2Contact* contacts = world->contacts.data;
+	const b2Shape* shapes = world->shapes.data;
+	const b2GraphColor* graphColors = world->constraintGraph.colors;
+	const b2SolverSet* awakeSet = world->solverSets.data + b2_awakeSet;
+	uint16_t worldId = world->worldId;
+
+	for ( int k = startIndex; k < endIndex; ++k )
+	{
+		b2ContactStateChange* change = changes + blockOffsets[k];
+		uint64_t block = bits[k];
+		while ( block != 0 )
+		{
+			uint32_t ctz = b2CTZ64( block );
+			int contactId = (int)( 64 * k + ctz );
+
+			const b2Contact* contact = contacts + contactId;
+			B2_ASSERT( contact->setIndex == b2_awakeSet );
+
+			const b2ContactSim* contactSim;
+			if ( contact->colorIndex != B2_NULL_INDEX )
+			{
+				// contact lives in constraint graph
+				B2_ASSERT( 0 <= contact->colorIndex && contact->colorIndex < B2_GRAPH_COLOR_COUNT );
+				contactSim = graphColors[contact->colorIndex].contactSims.data + contact->localIndex;
+			}
+			else
+			{
+				contactSim = awakeSet->contactSims.data + contact->localIndex;
+			}
+
+			const b2Shape* shapeA = shapes + contact->shapeIdA;
+			const b2Shape* shapeB = shapes + contact->shapeIdB;
+
+			change->shapeIdA = (b2ShapeId){ shapeA->id + 1, worldId, shapeA->generation };
+			change->shapeIdB = (b2ShapeId){ shapeB->id + 1, worldId, shapeB->generation };
+			change->contactId = (b2ContactId){
+				.index1 = contactId + 1,
+				.world0 = worldId,
+				.padding = 0,
+				.generation = contact->generation,
+			};
+			change->simFlags = contactSim->simFlags;
+			change->enableContactEvents = ( contact->flags & b2_contactEnableContactEvents ) != 0;
+			change += 1;
+
+			// Clear the smallest set bit
+			block = block & ( block - 1 );
+		}
+	}
+}
+
 // Narrow-phase collision
 static void b2Collide( b2StepContext* context )
 {
@@ -678,143 +840,150 @@ static void b2Collide( b2StepContext* context )
 
 	// Task should take at least 40us on a 4GHz CPU (10K cycles)
 	int minRange = 64;
-	b2ParallelFor( world, &b2CollideTask, contactCount, minRange, context );
+	b2ParallelFor( world, b2_timelineCollide, &b2CollideTask, contactCount, minRange, context );
 
 	b2StackFree( &world->stack, contactSims );
 	context->contactSims = NULL;
 	contactSims = NULL;
 
-	// Serially update contact state
+	// Update contact state in phases. The bit sets are merged and the changed contacts are classified
+	// in parallel. The island and graph mutations are then applied serially in contact id order because
+	// island ids, graph colors, and array positions depend on that order.
 	// todo_erin bring this zone together with island merge
 	b2TracyCZoneNC( contact_state, "Contact State", b2_colorLightSlateGray, true );
 
-	// Bitwise OR all contact bits
 	b2BitSet* bitSet = &world->taskContexts.data[0].contactStateBitSet;
-	for ( int i = 1; i < world->workerCount; ++i )
+	int blockCount = (int)bitSet->blockCount;
+	int* blockOffsets = b2StackAlloc( &world->stack, blockCount * sizeof( int ), "contact state blocks" );
+
+	b2ContactStateContext stateContext = {
+		.world = world,
+		.bitSet = bitSet,
+		.blockOffsets = blockOffsets,
+		.changes = NULL,
+	};
+
+	// Bitwise OR all contact bits and count the changes in each block
+	int minBlockRange = 256;
+	b2ParallelFor( world, b2_timelineContactState, b2MergeContactStateTask, blockCount, minBlockRange, &stateContext );
+
+	int changeCount = 0;
+	for ( int i = 0; i < blockCount; ++i )
 	{
-		b2InPlaceUnion( bitSet, &world->taskContexts.data[i].contactStateBitSet );
+		int count = blockOffsets[i];
+		blockOffsets[i] = changeCount;
+		changeCount += count;
+	}
+
+	b2ContactStateChange* changes = NULL;
+	if ( changeCount > 0 )
+	{
+		changes = b2StackAlloc( &world->stack, changeCount * sizeof( b2ContactStateChange ), "contact state changes" );
+		stateContext.changes = changes;
+
+		b2ParallelFor( world, b2_timelineContactState, b2ClassifyContactStateTask, blockCount, minBlockRange,
+					   &stateContext );
 	}
 
 	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
 
 	int endEventArrayIndex = world->endEventArrayIndex;
 
-	const b2Shape* shapes = world->shapes.data;
-	uint16_t worldId = world->worldId;
-
-	// Process contact state changes. Iterate over set bits
-	for ( uint32_t k = 0; k < bitSet->blockCount; ++k )
+	// Apply contact state changes in contact id order
+	for ( int i = 0; i < changeCount; ++i )
 	{
-		uint64_t bits = bitSet->bits[k];
-		while ( bits != 0 )
-		{
-			uint32_t ctz = b2CTZ64( bits );
-			int contactId = (int)( 64 * k + ctz );
+		const b2ContactStateChange* change = changes + i;
+		int contactId = change->contactId.index1 - 1;
 
-			b2Contact* contact = b2Array_Get( world->contacts, contactId );
-			B2_ASSERT( contact->setIndex == b2_awakeSet );
+		b2Contact* contact = b2Array_Get( world->contacts, contactId );
+		B2_ASSERT( contact->setIndex == b2_awakeSet );
 
-			int colorIndex = contact->colorIndex;
-			int localIndex = contact->localIndex;
+		int colorIndex = contact->colorIndex;
+		int localIndex = contact->localIndex;
 
-			b2ContactSim* contactSim = NULL;
-			if ( colorIndex != B2_NULL_INDEX )
-			{
-				// contact lives in constraint graph
-				B2_ASSERT( 0 <= colorIndex && colorIndex < B2_GRAPH_COLOR_COUNT );
-				b2GraphColor* color = graphColors + colorIndex;
-				contactSim = b2Array_Get( color->contactSims, localIndex );
-			}
-			else
-			{
-				contactSim = b2Array_Get( awakeSet->contactSims, localIndex );
-			}
-
-			const b2Shape* shapeA = shapes + contact->shapeIdA;
-			const b2Shape* shapeB = shapes + contact->shapeIdB;
-			b2ShapeId shapeIdA = { shapeA->id + 1, worldId, shapeA->generation };
-			b2ShapeId shapeIdB = { shapeB->id + 1, worldId, shapeB->generation };
-			b2ContactId contactFullId = {
-				.index1 = contactId + 1,
-				.world0 = worldId,
-				.padding = 0,
-				.generation = contact->generation,
-			};
-			uint32_t flags = contact->flags;
-			uint32_t simFlags = contactSim->simFlags;
+		if ( change->simFlags & b2_simDisjoint )
+		{
+			// Bounding boxes no longer overlap
+			b2DestroyContact( world, contact, false );
+			contact = NULL;
+		}
+		else if ( change->simFlags & b2_simStartedTouching )
+		{
+			B2_ASSERT( contact->islandId == B2_NULL_INDEX );
+			B2_ASSERT( colorIndex == B2_NULL_INDEX );
 
-			if ( simFlags & b2_simDisjoint )
+			if ( change->enableContactEvents )
 			{
-				// Bounding boxes no longer overlap
-				b2DestroyContact( world, contact, false );
-				contact = NULL;
-				contactSim = NULL;
+				b2ContactBeginTouchEvent event = { change->shapeIdA, change->shapeIdB, change->contactId };
+				b2Array_Push( world->contactBeginEvents, event );
 			}
-			else if ( simFlags & b2_simStartedTouching )
-			{
-				B2_ASSERT( contact->islandId == B2_NULL_INDEX );
 
-				if ( flags & b2_contactEnableContactEvents )
-				{
-					b2ContactBeginTouchEvent event = { shapeIdA, shapeIdB, contactFullId };
-					b2Array_Push( world->contactBeginEvents, event );
-				}
+			// Link first because this wakes colliding bodies and ensures the body sims
+			// are in the correct place.
+			contact->flags |= b2_contactTouchingFlag;
+			b2LinkContact( world, contact );
 
-				B2_ASSERT( contactSim->manifold.pointCount > 0 );
-				B2_ASSERT( contact->setIndex == b2_awakeSet );
+			// Make sure these didn't change
+			B2_ASSERT( contact->colorIndex == B2_NULL_INDEX );
+			B2_ASSERT( contact->localIndex == localIndex );
 
-				// Link first because this wakes colliding bodies and ensures the body sims
-				// are in the correct place.
-				contact->flags |= b2_contactTouchingFlag;
-				b2LinkContact( world, contact );
+			// Contact sims move as other contacts change state, so look it up here
+			b2ContactSim* contactSim = b2Array_Get( awakeSet->contactSims, localIndex );
+			B2_ASSERT( contactSim->manifold.pointCount > 0 );
 
-				// Make sure these didn't change
-				B2_ASSERT( contact->colorIndex == B2_NULL_INDEX );
-				B2_ASSERT( contact->localIndex == localIndex );
-
-				// Contact sim pointer may have become orphaned due to awake set growth,
-				// so I just need to refresh it.
-				contactSim = b2Array_Get( awakeSet->contactSims, localIndex );
+			contactSim->simFlags &= ~b2_simStartedTouching;
 
-				contactSim->simFlags &= ~b2_simStartedTouching;
+			// Add first for memcpy
+			b2AddContactToGraph( world, contactSim, contact );
 
-				// Add first for memcpy
-				b2AddContactToGraph( world, contactSim, contact );
+			// This destroys the contact sim
+			b2RemoveNonTouchingContact( world, b2_awakeSet, localIndex );
+		}
+		else if ( change->simFlags & b2_simStoppedTouching )
+		{
+			B2_ASSERT( 0 <= colorIndex && colorIndex < B2_GRAPH_COLOR_COUNT );
+			b2ContactSim* contactSim = b2Array_Get( graphColors[colorIndex].contactSims, localIndex );
 
-				// This destroys the contact sim
-				b2RemoveNonTouchingContact( world, b2_awakeSet, localIndex );
+			contactSim->simFlags &= ~b2_simStoppedTouching;
+			contact->flags &= ~b2_contactTouchingFlag;
 
-				contactSim = NULL;
-			}
-			else if ( simFlags & b2_simStoppedTouching )
+			if ( change->enableContactEvents )
 			{
-				contactSim->simFlags &= ~b2_simStoppedTouching;
-				contact->flags &= ~b2_contactTouchingFlag;
-
-				if ( contact->flags & b2_contactEnableContactEvents )
-				{
-					b2ContactEndTouchEvent event = { shapeIdA, shapeIdB, contactFullId };
-					b2Array_Push( world->contactEndEvents[endEventArrayIndex], event );
-				}
+				b2ContactEndTouchEvent event = { change->shapeIdA, change->shapeIdB, change->contactId };
+				b2Array_Push( world->contactEndEvents[endEventArrayIndex], event );
+			}
 
-				B2_ASSERT( contactSim->manifold.pointCount == 0 );
+			B2_ASSERT( contactSim->manifold.pointCount == 0 );
 
-				b2UnlinkContact( world, contact );
-				int bodyIdA = contact->edges[0].bodyId;
-				int bodyIdB = contact->edges[1].bodyId;
+			b2UnlinkContact( world, contact );
+			int bodyIdA = contact->edges[0].bodyId;
+			int bodyIdB = contact->edges[1].bodyId;
 
-				// Add first for memcpy
-				b2AddNonTouchingContact( world, contact, contactSim );
-				b2RemoveContactFromGraph( world, bodyIdA, bodyIdB, colorIndex, localIndex );
-				contact = NULL;
-				contactSim = NULL;
-			}
+			// Add first for memcpy
+			b2AddNonTouchingContact( world, contact, contactSim );
+			b2RemoveContactFromGraph( world, bodyIdA, bodyIdB, colorIndex, localIndex );
+			contact = NULL;
+		}
+	}
 
-			// Clear the smallest set bit
-			bits = bits & ( bits - 1 );
+	// Mesh child contacts are created and destroyed after the state changes because a child may have a
+	// state change of its own in the list
+	for ( int i = 0; i < changeCount; ++i )
+	{
+		const b2ContactStateChange* change = changes + i;
+		if ( change->simFlags & ( b2_simAddChild | b2_simRemoveChild ) )
+		{
+			b2UpdateChildContact( world, change->contactId.index1 - 1 );
 		}
 	}
 
+	if ( changes != NULL )
+	{
+		b2StackFree( &world->stack, changes );
+	}
+
+	b2StackFree( &world->stack, blockOffsets );
+
 	b2ValidateSolverSets( world );
 	b2ValidateContacts( world );
 
@@ -854,13 +1023,13 @@ void b2World_Step( b2WorldId worldId, float timeStep, int subStepCount )
 	world->activeTaskCount = 0;
 	world->taskCount = 0;
 
+	uint64_t stepTicks = b2GetTicks();
+
 	if ( world->scheduler != NULL )
 	{
 		b2ResetScheduler( world->scheduler );
 	}
 
-	uint64_t stepTicks = b2GetTicks();
-
 	{
 		b2Capacity* c = &world->maxCapacity;
 		c->staticShapeCount = b2MaxInt( c->staticShapeCount, world->broadPhase.trees[b2_staticBody].proxyCount );
@@ -929,12 +1098,15 @@ void b2World_Step( b2WorldId worldId, float timeStep, int subStepCount )
 		world->profile.solve = b2GetMilliseconds( solveTicks );
 	}
 
-	// Finish the tree task in case b2Solve didn't finish it
+	// Finish the tree task in case b2Solve didn't finish it. With the pipelined step this is the
+	// tree refit, which must be complete before sensors query the trees.
 	if ( world->userTreeTask )
 	{
 		world->finishTaskFcn( world->userTreeTask, world->userTaskContext );
 		world->userTreeTask = NULL;
 		world->activeTaskCount -= 1;
+
+		b2ValidateBroadphase( &world->broadPhase );
 	}
 
 	// Update sensors
@@ -946,6 +1118,19 @@ void b2World_Step( b2WorldId worldId, float timeStep, int subStepCount )
 
 	world->profile.step = b2GetMilliseconds( stepTicks );
 
+	// Gather worker idle time
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2TaskContext* taskContext = world->taskContexts.data + i;
+		world->profile.workerSpin[i] = taskContext->idleSpinTime;
+		taskContext->idleSpinTime = 0.0f;
+	}
+
+	if ( world->scheduler != NULL )
+	{
+		b2GetSchedulerIdleTimes( world->scheduler, world->profile.workerSpin, world->profile.workerPark );
+	}
+
 	B2_ASSERT( b2GetStackAllocation( &world->stack ) == 0 );
 
 	// Ensure stack is large enough
@@ -983,13 +1168,43 @@ void b2World_Step( b2WorldId worldId, float timeStep, int subStepCount )
 	b2TracyCFrame;
 }
 
-static void b2DrawShape( b2DebugDraw* draw, b2Shape* shape, b2Transform xf, b2HexColor color, bool drawChainNormals )
+typedef struct b2DrawMeshContext
+{
+	b2DebugDraw* draw;
+	b2Transform transform;
+	b2HexColor color;
+	bool drawNormals;
+} b2DrawMeshContext;
+
+static bool b2DrawMeshSegment( const b2ChainSegment* chainSegment, int segmentIndex, void* context )
+{
+	B2_UNUSED( segmentIndex );
+
+	b2DrawMeshContext* meshContext = context;
+	b2DebugDraw* draw = meshContext->draw;
+	b2Vec2 p1 = b2TransformPoint( meshContext->transform, chainSegment->segment.point1 );
+	b2Vec2 p2 = b2TransformPoint( meshContext->transform, chainSegment->segment.point2 );
+	draw->DrawLineFcn( p1, p2, meshContext->color, draw->context );
+
+	if ( meshContext->drawNormals )
+	{
+		b2Vec2 c = b2Lerp( p1, p2, 0.5f );
+		b2Vec2 e = b2Normalize( b2Sub( p2, p1 ) );
+		b2Vec2 n = b2RightPerp( e );
+		float L = 0.2f * b2GetLengthUnitsPerMeter();
+		draw->DrawLineFcn( c, b2MulAdd( c, L, n ), b2_colorPaleGreen, draw->context );
+	}
+
+	return true;
+}
+
+static void b2DrawShape( b2DebugDraw* draw, const b2ShapeSim* shape, b2Transform xf, b2HexColor color, bool drawChainNormals )
 {
 	switch ( shape->type )
 	{
 		case b2_capsuleShape:
 		{
-			b2Capsule* capsule = &shape->capsule;
+			const b2Capsule* capsule = &shape->capsule;
 			b2Vec2 p1 = b2TransformPoint( xf, capsule->center1 );
 			b2Vec2 p2 = b2TransformPoint( xf, capsule->center2 );
 			draw->DrawSolidCapsuleFcn( p1, p2, capsule->radius, color, draw->context );
@@ -998,7 +1213,7 @@ static void b2DrawShape( b2DebugDraw* draw, b2Shape* shape, b2Transform xf, b2He
 
 		case b2_circleShape:
 		{
-			b2Circle* circle = &shape->circle;
+			const b2Circle* circle = &shape->circle;
 			xf.p = b2TransformPoint( xf, circle->center );
 			draw->DrawSolidCircleFcn( xf, circle->radius, color, draw->context );
 		}
@@ -1006,14 +1221,14 @@ static void b2DrawShape( b2DebugDraw* draw, b2Shape* shape, b2Transform xf, b2He
 
 		case b2_polygonShape:
 		{
-			b2Polygon* poly = &shape->polygon;
+			const b2Polygon* poly = b2GetShapePolygon( shape );
 			draw->DrawSolidPolygonFcn( xf, poly->vertices, poly->count, poly->radius, color, draw->context );
 		}
 		break;
 
 		case b2_segmentShape:
 		{
-			b2Segment* segment = &shape->segment;
+			const b2Segment* segment = &shape->segment;
 			b2Vec2 p1 = b2TransformPoint( xf, segment->point1 );
 			b2Vec2 p2 = b2TransformPoint( xf, segment->point2 );
 			draw->DrawLineFcn( p1, p2, color, draw->context );
@@ -1022,7 +1237,7 @@ static void b2DrawShape( b2DebugDraw* draw, b2Shape* shape, b2Transform xf, b2He
 
 		case b2_chainSegmentShape:
 		{
-			b2Segment* segment = &shape->chainSegment.segment;
+			const b2Segment* segment = &shape->chainSegment.segment;
 			b2Vec2 p1 = b2TransformPoint( xf, segment->point1 );
 			b2Vec2 p2 = b2TransformPoint( xf, segment->point2 );
 			draw->DrawLineFcn( p1, p2, color, draw->context );
@@ -1039,6 +1254,16 @@ static void b2DrawShape( b2DebugDraw* draw, b2Shape* shape, b2Transform xf, b2He
 		}
 		break;
 
+		case b2_meshShape:
+		case b2_heightFieldShape:
+		{
+			// Only draw the segments inside the drawing bounds
+			b2DrawMeshContext meshContext = { draw, xf, color, drawChainNormals };
+			b2AABB localBounds = b2InvTransformAABB( xf, draw->drawingBounds );
+			b2QueryShapeSegments( shape, localBounds, b2DrawMeshSegment, &meshContext );
+		}
+		break;
+
 		default:
 			break;
 	}
@@ -1061,20 +1286,21 @@ static bool DrawQueryCallback( int proxyId, uint64_t userData, void* context )
 	b2DebugDraw* draw = drawContext->draw;
 
 	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
 	B2_ASSERT( shape->id == shapeId );
 
-	b2SetBit( &world->debugBodySet, shape->bodyId );
+	b2SetBit( &world->debugBodySet, shapeSim->bodyId );
 
 	if ( draw->drawShapes )
 	{
-		b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+		b2Body* body = b2Array_Get( world->bodies, shapeSim->bodyId );
 		b2BodySim* bodySim = b2GetBodySim( world, body );
 
 		b2HexColor color;
 
-		if ( shape->material.customColor != 0 )
+		if ( shapeSim->material.customColor != 0 )
 		{
-			color = shape->material.customColor;
+			color = shapeSim->material.customColor;
 		}
 		else if ( body->type == b2_dynamicBody && body->mass == 0.0f )
 		{
@@ -1122,12 +1348,12 @@ static bool DrawQueryCallback( int proxyId, uint64_t userData, void* context )
 			color = b2_colorGray;
 		}
 
-		b2DrawShape( draw, shape, bodySim->transform, color, draw->drawChainNormals );
+		b2DrawShape( draw, shapeSim, bodySim->transform, color, draw->drawChainNormals );
 	}
 
 	if ( draw->drawBounds )
 	{
-		b2AABB aabb = shape->fatAABB;
+		b2AABB aabb = shapeSim->fatAABB;
 
 		b2Vec2 vs[4] = { { aabb.lowerBound.x, aabb.lowerBound.y },
 						 { aabb.upperBound.x, aabb.lowerBound.y },
@@ -1368,7 +1594,7 @@ void b2World_Draw( b2WorldId worldId, b2DebugDraw* draw )
 						while ( shapeId != B2_NULL_INDEX )
 						{
 							b2Shape* shape = b2Array_Get( world->shapes, shapeId );
-							aabb = b2AABB_Union( aabb, shape->fatAABB );
+							aabb = b2AABB_Union( aabb, world->shapeSims.data[shapeId].fatAABB );
 							shapeCount += 1;
 							shapeId = shape->nextShapeId;
 						}
@@ -1630,6 +1856,38 @@ bool b2Chain_IsValid( b2ChainId id )
 	return id.generation == chain->generation;
 }
 
+bool b2Geometry_IsValid( b2GeometryId id )
+{
+	if ( B2_MAX_WORLDS <= id.world0 )
+	{
+		return false;
+	}
+
+	b2World* world = b2_worlds + id.world0;
+	if ( world->worldId != id.world0 )
+	{
+		// world is free
+		return false;
+	}
+
+	int geometryId = id.index1 - 1;
+	if ( geometryId < 0 || world->geometries.count <= geometryId )
+	{
+		return false;
+	}
+
+	b2Geometry* geometry = world->geometries.data + geometryId;
+	if ( geometry->id == B2_NULL_INDEX || geometry->userReference == false )
+	{
+		// geometry is free or only referenced by shapes
+		return false;
+	}
+
+	B2_ASSERT( geometry->id == geometryId );
+
+	return id.generation == geometry->generation;
+}
+
 bool b2Joint_IsValid( b2JointId id )
 {
 	if ( B2_MAX_WORLDS <= id.world0 )
@@ -1919,6 +2177,34 @@ b2Counters b2World_GetCounters( b2WorldId worldId )
 	}
 	s.awakeContactCount += world->solverSets.data[b2_awakeSet].contactSims.count;
 
+	b2GraphColor* overflow = world->constraintGraph.colors + B2_OVERFLOW_INDEX;
+	s.overflowContactCount = overflow->contactSims.count;
+	s.overflowJointCount = overflow->jointSims.count;
+	s.rebalancedContactCount = world->rebalancedContactCount;
+	s.sortedContactCount = world->sortedContactCount;
+
+	int simdWidth = world->contactSolverKernels->simdWidth;
+	int totalCount = 0;
+	int largestCount = 0;
+	int activeColorCount = 0;
+	int laneCount = 0;
+	for ( int i = 0; i < B2_OVERFLOW_INDEX; ++i )
+	{
+		int count = world->constraintGraph.colors[i].contactSims.count;
+		if ( count == 0 )
+		{
+			continue;
+		}
+
+		totalCount += count;
+		largestCount = b2MaxInt( largestCount, count );
+		activeColorCount += 1;
+		laneCount += ( ( count + simdWidth - 1 ) / simdWidth ) * simdWidth;
+	}
+
+	s.colorImbalance = totalCount > 0 ? (float)( largestCount * activeColorCount ) / (float)totalCount : 1.0f;
+	s.colorLaneFill = laneCount > 0 ? (float)totalCount / (float)laneCount : 1.0f;
+
 	return s;
 }
 
@@ -1976,6 +2262,39 @@ void b2World_SetRestitutionCallback( b2WorldId worldId, b2RestitutionCallback* c
 	}
 }
 
+int b2World_GetTimeline( b2WorldId worldId, b2TimelineEvent* events, int capacity )
+{
+	b2World* world = b2GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return 0;
+	}
+
+	return b2GetTimeline( world, events, capacity );
+}
+
+void b2World_ClearTimeline( b2WorldId worldId )
+{
+	b2World* world = b2GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	b2ClearTimeline( world );
+}
+
+bool b2World_SaveTimelineToFile( b2WorldId worldId, const char* path )
+{
+	b2World* world = b2GetUnlockedWorldFromId( worldId );
+	if ( world == NULL || path == NULL )
+	{
+		return false;
+	}
+
+	return b2SaveTimeline( world, path );
+}
+
 void b2World_SetWorkerCount( b2WorldId worldId, int count )
 {
 	b2World* world = b2GetUnlockedWorldFromId( worldId );
@@ -2005,6 +2324,12 @@ int b2World_GetWorkerCount( b2WorldId worldId )
 	return world->workerCount;
 }
 
+int b2World_GetContactSimdWidth( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->contactSolverKernels->simdWidth;
+}
+
 void b2World_StartRecording( b2WorldId worldId, b2Recording* recording )
 {
 	// Must be a step boundary, so refuse a locked world
@@ -2049,7 +2374,9 @@ void b2World_DumpMemoryStats( b2WorldId worldId )
 	int islandIdBytes = b2GetIdBytes( &world->islandIdPool );
 	int shapeIdBytes = b2GetIdBytes( &world->shapeIdPool );
 	int chainIdBytes = b2GetIdBytes( &world->chainIdPool );
-	total += bodyIdBytes + solverSetIdBytes + jointIdBytes + contactIdBytes + islandIdBytes + shapeIdBytes + chainIdBytes;
+	int geometryIdBytes = b2GetIdBytes( &world->geometryIdPool );
+	total += bodyIdBytes + solverSetIdBytes + jointIdBytes + contactIdBytes + islandIdBytes + shapeIdBytes + chainIdBytes +
+			 geometryIdBytes;
 
 	fprintf( file, "id pools\n" );
 	fprintf( file, "body ids: %d\n", bodyIdBytes );
@@ -2059,6 +2386,7 @@ void b2World_DumpMemoryStats( b2WorldId worldId )
 	fprintf( file, "island ids: %d\n", islandIdBytes );
 	fprintf( file, "shape ids: %d\n", shapeIdBytes );
 	fprintf( file, "chain ids: %d\n", chainIdBytes );
+	fprintf( file, "geometry ids: %d\n", geometryIdBytes );
 	fprintf( file, "\n" );
 
 	// Islands own per-island body/contact/joint link arrays
@@ -2078,10 +2406,13 @@ void b2World_DumpMemoryStats( b2WorldId worldId )
 	int contactArrayBytes = b2Array_ByteCount( world->contacts );
 	int islandArrayBytes = b2Array_ByteCount( world->islands );
 	int shapeArrayBytes = b2Array_ByteCount( world->shapes );
+	int shapeSimArrayBytes = b2Array_ByteCount( world->shapeSims );
 	int chainArrayBytes = b2Array_ByteCount( world->chainShapes );
+	int geometryArrayBytes = b2Array_ByteCount( world->geometries );
+	int polygonArrayBytes = b2Array_ByteCount( world->polygons );
 	int sensorArrayBytes = b2Array_ByteCount( world->sensors );
 	total += bodyArrayBytes + solverSetArrayBytes + jointArrayBytes + contactArrayBytes + islandArrayBytes + islandLinkBytes +
-			 shapeArrayBytes + chainArrayBytes + sensorArrayBytes;
+			 shapeArrayBytes + shapeSimArrayBytes + chainArrayBytes + geometryArrayBytes + polygonArrayBytes + sensorArrayBytes;
 
 	fprintf( file, "world arrays\n" );
 	fprintf( file, "bodies: %d\n", bodyArrayBytes );
@@ -2090,8 +2421,11 @@ void b2World_DumpMemoryStats( b2WorldId worldId )
 	fprintf( file, "contacts: %d\n", contactArrayBytes );
 	fprintf( file, "islands: %d\n", islandArrayBytes );
 	fprintf( file, "island links: %d\n", islandLinkBytes );
-	fprintf( file, "shapes: %d\n", shapeArrayBytes );
+	fprintf( file, "shapes: %d (%d bytes per shape)\n", shapeArrayBytes, (int)sizeof( b2Shape ) );
+	fprintf( file, "shape sims: %d (%d bytes per shape)\n", shapeSimArrayBytes, (int)sizeof( b2ShapeSim ) );
 	fprintf( file, "chains: %d\n", chainArrayBytes );
+	fprintf( file, "geometries: %d\n", geometryArrayBytes );
+	fprintf( file, "polygons: %d (%d bytes per polygon)\n", polygonArrayBytes, (int)sizeof( b2Polygon ) );
 	fprintf( file, "sensors: %d\n", sensorArrayBytes );
 	fprintf( file, "\n" );
 
@@ -2109,6 +2443,44 @@ void b2World_DumpMemoryStats( b2WorldId worldId )
 		chainDataBytes += chain->materialCount * (int)sizeof( b2SurfaceMaterial );
 	}
 
+	// Mesh shapes own their segments and hierarchy. Heightfield shapes own their samples.
+	int meshDataBytes = 0;
+	int heightFieldDataBytes = 0;
+	for ( int i = 0; i < world->shapes.count; ++i )
+	{
+		b2ShapeSim* shape = world->shapeSims.data + i;
+		if ( world->shapes.data[i].id == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		if ( shape->type == b2_meshShape )
+		{
+			meshDataBytes += shape->mesh->byteCount;
+		}
+		else if ( shape->type == b2_heightFieldShape )
+		{
+			heightFieldDataBytes += shape->heightField->byteCount;
+		}
+	}
+
+	// Each live geometry has a polygon in the polygon array. Shapes sharing a geometry don't pay for a polygon.
+	int geometryCount = 0;
+	int sharedGeometryCount = 0;
+	int geometryReferenceCount = 0;
+	for ( int i = 0; i < world->geometries.count; ++i )
+	{
+		b2Geometry* geometry = world->geometries.data + i;
+		if ( geometry->id == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		geometryCount += 1;
+		sharedGeometryCount += geometry->userReference ? 1 : 0;
+		geometryReferenceCount += geometry->refCount - ( geometry->userReference ? 1 : 0 );
+	}
+
 	// Sensors own overlap tracking arrays. The sensor array is dense.
 	int sensorOverlapBytes = 0;
 	for ( int i = 0; i < world->sensors.count; ++i )
@@ -2118,10 +2490,14 @@ void b2World_DumpMemoryStats( b2WorldId worldId )
 		sensorOverlapBytes += b2Array_ByteCount( sensor->overlaps1 );
 		sensorOverlapBytes += b2Array_ByteCount( sensor->overlaps2 );
 	}
-	total += chainDataBytes + sensorOverlapBytes;
+	total += chainDataBytes + meshDataBytes + heightFieldDataBytes + sensorOverlapBytes;
 
 	fprintf( file, "owned arrays\n" );
 	fprintf( file, "chain data: %d\n", chainDataBytes );
+	fprintf( file, "mesh data: %d\n", meshDataBytes );
+	fprintf( file, "heightfield data: %d\n", heightFieldDataBytes );
+	fprintf( file, "polygon geometry: %d polygons for %d shapes (%d shared)\n", geometryCount, geometryReferenceCount,
+			 sharedGeometryCount );
 	fprintf( file, "sensor overlaps: %d\n", sensorOverlapBytes );
 	fprintf( file, "\n" );
 
@@ -2267,6 +2643,47 @@ void b2World_DumpMemoryStats( b2WorldId worldId )
 	fclose( file );
 }
 
+// Batch queries and the static tree rebuild use the task system outside of b2World_Step. The world is locked while the
+// tasks run and the task counters are reset the same way as in b2World_Step. The step task
+// count is restored afterwards so b2World_GetCounters still reports the last step.
+// These are not thread-safe. A batch that overlaps another batch is rejected rather than corrupting the task
+// counters, the scheduler, and the stack allocator. Returns false if the batch must not run.
+static bool b2BeginBatchQuery( b2World* world, int* stepTaskCount )
+{
+	B2_ASSERT( world->locked == false );
+	bool claimed = b2AtomicCompareExchangeInt( &world->batchQueryActive, 0, 1 );
+	B2_ASSERT( claimed );
+	if ( claimed == false )
+	{
+		return false;
+	}
+
+	if ( world->locked )
+	{
+		b2AtomicStoreInt( &world->batchQueryActive, 0 );
+		return false;
+	}
+
+	world->locked = true;
+	*stepTaskCount = world->taskCount;
+	world->taskCount = 0;
+
+	if ( world->scheduler != NULL )
+	{
+		b2ResetScheduler( world->scheduler );
+	}
+
+	return true;
+}
+
+static void b2EndBatchQuery( b2World* world, int stepTaskCount )
+{
+	B2_ASSERT( b2AtomicLoadInt( &world->batchQueryActive ) == 1 );
+	world->taskCount = stepTaskCount;
+	world->locked = false;
+	b2AtomicStoreInt( &world->batchQueryActive, 0 );
+}
+
 typedef struct WorldQueryContext
 {
 	b2World* world;
@@ -2362,26 +2779,20 @@ static bool TreeOverlapCallback( int proxyId, uint64_t userData, void* context )
 	b2World* world = worldContext->world;
 
 	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
 
 	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
 	{
 		return true;
 	}
 
-	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+	b2Body* body = b2Array_Get( world->bodies, shapeSim->bodyId );
 	b2Transform transform = b2GetBodyTransformQuick( world, body );
 
-	b2DistanceInput input;
-	input.proxyA = *worldContext->proxy;
-	input.proxyB = b2MakeShapeDistanceProxy( shape );
-	input.transformA = b2Transform_identity;
-	input.transformB = transform;
-	input.useRadii = true;
-
-	b2SimplexCache cache = { 0 };
-	b2DistanceOutput output = b2ShapeDistance( &input, &cache, NULL, 0 );
-
 	float tolerance = 0.1f * B2_LINEAR_SLOP;
+	b2DistanceOutput output =
+		b2ComputeShapeProxyDistance( shapeSim, transform, worldContext->proxy, b2Transform_identity, tolerance );
+
 	if ( output.distance > tolerance )
 	{
 		return true;
@@ -2441,6 +2852,186 @@ b2TreeStats b2World_OverlapShape( b2WorldId worldId, const b2ShapeProxy* proxy,
 	return treeStats;
 }
 
+// Result of one query in an overlap batch. The hits are stored in the query hits of the worker
+// that ran the query.
+typedef struct b2OverlapBatchItem
+{
+	int workerIndex;
+	int start;
+	int count;
+	b2TreeStats treeStats;
+} b2OverlapBatchItem;
+
+typedef struct WorldOverlapBatchContext
+{
+	b2World* world;
+	const b2AABB* aabbs;
+	const b2ShapeProxy* proxies;
+	b2OverlapBatchItem* items;
+	b2QueryFilter filter;
+} WorldOverlapBatchContext;
+
+static bool b2CollectOverlapFcn( b2ShapeId shapeId, void* context )
+{
+	b2Array( b2ShapeId )* hits = context;
+	b2Array_Push( *hits, shapeId );
+	return true;
+}
+
+static void b2OverlapBatchTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( overlap_batch, "Overlap Batch", b2_colorDodgerBlue, true );
+
+	WorldOverlapBatchContext* batchContext = context;
+	b2World* world = batchContext->world;
+	b2QueryFilter filter = batchContext->filter;
+	b2Array( b2ShapeId )* hits = &world->taskContexts.data[workerIndex].queryHits;
+
+	for ( int queryIndex = startIndex; queryIndex < endIndex; ++queryIndex )
+	{
+		b2OverlapBatchItem* item = batchContext->items + queryIndex;
+		item->workerIndex = workerIndex;
+		item->start = hits->count;
+		item->treeStats = (b2TreeStats){ 0 };
+
+		if ( batchContext->proxies != NULL )
+		{
+			const b2ShapeProxy* proxy = batchContext->proxies + queryIndex;
+			b2AABB aabb = b2MakeAABB( proxy->points, proxy->count, proxy->radius );
+			WorldOverlapContext worldContext = { world, b2CollectOverlapFcn, filter, proxy, hits };
+
+			for ( int i = 0; i < b2_bodyTypeCount; ++i )
+			{
+				b2TreeStats treeResult =
+					b2DynamicTree_Query( world->broadPhase.trees + i, aabb, filter.maskBits, TreeOverlapCallback, &worldContext );
+				item->treeStats.nodeVisits += treeResult.nodeVisits;
+				item->treeStats.leafVisits += treeResult.leafVisits;
+			}
+		}
+		else
+		{
+			b2AABB aabb = batchContext->aabbs[queryIndex];
+			WorldQueryContext worldContext = { world, b2CollectOverlapFcn, filter, hits };
+
+			for ( int i = 0; i < b2_bodyTypeCount; ++i )
+			{
+				b2TreeStats treeResult =
+					b2DynamicTree_Query( world->broadPhase.trees + i, aabb, filter.maskBits, TreeQueryCallback, &worldContext );
+				item->treeStats.nodeVisits += treeResult.nodeVisits;
+				item->treeStats.leafVisits += treeResult.leafVisits;
+			}
+		}
+
+		item->count = hits->count - item->start;
+	}
+
+	b2TracyCZoneEnd( overlap_batch );
+}
+
+// Shared by the AABB and shape proxy batches. Exactly one of aabbs and proxies is non-null.
+static int b2OverlapBatch( b2WorldId worldId, const b2AABB* aabbs, const b2ShapeProxy* proxies, int queryCount,
+						   b2QueryFilter filter, int* offsets, b2ShapeId* shapeIds, int shapeIdCapacity )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	if ( queryCount <= 0 )
+	{
+		return 0;
+	}
+
+	B2_ASSERT( offsets != NULL );
+	B2_ASSERT( shapeIds != NULL || shapeIdCapacity == 0 );
+
+	// The query hits and the stack allocator are shared, so the world is claimed until they are released
+	int stepTaskCount;
+	if ( b2BeginBatchQuery( world, &stepTaskCount ) == false )
+	{
+		return 0;
+	}
+
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2Array_Clear( world->taskContexts.data[i].queryHits );
+	}
+
+	b2OverlapBatchItem* items = b2StackAlloc( &world->stack, queryCount * sizeof( b2OverlapBatchItem ), "overlap batch" );
+	WorldOverlapBatchContext batchContext = { world, aabbs, proxies, items, filter };
+
+	b2ParallelFor( world, b2_timelineQueries, b2OverlapBatchTask, queryCount, 16, &batchContext );
+
+	// Compact the per worker hits in query order
+	int hitCount = 0;
+	for ( int queryIndex = 0; queryIndex < queryCount; ++queryIndex )
+	{
+		b2OverlapBatchItem* item = items + queryIndex;
+		offsets[queryIndex] = hitCount;
+
+		int copyCount = b2MinInt( item->count, shapeIdCapacity - hitCount );
+		if ( copyCount > 0 )
+		{
+			const b2ShapeId* source = world->taskContexts.data[item->workerIndex].queryHits.data + item->start;
+			memcpy( shapeIds + hitCount, source, copyCount * sizeof( b2ShapeId ) );
+		}
+
+		hitCount += item->count;
+	}
+	offsets[queryCount] = hitCount;
+
+	if ( world->recording != NULL )
+	{
+		// Recorded as individual overlap queries that accept every hit
+		for ( int queryIndex = 0; queryIndex < queryCount; ++queryIndex )
+		{
+			b2OverlapBatchItem* item = items + queryIndex;
+			const b2ShapeId* hits = world->taskContexts.data[item->workerIndex].queryHits.data + item->start;
+
+			b2RecBuffer recBuf = { 0 };
+			b2RecW_WORLDID( &recBuf, worldId );
+			if ( proxies != NULL )
+			{
+				b2RecW_SHAPEPROXY( &recBuf, proxies[queryIndex] );
+			}
+			else
+			{
+				b2RecW_AABB( &recBuf, aabbs[queryIndex] );
+			}
+			b2RecW_QUERYFILTER( &recBuf, filter );
+			b2RecW_U32( &recBuf, (uint32_t)item->count );
+			for ( int i = 0; i < item->count; ++i )
+			{
+				b2RecW_SHAPEID( &recBuf, hits[i] );
+				b2RecW_BOOL( &recBuf, true );
+			}
+			b2RecW_TREESTATS( &recBuf, item->treeStats );
+			b2RecCommitRecord( world->recording, proxies != NULL ? 0xE1 : 0xE0, recBuf.data, recBuf.size );
+			b2RecBufFree( &recBuf );
+		}
+	}
+
+	b2StackFree( &world->stack, items );
+	b2EndBatchQuery( world, stepTaskCount );
+
+	return hitCount;
+}
+
+int b2World_OverlapAABBBatch( b2WorldId worldId, const b2AABB* aabbs, int queryCount, b2QueryFilter filter, int* offsets,
+							  b2ShapeId* shapeIds, int shapeIdCapacity )
+{
+#if B2_ENABLE_VALIDATION
+	for ( int i = 0; i < queryCount; ++i )
+	{
+		B2_ASSERT( b2IsValidAABB( aabbs[i] ) );
+	}
+#endif
+
+	return b2OverlapBatch( worldId, aabbs, NULL, queryCount, filter, offsets, shapeIds, shapeIdCapacity );
+}
+
+int b2World_OverlapShapeBatch( b2WorldId worldId, const b2ShapeProxy* proxies, int queryCount, b2QueryFilter filter,
+							   int* offsets, b2ShapeId* shapeIds, int shapeIdCapacity )
+{
+	return b2OverlapBatch( worldId, NULL, proxies, queryCount, filter, offsets, shapeIds, shapeIdCapacity );
+}
+
 typedef struct WorldRayCastContext
 {
 	b2World* world;
@@ -2460,15 +3051,16 @@ static float RayCastCallback( const b2RayCastInput* input, int proxyId, uint64_t
 	b2World* world = worldContext->world;
 
 	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
 
 	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
 	{
 		return input->maxFraction;
 	}
 
-	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+	b2Body* body = b2Array_Get( world->bodies, shapeSim->bodyId );
 	b2Transform transform = b2GetBodyTransformQuick( world, body );
-	b2CastOutput output = b2RayCastShape( input, shape, transform );
+	b2CastOutput output = b2RayCastShape( input, shapeSim, transform );
 
 	if ( output.hit )
 	{
@@ -2610,6 +3202,161 @@ b2RayResult b2World_CastRayClosest( b2WorldId worldId, b2Vec2 origin, b2Vec2 tra
 	return result;
 }
 
+typedef struct WorldRayPacketContext
+{
+	b2World* world;
+	b2QueryFilter filter;
+	b2RayResult* results;
+} WorldRayPacketContext;
+
+// Closest hit per ray, matching RayCastCallback combined with b2RayCastClosestFcn
+static float RayCastPacketCallback( const b2RayCastInput* input, int rayIndex, int proxyId, uint64_t userData, void* context )
+{
+	B2_UNUSED( proxyId );
+
+	int shapeId = (int)userData;
+
+	WorldRayPacketContext* packetContext = context;
+	b2World* world = packetContext->world;
+	b2RayResult* result = packetContext->results + rayIndex;
+	result->leafVisits += 1;
+
+	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
+
+	if ( b2ShouldQueryCollide( shape->filter, packetContext->filter ) == false )
+	{
+		return input->maxFraction;
+	}
+
+	b2Body* body = b2Array_Get( world->bodies, shapeSim->bodyId );
+	b2Transform transform = b2GetBodyTransformQuick( world, body );
+	b2CastOutput output = b2RayCastShape( input, shapeSim, transform );
+
+	// Ignore initial overlap
+	if ( output.hit == false || output.fraction == 0.0f )
+	{
+		return -1.0f;
+	}
+
+	result->shapeId = (b2ShapeId){ shapeId + 1, world->worldId, shape->generation };
+	result->point = output.point;
+	result->normal = output.normal;
+	result->fraction = output.fraction;
+	result->hit = true;
+	return output.fraction;
+}
+
+typedef struct WorldRayBatchContext
+{
+	b2World* world;
+	const b2Vec2* origins;
+	const b2Vec2* translations;
+	b2RayResult* results;
+	b2QueryFilter filter;
+	int rayCount;
+} WorldRayBatchContext;
+
+static void b2CastRayBatchTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( ray_batch, "Ray Batch", b2_colorDodgerBlue, true );
+
+	B2_UNUSED( workerIndex );
+
+	WorldRayBatchContext* batchContext = context;
+	b2World* world = batchContext->world;
+	b2QueryFilter filter = batchContext->filter;
+
+	for ( int packetIndex = startIndex; packetIndex < endIndex; ++packetIndex )
+	{
+		int base = packetIndex * B2_SIMD_WIDTH;
+		int rayCount = b2MinInt( B2_SIMD_WIDTH, batchContext->rayCount - base );
+
+		b2RayResult* results = batchContext->results + base;
+		b2RayCastInput inputs[B2_SIMD_WIDTH];
+		for ( int i = 0; i < rayCount; ++i )
+		{
+			inputs[i] = (b2RayCastInput){ batchContext->origins[base + i], batchContext->translations[base + i], 1.0f };
+			results[i] = (b2RayResult){ 0 };
+		}
+
+		WorldRayPacketContext packetContext = { world, filter, results };
+		int nodeVisits = 0;
+
+		for ( int treeIndex = 0; treeIndex < b2_bodyTypeCount; ++treeIndex )
+		{
+			b2TreeStats treeResult = b2DynamicTree_RayCastPacket( world->broadPhase.trees + treeIndex, inputs, rayCount,
+																  filter.maskBits, RayCastPacketCallback, &packetContext );
+			nodeVisits += treeResult.nodeVisits;
+
+			// Clip each ray for the next tree
+			for ( int i = 0; i < rayCount; ++i )
+			{
+				if ( results[i].hit )
+				{
+					inputs[i].maxFraction = results[i].fraction;
+				}
+			}
+		}
+
+		for ( int i = 0; i < rayCount; ++i )
+		{
+			results[i].nodeVisits = nodeVisits;
+		}
+	}
+
+	b2TracyCZoneEnd( ray_batch );
+}
+
+void b2World_CastRayBatch( b2WorldId worldId, const b2Vec2* origins, const b2Vec2* translations, int rayCount,
+						   b2QueryFilter filter, b2RayResult* results )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	if ( rayCount <= 0 )
+	{
+		return;
+	}
+
+	B2_ASSERT( origins != NULL && translations != NULL && results != NULL );
+
+#if B2_ENABLE_VALIDATION
+	for ( int i = 0; i < rayCount; ++i )
+	{
+		B2_ASSERT( b2IsValidVec2( origins[i] ) );
+		B2_ASSERT( b2IsValidVec2( translations[i] ) );
+	}
+#endif
+
+	WorldRayBatchContext batchContext = { world, origins, translations, results, filter, rayCount };
+	int packetCount = ( rayCount + B2_SIMD_WIDTH - 1 ) / B2_SIMD_WIDTH;
+
+	int stepTaskCount;
+	if ( b2BeginBatchQuery( world, &stepTaskCount ) == false )
+	{
+		return;
+	}
+
+	b2ParallelFor( world, b2_timelineQueries, b2CastRayBatchTask, packetCount, 8, &batchContext );
+
+	if ( world->recording != NULL )
+	{
+		// Recorded as individual closest ray casts since the results are identical
+		for ( int i = 0; i < rayCount; ++i )
+		{
+			b2RecBuffer recBuf = { 0 };
+			b2RecW_WORLDID( &recBuf, worldId );
+			b2RecW_VEC2( &recBuf, origins[i] );
+			b2RecW_VEC2( &recBuf, translations[i] );
+			b2RecW_QUERYFILTER( &recBuf, filter );
+			b2RecW_RAYRESULT( &recBuf, results[i] );
+			b2RecCommitRecord( world->recording, 0xE5, recBuf.data, recBuf.size );
+			b2RecBufFree( &recBuf );
+		}
+	}
+
+	b2EndBatchQuery( world, stepTaskCount );
+}
+
 static float ShapeCastCallback( const b2ShapeCastInput* input, int proxyId, uint64_t userData, void* context )
 {
 	B2_UNUSED( proxyId );
@@ -2620,16 +3367,17 @@ static float ShapeCastCallback( const b2ShapeCastInput* input, int proxyId, uint
 	b2World* world = worldContext->world;
 
 	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
 
 	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
 	{
 		return input->maxFraction;
 	}
 
-	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+	b2Body* body = b2Array_Get( world->bodies, shapeSim->bodyId );
 	b2Transform transform = b2GetBodyTransformQuick( world, body );
 
-	b2CastOutput output = b2ShapeCastShape( input, shape, transform );
+	b2CastOutput output = b2ShapeCastShape( input, shapeSim, transform );
 
 	if ( output.hit )
 	{
@@ -2733,16 +3481,17 @@ static float MoverCastCallback( const b2ShapeCastInput* input, int proxyId, uint
 	b2World* world = worldContext->world;
 
 	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
 
 	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
 	{
 		return worldContext->fraction;
 	}
 
-	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+	b2Body* body = b2Array_Get( world->bodies, shapeSim->bodyId );
 	b2Transform transform = b2GetBodyTransformQuick( world, body );
 
-	b2CastOutput output = b2ShapeCastShape( input, shape, transform );
+	b2CastOutput output = b2ShapeCastShape( input, shapeSim, transform );
 	if ( output.fraction == 0.0f )
 	{
 		// Ignore overlapping shapes
@@ -2812,6 +3561,55 @@ typedef struct WorldMoverContext
 	void* userContext;
 } WorldMoverContext;
 
+typedef struct b2MeshMoverContext
+{
+	WorldMoverContext* worldContext;
+	b2ShapeId shapeId;
+	b2Capsule localMover;
+	b2Rot rotation;
+	bool proceed;
+} b2MeshMoverContext;
+
+static bool b2MeshMoverCallback( const b2ChainSegment* segment, int segmentIndex, void* context )
+{
+	B2_UNUSED( segmentIndex );
+
+	b2MeshMoverContext* meshContext = context;
+	b2PlaneResult result = b2CollideMoverAndSegment( &meshContext->localMover, &segment->segment );
+
+	// todo handle deep overlap
+	if ( result.hit == false || b2IsNormalized( result.plane.normal ) == false )
+	{
+		return true;
+	}
+
+	result.plane.normal = b2RotateVector( meshContext->rotation, result.plane.normal );
+
+	WorldMoverContext* worldContext = meshContext->worldContext;
+	meshContext->proceed = worldContext->fcn( meshContext->shapeId, &result, worldContext->userContext );
+	return meshContext->proceed;
+}
+
+// A mesh or heightfield reports a plane for each nearby segment
+static bool b2CollideMoverAndMeshShape( WorldMoverContext* worldContext, b2ShapeId shapeId, const b2ShapeSim* shape,
+										b2Transform transform )
+{
+	const b2Capsule* mover = &worldContext->mover;
+
+	b2MeshMoverContext meshContext;
+	meshContext.worldContext = worldContext;
+	meshContext.shapeId = shapeId;
+	meshContext.localMover.center1 = b2InvTransformPoint( transform, mover->center1 );
+	meshContext.localMover.center2 = b2InvTransformPoint( transform, mover->center2 );
+	meshContext.localMover.radius = mover->radius;
+	meshContext.rotation = transform.q;
+	meshContext.proceed = true;
+
+	b2AABB box = b2ComputeCapsuleAABB( &meshContext.localMover, b2Transform_identity );
+	b2QueryShapeSegments( shape, box, b2MeshMoverCallback, &meshContext );
+	return meshContext.proceed;
+}
+
 static bool TreeCollideCallback( int proxyId, uint64_t userData, void* context )
 {
 	B2_UNUSED( proxyId );
@@ -2821,16 +3619,23 @@ static bool TreeCollideCallback( int proxyId, uint64_t userData, void* context )
 	b2World* world = worldContext->world;
 
 	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
 
 	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
 	{
 		return true;
 	}
 
-	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+	b2Body* body = b2Array_Get( world->bodies, shapeSim->bodyId );
 	b2Transform transform = b2GetBodyTransformQuick( world, body );
 
-	b2PlaneResult result = b2CollideMover( &worldContext->mover, shape, transform );
+	if ( b2IsSegmentCollection( shapeSim ) )
+	{
+		b2ShapeId id = { shapeId + 1, world->worldId, shape->generation };
+		return b2CollideMoverAndMeshShape( worldContext, id, shapeSim, transform );
+	}
+
+	b2PlaneResult result = b2CollideMover( &worldContext->mover, shapeSim, transform );
 
 	// todo handle deep overlap
 	if ( result.hit && b2IsNormalized( result.plane.normal ) )
@@ -3011,25 +3816,18 @@ static bool ExplosionCallback( int proxyId, uint64_t userData, void* context )
 	struct ExplosionContext* explosionContext = context;
 	b2World* world = explosionContext->world;
 
-	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	b2ShapeSim* shape = b2Array_Get( world->shapeSims, shapeId );
 
 	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
 	B2_ASSERT( body->type == b2_dynamicBody );
 
 	b2Transform transform = b2GetBodyTransformQuick( world, body );
 
-	b2DistanceInput input;
-	input.proxyA = b2MakeShapeDistanceProxy( shape );
-	input.proxyB = b2MakeProxy( &explosionContext->position, 1, 0.0f );
-	input.transformA = transform;
-	input.transformB = b2Transform_identity;
-	input.useRadii = true;
-
-	b2SimplexCache cache = { 0 };
-	b2DistanceOutput output = b2ShapeDistance( &input, &cache, NULL, 0 );
-
 	float radius = explosionContext->radius;
 	float falloff = explosionContext->falloff;
+	b2ShapeProxy proxy = b2MakeProxy( &explosionContext->position, 1, 0.0f );
+	b2DistanceOutput output = b2ComputeShapeProxyDistance( shape, transform, &proxy, b2Transform_identity, radius + falloff );
+
 	if ( output.distance > radius + falloff )
 	{
 		return true;
@@ -3113,6 +3911,12 @@ void b2World_Explode( b2WorldId worldId, const b2ExplosionDef* explosionDef )
 	b2DynamicTree_Query( world->broadPhase.trees + b2_dynamicBody, aabb, maskBits, ExplosionCallback, &explosionContext );
 }
 
+static void b2RebuildSubtreesTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+	b2DynamicTree_BuildSubtrees( context, startIndex, endIndex );
+}
+
 void b2World_RebuildStaticTree( b2WorldId worldId )
 {
 	b2World* world = b2GetWorldFromId( worldId );
@@ -3124,8 +3928,39 @@ void b2World_RebuildStaticTree( b2WorldId worldId )
 
 	B2_REC( world, WorldRebuildStaticTree, worldId );
 
+	int stepTaskCount;
+	if ( b2BeginBatchQuery( world, &stepTaskCount ) == false )
+	{
+		return;
+	}
+
 	b2DynamicTree* staticTree = world->broadPhase.trees + b2_staticBody;
-	b2DynamicTree_Rebuild( staticTree, true );
+
+	if ( world->workerCount > 1 )
+	{
+		// Split the tree into a few subtrees per worker. Each subtree uses the internal nodes the serial
+		// build would give it, so the tree does not depend on the worker count.
+		int subtreeLeafCount = b2MaxInt( 256, staticTree->proxyCount / ( 4 * world->workerCount ) );
+		b2TreeRebuild rebuild = b2DynamicTree_BeginRebuild( staticTree, true, subtreeLeafCount );
+
+		if ( rebuild.subtreeCount > 0 )
+		{
+			b2ParallelFor( world, b2_timelineRebuildTree, b2RebuildSubtreesTask, rebuild.subtreeCount, 1, &rebuild );
+		}
+
+		b2DynamicTree_EndRebuild( &rebuild );
+	}
+	else
+	{
+		b2DynamicTree_Rebuild( staticTree, true );
+	}
+
+	if ( world->enableWideStaticTree )
+	{
+		b2DynamicTree_BuildWide( staticTree );
+	}
+
+	b2EndBatchQuery( world, stepTaskCount );
 }
 
 void b2World_EnableSpeculative( b2WorldId worldId, bool flag )
@@ -3236,6 +4071,7 @@ void b2ValidateSolverSets( b2World* world )
 	int totalBodyCount = 0;
 	int totalJointCount = 0;
 	int totalContactCount = 0;
+	int totalPairCount = 0;
 	int totalIslandCount = 0;
 
 	// Validate all solver sets
@@ -3394,6 +4230,7 @@ void b2ValidateSolverSets( b2World* world )
 				{
 					b2ContactSim* contactSim = set->contactSims.data + i;
 					b2Contact* contact = b2Array_Get( world->contacts, contactSim->contactId );
+					totalPairCount += contactSim->childIndex == 0 ? 1 : 0;
 					if ( setIndex == b2_awakeSet )
 					{
 						// contact should be non-touching if awake
@@ -3466,6 +4303,7 @@ void b2ValidateSolverSets( b2World* world )
 		{
 			b2ContactSim* contactSim = color->contactSims.data + i;
 			b2Contact* contact = b2Array_Get( world->contacts, contactSim->contactId );
+			totalPairCount += contactSim->childIndex == 0 ? 1 : 0;
 			// contact should be touching in the constraint graph or awaiting transfer to non-touching
 			B2_ASSERT( contactSim->manifold.pointCount > 0 ||
 					   ( contactSim->simFlags & ( b2_simStoppedTouching | b2_simDisjoint ) ) != 0 );
@@ -3519,7 +4357,8 @@ void b2ValidateSolverSets( b2World* world )
 
 	int contactIdCount = b2GetIdCount( &world->contactIdPool );
 	B2_ASSERT( totalContactCount == contactIdCount );
-	B2_ASSERT( totalContactCount == (int)world->broadPhase.pairSet.count );
+	// Child contacts share the pair key
+	B2_ASSERT( totalPairCount == (int)world->broadPhase.pairSet.count );
 
 	int jointIdCount = b2GetIdCount( &world->jointIdPool );
 	B2_ASSERT( totalJointCount == jointIdCount );
@@ -3536,11 +4375,13 @@ void b2ValidateSolverSets( b2World* world )
 			continue;
 		}
 
-		b2Body* body = b2Array_Get(world->bodies, shape->bodyId);
+		b2ShapeSim* shapeSim = world->shapeSims.data + shapeIndex;
+
+		b2Body* body = b2Array_Get(world->bodies, shapeSim->bodyId);
 
 		b2SolverSet* set = b2Array_Get(world->solverSets, body->setIndex);
 		b2BodySim* bodySim = b2Array_Get(set->bodySims, body->localIndex);
-		B2_ASSERT(bodySim->bodyId == shape->bodyId);
+		B2_ASSERT(bodySim->bodyId == shapeSim->bodyId);
 
 		bool found = false;
 		int shapeCount = 0;
@@ -3,6 +3,7 @@
 
 #pragma once
 
+typedef struct b2ContactSolverKernels b2ContactSolverKernels;
 typedef struct b2Recording b2Recording;
 
 #include "arena_allocator.h"
@@ -24,6 +25,7 @@ b2DeclareArray( b2ContactHitEvent );
 b2DeclareArray( b2JointEvent );
 b2DeclareArray( b2SensorBeginTouchEvent );
 b2DeclareArray( b2SensorEndTouchEvent );
+b2DeclareArray( b2ShapeId );
 b2DeclareArray( b2TaskContext );
 
 // Per thread task storage
@@ -58,6 +60,17 @@ typedef struct b2TaskContext
 	// Number of contacts recycled this step (collide pass).
 	int recycledContactCount;
 
+	// Per worker shape ids collected by batched overlap queries
+	b2Array( b2ShapeId ) queryHits;
+
+	// Time this worker spent spinning on solver stages this step (ms)
+	float idleSpinTime;
+
+	// Timeline ring buffer with world->timelineCapacity entries. Null if the timeline is disabled.
+	b2TimelineEvent* timelineEvents;
+	int timelineIndex;
+	int timelineCount;
+
 } b2TaskContext;
 
 // The world struct manages all physics entities, dynamic simulation,  and asynchronous queries.
@@ -111,8 +124,15 @@ typedef struct b2World
 
 	// These are sparse arrays that point into the pools above
 	b2Array( b2Shape ) shapes;
+	b2Array( b2ShapeSim ) shapeSims;
 	b2Array( b2ChainShape ) chainShapes;
 
+	// Polygon geometry referenced by polygon shapes. Sparse arrays indexed by geometry id. The polygon shape
+	// sims point into the polygon array, see b2LinkShapePolygons.
+	b2IdPool geometryIdPool;
+	b2Array( b2Geometry ) geometries;
+	b2Array( b2Polygon ) polygons;
+
 	// This is a dense array of sensor data.
 	b2Array( b2Sensor ) sensors;
 
@@ -159,6 +179,12 @@ typedef struct b2World
 	// - if no bodies want to sleep then there is no reason to perform island splitting
 	int splitIslandId;
 
+	// Contacts moved between graph colors in the most recent step
+	int rebalancedContactCount;
+
+	// Contacts moved by the color sort in the most recent step
+	int sortedContactCount;
+
 	b2Vec2 gravity;
 	float hitEventThreshold;
 	float restitutionThreshold;
@@ -184,6 +210,9 @@ typedef struct b2World
 	void* customFilterContext;
 
 	int workerCount;
+	b2IdlePolicy idlePolicy;
+	int idleSpinCount;
+	int timelineCapacity;
 	b2EnqueueTaskCallback* enqueueTaskFcn;
 	b2FinishTaskCallback* finishTaskFcn;
 	void* userTaskContext;
@@ -191,6 +220,9 @@ typedef struct b2World
 
 	struct b2Scheduler* scheduler;
 
+	// Wide contact solver kernels selected for the CPU
+	const b2ContactSolverKernels* contactSolverKernels;
+
 	void* userData;
 
 	b2Recording* recording; // NULL unless b2World_StartRecording is active, owned by the host
@@ -205,6 +237,9 @@ typedef struct b2World
 	int activeTaskCount;
 	int taskCount;
 
+	// Set while a batch query uses the task system, see b2BeginBatchQuery
+	b2AtomicInt batchQueryActive;
+
 	uint16_t worldId;
 
 	bool enableSleep;
@@ -213,6 +248,11 @@ typedef struct b2World
 	bool enableContactSoftening;
 	bool enableContinuous;
 	bool enableSpeculative;
+	bool enablePipelinedStep;
+	bool enableWideStaticTree;
+	bool enableParallelOverflow;
+	bool enableGraphRebalance;
+	bool enableContactSort;
 	bool inUse;
 } b2World;
 
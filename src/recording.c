@@ -151,6 +151,11 @@ void b2RecW_JOINTID( b2RecBuffer* buf, b2JointId v )
 	b2RecW_U64( buf, b2StoreJointId( v ) );
 }
 
+void b2RecW_GEOMETRYID( b2RecBuffer* buf, b2GeometryId v )
+{
+	b2RecW_U64( buf, b2StoreGeometryId( v ) );
+}
+
 // Geometry is pointer-free POD, pointerWidth in the header gates the layout
 
 void b2RecW_CIRCLE( b2RecBuffer* buf, b2Circle v )
@@ -262,6 +267,7 @@ void b2RecW_SHAPEDEF( b2RecBuffer* buf, b2ShapeDef v )
 	b2RecW_MATERIAL( buf, v.material );
 	b2RecW_F32( buf, v.density );
 	b2RecW_FILTER( buf, v.filter );
+	b2RecW_GEOMETRYID( buf, v.geometry );
 	b2RecW_BOOL( buf, v.enableCustomFiltering );
 	b2RecW_BOOL( buf, v.isSensor );
 	b2RecW_BOOL( buf, v.enableSensorEvents );
@@ -295,6 +301,39 @@ void b2RecW_CHAINDEF( b2RecBuffer* buf, b2ChainDef v )
 	// internalValue omitted
 }
 
+// Variable-length like the chain def. The segments are cloned by b2CreateMeshShape.
+void b2RecW_MESH( b2RecBuffer* buf, b2Mesh v )
+{
+	b2RecW_I32( buf, v.count );
+	for ( int i = 0; i < v.count; ++i )
+	{
+		b2RecW_CHAINSEG( buf, v.segments[i] );
+	}
+}
+
+// Variable-length, the arrays are cloned by b2CreateHeightFieldShape. Cell materials are only
+// written when both the materials and the indices are present.
+void b2RecW_HEIGHTFIELD( b2RecBuffer* buf, b2HeightField v )
+{
+	b2RecW_I32( buf, v.count );
+	for ( int i = 0; i < v.count; ++i )
+	{
+		b2RecW_F32( buf, v.heights[i] );
+	}
+	b2RecW_F32( buf, v.spacing );
+
+	int materialCount = v.materials != NULL && v.materialIndices != NULL ? v.materialCount : 0;
+	b2RecW_I32( buf, materialCount );
+	for ( int i = 0; i < materialCount; ++i )
+	{
+		b2RecW_MATERIAL( buf, v.materials[i] );
+	}
+	for ( int i = 0; materialCount > 0 && i < v.count - 1; ++i )
+	{
+		b2RecW_U8( buf, v.materialIndices[i] );
+	}
+}
+
 void b2RecW_EXPLOSIONDEF( b2RecBuffer* buf, b2ExplosionDef v )
 {
 	b2RecW_U64( buf, v.maskBits );
@@ -648,6 +687,7 @@ void b2RecEndRecord( b2Recording* rec )
 #define B2_REC_RETWRITE_RET_SHAPEID( op, Name ) B2_REC_RETWRITE( op, Name, b2ShapeId, b2RecW_SHAPEID )
 #define B2_REC_RETWRITE_RET_CHAINID( op, Name ) B2_REC_RETWRITE( op, Name, b2ChainId, b2RecW_CHAINID )
 #define B2_REC_RETWRITE_RET_JOINTID( op, Name ) B2_REC_RETWRITE( op, Name, b2JointId, b2RecW_JOINTID )
+#define B2_REC_RETWRITE_RET_GEOMETRYID( op, Name ) B2_REC_RETWRITE( op, Name, b2GeometryId, b2RecW_GEOMETRYID )
 #define B2_REC_OP( op, Name, RET, ... ) B2_REC_RETWRITE_##RET( op, Name )
 #include "recording_ops.inl"
 #undef B2_REC_OP
@@ -656,6 +696,7 @@ void b2RecEndRecord( b2Recording* rec )
 #undef B2_REC_RETWRITE_RET_SHAPEID
 #undef B2_REC_RETWRITE_RET_CHAINID
 #undef B2_REC_RETWRITE_RET_JOINTID
+#undef B2_REC_RETWRITE_RET_GEOMETRYID
 #undef B2_REC_RETWRITE
 
 // Lifecycle
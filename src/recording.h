@@ -80,6 +80,7 @@ typedef b2BodyId b2RecCType_BODYID;
 typedef b2ShapeId b2RecCType_SHAPEID;
 typedef b2ChainId b2RecCType_CHAINID;
 typedef b2JointId b2RecCType_JOINTID;
+typedef b2GeometryId b2RecCType_GEOMETRYID;
 typedef b2Circle b2RecCType_CIRCLE;
 typedef b2Capsule b2RecCType_CAPSULE;
 typedef b2Segment b2RecCType_SEGMENT;
@@ -93,6 +94,8 @@ typedef b2ExplosionDef b2RecCType_EXPLOSIONDEF;
 typedef b2BodyDef b2RecCType_BODYDEF;
 typedef b2ShapeDef b2RecCType_SHAPEDEF;
 typedef b2ChainDef b2RecCType_CHAINDEF;
+typedef b2Mesh b2RecCType_MESH;
+typedef b2HeightField b2RecCType_HEIGHTFIELD;
 typedef b2DistanceJointDef b2RecCType_DISTANCEJOINTDEF;
 typedef b2MotorJointDef b2RecCType_MOTORJOINTDEF;
 typedef b2FilterJointDef b2RecCType_FILTERJOINTDEF;
@@ -150,6 +153,7 @@ void b2RecW_BODYID( b2RecBuffer* buf, b2BodyId v );
 void b2RecW_SHAPEID( b2RecBuffer* buf, b2ShapeId v );
 void b2RecW_CHAINID( b2RecBuffer* buf, b2ChainId v );
 void b2RecW_JOINTID( b2RecBuffer* buf, b2JointId v );
+void b2RecW_GEOMETRYID( b2RecBuffer* buf, b2GeometryId v );
 void b2RecW_CIRCLE( b2RecBuffer* buf, b2Circle v );
 void b2RecW_CAPSULE( b2RecBuffer* buf, b2Capsule v );
 void b2RecW_SEGMENT( b2RecBuffer* buf, b2Segment v );
@@ -164,6 +168,8 @@ void b2RecW_EXPLOSIONDEF( b2RecBuffer* buf, b2ExplosionDef v );
 void b2RecW_BODYDEF( b2RecBuffer* buf, b2BodyDef v );
 void b2RecW_SHAPEDEF( b2RecBuffer* buf, b2ShapeDef v );
 void b2RecW_CHAINDEF( b2RecBuffer* buf, b2ChainDef v );
+void b2RecW_MESH( b2RecBuffer* buf, b2Mesh v );
+void b2RecW_HEIGHTFIELD( b2RecBuffer* buf, b2HeightField v );
 void b2RecW_DISTANCEJOINTDEF( b2RecBuffer* buf, b2DistanceJointDef v );
 void b2RecW_MOTORJOINTDEF( b2RecBuffer* buf, b2MotorJointDef v );
 void b2RecW_FILTERJOINTDEF( b2RecBuffer* buf, b2FilterJointDef v );
@@ -201,6 +207,8 @@ void b2RecEndRecord( b2Recording* rec );
 #define B2_REC_RETDECL_RET_SHAPEID( Name ) void b2RecWriteRet_##Name( b2Recording* rec, const b2RecArgs_##Name* a, b2ShapeId id );
 #define B2_REC_RETDECL_RET_CHAINID( Name ) void b2RecWriteRet_##Name( b2Recording* rec, const b2RecArgs_##Name* a, b2ChainId id );
 #define B2_REC_RETDECL_RET_JOINTID( Name ) void b2RecWriteRet_##Name( b2Recording* rec, const b2RecArgs_##Name* a, b2JointId id );
+#define B2_REC_RETDECL_RET_GEOMETRYID( Name )                                                                                    \
+	void b2RecWriteRet_##Name( b2Recording* rec, const b2RecArgs_##Name* a, b2GeometryId id );
 #define B2_REC_OP( op, Name, RET, ... ) B2_REC_RETDECL_##RET( Name )
 #include "recording_ops.inl"
 #undef B2_REC_OP
@@ -209,6 +217,7 @@ void b2RecEndRecord( b2Recording* rec );
 #undef B2_REC_RETDECL_RET_SHAPEID
 #undef B2_REC_RETDECL_RET_CHAINID
 #undef B2_REC_RETDECL_RET_JOINTID
+#undef B2_REC_RETDECL_RET_GEOMETRYID
 
 // Record a void op. One branch when recording is off, args built inside the branch
 #define B2_REC( world, Name, ... )                                                                                               \
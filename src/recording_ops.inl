@@ -5,7 +5,7 @@
 // Include with B2_REC_OP and ARG defined. No commas between ARG tokens.
 //
 // B2_REC_OP( opcode, Name, RET, ARGS )
-//   RET in { RET_NONE, RET_BODYID, RET_SHAPEID }
+//   RET in { RET_NONE, RET_BODYID, RET_SHAPEID, RET_CHAINID, RET_JOINTID, RET_GEOMETRYID }
 //   ARGS = zero or more ARG( TAG, fieldName ) tokens, NO commas between them
 //
 // Opcode ranges:
@@ -80,6 +80,10 @@ B2_REC_OP( 0x42, CreateSegmentShape, RET_SHAPEID, ARG( BODYID, body ) ARG( SHAPE
 B2_REC_OP( 0x43, CreatePolygonShape, RET_SHAPEID, ARG( BODYID, body ) ARG( SHAPEDEF, def ) ARG( POLYGON, polygon ) )
 B2_REC_OP( 0x44, CreateChainSegmentShape, RET_SHAPEID, ARG( BODYID, body ) ARG( SHAPEDEF, def ) ARG( CHAINSEG, chainSegment ) )
 B2_REC_OP( 0x45, DestroyShape, RET_NONE, ARG( SHAPEID, shape ) ARG( BOOL, updateBodyMass ) )
+B2_REC_OP( 0x46, CreateMeshShape, RET_SHAPEID, ARG( BODYID, body ) ARG( SHAPEDEF, def ) ARG( MESH, mesh ) )
+B2_REC_OP( 0x47, CreateHeightFieldShape, RET_SHAPEID, ARG( BODYID, body ) ARG( SHAPEDEF, def ) ARG( HEIGHTFIELD, heightField ) )
+B2_REC_OP( 0x48, CreateGeometry, RET_GEOMETRYID, ARG( WORLDID, world ) ARG( POLYGON, polygon ) )
+B2_REC_OP( 0x49, DestroyGeometry, RET_NONE, ARG( GEOMETRYID, geometry ) )
 
 // Shape mutators
 B2_REC_OP( 0x50, ShapeSetDensity, RET_NONE, ARG( SHAPEID, shape ) ARG( F32, density ) ARG( BOOL, updateBodyMass ) )
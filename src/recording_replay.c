@@ -166,6 +166,11 @@ b2JointId b2RecR_JOINTID( b2RecReader* rdr )
 	return b2LoadJointId( b2RecR_U64( rdr ) );
 }
 
+b2GeometryId b2RecR_GEOMETRYID( b2RecReader* rdr )
+{
+	return b2LoadGeometryId( b2RecR_U64( rdr ) );
+}
+
 // Read a pointer-free POD blob of the given size into out, advancing the cursor.
 // Zeroes out on overrun so a truncated file fails the read check rather than reading garbage.
 static void b2RecRdrBlob( b2RecReader* rdr, void* out, int size )
@@ -323,6 +328,7 @@ b2ShapeDef b2RecR_SHAPEDEF( b2RecReader* rdr )
 	def.material = b2RecR_MATERIAL( rdr );
 	def.density = b2RecR_F32( rdr );
 	def.filter = b2RecR_FILTER( rdr );
+	def.geometry = b2RecR_GEOMETRYID( rdr );
 	def.enableCustomFiltering = b2RecR_BOOL( rdr );
 	def.isSensor = b2RecR_BOOL( rdr );
 	def.enableSensorEvents = b2RecR_BOOL( rdr );
@@ -380,6 +386,80 @@ b2ChainDef b2RecR_CHAINDEF( b2RecReader* rdr )
 	return def;
 }
 
+b2Mesh b2RecR_MESH( b2RecReader* rdr )
+{
+	int count = b2RecR_I32( rdr );
+	if ( count < 0 )
+	{
+		count = 0;
+	}
+	if ( b2RecReserveScratch( rdr, (void**)&rdr->meshSegments, &rdr->meshSegmentCap, count, (int)sizeof( b2ChainSegment ) ) ==
+		 false )
+	{
+		count = 0; // corrupt count, the read has already failed
+	}
+	for ( int i = 0; i < count; ++i )
+	{
+		rdr->meshSegments[i] = b2RecR_CHAINSEG( rdr );
+	}
+
+	b2Mesh mesh = { count > 0 ? rdr->meshSegments : NULL, count };
+	return mesh;
+}
+
+// The cell materials share the chain material scratch
+b2HeightField b2RecR_HEIGHTFIELD( b2RecReader* rdr )
+{
+	b2HeightField heightField = { 0 };
+
+	int count = b2RecR_I32( rdr );
+	if ( count < 0 )
+	{
+		count = 0;
+	}
+	if ( b2RecReserveScratch( rdr, (void**)&rdr->heights, &rdr->heightCap, count, (int)sizeof( float ) ) == false )
+	{
+		count = 0; // corrupt count, the read has already failed
+	}
+	for ( int i = 0; i < count; ++i )
+	{
+		rdr->heights[i] = b2RecR_F32( rdr );
+	}
+	heightField.heights = count > 0 ? rdr->heights : NULL;
+	heightField.count = count;
+	heightField.spacing = b2RecR_F32( rdr );
+
+	int materialCount = b2RecR_I32( rdr );
+	if ( materialCount < 0 || count < 2 )
+	{
+		materialCount = 0;
+	}
+	if ( b2RecReserveScratch( rdr, (void**)&rdr->chainMaterials, &rdr->chainMaterialCap, materialCount,
+							  (int)sizeof( b2SurfaceMaterial ) ) == false ||
+		 b2RecReserveScratch( rdr, (void**)&rdr->materialIndices, &rdr->materialIndexCap, materialCount > 0 ? count - 1 : 0,
+							  (int)sizeof( uint8_t ) ) == false )
+	{
+		materialCount = 0;
+	}
+	for ( int i = 0; i < materialCount; ++i )
+	{
+		rdr->chainMaterials[i] = b2RecR_MATERIAL( rdr );
+	}
+	for ( int i = 0; materialCount > 0 && i < count - 1; ++i )
+	{
+		rdr->materialIndices[i] = b2RecR_U8( rdr );
+	}
+
+	if ( materialCount > 0 )
+	{
+		heightField.materials = rdr->chainMaterials;
+		heightField.materialCount = materialCount;
+		heightField.materialIndices = rdr->materialIndices;
+	}
+
+	return heightField;
+}
+
 b2ExplosionDef b2RecR_EXPLOSIONDEF( b2RecReader* rdr )
 {
 	b2ExplosionDef def = b2DefaultExplosionDef();
@@ -685,6 +765,15 @@ static b2ChainId b2RecMakeChainId( b2RecReader* rdr, b2ChainId recorded )
 	return id;
 }
 
+static b2GeometryId b2RecMakeGeometryId( b2RecReader* rdr, b2GeometryId recorded )
+{
+	b2GeometryId id;
+	id.index1 = recorded.index1;
+	id.world0 = (uint16_t)( rdr->replayWorldId.index1 - 1u );
+	id.generation = recorded.generation;
+	return id;
+}
+
 static b2JointId b2RecMakeJointId( b2RecReader* rdr, b2JointId recorded )
 {
 	b2JointId id;
@@ -722,6 +811,11 @@ static void b2RecCheckChainId( b2RecReader* rdr, b2ChainId got, b2ChainId rec )
 	b2RecCheckId( rdr, "chain", got.index1, got.generation, rec.index1, rec.generation );
 }
 
+static void b2RecCheckGeometryId( b2RecReader* rdr, b2GeometryId got, b2GeometryId rec )
+{
+	b2RecCheckId( rdr, "geometry", got.index1, got.generation, rec.index1, rec.generation );
+}
+
 static void b2RecCheckJointId( b2RecReader* rdr, b2JointId got, b2JointId rec )
 {
 	b2RecCheckId( rdr, "joint", got.index1, got.generation, rec.index1, rec.generation );
@@ -1039,10 +1133,27 @@ static void b2RecDispatch_CreatePolygonShape( const b2RecArgs_CreatePolygonShape
 {
 	b2ShapeId recId = b2RecR_SHAPEID( rdr );
 	b2BodyId bodyId = b2RecMakeBodyId( rdr, a->body );
-	b2ShapeId gotId = b2CreatePolygonShape( bodyId, &a->def, &a->polygon );
+	b2ShapeDef def = a->def;
+	if ( B2_IS_NON_NULL( def.geometry ) )
+	{
+		def.geometry = b2RecMakeGeometryId( rdr, def.geometry );
+	}
+	b2ShapeId gotId = b2CreatePolygonShape( bodyId, &def, &a->polygon );
 	b2RecCheckShapeId( rdr, gotId, recId );
 }
 
+static void b2RecDispatch_CreateGeometry( const b2RecArgs_CreateGeometry* a, b2RecReader* rdr )
+{
+	b2GeometryId recId = b2RecR_GEOMETRYID( rdr );
+	b2GeometryId gotId = b2CreateGeometry( rdr->replayWorldId, &a->polygon );
+	b2RecCheckGeometryId( rdr, gotId, recId );
+}
+
+static void b2RecDispatch_DestroyGeometry( const b2RecArgs_DestroyGeometry* a, b2RecReader* rdr )
+{
+	b2DestroyGeometry( b2RecMakeGeometryId( rdr, a->geometry ) );
+}
+
 static void b2RecDispatch_CreateChainSegmentShape( const b2RecArgs_CreateChainSegmentShape* a, b2RecReader* rdr )
 {
 	b2ShapeId recId = b2RecR_SHAPEID( rdr );
@@ -1051,6 +1162,22 @@ static void b2RecDispatch_CreateChainSegmentShape( const b2RecArgs_CreateChainSe
 	b2RecCheckShapeId( rdr, gotId, recId );
 }
 
+static void b2RecDispatch_CreateMeshShape( const b2RecArgs_CreateMeshShape* a, b2RecReader* rdr )
+{
+	b2ShapeId recId = b2RecR_SHAPEID( rdr );
+	b2BodyId bodyId = b2RecMakeBodyId( rdr, a->body );
+	b2ShapeId gotId = b2CreateMeshShape( bodyId, &a->def, &a->mesh );
+	b2RecCheckShapeId( rdr, gotId, recId );
+}
+
+static void b2RecDispatch_CreateHeightFieldShape( const b2RecArgs_CreateHeightFieldShape* a, b2RecReader* rdr )
+{
+	b2ShapeId recId = b2RecR_SHAPEID( rdr );
+	b2BodyId bodyId = b2RecMakeBodyId( rdr, a->body );
+	b2ShapeId gotId = b2CreateHeightFieldShape( bodyId, &a->def, &a->heightField );
+	b2RecCheckShapeId( rdr, gotId, recId );
+}
+
 static void b2RecDispatch_DestroyShape( const b2RecArgs_DestroyShape* a, b2RecReader* rdr )
 {
 	b2DestroyShape( b2RecMakeShapeId( rdr, a->shape ), a->updateBodyMass );
@@ -2089,6 +2216,12 @@ b2RecPlayer* b2RecPlayer_Create( const void* data, int size, int workerCount )
 	player->rdr.chainPointCap = 0;
 	player->rdr.chainMaterials = NULL;
 	player->rdr.chainMaterialCap = 0;
+	player->rdr.meshSegments = NULL;
+	player->rdr.meshSegmentCap = 0;
+	player->rdr.heights = NULL;
+	player->rdr.heightCap = 0;
+	player->rdr.materialIndices = NULL;
+	player->rdr.materialIndexCap = 0;
 	player->rdr.hits = NULL;
 	player->rdr.hitCap = 0;
 	player->rdr.owner = player;
@@ -2497,6 +2630,18 @@ void b2RecPlayer_Destroy( b2RecPlayer* player )
 	{
 		b2Free( player->rdr.chainMaterials, player->rdr.chainMaterialCap * (int)sizeof( b2SurfaceMaterial ) );
 	}
+	if ( player->rdr.meshSegments != NULL )
+	{
+		b2Free( player->rdr.meshSegments, player->rdr.meshSegmentCap * (int)sizeof( b2ChainSegment ) );
+	}
+	if ( player->rdr.heights != NULL )
+	{
+		b2Free( player->rdr.heights, player->rdr.heightCap * (int)sizeof( float ) );
+	}
+	if ( player->rdr.materialIndices != NULL )
+	{
+		b2Free( player->rdr.materialIndices, player->rdr.materialIndexCap * (int)sizeof( uint8_t ) );
+	}
 	if ( player->rdr.hits != NULL )
 	{
 		b2Free( player->rdr.hits, player->rdr.hitCap * (int)sizeof( b2RecRecordedHit ) );
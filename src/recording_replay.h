@@ -70,6 +70,12 @@ typedef struct b2RecReader
 	int chainPointCap;
 	b2SurfaceMaterial* chainMaterials;
 	int chainMaterialCap;
+	b2ChainSegment* meshSegments;
+	int meshSegmentCap;
+	float* heights;
+	int heightCap;
+	uint8_t* materialIndices;
+	int materialIndexCap;
 
 	// Scratch for recorded query hits; grown on demand, freed with the player
 	b2RecRecordedHit* hits;
@@ -163,6 +169,7 @@ b2BodyId b2RecR_BODYID( b2RecReader* rdr );
 b2ShapeId b2RecR_SHAPEID( b2RecReader* rdr );
 b2ChainId b2RecR_CHAINID( b2RecReader* rdr );
 b2JointId b2RecR_JOINTID( b2RecReader* rdr );
+b2GeometryId b2RecR_GEOMETRYID( b2RecReader* rdr );
 b2Circle b2RecR_CIRCLE( b2RecReader* rdr );
 b2Capsule b2RecR_CAPSULE( b2RecReader* rdr );
 b2Segment b2RecR_SEGMENT( b2RecReader* rdr );
@@ -177,6 +184,8 @@ b2ExplosionDef b2RecR_EXPLOSIONDEF( b2RecReader* rdr );
 b2BodyDef b2RecR_BODYDEF( b2RecReader* rdr );
 b2ShapeDef b2RecR_SHAPEDEF( b2RecReader* rdr );
 b2ChainDef b2RecR_CHAINDEF( b2RecReader* rdr );
+b2Mesh b2RecR_MESH( b2RecReader* rdr );
+b2HeightField b2RecR_HEIGHTFIELD( b2RecReader* rdr );
 b2DistanceJointDef b2RecR_DISTANCEJOINTDEF( b2RecReader* rdr );
 b2MotorJointDef b2RecR_MOTORJOINTDEF( b2RecReader* rdr );
 b2FilterJointDef b2RecR_FILTERJOINTDEF( b2RecReader* rdr );
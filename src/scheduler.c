@@ -24,8 +24,56 @@ typedef struct b2SchedulerTask
 	b2TaskCallback* callback;
 	void* taskContext;
 	b2AtomicInt status;
+
+	// The queue that holds this task (work stealing only)
+	int queueIndex;
 } b2SchedulerTask;
 
+// Per worker task queue for the work stealing scheduler. Tasks are appended at the tail by the
+// thread that enqueues them (the thread running b2World_Step) and taken from the head by the
+// owning worker first and by other workers once their own queue runs dry. Takers race with a
+// CAS on head. A queue never holds more than B2_MAX_TASKS entries, so the slots are a ring.
+// Head and tail only grow and are never reset. Otherwise a taker that was preempted between
+// reading a slot and its CAS could win the CAS after a reset and run a stale task.
+typedef struct b2TaskQueue
+{
+	// Next entry to take
+	b2AtomicInt head;
+
+	// padding to prevent false sharing
+	char padding1[64];
+
+	// Next entry to fill
+	b2AtomicInt tail;
+
+	// Set by the owning worker right before it parks. The enqueuing thread only signals the
+	// semaphore if it wins the CAS that clears this flag, so a spinning worker is never signaled
+	// and the semaphore count stays at zero or one.
+	b2AtomicInt sleeping;
+
+	// padding to prevent false sharing
+	char padding2[64];
+
+	// Wakes the owning worker
+	b2Semaphore* semaphore;
+
+	// Indices into the scheduler task table
+	int slots[B2_MAX_TASKS];
+} b2TaskQueue;
+
+// Idle time of one thread. The atomics are only written by the owning thread and accumulate over
+// the life of the scheduler. The stepping thread takes a snapshot at each reset.
+typedef struct b2IdleStats
+{
+	b2AtomicI64 spinNanoseconds;
+	b2AtomicI64 parkNanoseconds;
+	int64_t spinBase;
+	int64_t parkBase;
+
+	// padding to prevent false sharing
+	char padding[32];
+} b2IdleStats;
+
 typedef struct b2SchedulerWorkerContext
 {
 	struct b2Scheduler* scheduler;
@@ -43,16 +91,59 @@ typedef struct b2Scheduler
 	// threads created = workerCount - 1
 	int threadCount;
 
+	b2SchedulerType type;
+	b2IdlePolicy idlePolicy;
+	int idleSpinCount;
+
 	b2SchedulerTask tasks[B2_MAX_TASKS];
 	b2AtomicInt nextSlot;
 
+	// Work stealing: one queue per background thread
+	b2TaskQueue queues[B2_MAX_WORKERS];
+
+	// Shared table: all workers wait on one semaphore and scan the task table
 	b2Semaphore* taskSemaphore;
+
+	// Indexed by thread, main thread is 0
+	b2IdleStats idleStats[B2_MAX_WORKERS];
+
+	// Ticks of the last reset. Park time before this belongs to the previous step.
+	b2AtomicI64 resetTicks;
+
 	b2AtomicInt shutdown;
 } b2Scheduler;
 
-// Try to claim and execute one pending task.
+// Add the idle time from startTicks until now. Idle time between steps is not charged to the current step.
+static void b2AddIdleTime( b2Scheduler* scheduler, b2AtomicI64* nanoseconds, uint64_t startTicks )
+{
+	uint64_t resetTicks = (uint64_t)b2AtomicLoadI64( &scheduler->resetTicks );
+	if ( b2GetTicks() <= resetTicks )
+	{
+		return;
+	}
+
+	startTicks = startTicks > resetTicks ? startTicks : resetTicks;
+	float milliseconds = b2GetMilliseconds( startTicks );
+	(void)b2AtomicFetchAddI64( nanoseconds, (int64_t)( 1000000.0f * milliseconds ) );
+}
+
+// Block on a semaphore and record the time spent parked
+static void b2Park( b2Scheduler* scheduler, b2Semaphore* semaphore, b2IdleStats* stats )
+{
+	uint64_t parkTicks = b2GetTicks();
+	b2WaitSemaphore( semaphore );
+	b2AddIdleTime( scheduler, &stats->parkNanoseconds, parkTicks );
+}
+
+static void b2SchedulerRunTask( b2SchedulerTask* task )
+{
+	task->callback( task->taskContext );
+	b2AtomicStoreInt( &task->status, b2_schedulerComplete );
+}
+
+// Shared table: try to claim and execute one pending task.
 // Returns true if work was performed, false otherwise.
-static bool b2SchedulerExecuteOne( b2Scheduler* scheduler )
+static bool b2SchedulerExecuteShared( b2Scheduler* scheduler )
 {
 	int taskCount = b2AtomicLoadInt( &scheduler->nextSlot );
 	for ( int t = 0; t < taskCount; ++t )
@@ -68,38 +159,173 @@ static bool b2SchedulerExecuteOne( b2Scheduler* scheduler )
 			continue;
 		}
 
-		task->callback( task->taskContext );
-
-		b2AtomicStoreInt( &task->status, b2_schedulerComplete );
+		b2SchedulerRunTask( task );
 		return true;
 	}
 
 	return false;
 }
 
+// Head and tail wrap around, so compare them by difference
+static inline int b2GetQueueCount( int head, int tail )
+{
+	return (int)( (uint32_t)tail - (uint32_t)head );
+}
+
+static inline int b2NextQueueIndex( int index )
+{
+	return (int)( (uint32_t)index + 1u );
+}
+
+// Take the task at the head of a queue. Returns the task slot or B2_NULL_INDEX if the queue is empty.
+static int b2TakeTask( b2TaskQueue* queue )
+{
+	while ( true )
+	{
+		int head = b2AtomicLoadInt( &queue->head );
+		int tail = b2AtomicLoadInt( &queue->tail );
+		if ( b2GetQueueCount( head, tail ) <= 0 )
+		{
+			return B2_NULL_INDEX;
+		}
+
+		// The slot is published before the tail so this read is valid
+		int slot = queue->slots[(uint32_t)head % B2_MAX_TASKS];
+		if ( b2AtomicCompareExchangeInt( &queue->head, head, b2NextQueueIndex( head ) ) )
+		{
+			return slot;
+		}
+	}
+}
+
+// Work stealing: execute one task, preferring the given queue and then stealing from the
+// following queues. Returns true if work was performed, false otherwise.
+static bool b2SchedulerExecuteStealing( b2Scheduler* scheduler, int queueIndex )
+{
+	int queueCount = scheduler->threadCount;
+	for ( int i = 0; i < queueCount; ++i )
+	{
+		int index = queueIndex + i < queueCount ? queueIndex + i : queueIndex + i - queueCount;
+		int slot = b2TakeTask( scheduler->queues + index );
+		if ( slot != B2_NULL_INDEX )
+		{
+			b2SchedulerTask* task = scheduler->tasks + slot;
+			b2AtomicStoreInt( &task->status, b2_schedulerClaimed );
+			b2SchedulerRunTask( task );
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Work stealing: check for work without taking it
+static bool b2HasPendingTask( b2Scheduler* scheduler )
+{
+	for ( int i = 0; i < scheduler->threadCount; ++i )
+	{
+		b2TaskQueue* queue = scheduler->queues + i;
+		if ( b2GetQueueCount( b2AtomicLoadInt( &queue->head ), b2AtomicLoadInt( &queue->tail ) ) > 0 )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 // Background worker thread entry point.
 static void b2SchedulerWorkerMain( void* context )
 {
 	b2SchedulerWorkerContext* workerContext = context;
 	b2Scheduler* scheduler = workerContext->scheduler;
+	b2IdleStats* stats = scheduler->idleStats + workerContext->threadIndex;
 
-	while ( true )
+	if ( scheduler->type == b2_sharedTableScheduler )
+	{
+		while ( true )
+		{
+			b2Park( scheduler, scheduler->taskSemaphore, stats );
+
+			if ( b2AtomicLoadInt( &scheduler->shutdown ) != 0 )
+			{
+				break;
+			}
+
+			// Claim and execute all available work
+			while ( b2SchedulerExecuteShared( scheduler ) )
+			{
+			}
+		}
+
+		return;
+	}
+
+	// Thread index 1 owns queue 0
+	int queueIndex = workerContext->threadIndex - 1;
+	b2TaskQueue* queue = scheduler->queues + queueIndex;
+	b2IdlePolicy idlePolicy = scheduler->idlePolicy;
+	int idleSpinCount = scheduler->idleSpinCount;
+
+	while ( b2AtomicLoadInt( &scheduler->shutdown ) == 0 )
 	{
-		b2WaitSemaphore( scheduler->taskSemaphore );
+		// Drain the local queue, then steal until there is no work left anywhere
+		while ( b2SchedulerExecuteStealing( scheduler, queueIndex ) )
+		{
+		}
 
-		if ( b2AtomicLoadInt( &scheduler->shutdown ) != 0 )
+		// Poll for new work. Only the park policy gives up once the spin budget is spent.
+		uint64_t spinTicks = b2GetTicks();
+		bool workFound = false;
+		int spinCount = 0;
+		while ( b2AtomicLoadInt( &scheduler->shutdown ) == 0 )
 		{
-			break;
+			if ( b2HasPendingTask( scheduler ) )
+			{
+				workFound = true;
+				break;
+			}
+
+			if ( spinCount < idleSpinCount || idlePolicy == b2_idleSpin )
+			{
+				b2Pause();
+				spinCount += 1;
+			}
+			else if ( idlePolicy == b2_idleSpinThenYield )
+			{
+				b2Yield();
+			}
+			else
+			{
+				break;
+			}
 		}
 
-		// Claim and execute all available work
-		while ( b2SchedulerExecuteOne( scheduler ) )
+		b2AddIdleTime( scheduler, &stats->spinNanoseconds, spinTicks );
+
+		if ( workFound || b2AtomicLoadInt( &scheduler->shutdown ) != 0 )
 		{
+			continue;
 		}
+
+		// Announce the park, then check the queue again. Either this check sees a task enqueued
+		// concurrently or the enqueuing thread sees the flag and signals.
+		b2AtomicStoreInt( &queue->sleeping, 1 );
+		if ( b2GetQueueCount( b2AtomicLoadInt( &queue->head ), b2AtomicLoadInt( &queue->tail ) ) > 0 )
+		{
+			if ( b2AtomicCompareExchangeInt( &queue->sleeping, 1, 0 ) )
+			{
+				continue;
+			}
+
+			// The enqueuing thread already cleared the flag and is signaling, so consume the signal
+		}
+
+		b2Park( scheduler, queue->semaphore, stats );
 	}
 }
 
-b2Scheduler* b2CreateScheduler( int workerCount )
+b2Scheduler* b2CreateScheduler( int workerCount, b2SchedulerType type, b2IdlePolicy idlePolicy, int idleSpinCount )
 {
 	B2_ASSERT( 0 < workerCount && workerCount <= B2_MAX_WORKERS );
 
@@ -109,10 +335,28 @@ b2Scheduler* b2CreateScheduler( int workerCount )
 	scheduler->workerCount = workerCount;
 	int threadCount = workerCount - 1;
 	scheduler->threadCount = threadCount;
-	scheduler->taskSemaphore = b2CreateSemaphore( 0 );
+	scheduler->type = type;
+	scheduler->idlePolicy = idlePolicy;
+	scheduler->idleSpinCount = idleSpinCount;
+	b2AtomicStoreI64( &scheduler->resetTicks, (int64_t)b2GetTicks() );
 	b2AtomicStoreInt( &scheduler->shutdown, 0 );
 	b2AtomicStoreInt( &scheduler->nextSlot, 0 );
 
+	if ( type == b2_sharedTableScheduler )
+	{
+		scheduler->taskSemaphore = b2CreateSemaphore( 0 );
+	}
+	else
+	{
+		for ( int i = 0; i < threadCount; ++i )
+		{
+			scheduler->queues[i].semaphore = b2CreateSemaphore( 0 );
+			b2AtomicStoreInt( &scheduler->queues[i].head, 0 );
+			b2AtomicStoreInt( &scheduler->queues[i].tail, 0 );
+			b2AtomicStoreInt( &scheduler->queues[i].sleeping, 0 );
+		}
+	}
+
 	// Background threads use indices 1..workerCount-1.
 	// Main thread uses index 0.
 	for ( int i = 0; i < threadCount; ++i )
@@ -135,7 +379,14 @@ void b2DestroyScheduler( b2Scheduler* scheduler )
 	// Wake all background threads so they see the shutdown flag
 	for ( int i = 0; i < scheduler->threadCount; ++i )
 	{
-		b2SignalSemaphore( scheduler->taskSemaphore );
+		if ( scheduler->type == b2_sharedTableScheduler )
+		{
+			b2SignalSemaphore( scheduler->taskSemaphore );
+		}
+		else
+		{
+			b2SignalSemaphore( scheduler->queues[i].semaphore );
+		}
 	}
 
 	for ( int i = 0; i < scheduler->threadCount; ++i )
@@ -144,13 +395,51 @@ void b2DestroyScheduler( b2Scheduler* scheduler )
 		scheduler->threads[i] = NULL;
 	}
 
-	b2DestroySemaphore( scheduler->taskSemaphore );
+	if ( scheduler->type == b2_sharedTableScheduler )
+	{
+		b2DestroySemaphore( scheduler->taskSemaphore );
+	}
+	else
+	{
+		for ( int i = 0; i < scheduler->threadCount; ++i )
+		{
+			b2DestroySemaphore( scheduler->queues[i].semaphore );
+		}
+	}
+
 	b2Free( scheduler, sizeof( b2Scheduler ) );
 }
 
 void b2ResetScheduler( b2Scheduler* scheduler )
 {
+	// All tasks from the previous step have been taken and finished, so the queues are empty.
+	// The queue indices keep growing, see b2TaskQueue.
+	for ( int i = 0; i < scheduler->threadCount; ++i )
+	{
+		B2_ASSERT( b2GetQueueCount( b2AtomicLoadInt( &scheduler->queues[i].head ),
+									b2AtomicLoadInt( &scheduler->queues[i].tail ) ) == 0 );
+	}
+
 	b2AtomicStoreInt( &scheduler->nextSlot, 0 );
+
+	for ( int i = 0; i < scheduler->workerCount; ++i )
+	{
+		b2IdleStats* stats = scheduler->idleStats + i;
+		stats->spinBase = b2AtomicLoadI64( &stats->spinNanoseconds );
+		stats->parkBase = b2AtomicLoadI64( &stats->parkNanoseconds );
+	}
+
+	b2AtomicStoreI64( &scheduler->resetTicks, (int64_t)b2GetTicks() );
+}
+
+void b2GetSchedulerIdleTimes( b2Scheduler* scheduler, float* spinTimes, float* parkTimes )
+{
+	for ( int i = 0; i < scheduler->workerCount; ++i )
+	{
+		b2IdleStats* stats = scheduler->idleStats + i;
+		spinTimes[i] += 0.000001f * (float)( b2AtomicLoadI64( &stats->spinNanoseconds ) - stats->spinBase );
+		parkTimes[i] += 0.000001f * (float)( b2AtomicLoadI64( &stats->parkNanoseconds ) - stats->parkBase );
+	}
 }
 
 void* b2SchedulerEnqueueTask( b2TaskCallback* task, void* taskContext, void* userContext )
@@ -164,11 +453,37 @@ void* b2SchedulerEnqueueTask( b2TaskCallback* task, void* taskContext, void* use
 	schedulerTask->callback = task;
 	schedulerTask->taskContext = taskContext;
 
-	// Memory fence: status must be published after callback and context are written
+	if ( scheduler->type == b2_sharedTableScheduler )
+	{
+		schedulerTask->queueIndex = B2_NULL_INDEX;
+
+		// Memory fence: status must be published after callback and context are written
+		b2AtomicStoreInt( &schedulerTask->status, b2_schedulerPending );
+
+		// One wake per enqueue is enough: at most one worker picks up each task.
+		b2SignalSemaphore( scheduler->taskSemaphore );
+
+		return schedulerTask;
+	}
+
+	// Spread tasks round-robin over the worker queues. Tasks are only enqueued from the thread
+	// that steps the world, so each queue has a single producer.
+	int queueIndex = slot % scheduler->threadCount;
+	schedulerTask->queueIndex = queueIndex;
 	b2AtomicStoreInt( &schedulerTask->status, b2_schedulerPending );
 
-	// One wake per enqueue is enough: at most one worker picks up each task.
-	b2SignalSemaphore( scheduler->taskSemaphore );
+	b2TaskQueue* queue = scheduler->queues + queueIndex;
+	int tail = b2AtomicLoadInt( &queue->tail );
+	queue->slots[(uint32_t)tail % B2_MAX_TASKS] = slot;
+
+	// Memory fence: the slot must be published before the tail
+	b2AtomicStoreInt( &queue->tail, b2NextQueueIndex( tail ) );
+
+	// Wake the owner if it is parked. Other workers only steal while they are already awake.
+	if ( b2AtomicCompareExchangeInt( &queue->sleeping, 1, 0 ) )
+	{
+		b2SignalSemaphore( queue->semaphore );
+	}
 
 	return schedulerTask;
 }
@@ -186,11 +501,58 @@ void b2SchedulerFinishTask( void* userTask, void* userContext )
 	// Main thread helps execute any available work while waiting for the
 	// target task to complete. This keeps the main thread from idling when
 	// background threads are busy on other tasks from the same phase.
+	// With work stealing the main thread starts at the queue holding the target
+	// task, so it runs the target itself if no worker has started it yet.
+
+	// Time without work is charged to the main thread as spin time. The main thread never parks
+	// because nothing would wake it when the task completes.
+	b2IdleStats* stats = scheduler->idleStats + 0;
+	uint64_t spinTicks = 0;
+	bool spinning = false;
+	int spinCount = 0;
 	while ( b2AtomicLoadInt( &waitTask->status ) != b2_schedulerComplete )
 	{
-		if ( b2SchedulerExecuteOne( scheduler ) == false )
+		bool executed;
+		if ( scheduler->type == b2_sharedTableScheduler )
+		{
+			executed = b2SchedulerExecuteShared( scheduler );
+		}
+		else
+		{
+			executed = b2SchedulerExecuteStealing( scheduler, waitTask->queueIndex );
+		}
+
+		if ( executed )
+		{
+			if ( spinning )
+			{
+				b2AddIdleTime( scheduler, &stats->spinNanoseconds, spinTicks );
+				spinning = false;
+			}
+
+			spinCount = 0;
+			continue;
+		}
+
+		if ( spinning == false )
+		{
+			spinTicks = b2GetTicks();
+			spinning = true;
+		}
+
+		if ( spinCount < scheduler->idleSpinCount || scheduler->idlePolicy == b2_idleSpin )
+		{
+			b2Pause();
+			spinCount += 1;
+		}
+		else
 		{
 			b2Yield();
 		}
 	}
+
+	if ( spinning )
+	{
+		b2AddIdleTime( scheduler, &stats->spinNanoseconds, spinTicks );
+	}
 }
@@ -3,13 +3,19 @@
 
 #pragma once
 
+#include "box2d/types.h"
+
 typedef void b2TaskCallback( void* taskContext );
 typedef struct b2Scheduler b2Scheduler;
 
-b2Scheduler* b2CreateScheduler( int workerCount );
+b2Scheduler* b2CreateScheduler( int workerCount, b2SchedulerType type, b2IdlePolicy idlePolicy, int idleSpinCount );
 void b2DestroyScheduler( b2Scheduler* scheduler );
 void b2ResetScheduler( b2Scheduler* scheduler );
 
+// Adds the time each thread spent spinning and parked since the last reset, in milliseconds.
+// The arrays are indexed by thread and must hold B2_MAX_WORKERS entries.
+void b2GetSchedulerIdleTimes( b2Scheduler* scheduler, float* spinTimes, float* parkTimes );
+
 // See b2EnqueueTaskCallback and b2FinishTaskCallback
 void* b2SchedulerEnqueueTask( b2TaskCallback* task, void* taskContext, void* userContext );
 void b2SchedulerFinishTask( void* userTask, void* userContext );
@@ -22,6 +22,7 @@ struct b2SensorQueryContext
 	b2SensorTaskContext* taskContext;
 	b2Sensor* sensor;
 	b2Shape* sensorShape;
+	b2ShapeSim* sensorShapeSim;
 	b2Transform transform;
 };
 
@@ -57,20 +58,23 @@ static bool b2SensorQueryCallback( int proxyId, uint64_t userData, void* context
 	}
 
 	b2World* world = queryContext->world;
-	b2Shape* otherShape = b2Array_Get( world->shapes,shapeId );
+	b2ShapeSim* sensorShapeSim = queryContext->sensorShapeSim;
+	b2ShapeSim* otherShapeSim = b2Array_Get( world->shapeSims, shapeId );
 
 	// Are sensor events enabled on the other shape?
-	if ( otherShape->enableSensorEvents == false )
+	if ( otherShapeSim->enableSensorEvents == false )
 	{
 		return true;
 	}
 
 	// Skip shapes on the same body
-	if ( otherShape->bodyId == sensorShape->bodyId )
+	if ( otherShapeSim->bodyId == sensorShapeSim->bodyId )
 	{
 		return true;
 	}
 
+	b2Shape* otherShape = b2Array_Get( world->shapes,shapeId );
+
 	// Check filter
 	if ( b2ShouldShapesCollide( sensorShape->filter, otherShape->filter ) == false )
 	{
@@ -93,16 +97,26 @@ static bool b2SensorQueryCallback( int proxyId, uint64_t userData, void* context
 		}
 	}
 
-	b2Transform otherTransform = b2GetBodyTransform( world, otherShape->bodyId );
+	b2Transform otherTransform = b2GetBodyTransform( world, otherShapeSim->bodyId );
 
-	b2DistanceInput input;
-	input.proxyA = b2MakeShapeDistanceProxy( sensorShape );
-	input.proxyB = b2MakeShapeDistanceProxy( otherShape );
-	input.transformA = queryContext->transform;
-	input.transformB = otherTransform;
-	input.useRadii = true;
-	b2SimplexCache cache = { 0 };
-	b2DistanceOutput output = b2ShapeDistance( &input, &cache, NULL, 0 );
+	b2DistanceOutput output;
+	if ( b2IsSegmentCollection( otherShapeSim ) )
+	{
+		// Sensors are never meshes or heightfields, so distance is measured from the other shape to the sensor
+		b2ShapeProxy sensorProxy = b2MakeShapeDistanceProxy( sensorShapeSim );
+		output = b2ComputeShapeProxyDistance( otherShapeSim, otherTransform, &sensorProxy, queryContext->transform, 0.0f );
+	}
+	else
+	{
+		b2DistanceInput input;
+		input.proxyA = b2MakeShapeDistanceProxy( sensorShapeSim );
+		input.proxyB = b2MakeShapeDistanceProxy( otherShapeSim );
+		input.transformA = queryContext->transform;
+		input.transformB = otherTransform;
+		input.useRadii = true;
+		b2SimplexCache cache = { 0 };
+		output = b2ShapeDistance( &input, &cache, NULL, 0 );
+	}
 
 	bool overlaps = output.distance < 10.0f * FLT_EPSILON;
 	if ( overlaps == false )
@@ -146,6 +160,7 @@ static void b2SensorTask( int startIndex, int endIndex, int threadIndex, void* c
 	{
 		b2Sensor* sensor = b2Array_Get( world->sensors,sensorIndex );
 		b2Shape* sensorShape = b2Array_Get( world->shapes,sensor->shapeId );
+		b2ShapeSim* sensorShapeSim = b2Array_Get( world->shapeSims, sensor->shapeId );
 
 		// Swap overlap arrays
 		b2Array( b2Visitor ) temp = sensor->overlaps1;
@@ -163,8 +178,8 @@ static void b2SensorTask( int startIndex, int endIndex, int threadIndex, void* c
 		// Clear the hits
 		b2Array_Clear( sensor->hits );
 
-		b2Body* body = b2Array_Get( world->bodies,sensorShape->bodyId );
-		if ( body->setIndex == b2_disabledSet || sensorShape->enableSensorEvents == false )
+		b2Body* body = b2Array_Get( world->bodies,sensorShapeSim->bodyId );
+		if ( body->setIndex == b2_disabledSet || sensorShapeSim->enableSensorEvents == false )
 		{
 			if ( sensor->overlaps1.count != 0 )
 			{
@@ -181,6 +196,7 @@ static void b2SensorTask( int startIndex, int endIndex, int threadIndex, void* c
 			.taskContext = taskContext,
 			.sensor = sensor,
 			.sensorShape = sensorShape,
+			.sensorShapeSim = sensorShapeSim,
 			.transform = transform,
 		};
 
@@ -255,7 +271,7 @@ void b2OverlapSensors( b2World* world )
 
 	// Parallel-for sensors overlaps
 	int minRange = 16;
-	b2ParallelFor( world, &b2SensorTask, sensorCount, minRange, world );
+	b2ParallelFor( world, b2_timelineSensors, &b2SensorTask, sensorCount, minRange, world );
 
 	b2TracyCZoneNC( sensor_state, "Events", b2_colorLightSlateGray, true );
 
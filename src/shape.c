@@ -8,6 +8,8 @@
 #include "body.h"
 #include "broad_phase.h"
 #include "contact.h"
+#include "height_field.h"
+#include "mesh.h"
 #include "physics_world.h"
 #include "sensor.h"
 
@@ -17,6 +19,10 @@
 
 #include <stddef.h>
 
+// The hot shape data is streamed by the narrow phase and the sensor pass. Keep it well below the 296 bytes
+// of the full shape before the hot/cold split.
+_Static_assert( sizeof( b2ShapeSim ) <= 128, "b2ShapeSim is too large, move data to b2Shape" );
+
 static b2Shape* b2GetShape( b2World* world, b2ShapeId shapeId )
 {
 	int id = shapeId.index1 - 1;
@@ -25,6 +31,118 @@ static b2Shape* b2GetShape( b2World* world, b2ShapeId shapeId )
 	return shape;
 }
 
+static b2ShapeSim* b2GetShapeSim( b2World* world, b2ShapeId shapeId )
+{
+	int id = shapeId.index1 - 1;
+	B2_ASSERT( b2Array_Get( world->shapes, id )->generation == shapeId.generation );
+	return b2Array_Get( world->shapeSims, id );
+}
+
+// Local bounds of a mesh or heightfield
+static b2AABB b2GetSegmentCollectionBounds( const b2ShapeSim* shape )
+{
+	if ( shape->type == b2_meshShape )
+	{
+		return b2GetMeshBounds( shape->mesh );
+	}
+
+	B2_ASSERT( shape->type == b2_heightFieldShape );
+	return b2GetHeightFieldBounds( shape->heightField );
+}
+
+static b2Geometry* b2GetGeometry( b2World* world, b2GeometryId geometryId )
+{
+	B2_ASSERT( geometryId.world0 == world->worldId );
+	int id = geometryId.index1 - 1;
+	b2Geometry* geometry = b2Array_Get( world->geometries, id );
+	B2_ASSERT( geometry->id == id && geometry->generation == geometryId.generation );
+	B2_ASSERT( geometry->userReference );
+	return geometry;
+}
+
+void b2LinkShapePolygons( b2World* world )
+{
+	const b2Shape* shapes = world->shapes.data;
+	b2ShapeSim* shapeSims = world->shapeSims.data;
+	int shapeCount = world->shapes.count;
+	for ( int i = 0; i < shapeCount; ++i )
+	{
+		b2ShapeSim* shapeSim = shapeSims + i;
+		if ( shapes[i].id != B2_NULL_INDEX && shapeSim->type == b2_polygonShape && shapeSim->geometryId != B2_NULL_INDEX )
+		{
+			shapeSim->polygon = b2Array_Get( world->polygons, shapeSim->geometryId );
+		}
+	}
+}
+
+// The geometry starts with no references
+static b2Geometry* b2CreateGeometryInternal( b2World* world, const b2Polygon* polygon )
+{
+	// The polygon may be in the array that is about to grow
+	b2Polygon copy = *polygon;
+
+	int geometryId = b2AllocId( &world->geometryIdPool );
+
+	if ( geometryId == world->geometries.count )
+	{
+		int capacity = world->polygons.capacity;
+		b2Array_Push( world->geometries, (b2Geometry){ 0 } );
+		b2Array_Push( world->polygons, copy );
+
+		// The array grows by doubling so this is rare
+		if ( world->polygons.capacity != capacity )
+		{
+			b2LinkShapePolygons( world );
+		}
+	}
+	else
+	{
+		B2_ASSERT( world->geometries.data[geometryId].id == B2_NULL_INDEX );
+		world->polygons.data[geometryId] = copy;
+	}
+
+	b2Geometry* geometry = b2Array_Get( world->geometries, geometryId );
+	geometry->id = geometryId;
+	geometry->refCount = 0;
+	geometry->generation += 1;
+	geometry->userReference = false;
+	return geometry;
+}
+
+static void b2ReleaseGeometry( b2World* world, int geometryId )
+{
+	b2Geometry* geometry = b2Array_Get( world->geometries, geometryId );
+	B2_ASSERT( geometry->id == geometryId && geometry->refCount > 0 );
+
+	geometry->refCount -= 1;
+	if ( geometry->refCount > 0 )
+	{
+		return;
+	}
+
+	geometry->id = B2_NULL_INDEX;
+	b2FreeId( &world->geometryIdPool, geometryId );
+}
+
+// Reference the shared geometry from the definition or give the shape a private geometry. Either way
+// the polygon lives in the dense polygon array and the shape sim only holds a pointer to it.
+static void b2AttachPolygon( b2World* world, b2ShapeSim* shape, b2GeometryId geometryId, const b2Polygon* polygon )
+{
+	b2Geometry* geometry;
+	if ( B2_IS_NULL( geometryId ) )
+	{
+		geometry = b2CreateGeometryInternal( world, polygon );
+	}
+	else
+	{
+		geometry = b2GetGeometry( world, geometryId );
+	}
+
+	geometry->refCount += 1;
+	shape->polygon = world->polygons.data + geometry->id;
+	shape->geometryId = geometry->id;
+}
+
 static b2ChainShape* b2GetChainShape( b2World* world, b2ChainId chainId )
 {
 	int id = chainId.index1 - 1;
@@ -33,7 +151,7 @@ static b2ChainShape* b2GetChainShape( b2World* world, b2ChainId chainId )
 	return chain;
 }
 
-static float b2ComputeShapeMargin( b2Shape* shape )
+static float b2ComputeShapeMargin( const b2ShapeSim* shape )
 {
 	float margin = 0.0f;
 
@@ -53,7 +171,7 @@ static float b2ComputeShapeMargin( b2Shape* shape )
 
 		case b2_polygonShape:
 		{
-			const b2Polygon* poly = &shape->polygon;
+			const b2Polygon* poly = b2GetShapePolygon( shape );
 			float maxExtentSqr = 0.0f;
 			int count = poly->count;
 			for ( int i = 0; i < count; ++i )
@@ -78,6 +196,14 @@ static float b2ComputeShapeMargin( b2Shape* shape )
 		}
 		break;
 
+		case b2_meshShape:
+		case b2_heightFieldShape:
+		{
+			b2AABB bounds = b2GetSegmentCollectionBounds( shape );
+			margin = 0.5f * b2Distance( bounds.lowerBound, bounds.upperBound );
+		}
+		break;
+
 		default:
 			B2_VALIDATE( false );
 			return B2_MAX_AABB_MARGIN;
@@ -86,13 +212,20 @@ static float b2ComputeShapeMargin( b2Shape* shape )
 	return b2MinFloat( B2_MAX_AABB_MARGIN, B2_AABB_MARGIN_FRACTION * margin );
 }
 
-static void b2UpdateShapeAABBs( b2Shape* shape, b2Transform transform, b2BodyType proxyType )
-	{
+// Refresh the values derived from the geometry
+static void b2UpdateShapeGeometry( b2Shape* shape, b2ShapeSim* shapeSim )
+{
+	shapeSim->radius = b2GetShapeRadius( shapeSim );
+	shape->aabbMargin = b2ComputeShapeMargin( shapeSim );
+}
+
+static void b2UpdateShapeAABBs( b2Shape* shape, b2ShapeSim* shapeSim, b2Transform transform, b2BodyType proxyType )
+{
 	// Compute a bounding box with a speculative margin
 	const float speculativeDistance = B2_SPECULATIVE_DISTANCE;
 	const float aabbMargin = shape->aabbMargin;
 
-	b2AABB aabb = b2ComputeShapeAABB( shape, transform );
+	b2AABB aabb = b2ComputeShapeAABB( shapeSim, transform );
 	aabb.lowerBound.x -= speculativeDistance;
 	aabb.lowerBound.y -= speculativeDistance;
 	aabb.upperBound.x += speculativeDistance;
@@ -106,7 +239,7 @@ static void b2UpdateShapeAABBs( b2Shape* shape, b2Transform transform, b2BodyTyp
 	fatAABB.lowerBound.y = aabb.lowerBound.y - margin;
 	fatAABB.upperBound.x = aabb.upperBound.x + margin;
 	fatAABB.upperBound.y = aabb.upperBound.y + margin;
-	shape->fatAABB = fatAABB;
+	shapeSim->fatAABB = fatAABB;
 }
 
 static b2Shape* b2CreateShapeInternal( b2World* world, b2Body* body, b2Transform transform, const b2ShapeDef* def,
@@ -117,6 +250,7 @@ static b2Shape* b2CreateShapeInternal( b2World* world, b2Body* body, b2Transform
 	if ( shapeId == world->shapes.count )
 	{
 		b2Array_Push( world->shapes,(b2Shape){ 0 } );
+		b2Array_Push( world->shapeSims, (b2ShapeSim){ 0 } );
 	}
 	else
 	{
@@ -124,27 +258,39 @@ static b2Shape* b2CreateShapeInternal( b2World* world, b2Body* body, b2Transform
 	}
 
 	b2Shape* shape = b2Array_Get( world->shapes,shapeId );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
+	shapeSim->geometryId = B2_NULL_INDEX;
 
 	switch ( shapeType )
 	{
 		case b2_capsuleShape:
-			shape->capsule = *(const b2Capsule*)geometry;
+			shapeSim->capsule = *(const b2Capsule*)geometry;
 			break;
 
 		case b2_circleShape:
-			shape->circle = *(const b2Circle*)geometry;
+			shapeSim->circle = *(const b2Circle*)geometry;
 			break;
 
 		case b2_polygonShape:
-			shape->polygon = *(const b2Polygon*)geometry;
+			b2AttachPolygon( world, shapeSim, def->geometry, (const b2Polygon*)geometry );
 			break;
 
 		case b2_segmentShape:
-			shape->segment = *(const b2Segment*)geometry;
+			shapeSim->segment = *(const b2Segment*)geometry;
 			break;
 
 		case b2_chainSegmentShape:
-			shape->chainSegment = *(const b2ChainSegment*)geometry;
+			shapeSim->chainSegment = *(const b2ChainSegment*)geometry;
+			break;
+
+		case b2_meshShape:
+			// The shape takes ownership of the mesh data
+			shapeSim->mesh = (b2MeshShape*)geometry;
+			break;
+
+		case b2_heightFieldShape:
+			// The shape takes ownership of the heightfield data
+			shapeSim->heightField = (b2HeightFieldShape*)geometry;
 			break;
 
 		default:
@@ -152,30 +298,31 @@ static b2Shape* b2CreateShapeInternal( b2World* world, b2Body* body, b2Transform
 			break;
 	}
 
+	shapeSim->bodyId = body->id;
+	shapeSim->type = shapeType;
+	shapeSim->material = def->material;
+	shapeSim->enableSensorEvents = def->enableSensorEvents;
+	shapeSim->enableHitEvents = def->enableHitEvents;
+	shapeSim->fatAABB = (b2AABB){ b2Vec2_zero, b2Vec2_zero };
+
 	shape->id = shapeId;
-	shape->bodyId = body->id;
-	shape->type = shapeType;
 	shape->density = def->density;
-	shape->material = def->material;
 	shape->filter = def->filter;
 	shape->userData = def->userData;
 	shape->enlargedAABB = false;
-	shape->enableSensorEvents = def->enableSensorEvents;
 	shape->enableContactEvents = def->enableContactEvents;
 	shape->enableCustomFiltering = def->enableCustomFiltering;
-	shape->enableHitEvents = def->enableHitEvents;
 	shape->enablePreSolveEvents = def->enablePreSolveEvents;
 	shape->proxyKey = B2_NULL_INDEX;
-	shape->localCentroid = b2GetShapeCentroid( shape );
-	shape->aabbMargin = b2ComputeShapeMargin( shape );
+	shape->localCentroid = b2GetShapeCentroid( shapeSim );
 	shape->aabb = (b2AABB){ b2Vec2_zero, b2Vec2_zero };
-	shape->fatAABB = (b2AABB){ b2Vec2_zero, b2Vec2_zero };
 	shape->generation += 1;
+	b2UpdateShapeGeometry( shape, shapeSim );
 
 	if ( body->setIndex != b2_disabledSet )
 	{
 		b2BodyType proxyType = body->type;
-		b2CreateShapeProxy( shape, &world->broadPhase, proxyType, transform, def->invokeContactCreation || def->isSensor );
+		b2CreateShapeProxy( world, shape, proxyType, transform, def->invokeContactCreation || def->isSensor );
 	}
 
 	// Add to shape doubly linked list
@@ -274,16 +421,69 @@ b2ShapeId b2CreateCapsuleShape( b2BodyId bodyId, const b2ShapeDef* def, const b2
 
 b2ShapeId b2CreatePolygonShape( b2BodyId bodyId, const b2ShapeDef* def, const b2Polygon* polygon )
 {
+	b2World* world = b2GetWorld( bodyId.world0 );
+
+	if ( B2_IS_NON_NULL( def->geometry ) )
+	{
+		// Shared geometry replaces the polygon argument. This is also what gets recorded.
+		polygon = b2Array_Get( world->polygons, b2GetGeometry( world, def->geometry )->id );
+	}
+
 	B2_ASSERT( b2IsValidFloat( polygon->radius ) && polygon->radius >= 0.0f );
 
 	b2ShapeId id = b2CreateShape( bodyId, def, polygon, b2_polygonShape );
 
-	b2World* world = b2GetWorld( bodyId.world0 );
 	B2_REC_CREATE( world, CreatePolygonShape, id, bodyId, *def, *polygon );
 
 	return id;
 }
 
+b2GeometryId b2CreateGeometry( b2WorldId worldId, const b2Polygon* polygon )
+{
+	B2_ASSERT( b2IsValidFloat( polygon->radius ) && polygon->radius >= 0.0f );
+
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return b2_nullGeometryId;
+	}
+
+	b2Geometry* geometry = b2CreateGeometryInternal( world, polygon );
+	geometry->userReference = true;
+	geometry->refCount = 1;
+
+	b2GeometryId id = { geometry->id + 1, world->worldId, geometry->generation };
+
+	B2_REC_CREATE( world, CreateGeometry, id, worldId, *polygon );
+
+	return id;
+}
+
+void b2DestroyGeometry( b2GeometryId geometryId )
+{
+	b2World* world = b2GetWorldLocked( geometryId.world0 );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	B2_REC( world, DestroyGeometry, geometryId );
+
+	b2Geometry* geometry = b2GetGeometry( world, geometryId );
+	geometry->userReference = false;
+	b2ReleaseGeometry( world, geometry->id );
+}
+
+int b2Geometry_GetShapeCount( b2GeometryId geometryId )
+{
+	b2World* world = b2GetWorld( geometryId.world0 );
+	b2Geometry* geometry = b2GetGeometry( world, geometryId );
+
+	// Exclude the user reference
+	return geometry->refCount - 1;
+}
+
 b2ShapeId b2CreateSegmentShape( b2BodyId bodyId, const b2ShapeDef* def, const b2Segment* segment )
 {
 	float lengthSqr = b2DistanceSquared( segment->point1, segment->point2 );
@@ -322,6 +522,104 @@ b2ShapeId b2CreateChainSegmentShape( b2BodyId bodyId, const b2ShapeDef* def, con
 	return id;
 }
 
+b2ShapeId b2CreateMeshShape( b2BodyId bodyId, const b2ShapeDef* def, const b2Mesh* mesh )
+{
+	if ( mesh->count <= 0 )
+	{
+		B2_ASSERT( false );
+		return b2_nullShapeId;
+	}
+
+	// Mesh segments are one-sided and have no interior, so they cannot detect sensor overlaps
+	B2_ASSERT( def->isSensor == false );
+	if ( def->isSensor )
+	{
+		return b2_nullShapeId;
+	}
+
+	// Building the hierarchy reorders the segments
+	b2MeshShape* meshData = b2CreateMeshShapeData( mesh );
+
+	b2ShapeId id = b2CreateShape( bodyId, def, meshData, b2_meshShape );
+	if ( B2_IS_NULL( id ) )
+	{
+		b2DestroyMeshShapeData( meshData );
+		return id;
+	}
+
+	b2World* world = b2GetWorld( bodyId.world0 );
+	B2_REC_CREATE( world, CreateMeshShape, id, bodyId, *def, *mesh );
+
+	return id;
+}
+
+b2ShapeId b2CreateHeightFieldShape( b2BodyId bodyId, const b2ShapeDef* def, const b2HeightField* heightField )
+{
+	if ( heightField->count < 2 || heightField->spacing <= 0.0f || b2IsValidFloat( heightField->spacing ) == false )
+	{
+		B2_ASSERT( false );
+		return b2_nullShapeId;
+	}
+
+	// Heightfield cells are one-sided and have no interior, so they cannot detect sensor overlaps
+	B2_ASSERT( def->isSensor == false );
+	if ( def->isSensor )
+	{
+		return b2_nullShapeId;
+	}
+
+	b2HeightFieldShape* heightFieldData = b2CreateHeightFieldShapeData( heightField );
+
+	b2ShapeId id = b2CreateShape( bodyId, def, heightFieldData, b2_heightFieldShape );
+	if ( B2_IS_NULL( id ) )
+	{
+		b2DestroyHeightFieldShapeData( heightFieldData );
+		return id;
+	}
+
+	b2World* world = b2GetWorld( bodyId.world0 );
+	B2_REC_CREATE( world, CreateHeightFieldShape, id, bodyId, *def, *heightField );
+
+	return id;
+}
+
+void b2FreeShapeData( b2World* world, b2ShapeSim* shape )
+{
+	if ( shape->type == b2_polygonShape )
+	{
+		// The polygon is NULL if a snapshot restore failed before relinking the geometry
+		if ( shape->geometryId != B2_NULL_INDEX && shape->polygon != NULL )
+		{
+			b2ReleaseGeometry( world, shape->geometryId );
+		}
+
+		shape->polygon = NULL;
+		shape->geometryId = B2_NULL_INDEX;
+	}
+	else if ( shape->type == b2_meshShape )
+	{
+		b2DestroyMeshShapeData( shape->mesh );
+		shape->mesh = NULL;
+	}
+	else if ( shape->type == b2_heightFieldShape )
+	{
+		b2DestroyHeightFieldShapeData( shape->heightField );
+		shape->heightField = NULL;
+	}
+}
+
+void b2QueryShapeSegments( const b2ShapeSim* shape, b2AABB aabb, b2MeshQueryFcn* fcn, void* context )
+{
+	if ( shape->type == b2_meshShape )
+	{
+		b2QueryMesh( shape->mesh, aabb, fcn, context );
+	}
+	else if ( shape->type == b2_heightFieldShape )
+	{
+		b2QueryHeightField( shape->heightField, aabb, fcn, context );
+	}
+}
+
 // Destroy a shape on a body. This doesn't need to be called when destroying a body.
 static void b2DestroyShapeInternal( b2World* world, b2Shape* shape, b2Body* body, bool wakeBodies )
 {
@@ -405,6 +703,8 @@ static void b2DestroyShapeInternal( b2World* world, b2Shape* shape, b2Body* body
 		}
 	}
 
+	b2FreeShapeData( world, b2Array_Get( world->shapeSims, shapeId ) );
+
 	// Return shape to free list.
 	b2FreeId( &world->shapeIdPool, shapeId );
 	shape->id = B2_NULL_INDEX;
@@ -421,9 +721,10 @@ void b2DestroyShape( b2ShapeId shapeId, bool updateBodyMass )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shape->id );
 
 	// Cannot destroy a chain segment that has a parent chain shape
-	if ( shape->type == b2_chainSegmentShape && shape->chainSegment.chainId != B2_NULL_INDEX )
+	if ( shapeSim->type == b2_chainSegmentShape && shapeSim->chainSegment.chainId != B2_NULL_INDEX )
 	{
 		B2_ASSERT( false );
 		return;
@@ -433,7 +734,7 @@ void b2DestroyShape( b2ShapeId shapeId, bool updateBodyMass )
 
 	// need to wake bodies because this might be a static body
 	bool wakeBodies = true;
-	b2Body* body = b2Array_Get( world->bodies,shape->bodyId );
+	b2Body* body = b2Array_Get( world->bodies,shapeSim->bodyId );
 	b2DestroyShapeInternal( world, shape, body, wakeBodies );
 
 	if ( updateBodyMass == true )
@@ -686,7 +987,7 @@ int b2Chain_GetSegments( b2ChainId chainId, b2ShapeId* segmentArray, int capacit
 	return count;
 }
 
-b2AABB b2ComputeShapeAABB( const b2Shape* shape, b2Transform xf )
+b2AABB b2ComputeShapeAABB( const b2ShapeSim* shape, b2Transform xf )
 {
 	switch ( shape->type )
 	{
@@ -695,11 +996,24 @@ b2AABB b2ComputeShapeAABB( const b2Shape* shape, b2Transform xf )
 		case b2_circleShape:
 			return b2ComputeCircleAABB( &shape->circle, xf );
 		case b2_polygonShape:
-			return b2ComputePolygonAABB( &shape->polygon, xf );
+			return b2ComputePolygonAABB( b2GetShapePolygon( shape ), xf );
 		case b2_segmentShape:
 			return b2ComputeSegmentAABB( &shape->segment, xf );
 		case b2_chainSegmentShape:
 			return b2ComputeSegmentAABB( &shape->chainSegment.segment, xf );
+		case b2_meshShape:
+		case b2_heightFieldShape:
+		{
+			// Bound the transformed local bounds. These are usually static and axis aligned.
+			b2AABB bounds = b2GetSegmentCollectionBounds( shape );
+			b2Vec2 center = b2TransformPoint( xf, b2AABB_Center( bounds ) );
+			b2Vec2 extents = b2AABB_Extents( bounds );
+			float c = b2AbsFloat( xf.q.c );
+			float s = b2AbsFloat( xf.q.s );
+			b2Vec2 h = { c * extents.x + s * extents.y, s * extents.x + c * extents.y };
+			b2AABB aabb = { b2Sub( center, h ), b2Add( center, h ) };
+			return aabb;
+		}
 		default:
 		{
 			B2_ASSERT( false );
@@ -709,7 +1023,7 @@ b2AABB b2ComputeShapeAABB( const b2Shape* shape, b2Transform xf )
 	}
 }
 
-b2Vec2 b2GetShapeCentroid( const b2Shape* shape )
+b2Vec2 b2GetShapeCentroid( const b2ShapeSim* shape )
 {
 	switch ( shape->type )
 	{
@@ -718,18 +1032,21 @@ b2Vec2 b2GetShapeCentroid( const b2Shape* shape )
 		case b2_circleShape:
 			return shape->circle.center;
 		case b2_polygonShape:
-			return shape->polygon.centroid;
+			return b2GetShapePolygon( shape )->centroid;
 		case b2_segmentShape:
 			return b2Lerp( shape->segment.point1, shape->segment.point2, 0.5f );
 		case b2_chainSegmentShape:
 			return b2Lerp( shape->chainSegment.segment.point1, shape->chainSegment.segment.point2, 0.5f );
+		case b2_meshShape:
+		case b2_heightFieldShape:
+			return b2AABB_Center( b2GetSegmentCollectionBounds( shape ) );
 		default:
 			return b2Vec2_zero;
 	}
 }
 
 // todo_erin maybe compute this on shape creation
-float b2GetShapePerimeter( const b2Shape* shape )
+float b2GetShapePerimeter( const b2ShapeSim* shape )
 {
 	switch ( shape->type )
 	{
@@ -740,9 +1057,10 @@ float b2GetShapePerimeter( const b2Shape* shape )
 			return 2.0f * B2_PI * shape->circle.radius;
 		case b2_polygonShape:
 		{
-			const b2Vec2* points = shape->polygon.vertices;
-			int count = shape->polygon.count;
-			float perimeter = 2.0f * B2_PI * shape->polygon.radius;
+			const b2Polygon* polygon = b2GetShapePolygon( shape );
+			const b2Vec2* points = polygon->vertices;
+			int count = polygon->count;
+			float perimeter = 2.0f * B2_PI * polygon->radius;
 			B2_ASSERT( count > 0 );
 			b2Vec2 prev = points[count - 1];
 			for ( int i = 0; i < count; ++i )
@@ -758,13 +1076,36 @@ float b2GetShapePerimeter( const b2Shape* shape )
 			return 2.0f * b2Length( b2Sub( shape->segment.point1, shape->segment.point2 ) );
 		case b2_chainSegmentShape:
 			return 2.0f * b2Length( b2Sub( shape->chainSegment.segment.point1, shape->chainSegment.segment.point2 ) );
+		case b2_meshShape:
+		{
+			const b2MeshShape* mesh = shape->mesh;
+			float perimeter = 0.0f;
+			for ( int i = 0; i < mesh->segmentCount; ++i )
+			{
+				perimeter += 2.0f * b2Length( b2Sub( mesh->segments[i].segment.point1, mesh->segments[i].segment.point2 ) );
+			}
+
+			return perimeter;
+		}
+		case b2_heightFieldShape:
+		{
+			const b2HeightFieldShape* heightField = shape->heightField;
+			float perimeter = 0.0f;
+			for ( int i = 1; i < heightField->count; ++i )
+			{
+				b2Vec2 d = { heightField->spacing, heightField->heights[i] - heightField->heights[i - 1] };
+				perimeter += 2.0f * b2Length( d );
+			}
+
+			return perimeter;
+		}
 		default:
 			return 0.0f;
 	}
 }
 
 // This projects the shape perimeter onto an infinite line
-float b2GetShapeProjectedPerimeter( const b2Shape* shape, b2Vec2 line )
+float b2GetShapeProjectedPerimeter( const b2ShapeSim* shape, b2Vec2 line )
 {
 	switch ( shape->type )
 	{
@@ -780,8 +1121,9 @@ float b2GetShapeProjectedPerimeter( const b2Shape* shape, b2Vec2 line )
 
 		case b2_polygonShape:
 		{
-			const b2Vec2* points = shape->polygon.vertices;
-			int count = shape->polygon.count;
+			const b2Polygon* polygon = b2GetShapePolygon( shape );
+			const b2Vec2* points = polygon->vertices;
+			int count = polygon->count;
 			B2_ASSERT( count > 0 );
 			float value = b2Dot( points[0], line );
 			float lower = value;
@@ -793,7 +1135,7 @@ float b2GetShapeProjectedPerimeter( const b2Shape* shape, b2Vec2 line )
 				upper = b2MaxFloat( upper, value );
 			}
 
-			return ( upper - lower ) + 2.0f * shape->polygon.radius;
+			return ( upper - lower ) + 2.0f * polygon->radius;
 		}
 
 		case b2_segmentShape:
@@ -810,27 +1152,53 @@ float b2GetShapeProjectedPerimeter( const b2Shape* shape, b2Vec2 line )
 			return b2AbsFloat( value2 - value1 );
 		}
 
+		case b2_meshShape:
+		{
+			const b2MeshShape* mesh = shape->mesh;
+			float perimeter = 0.0f;
+			for ( int i = 0; i < mesh->segmentCount; ++i )
+			{
+				float value1 = b2Dot( mesh->segments[i].segment.point1, line );
+				float value2 = b2Dot( mesh->segments[i].segment.point2, line );
+				perimeter += b2AbsFloat( value2 - value1 );
+			}
+
+			return perimeter;
+		}
+		case b2_heightFieldShape:
+		{
+			const b2HeightFieldShape* heightField = shape->heightField;
+			float perimeter = 0.0f;
+			for ( int i = 1; i < heightField->count; ++i )
+			{
+				b2Vec2 d = { heightField->spacing, heightField->heights[i] - heightField->heights[i - 1] };
+				perimeter += b2AbsFloat( b2Dot( d, line ) );
+			}
+
+			return perimeter;
+		}
+
 		default:
 			return 0.0f;
 	}
 }
 
-b2MassData b2ComputeShapeMass( const b2Shape* shape )
+b2MassData b2ComputeShapeMass( const b2ShapeSim* shape, float density )
 {
 	switch ( shape->type )
 	{
 		case b2_capsuleShape:
-			return b2ComputeCapsuleMass( &shape->capsule, shape->density );
+			return b2ComputeCapsuleMass( &shape->capsule, density );
 		case b2_circleShape:
-			return b2ComputeCircleMass( &shape->circle, shape->density );
+			return b2ComputeCircleMass( &shape->circle, density );
 		case b2_polygonShape:
-			return b2ComputePolygonMass( &shape->polygon, shape->density );
+			return b2ComputePolygonMass( b2GetShapePolygon( shape ), density );
 		default:
 			return (b2MassData){ 0 };
 	}
 }
 
-b2ShapeExtent b2ComputeShapeExtent( const b2Shape* shape, b2Vec2 localCenter )
+b2ShapeExtent b2ComputeShapeExtent( const b2ShapeSim* shape, b2Vec2 localCenter )
 {
 	b2ShapeExtent extent = { 0 };
 
@@ -856,7 +1224,7 @@ b2ShapeExtent b2ComputeShapeExtent( const b2Shape* shape, b2Vec2 localCenter )
 
 		case b2_polygonShape:
 		{
-			const b2Polygon* poly = &shape->polygon;
+			const b2Polygon* poly = b2GetShapePolygon( shape );
 			float minExtent = B2_HUGE;
 			float maxExtentSqr = 0.0f;
 			int count = poly->count;
@@ -893,6 +1261,17 @@ b2ShapeExtent b2ComputeShapeExtent( const b2Shape* shape, b2Vec2 localCenter )
 		}
 		break;
 
+		case b2_meshShape:
+		case b2_heightFieldShape:
+		{
+			extent.minExtent = 0.0f;
+			b2AABB bounds = b2GetSegmentCollectionBounds( shape );
+			b2Vec2 d1 = b2Abs( b2Sub( bounds.lowerBound, localCenter ) );
+			b2Vec2 d2 = b2Abs( b2Sub( bounds.upperBound, localCenter ) );
+			extent.maxExtent = b2Length( b2Max( d1, d2 ) );
+		}
+		break;
+
 		default:
 			break;
 	}
@@ -900,7 +1279,7 @@ b2ShapeExtent b2ComputeShapeExtent( const b2Shape* shape, b2Vec2 localCenter )
 	return extent;
 }
 
-b2CastOutput b2RayCastShape( const b2RayCastInput* input, const b2Shape* shape, b2Transform transform )
+b2CastOutput b2RayCastShape( const b2RayCastInput* input, const b2ShapeSim* shape, b2Transform transform )
 {
 	b2RayCastInput localInput = *input;
 	localInput.origin = b2InvTransformPoint( transform, input->origin );
@@ -916,7 +1295,7 @@ b2CastOutput b2RayCastShape( const b2RayCastInput* input, const b2Shape* shape,
 			output = b2RayCastCircle( &shape->circle, &localInput );
 			break;
 		case b2_polygonShape:
-			output = b2RayCastPolygon( &shape->polygon, &localInput );
+			output = b2RayCastPolygon( b2GetShapePolygon( shape ), &localInput );
 			break;
 		case b2_segmentShape:
 			output = b2RayCastSegment( &shape->segment, &localInput, false );
@@ -924,6 +1303,12 @@ b2CastOutput b2RayCastShape( const b2RayCastInput* input, const b2Shape* shape,
 		case b2_chainSegmentShape:
 			output = b2RayCastSegment( &shape->chainSegment.segment, &localInput, true );
 			break;
+		case b2_meshShape:
+			output = b2RayCastMesh( shape->mesh, &localInput );
+			break;
+		case b2_heightFieldShape:
+			output = b2RayCastHeightField( shape->heightField, &localInput );
+			break;
 		default:
 			return output;
 	}
@@ -933,7 +1318,7 @@ b2CastOutput b2RayCastShape( const b2RayCastInput* input, const b2Shape* shape,
 	return output;
 }
 
-b2CastOutput b2ShapeCastShape( const b2ShapeCastInput* input, const b2Shape* shape, b2Transform transform )
+b2CastOutput b2ShapeCastShape( const b2ShapeCastInput* input, const b2ShapeSim* shape, b2Transform transform )
 {
 	b2CastOutput output = { 0 };
 
@@ -960,7 +1345,7 @@ b2CastOutput b2ShapeCastShape( const b2ShapeCastInput* input, const b2Shape* sha
 			output = b2ShapeCastCircle( &shape->circle, &localInput );
 			break;
 		case b2_polygonShape:
-			output = b2ShapeCastPolygon( &shape->polygon, &localInput );
+			output = b2ShapeCastPolygon( b2GetShapePolygon( shape ), &localInput );
 			break;
 		case b2_segmentShape:
 			output = b2ShapeCastSegment( &shape->segment, &localInput );
@@ -988,6 +1373,12 @@ b2CastOutput b2ShapeCastShape( const b2ShapeCastInput* input, const b2Shape* sha
 			output = b2ShapeCastSegment( &shape->chainSegment.segment, &localInput );
 		}
 		break;
+		case b2_meshShape:
+			output = b2ShapeCastMesh( shape->mesh, &localInput );
+			break;
+		case b2_heightFieldShape:
+			output = b2ShapeCastHeightField( shape->heightField, &localInput );
+			break;
 		default:
 			return output;
 	}
@@ -997,7 +1388,7 @@ b2CastOutput b2ShapeCastShape( const b2ShapeCastInput* input, const b2Shape* sha
 	return output;
 }
 
-b2PlaneResult b2CollideMover( const b2Capsule* mover, const b2Shape* shape, b2Transform transform )
+b2PlaneResult b2CollideMover( const b2Capsule* mover, const b2ShapeSim* shape, b2Transform transform )
 {
 	b2Capsule localMover;
 	localMover.center1 = b2InvTransformPoint( transform, mover->center1 );
@@ -1014,7 +1405,7 @@ b2PlaneResult b2CollideMover( const b2Capsule* mover, const b2Shape* shape, b2Tr
 			result = b2CollideMoverAndCircle( &localMover, &shape->circle );
 			break;
 		case b2_polygonShape:
-			result = b2CollideMoverAndPolygon( &localMover, &shape->polygon );
+			result = b2CollideMoverAndPolygon( &localMover, b2GetShapePolygon( shape ) );
 			break;
 		case b2_segmentShape:
 			result = b2CollideMoverAndSegment( &localMover, &shape->segment );
@@ -1035,15 +1426,16 @@ b2PlaneResult b2CollideMover( const b2Capsule* mover, const b2Shape* shape, b2Tr
 	return result;
 }
 
-void b2CreateShapeProxy( b2Shape* shape, b2BroadPhase* bp, b2BodyType type, b2Transform transform, bool forcePairCreation )
+void b2CreateShapeProxy( b2World* world, b2Shape* shape, b2BodyType type, b2Transform transform, bool forcePairCreation )
 {
 	B2_ASSERT( shape->proxyKey == B2_NULL_INDEX );
 
-	b2UpdateShapeAABBs( shape, transform, type );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shape->id );
+	b2UpdateShapeAABBs( shape, shapeSim, transform, type );
 
 	// Create proxies in the broad-phase.
 	shape->proxyKey =
-		b2BroadPhase_CreateProxy( bp, type, shape->fatAABB, shape->filter.categoryBits, shape->id, forcePairCreation );
+		b2BroadPhase_CreateProxy( &world->broadPhase, type, shapeSim->fatAABB, shape->filter.categoryBits, shape->id, forcePairCreation );
 	B2_ASSERT( B2_PROXY_TYPE( shape->proxyKey ) < b2_bodyTypeCount );
 }
 
@@ -1056,7 +1448,7 @@ void b2DestroyShapeProxy( b2Shape* shape, b2BroadPhase* bp )
 	}
 }
 
-b2ShapeProxy b2MakeShapeDistanceProxy( const b2Shape* shape )
+b2ShapeProxy b2MakeShapeDistanceProxy( const b2ShapeSim* shape )
 {
 	switch ( shape->type )
 	{
@@ -1065,7 +1457,10 @@ b2ShapeProxy b2MakeShapeDistanceProxy( const b2Shape* shape )
 		case b2_circleShape:
 			return b2MakeProxy( &shape->circle.center, 1, shape->circle.radius );
 		case b2_polygonShape:
-			return b2MakeProxy( shape->polygon.vertices, shape->polygon.count, shape->polygon.radius );
+		{
+			const b2Polygon* polygon = b2GetShapePolygon( shape );
+			return b2MakeProxy( polygon->vertices, polygon->count, polygon->radius );
+		}
 		case b2_segmentShape:
 			return b2MakeProxy( &shape->segment.point1, 2, 0.0f );
 		case b2_chainSegmentShape:
@@ -1079,10 +1474,73 @@ b2ShapeProxy b2MakeShapeDistanceProxy( const b2Shape* shape )
 	}
 }
 
+typedef struct b2MeshDistanceContext
+{
+	b2DistanceInput input;
+	b2DistanceOutput output;
+} b2MeshDistanceContext;
+
+static bool b2MeshDistanceCallback( const b2ChainSegment* segment, int segmentIndex, void* context )
+{
+	B2_UNUSED( segmentIndex );
+
+	b2MeshDistanceContext* meshContext = context;
+	meshContext->input.proxyA = b2MakeProxy( &segment->segment.point1, 2, 0.0f );
+
+	b2SimplexCache cache = { 0 };
+	b2DistanceOutput output = b2ShapeDistance( &meshContext->input, &cache, NULL, 0 );
+	if ( output.distance < meshContext->output.distance )
+	{
+		meshContext->output = output;
+	}
+
+	// Stop at the first overlap
+	return output.distance > 0.0f;
+}
+
+b2DistanceOutput b2ComputeShapeProxyDistance( const b2ShapeSim* shape, b2Transform transform, const b2ShapeProxy* proxy,
+											  b2Transform proxyTransform, float maxDistance )
+{
+	b2DistanceInput input;
+	input.proxyB = *proxy;
+	input.transformA = transform;
+	input.transformB = proxyTransform;
+	input.useRadii = true;
+
+	if ( b2IsSegmentCollection( shape ) == false )
+	{
+		input.proxyA = b2MakeShapeDistanceProxy( shape );
+		b2SimplexCache cache = { 0 };
+		return b2ShapeDistance( &input, &cache, NULL, 0 );
+	}
+
+	// Bound the proxy in the shape frame
+	b2Transform relativeTransform = b2InvMulTransforms( transform, proxyTransform );
+	b2Vec2 p = b2TransformPoint( relativeTransform, proxy->points[0] );
+	b2AABB box = { p, p };
+	for ( int i = 1; i < proxy->count; ++i )
+	{
+		p = b2TransformPoint( relativeTransform, proxy->points[i] );
+		box.lowerBound = b2Min( box.lowerBound, p );
+		box.upperBound = b2Max( box.upperBound, p );
+	}
+
+	float extension = proxy->radius + maxDistance;
+	box.lowerBound = b2Sub( box.lowerBound, (b2Vec2){ extension, extension } );
+	box.upperBound = b2Add( box.upperBound, (b2Vec2){ extension, extension } );
+
+	b2MeshDistanceContext context = { 0 };
+	context.input = input;
+	context.output.distance = B2_HUGE;
+
+	b2QueryShapeSegments( shape, box, b2MeshDistanceCallback, &context );
+	return context.output;
+}
+
 b2BodyId b2Shape_GetBody( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	return b2MakeBodyId( world, shape->bodyId );
 }
 
@@ -1116,7 +1574,7 @@ bool b2Shape_IsSensor( b2ShapeId shapeId )
 bool b2Shape_TestPoint( b2ShapeId shapeId, b2Vec2 point )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 
 	b2Transform transform = b2GetBodyTransform( world, shape->bodyId );
 	b2Vec2 localPoint = b2InvTransformPoint( transform, point );
@@ -1133,7 +1591,7 @@ bool b2Shape_TestPoint( b2ShapeId shapeId, b2Vec2 point )
 			break;
 
 		case b2_polygonShape:
-			result = b2PointInPolygon( &shape->polygon, localPoint );
+			result = b2PointInPolygon( b2GetShapePolygon( shape ), localPoint );
 			break;
 
 		default:
@@ -1158,7 +1616,7 @@ bool b2Shape_TestPoint( b2ShapeId shapeId, b2Vec2 point )
 b2CastOutput b2Shape_RayCast( b2ShapeId shapeId, const b2RayCastInput* input )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 
 	b2Transform transform = b2GetBodyTransform( world, shape->bodyId );
 
@@ -1184,13 +1642,21 @@ b2CastOutput b2Shape_RayCast( b2ShapeId shapeId, const b2RayCastInput* input )
 			break;
 
 		case b2_polygonShape:
-			output = b2RayCastPolygon( &shape->polygon, &localInput );
+			output = b2RayCastPolygon( b2GetShapePolygon( shape ), &localInput );
 			break;
 
 		case b2_chainSegmentShape:
 			output = b2RayCastSegment( &shape->chainSegment.segment, &localInput, true );
 			break;
 
+		case b2_meshShape:
+			output = b2RayCastMesh( shape->mesh, &localInput );
+			break;
+
+		case b2_heightFieldShape:
+			output = b2RayCastHeightField( shape->heightField, &localInput );
+			break;
+
 		default:
 			B2_ASSERT( false );
 			break;
@@ -1239,7 +1705,7 @@ void b2Shape_SetDensity( b2ShapeId shapeId, float density, bool updateBodyMass )
 
 	if ( updateBodyMass == true )
 	{
-		b2Body* body = b2Array_Get( world->bodies,shape->bodyId );
+		b2Body* body = b2Array_Get( world->bodies,b2GetShapeSim( world, shapeId )->bodyId );
 		b2UpdateBodyMassData( world, body );
 	}
 }
@@ -1264,14 +1730,14 @@ void b2Shape_SetFriction( b2ShapeId shapeId, float friction )
 
 	B2_REC( world, ShapeSetFriction, shapeId, friction );
 
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	shape->material.friction = friction;
 }
 
 float b2Shape_GetFriction( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	return shape->material.friction;
 }
 
@@ -1288,14 +1754,14 @@ void b2Shape_SetRestitution( b2ShapeId shapeId, float restitution )
 
 	B2_REC( world, ShapeSetRestitution, shapeId, restitution );
 
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	shape->material.restitution = restitution;
 }
 
 float b2Shape_GetRestitution( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	return shape->material.restitution;
 }
 
@@ -1310,21 +1776,21 @@ void b2Shape_SetUserMaterial( b2ShapeId shapeId, uint64_t material )
 
 	B2_REC( world, ShapeSetUserMaterial, shapeId, material );
 
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	shape->material.userMaterialId = material;
 }
 
 uint64_t b2Shape_GetUserMaterial( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	return shape->material.userMaterialId;
 }
 
 b2SurfaceMaterial b2Shape_GetSurfaceMaterial( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	return shape->material;
 }
 
@@ -1332,7 +1798,7 @@ void b2Shape_SetSurfaceMaterial( b2ShapeId shapeId, const b2SurfaceMaterial* sur
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
 	B2_REC( world, ShapeSetSurfaceMaterial, shapeId, *surfaceMaterial );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	shape->material = *surfaceMaterial;
 }
 
@@ -1345,9 +1811,9 @@ b2Filter b2Shape_GetFilter( b2ShapeId shapeId )
 
 static void b2ResetProxy( b2World* world, b2Shape* shape, bool wakeBodies, bool destroyProxy )
 {
-	b2Body* body = b2Array_Get( world->bodies,shape->bodyId );
-
 	int shapeId = shape->id;
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
+	b2Body* body = b2Array_Get( world->bodies,shapeSim->bodyId );
 
 	// destroy all contacts associated with this shape
 	int contactKey = body->headContactKey;
@@ -1369,25 +1835,25 @@ static void b2ResetProxy( b2World* world, b2Shape* shape, bool wakeBodies, bool
 	if ( shape->proxyKey != B2_NULL_INDEX )
 	{
 		b2BodyType proxyType = B2_PROXY_TYPE( shape->proxyKey );
-		b2UpdateShapeAABBs( shape, transform, proxyType );
+		b2UpdateShapeAABBs( shape, shapeSim, transform, proxyType );
 
 		if ( destroyProxy )
 		{
 			b2BroadPhase_DestroyProxy( &world->broadPhase, shape->proxyKey );
 
 			bool forcePairCreation = true;
-			shape->proxyKey = b2BroadPhase_CreateProxy( &world->broadPhase, proxyType, shape->fatAABB, shape->filter.categoryBits,
+			shape->proxyKey = b2BroadPhase_CreateProxy( &world->broadPhase, proxyType, shapeSim->fatAABB, shape->filter.categoryBits,
 														shapeId, forcePairCreation );
 		}
 		else
 		{
-			b2BroadPhase_MoveProxy( &world->broadPhase, shape->proxyKey, shape->fatAABB );
+			b2BroadPhase_MoveProxy( &world->broadPhase, shape->proxyKey, shapeSim->fatAABB );
 		}
 	}
 	else
 	{
 		b2BodyType proxyType = body->type;
-		b2UpdateShapeAABBs( shape, transform, proxyType );
+		b2UpdateShapeAABBs( shape, shapeSim, transform, proxyType );
 	}
 
 	b2ValidateSolverSets( world );
@@ -1433,14 +1899,14 @@ void b2Shape_EnableSensorEvents( b2ShapeId shapeId, bool flag )
 
 	B2_REC( world, ShapeEnableSensorEvents, shapeId, flag );
 
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	shape->enableSensorEvents = flag;
 }
 
 bool b2Shape_AreSensorEventsEnabled( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	return shape->enableSensorEvents;
 }
 
@@ -1496,28 +1962,28 @@ void b2Shape_EnableHitEvents( b2ShapeId shapeId, bool flag )
 
 	B2_REC( world, ShapeEnableHitEvents, shapeId, flag );
 
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	shape->enableHitEvents = flag;
 }
 
 bool b2Shape_AreHitEventsEnabled( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	return shape->enableHitEvents;
 }
 
 b2ShapeType b2Shape_GetType( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	return shape->type;
 }
 
 b2Circle b2Shape_GetCircle( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	B2_ASSERT( shape->type == b2_circleShape );
 	return shape->circle;
 }
@@ -1525,7 +1991,7 @@ b2Circle b2Shape_GetCircle( b2ShapeId shapeId )
 b2Segment b2Shape_GetSegment( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	B2_ASSERT( shape->type == b2_segmentShape );
 	return shape->segment;
 }
@@ -1533,15 +1999,48 @@ b2Segment b2Shape_GetSegment( b2ShapeId shapeId )
 b2ChainSegment b2Shape_GetChainSegment( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	B2_ASSERT( shape->type == b2_chainSegmentShape );
 	return shape->chainSegment;
 }
 
+int b2Shape_GetMeshSegmentCount( b2ShapeId shapeId )
+{
+	b2World* world = b2GetWorld( shapeId.world0 );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
+	B2_ASSERT( shape->type == b2_meshShape );
+	return shape->mesh->segmentCount;
+}
+
+b2ChainSegment b2Shape_GetMeshSegment( b2ShapeId shapeId, int index )
+{
+	b2World* world = b2GetWorld( shapeId.world0 );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
+	B2_ASSERT( shape->type == b2_meshShape );
+	B2_ASSERT( 0 <= index && index < shape->mesh->segmentCount );
+	return shape->mesh->segments[index];
+}
+
+int b2Shape_GetHeightFieldCellCount( b2ShapeId shapeId )
+{
+	b2World* world = b2GetWorld( shapeId.world0 );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
+	B2_ASSERT( shape->type == b2_heightFieldShape );
+	return shape->heightField->count - 1;
+}
+
+b2ChainSegment b2Shape_GetHeightFieldSegment( b2ShapeId shapeId, int cellIndex )
+{
+	b2World* world = b2GetWorld( shapeId.world0 );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
+	B2_ASSERT( shape->type == b2_heightFieldShape );
+	return b2GetHeightFieldSegment( shape->heightField, cellIndex );
+}
+
 b2Capsule b2Shape_GetCapsule( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	B2_ASSERT( shape->type == b2_capsuleShape );
 	return shape->capsule;
 }
@@ -1549,9 +2048,9 @@ b2Capsule b2Shape_GetCapsule( b2ShapeId shapeId )
 b2Polygon b2Shape_GetPolygon( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	B2_ASSERT( shape->type == b2_polygonShape );
-	return shape->polygon;
+	return *b2GetShapePolygon( shape );
 }
 
 void b2Shape_SetCircle( b2ShapeId shapeId, const b2Circle* circle )
@@ -1565,9 +2064,11 @@ void b2Shape_SetCircle( b2ShapeId shapeId, const b2Circle* circle )
 	B2_REC( world, ShapeSetCircle, shapeId, *circle );
 
 	b2Shape* shape = b2GetShape( world, shapeId );
-	shape->circle = *circle;
-	shape->type = b2_circleShape;
-	shape->aabbMargin = b2ComputeShapeMargin( shape );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shape->id );
+	b2FreeShapeData( world, shapeSim );
+	shapeSim->circle = *circle;
+	shapeSim->type = b2_circleShape;
+	b2UpdateShapeGeometry( shape, shapeSim );
 
 	// need to wake bodies so they can react to the shape change
 	bool wakeBodies = true;
@@ -1592,9 +2093,11 @@ void b2Shape_SetCapsule( b2ShapeId shapeId, const b2Capsule* capsule )
 	B2_REC( world, ShapeSetCapsule, shapeId, *capsule );
 
 	b2Shape* shape = b2GetShape( world, shapeId );
-	shape->capsule = *capsule;
-	shape->type = b2_capsuleShape;
-	shape->aabbMargin = b2ComputeShapeMargin( shape );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shape->id );
+	b2FreeShapeData( world, shapeSim );
+	shapeSim->capsule = *capsule;
+	shapeSim->type = b2_capsuleShape;
+	b2UpdateShapeGeometry( shape, shapeSim );
 
 	// need to wake bodies so they can react to the shape change
 	bool wakeBodies = true;
@@ -1613,9 +2116,11 @@ void b2Shape_SetSegment( b2ShapeId shapeId, const b2Segment* segment )
 	B2_REC( world, ShapeSetSegment, shapeId, *segment );
 
 	b2Shape* shape = b2GetShape( world, shapeId );
-	shape->segment = *segment;
-	shape->type = b2_segmentShape;
-	shape->aabbMargin = b2ComputeShapeMargin( shape );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shape->id );
+	b2FreeShapeData( world, shapeSim );
+	shapeSim->segment = *segment;
+	shapeSim->type = b2_segmentShape;
+	b2UpdateShapeGeometry( shape, shapeSim );
 
 	// need to wake bodies so they can react to the shape change
 	bool wakeBodies = true;
@@ -1634,9 +2139,12 @@ void b2Shape_SetPolygon( b2ShapeId shapeId, const b2Polygon* polygon )
 	B2_REC( world, ShapeSetPolygon, shapeId, *polygon );
 
 	b2Shape* shape = b2GetShape( world, shapeId );
-	shape->polygon = *polygon;
-	shape->type = b2_polygonShape;
-	shape->aabbMargin = b2ComputeShapeMargin( shape );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shape->id );
+	// Shared geometry is immutable, so the shape gets a private copy
+	b2FreeShapeData( world, shapeSim );
+	b2AttachPolygon( world, shapeSim, b2_nullGeometryId, polygon );
+	shapeSim->type = b2_polygonShape;
+	b2UpdateShapeGeometry( shape, shapeSim );
 
 	// need to wake bodies so they can react to the shape change
 	bool wakeBodies = true;
@@ -1653,9 +2161,10 @@ void b2Shape_SetChainSegment( b2ShapeId shapeId, const b2ChainSegment* chainSegm
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shape->id );
 
 	// Cannot modify a chain segment that has a parent chain shape
-	if ( shape->type == b2_chainSegmentShape && shape->chainSegment.chainId != B2_NULL_INDEX )
+	if ( shapeSim->type == b2_chainSegmentShape && shapeSim->chainSegment.chainId != B2_NULL_INDEX )
 	{
 		B2_ASSERT( false );
 		return;
@@ -1669,10 +2178,11 @@ void b2Shape_SetChainSegment( b2ShapeId shapeId, const b2ChainSegment* chainSegm
 
 	B2_REC( world, ShapeSetChainSegment, shapeId, *chainSegment );
 
-	shape->chainSegment = *chainSegment;
-	shape->chainSegment.chainId = B2_NULL_INDEX;
-	shape->type = b2_chainSegmentShape;
-	shape->aabbMargin = b2ComputeShapeMargin( shape );
+	b2FreeShapeData( world, shapeSim );
+	shapeSim->chainSegment = *chainSegment;
+	shapeSim->chainSegment.chainId = B2_NULL_INDEX;
+	shapeSim->type = b2_chainSegmentShape;
+	b2UpdateShapeGeometry( shape, shapeSim );
 
 	bool wakeBodies = true;
 	bool destroyProxy = true;
@@ -1682,7 +2192,7 @@ void b2Shape_SetChainSegment( b2ShapeId shapeId, const b2ChainSegment* chainSegm
 b2ChainId b2Shape_GetParentChain( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	if ( shape->type == b2_chainSegmentShape )
 	{
 		int chainId = shape->chainSegment.chainId;
@@ -1726,14 +2236,14 @@ void b2Chain_SetSurfaceMaterial( b2ChainId chainId, const b2SurfaceMaterial* mat
 		for ( int i = 0; i < count; ++i )
 		{
 			int shapeId = chainShape->shapeIndices[i];
-			b2Shape* shape = b2Array_Get( world->shapes,shapeId );
+			b2ShapeSim* shape = b2Array_Get( world->shapeSims, shapeId );
 			shape->material = *material;
 		}
 	}
 	else
 	{
 		int shapeId = chainShape->shapeIndices[materialIndex];
-		b2Shape* shape = b2Array_Get( world->shapes,shapeId );
+		b2ShapeSim* shape = b2Array_Get( world->shapeSims, shapeId );
 		shape->material = *material;
 	}
 }
@@ -1760,7 +2270,7 @@ int b2Shape_GetContactCapacity( b2ShapeId shapeId )
 		return 0;
 	}
 
-	b2Body* body = b2Array_Get( world->bodies,shape->bodyId );
+	b2Body* body = b2Array_Get( world->bodies,b2GetShapeSim( world, shapeId )->bodyId );
 
 	// Conservative and fast
 	return body->contactCount;
@@ -1780,7 +2290,7 @@ int b2Shape_GetContactData( b2ShapeId shapeId, b2ContactData* contactData, int c
 		return 0;
 	}
 
-	b2Body* body = b2Array_Get( world->bodies,shape->bodyId );
+	b2Body* body = b2Array_Get( world->bodies,b2GetShapeSim( world, shapeId )->bodyId );
 	int contactKey = body->headContactKey;
 	int index = 0;
 	while ( contactKey != B2_NULL_INDEX && index < capacity )
@@ -1885,7 +2395,7 @@ b2MassData b2Shape_ComputeMassData( b2ShapeId shapeId )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
-	return b2ComputeShapeMass( shape );
+	return b2ComputeShapeMass( b2GetShapeSim( world, shapeId ), shape->density );
 }
 
 b2Vec2 b2Shape_GetClosestPoint( b2ShapeId shapeId, b2Vec2 target )
@@ -1896,19 +2406,12 @@ b2Vec2 b2Shape_GetClosestPoint( b2ShapeId shapeId, b2Vec2 target )
 		return (b2Vec2){ 0 };
 	}
 
-	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shape = b2GetShapeSim( world, shapeId );
 	b2Body* body = b2Array_Get( world->bodies,shape->bodyId );
 	b2Transform transform = b2GetBodyTransformQuick( world, body );
 
-	b2DistanceInput input;
-	input.proxyA = b2MakeShapeDistanceProxy( shape );
-	input.proxyB = b2MakeProxy( &target, 1, 0.0f );
-	input.transformA = transform;
-	input.transformB = b2Transform_identity;
-	input.useRadii = true;
-
-	b2SimplexCache cache = { 0 };
-	b2DistanceOutput output = b2ShapeDistance( &input, &cache, NULL, 0 );
+	b2ShapeProxy proxy = b2MakeProxy( &target, 1, 0.0f );
+	b2DistanceOutput output = b2ComputeShapeProxyDistance( shape, transform, &proxy, b2Transform_identity, B2_HUGE );
 
 	return output.pointA;
 }
@@ -1928,14 +2431,15 @@ void b2Shape_ApplyWind( b2ShapeId shapeId, b2Vec2 wind, float drag, float lift,
 	B2_REC( world, ShapeApplyWind, shapeId, wind, drag, lift, wake );
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shape->id );
 
-	b2ShapeType shapeType = shape->type;
+	b2ShapeType shapeType = shapeSim->type;
 	if ( shapeType != b2_circleShape && shapeType != b2_capsuleShape && shapeType != b2_polygonShape )
 	{
 		return;
 	}
 
-	b2Body* body = b2Array_Get( world->bodies,shape->bodyId );
+	b2Body* body = b2Array_Get( world->bodies,shapeSim->bodyId );
 
 	if ( body->type != b2_dynamicBody )
 	{
@@ -1969,11 +2473,11 @@ void b2Shape_ApplyWind( b2ShapeId shapeId, b2Vec2 wind, float drag, float lift,
 	b2Vec2 force = { 0 };
 	float torque = 0.0f;
 
-	switch ( shape->type )
+	switch ( shapeSim->type )
 	{
 		case b2_circleShape:
 		{
-			float radius = shape->circle.radius;
+			float radius = shapeSim->circle.radius;
 			b2Vec2 centroid = shape->localCentroid;
 			b2Vec2 lever = b2RotateVector( transform.q, b2Sub( centroid, sim->localCenter ) );
 			b2Vec2 shapeVelocity = b2Add( state->linearVelocity, b2CrossSV( state->angularVelocity, lever ) );
@@ -1995,10 +2499,10 @@ void b2Shape_ApplyWind( b2ShapeId shapeId, b2Vec2 wind, float drag, float lift,
 			float speed;
 			b2Vec2 direction = b2GetLengthAndNormalize( &speed, relativeVelocity );
 
-			b2Vec2 d = b2Sub( shape->capsule.center2, shape->capsule.center1 );
+			b2Vec2 d = b2Sub( shapeSim->capsule.center2, shapeSim->capsule.center1 );
 			d = b2RotateVector( transform.q, d );
 
-			float radius = shape->capsule.radius;
+			float radius = shapeSim->capsule.radius;
 			float projectedArea = 2.0f * radius + b2AbsFloat( b2Cross(d, direction) );
 
 			// Normal that opposes the wind
@@ -2026,8 +2530,9 @@ void b2Shape_ApplyWind( b2ShapeId shapeId, b2Vec2 wind, float drag, float lift,
 			b2Vec2 direction = b2GetLengthAndNormalize( &speed, relativeVelocity );
 
 			// polygon radius is ignored for simplicity
-			int count = shape->polygon.count;
-			b2Vec2* vertices = shape->polygon.vertices;
+			const b2Polygon* polygon = b2GetShapePolygon( shapeSim );
+			int count = polygon->count;
+			const b2Vec2* vertices = polygon->vertices;
 
 			b2Vec2 v1 = vertices[count - 1];
 			for ( int i = 0; i < count; ++i )
@@ -4,49 +4,82 @@
 #pragma once
 
 #include "container.h"
+#include "mesh.h"
 
 #include "box2d/types.h"
 
 typedef struct b2BroadPhase b2BroadPhase;
+typedef struct b2HeightFieldShape b2HeightFieldShape;
 typedef struct b2World b2World;
 
+// Shape data read by the narrow phase, the sensor pass, and queries. This is a sparse array parallel to
+// world->shapes and indexed by shape id, so those loops stream through compact data instead of the full
+// shape. Everything else lives in b2Shape. The material, event flags and chain segment stay here on
+// purpose: moving them out to get this down to one cache line did not measurably help the benchmarks and
+// adds a b2Shape lookup to the contact update and the sensor pass.
+typedef struct b2ShapeSim
+{
+	b2AABB fatAABB;
+	b2SurfaceMaterial material;
+
+	union
+	{
+		b2Capsule capsule;
+		b2Circle circle;
+		// Polygons are large so they live in world->polygons, see b2Geometry
+		const b2Polygon* polygon;
+		b2Segment segment;
+		b2ChainSegment chainSegment;
+		b2MeshShape* mesh;
+		b2HeightFieldShape* heightField;
+	};
+
+	int bodyId;
+	b2ShapeType type;
+
+	// The polygon geometry or B2_NULL_INDEX
+	int geometryId;
+
+	// Rounding radius of the geometry
+	float radius;
+
+	bool enableSensorEvents;
+	bool enableHitEvents;
+} b2ShapeSim;
+
 typedef struct b2Shape
 {
 	int id;
-	int bodyId;
 	int prevShapeId;
 	int nextShapeId;
 	int sensorIndex;
-	b2ShapeType type;
-	b2SurfaceMaterial material;
 	float density;
 	float aabbMargin;
 	b2AABB aabb;
-	b2AABB fatAABB;
 	b2Vec2 localCentroid;
 	int proxyKey;
 
 	b2Filter filter;
 	void* userData;
 
-	union
-	{
-		b2Capsule capsule;
-		b2Circle circle;
-		b2Polygon polygon;
-		b2Segment segment;
-		b2ChainSegment chainSegment;
-	};
-
 	uint16_t generation;
-	bool enableSensorEvents;
 	bool enableContactEvents;
 	bool enableCustomFiltering;
-	bool enableHitEvents;
 	bool enablePreSolveEvents;
 	bool enlargedAABB;
 } b2Shape;
 
+// Immutable polygon geometry. The polygon is stored densely in world->polygons at the geometry id. Each
+// polygon shape using it holds a reference. Geometry created by b2CreateGeometry also has a user reference
+// until b2DestroyGeometry. A polygon shape created without shared geometry gets a private geometry.
+typedef struct b2Geometry
+{
+	int id;
+	int refCount;
+	uint16_t generation;
+	bool userReference;
+} b2Geometry;
+
 typedef struct b2ChainShape
 {
 	int id;
@@ -77,30 +110,57 @@ typedef struct
 	b2Array( int ) overlaps;
 } b2SensorOverlaps;
 
-void b2CreateShapeProxy( b2Shape* shape, b2BroadPhase* bp, b2BodyType type, b2Transform transform, bool forcePairCreation );
+void b2CreateShapeProxy( b2World* world, b2Shape* shape, b2BodyType type, b2Transform transform, bool forcePairCreation );
 void b2DestroyShapeProxy( b2Shape* shape, b2BroadPhase* bp );
 
 void b2FreeChainData( b2ChainShape* chain );
 
-b2MassData b2ComputeShapeMass( const b2Shape* shape );
-b2ShapeExtent b2ComputeShapeExtent( const b2Shape* shape, b2Vec2 localCenter );
-b2AABB b2ComputeShapeAABB( const b2Shape* shape, b2Transform transform );
-b2Vec2 b2GetShapeCentroid( const b2Shape* shape );
-float b2GetShapePerimeter( const b2Shape* shape );
-float b2GetShapeProjectedPerimeter( const b2Shape* shape, b2Vec2 line );
+// Free geometry owned by the shape, such as mesh data, and release shared geometry
+void b2FreeShapeData( b2World* world, b2ShapeSim* shape );
+
+// Point the polygon shapes at world->polygons. Needed when the polygon array moves.
+void b2LinkShapePolygons( b2World* world );
+
+// Meshes and heightfields are static collections of one-sided chain segments
+static inline bool b2IsSegmentCollection( const b2ShapeSim* shape )
+{
+	return shape->type == b2_meshShape || shape->type == b2_heightFieldShape;
+}
+
+// Visit the mesh or heightfield segments that overlap an AABB in the shape frame
+void b2QueryShapeSegments( const b2ShapeSim* shape, b2AABB aabb, b2MeshQueryFcn* fcn, void* context );
+
+b2MassData b2ComputeShapeMass( const b2ShapeSim* shape, float density );
+b2ShapeExtent b2ComputeShapeExtent( const b2ShapeSim* shape, b2Vec2 localCenter );
+b2AABB b2ComputeShapeAABB( const b2ShapeSim* shape, b2Transform transform );
+b2Vec2 b2GetShapeCentroid( const b2ShapeSim* shape );
+float b2GetShapePerimeter( const b2ShapeSim* shape );
+float b2GetShapeProjectedPerimeter( const b2ShapeSim* shape, b2Vec2 line );
+
+b2ShapeProxy b2MakeShapeDistanceProxy( const b2ShapeSim* shape );
 
-b2ShapeProxy b2MakeShapeDistanceProxy( const b2Shape* shape );
+// Distance between a shape and a convex proxy. A segment collection uses its closest segment within maxDistance
+// of the proxy and reports B2_HUGE if there is none. pointA is on the shape and pointB is on the proxy.
+b2DistanceOutput b2ComputeShapeProxyDistance( const b2ShapeSim* shape, b2Transform transform, const b2ShapeProxy* proxy,
+											  b2Transform proxyTransform, float maxDistance );
 
-b2CastOutput b2RayCastShape( const b2RayCastInput* input, const b2Shape* shape, b2Transform transform );
-b2CastOutput b2ShapeCastShape( const b2ShapeCastInput* input, const b2Shape* shape, b2Transform transform );
+b2CastOutput b2RayCastShape( const b2RayCastInput* input, const b2ShapeSim* shape, b2Transform transform );
+b2CastOutput b2ShapeCastShape( const b2ShapeCastInput* input, const b2ShapeSim* shape, b2Transform transform );
 
 b2PlaneResult b2CollideMoverAndCircle( const b2Capsule* mover, const b2Circle* shape );
 b2PlaneResult b2CollideMoverAndCapsule( const b2Capsule* mover, const b2Capsule* shape );
 b2PlaneResult b2CollideMoverAndPolygon( const b2Capsule* mover, const b2Polygon* shape );
 b2PlaneResult b2CollideMoverAndSegment( const b2Capsule* mover, const b2Segment* shape );
-b2PlaneResult b2CollideMover( const b2Capsule* mover, const b2Shape* shape, b2Transform transform );
+b2PlaneResult b2CollideMover( const b2Capsule* mover, const b2ShapeSim* shape, b2Transform transform );
+
+// The polygon of a polygon shape
+static inline const b2Polygon* b2GetShapePolygon( const b2ShapeSim* shape )
+{
+	return shape->polygon;
+}
 
-static inline float b2GetShapeRadius( const b2Shape* shape )
+// Used to refresh b2ShapeSim::radius when the geometry changes
+static inline float b2GetShapeRadius( const b2ShapeSim* shape )
 {
 	switch ( shape->type )
 	{
@@ -109,7 +169,7 @@ static inline float b2GetShapeRadius( const b2Shape* shape )
 		case b2_circleShape:
 			return shape->circle.radius;
 		case b2_polygonShape:
-			return shape->polygon.radius;
+			return b2GetShapePolygon( shape )->radius;
 		default:
 			return 0.0f;
 	}
@@ -131,4 +191,7 @@ static inline bool b2ShouldQueryCollide( b2Filter shapeFilter, b2QueryFilter que
 }
 
 b2DeclareArray( b2Shape );
+b2DeclareArray( b2ShapeSim );
+b2DeclareArray( b2Geometry );
+b2DeclareArray( b2Polygon );
 b2DeclareArray( b2ChainShape );
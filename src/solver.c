@@ -13,11 +13,14 @@
 #include "ctz.h"
 #include "island.h"
 #include "joint.h"
+#include "joint_solver.h"
+#include "mesh.h"
 #include "parallel_for.h"
 #include "physics_world.h"
 #include "sensor.h"
 #include "shape.h"
 #include "solver_set.h"
+#include "timeline.h"
 
 #include <limits.h>
 #include <stdbool.h>
@@ -28,32 +31,6 @@
 #define ITERATIONS 1
 #define RELAX_ITERATIONS 1
 
-#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
-static inline void b2Pause( void )
-{
-	__asm__ __volatile__( "pause\n" );
-}
-#elif ( defined( __arm__ ) && defined( __ARM_ARCH ) && __ARM_ARCH >= 7 ) || defined( __aarch64__ )
-static inline void b2Pause( void )
-{
-	__asm__ __volatile__( "yield" ::: "memory" );
-}
-#elif defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
-static inline void b2Pause( void )
-{
-	_mm_pause();
-}
-#elif defined( _MSC_VER ) && ( defined( _M_ARM ) || defined( _M_ARM64 ) )
-static inline void b2Pause( void )
-{
-	__yield();
-}
-#else
-static inline void b2Pause( void )
-{
-}
-#endif
-
 typedef struct b2WorkerContext
 {
 	b2StepContext* context;
@@ -167,8 +144,10 @@ struct b2ContinuousContext
 	b2World* world;
 	b2BodySim* fastBodySim;
 	b2Shape* fastShape;
+	b2ShapeSim* fastShapeSim;
 	b2Vec2 centroid1, centroid2;
 	b2Sweep sweep;
+	b2AABB sweptBox;
 	float fraction;
 	b2SensorHit sensorHits[B2_MAX_CONTINUOUS_SENSOR_HITS];
 	float sensorFractions[B2_MAX_CONTINUOUS_SENSOR_HITS];
@@ -177,6 +156,126 @@ struct b2ContinuousContext
 
 #define B2_CORE_FRACTION 0.25f
 
+// Early out on fast parallel movement over a chain segment.
+static bool b2SkipChainSegment( const struct b2ContinuousContext* continuousContext, const b2Segment* segment,
+								b2Transform transform )
+{
+	b2Vec2 p1 = b2TransformPoint( transform, segment->point1 );
+	b2Vec2 p2 = b2TransformPoint( transform, segment->point2 );
+	b2Vec2 e = b2Sub( p2, p1 );
+	float length;
+	e = b2GetLengthAndNormalize( &length, e );
+	if ( length > B2_LINEAR_SLOP )
+	{
+		b2Vec2 c1 = continuousContext->centroid1;
+		float separation1 = b2Cross( b2Sub( c1, p1 ), e );
+		b2Vec2 c2 = continuousContext->centroid2;
+		float separation2 = b2Cross( b2Sub( c2, p1 ), e );
+
+		float coreDistance = B2_CORE_FRACTION * continuousContext->fastBodySim->minExtent;
+
+		if ( separation1 < 0.0f || ( separation1 - separation2 < coreDistance && separation2 > coreDistance ) )
+		{
+			// Minimal clipping
+			return true;
+		}
+	}
+
+	return false;
+}
+
+struct b2ContinuousMeshContext
+{
+	const struct b2ContinuousContext* continuousContext;
+	b2Sweep sweep;
+	b2Transform transform;
+	b2TOIOutput output;
+	float fraction;
+	bool didHit;
+};
+
+static bool b2ContinuousMeshCallback( const b2ChainSegment* segment, int segmentIndex, void* context )
+{
+	B2_UNUSED( segmentIndex );
+
+	struct b2ContinuousMeshContext* meshContext = context;
+	const struct b2ContinuousContext* continuousContext = meshContext->continuousContext;
+	if ( b2SkipChainSegment( continuousContext, &segment->segment, meshContext->transform ) )
+	{
+		return true;
+	}
+
+	const b2ShapeSim* fastShape = continuousContext->fastShapeSim;
+
+	b2TOIInput input;
+	input.proxyA = b2MakeProxy( &segment->segment.point1, 2, 0.0f );
+	input.proxyB = b2MakeShapeDistanceProxy( fastShape );
+	input.sweepA = meshContext->sweep;
+	input.sweepB = continuousContext->sweep;
+	input.maxFraction = meshContext->fraction;
+
+	b2TOIOutput output = b2TimeOfImpact( &input );
+	if ( 0.0f == output.fraction )
+	{
+		// fallback to TOI of a small circle around the fast shape centroid
+		b2Vec2 centroid = b2GetShapeCentroid( fastShape );
+		b2ShapeExtent extent = b2ComputeShapeExtent( fastShape, centroid );
+		float radius = B2_CORE_FRACTION * extent.minExtent;
+		input.proxyB = b2MakeProxy( &centroid, 1, radius );
+		output = b2TimeOfImpact( &input );
+	}
+
+	if ( 0.0f < output.fraction && output.fraction < meshContext->fraction )
+	{
+		meshContext->output = output;
+		meshContext->fraction = output.fraction;
+		meshContext->didHit = true;
+	}
+
+	return true;
+}
+
+// Find the earliest time of impact with the mesh or heightfield segments near the swept box of the fast shape
+static void b2ContinuousMeshQuery( struct b2ContinuousContext* continuousContext, b2Shape* shape, const b2ShapeSim* shapeSim,
+								   b2BodySim* bodySim )
+{
+	struct b2ContinuousMeshContext meshContext = { 0 };
+	meshContext.continuousContext = continuousContext;
+	meshContext.sweep = b2MakeSweep( bodySim );
+	meshContext.transform = bodySim->transform;
+	meshContext.fraction = continuousContext->fraction;
+
+	// The mesh body may be a moving kinematic body when the fast body is a bullet
+	b2Sweep sweep = meshContext.sweep;
+	b2Transform xf1 = { b2Sub( sweep.c1, b2RotateVector( sweep.q1, sweep.localCenter ) ), sweep.q1 };
+	b2AABB box1 = b2InvTransformAABB( xf1, continuousContext->sweptBox );
+	b2AABB box2 = b2InvTransformAABB( bodySim->transform, continuousContext->sweptBox );
+	b2QueryShapeSegments( shapeSim, b2AABB_Union( box1, box2 ), b2ContinuousMeshCallback, &meshContext );
+
+	if ( meshContext.didHit == false )
+	{
+		return;
+	}
+
+	b2World* world = continuousContext->world;
+	b2Shape* fastShape = continuousContext->fastShape;
+	b2TOIOutput output = meshContext.output;
+	bool didHit = true;
+
+	if ( ( shape->enablePreSolveEvents || fastShape->enablePreSolveEvents ) && world->preSolveFcn != NULL )
+	{
+		b2ShapeId shapeIdA = { shape->id + 1, world->worldId, shape->generation };
+		b2ShapeId shapeIdB = { fastShape->id + 1, world->worldId, fastShape->generation };
+		didHit = world->preSolveFcn( shapeIdA, shapeIdB, output.point, output.normal, world->preSolveContext );
+	}
+
+	if ( didHit )
+	{
+		continuousContext->fastBodySim->flags |= b2_hadTimeOfImpact;
+		continuousContext->fraction = output.fraction;
+	}
+}
+
 // This is called from b2DynamicTree_Query for continuous collision
 static bool b2ContinuousQueryCallback( int proxyId, uint64_t userData, void* context )
 {
@@ -185,6 +284,7 @@ static bool b2ContinuousQueryCallback( int proxyId, uint64_t userData, void* con
 	int shapeId = (int)userData;
 	struct b2ContinuousContext* continuousContext = context;
 	b2Shape* fastShape = continuousContext->fastShape;
+	b2ShapeSim* fastShapeSim = continuousContext->fastShapeSim;
 	b2BodySim* fastBodySim = continuousContext->fastBodySim;
 
 	B2_ASSERT( fastShape->sensorIndex == B2_NULL_INDEX );
@@ -197,16 +297,17 @@ static bool b2ContinuousQueryCallback( int proxyId, uint64_t userData, void* con
 
 	b2World* world = continuousContext->world;
 	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
 
 	// Skip same body
-	if ( shape->bodyId == fastShape->bodyId )
+	if ( shapeSim->bodyId == fastShapeSim->bodyId )
 	{
 		return true;
 	}
 
 	// Skip sensors unless the shapes want sensor events
 	bool isSensor = shape->sensorIndex != B2_NULL_INDEX;
-	if ( isSensor && ( shape->enableSensorEvents == false || fastShape->enableSensorEvents == false ) )
+	if ( isSensor && ( shapeSim->enableSensorEvents == false || fastShapeSim->enableSensorEvents == false ) )
 	{
 		return true;
 	}
@@ -218,7 +319,7 @@ static bool b2ContinuousQueryCallback( int proxyId, uint64_t userData, void* con
 		return true;
 	}
 
-	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+	b2Body* body = b2Array_Get( world->bodies, shapeSim->bodyId );
 
 	b2BodySim* bodySim = b2GetBodySim( world, body );
 	B2_ASSERT( body->type == b2_staticBody || ( fastBodySim->flags & b2_isBullet ) );
@@ -253,39 +354,27 @@ static bool b2ContinuousQueryCallback( int proxyId, uint64_t userData, void* con
 		}
 	}
 
-	// Early out on fast parallel movement over a chain shape.
-	if ( shape->type == b2_chainSegmentShape )
+	// Meshes and heightfields are never sensors
+	if ( b2IsSegmentCollection( shapeSim ) )
 	{
-		b2Transform transform = bodySim->transform;
-		b2Vec2 p1 = b2TransformPoint( transform, shape->chainSegment.segment.point1 );
-		b2Vec2 p2 = b2TransformPoint( transform, shape->chainSegment.segment.point2 );
-		b2Vec2 e = b2Sub( p2, p1 );
-		float length;
-		e = b2GetLengthAndNormalize( &length, e );
-		if ( length > B2_LINEAR_SLOP )
-		{
-			b2Vec2 c1 = continuousContext->centroid1;
-			float separation1 = b2Cross( b2Sub( c1, p1 ), e );
-			b2Vec2 c2 = continuousContext->centroid2;
-			float separation2 = b2Cross( b2Sub( c2, p1 ), e );
-
-			float coreDistance = B2_CORE_FRACTION * fastBodySim->minExtent;
+		b2ContinuousMeshQuery( continuousContext, shape, shapeSim, bodySim );
+		return true;
+	}
 
-			if ( separation1 < 0.0f || ( separation1 - separation2 < coreDistance && separation2 > coreDistance ) )
-			{
-				// Minimal clipping
-				return true;
-			}
-		}
+	// Early out on fast parallel movement over a chain shape.
+	if ( shapeSim->type == b2_chainSegmentShape &&
+		 b2SkipChainSegment( continuousContext, &shapeSim->chainSegment.segment, bodySim->transform ) )
+	{
+		return true;
 	}
 
 	// todo_erin testing early out for segments
 #if 0
-	if ( shape->type == b2_segmentShape )
+	if ( shapeSim->type == b2_segmentShape )
 	{
 		b2Transform transform = bodySim->transform;
-		b2Vec2 p1 = b2TransformPoint( transform, shape->segment.point1 );
-		b2Vec2 p2 = b2TransformPoint( transform, shape->segment.point2 );
+		b2Vec2 p1 = b2TransformPoint( transform, shapeSim->segment.point1 );
+		b2Vec2 p2 = b2TransformPoint( transform, shapeSim->segment.point2 );
 		b2Vec2 e = b2Sub( p2, p1 );
 		b2Vec2 c1 = continuousContext->centroid1;
 		b2Vec2 c2 = continuousContext->centroid2;
@@ -307,8 +396,8 @@ static bool b2ContinuousQueryCallback( int proxyId, uint64_t userData, void* con
 #endif
 
 	b2TOIInput input;
-	input.proxyA = b2MakeShapeDistanceProxy( shape );
-	input.proxyB = b2MakeShapeDistanceProxy( fastShape );
+	input.proxyA = b2MakeShapeDistanceProxy( shapeSim );
+	input.proxyB = b2MakeShapeDistanceProxy( fastShapeSim );
 	input.sweepA = b2MakeSweep( bodySim );
 	input.sweepB = continuousContext->sweep;
 	input.maxFraction = continuousContext->fraction;
@@ -345,8 +434,8 @@ static bool b2ContinuousQueryCallback( int proxyId, uint64_t userData, void* con
 		else if ( 0.0f == output.fraction )
 		{
 			// fallback to TOI of a small circle around the fast shape centroid
-			b2Vec2 centroid = b2GetShapeCentroid( fastShape );
-			b2ShapeExtent extent = b2ComputeShapeExtent( fastShape, centroid );
+			b2Vec2 centroid = b2GetShapeCentroid( fastShapeSim );
+			b2ShapeExtent extent = b2ComputeShapeExtent( fastShapeSim, centroid );
 			float radius = B2_CORE_FRACTION * extent.minExtent;
 			input.proxyB = b2MakeProxy( &centroid, 1, radius );
 			output = b2TimeOfImpact( &input );
@@ -411,25 +500,28 @@ static void b2SolveContinuous( b2World* world, int bodySimIndex, b2TaskContext*
 	while ( shapeId != B2_NULL_INDEX )
 	{
 		b2Shape* fastShape = b2Array_Get( world->shapes, shapeId );
+		b2ShapeSim* fastShapeSim = b2Array_Get( world->shapeSims, shapeId );
 		shapeId = fastShape->nextShapeId;
 
 		context.fastShape = fastShape;
+		context.fastShapeSim = fastShapeSim;
 		context.centroid1 = b2TransformPoint( xf1, fastShape->localCentroid );
 		context.centroid2 = b2TransformPoint( xf2, fastShape->localCentroid );
 
 		b2AABB box1 = fastShape->aabb;
-		b2AABB box2 = b2ComputeShapeAABB( fastShape, xf2 );
+		b2AABB box2 = b2ComputeShapeAABB( fastShapeSim, xf2 );
 
 		// Store this to avoid double computation in the case there is no impact event
 		fastShape->aabb = box2;
 
-		// No continuous collision for sensors (but still need the updated bounds)
-		if ( fastShape->sensorIndex != B2_NULL_INDEX )
+		// No continuous collision for sensors, meshes, or heightfields (but still need the updated bounds)
+		if ( fastShape->sensorIndex != B2_NULL_INDEX || b2IsSegmentCollection( fastShapeSim ) )
 		{
 			continue;
 		}
 
 		b2AABB sweptBox = b2AABB_Union( box1, box2 );
+		context.sweptBox = sweptBox;
 
 		b2DynamicTree_Query( staticTree, sweptBox, B2_DEFAULT_MASK_BITS, b2ContinuousQueryCallback, &context );
 
@@ -467,16 +559,17 @@ static void b2SolveContinuous( b2World* world, int bodySimIndex, b2TaskContext*
 		while ( shapeId != B2_NULL_INDEX )
 		{
 			b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+			b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
 
 			// Must recompute aabb at the interpolated transform
-			b2AABB aabb = b2ComputeShapeAABB( shape, transform );
+			b2AABB aabb = b2ComputeShapeAABB( shapeSim, transform );
 			aabb.lowerBound.x -= speculativeDistance;
 			aabb.lowerBound.y -= speculativeDistance;
 			aabb.upperBound.x += speculativeDistance;
 			aabb.upperBound.y += speculativeDistance;
 			shape->aabb = aabb;
 
-			if ( b2AABB_Contains( shape->fatAABB, aabb ) == false )
+			if ( b2AABB_Contains( shapeSim->fatAABB, aabb ) == false )
 			{
 				float margin = shape->aabbMargin;
 				b2AABB fatAABB;
@@ -484,7 +577,7 @@ static void b2SolveContinuous( b2World* world, int bodySimIndex, b2TaskContext*
 				fatAABB.lowerBound.y = aabb.lowerBound.y - margin;
 				fatAABB.upperBound.x = aabb.upperBound.x + margin;
 				fatAABB.upperBound.y = aabb.upperBound.y + margin;
-				shape->fatAABB = fatAABB;
+				shapeSim->fatAABB = fatAABB;
 
 				shape->enlargedAABB = true;
 				fastBodySim->flags |= b2_enlargeBounds;
@@ -506,10 +599,11 @@ static void b2SolveContinuous( b2World* world, int bodySimIndex, b2TaskContext*
 		while ( shapeId != B2_NULL_INDEX )
 		{
 			b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+			b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
 
 			// shape->aabb is still valid from above
 
-			if ( b2AABB_Contains( shape->fatAABB, shape->aabb ) == false )
+			if ( b2AABB_Contains( shapeSim->fatAABB, shape->aabb ) == false )
 			{
 				float margin = shape->aabbMargin;
 				b2AABB fatAABB;
@@ -517,7 +611,7 @@ static void b2SolveContinuous( b2World* world, int bodySimIndex, b2TaskContext*
 				fatAABB.lowerBound.y = shape->aabb.lowerBound.y - margin;
 				fatAABB.upperBound.x = shape->aabb.upperBound.x + margin;
 				fatAABB.upperBound.y = shape->aabb.upperBound.y + margin;
-				shape->fatAABB = fatAABB;
+				shapeSim->fatAABB = fatAABB;
 
 				shape->enlargedAABB = true;
 				fastBodySim->flags |= b2_enlargeBounds;
@@ -692,6 +786,7 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex,
 		while ( shapeId != B2_NULL_INDEX )
 		{
 			b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+			b2ShapeSim* shapeSim = b2Array_Get( world->shapeSims, shapeId );
 
 			if ( isFast )
 			{
@@ -704,7 +799,7 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex,
 			}
 			else
 			{
-				b2AABB aabb = b2ComputeShapeAABB( shape, transform );
+				b2AABB aabb = b2ComputeShapeAABB( shapeSim, transform );
 				aabb.lowerBound.x -= speculativeDistance;
 				aabb.lowerBound.y -= speculativeDistance;
 				aabb.upperBound.x += speculativeDistance;
@@ -713,7 +808,7 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex,
 
 				B2_ASSERT( shape->enlargedAABB == false );
 
-				if ( b2AABB_Contains( shape->fatAABB, aabb ) == false )
+				if ( b2AABB_Contains( shapeSim->fatAABB, aabb ) == false )
 				{
 					float margin = shape->aabbMargin;
 					b2AABB fatAABB;
@@ -721,7 +816,7 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex,
 					fatAABB.lowerBound.y = aabb.lowerBound.y - margin;
 					fatAABB.upperBound.x = aabb.upperBound.x + margin;
 					fatAABB.upperBound.y = aabb.upperBound.y + margin;
-					shape->fatAABB = fatAABB;
+					shapeSim->fatAABB = fatAABB;
 
 					shape->enlargedAABB = true;
 
@@ -779,6 +874,21 @@ static inline b2BlockDim b2ComputeBlockCount( int itemCount, int minSize, int ma
 	return dim;
 }
 
+// Turn lanes of a wide contact constraint into dummy constraints. Every member of the wide constraint
+// is an array of 32-bit values with one value per lane, so the constraint is a table of lane rows.
+static void b2ClearWideLanes( void* constraint, int byteCount, int simdWidth, int firstLane )
+{
+	uint32_t* values = constraint;
+	int rowCount = byteCount / ( simdWidth * (int)sizeof( uint32_t ) );
+	for ( int row = 0; row < rowCount; ++row )
+	{
+		for ( int lane = firstLane; lane < simdWidth; ++lane )
+		{
+			values[row * simdWidth + lane] = 0;
+		}
+	}
+}
+
 // Initialize solver blocks for a contiguous range of items. Computes block size internally
 // from the same parameters used by b2ComputeBlockCount. The atomic claim counter is zeroed
 // so workers can CAS (0, 1) on the first stage that owns these blocks.
@@ -826,12 +936,19 @@ static inline b2SolverStage* b2InitStage( b2SolverStage* stage, b2SolverStageTyp
 
 // Initialize one stage per color for each iteration. Used for warm start, solve, relax, and restitution.
 // All iterations of a given color share the same b2SyncBlock array so the per-block syncIndex
-// grows monotonically across stages within that color.
+// grows monotonically across stages within that color. The parallel overflow stage runs ahead
+// of the colors, matching the priority of the serial overflow solver.
 static b2SolverStage* b2InitColorStages( b2SolverStage* stage, b2SolverStageType type, int iterations, int activeColorCount,
-										 b2SyncBlock** colorBlocks, int* colorBlockCounts, int* activeColorIndices )
+										 b2SyncBlock** colorBlocks, int* colorBlockCounts, int* activeColorIndices,
+										 b2SyncBlock* overflowBlocks, int overflowBlockCount )
 {
 	for ( int j = 0; j < iterations; ++j )
 	{
+		if ( overflowBlockCount > 0 )
+		{
+			stage = b2InitStage( stage, type, overflowBlocks, overflowBlockCount, B2_OVERFLOW_INDEX );
+		}
+
 		for ( int i = 0; i < activeColorCount; ++i )
 		{
 			stage = b2InitStage( stage, type, colorBlocks[i], colorBlockCounts[i], (uint8_t)activeColorIndices[i] );
@@ -840,11 +957,19 @@ static b2SolverStage* b2InitColorStages( b2SolverStage* stage, b2SolverStageType
 	return stage;
 }
 
+// Solver stages map directly onto the leading timeline stages
+_Static_assert( (int)b2_timelineStoreImpulses - (int)b2_timelinePrepareJoints == (int)b2_stageStoreImpulses,
+				"timeline stages must match solver stages" );
+
 static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2SolverBlock block, int workerIndex )
 {
 	b2SolverStageType stageType = stage->type;
 	b2SolverBlockType blockType = block.blockType;
 
+	const b2ContactSolverKernels* contactKernels = context->world->contactSolverKernels;
+	bool recordTimeline = context->world->timelineCapacity > 0;
+	uint64_t startTicks = recordTimeline ? b2GetTicks() : 0;
+
 	switch ( stageType )
 	{
 		case b2_stagePrepareJoints:
@@ -852,7 +977,7 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 			break;
 
 		case b2_stagePrepareContacts:
-			b2PrepareContactsTask( block, context );
+			contactKernels->prepare( block, context );
 			break;
 
 		case b2_stageIntegrateVelocities:
@@ -862,25 +987,34 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 		case b2_stageWarmStart:
 			if ( blockType == b2_graphContactBlock )
 			{
-				b2WarmStartContactsTask( block, context );
+				contactKernels->warmStart( block, context );
 			}
 			else if ( blockType == b2_graphJointBlock )
 			{
 				b2WarmStartJointsTask( block, context );
 			}
+			else if ( blockType == b2_overflowContactBlock )
+			{
+				b2WarmStartOverflowContactsTask( block, context );
+			}
 			break;
 
 		case b2_stageSolve:
 			if ( blockType == b2_graphContactBlock )
 			{
 				bool useBias = true;
-				b2SolveContactsTask( block, context, useBias );
+				contactKernels->solve( block, context, useBias );
 			}
 			else if ( blockType == b2_graphJointBlock )
 			{
 				bool useBias = true;
 				b2SolveJointsTask( block, context, useBias, workerIndex );
 			}
+			else if ( blockType == b2_overflowContactBlock )
+			{
+				bool useBias = true;
+				b2SolveOverflowContactsTask( block, context, useBias );
+			}
 			break;
 
 		case b2_stageIntegratePositions:
@@ -891,26 +1025,48 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 			if ( blockType == b2_graphContactBlock )
 			{
 				bool useBias = false;
-				b2SolveContactsTask( block, context, useBias );
+				contactKernels->solve( block, context, useBias );
 			}
 			else if ( blockType == b2_graphJointBlock )
 			{
 				bool useBias = false;
 				b2SolveJointsTask( block, context, useBias, workerIndex );
 			}
+			else if ( blockType == b2_overflowContactBlock )
+			{
+				bool useBias = false;
+				b2SolveOverflowContactsTask( block, context, useBias );
+			}
 			break;
 
 		case b2_stageRestitution:
 			if ( blockType == b2_graphContactBlock )
 			{
-				b2ApplyRestitutionTask( block, context );
+				contactKernels->applyRestitution( block, context );
+			}
+			else if ( blockType == b2_overflowContactBlock )
+			{
+				b2ApplyOverflowRestitutionTask( block, context );
 			}
 			break;
 
 		case b2_stageStoreImpulses:
-			b2StoreImpulsesTask( block, context, workerIndex );
+			if ( blockType == b2_contactBlock )
+			{
+				contactKernels->storeImpulses( block, context, workerIndex );
+			}
+			else if ( blockType == b2_jointBlock )
+			{
+				b2StoreJointImpulsesTask( block, context );
+			}
 			break;
 	}
+
+	if ( recordTimeline )
+	{
+		b2TimelineStage timelineStage = (b2TimelineStage)( b2_timelinePrepareJoints + stageType );
+		b2AddTimelineEvent( context->world, workerIndex, timelineStage, startTicks, block.count );
+	}
 }
 
 // This staggers the worker start indices so they avoid touching the same solver blocks
@@ -992,15 +1148,31 @@ static void b2ExecuteMainStage( b2SolverStage* stage, b2StepContext* context, ui
 		b2ExecuteStage( stage, context, previousSyncIndex, syncIndex, workerIndex );
 
 		// Spin waiting for thieves to finish
-		while ( b2AtomicLoadInt( &stage->completionCount ) != blockCount )
+		if ( b2AtomicLoadInt( &stage->completionCount ) != blockCount )
 		{
-			b2Pause();
+			uint64_t spinTicks = b2GetTicks();
+			while ( b2AtomicLoadInt( &stage->completionCount ) != blockCount )
+			{
+				b2Pause();
+			}
+
+			context->world->taskContexts.data[workerIndex].idleSpinTime += b2GetMilliseconds( spinTicks );
 		}
 
 		b2AtomicStoreInt( &stage->completionCount, 0 );
 	}
 }
 
+// Run the parallel overflow stage and then apply the velocity changes serially. Returns the next stage index.
+static int b2ExecuteOverflowStage( b2StepContext* context, int stageIndex, int syncIndex )
+{
+	B2_ASSERT( context->stages[stageIndex].colorIndex == B2_OVERFLOW_INDEX );
+	uint32_t syncBits = ( (uint32_t)syncIndex << 16 ) | (uint32_t)stageIndex;
+	b2ExecuteMainStage( context->stages + stageIndex, context, syncBits );
+	b2ApplyOverflowContactDeltas( context );
+	return stageIndex + 1;
+}
+
 // Parallel solver task
 static void b2SolverTask( void* taskContext )
 {
@@ -1072,6 +1244,10 @@ static void b2SolverTask( void* taskContext )
 		b2PrepareJoints_Overflow( context );
 		b2PrepareContacts_Overflow( context );
 
+		// Overflow contacts are either solved here on the main thread or by a parallel stage ahead of each color pass
+		bool parallelOverflow = context->overflowSplitCounts != NULL;
+		int colorStageCount = activeColorCount + ( parallelOverflow ? 1 : 0 );
+
 		profile->prepareConstraints += b2GetMillisecondsAndReset( &ticks );
 
 		int graphSyncIndex = 1;
@@ -1093,7 +1269,14 @@ static void b2SolverTask( void* taskContext )
 
 			// Warm start constraints
 			b2WarmStartJoints_Overflow( context );
-			b2WarmStartContacts_Overflow( context );
+			if ( parallelOverflow )
+			{
+				iterationStageIndex = b2ExecuteOverflowStage( context, iterationStageIndex, graphSyncIndex );
+			}
+			else
+			{
+				b2WarmStartContacts_Overflow( context );
+			}
 
 			for ( int colorIndex = 0; colorIndex < activeColorCount; ++colorIndex )
 			{
@@ -1112,7 +1295,14 @@ static void b2SolverTask( void* taskContext )
 			{
 				// Overflow constraints have lower priority. Typically these are dynamic-vs-dynamic.
 				b2SolveJoints_Overflow( context, useBias );
-				b2SolveContacts_Overflow( context, useBias );
+				if ( parallelOverflow )
+				{
+					iterationStageIndex = b2ExecuteOverflowStage( context, iterationStageIndex, graphSyncIndex );
+				}
+				else
+				{
+					b2SolveContacts_Overflow( context, useBias );
+				}
 
 				for ( int colorIndex = 0; colorIndex < activeColorCount; ++colorIndex )
 				{
@@ -1140,7 +1330,15 @@ static void b2SolverTask( void* taskContext )
 			for ( int j = 0; j < RELAX_ITERATIONS; ++j )
 			{
 				b2SolveJoints_Overflow( context, useBias );
-				b2SolveContacts_Overflow( context, useBias );
+				if ( parallelOverflow )
+				{
+					iterationStageIndex = b2ExecuteOverflowStage( context, iterationStageIndex, graphSyncIndex );
+				}
+				else
+				{
+					b2SolveContacts_Overflow( context, useBias );
+				}
+
 				for ( int colorIndex = 0; colorIndex < activeColorCount; ++colorIndex )
 				{
 					syncBits = ( graphSyncIndex << 16 ) | iterationStageIndex;
@@ -1156,13 +1354,20 @@ static void b2SolverTask( void* taskContext )
 
 		// Advance the stage according to the sub-stepping tasks just completed
 		// integrate velocities / warm start / solve / integrate positions / relax
-		stageIndex += 1 + activeColorCount + ITERATIONS * activeColorCount + 1 + RELAX_ITERATIONS * activeColorCount;
+		stageIndex += 1 + colorStageCount + ITERATIONS * colorStageCount + 1 + RELAX_ITERATIONS * colorStageCount;
 
 		// Restitution
 		{
-			b2ApplyRestitution_Overflow( context );
-
 			int iterStageIndex = stageIndex;
+			if ( parallelOverflow )
+			{
+				iterStageIndex = b2ExecuteOverflowStage( context, iterStageIndex, graphSyncIndex );
+			}
+			else
+			{
+				b2ApplyRestitution_Overflow( context );
+			}
+
 			for ( int colorIndex = 0; colorIndex < activeColorCount; ++colorIndex )
 			{
 				syncBits = ( graphSyncIndex << 16 ) | iterStageIndex;
@@ -1171,7 +1376,7 @@ static void b2SolverTask( void* taskContext )
 				iterStageIndex += 1;
 			}
 			// graphSyncIndex += 1;
-			stageIndex += activeColorCount;
+			stageIndex += colorStageCount;
 		}
 
 		profile->applyRestitution += b2GetMillisecondsAndReset( &ticks );
@@ -1179,7 +1384,8 @@ static void b2SolverTask( void* taskContext )
 		// Store impulses
 		b2StoreImpulses_Overflow( context );
 
-		syncBits = ( contactSyncIndex << 16 ) | stageIndex;
+		uint32_t storeSyncIndex = 1;
+		syncBits = ( storeSyncIndex << 16 ) | stageIndex;
 		B2_ASSERT( stages[stageIndex].type == b2_stageStoreImpulses );
 		b2ExecuteMainStage( stages + stageIndex, context, syncBits );
 
@@ -1192,7 +1398,11 @@ static void b2SolverTask( void* taskContext )
 		return;
 	}
 
-	// Worker spins and waits for work
+	// Worker spins and waits for work. Solver stages are short so the worker never parks here,
+	// but it does yield after the spin budget unless the idle policy is pure spinning.
+	b2IdlePolicy idlePolicy = context->world->idlePolicy;
+	int idleSpinCount = context->world->idleSpinCount;
+	float idleSpinTime = 0.0f;
 	uint32_t lastSyncBits = 0;
 	// uint64_t maxSpinTime = 10;
 	while ( true )
@@ -1200,31 +1410,37 @@ static void b2SolverTask( void* taskContext )
 		// Spin until main thread bumps changes the sync bits. This can waste significant time overall, but it is necessary for
 		// parallel simulation with graph coloring.
 		// todo improve this spinner
-		uint32_t syncBits;
-		int spinCount = 0;
-		while ( ( syncBits = b2AtomicLoadU32( &context->atomicSyncBits ) ) == lastSyncBits )
+		uint32_t syncBits = b2AtomicLoadU32( &context->atomicSyncBits );
+		if ( syncBits == lastSyncBits )
 		{
-			if ( spinCount > 5 )
+			uint64_t spinTicks = b2GetTicks();
+			int spinCount = 0;
+			while ( ( syncBits = b2AtomicLoadU32( &context->atomicSyncBits ) ) == lastSyncBits )
 			{
-				b2Yield();
-				spinCount = 0;
+				if ( spinCount > idleSpinCount && idlePolicy != b2_idleSpin )
+				{
+					b2Yield();
+					spinCount = 0;
+				}
+				else
+				{
+					// Using the cycle counter helps to account for variation in mm_pause timing across different
+					// CPUs. However, this is X64 only.
+					// uint64_t prev = __rdtsc();
+					// do
+					//{
+					//	_mm_pause();
+					//}
+					// while ((__rdtsc() - prev) < maxSpinTime);
+					// maxSpinTime += 10;
+
+					b2Pause();
+					b2Pause();
+					spinCount += 1;
+				}
 			}
-			else
-			{
-				// Using the cycle counter helps to account for variation in mm_pause timing across different
-				// CPUs. However, this is X64 only.
-				// uint64_t prev = __rdtsc();
-				// do
-				//{
-				//	_mm_pause();
-				//}
-				// while ((__rdtsc() - prev) < maxSpinTime);
-				// maxSpinTime += 10;
 
-				b2Pause();
-				b2Pause();
-				spinCount += 1;
-			}
+			idleSpinTime += b2GetMilliseconds( spinTicks );
 		}
 
 		if ( syncBits == UINT_MAX )
@@ -1246,6 +1462,8 @@ static void b2SolverTask( void* taskContext )
 
 		lastSyncBits = syncBits;
 	}
+
+	context->world->taskContexts.data[workerIndex].idleSpinTime += idleSpinTime;
 }
 
 static void b2BulletBodyTask( int startIndex, int endIndex, int workerIndex, void* context )
@@ -1266,12 +1484,28 @@ static void b2BulletBodyTask( int startIndex, int endIndex, int workerIndex, voi
 	b2TracyCZoneEnd( bullet_body_task );
 }
 
+// Applies the deferred broad-phase enlargements of the pipelined step. This runs in the user tree task slot
+// so it is finished before anything reads the trees.
+static void b2EnlargeProxiesTask( void* context )
+{
+	b2TracyCZoneNC( enlarge_task, "Enlarge Proxies", b2_colorFireBrick, true );
+
+	b2World* world = context;
+	b2BroadPhase_ApplyEnlargements( &world->broadPhase );
+
+	b2TracyCZoneEnd( enlarge_task );
+}
+
 // Solve with graph coloring
 void b2Solve( b2World* world, b2StepContext* stepContext )
 {
 	// Only count steps that advance the simulation
 	world->stepIndex += 1;
 
+	// Rebalance before the solver gathers the colors
+	world->rebalancedContactCount = world->enableGraphRebalance ? b2RebalanceGraph( world ) : 0;
+	world->sortedContactCount = world->enableContactSort ? b2SortGraphColor( world ) : 0;
+
 	// Are there any awake bodies? This scenario should not be important for profiling.
 	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
 	int awakeBodyCount = awakeSet->bodySims.count;
@@ -1320,6 +1554,26 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 
 		const int minContactsPerBlock = 4;
 		const int minJointsPerBlock = 4;
+		const int minOverflowContactsPerBlock = 16;
+
+		// Revolute, weld, and prismatic joints in the graph colors are packed into wide joint constraints.
+		// The remaining joints are listed separately and solved one at a time.
+		int wideJointCapacity = 0;
+		int graphJointCount = 0;
+		for ( int i = 0; i < B2_GRAPH_COLOR_COUNT - 1; ++i )
+		{
+			int perColorJointCount = colors[i].jointSims.count;
+			if ( perColorJointCount > 0 )
+			{
+				wideJointCapacity += b2GetWideJointCapacity( perColorJointCount );
+				graphJointCount += perColorJointCount;
+			}
+		}
+
+		int wideJointByteCount = b2GetWideJointConstraintByteCount();
+		struct b2JointConstraintWide* wideJoints =
+			b2StackAlloc( &world->stack, wideJointCapacity * wideJointByteCount, "wide joint constraints" );
+		b2JointSim** scalarJoints = b2StackAlloc( &world->stack, graphJointCount * sizeof( b2JointSim* ), "scalar joints" );
 
 		// Configure blocks for tasks parallel-for each active graph color
 		// The blocks are a mix of wide contact blocks and joint blocks
@@ -1330,9 +1584,16 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		b2BlockDim graphJointDims[B2_GRAPH_COLOR_COUNT];
 		int graphBlockCount = 0;
 
+		// The wide contact layout follows the SIMD width of the contact kernels selected for this world
+		const b2ContactSolverKernels* contactKernels = world->contactSolverKernels;
+		int contactSimdWidth = contactKernels->simdWidth;
+		int contactSimdShift = contactKernels->simdShift;
+
 		// c is the active color index
 		int wideContactCount = 0;
 		int jointCount = 0;
+		int wideJointBase = 0;
+		int scalarJointBase = 0;
 		int c = 0;
 		for ( int i = 0; i < B2_GRAPH_COLOR_COUNT - 1; ++i )
 		{
@@ -1347,21 +1608,30 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			activeColorIndices[c] = i;
 
 			// Ceiling for wide constraint count
-			int colorContactCountW = colorContactCount > 0 ? ( ( colorContactCount - 1 ) >> B2_SIMD_SHIFT ) + 1 : 0;
+			int colorContactCountW = colorContactCount > 0 ? ( ( colorContactCount - 1 ) >> contactSimdShift ) + 1 : 0;
 			wideContactCount += colorContactCountW;
 			colorContactCounts[c] = colorContactCountW;
 
-			colorJointCounts[c] = colorJointCount;
-			jointCount += colorJointCount;
+			// Joint work items are the wide joint constraints followed by the scalar joints
+			struct b2JointConstraintWide* colorWideJoints =
+				(struct b2JointConstraintWide*)( (uint8_t*)wideJoints + wideJointBase * wideJointByteCount );
+			int colorJointItemCount = b2BuildWideJoints( colors + i, colorWideJoints, scalarJoints + scalarJointBase );
+			wideJointBase += colors[i].wideJointCount;
+			scalarJointBase += colors[i].scalarJointCount;
+
+			colorJointCounts[c] = colorJointItemCount;
+			jointCount += colorJointItemCount;
 
 			// Graph solver block dimensions
 			graphContactDims[c] = b2ComputeBlockCount( colorContactCountW, minContactsPerBlock, maxBlockCount );
-			graphJointDims[c] = b2ComputeBlockCount( colorJointCount, minJointsPerBlock, maxBlockCount );
+			graphJointDims[c] = b2ComputeBlockCount( colorJointItemCount, minJointsPerBlock, maxBlockCount );
 			graphBlockCount += graphContactDims[c].count + graphJointDims[c].count;
 
 			c += 1;
 		}
 		activeColorCount = c;
+		B2_ASSERT( wideJointBase <= wideJointCapacity );
+		B2_ASSERT( scalarJointBase <= graphJointCount );
 
 		// Prepare and store run as one flat parallel-for over the entire wide constraint range,
 		// partitioned into uniformly sized blocks. Color info is consulted inside the task via
@@ -1369,9 +1639,19 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		b2BlockDim contactPrepareDim = b2ComputeBlockCount( wideContactCount, minContactsPerBlock, maxBlockCount );
 		b2BlockDim jointPrepareDim = b2ComputeBlockCount( jointCount, minJointsPerBlock, maxBlockCount );
 
-		int wideContactConstraintByteCount = b2GetWideContactConstraintByteCount();
-		struct b2ContactConstraintWide* wideContactConstraints =
-			b2StackAlloc( &world->stack, wideContactCount * wideContactConstraintByteCount, "contact constraint" );
+		int wideContactConstraintByteCount = contactKernels->constraintByteCount;
+		B2_ASSERT( graph->wideConstraintByteCount == wideContactConstraintByteCount );
+
+		// The persistent wide constraints only need the dirty lanes prepared unless a solver parameter changed
+		bool fullContactPrepare = graph->preparedH != stepContext->h || graph->preparedInvH != stepContext->inv_h ||
+								  graph->preparedContactHertz != world->contactHertz ||
+								  graph->preparedDampingRatio != world->contactDampingRatio ||
+								  graph->preparedSoftening != world->enableContactSoftening;
+		graph->preparedH = stepContext->h;
+		graph->preparedInvH = stepContext->inv_h;
+		graph->preparedContactHertz = world->contactHertz;
+		graph->preparedDampingRatio = world->contactDampingRatio;
+		graph->preparedSoftening = world->enableContactSoftening;
 
 		b2GraphColor* overflow = colors + B2_OVERFLOW_INDEX;
 		int overflowCount = overflow->contactSims.count;
@@ -1379,6 +1659,36 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			b2StackAlloc( &world->stack, overflowCount * sizeof( b2ContactConstraint ), "overflow contact constraint" );
 		overflow->overflowConstraints = overflowContacts;
 
+		// The parallel overflow solver splits the mass of each body across the overflow contacts that share it
+		int* overflowSplitCounts = NULL;
+		b2BlockDim overflowDim = { 0 };
+		if ( world->enableParallelOverflow && overflowCount > 0 )
+		{
+			overflowSplitCounts = b2StackAlloc( &world->stack, awakeBodyCount * sizeof( int ), "overflow split counts" );
+			memset( overflowSplitCounts, 0, awakeBodyCount * sizeof( int ) );
+
+			b2ContactSim* overflowSims = overflow->contactSims.data;
+			for ( int i = 0; i < overflowCount; ++i )
+			{
+				int indexA = overflowSims[i].bodySimIndexA;
+				int indexB = overflowSims[i].bodySimIndexB;
+				if ( indexA != B2_NULL_INDEX )
+				{
+					overflowSplitCounts[indexA] += 1;
+				}
+
+				if ( indexB != B2_NULL_INDEX )
+				{
+					overflowSplitCounts[indexB] += 1;
+				}
+			}
+
+			overflowDim = b2ComputeBlockCount( overflowCount, minOverflowContactsPerBlock, maxBlockCount );
+		}
+
+		// The overflow stage runs ahead of the colors in each color pass
+		int colorStageCount = activeColorCount + ( overflowDim.count > 0 ? 1 : 0 );
+
 		// Build the span table for the flat prepare/store parallel-for while I slice the
 		// wide constraint buffer across colors. One entry per active color plus a sentinel
 		// at wideContactCount.
@@ -1395,49 +1705,50 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 				b2GraphColor* color = colors + j;
 
 				int colorContactCount = color->contactSims.count;
-				contactPrepareSpans[i].start = wideBase;
-				contactPrepareSpans[i].count = colorContactCount;
-				contactPrepareSpans[i].contacts = color->contactSims.data;
+				int colorContactCountW = colorContactCount > 0 ? ( ( colorContactCount - 1 ) >> contactSimdShift ) + 1 : 0;
 
-				if ( colorContactCount == 0 )
+				if ( colorContactCountW > color->wideConstraintCapacity )
 				{
-					color->wideConstraints = NULL;
-					color->wideConstraintCount = 0;
+					// Growing keeps the prepared lanes
+					int newCapacity = b2MaxInt( colorContactCountW, 2 * color->wideConstraintCapacity );
+					color->wideConstraints =
+						b2GrowAlloc( color->wideConstraints, color->wideConstraintCapacity * wideContactConstraintByteCount,
+									 newCapacity * wideContactConstraintByteCount );
+					color->wideConstraintCapacity = newCapacity;
 				}
-				else
-				{
-					color->wideConstraints = (struct b2ContactConstraintWide*)( (uint8_t*)wideContactConstraints +
-																				wideBase * wideContactConstraintByteCount );
-
-					int colorContactCountW = ( ( colorContactCount - 1 ) >> B2_SIMD_SHIFT ) + 1;
-					color->wideConstraintCount = colorContactCountW;
 
-					// Zero remainder lanes in the tail wide slot so prepare workers don't need to
-					// initialize them.
-					if ( ( colorContactCount & ( B2_SIMD_WIDTH - 1 ) ) != 0 )
-					{
-						memset( (uint8_t*)color->wideConstraints + ( colorContactCountW - 1 ) * wideContactConstraintByteCount, 0,
-								wideContactConstraintByteCount );
-					}
+				color->wideConstraintCount = colorContactCountW;
 
-					wideBase += colorContactCountW;
+				// Lanes past the contact count may hold a removed contact and must act as dummy constraints
+				int tailLane = colorContactCount & ( contactSimdWidth - 1 );
+				if ( tailLane != 0 )
+				{
+					uint8_t* tail = (uint8_t*)color->wideConstraints + ( colorContactCountW - 1 ) * wideContactConstraintByteCount;
+					b2ClearWideLanes( tail, wideContactConstraintByteCount, contactSimdWidth, tailLane );
 				}
 
+				contactPrepareSpans[i].start = wideBase;
+				contactPrepareSpans[i].count = colorContactCount;
+				contactPrepareSpans[i].contacts = color->contactSims.data;
+				contactPrepareSpans[i].constraints = color->wideConstraints;
+				wideBase += colorContactCountW;
+
 				jointPrepareSpans[i].start = jointBase;
-				jointPrepareSpans[i].count = color->jointSims.count;
-				jointPrepareSpans[i].joints = color->jointSims.data;
-				jointBase += color->jointSims.count;
+				jointPrepareSpans[i].count = colorJointCounts[i];
+				jointPrepareSpans[i].color = color;
+				jointBase += colorJointCounts[i];
 			}
 
 			// Sentinel
 			contactPrepareSpans[activeColorCount].start = wideContactCount;
 			contactPrepareSpans[activeColorCount].count = 0;
 			contactPrepareSpans[activeColorCount].contacts = NULL;
+			contactPrepareSpans[activeColorCount].constraints = NULL;
 			B2_ASSERT( wideBase == wideContactCount );
 
 			jointPrepareSpans[activeColorCount].start = jointCount;
 			jointPrepareSpans[activeColorCount].count = 0;
-			jointPrepareSpans[activeColorCount].joints = NULL;
+			jointPrepareSpans[activeColorCount].color = NULL;
 			B2_ASSERT( jointBase == jointCount );
 		}
 
@@ -1450,15 +1761,15 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		// b2_stageIntegrateVelocities
 		stageCount += 1;
 		// b2_stageWarmStart
-		stageCount += activeColorCount;
+		stageCount += colorStageCount;
 		// b2_stageSolve
-		stageCount += ITERATIONS * activeColorCount;
+		stageCount += ITERATIONS * colorStageCount;
 		// b2_stageIntegratePositions
 		stageCount += 1;
 		// b2_stageRelax
-		stageCount += RELAX_ITERATIONS * activeColorCount;
+		stageCount += RELAX_ITERATIONS * colorStageCount;
 		// b2_stageRestitution
-		stageCount += activeColorCount;
+		stageCount += colorStageCount;
 		// b2_stageStoreImpulses
 		stageCount += 1;
 
@@ -1469,6 +1780,18 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		b2SyncBlock* jointBlocks = b2StackAlloc( &world->stack, jointPrepareDim.count * sizeof( b2SyncBlock ), "joint blocks" );
 		b2SyncBlock* graphBlocks = b2StackAlloc( &world->stack, graphBlockCount * sizeof( b2SyncBlock ), "graph blocks" );
 
+		// Store impulses covers the joint range followed by the contact range. It needs its own blocks because
+		// the prepare blocks are not synchronized the same number of times.
+		int storeBlockCount = jointPrepareDim.count + contactPrepareDim.count;
+		b2SyncBlock* storeBlocks = b2StackAlloc( &world->stack, storeBlockCount * sizeof( b2SyncBlock ), "store blocks" );
+
+		b2SyncBlock* overflowBlocks = NULL;
+		if ( overflowDim.count > 0 )
+		{
+			overflowBlocks = b2StackAlloc( &world->stack, overflowDim.count * sizeof( b2SyncBlock ), "overflow blocks" );
+			b2InitBlocks( overflowBlocks, overflowDim, overflowCount, b2_overflowContactBlock, B2_OVERFLOW_INDEX );
+		}
+
 		// Split an awake island. This modifies:
 		// - stack allocator
 		// - world island array and solver set
@@ -1497,6 +1820,8 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		// The task walks spans to decode flat slot indices back to per-color arrays.
 		b2InitBlocks( contactBlocks, contactPrepareDim, wideContactCount, b2_contactBlock, UINT8_MAX );
 		b2InitBlocks( jointBlocks, jointPrepareDim, jointCount, b2_jointBlock, UINT8_MAX );
+		b2InitBlocks( storeBlocks, jointPrepareDim, jointCount, b2_jointBlock, UINT8_MAX );
+		b2InitBlocks( storeBlocks + jointPrepareDim.count, contactPrepareDim, wideContactCount, b2_contactBlock, UINT8_MAX );
 
 		// Prepare graph work blocks. Each color gets joint blocks followed by contact blocks.
 		b2SyncBlock* graphColorBlocks[B2_GRAPH_COLOR_COUNT] = { 0 };
@@ -1523,15 +1848,15 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		stage = b2InitStage( stage, b2_stagePrepareContacts, contactBlocks, contactPrepareDim.count, UINT8_MAX );
 		stage = b2InitStage( stage, b2_stageIntegrateVelocities, bodyBlocks, bodyDim.count, UINT8_MAX );
 		stage = b2InitColorStages( stage, b2_stageWarmStart, 1, activeColorCount, graphColorBlocks, graphBlockCounts,
-								   activeColorIndices );
+								   activeColorIndices, overflowBlocks, overflowDim.count );
 		stage = b2InitColorStages( stage, b2_stageSolve, ITERATIONS, activeColorCount, graphColorBlocks, graphBlockCounts,
-								   activeColorIndices );
+								   activeColorIndices, overflowBlocks, overflowDim.count );
 		stage = b2InitStage( stage, b2_stageIntegratePositions, bodyBlocks, bodyDim.count, UINT8_MAX );
 		stage = b2InitColorStages( stage, b2_stageRelax, RELAX_ITERATIONS, activeColorCount, graphColorBlocks, graphBlockCounts,
-								   activeColorIndices );
+								   activeColorIndices, overflowBlocks, overflowDim.count );
 		stage = b2InitColorStages( stage, b2_stageRestitution, 1, activeColorCount, graphColorBlocks, graphBlockCounts,
-								   activeColorIndices );
-		stage = b2InitStage( stage, b2_stageStoreImpulses, contactBlocks, contactPrepareDim.count, UINT8_MAX );
+								   activeColorIndices, overflowBlocks, overflowDim.count );
+		stage = b2InitStage( stage, b2_stageStoreImpulses, storeBlocks, storeBlockCount, UINT8_MAX );
 
 		B2_ASSERT( (int)( stage - stages ) == stageCount );
 
@@ -1543,10 +1868,11 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		stepContext->workerCount = workerCount;
 		stepContext->stageCount = stageCount;
 		stepContext->stages = stages;
-		stepContext->wideContactConstraints = wideContactConstraints;
+		stepContext->fullContactPrepare = fullContactPrepare;
 		stepContext->contactPrepareSpans = contactPrepareSpans;
 		stepContext->wideContactCount = wideContactCount;
 		stepContext->jointPrepareSpans = jointPrepareSpans;
+		stepContext->overflowSplitCounts = overflowSplitCounts;
 		b2AtomicStoreU32( &stepContext->atomicSyncBits, 0 );
 		b2AtomicStoreInt( &stepContext->mainClaimed, 0 );
 
@@ -1627,15 +1953,25 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		}
 
 		// Finalize bodies. Must happen after the constraint solver and after island splitting.
-		b2ParallelFor( world, &b2FinalizeBodiesTask, awakeBodyCount, 64, stepContext );
+		b2ParallelFor( world, b2_timelineFinalizeBodies, &b2FinalizeBodiesTask, awakeBodyCount, 64, stepContext );
 
+		if ( overflowBlocks != NULL )
+		{
+			b2StackFree( &world->stack, overflowBlocks );
+		}
+		b2StackFree( &world->stack, storeBlocks );
 		b2StackFree( &world->stack, graphBlocks );
 		b2StackFree( &world->stack, jointBlocks );
 		b2StackFree( &world->stack, contactBlocks );
 		b2StackFree( &world->stack, bodyBlocks );
 		b2StackFree( &world->stack, stages );
+		if ( overflowSplitCounts != NULL )
+		{
+			b2StackFree( &world->stack, overflowSplitCounts );
+		}
 		b2StackFree( &world->stack, overflowContacts );
-		b2StackFree( &world->stack, wideContactConstraints );
+		b2StackFree( &world->stack, scalarJoints );
+		b2StackFree( &world->stack, wideJoints );
 
 		world->profile.transforms = b2GetMilliseconds( transformTicks );
 		b2TracyCZoneEnd( update_transforms );
@@ -1826,6 +2162,8 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		// Apply shape AABB changes to broad-phase. This also create the move array which must be
 		// in deterministic order. I'm tracking sim bodies because the number of shape ids can be huge.
 		// This has to happen before bullets are processed.
+		// The tree updates are applied afterwards, in parallel or by a task in the pipelined step.
+		bool deferEnlarge = world->enablePipelinedStep && world->taskCount < B2_MAX_TASKS;
 		{
 			b2BroadPhase* broadPhase = &world->broadPhase;
 			uint32_t wordCount = enlargedBodyBitSet->blockCount;
@@ -1835,6 +2173,7 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			b2Body* bodyArray = world->bodies.data;
 			b2BodySim* bodySimArray = awakeSet->bodySims.data;
 			b2Shape* shapeArray = world->shapes.data;
+			b2ShapeSim* shapeSimArray = world->shapeSims.data;
 
 			for ( uint32_t k = 0; k < wordCount; ++k )
 			{
@@ -1875,7 +2214,7 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 							// A fast body may have been flagged as enlarged despite having no shapes enlarged.
 							if ( shape->enlargedAABB )
 							{
-								b2BroadPhase_EnlargeProxy( broadPhase, shape->proxyKey, shape->fatAABB );
+								b2BroadPhase_DeferEnlargeProxy( broadPhase, shape->proxyKey, shapeSimArray[shapeId].fatAABB );
 								shape->enlargedAABB = false;
 							}
 
@@ -1889,7 +2228,19 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			}
 		}
 
-		b2ValidateBroadphase( &world->broadPhase );
+		if ( deferEnlarge && world->broadPhase.enlargeArray.count > 0 )
+		{
+			// The tree refit overlaps the rest of the step until the next fence.
+			// Fences: bullets and b2World_Step before the sensor pass.
+			world->userTreeTask = world->enqueueTaskFcn( &b2EnlargeProxiesTask, world, world->userTaskContext );
+			world->taskCount += 1;
+			world->activeTaskCount += world->userTreeTask == NULL ? 0 : 1;
+		}
+		else
+		{
+			b2RefitBroadPhase( world );
+			b2ValidateBroadphase( &world->broadPhase );
+		}
 
 		world->profile.refit = b2GetMilliseconds( refitTicks );
 		b2TracyCZoneEnd( refit_bvh );
@@ -1898,13 +2249,21 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 	int bulletBodyCount = b2AtomicLoadInt( &stepContext->bulletBodyCount );
 	if ( bulletBodyCount > 0 )
 	{
+		// Continuous collision queries the trees
+		if ( world->userTreeTask != NULL )
+		{
+			world->finishTaskFcn( world->userTreeTask, world->userTaskContext );
+			world->userTreeTask = NULL;
+			world->activeTaskCount -= 1;
+		}
+
 		b2TracyCZoneNC( bullets, "Bullets", b2_colorLightYellow, true );
 		uint64_t bulletTicks = b2GetTicks();
 
 		// Fast bullet bodies
 		// Note: a bullet body may be moving slow
 		int minRange = 8;
-		b2ParallelFor( world, &b2BulletBodyTask, bulletBodyCount, minRange, stepContext );
+		b2ParallelFor( world, b2_timelineBullets, &b2BulletBodyTask, bulletBodyCount, minRange, stepContext );
 
 		// Serially enlarge broad-phase proxies for bullet shapes
 		b2BroadPhase* broadPhase = &world->broadPhase;
@@ -1914,6 +2273,7 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		b2Body* bodyArray = world->bodies.data;
 		b2BodySim* bodySimArray = awakeSet->bodySims.data;
 		b2Shape* shapeArray = world->shapes.data;
+		b2ShapeSim* shapeSimArray = world->shapeSims.data;
 
 		// Serially enlarge broad-phase proxies for bullet shapes
 		int* bulletBodySimIndices = stepContext->bulletBodies;
@@ -1954,7 +2314,7 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 				// all fast bullet shapes should already be in the move buffer
 				B2_ASSERT( b2GetBit( &broadPhase->movedProxies[b2_dynamicBody], proxyId ) );
 
-				b2DynamicTree_EnlargeProxy( dynamicTree, proxyId, shape->fatAABB );
+				b2DynamicTree_EnlargeProxy( dynamicTree, proxyId, shapeSimArray[shapeId].fatAABB );
 
 				shapeId = shape->nextShapeId;
 			}
@@ -91,7 +91,8 @@ typedef enum b2SolverBlockType
 	b2_jointBlock,
 	b2_contactBlock,
 	b2_graphJointBlock,
-	b2_graphContactBlock
+	b2_graphContactBlock,
+	b2_overflowContactBlock
 } b2SolverBlockType;
 
 // Solver block describes a multithreaded unit of work.
@@ -133,22 +134,24 @@ typedef struct b2Softness
 
 // Prepare/store run as a flat parallel-for over the whole wide-constraint
 // range. Each span maps a slice of that range back to the owning color's
-// contacts so workers can decode flat wide-slot indices without touching
-// graph state. The spans array has one entry per active color plus a sentinel
-// whose start == wideContactCount.
+// contacts and persistent wide constraints so workers can decode flat
+// wide-slot indices without touching graph state. The spans array has one
+// entry per active color plus a sentinel whose start == wideContactCount.
 typedef struct b2ContactPrepareSpan
 {
 	int start;
 	int count;
 	b2ContactSim* contacts;
+	struct b2ContactConstraintWide* constraints;
 } b2ContactPrepareSpan;
 
-// Similar for joints
+// Similar for joints. A color's joint work items are its wide joint constraints
+// followed by its scalar joints, see b2BuildWideJoints.
 typedef struct b2JointPrepareSpan
 {
 	int start;
 	int count;
-	b2JointSim* joints;
+	struct b2GraphColor* color;
 } b2JointPrepareSpan;
 
 // Context for a time step. Recreated each time step.
@@ -193,17 +196,22 @@ typedef struct b2StepContext
 	// - parallel-for collide with no gaps, includes touching and non-touching
 	b2ContactSim** contactSims;
 
-	// Flat view of the wide contact constraint array used by prepare and store.
+	// Flat view of the wide contact constraints used by prepare and store.
 	// prepareSpans has activeColorCount + 1 entries, the last being a sentinel
-	// at wideContactCount. wideContactConstraints is the contiguous base
-	// pointer; per-color slices live at colors[i].wideConstraints.
-	b2ContactConstraintWide* wideContactConstraints;
+	// at wideContactCount.
 	b2ContactPrepareSpan* contactPrepareSpans;
 	int wideContactCount;
+
+	// Prepare every lane instead of only the dirty lanes, see b2_simPrepareDirty
+	bool fullContactPrepare;
 	
 	b2JointPrepareSpan* jointPrepareSpans;
 	int jointCount;
 
+	// Number of overflow contacts per awake body for the parallel overflow solver, NULL when the
+	// overflow contacts are solved serially
+	int* overflowSplitCounts;
+
 	int activeColorCount;
 	int workerCount;
 
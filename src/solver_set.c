@@ -321,8 +321,9 @@ void b2TrySleepIsland( b2World* world, int islandId )
 			int movedLocalIndex = b2Array_RemoveSwap( color->contactSims, localIndex );
 			if ( movedLocalIndex != B2_NULL_INDEX )
 			{
-				// fix moved element
+				// fix moved element, it now owns a different wide constraint lane
 				b2ContactSim* movedContactSim = color->contactSims.data + localIndex;
+				movedContactSim->simFlags |= b2_simPrepareDirty;
 				b2Contact* movedContact = b2Array_Get( world->contacts, movedContactSim->contactId );
 				B2_ASSERT( movedContact->localIndex == movedLocalIndex );
 				movedContact->localIndex = localIndex;
@@ -11,46 +11,19 @@
 #include <stdbool.h>
 #include <string.h>
 
+#if defined( BOX2D_SWISS_TABLE )
+#if defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+#include <emmintrin.h>
+#elif defined( B2_SIMD_NEON )
+#include <arm_neon.h>
+#endif
+#endif
+
 #if B2_SNOOP_TABLE_COUNTERS
 b2AtomicInt b2_findCount;
 b2AtomicInt b2_probeCount;
 #endif
 
-b2HashSet b2CreateSet( int capacity )
-{
-	b2HashSet set = { 0 };
-
-	// Capacity must be a power of 2
-	if ( capacity > 16 )
-	{
-		set.capacity = b2RoundUpPowerOf2( capacity );
-	}
-	else
-	{
-		set.capacity = 16;
-	}
-
-	set.count = 0;
-	set.items = b2Alloc( set.capacity * sizeof( b2SetItem ) );
-	memset( set.items, 0, set.capacity * sizeof( b2SetItem ) );
-
-	return set;
-}
-
-void b2DestroySet( b2HashSet* set )
-{
-	b2Free( set->items, set->capacity * sizeof( b2SetItem ) );
-	set->items = NULL;
-	set->count = 0;
-	set->capacity = 0;
-}
-
-void b2ClearSet( b2HashSet* set )
-{
-	set->count = 0;
-	memset( set->items, 0, set->capacity * sizeof( b2SetItem ) );
-}
-
 // I need a good hash because the keys are built from pairs of increasing integers.
 // A simple hash like hash = (integer1 XOR integer2) has many collisions.
 // https://lemire.me/blog/2018/08/15/fast-strongly-universal-64-bit-hashing-everywhere/
@@ -88,6 +61,510 @@ static uint64_t b2KeyHash( uint64_t key )
 }
 #endif
 
+#if defined( BOX2D_SWISS_TABLE )
+
+// Group probed hash set, based on the Swiss table
+// https://abseil.io/about/design/swisstables
+// Control bytes are either empty, deleted, busy, or hold the low 7 bits of the key hash. The
+// remaining hash bits select the home group. Groups are probed with triangular steps, which
+// visits every group because the group count is a power of 2.
+#define B2_CONTROL_EMPTY 0x80
+#define B2_CONTROL_DELETED 0xFE
+
+// A slot being filled by b2AddKeyConcurrent
+#define B2_CONTROL_BUSY 0xFF
+
+_Static_assert( B2_SET_GROUP_SIZE == 16, "groups are matched with 16 byte vectors" );
+
+#if defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+
+typedef __m128i b2ControlGroup;
+
+// One bit per slot
+#define B2_GROUP_MASK_SHIFT 0
+
+static inline b2ControlGroup b2LoadGroup( const uint8_t* controls )
+{
+	return _mm_load_si128( (const __m128i*)controls );
+}
+
+static inline uint64_t b2MatchGroup( b2ControlGroup group, uint8_t value )
+{
+	__m128i match = _mm_cmpeq_epi8( group, _mm_set1_epi8( (char)value ) );
+	return (uint32_t)_mm_movemask_epi8( match );
+}
+
+#elif defined( B2_SIMD_NEON )
+
+typedef uint8x16_t b2ControlGroup;
+
+// NEON has no movemask. Narrowing the compare result gives one nibble per slot.
+// https://community.arm.com/arm-community-blogs/b/servers-and-cloud-computing-blog/posts/porting-x86-vector-bitmask-optimizations-to-arm-neon
+#define B2_GROUP_MASK_SHIFT 2
+
+static inline b2ControlGroup b2LoadGroup( const uint8_t* controls )
+{
+	return vld1q_u8( controls );
+}
+
+static inline uint64_t b2MatchGroup( b2ControlGroup group, uint8_t value )
+{
+	uint8x16_t match = vceqq_u8( group, vdupq_n_u8( value ) );
+	uint8x8_t nibbles = vshrn_n_u16( vreinterpretq_u16_u8( match ), 4 );
+	return vget_lane_u64( vreinterpret_u64_u8( nibbles ), 0 ) & 0x8888888888888888ull;
+}
+
+#else
+
+typedef struct b2ControlGroup
+{
+	uint8_t bytes[B2_SET_GROUP_SIZE];
+} b2ControlGroup;
+
+#define B2_GROUP_MASK_SHIFT 0
+
+static inline b2ControlGroup b2LoadGroup( const uint8_t* controls )
+{
+	b2ControlGroup group;
+	memcpy( group.bytes, controls, B2_SET_GROUP_SIZE );
+	return group;
+}
+
+static inline uint64_t b2MatchGroup( b2ControlGroup group, uint8_t value )
+{
+	uint64_t mask = 0;
+	for ( int i = 0; i < B2_SET_GROUP_SIZE; ++i )
+	{
+		mask |= (uint64_t)( group.bytes[i] == value ) << i;
+	}
+	return mask;
+}
+
+#endif
+
+// Index of the lowest matching slot in a group mask
+static inline uint32_t b2FirstMatch( uint64_t mask )
+{
+	return b2CTZ64( mask ) >> B2_GROUP_MASK_SHIFT;
+}
+
+// Low 7 bits of the hash
+static inline uint8_t b2ControlHash( uint64_t hash )
+{
+	return (uint8_t)( hash & 0x7F );
+}
+
+static inline uint32_t b2HomeGroup( uint64_t hash, uint32_t groupCount )
+{
+	return (uint32_t)( hash >> 7 ) & ( groupCount - 1 );
+}
+
+static void b2AllocateSet( b2HashSet* set, uint32_t capacity )
+{
+	set->capacity = capacity;
+	set->count = 0;
+	set->deletedCount = 0;
+	set->items = b2Alloc( capacity * sizeof( b2SetItem ) );
+	memset( set->items, 0, capacity * sizeof( b2SetItem ) );
+
+	// b2Alloc aligns to 32 bytes so groups can use aligned loads
+	set->controls = b2Alloc( capacity * sizeof( uint8_t ) );
+	memset( set->controls, B2_CONTROL_EMPTY, capacity * sizeof( uint8_t ) );
+}
+
+b2HashSet b2CreateSet( int capacity )
+{
+	b2HashSet set = { 0 };
+
+	// Capacity must be a power of 2 and hold at least one group
+	if ( capacity > B2_SET_GROUP_SIZE )
+	{
+		b2AllocateSet( &set, b2RoundUpPowerOf2( capacity ) );
+	}
+	else
+	{
+		b2AllocateSet( &set, B2_SET_GROUP_SIZE );
+	}
+
+	return set;
+}
+
+void b2DestroySet( b2HashSet* set )
+{
+	b2Free( set->items, set->capacity * sizeof( b2SetItem ) );
+	b2Free( set->controls, set->capacity * sizeof( uint8_t ) );
+	set->items = NULL;
+	set->controls = NULL;
+	set->count = 0;
+	set->deletedCount = 0;
+	set->capacity = 0;
+}
+
+void b2ClearSet( b2HashSet* set )
+{
+	set->count = 0;
+	set->deletedCount = 0;
+	memset( set->items, 0, set->capacity * sizeof( b2SetItem ) );
+	memset( set->controls, B2_CONTROL_EMPTY, set->capacity * sizeof( uint8_t ) );
+}
+
+// Returns the item index or B2_NULL_INDEX
+static int b2FindKey( const b2HashSet* set, uint64_t key, uint64_t hash )
+{
+#if B2_SNOOP_TABLE_COUNTERS
+	b2AtomicFetchAddInt( &b2_findCount, 1 );
+#endif
+
+	uint32_t groupCount = set->capacity / B2_SET_GROUP_SIZE;
+	uint32_t groupIndex = b2HomeGroup( hash, groupCount );
+	uint8_t controlHash = b2ControlHash( hash );
+	const b2SetItem* items = set->items;
+
+	// The load factor guarantees an empty slot
+	for ( uint32_t step = 1;; ++step )
+	{
+		uint32_t base = groupIndex * B2_SET_GROUP_SIZE;
+		b2ControlGroup group = b2LoadGroup( set->controls + base );
+
+		uint64_t match = b2MatchGroup( group, controlHash );
+		while ( match != 0 )
+		{
+			uint32_t index = base + b2FirstMatch( match );
+			if ( items[index].key == key )
+			{
+				return (int)index;
+			}
+
+			match &= match - 1;
+		}
+
+		if ( b2MatchGroup( group, B2_CONTROL_EMPTY ) != 0 )
+		{
+			return B2_NULL_INDEX;
+		}
+
+#if B2_SNOOP_TABLE_COUNTERS
+		b2AtomicFetchAddInt( &b2_probeCount, 1 );
+#endif
+
+		groupIndex = ( groupIndex + step ) & ( groupCount - 1 );
+	}
+}
+
+// Finds the first empty or deleted slot along the probe sequence
+static int b2FindInsertSlot( const b2HashSet* set, uint64_t hash )
+{
+	uint32_t groupCount = set->capacity / B2_SET_GROUP_SIZE;
+	uint32_t groupIndex = b2HomeGroup( hash, groupCount );
+
+	for ( uint32_t step = 1;; ++step )
+	{
+		uint32_t base = groupIndex * B2_SET_GROUP_SIZE;
+		b2ControlGroup group = b2LoadGroup( set->controls + base );
+		uint64_t match = b2MatchGroup( group, B2_CONTROL_EMPTY ) | b2MatchGroup( group, B2_CONTROL_DELETED );
+		if ( match != 0 )
+		{
+			return (int)( base + b2FirstMatch( match ) );
+		}
+
+		groupIndex = ( groupIndex + step ) & ( groupCount - 1 );
+	}
+}
+
+// Moves the keys into new storage. This drops deleted slots, so it is also used at the same capacity.
+static void b2ResizeSet( b2HashSet* set, uint32_t capacity )
+{
+	uint32_t oldCount = set->count;
+	B2_UNUSED( oldCount );
+
+	uint32_t oldCapacity = set->capacity;
+	b2SetItem* oldItems = set->items;
+	uint8_t* oldControls = set->controls;
+
+	b2AllocateSet( set, capacity );
+
+	for ( uint32_t i = 0; i < oldCapacity; ++i )
+	{
+		if ( oldControls[i] & 0x80 )
+		{
+			// empty or deleted
+			continue;
+		}
+
+		uint64_t key = oldItems[i].key;
+		uint64_t hash = b2KeyHash( key );
+		int index = b2FindInsertSlot( set, hash );
+		set->items[index].key = key;
+		set->controls[index] = b2ControlHash( hash );
+		set->count += 1;
+	}
+
+	B2_ASSERT( set->count == oldCount );
+
+	b2Free( oldItems, oldCapacity * sizeof( b2SetItem ) );
+	b2Free( oldControls, oldCapacity * sizeof( uint8_t ) );
+}
+
+bool b2ContainsKey( const b2HashSet* set, uint64_t key )
+{
+	// key of zero is a sentinel
+	B2_ASSERT( key != 0 );
+	uint64_t hash = b2KeyHash( key );
+	return b2FindKey( set, key, hash ) != B2_NULL_INDEX;
+}
+
+int b2GetHashSetBytes( b2HashSet* set )
+{
+	return set->capacity * (int)( sizeof( b2SetItem ) + sizeof( uint8_t ) );
+}
+
+bool b2AddKey( b2HashSet* set, uint64_t key )
+{
+	// key of zero is a sentinel
+	B2_ASSERT( key != 0 );
+
+	uint64_t hash = b2KeyHash( key );
+	if ( b2FindKey( set, key, hash ) != B2_NULL_INDEX )
+	{
+		// Already in set
+		return true;
+	}
+
+	if ( b2GetSetRoom( set ) <= 0 )
+	{
+		// Grow if the keys fill more than half the room, otherwise the room is held by deleted
+		// slots and rehashing in place reclaims them.
+		uint32_t capacity = set->capacity;
+		if ( 16 * ( set->count + 1 ) > 7 * capacity )
+		{
+			capacity = 2 * capacity;
+		}
+
+		b2ResizeSet( set, capacity );
+	}
+
+	int index = b2FindInsertSlot( set, hash );
+	if ( set->controls[index] == B2_CONTROL_DELETED )
+	{
+		B2_ASSERT( set->deletedCount > 0 );
+		set->deletedCount -= 1;
+	}
+
+	set->items[index].key = key;
+	set->controls[index] = b2ControlHash( hash );
+	set->count += 1;
+	return false;
+}
+
+bool b2RemoveKey( b2HashSet* set, uint64_t key )
+{
+	uint64_t hash = b2KeyHash( key );
+	int index = b2FindKey( set, key, hash );
+	if ( index == B2_NULL_INDEX )
+	{
+		// Not in set
+		return false;
+	}
+
+	// A probe only moves past a group that has no empty slot. If this group already has an empty
+	// slot then no probe sequence continues through it and the slot can be emptied.
+	int base = index & ~( B2_SET_GROUP_SIZE - 1 );
+	b2ControlGroup group = b2LoadGroup( set->controls + base );
+	if ( b2MatchGroup( group, B2_CONTROL_EMPTY ) != 0 )
+	{
+		set->controls[index] = B2_CONTROL_EMPTY;
+	}
+	else
+	{
+		set->controls[index] = B2_CONTROL_DELETED;
+		set->deletedCount += 1;
+	}
+
+	set->items[index].key = 0;
+
+	B2_ASSERT( set->count > 0 );
+	set->count -= 1;
+	return true;
+}
+
+void b2ReserveSet( b2HashSet* set, int addCount )
+{
+	if ( b2GetSetRoom( set ) >= addCount )
+	{
+		return;
+	}
+
+	// Size for the keys alone. Deleted slots are dropped by the resize.
+	uint32_t requiredCount = set->count + (uint32_t)addCount;
+	uint32_t capacity = set->capacity;
+	while ( capacity - capacity / 8 < requiredCount )
+	{
+		capacity = 2 * capacity;
+	}
+
+	b2ResizeSet( set, capacity );
+}
+
+// While keys are added concurrently a slot is claimed by swapping its control byte from empty to
+// busy. The key is stored before the control hash is published, so a probe that matches the control
+// hash can read the key. A probe that sees a busy slot waits because the key being stored may be the
+// same key. Deleted slots are not reused concurrently.
+// The group snapshots are plain loads that may race with the swaps. The control bytes only move from
+// empty to busy to full while this happens and any match is confirmed with atomic loads.
+_Static_assert( sizeof( b2SetItem ) == sizeof( b2AtomicU64 ), "set items are accessed atomically" );
+
+bool b2AddKeyConcurrent( b2HashSet* set, uint64_t key )
+{
+	// key of zero is a sentinel
+	B2_ASSERT( key != 0 );
+
+	uint64_t hash = b2KeyHash( key );
+	uint32_t groupCount = set->capacity / B2_SET_GROUP_SIZE;
+	uint32_t groupIndex = b2HomeGroup( hash, groupCount );
+	uint8_t controlHash = b2ControlHash( hash );
+	b2AtomicU8* controls = (b2AtomicU8*)set->controls;
+	b2AtomicU64* items = (b2AtomicU64*)set->items;
+
+	// There is always an empty slot because the caller stays within the reserved room
+	uint32_t step = 1;
+	for ( ;; )
+	{
+		uint32_t base = groupIndex * B2_SET_GROUP_SIZE;
+		b2ControlGroup group = b2LoadGroup( set->controls + base );
+
+		uint64_t match = b2MatchGroup( group, controlHash );
+		while ( match != 0 )
+		{
+			uint32_t index = base + b2FirstMatch( match );
+
+			// Acquire the control byte before reading the key
+			if ( b2AtomicLoadU8( controls + index ) == controlHash && b2AtomicLoadU64( items + index ) == key )
+			{
+				// Already in set
+				return true;
+			}
+
+			match &= match - 1;
+		}
+
+		uint64_t busy = b2MatchGroup( group, B2_CONTROL_BUSY );
+		if ( busy != 0 )
+		{
+			// Another thread is filling this group. Wait on the slot with atomic loads so the group
+			// is loaded again.
+			uint32_t index = base + b2FirstMatch( busy );
+			while ( b2AtomicLoadU8( controls + index ) == B2_CONTROL_BUSY )
+			{
+				b2Pause();
+			}
+
+			continue;
+		}
+
+		uint64_t empty = b2MatchGroup( group, B2_CONTROL_EMPTY );
+		if ( empty != 0 )
+		{
+			uint32_t index = base + b2FirstMatch( empty );
+			if ( b2AtomicCompareExchangeU8( controls + index, B2_CONTROL_EMPTY, B2_CONTROL_BUSY ) )
+			{
+				b2AtomicStoreU64( items + index, key );
+				b2AtomicStoreU8( controls + index, controlHash );
+
+				// Added
+				return false;
+			}
+
+			// Lost the slot, look at the group again
+			continue;
+		}
+
+		groupIndex = ( groupIndex + step ) & ( groupCount - 1 );
+		step += 1;
+	}
+}
+
+bool b2ContainsKeyConcurrent( const b2HashSet* set, uint64_t key )
+{
+	// key of zero is a sentinel
+	B2_ASSERT( key != 0 );
+
+	uint64_t hash = b2KeyHash( key );
+	uint32_t groupCount = set->capacity / B2_SET_GROUP_SIZE;
+	uint32_t groupIndex = b2HomeGroup( hash, groupCount );
+	uint8_t controlHash = b2ControlHash( hash );
+	const b2AtomicU8* controls = (const b2AtomicU8*)set->controls;
+	const b2AtomicU64* items = (const b2AtomicU64*)set->items;
+
+	// Keys that are still being stored are not found
+	for ( uint32_t step = 1;; ++step )
+	{
+		uint32_t base = groupIndex * B2_SET_GROUP_SIZE;
+		b2ControlGroup group = b2LoadGroup( set->controls + base );
+
+		uint64_t match = b2MatchGroup( group, controlHash );
+		while ( match != 0 )
+		{
+			uint32_t index = base + b2FirstMatch( match );
+			if ( b2AtomicLoadU8( controls + index ) == controlHash && b2AtomicLoadU64( items + index ) == key )
+			{
+				return true;
+			}
+
+			match &= match - 1;
+		}
+
+		if ( b2MatchGroup( group, B2_CONTROL_EMPTY ) != 0 )
+		{
+			return false;
+		}
+
+		groupIndex = ( groupIndex + step ) & ( groupCount - 1 );
+	}
+}
+
+void b2FinishConcurrentAdds( b2HashSet* set, int addCount )
+{
+	B2_ASSERT( addCount <= b2GetSetRoom( set ) );
+	set->count += (uint32_t)addCount;
+}
+
+#else
+
+b2HashSet b2CreateSet( int capacity )
+{
+	b2HashSet set = { 0 };
+
+	// Capacity must be a power of 2
+	if ( capacity > 16 )
+	{
+		set.capacity = b2RoundUpPowerOf2( capacity );
+	}
+	else
+	{
+		set.capacity = 16;
+	}
+
+	set.count = 0;
+	set.items = b2Alloc( set.capacity * sizeof( b2SetItem ) );
+	memset( set.items, 0, set.capacity * sizeof( b2SetItem ) );
+
+	return set;
+}
+
+void b2DestroySet( b2HashSet* set )
+{
+	b2Free( set->items, set->capacity * sizeof( b2SetItem ) );
+	set->items = NULL;
+	set->count = 0;
+	set->capacity = 0;
+}
+
+void b2ClearSet( b2HashSet* set )
+{
+	set->count = 0;
+	memset( set->items, 0, set->capacity * sizeof( b2SetItem ) );
+}
+
 static int b2FindSlot( const b2HashSet* set, uint64_t key, uint64_t hash )
 {
 #if B2_SNOOP_TABLE_COUNTERS
@@ -190,6 +667,84 @@ bool b2AddKey( b2HashSet* set, uint64_t key )
 	return false;
 }
 
+void b2ReserveSet( b2HashSet* set, int addCount )
+{
+	while ( b2GetSetRoom( set ) < addCount )
+	{
+		b2GrowTable( set );
+	}
+}
+
+// The items are accessed atomically while keys are added concurrently. A key is claimed by swapping
+// it into an empty slot. A slot never changes once it holds a key, so a probe that fails the swap
+// only needs to check the key that won.
+_Static_assert( sizeof( b2SetItem ) == sizeof( b2AtomicU64 ), "set items are accessed atomically" );
+
+bool b2AddKeyConcurrent( b2HashSet* set, uint64_t key )
+{
+	// key of zero is a sentinel
+	B2_ASSERT( key != 0 );
+
+	uint32_t capacity = set->capacity;
+	uint32_t index = (uint32_t)b2KeyHash( key ) & ( capacity - 1 );
+	b2AtomicU64* items = (b2AtomicU64*)set->items;
+
+	// There is always an empty slot because the caller stays within the reserved room
+	for ( ;; )
+	{
+		uint64_t slotKey = b2AtomicLoadU64( items + index );
+		if ( slotKey == 0 )
+		{
+			slotKey = b2AtomicCompareExchangeU64( items + index, 0, key );
+			if ( slotKey == 0 )
+			{
+				// Added
+				return false;
+			}
+		}
+
+		if ( slotKey == key )
+		{
+			// Already in set
+			return true;
+		}
+
+		index = ( index + 1 ) & ( capacity - 1 );
+	}
+}
+
+bool b2ContainsKeyConcurrent( const b2HashSet* set, uint64_t key )
+{
+	// key of zero is a sentinel
+	B2_ASSERT( key != 0 );
+
+	uint32_t capacity = set->capacity;
+	uint32_t index = (uint32_t)b2KeyHash( key ) & ( capacity - 1 );
+	const b2AtomicU64* items = (const b2AtomicU64*)set->items;
+
+	for ( ;; )
+	{
+		uint64_t slotKey = b2AtomicLoadU64( items + index );
+		if ( slotKey == key )
+		{
+			return true;
+		}
+
+		if ( slotKey == 0 )
+		{
+			return false;
+		}
+
+		index = ( index + 1 ) & ( capacity - 1 );
+	}
+}
+
+void b2FinishConcurrentAdds( b2HashSet* set, int addCount )
+{
+	B2_ASSERT( addCount <= b2GetSetRoom( set ) );
+	set->count += (uint32_t)addCount;
+}
+
 // See https://en.wikipedia.org/wiki/Open_addressing
 bool b2RemoveKey( b2HashSet* set, uint64_t key )
 {
@@ -253,6 +808,8 @@ bool b2RemoveKey( b2HashSet* set, uint64_t key )
 	return true;
 }
 
+#endif
+
 // This function is here because ctz.h is included by
 // this file but not in bitset.c
 int b2CountSetBits( b2BitSet* bitSet )
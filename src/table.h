@@ -20,6 +20,26 @@ typedef struct b2SetItem
 	//uint32_t hash;
 } b2SetItem;
 
+#if defined( BOX2D_SWISS_TABLE )
+
+// Items are probed in aligned groups of 16. Each item has a control byte that is either empty, deleted,
+// or holds 7 bits of the key hash. A group of control bytes is matched against the hash bits with a
+// single SIMD compare, so most probes only compare one key.
+#define B2_SET_GROUP_SIZE 16
+
+typedef struct b2HashSet
+{
+	b2SetItem* items;
+	uint8_t* controls;
+	uint32_t capacity;
+	uint32_t count;
+
+	// Removed items leave a deleted control byte in groups that are full, so probing can continue
+	uint32_t deletedCount;
+} b2HashSet;
+
+#else
+
 typedef struct b2HashSet
 {
 	b2SetItem* items;
@@ -27,6 +47,8 @@ typedef struct b2HashSet
 	uint32_t count;
 } b2HashSet;
 
+#endif
+
 b2HashSet b2CreateSet( int capacity );
 void b2DestroySet( b2HashSet* set );
 
@@ -42,6 +64,35 @@ bool b2ContainsKey( const b2HashSet* set, uint64_t key );
 
 int b2GetHashSetBytes( b2HashSet* set );
 
+// Concurrent insertion. Keys may be added and looked up from multiple threads at the same time with
+// the functions below. Keys may not be removed and the set may not grow while this happens, so room
+// is reserved beforehand and the number of keys added concurrently must stay within b2GetSetRoom.
+// With linear probing removal uses backward shift deletion in b2RemoveKey, so there are no tombstones
+// to clean up. The group probed set reclaims deleted items when it grows.
+
+// Grows the set so addCount more keys fit without growing
+void b2ReserveSet( b2HashSet* set, int addCount );
+
+// Thread safe. Returns true if key was already in set. The set count is not updated.
+bool b2AddKeyConcurrent( b2HashSet* set, uint64_t key );
+
+// Thread safe with b2AddKeyConcurrent
+bool b2ContainsKeyConcurrent( const b2HashSet* set, uint64_t key );
+
+// Adds the number of keys inserted by b2AddKeyConcurrent to the set count. Not thread safe.
+void b2FinishConcurrentAdds( b2HashSet* set, int addCount );
+
+// Number of keys that can be added before the set grows
+static inline int b2GetSetRoom( const b2HashSet* set )
+{
+#if defined( BOX2D_SWISS_TABLE )
+	// Maximum load factor of 7/8
+	return (int)( set->capacity - set->capacity / 8 ) - (int)( set->count + set->deletedCount );
+#else
+	return (int)( set->capacity / 2 ) - (int)set->count;
+#endif
+}
+
 static inline int b2GetSetCount( b2HashSet* set )
 {
 	return set->count;
@@ -0,0 +1,165 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "timeline.h"
+
+#include "physics_world.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+_Static_assert( b2_timelineStageCount == 19, "update the stage names" );
+
+static const char* b2_timelineStageNames[b2_timelineStageCount] = {
+	"PrepareJoints", "PrepareContacts", "IntegrateVelocities", "WarmStart", "Solve",	"IntegratePositions", "Relax",
+	"Restitution",	 "StoreImpulses",	"FindPairs",		   "Collide",	"FinalizeBodies", "Bullets",		"Sensors",
+	"Queries",		 "RebuildTree",	"ContactState",	"CreateContacts", "Refit",
+};
+
+void b2AddTimelineEvent( b2World* world, int workerIndex, b2TimelineStage stage, uint64_t startTicks, int itemCount )
+{
+	B2_ASSERT( world->timelineCapacity > 0 );
+
+	b2TaskContext* taskContext = b2Array_Get( world->taskContexts, workerIndex );
+	taskContext->timelineEvents[taskContext->timelineIndex] = (b2TimelineEvent){
+		.startTicks = startTicks,
+		.endTicks = b2GetTicks(),
+		.workerIndex = workerIndex,
+		.stage = stage,
+		.itemCount = itemCount,
+	};
+
+	taskContext->timelineIndex += 1;
+	if ( taskContext->timelineIndex == world->timelineCapacity )
+	{
+		taskContext->timelineIndex = 0;
+	}
+
+	if ( taskContext->timelineCount < world->timelineCapacity )
+	{
+		taskContext->timelineCount += 1;
+	}
+}
+
+static int b2CompareTimelineEvents( const void* a, const void* b )
+{
+	const b2TimelineEvent* eventA = a;
+	const b2TimelineEvent* eventB = b;
+
+	if ( eventA->startTicks != eventB->startTicks )
+	{
+		return eventA->startTicks < eventB->startTicks ? -1 : 1;
+	}
+
+	return eventA->workerIndex - eventB->workerIndex;
+}
+
+// Gathers the events of all workers sorted by start tick. Free with b2Free.
+static b2TimelineEvent* b2GatherTimeline( b2World* world, int* eventCount )
+{
+	int count = 0;
+	for ( int i = 0; i < world->taskContexts.count; ++i )
+	{
+		count += world->taskContexts.data[i].timelineCount;
+	}
+
+	*eventCount = count;
+	if ( count == 0 )
+	{
+		return NULL;
+	}
+
+	b2TimelineEvent* events = B2_ALLOC_ARRAY( count, b2TimelineEvent );
+	int index = 0;
+	for ( int i = 0; i < world->taskContexts.count; ++i )
+	{
+		b2TaskContext* taskContext = world->taskContexts.data + i;
+		for ( int j = 0; j < taskContext->timelineCount; ++j )
+		{
+			events[index++] = taskContext->timelineEvents[j];
+		}
+	}
+
+	qsort( events, count, sizeof( b2TimelineEvent ), b2CompareTimelineEvents );
+	return events;
+}
+
+int b2GetTimeline( b2World* world, b2TimelineEvent* events, int capacity )
+{
+	int count;
+	b2TimelineEvent* sorted = b2GatherTimeline( world, &count );
+	if ( events == NULL || sorted == NULL )
+	{
+		if ( sorted != NULL )
+		{
+			B2_FREE_ARRAY( sorted, count, b2TimelineEvent );
+		}
+
+		return count;
+	}
+
+	// Keep the most recent events
+	int writeCount = b2MinInt( count, capacity );
+	int first = count - writeCount;
+	for ( int i = 0; i < writeCount; ++i )
+	{
+		events[i] = sorted[first + i];
+	}
+
+	B2_FREE_ARRAY( sorted, count, b2TimelineEvent );
+	return writeCount;
+}
+
+void b2ClearTimeline( b2World* world )
+{
+	for ( int i = 0; i < world->taskContexts.count; ++i )
+	{
+		world->taskContexts.data[i].timelineIndex = 0;
+		world->taskContexts.data[i].timelineCount = 0;
+	}
+}
+
+bool b2SaveTimeline( b2World* world, const char* path )
+{
+	FILE* file = fopen( path, "w" );
+	if ( file == NULL )
+	{
+		return false;
+	}
+
+	int count;
+	b2TimelineEvent* events = b2GatherTimeline( world, &count );
+
+	fprintf( file, "{\"traceEvents\":[\n" );
+
+	// Name the worker rows
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		fprintf( file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"worker %d\"}}%s\n", i,
+				 i, i + 1 < world->workerCount || count > 0 ? "," : "" );
+	}
+
+	// Complete events with microsecond times relative to the first event
+	uint64_t baseTicks = count > 0 ? events[0].startTicks : 0;
+	for ( int i = 0; i < count; ++i )
+	{
+		b2TimelineEvent* event = events + i;
+		float start = 1000.0f * b2TicksToMilliseconds( event->startTicks - baseTicks );
+		float duration = 1000.0f * b2TicksToMilliseconds( event->endTicks - event->startTicks );
+		fprintf( file,
+				 "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"items\":%d}}%s\n",
+				 b2_timelineStageNames[event->stage], event->workerIndex, start, duration, event->itemCount,
+				 i + 1 < count ? "," : "" );
+	}
+
+	fprintf( file, "]}\n" );
+
+	if ( events != NULL )
+	{
+		B2_FREE_ARRAY( events, count, b2TimelineEvent );
+	}
+
+	bool success = ferror( file ) == 0;
+	fclose( file );
+	return success;
+}
@@ -0,0 +1,20 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "box2d/types.h"
+
+typedef struct b2World b2World;
+
+// Record a block of work that started at startTicks and ends now. Only call this
+// when world->timelineCapacity is positive. Each worker writes its own ring buffer.
+void b2AddTimelineEvent( b2World* world, int workerIndex, b2TimelineStage stage, uint64_t startTicks, int itemCount );
+
+// Copies the most recent events sorted by start tick. Returns the number of events written, or the
+// number available if events is NULL.
+int b2GetTimeline( b2World* world, b2TimelineEvent* events, int capacity );
+void b2ClearTimeline( b2World* world );
+
+// Writes the timeline as Chrome trace JSON
+bool b2SaveTimeline( b2World* world, const char* path );
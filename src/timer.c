@@ -70,6 +70,23 @@ float b2GetMillisecondsAndReset( uint64_t* ticks )
 	return ms;
 }
 
+float b2TicksToMilliseconds( uint64_t ticks )
+{
+	if ( s_invFrequency == 0.0 )
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency( &frequency );
+
+		s_invFrequency = (double)frequency.QuadPart;
+		if ( s_invFrequency > 0.0 )
+		{
+			s_invFrequency = 1000.0 / s_invFrequency;
+		}
+	}
+
+	return (float)( s_invFrequency * ticks );
+}
+
 void b2Yield( void )
 {
 	SwitchToThread();
@@ -258,6 +275,11 @@ float b2GetMillisecondsAndReset( uint64_t* ticks )
 	return ms;
 }
 
+float b2TicksToMilliseconds( uint64_t ticks )
+{
+	return (float)( ticks / 1000000.0 );
+}
+
 void b2Yield( void )
 {
 	sched_yield();
@@ -427,6 +449,20 @@ float b2GetMillisecondsAndReset( uint64_t* ticks )
 	return ms;
 }
 
+float b2TicksToMilliseconds( uint64_t ticks )
+{
+	if ( s_invFrequency == 0 )
+	{
+		mach_timebase_info_data_t timebase;
+		mach_timebase_info( &timebase );
+
+		// convert to ns then to ms
+		s_invFrequency = 1e-6 * (double)timebase.numer / (double)timebase.denom;
+	}
+
+	return (float)( s_invFrequency * ticks );
+}
+
 void b2Yield( void )
 {
 	sched_yield();
@@ -573,6 +609,12 @@ float b2GetMillisecondsAndReset( uint64_t* ticks )
 	return 0.0f;
 }
 
+float b2TicksToMilliseconds( uint64_t ticks )
+{
+	( (void)( ticks ) );
+	return 0.0f;
+}
+
 void b2Yield( void )
 {
 }
@@ -23,6 +23,9 @@ b2WorldDef b2DefaultWorldDef( void )
 	def.maximumLinearSpeed = 400.0f * lengthUnits;
 	def.enableSleep = true;
 	def.enableContinuous = true;
+	def.idlePolicy = b2_idleSpinThenPark;
+	def.idleSpinCount = 5;
+	def.broadPhaseType = b2_treeBroadPhase;
 	def.internalValue = B2_SECRET_COOKIE;
 	return def;
 }
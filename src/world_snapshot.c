@@ -10,9 +10,11 @@
 #include "contact.h"
 #include "container.h"
 #include "core.h"
+#include "height_field.h"
 #include "id_pool.h"
 #include "island.h"
 #include "joint.h"
+#include "mesh.h"
 #include "physics_world.h"
 #include "recording.h"
 #include "sensor.h"
@@ -30,7 +32,7 @@
 #define B2_SNAP_MAGIC 0x32534E42u // 'BNS2'
 
 // Bump this if any of the data structures below get modified.
-#define B2_SNAP_VERSION 2u
+#define B2_SNAP_VERSION 12u
 
 // Header flag bits
 #define B2_SNAP_FLAG_VALIDATION 0x1u // image was built with validation, only used for diagnostics
@@ -49,7 +51,11 @@ static uint32_t b2ComputeLayoutHash( void )
 	MIX( sizeof( b2BodySim ) )
 	MIX( sizeof( b2BodyState ) )
 	MIX( sizeof( b2Shape ) )
+	MIX( sizeof( b2ShapeSim ) )
 	MIX( sizeof( b2ChainShape ) )
+	MIX( sizeof( b2Geometry ) )
+	MIX( sizeof( b2Polygon ) )
+	MIX( sizeof( b2MeshNode ) )
 	MIX( sizeof( b2Contact ) )
 	MIX( sizeof( b2ContactSim ) )
 	MIX( sizeof( b2Joint ) )
@@ -64,7 +70,10 @@ static uint32_t b2ComputeLayoutHash( void )
 	MIX( sizeof( b2GraphColor ) )
 	MIX( sizeof( b2DynamicTree ) )
 	MIX( sizeof( b2TreeNode ) )
+	MIX( sizeof( b2TreeNodeData ) )
+	MIX( sizeof( b2TreeNode4 ) )
 	MIX( sizeof( b2SetItem ) )
+	MIX( sizeof( b2HashSet ) )
 	MIX( sizeof( b2IdPool ) )
 	MIX( sizeof( b2SurfaceMaterial ) )
 	MIX( B2_GRAPH_COLOR_COUNT )
@@ -88,6 +97,7 @@ typedef struct b2SnapHeader
 // B2_SNAP_VERSION.
 #if INTPTR_MAX == INT64_MAX
 _Static_assert( sizeof( b2ChainShape ) == 48, "b2ChainShape layout changed; resync snapshot chain serialization" );
+_Static_assert( sizeof( b2Geometry ) == 12, "b2Geometry layout changed; resync snapshot geometry serialization" );
 _Static_assert( sizeof( b2Sensor ) == 56, "b2Sensor layout changed; resync snapshot sensor serialization" );
 _Static_assert( sizeof( b2Island ) == 64, "b2Island layout changed; resync snapshot island serialization" );
 #endif
@@ -275,6 +285,13 @@ static void b2SerHashSet( b2RecBuffer* buf, const b2HashSet* hs )
 	{
 		b2SnapW_Bytes( buf, hs->items, (int)( hs->capacity * sizeof( b2SetItem ) ) );
 	}
+#if defined( BOX2D_SWISS_TABLE )
+	b2SnapW_U32( buf, hs->deletedCount );
+	if ( hs->capacity > 0 )
+	{
+		b2SnapW_Bytes( buf, hs->controls, (int)hs->capacity );
+	}
+#endif
 }
 
 static void b2DesHashSet( b2SnapReader* r, b2HashSet* hs )
@@ -285,6 +302,10 @@ static void b2DesHashSet( b2SnapReader* r, b2HashSet* hs )
 	// (cap & (cap-1)) == 0 also accepts 0, which the empty branch handles.
 	bool valid = b2SnapCheckCount( r, (int)cap, (int)sizeof( b2SetItem ), (int)sizeof( b2SetItem ) ) && ( cap & ( cap - 1 ) ) == 0 &&
 				 cnt <= cap;
+#if defined( BOX2D_SWISS_TABLE )
+	// Probing is by whole groups
+	valid = valid && ( cap == 0 || cap >= B2_SET_GROUP_SIZE );
+#endif
 	if ( r->ok && valid == false )
 	{
 		r->ok = false;
@@ -308,6 +329,24 @@ static void b2DesHashSet( b2SnapReader* r, b2HashSet* hs )
 		hs->capacity = 0;
 		hs->count = 0;
 	}
+#if defined( BOX2D_SWISS_TABLE )
+	hs->deletedCount = b2SnapR_U32( r );
+	if ( r->ok && ( hs->deletedCount > cap || cnt + hs->deletedCount > cap ) )
+	{
+		r->ok = false;
+	}
+	if ( cap > 0 )
+	{
+		hs->controls = b2Alloc( cap );
+		memset( hs->controls, 0x80, cap );
+		b2SnapR_Bytes( r, hs->controls, (int)cap );
+	}
+	else
+	{
+		hs->controls = NULL;
+		hs->deletedCount = 0;
+	}
+#endif
 }
 
 // DynamicTree: scalars + full nodeCapacity nodes (freeList chains through free slots)
@@ -321,6 +360,14 @@ static void b2SerTree( b2RecBuffer* buf, const b2DynamicTree* tree )
 	if ( tree->nodeCapacity > 0 )
 	{
 		b2SnapW_Bytes( buf, tree->nodes, tree->nodeCapacity * (int)sizeof( b2TreeNode ) );
+		b2SnapW_Bytes( buf, tree->nodeData, tree->nodeCapacity * (int)sizeof( b2TreeNodeData ) );
+	}
+
+	// The wide tree changes the query order, so it is restored as well
+	b2SnapW_I32( buf, tree->wideNodeCount );
+	if ( tree->wideNodeCount > 0 )
+	{
+		b2SnapW_Bytes( buf, tree->wideNodes, tree->wideNodeCount * (int)sizeof( b2TreeNode4 ) );
 	}
 }
 
@@ -332,7 +379,8 @@ static void b2DesTree( b2SnapReader* r, b2DynamicTree* tree )
 	int freeList = b2SnapR_I32( r );
 	int proxyCount = b2SnapR_I32( r );
 
-	if ( r->ok && b2SnapCheckCount( r, nodeCapacity, (int)sizeof( b2TreeNode ), (int)sizeof( b2TreeNode ) ) == false )
+	if ( r->ok && b2SnapCheckCount( r, nodeCapacity, (int)sizeof( b2TreeNode ) + (int)sizeof( b2TreeNodeData ),
+									 (int)sizeof( b2TreeNode ) + (int)sizeof( b2TreeNodeData ) ) == false )
 	{
 		r->ok = false;
 	}
@@ -341,17 +389,23 @@ static void b2DesTree( b2SnapReader* r, b2DynamicTree* tree )
 	// rebuild scratch, so free that too. Null everything so a failure here leaves the tree
 	// safe to destroy.
 	b2Free( tree->nodes, tree->nodeCapacity * (int)sizeof( b2TreeNode ) );
+	b2Free( tree->nodeData, tree->nodeCapacity * (int)sizeof( b2TreeNodeData ) );
 	b2Free( tree->leafIndices, tree->rebuildCapacity * (int)sizeof( int ) );
 	b2Free( tree->leafBoxes, tree->rebuildCapacity * (int)sizeof( b2AABB ) );
 	b2Free( tree->leafCenters, tree->rebuildCapacity * (int)sizeof( b2Vec2 ) );
 	b2Free( tree->binIndices, tree->rebuildCapacity * (int)sizeof( int ) );
+	b2Free( tree->wideNodes, tree->wideNodeCapacity * (int)sizeof( b2TreeNode4 ) );
 	tree->nodes = NULL;
+	tree->nodeData = NULL;
 	tree->leafIndices = NULL;
 	tree->leafBoxes = NULL;
 	tree->leafCenters = NULL;
 	tree->binIndices = NULL;
+	tree->wideNodes = NULL;
 	tree->nodeCapacity = 0;
 	tree->rebuildCapacity = 0;
+	tree->wideNodeCount = 0;
+	tree->wideNodeCapacity = 0;
 
 	if ( !r->ok )
 	{
@@ -368,6 +422,22 @@ static void b2DesTree( b2SnapReader* r, b2DynamicTree* tree )
 	{
 		tree->nodes = b2Alloc( nodeCapacity * (int)sizeof( b2TreeNode ) );
 		b2SnapR_Bytes( r, tree->nodes, nodeCapacity * (int)sizeof( b2TreeNode ) );
+		tree->nodeData = b2Alloc( nodeCapacity * (int)sizeof( b2TreeNodeData ) );
+		b2SnapR_Bytes( r, tree->nodeData, nodeCapacity * (int)sizeof( b2TreeNodeData ) );
+	}
+
+	int wideNodeCount = b2SnapR_I32( r );
+	if ( r->ok && b2SnapCheckCount( r, wideNodeCount, (int)sizeof( b2TreeNode4 ), (int)sizeof( b2TreeNode4 ) ) == false )
+	{
+		r->ok = false;
+	}
+
+	if ( r->ok && wideNodeCount > 0 )
+	{
+		tree->wideNodes = b2Alloc( wideNodeCount * (int)sizeof( b2TreeNode4 ) );
+		tree->wideNodeCapacity = wideNodeCount;
+		b2SnapR_Bytes( r, tree->wideNodes, wideNodeCount * (int)sizeof( b2TreeNode4 ) );
+		tree->wideNodeCount = wideNodeCount;
 	}
 }
 
@@ -411,7 +481,7 @@ static void b2DesGraphColor( b2SnapReader* r, b2GraphColor* color, bool isOverfl
 	}
 	b2DesPodArray( r, color->contactSims );
 	b2DesPodArray( r, color->jointSims );
-	// Transient wideConstraints/overflowConstraints stay NULL, wideConstraintCount 0
+	// Wide constraints are not serialized, the restore forces a full prepare
 }
 
 // World scalar config (simulation settings only, no runtime/shell fields)
@@ -485,10 +555,11 @@ void b2SerializeWorld( b2World* world, b2RecBuffer* buf )
 	// World config
 	b2SerWorldConfig( buf, world );
 
-	// 7 id pools
+	// 8 id pools
 	b2SerIdPool( buf, &world->bodyIdPool );
 	b2SerIdPool( buf, &world->shapeIdPool );
 	b2SerIdPool( buf, &world->chainIdPool );
+	b2SerIdPool( buf, &world->geometryIdPool );
 	b2SerIdPool( buf, &world->contactIdPool );
 	b2SerIdPool( buf, &world->jointIdPool );
 	b2SerIdPool( buf, &world->islandIdPool );
@@ -506,6 +577,7 @@ void b2SerializeWorld( b2World* world, b2RecBuffer* buf )
 	// Contacts have no userData, so they go out as raw POD.
 	b2SerSimArray( buf, world->bodies, b2Body );
 	b2SerSimArray( buf, world->shapes, b2Shape );
+	b2SerPodArray( buf, world->shapeSims );
 	b2SerPodArray( buf, world->contacts );
 	b2SerSimArray( buf, world->joints, b2Joint );
 
@@ -530,6 +602,57 @@ void b2SerializeWorld( b2World* world, b2RecBuffer* buf )
 		}
 	}
 
+	// Polygon geometry: POD scalars then the polygon for each live slot. Shapes keep their geometry index.
+	int geometryCount = world->geometries.count;
+	b2SnapW_I32( buf, geometryCount );
+	for ( int i = 0; i < geometryCount; ++i )
+	{
+		b2Geometry* geometry = world->geometries.data + i;
+		b2SnapW_I32( buf, geometry->id );
+		b2SnapW_I32( buf, geometry->refCount );
+		b2SnapW_Bytes( buf, &geometry->generation, sizeof( uint16_t ) );
+		b2SnapW_Bytes( buf, &geometry->userReference, sizeof( bool ) );
+		if ( geometry->id != B2_NULL_INDEX )
+		{
+			b2SnapW_Bytes( buf, world->polygons.data + i, sizeof( b2Polygon ) );
+		}
+	}
+
+	// Mesh and heightfield shapes: counts then the owned arrays for each live shape
+	for ( int i = 0; i < world->shapes.count; ++i )
+	{
+		b2ShapeSim* shape = world->shapeSims.data + i;
+		if ( world->shapes.data[i].id == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		if ( shape->type == b2_meshShape )
+		{
+			b2MeshShape* mesh = shape->mesh;
+			b2SnapW_I32( buf, mesh->segmentCount );
+			b2SnapW_I32( buf, mesh->nodeCount );
+			b2SnapW_Bytes( buf, mesh->segments, mesh->segmentCount * (int)sizeof( b2ChainSegment ) );
+			b2SnapW_Bytes( buf, mesh->nodes, mesh->nodeCount * (int)sizeof( b2MeshNode ) );
+		}
+		else if ( shape->type == b2_heightFieldShape )
+		{
+			b2HeightFieldShape* heightField = shape->heightField;
+			b2SnapW_I32( buf, heightField->count );
+			b2SnapW_I32( buf, heightField->materialCount );
+			b2SnapW_Bytes( buf, &heightField->spacing, sizeof( float ) );
+			b2SnapW_Bytes( buf, &heightField->inverseSpacing, sizeof( float ) );
+			b2SnapW_Bytes( buf, &heightField->minHeight, sizeof( float ) );
+			b2SnapW_Bytes( buf, &heightField->maxHeight, sizeof( float ) );
+			b2SnapW_Bytes( buf, heightField->heights, heightField->count * (int)sizeof( float ) );
+			if ( heightField->materialCount > 0 )
+			{
+				b2SnapW_Bytes( buf, heightField->materials, heightField->materialCount * (int)sizeof( b2SurfaceMaterial ) );
+				b2SnapW_Bytes( buf, heightField->materialIndices, heightField->count - 1 );
+			}
+		}
+	}
+
 	// Sensors: shapeId + 3 visitor arrays per slot
 	int sensorCount = world->sensors.count;
 	b2SnapW_I32( buf, sensorCount );
@@ -569,6 +692,10 @@ void b2SerializeWorld( b2World* world, b2RecBuffer* buf )
 	}
 	b2SerPodArray( buf, bp->moveArray );
 	b2SerHashSet( buf, &bp->pairSet );
+	// The pair order depends on the algorithm
+	b2SnapW_I32( buf, bp->type );
+	b2SnapW_Bytes( buf, &bp->gridCellSize, sizeof( float ) );
+	b2SnapW_I32( buf, bp->newPairCount );
 
 	// Constraint graph: B2_GRAPH_COLOR_COUNT colors
 	b2ConstraintGraph* graph = &world->constraintGraph;
@@ -583,6 +710,15 @@ void b2SerializeWorld( b2World* world, b2RecBuffer* buf )
 // Mirrors the per-object teardown in b2DestroyWorld.
 static void b2FreeLiveSimElements( b2World* world )
 {
+	for ( int i = 0; i < world->shapes.count; ++i )
+	{
+		b2Shape* shape = world->shapes.data + i;
+		if ( shape->id != B2_NULL_INDEX )
+		{
+			b2FreeShapeData( world, world->shapeSims.data + i );
+		}
+	}
+
 	for ( int i = 0; i < world->chainShapes.count; ++i )
 	{
 		b2ChainShape* chain = world->chainShapes.data + i;
@@ -619,10 +755,11 @@ static bool b2DeserializeIntoShell( b2SnapReader* r, b2World* world )
 	// Step 1: world scalars
 	b2DesWorldConfig( r, world );
 
-	// Step 2: 7 id pools (overwrite entirely, including solverSetIdPool from the 3 pre-created sets)
+	// Step 2: 8 id pools (overwrite entirely, including solverSetIdPool from the 3 pre-created sets)
 	b2DesIdPool( r, &world->bodyIdPool );
 	b2DesIdPool( r, &world->shapeIdPool );
 	b2DesIdPool( r, &world->chainIdPool );
+	b2DesIdPool( r, &world->geometryIdPool );
 	b2DesIdPool( r, &world->contactIdPool );
 	b2DesIdPool( r, &world->jointIdPool );
 	b2DesIdPool( r, &world->islandIdPool );
@@ -664,6 +801,34 @@ static bool b2DeserializeIntoShell( b2SnapReader* r, b2World* world )
 	// it cleanly with no host pointers to scrub here.
 	b2DesPodArray( r, world->bodies );
 	b2DesPodArray( r, world->shapes );
+	b2DesPodArray( r, world->shapeSims );
+
+	// The polygon, mesh and heightfield pointers are stale. Clear them so a failed read never frees them.
+	for ( int i = 0; i < world->shapeSims.count; ++i )
+	{
+		b2ShapeSim* shape = world->shapeSims.data + i;
+		if ( shape->type == b2_polygonShape )
+		{
+			shape->polygon = NULL;
+		}
+		else if ( shape->type == b2_meshShape )
+		{
+			shape->mesh = NULL;
+		}
+		else if ( shape->type == b2_heightFieldShape )
+		{
+			shape->heightField = NULL;
+		}
+	}
+
+	// The shape arrays are parallel. Drop both on a mismatch so teardown never indexes past the sims.
+	if ( world->shapes.count != world->shapeSims.count )
+	{
+		r->ok = false;
+		world->shapes.count = 0;
+		world->shapeSims.count = 0;
+	}
+
 	b2DesPodArray( r, world->contacts );
 	b2DesPodArray( r, world->joints );
 
@@ -719,6 +884,123 @@ static bool b2DeserializeIntoShell( b2SnapReader* r, b2World* world )
 		}
 	}
 
+	// Step 5b: polygon geometry
+	{
+		// Each geometry writes 2 ints, a uint16 generation, and a bool
+		int geometryCount = b2SnapR_I32( r );
+		if ( r->ok && b2SnapCheckCount( r, geometryCount, (int)sizeof( b2Geometry ),
+										 2 * (int)sizeof( int ) + (int)sizeof( uint16_t ) + (int)sizeof( bool ) ) == false )
+		{
+			r->ok = false;
+		}
+		if ( r->ok )
+		{
+			b2Array_Resize( world->geometries, geometryCount );
+			b2Array_Resize( world->polygons, geometryCount );
+			// Zero the whole arrays so free slots are clean
+			memset( world->geometries.data, 0, geometryCount * sizeof( b2Geometry ) );
+			memset( world->polygons.data, 0, geometryCount * sizeof( b2Polygon ) );
+		}
+
+		for ( int i = 0; i < geometryCount && r->ok; ++i )
+		{
+			b2Geometry* geometry = world->geometries.data + i;
+			geometry->id = b2SnapR_I32( r );
+			geometry->refCount = b2SnapR_I32( r );
+			b2SnapR_Bytes( r, &geometry->generation, sizeof( uint16_t ) );
+			b2SnapR_Bytes( r, &geometry->userReference, sizeof( bool ) );
+			if ( r->ok && geometry->id != B2_NULL_INDEX )
+			{
+				if ( geometry->id != i || geometry->refCount <= 0 ||
+					 b2SnapCheckCount( r, 1, (int)sizeof( b2Polygon ), (int)sizeof( b2Polygon ) ) == false )
+				{
+					r->ok = false;
+					break;
+				}
+
+				b2SnapR_Bytes( r, world->polygons.data + i, sizeof( b2Polygon ) );
+			}
+		}
+
+		// Relink polygon shapes to their geometry
+		for ( int i = 0; i < world->shapes.count && r->ok; ++i )
+		{
+			b2ShapeSim* shape = world->shapeSims.data + i;
+			if ( world->shapes.data[i].id == B2_NULL_INDEX || shape->type != b2_polygonShape )
+			{
+				continue;
+			}
+
+			// Every polygon shape references a geometry
+			int geometryId = shape->geometryId;
+			if ( geometryId < 0 || geometryCount <= geometryId || world->geometries.data[geometryId].id != geometryId )
+			{
+				r->ok = false;
+				break;
+			}
+
+			shape->polygon = world->polygons.data + geometryId;
+		}
+	}
+
+	// Step 5c: mesh and heightfield shapes, in the same live shape order as the writer
+	for ( int i = 0; i < world->shapes.count && r->ok; ++i )
+	{
+		b2ShapeSim* shape = world->shapeSims.data + i;
+		if ( world->shapes.data[i].id == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		if ( shape->type == b2_heightFieldShape )
+		{
+			int count = b2SnapR_I32( r );
+			int materialCount = b2SnapR_I32( r );
+			if ( r->ok == false || count < 2 || materialCount < 0 || materialCount > 256 ||
+				 b2SnapCheckCount( r, count, (int)sizeof( float ), (int)sizeof( float ) ) == false ||
+				 b2SnapCheckCount( r, materialCount, (int)sizeof( b2SurfaceMaterial ), (int)sizeof( b2SurfaceMaterial ) ) ==
+					 false )
+			{
+				r->ok = false;
+				break;
+			}
+
+			b2HeightFieldShape* heightField = b2AllocHeightFieldShapeData( count, materialCount );
+			shape->heightField = heightField;
+			b2SnapR_Bytes( r, &heightField->spacing, sizeof( float ) );
+			b2SnapR_Bytes( r, &heightField->inverseSpacing, sizeof( float ) );
+			b2SnapR_Bytes( r, &heightField->minHeight, sizeof( float ) );
+			b2SnapR_Bytes( r, &heightField->maxHeight, sizeof( float ) );
+			b2SnapR_Bytes( r, heightField->heights, count * (int)sizeof( float ) );
+			if ( materialCount > 0 )
+			{
+				b2SnapR_Bytes( r, heightField->materials, materialCount * (int)sizeof( b2SurfaceMaterial ) );
+				b2SnapR_Bytes( r, heightField->materialIndices, count - 1 );
+			}
+			continue;
+		}
+
+		if ( shape->type != b2_meshShape )
+		{
+			continue;
+		}
+
+		int segmentCount = b2SnapR_I32( r );
+		int nodeCount = b2SnapR_I32( r );
+		if ( r->ok == false || segmentCount <= 0 || nodeCount <= 0 ||
+			 b2SnapCheckCount( r, segmentCount, (int)sizeof( b2ChainSegment ), (int)sizeof( b2ChainSegment ) ) == false ||
+			 b2SnapCheckCount( r, nodeCount, (int)sizeof( b2MeshNode ), (int)sizeof( b2MeshNode ) ) == false )
+		{
+			r->ok = false;
+			break;
+		}
+
+		b2MeshShape* mesh = b2AllocMeshShapeData( segmentCount, nodeCount );
+		b2SnapR_Bytes( r, mesh->segments, segmentCount * (int)sizeof( b2ChainSegment ) );
+		b2SnapR_Bytes( r, mesh->nodes, nodeCount * (int)sizeof( b2MeshNode ) );
+		shape->mesh = mesh;
+	}
+
 	// Step 6: sensors
 	{
 		// Destroy the shell's sensors array
@@ -810,6 +1092,15 @@ static bool b2DeserializeIntoShell( b2SnapReader* r, b2World* world )
 		// pairSet
 		b2DesHashSet( r, &bp->pairSet );
 
+		int type = b2SnapR_I32( r );
+		if ( r->ok && ( type < b2_treeBroadPhase || type > b2_gridBroadPhase ) )
+		{
+			r->ok = false;
+		}
+		bp->type = (b2BroadPhaseType)type;
+		b2SnapR_Bytes( r, &bp->gridCellSize, sizeof( float ) );
+		bp->newPairCount = b2MaxInt( 0, b2SnapR_I32( r ) );
+
 		// Transient move results stay at shell's NULL/0
 	}
 
@@ -820,6 +1111,9 @@ static bool b2DeserializeIntoShell( b2SnapReader* r, b2World* world )
 		{
 			b2DesGraphColor( r, &graph->colors[c], c == B2_OVERFLOW_INDEX );
 		}
+
+		// The persistent wide constraints belong to the previous contents
+		graph->preparedH = 0.0f;
 	}
 
 	return r->ok;
@@ -2,12 +2,16 @@
 // SPDX-License-Identifier: MIT
 
 #include "determinism.h"
+#include "physics_world.h"
+#include "recording.h"
 #include "test_macros.h"
 
 #include "box2d/box2d.h"
 #include "box2d/types.h"
 
+#include <float.h>
 #include <stdio.h>
+#include <string.h>
 
 #ifdef BOX2D_PROFILE
 #include <tracy/TracyC.h>
@@ -78,18 +82,74 @@ static int MultithreadingTest( void )
 	return 0;
 }
 
-// Test determinism using the built-in scheduler (no external task system).
+// Test determinism using the built-in schedulers (no external task system).
 static int BuiltInSchedulerTest( void )
 {
-	for ( int workerCount = 2; workerCount <= 8; workerCount += 2 )
+	b2SchedulerType schedulerTypes[] = { b2_workStealingScheduler, b2_sharedTableScheduler };
+
+	for ( int typeIndex = 0; typeIndex < 2; ++typeIndex )
+	{
+		for ( int workerCount = 2; workerCount <= 8; workerCount += 2 )
+		{
+			b2WorldDef worldDef = b2DefaultWorldDef();
+			worldDef.workerCount = workerCount;
+			worldDef.schedulerType = schedulerTypes[typeIndex];
+
+			b2WorldId worldId = b2CreateWorld( &worldDef );
+
+			FallingHingeData data = CreateFallingHinges( worldId );
+
+			float timeStep = 1.0f / 60.0f;
+			int stepLimit = 1000;
+			for ( int i = 0; i < stepLimit; ++i )
+			{
+				int subStepCount = 4;
+				b2World_Step( worldId, timeStep, subStepCount );
+
+				bool done = UpdateFallingHinges( worldId, &data );
+				if ( done )
+				{
+					break;
+				}
+			}
+
+			b2DestroyWorld( worldId );
+
+			if ( data.sleepStep != EXPECTED_SLEEP_STEP || data.hash != EXPECTED_HASH )
+			{
+				printf( "  built-in scheduler type=%d workers=%d sleepStep=%d hash=0x%08X\n", typeIndex, workerCount,
+						data.sleepStep, data.hash );
+			}
+
+			ENSURE( data.sleepStep == EXPECTED_SLEEP_STEP );
+			ENSURE( data.hash == EXPECTED_HASH );
+
+			DestroyFallingHinges( &data );
+		}
+	}
+
+	return 0;
+}
+
+// Each idle policy must give the same result and report sane per worker idle times
+static int IdlePolicyTest( void )
+{
+	b2IdlePolicy policies[] = { b2_idleSpinThenPark, b2_idleSpinThenYield, b2_idleSpin };
+
+	for ( int policyIndex = 0; policyIndex < 3; ++policyIndex )
 	{
+		int workerCount = 4;
 		b2WorldDef worldDef = b2DefaultWorldDef();
 		worldDef.workerCount = workerCount;
+		worldDef.idlePolicy = policies[policyIndex];
+		worldDef.idleSpinCount = 100 * policyIndex;
 
 		b2WorldId worldId = b2CreateWorld( &worldDef );
 
 		FallingHingeData data = CreateFallingHinges( worldId );
 
+		float totalSpin = 0.0f;
+		float totalPark = 0.0f;
 		float timeStep = 1.0f / 60.0f;
 		int stepLimit = 1000;
 		for ( int i = 0; i < stepLimit; ++i )
@@ -97,6 +157,21 @@ static int BuiltInSchedulerTest( void )
 			int subStepCount = 4;
 			b2World_Step( worldId, timeStep, subStepCount );
 
+			b2Profile profile = b2World_GetProfile( worldId );
+			for ( int j = 0; j < B2_MAX_WORKERS; ++j )
+			{
+				ENSURE( profile.workerSpin[j] >= 0.0f );
+				ENSURE( profile.workerPark[j] >= 0.0f );
+
+				if ( j >= workerCount )
+				{
+					ENSURE( profile.workerSpin[j] == 0.0f && profile.workerPark[j] == 0.0f );
+				}
+
+				totalSpin += profile.workerSpin[j];
+				totalPark += profile.workerPark[j];
+			}
+
 			bool done = UpdateFallingHinges( worldId, &data );
 			if ( done )
 			{
@@ -106,10 +181,9 @@ static int BuiltInSchedulerTest( void )
 
 		b2DestroyWorld( worldId );
 
-		if ( data.sleepStep != EXPECTED_SLEEP_STEP || data.hash != EXPECTED_HASH )
-		{
-			printf( "  built-in scheduler workers=%d sleepStep=%d hash=0x%08X\n", workerCount, data.sleepStep, data.hash );
-		}
+		// Only the park policy may park
+		ENSURE( totalSpin > 0.0f );
+		ENSURE( policies[policyIndex] == b2_idleSpinThenPark || totalPark == 0.0f );
 
 		ENSURE( data.sleepStep == EXPECTED_SLEEP_STEP );
 		ENSURE( data.hash == EXPECTED_HASH );
@@ -155,11 +229,843 @@ static int CrossPlatformTest( void )
 	return 0;
 }
 
+#define WIDE_JOINT_COLUMNS 12
+#define WIDE_JOINT_LINKS 10
+
+static void SetChainJointBase( b2JointDef* base, b2BodyId bodyIdA, b2BodyId bodyIdB, b2Vec2 localAnchorA, float threshold )
+{
+	base->bodyIdA = bodyIdA;
+	base->bodyIdB = bodyIdB;
+	base->localFrameA.p = localAnchorA;
+	base->localFrameB.p = (b2Vec2){ -0.4f, 0.0f };
+	base->forceThreshold = threshold;
+	base->torqueThreshold = threshold;
+}
+
+// Chains that mix revolute, weld, and prismatic joints. A finite event threshold keeps a joint out of the
+// wide joint solver, so the thresholds select between the wide and scalar paths.
+static void SimulateJointChains( int workerCount, float threshold, b2Transform* transforms )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = workerCount;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+	b2Polygon box = b2MakeBox( 0.4f, 0.1f );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	b2BodyId bodyIds[WIDE_JOINT_COLUMNS * WIDE_JOINT_LINKS];
+	int bodyCount = 0;
+
+	for ( int i = 0; i < WIDE_JOINT_COLUMNS; ++i )
+	{
+		float x = 3.0f * i;
+		b2BodyId prevId = groundId;
+		b2Vec2 prevAnchor = { x, 20.0f };
+
+		for ( int j = 0; j < WIDE_JOINT_LINKS; ++j )
+		{
+			bodyDef.type = b2_dynamicBody;
+			bodyDef.position = (b2Vec2){ x + 0.8f * j + 0.4f, 20.0f };
+			b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( bodyId, &shapeDef, &box );
+			bodyIds[bodyCount++] = bodyId;
+
+			b2Vec2 localAnchorA = b2Body_GetLocalPoint( prevId, prevAnchor );
+
+			int type = ( i + j ) % 3;
+			if ( type == 0 )
+			{
+				b2RevoluteJointDef jointDef = b2DefaultRevoluteJointDef();
+				SetChainJointBase( &jointDef.base, prevId, bodyId, localAnchorA, threshold );
+				jointDef.enableLimit = j % 2 == 1;
+				jointDef.lowerAngle = -0.25f * B2_PI;
+				jointDef.upperAngle = 0.1f * B2_PI;
+				jointDef.enableMotor = j % 3 == 0;
+				jointDef.maxMotorTorque = 5.0f;
+				jointDef.motorSpeed = 0.5f;
+				b2CreateRevoluteJoint( worldId, &jointDef );
+			}
+			else if ( type == 1 )
+			{
+				b2WeldJointDef jointDef = b2DefaultWeldJointDef();
+				SetChainJointBase( &jointDef.base, prevId, bodyId, localAnchorA, threshold );
+				jointDef.linearHertz = j % 2 == 0 ? 5.0f : 0.0f;
+				jointDef.angularHertz = j % 3 == 0 ? 2.0f : 0.0f;
+				jointDef.linearDampingRatio = 0.5f;
+				jointDef.angularDampingRatio = 0.7f;
+				b2CreateWeldJoint( worldId, &jointDef );
+			}
+			else
+			{
+				b2PrismaticJointDef jointDef = b2DefaultPrismaticJointDef();
+				SetChainJointBase( &jointDef.base, prevId, bodyId, localAnchorA, threshold );
+				jointDef.base.localFrameA.q = b2MakeRot( 0.25f * B2_PI * ( j % 4 ) );
+				jointDef.base.localFrameB.q = jointDef.base.localFrameA.q;
+				jointDef.enableSpring = j % 2 == 0;
+				jointDef.hertz = 2.0f;
+				jointDef.dampingRatio = 0.5f;
+				jointDef.enableLimit = true;
+				jointDef.lowerTranslation = -0.2f;
+				jointDef.upperTranslation = 0.3f;
+				jointDef.enableMotor = j % 3 == 1;
+				jointDef.maxMotorForce = 20.0f;
+				jointDef.motorSpeed = -1.0f;
+				b2CreatePrismaticJoint( worldId, &jointDef );
+			}
+
+			prevId = bodyId;
+			prevAnchor = (b2Vec2){ x + 0.8f * ( j + 1 ), 20.0f };
+		}
+	}
+
+	float timeStep = 1.0f / 60.0f;
+	for ( int i = 0; i < 90; ++i )
+	{
+		b2World_Step( worldId, timeStep, 4 );
+	}
+
+	for ( int i = 0; i < bodyCount; ++i )
+	{
+		transforms[i] = b2Body_GetTransform( bodyIds[i] );
+	}
+
+	b2DestroyWorld( worldId );
+}
+
+// The wide joint solver must match the scalar joint solver bit for bit
+static int WideJointTest( void )
+{
+	b2Transform scalarTransforms[WIDE_JOINT_COLUMNS * WIDE_JOINT_LINKS];
+	b2Transform wideTransforms[WIDE_JOINT_COLUMNS * WIDE_JOINT_LINKS];
+
+	SimulateJointChains( 1, 1.0e30f, scalarTransforms );
+
+	int workerCounts[] = { 1, 4 };
+	for ( int i = 0; i < 2; ++i )
+	{
+		SimulateJointChains( workerCounts[i], FLT_MAX, wideTransforms );
+
+		// The chains should have moved
+		ENSURE( wideTransforms[0].p.y < 20.0f );
+
+		ENSURE( memcmp( scalarTransforms, wideTransforms, sizeof( wideTransforms ) ) == 0 );
+	}
+
+	return 0;
+}
+
+// Falling boxes hit by bullets inside a large sensor. This covers both pipelined step fences.
+static b2WorldId CreatePipelineScene( bool enablePipelinedStep )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	worldDef.enablePipelinedStep = enablePipelinedStep;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon groundBox = b2MakeOffsetBox( 40.0f, 1.0f, (b2Vec2){ 0.0f, -1.0f }, b2Rot_identity );
+	b2CreatePolygonShape( groundId, &shapeDef, &groundBox );
+
+	b2ShapeDef sensorDef = b2DefaultShapeDef();
+	sensorDef.isSensor = true;
+	sensorDef.enableSensorEvents = true;
+	b2Polygon sensorBox = b2MakeOffsetBox( 10.0f, 4.0f, (b2Vec2){ 0.0f, 4.0f }, b2Rot_identity );
+	b2CreatePolygonShape( groundId, &sensorDef, &sensorBox );
+
+	shapeDef.enableSensorEvents = true;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	bodyDef.type = b2_dynamicBody;
+	for ( int i = 0; i < 20; ++i )
+	{
+		for ( int j = 0; j < 10; ++j )
+		{
+			bodyDef.position = (b2Vec2){ -10.0f + 1.1f * i, 1.0f + 1.2f * j };
+			b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( bodyId, &shapeDef, &box );
+		}
+	}
+
+	bodyDef.isBullet = true;
+	b2Circle circle = { { 0.0f, 0.0f }, 0.25f };
+	for ( int i = 0; i < 4; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -30.0f, 2.0f + 3.0f * i };
+		bodyDef.linearVelocity = (b2Vec2){ 200.0f, 0.0f };
+		b2BodyId bulletId = b2CreateBody( worldId, &bodyDef );
+		b2CreateCircleShape( bulletId, &shapeDef, &circle );
+	}
+
+	return worldId;
+}
+
+// The pipelined step must give the same results as the regular step
+static int PipelinedStepTest( void )
+{
+	b2WorldId worldIdA = CreatePipelineScene( false );
+	b2WorldId worldIdB = CreatePipelineScene( true );
+	b2World* worldA = b2GetWorldFromId( worldIdA );
+	b2World* worldB = b2GetWorldFromId( worldIdB );
+
+	int sensorEventCount = 0;
+	float timeStep = 1.0f / 60.0f;
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldIdA, timeStep, 4 );
+		b2World_Step( worldIdB, timeStep, 4 );
+
+		ENSURE( b2HashWorldState( worldA ) == b2HashWorldState( worldB ) );
+
+		for ( int j = 0; j < b2_bodyTypeCount; ++j )
+		{
+			const b2DynamicTree* treeA = worldA->broadPhase.trees + j;
+			const b2DynamicTree* treeB = worldB->broadPhase.trees + j;
+			ENSURE( b2DynamicTree_GetHeight( treeA ) == b2DynamicTree_GetHeight( treeB ) );
+			ENSURE( b2DynamicTree_GetAreaRatio( treeA ) == b2DynamicTree_GetAreaRatio( treeB ) );
+		}
+
+		b2SensorEvents eventsA = b2World_GetSensorEvents( worldIdA );
+		b2SensorEvents eventsB = b2World_GetSensorEvents( worldIdB );
+		ENSURE( eventsA.beginCount == eventsB.beginCount );
+		ENSURE( eventsA.endCount == eventsB.endCount );
+		sensorEventCount += eventsA.beginCount + eventsA.endCount;
+	}
+
+	ENSURE( sensorEventCount > 0 );
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+
+	return 0;
+}
+
+// Many static boxes of different sizes for the static tree rebuild
+static b2WorldId CreateStaticScene( int workerCount )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = workerCount;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	for ( int i = 0; i < 60; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 3.0f * i, 0.0f };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+
+		for ( int j = 0; j < 50; ++j )
+		{
+			float h = 0.1f + 0.05f * ( ( i * 7 + j * 3 ) % 11 );
+			b2Polygon box = b2MakeOffsetBox( h, h, (b2Vec2){ 0.2f * ( j % 7 ), 1.5f * j }, b2Rot_identity );
+			b2CreatePolygonShape( bodyId, &shapeDef, &box );
+		}
+	}
+
+	return worldId;
+}
+
+// The static tree rebuild is split across workers and must give the same tree as the serial rebuild
+static int StaticTreeRebuildTest( void )
+{
+	b2WorldId worldIdA = CreateStaticScene( 1 );
+	b2WorldId worldIdB = CreateStaticScene( 4 );
+
+	b2World_RebuildStaticTree( worldIdA );
+	b2World_RebuildStaticTree( worldIdB );
+
+	b2World* worldA = b2GetWorldFromId( worldIdA );
+	b2World* worldB = b2GetWorldFromId( worldIdB );
+	const b2DynamicTree* treeA = worldA->broadPhase.trees + b2_staticBody;
+	const b2DynamicTree* treeB = worldB->broadPhase.trees + b2_staticBody;
+
+	ENSURE( treeA->proxyCount == 3000 );
+	ENSURE( treeA->root == treeB->root );
+	ENSURE( treeA->nodeCapacity == treeB->nodeCapacity );
+	ENSURE( memcmp( treeA->nodes, treeB->nodes, treeA->nodeCapacity * sizeof( b2TreeNode ) ) == 0 );
+	ENSURE( memcmp( treeA->nodeData, treeB->nodeData, treeA->nodeCapacity * sizeof( b2TreeNodeData ) ) == 0 );
+
+	b2World_Step( worldIdA, 1.0f / 60.0f, 4 );
+	b2World_Step( worldIdB, 1.0f / 60.0f, 4 );
+	ENSURE( b2HashWorldState( worldA ) == b2HashWorldState( worldB ) );
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+
+	return 0;
+}
+
+// Debris falling on a bumpy ground so many contacts begin and end touching each step
+static b2WorldId CreateDebrisScene( int workerCount, b2BroadPhaseType broadPhaseType, int contactSimdWidth )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = workerCount;
+	worldDef.broadPhaseType = broadPhaseType;
+	worldDef.contactSimdWidth = contactSimdWidth;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enableContactEvents = true;
+	for ( int i = 0; i < 40; ++i )
+	{
+		b2Polygon bump = b2MakeOffsetBox( 0.5f, 0.25f + 0.25f * ( i % 3 ), (b2Vec2){ -40.0f + 2.0f * i, 0.0f }, b2Rot_identity );
+		b2CreatePolygonShape( groundId, &shapeDef, &bump );
+	}
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.2f, 0.15f );
+	b2Circle circle = { { 0.0f, 0.0f }, 0.2f };
+	for ( int i = 0; i < 60; ++i )
+	{
+		for ( int j = 0; j < 12; ++j )
+		{
+			bodyDef.position = (b2Vec2){ -30.0f + 1.0f * i + 0.1f * ( j % 3 ), 3.0f + 0.6f * j };
+			bodyDef.linearVelocity = (b2Vec2){ 2.0f * ( ( i + j ) % 5 ) - 4.0f, 0.0f };
+			b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+			if ( ( i + j ) % 2 == 0 )
+			{
+				b2CreatePolygonShape( bodyId, &shapeDef, &box );
+			}
+			else
+			{
+				b2CreateCircleShape( bodyId, &shapeDef, &circle );
+			}
+		}
+	}
+
+	return worldId;
+}
+
+// Contact state changes are classified in parallel. The contact events must come out in the same
+// order for any worker count.
+static int ContactEventOrderTest( void )
+{
+	b2WorldId worldIdA = CreateDebrisScene( 1, b2_treeBroadPhase, 0 );
+	b2WorldId worldIdB = CreateDebrisScene( 4, b2_treeBroadPhase, 0 );
+	b2World* worldA = b2GetWorldFromId( worldIdA );
+	b2World* worldB = b2GetWorldFromId( worldIdB );
+
+	int beginCount = 0;
+	int endCount = 0;
+	float timeStep = 1.0f / 60.0f;
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldIdA, timeStep, 4 );
+		b2World_Step( worldIdB, timeStep, 4 );
+
+		ENSURE( b2HashWorldState( worldA ) == b2HashWorldState( worldB ) );
+
+		b2ContactEvents eventsA = b2World_GetContactEvents( worldIdA );
+		b2ContactEvents eventsB = b2World_GetContactEvents( worldIdB );
+		ENSURE( eventsA.beginCount == eventsB.beginCount );
+		ENSURE( eventsA.endCount == eventsB.endCount );
+
+		// The worlds have different ids
+		for ( int j = 0; j < eventsA.beginCount; ++j )
+		{
+			b2ContactBeginTouchEvent* a = eventsA.beginEvents + j;
+			b2ContactBeginTouchEvent* b = eventsB.beginEvents + j;
+			ENSURE( a->shapeIdA.index1 == b->shapeIdA.index1 && a->shapeIdB.index1 == b->shapeIdB.index1 );
+			ENSURE( a->contactId.index1 == b->contactId.index1 && a->contactId.generation == b->contactId.generation );
+		}
+
+		for ( int j = 0; j < eventsA.endCount; ++j )
+		{
+			b2ContactEndTouchEvent* a = eventsA.endEvents + j;
+			b2ContactEndTouchEvent* b = eventsB.endEvents + j;
+			ENSURE( a->shapeIdA.index1 == b->shapeIdA.index1 && a->shapeIdB.index1 == b->shapeIdB.index1 );
+			ENSURE( a->contactId.index1 == b->contactId.index1 && a->contactId.generation == b->contactId.generation );
+		}
+
+		beginCount += eventsA.beginCount;
+		endCount += eventsA.endCount;
+	}
+
+	ENSURE( beginCount > 2000 );
+	ENSURE( endCount > 1000 );
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+
+	return 0;
+}
+
+// The grid broad-phase must find the same pairs as the tree broad-phase, including shapes that are too
+// large for the grid and kinematic shapes
+static int GridBroadPhasePairTest( void )
+{
+	b2WorldId worldIds[2];
+	for ( int k = 0; k < 2; ++k )
+	{
+		b2WorldDef worldDef = b2DefaultWorldDef();
+		worldDef.broadPhaseType = k == 0 ? b2_treeBroadPhase : b2_gridBroadPhase;
+		worldIds[k] = b2CreateWorld( &worldDef );
+
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		b2BodyId groundId = b2CreateBody( worldIds[k], &bodyDef );
+		b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+		b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+		bodyDef.type = b2_kinematicBody;
+		bodyDef.position = (b2Vec2){ 5.0f, 2.0f };
+		b2BodyId kinematicId = b2CreateBody( worldIds[k], &bodyDef );
+		b2Polygon platform = b2MakeBox( 3.0f, 0.2f );
+		b2CreatePolygonShape( kinematicId, &shapeDef, &platform );
+
+		bodyDef.type = b2_dynamicBody;
+		bodyDef.position = (b2Vec2){ -5.0f, 4.0f };
+		b2BodyId largeId = b2CreateBody( worldIds[k], &bodyDef );
+		b2Polygon largeBox = b2MakeBox( 4.0f, 2.5f );
+		b2CreatePolygonShape( largeId, &shapeDef, &largeBox );
+
+		// Overlapping small shapes of a few sizes
+		for ( int i = 0; i < 400; ++i )
+		{
+			bodyDef.position = (b2Vec2){ -10.0f + 0.35f * ( i % 60 ), 0.5f + 0.3f * ( i / 60 ) };
+			b2BodyId bodyId = b2CreateBody( worldIds[k], &bodyDef );
+			b2Circle circle = { { 0.0f, 0.0f }, 0.1f + 0.05f * ( i % 4 ) };
+			b2CreateCircleShape( bodyId, &shapeDef, &circle );
+		}
+	}
+
+	b2World_Step( worldIds[0], 1.0f / 60.0f, 4 );
+	b2World_Step( worldIds[1], 1.0f / 60.0f, 4 );
+
+	b2World* worldA = b2GetWorldFromId( worldIds[0] );
+	b2World* worldB = b2GetWorldFromId( worldIds[1] );
+	int shapeCount = worldA->shapes.count;
+	ENSURE( shapeCount == worldB->shapes.count );
+	ENSURE( b2GetSetCount( &worldA->broadPhase.pairSet ) == b2GetSetCount( &worldB->broadPhase.pairSet ) );
+	ENSURE( b2GetSetCount( &worldA->broadPhase.pairSet ) > 1000 );
+
+	for ( int i = 0; i < shapeCount; ++i )
+	{
+		for ( int j = i + 1; j < shapeCount; ++j )
+		{
+			uint64_t key = B2_SHAPE_PAIR_KEY( i, j );
+			ENSURE( b2ContainsKey( &worldA->broadPhase.pairSet, key ) == b2ContainsKey( &worldB->broadPhase.pairSet, key ) );
+		}
+	}
+
+	b2DestroyWorld( worldIds[0] );
+	b2DestroyWorld( worldIds[1] );
+
+	return 0;
+}
+
+// The grid broad-phase must be deterministic for any worker count
+static int GridBroadPhaseDeterminismTest( void )
+{
+	b2WorldId worldIdA = CreateDebrisScene( 1, b2_gridBroadPhase, 0 );
+	b2WorldId worldIdB = CreateDebrisScene( 4, b2_gridBroadPhase, 0 );
+	b2World* worldA = b2GetWorldFromId( worldIdA );
+	b2World* worldB = b2GetWorldFromId( worldIdB );
+
+	float timeStep = 1.0f / 60.0f;
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldIdA, timeStep, 4 );
+		b2World_Step( worldIdB, timeStep, 4 );
+
+		ENSURE( b2HashWorldState( worldA ) == b2HashWorldState( worldB ) );
+	}
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+
+	return 0;
+}
+
+// The enlarged proxies are refit in parallel with several workers and must give the same trees as the
+// serial refit
+static int ParallelRefitTest( void )
+{
+	b2WorldId worldIdA = CreateDebrisScene( 1, b2_treeBroadPhase, 0 );
+	b2WorldId worldIdB = CreateDebrisScene( 4, b2_treeBroadPhase, 0 );
+	b2World* worldA = b2GetWorldFromId( worldIdA );
+	b2World* worldB = b2GetWorldFromId( worldIdB );
+
+	float timeStep = 1.0f / 60.0f;
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldIdA, timeStep, 4 );
+		b2World_Step( worldIdB, timeStep, 4 );
+
+		ENSURE( b2HashWorldState( worldA ) == b2HashWorldState( worldB ) );
+
+		const b2DynamicTree* treeA = worldA->broadPhase.trees + b2_dynamicBody;
+		const b2DynamicTree* treeB = worldB->broadPhase.trees + b2_dynamicBody;
+		ENSURE( treeA->root == treeB->root );
+		ENSURE( treeA->nodeCapacity == treeB->nodeCapacity );
+
+		for ( int j = 0; j < treeA->nodeCapacity; ++j )
+		{
+			if ( ( treeA->nodeData[j].flags & b2_allocatedNode ) == 0 )
+			{
+				continue;
+			}
+
+			ENSURE( memcmp( &treeA->nodes[j].aabb, &treeB->nodes[j].aabb, sizeof( b2AABB ) ) == 0 );
+			ENSURE( treeA->nodeData[j].flags == treeB->nodeData[j].flags );
+		}
+	}
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+
+	return 0;
+}
+
+// Every internal node box must contain its children
+static bool IsTreeEnclosing( const b2DynamicTree* tree )
+{
+	for ( int i = 0; i < tree->nodeCapacity; ++i )
+	{
+		const b2TreeNode* node = tree->nodes + i;
+		if ( ( tree->nodeData[i].flags & b2_allocatedNode ) == 0 || ( tree->nodeData[i].flags & b2_leafNode ) != 0 )
+		{
+			continue;
+		}
+
+		if ( b2AABB_Contains( node->aabb, tree->nodes[node->children.child1].aabb ) == false ||
+			 b2AABB_Contains( node->aabb, tree->nodes[node->children.child2].aabb ) == false )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Bodies enlarged in one step and destroyed before the next leave no moved proxies, so the tree is not
+// rebuilt and the enlarged flags survive. The parallel refit must still grow the boxes above those nodes.
+static int ParallelRefitDestroyTest( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	worldDef.gravity = b2Vec2_zero;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	b2World* world = b2GetWorldFromId( worldId );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Circle circle = { { 0.0f, 0.0f }, 0.25f };
+
+	enum
+	{
+		e_rowCount = 32,
+		e_columnCount = 32,
+	};
+
+	b2BodyId bodyIds[e_rowCount * e_columnCount];
+	for ( int i = 0; i < e_rowCount; ++i )
+	{
+		for ( int j = 0; j < e_columnCount; ++j )
+		{
+			bodyDef.position = (b2Vec2){ 2.0f * j, 2.0f * i };
+			b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+			b2CreateCircleShape( bodyId, &shapeDef, &circle );
+			bodyIds[i * e_columnCount + j] = bodyId;
+		}
+	}
+
+	float timeStep = 1.0f / 60.0f;
+	b2World_Step( worldId, timeStep, 4 );
+
+	// Enlarge the even bodies, then destroy them
+	int count = e_rowCount * e_columnCount;
+	for ( int i = 0; i < count; i += 2 )
+	{
+		b2Body_SetLinearVelocity( bodyIds[i], (b2Vec2){ 20.0f, 0.0f } );
+	}
+
+	b2World_Step( worldId, timeStep, 4 );
+
+	for ( int i = 0; i < count; i += 2 )
+	{
+		b2DestroyBody( bodyIds[i] );
+	}
+
+	ENSURE( world->broadPhase.moveArray.count == 0 );
+
+	// Enlarge the odd bodies with the stale flags in place
+	for ( int i = 1; i < count; i += 2 )
+	{
+		b2Body_SetLinearVelocity( bodyIds[i], (b2Vec2){ 0.0f, 20.0f } );
+	}
+
+	for ( int i = 0; i < 4; ++i )
+	{
+		b2World_Step( worldId, timeStep, 4 );
+		ENSURE( IsTreeEnclosing( world->broadPhase.trees + b2_dynamicBody ) );
+	}
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// The contact solver kernels are compiled for several SIMD widths. Every width must give the same results.
+static int ContactSimdWidthTest( void )
+{
+	b2WorldId worldIdA = CreateDebrisScene( 1, b2_treeBroadPhase, 4 );
+	b2WorldId worldIdB = CreateDebrisScene( 1, b2_treeBroadPhase, 8 );
+	b2World* worldA = b2GetWorldFromId( worldIdA );
+	b2World* worldB = b2GetWorldFromId( worldIdB );
+
+	int widthA = b2World_GetContactSimdWidth( worldIdA );
+	int widthB = b2World_GetContactSimdWidth( worldIdB );
+	ENSURE( widthA == 4 || widthA == 8 );
+	ENSURE( widthB == 4 || widthB == 8 );
+
+	float timeStep = 1.0f / 60.0f;
+	for ( int i = 0; i < 90; ++i )
+	{
+		b2World_Step( worldIdA, timeStep, 4 );
+		b2World_Step( worldIdB, timeStep, 4 );
+
+		ENSURE( b2HashWorldState( worldA ) == b2HashWorldState( worldB ) );
+	}
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+
+	return 0;
+}
+
+// A heavy platform carrying a pile of debris pushes most of its contacts into the overflow color
+#define PLATFORM_COLUMN_COUNT 100
+#define PLATFORM_ROW_COUNT 3
+#define PLATFORM_DEBRIS_COUNT ( PLATFORM_COLUMN_COUNT * PLATFORM_ROW_COUNT )
+
+static b2WorldId CreatePlatformScene( const b2WorldDef* worldDef, b2BodyId* debrisIds )
+{
+	b2WorldId worldId = b2CreateWorld( worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon groundBox = b2MakeOffsetBox( 50.0f, 1.0f, (b2Vec2){ 0.0f, -1.0f }, b2Rot_identity );
+	b2CreatePolygonShape( groundId, &shapeDef, &groundBox );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = (b2Vec2){ 0.0f, 0.5f };
+	b2BodyId platformId = b2CreateBody( worldId, &bodyDef );
+	shapeDef.density = 10.0f;
+	b2Polygon platformBox = b2MakeBox( 32.0f, 0.5f );
+	b2CreatePolygonShape( platformId, &shapeDef, &platformBox );
+
+	shapeDef.density = 1.0f;
+	b2Polygon box = b2MakeBox( 0.15f, 0.15f );
+	for ( int i = 0; i < PLATFORM_COLUMN_COUNT; ++i )
+	{
+		for ( int j = 0; j < PLATFORM_ROW_COUNT; ++j )
+		{
+			int index = PLATFORM_ROW_COUNT * i + j;
+			bodyDef.position = (b2Vec2){ -30.0f + 0.31f * i, 1.16f + 0.31f * j };
+			debrisIds[index] = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( debrisIds[index], &shapeDef, &box );
+		}
+	}
+
+	return worldId;
+}
+
+// The parallel overflow solver must be deterministic for any worker count and must hold the debris up
+static int ParallelOverflowTest( void )
+{
+	b2BodyId debrisIdsA[PLATFORM_DEBRIS_COUNT];
+	b2BodyId debrisIdsB[PLATFORM_DEBRIS_COUNT];
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.enableParallelOverflow = true;
+
+	worldDef.workerCount = 1;
+	b2WorldId worldIdA = CreatePlatformScene( &worldDef, debrisIdsA );
+	worldDef.workerCount = 4;
+	b2WorldId worldIdB = CreatePlatformScene( &worldDef, debrisIdsB );
+	b2World* worldA = b2GetWorldFromId( worldIdA );
+	b2World* worldB = b2GetWorldFromId( worldIdB );
+
+	// The bodies fall asleep eventually, which removes their constraints from the graph
+	int maxOverflowCount = 0;
+	float timeStep = 1.0f / 60.0f;
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldIdA, timeStep, 4 );
+		b2World_Step( worldIdB, timeStep, 4 );
+
+		ENSURE( b2HashWorldState( worldA ) == b2HashWorldState( worldB ) );
+
+		b2Counters counters = b2World_GetCounters( worldIdA );
+		maxOverflowCount = b2MaxInt( maxOverflowCount, counters.overflowContactCount );
+	}
+
+	ENSURE( maxOverflowCount > 0 );
+
+	// The bottom boxes rest on the platform top at y = 1.15
+	for ( int i = 0; i < PLATFORM_COLUMN_COUNT; ++i )
+	{
+		b2Vec2 position = b2Body_GetPosition( debrisIdsA[PLATFORM_ROW_COUNT * i] );
+		ENSURE( b2IsValidVec2( position ) );
+		ENSURE_SMALL( position.y - 1.15f, 0.05f );
+	}
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+
+	return 0;
+}
+
+// The rebalancer moves contacts between colors serially, so results must not depend on the worker count.
+// It should also leave the colors no less balanced than the greedy coloring.
+static int GraphRebalanceTest( void )
+{
+	b2BodyId debrisIdsA[PLATFORM_DEBRIS_COUNT];
+	b2BodyId debrisIdsB[PLATFORM_DEBRIS_COUNT];
+	b2BodyId debrisIdsC[PLATFORM_DEBRIS_COUNT];
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.enableSleep = false;
+	worldDef.workerCount = 1;
+	b2WorldId baselineId = CreatePlatformScene( &worldDef, debrisIdsC );
+
+	worldDef.enableGraphRebalance = true;
+	b2WorldId worldIdA = CreatePlatformScene( &worldDef, debrisIdsA );
+	worldDef.workerCount = 4;
+	b2WorldId worldIdB = CreatePlatformScene( &worldDef, debrisIdsB );
+
+	b2World* worldA = b2GetWorldFromId( worldIdA );
+	b2World* worldB = b2GetWorldFromId( worldIdB );
+
+	int moveCount = 0;
+	float timeStep = 1.0f / 60.0f;
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( baselineId, timeStep, 4 );
+		b2World_Step( worldIdA, timeStep, 4 );
+		b2World_Step( worldIdB, timeStep, 4 );
+
+		ENSURE( b2HashWorldState( worldA ) == b2HashWorldState( worldB ) );
+
+		moveCount += b2World_GetCounters( worldIdA ).rebalancedContactCount;
+	}
+
+	ENSURE( moveCount > 0 );
+
+	b2Counters baseline = b2World_GetCounters( baselineId );
+	b2Counters counters = b2World_GetCounters( worldIdA );
+	ENSURE( counters.colorImbalance <= baseline.colorImbalance );
+	ENSURE( counters.overflowContactCount <= baseline.overflowContactCount );
+
+	for ( int i = 0; i < PLATFORM_COLUMN_COUNT; ++i )
+	{
+		b2Vec2 position = b2Body_GetPosition( debrisIdsA[PLATFORM_ROW_COUNT * i] );
+		ENSURE_SMALL( position.y - 1.15f, 0.05f );
+	}
+
+	b2DestroyWorld( baselineId );
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+
+	return 0;
+}
+
+// Recycled contacts only refresh part of their persistent wide constraint lane. This must give the same
+// results as preparing every lane from scratch.
+static int IncrementalPrepareTest( void )
+{
+	b2WorldId worldIdA = CreateDebrisScene( 1, b2_treeBroadPhase, 0 );
+	b2WorldId worldIdB = CreateDebrisScene( 1, b2_treeBroadPhase, 0 );
+	b2World* worldA = b2GetWorldFromId( worldIdA );
+	b2World* worldB = b2GetWorldFromId( worldIdB );
+
+	int recycledCount = 0;
+	float timeStep = 1.0f / 60.0f;
+	for ( int i = 0; i < 120; ++i )
+	{
+		// Forget the prepared parameters so every lane is prepared again
+		worldB->constraintGraph.preparedH = 0.0f;
+
+		b2World_Step( worldIdA, timeStep, 4 );
+		b2World_Step( worldIdB, timeStep, 4 );
+
+		ENSURE( b2HashWorldState( worldA ) == b2HashWorldState( worldB ) );
+
+		recycledCount += b2World_GetCounters( worldIdA ).recycledContactCount;
+	}
+
+	ENSURE( recycledCount > 0 );
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+
+	return 0;
+}
+
+static int ContactSortTest( void )
+{
+	b2WorldId baselineId = CreateDebrisScene( 1, b2_treeBroadPhase, 0 );
+	b2WorldId worldIdA = CreateDebrisScene( 1, b2_treeBroadPhase, 0 );
+	b2WorldId worldIdB = CreateDebrisScene( 4, b2_treeBroadPhase, 0 );
+	b2World* baseline = b2GetWorldFromId( baselineId );
+	b2World* worldA = b2GetWorldFromId( worldIdA );
+	b2World* worldB = b2GetWorldFromId( worldIdB );
+	worldA->enableContactSort = true;
+	worldB->enableContactSort = true;
+
+	// Sorting within a color does not change the solver results
+	int sortedCount = 0;
+	float timeStep = 1.0f / 60.0f;
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( baselineId, timeStep, 4 );
+		b2World_Step( worldIdA, timeStep, 4 );
+		b2World_Step( worldIdB, timeStep, 4 );
+
+		uint64_t hash = b2HashWorldState( baseline );
+		ENSURE( b2HashWorldState( worldA ) == hash );
+		ENSURE( b2HashWorldState( worldB ) == hash );
+
+		sortedCount += b2World_GetCounters( worldIdA ).sortedContactCount;
+	}
+
+	ENSURE( sortedCount > 0 );
+
+	b2DestroyWorld( baselineId );
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+
+	return 0;
+}
+
 int DeterminismTest( void )
 {
 	RUN_SUBTEST( MultithreadingTest );
 	RUN_SUBTEST( BuiltInSchedulerTest );
+	RUN_SUBTEST( IdlePolicyTest );
 	RUN_SUBTEST( CrossPlatformTest );
+	RUN_SUBTEST( WideJointTest );
+	RUN_SUBTEST( PipelinedStepTest );
+	RUN_SUBTEST( StaticTreeRebuildTest );
+	RUN_SUBTEST( ContactEventOrderTest );
+	RUN_SUBTEST( GridBroadPhasePairTest );
+	RUN_SUBTEST( GridBroadPhaseDeterminismTest );
+	RUN_SUBTEST( ParallelRefitTest );
+	RUN_SUBTEST( ParallelRefitDestroyTest );
+	RUN_SUBTEST( ContactSimdWidthTest );
+	RUN_SUBTEST( ParallelOverflowTest );
+	RUN_SUBTEST( GraphRebalanceTest );
+	RUN_SUBTEST( IncrementalPrepareTest );
+	RUN_SUBTEST( ContactSortTest );
 
 	return 0;
 }
@@ -1,10 +1,13 @@
 // SPDX-FileCopyrightText: 2025 Erin Catto
 // SPDX-License-Identifier: MIT
 
+#include "dynamic_tree.h"
 #include "test_macros.h"
 
 #include "box2d/collision.h"
 
+#include <string.h>
+
 static int TreeCreateDestroy( void )
 {
 	b2AABB a = {
@@ -446,6 +449,398 @@ static int TreeGridMovementTest( void )
 	return 0;
 }
 
+#define SYNC_COUNT 256
+
+typedef struct SyncProxy
+{
+	b2AABB aabb;
+	uint64_t categoryBits;
+	int proxyId;
+	bool alive;
+} SyncProxy;
+
+typedef struct SyncQueryContext
+{
+	int found[4 * SYNC_COUNT];
+	bool userDataMatches;
+} SyncQueryContext;
+
+static bool SyncQueryCallback( int proxyId, uint64_t userData, void* context )
+{
+	SyncQueryContext* queryContext = context;
+	queryContext->found[proxyId] += 1;
+
+	// user data is 1000 + the test proxy index, see TreeNodeDataSyncTest
+	if ( userData < 1000 || userData >= 1000 + SYNC_COUNT )
+	{
+		queryContext->userDataMatches = false;
+	}
+
+	return true;
+}
+
+// Compare tree queries against brute force. This covers the node data living apart from the hot nodes.
+static int CheckSyncQueries( b2DynamicTree* tree, const SyncProxy* proxies )
+{
+	b2DynamicTree_Validate( tree );
+
+	b2AABB queries[] = {
+		{ { -1.0f, -1.0f }, { 40.0f, 40.0f } },
+		{ { 3.5f, 3.5f }, { 9.5f, 7.5f } },
+		{ { 20.0f, 2.0f }, { 26.0f, 30.0f } },
+		{ { 14.2f, 14.2f }, { 14.8f, 14.8f } },
+	};
+	uint64_t masks[] = { 0x1ull, 0x2ull, 0x5ull, UINT64_MAX };
+
+	for ( int q = 0; q < (int)( sizeof( queries ) / sizeof( queries[0] ) ); ++q )
+	{
+		for ( int m = 0; m < (int)( sizeof( masks ) / sizeof( masks[0] ) ); ++m )
+		{
+			SyncQueryContext context = { .userDataMatches = true };
+			b2DynamicTree_Query( tree, queries[q], masks[m], SyncQueryCallback, &context );
+			ENSURE( context.userDataMatches );
+
+			for ( int i = 0; i < SYNC_COUNT; ++i )
+			{
+				const SyncProxy* proxy = proxies + i;
+				if ( proxy->alive == false )
+				{
+					continue;
+				}
+
+				ENSURE( b2DynamicTree_GetUserData( tree, proxy->proxyId ) == 1000 + (uint64_t)i );
+				ENSURE( b2DynamicTree_GetCategoryBits( tree, proxy->proxyId ) == proxy->categoryBits );
+
+				bool expected = b2AABB_Overlaps( proxy->aabb, queries[q] ) && ( proxy->categoryBits & masks[m] ) != 0;
+				ENSURE( context.found[proxy->proxyId] == ( expected ? 1 : 0 ) );
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int TreeNodeDataSyncTest( void )
+{
+	b2DynamicTree tree = b2DynamicTree_Create( 16 );
+
+	SyncProxy proxies[SYNC_COUNT];
+	for ( int i = 0; i < SYNC_COUNT; ++i )
+	{
+		float x = 2.0f * ( i % 16 );
+		float y = 2.0f * ( i / 16 );
+		SyncProxy* proxy = proxies + i;
+		proxy->aabb = ( b2AABB ){ { x, y }, { x + 1.0f, y + 1.0f } };
+		proxy->categoryBits = 1ull << ( i % 4 );
+		proxy->proxyId = b2DynamicTree_CreateProxy( &tree, proxy->aabb, proxy->categoryBits, 1000 + (uint64_t)i );
+		proxy->alive = true;
+	}
+
+	ENSURE( CheckSyncQueries( &tree, proxies ) == 0 );
+
+	// Moves reinsert leaves and allocate internal nodes
+	for ( int i = 0; i < SYNC_COUNT; i += 3 )
+	{
+		SyncProxy* proxy = proxies + i;
+		b2Vec2 offset = { 0.5f * ( i % 7 ), -0.25f * ( i % 5 ) };
+		proxy->aabb.lowerBound = b2Add( proxy->aabb.lowerBound, offset );
+		proxy->aabb.upperBound = b2Add( proxy->aabb.upperBound, offset );
+		b2DynamicTree_MoveProxy( &tree, proxy->proxyId, proxy->aabb );
+	}
+
+	ENSURE( CheckSyncQueries( &tree, proxies ) == 0 );
+
+	// Enlarge marks ancestors for the partial rebuild
+	for ( int i = 1; i < SYNC_COUNT; i += 5 )
+	{
+		SyncProxy* proxy = proxies + i;
+		proxy->aabb.upperBound = b2Add( proxy->aabb.upperBound, ( b2Vec2 ){ 1.5f, 0.5f } );
+		b2DynamicTree_EnlargeProxy( &tree, proxy->proxyId, proxy->aabb );
+	}
+
+	ENSURE( CheckSyncQueries( &tree, proxies ) == 0 );
+
+	// Category changes propagate to ancestors
+	for ( int i = 2; i < SYNC_COUNT; i += 7 )
+	{
+		SyncProxy* proxy = proxies + i;
+		proxy->categoryBits = 0x8ull;
+		b2DynamicTree_SetCategoryBits( &tree, proxy->proxyId, proxy->categoryBits );
+	}
+
+	ENSURE( CheckSyncQueries( &tree, proxies ) == 0 );
+
+	b2DynamicTree_Rebuild( &tree, false );
+	ENSURE( CheckSyncQueries( &tree, proxies ) == 0 );
+
+	// Removal frees nodes back to the pool
+	for ( int i = 0; i < SYNC_COUNT; i += 4 )
+	{
+		SyncProxy* proxy = proxies + i;
+		b2DynamicTree_DestroyProxy( &tree, proxy->proxyId );
+		proxy->alive = false;
+	}
+
+	ENSURE( CheckSyncQueries( &tree, proxies ) == 0 );
+
+	b2DynamicTree_Rebuild( &tree, true );
+	ENSURE( CheckSyncQueries( &tree, proxies ) == 0 );
+
+	b2DynamicTree_Destroy( &tree );
+	return 0;
+}
+
+#define WIDE_COUNT 500
+
+// Indexed by proxy id, which is a node index
+typedef struct WideTestContext
+{
+	b2Circle circles[4 * WIDE_COUNT];
+	int hits[4 * WIDE_COUNT];
+	int closestProxy;
+	float closestFraction;
+} WideTestContext;
+
+static bool WideQueryCallback( int proxyId, uint64_t userData, void* context )
+{
+	(void)userData;
+	WideTestContext* wideContext = context;
+	wideContext->hits[proxyId] += 1;
+	return true;
+}
+
+static float WideRayCastCallback( const b2RayCastInput* input, int proxyId, uint64_t userData, void* context )
+{
+	(void)userData;
+	WideTestContext* wideContext = context;
+	wideContext->hits[proxyId] += 1;
+
+	b2CastOutput output = b2RayCastCircle( wideContext->circles + proxyId, input );
+	if ( output.hit == false )
+	{
+		return -1.0f;
+	}
+
+	wideContext->closestProxy = proxyId;
+	wideContext->closestFraction = output.fraction;
+	return output.fraction;
+}
+
+static float WideCollectCastCallback( const b2ShapeCastInput* input, int proxyId, uint64_t userData, void* context )
+{
+	(void)userData;
+	WideTestContext* wideContext = context;
+	wideContext->hits[proxyId] += 1;
+	return input->maxFraction;
+}
+
+// The wide tree must report the same proxies as the binary tree
+static int CompareWideQueries( const b2DynamicTree* binaryTree, const b2DynamicTree* wideTree, WideTestContext* contexts )
+{
+	b2AABB queries[] = {
+		{ { -100.0f, -100.0f }, { 100.0f, 100.0f } },
+		{ { -10.0f, -5.0f }, { 12.0f, 7.0f } },
+		{ { 20.0f, -30.0f }, { 25.0f, 40.0f } },
+		{ { 3.0f, 3.0f }, { 3.1f, 3.1f } },
+	};
+	uint64_t masks[] = { 0x1ull, 0x6ull, UINT64_MAX };
+
+	for ( int q = 0; q < (int)( sizeof( queries ) / sizeof( queries[0] ) ); ++q )
+	{
+		for ( int m = 0; m < (int)( sizeof( masks ) / sizeof( masks[0] ) ); ++m )
+		{
+			memset( contexts[0].hits, 0, sizeof( contexts[0].hits ) );
+			memset( contexts[1].hits, 0, sizeof( contexts[1].hits ) );
+			b2DynamicTree_Query( binaryTree, queries[q], masks[m], WideQueryCallback, contexts + 0 );
+			b2DynamicTree_Query( wideTree, queries[q], masks[m], WideQueryCallback, contexts + 1 );
+			ENSURE( memcmp( contexts[0].hits, contexts[1].hits, sizeof( contexts[0].hits ) ) == 0 );
+		}
+
+		memset( contexts[0].hits, 0, sizeof( contexts[0].hits ) );
+		memset( contexts[1].hits, 0, sizeof( contexts[1].hits ) );
+		b2DynamicTree_QueryAll( binaryTree, queries[q], WideQueryCallback, contexts + 0 );
+		b2DynamicTree_QueryAll( wideTree, queries[q], WideQueryCallback, contexts + 1 );
+		ENSURE( memcmp( contexts[0].hits, contexts[1].hits, sizeof( contexts[0].hits ) ) == 0 );
+	}
+
+	for ( int i = 0; i < 16; ++i )
+	{
+		float angle = 0.4f * i;
+		b2RayCastInput input = {
+			.origin = { -60.0f + 7.0f * i, 30.0f - 3.0f * i },
+			.translation = { 120.0f * cosf( angle ), 120.0f * sinf( angle ) },
+			.maxFraction = 1.0f,
+		};
+
+		for ( int k = 0; k < 2; ++k )
+		{
+			contexts[k].closestProxy = -1;
+			contexts[k].closestFraction = 1.0f;
+		}
+
+		b2DynamicTree_RayCast( binaryTree, &input, UINT64_MAX, WideRayCastCallback, contexts + 0 );
+		b2DynamicTree_RayCast( wideTree, &input, UINT64_MAX, WideRayCastCallback, contexts + 1 );
+		ENSURE( contexts[0].closestProxy == contexts[1].closestProxy );
+		ENSURE( contexts[0].closestFraction == contexts[1].closestFraction );
+
+		b2Vec2 points[3] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0f, 1.0f } };
+		b2ShapeCastInput castInput = {
+			.proxy = b2MakeOffsetProxy( points, 3, 0.1f, input.origin, b2Rot_identity ),
+			.translation = input.translation,
+			.maxFraction = 1.0f,
+		};
+
+		memset( contexts[0].hits, 0, sizeof( contexts[0].hits ) );
+		memset( contexts[1].hits, 0, sizeof( contexts[1].hits ) );
+		b2DynamicTree_ShapeCast( binaryTree, &castInput, 0x3ull, WideCollectCastCallback, contexts + 0 );
+		b2DynamicTree_ShapeCast( wideTree, &castInput, 0x3ull, WideCollectCastCallback, contexts + 1 );
+		ENSURE( memcmp( contexts[0].hits, contexts[1].hits, sizeof( contexts[0].hits ) ) == 0 );
+	}
+
+	return 0;
+}
+
+static int TreeWideTest( void )
+{
+	b2DynamicTree binaryTree = b2DynamicTree_Create( 16 );
+	b2DynamicTree wideTree = b2DynamicTree_Create( 16 );
+
+	// Both trees get the same proxy ids
+	static WideTestContext contexts[2];
+	uint32_t seed = 12345;
+	for ( int i = 0; i < WIDE_COUNT; ++i )
+	{
+		seed = 1664525u * seed + 1013904223u;
+		float x = -50.0f + 100.0f * (float)( seed >> 8 ) / 16777216.0f;
+		seed = 1664525u * seed + 1013904223u;
+		float y = -50.0f + 100.0f * (float)( seed >> 8 ) / 16777216.0f;
+		float radius = 0.25f + 0.25f * ( i % 5 );
+
+		b2AABB box = { { x - radius, y - radius }, { x + radius, y + radius } };
+		uint64_t categoryBits = 1ull << ( i % 3 );
+		int id1 = b2DynamicTree_CreateProxy( &binaryTree, box, categoryBits, (uint64_t)i );
+		int id2 = b2DynamicTree_CreateProxy( &wideTree, box, categoryBits, (uint64_t)i );
+		ENSURE( id1 == id2 );
+
+		contexts[0].circles[id1] = ( b2Circle ){ { x, y }, radius };
+		contexts[1].circles[id1] = ( b2Circle ){ { x, y }, radius };
+	}
+
+	b2DynamicTree_Rebuild( &binaryTree, true );
+	b2DynamicTree_Rebuild( &wideTree, true );
+	b2DynamicTree_BuildWide( &wideTree );
+
+	ENSURE( binaryTree.wideNodeCount == 0 );
+	ENSURE( wideTree.wideNodeCount > 0 );
+	ENSURE( wideTree.wideNodeCount < wideTree.nodeCount / 2 );
+
+	ENSURE( CompareWideQueries( &binaryTree, &wideTree, contexts ) == 0 );
+
+	// Any change falls back to the binary tree
+	b2AABB box = b2DynamicTree_GetAABB( &wideTree, 7 );
+	box.upperBound.x += 3.0f;
+	b2DynamicTree_MoveProxy( &binaryTree, 7, box );
+	b2DynamicTree_MoveProxy( &wideTree, 7, box );
+	ENSURE( wideTree.wideNodeCount == 0 );
+
+	ENSURE( CompareWideQueries( &binaryTree, &wideTree, contexts ) == 0 );
+
+	b2DynamicTree_BuildWide( &wideTree );
+	ENSURE( wideTree.wideNodeCount > 0 );
+	ENSURE( CompareWideQueries( &binaryTree, &wideTree, contexts ) == 0 );
+
+	b2DynamicTree_Destroy( &binaryTree );
+	b2DynamicTree_Destroy( &wideTree );
+	return 0;
+}
+
+static int CompareTrees( const b2DynamicTree* a, const b2DynamicTree* b )
+{
+	ENSURE( a->root == b->root );
+	ENSURE( a->nodeCount == b->nodeCount );
+	ENSURE( a->nodeCapacity == b->nodeCapacity );
+	ENSURE( a->freeList == b->freeList );
+	ENSURE( memcmp( a->nodes, b->nodes, a->nodeCapacity * sizeof( b2TreeNode ) ) == 0 );
+	ENSURE( memcmp( a->nodeData, b->nodeData, a->nodeCapacity * sizeof( b2TreeNodeData ) ) == 0 );
+	return 0;
+}
+
+static int SplitRebuild( b2DynamicTree* tree, bool fullBuild, int subtreeLeafCount )
+{
+	b2TreeRebuild rebuild = b2DynamicTree_BeginRebuild( tree, fullBuild, subtreeLeafCount );
+
+	// Build order must not matter
+	for ( int i = rebuild.subtreeCount - 1; i >= 0; --i )
+	{
+		b2DynamicTree_BuildSubtrees( &rebuild, i, i + 1 );
+	}
+
+	return b2DynamicTree_EndRebuild( &rebuild );
+}
+
+static int TreeSplitRebuildTest( void )
+{
+	b2DynamicTree serialTree = b2DynamicTree_Create( 16 );
+	b2DynamicTree splitTree = b2DynamicTree_Create( 16 );
+
+	// Empty and single proxy trees
+	ENSURE( b2DynamicTree_Rebuild( &serialTree, true ) == SplitRebuild( &splitTree, true, 8 ) );
+	ENSURE( CompareTrees( &serialTree, &splitTree ) == 0 );
+
+	enum
+	{
+		count = 300
+	};
+	int proxyIds[count];
+	uint32_t seed = 4321;
+	for ( int i = 0; i < count; ++i )
+	{
+		seed = 1664525u * seed + 1013904223u;
+		float x = -50.0f + 100.0f * (float)( seed >> 8 ) / 16777216.0f;
+		seed = 1664525u * seed + 1013904223u;
+		float y = -50.0f + 100.0f * (float)( seed >> 8 ) / 16777216.0f;
+
+		b2AABB box = { { x - 0.5f, y - 0.5f }, { x + 0.5f, y + 0.5f } };
+		uint64_t categoryBits = 1ull << ( i % 5 );
+		proxyIds[i] = b2DynamicTree_CreateProxy( &serialTree, box, categoryBits, (uint64_t)i );
+		ENSURE( b2DynamicTree_CreateProxy( &splitTree, box, categoryBits, (uint64_t)i ) == proxyIds[i] );
+
+		if ( i == 0 )
+		{
+			ENSURE( b2DynamicTree_Rebuild( &serialTree, true ) == SplitRebuild( &splitTree, true, 8 ) );
+			ENSURE( CompareTrees( &serialTree, &splitTree ) == 0 );
+		}
+	}
+
+	ENSURE( b2DynamicTree_Rebuild( &serialTree, true ) == count );
+	ENSURE( SplitRebuild( &splitTree, true, 8 ) == count );
+	ENSURE( CompareTrees( &serialTree, &splitTree ) == 0 );
+
+	// Single subtree
+	ENSURE( b2DynamicTree_Rebuild( &serialTree, true ) == SplitRebuild( &splitTree, true, 1000 ) );
+	ENSURE( CompareTrees( &serialTree, &splitTree ) == 0 );
+
+	// Partial rebuild after enlarging some proxies
+	for ( int i = 0; i < count; i += 7 )
+	{
+		b2AABB box = b2DynamicTree_GetAABB( &serialTree, proxyIds[i] );
+		box.lowerBound.x -= 2.0f;
+		box.upperBound.y += 3.0f;
+		b2DynamicTree_EnlargeProxy( &serialTree, proxyIds[i], box );
+		b2DynamicTree_EnlargeProxy( &splitTree, proxyIds[i], box );
+	}
+
+	ENSURE( b2DynamicTree_Rebuild( &serialTree, false ) == SplitRebuild( &splitTree, false, 8 ) );
+	ENSURE( CompareTrees( &serialTree, &splitTree ) == 0 );
+
+	b2DynamicTree_Validate( &splitTree );
+	ENSURE( b2DynamicTree_GetHeight( &serialTree ) == b2DynamicTree_GetHeight( &splitTree ) );
+
+	b2DynamicTree_Destroy( &serialTree );
+	b2DynamicTree_Destroy( &splitTree );
+	return 0;
+}
+
 int DynamicTreeTest( void )
 {
 	RUN_SUBTEST( TreeCreateDestroy );
@@ -457,6 +852,9 @@ int DynamicTreeTest( void )
 	RUN_SUBTEST( TreeRowHeightTest );
 	RUN_SUBTEST( TreeGridHeightTest );
 	RUN_SUBTEST( TreeGridMovementTest );
+	RUN_SUBTEST( TreeNodeDataSyncTest );
+	RUN_SUBTEST( TreeWideTest );
+	RUN_SUBTEST( TreeSplitRebuildTest );
 
 	// todo test queries versus brute force
 
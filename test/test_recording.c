@@ -169,6 +169,24 @@ int RecordingTest( void )
 	b2ShapeId chainSegShapeId = b2CreateChainSegmentShape( groundId, &segmentDef, &chainSeg );
 	ENSURE( b2Shape_IsValid( chainSegShapeId ) );
 
+	// Mesh shape with a step up on the right
+	b2ChainSegment meshSegments[2] = {
+		{ { 8.0f, 0.5f }, { { 6.0f, 0.5f }, { 4.0f, 0.5f } }, { 3.0f, 0.0f }, -1 },
+		{ { 10.0f, 0.5f }, { { 8.0f, 0.5f }, { 6.0f, 0.5f } }, { 4.0f, 0.5f }, -1 },
+	};
+	b2Mesh mesh = { meshSegments, 2 };
+	b2ShapeId meshShapeId = b2CreateMeshShape( groundId, &segmentDef, &mesh );
+	ENSURE( b2Shape_IsValid( meshShapeId ) );
+
+	// Heightfield with per cell materials
+	float heights[5] = { 0.5f, 0.75f, 0.5f, 0.25f, 0.5f };
+	uint8_t materialIndices[4] = { 1, 0, 0, 1 };
+	b2SurfaceMaterial cellMaterials[2] = { b2DefaultSurfaceMaterial(), b2DefaultSurfaceMaterial() };
+	cellMaterials[1].friction = 0.1f;
+	b2HeightField heightField = { heights, 5, 1.0f, cellMaterials, 2, materialIndices };
+	b2ShapeId heightFieldShapeId = b2CreateHeightFieldShape( groundId, &segmentDef, &heightField );
+	ENSURE( b2Shape_IsValid( heightFieldShapeId ) );
+
 	// Exercise the recorded shape mutators
 	b2Shape_SetFriction( boxShapeId, 0.3f );
 	b2Shape_SetRestitution( capsuleShapeId, 0.5f );
@@ -196,6 +214,24 @@ int RecordingTest( void )
 	b2ShapeId tmpShapeId = b2CreateCircleShape( capsuleBodyId, &capsuleDef, &tmpCircle );
 	b2DestroyShape( tmpShapeId, true );
 
+	// Crates sharing one geometry. The geometry outlives its user reference.
+	b2Polygon crate = b2MakeBox( 0.25f, 0.25f );
+	b2GeometryId crateGeometryId = b2CreateGeometry( worldId, &crate );
+	b2BodyDef crateDef = b2DefaultBodyDef();
+	crateDef.type = b2_dynamicBody;
+	b2ShapeDef crateShapeDef = b2DefaultShapeDef();
+	crateShapeDef.geometry = crateGeometryId;
+	b2ShapeId crateShapeId = b2_nullShapeId;
+	for ( int i = 0; i < 3; ++i )
+	{
+		crateDef.position = (b2Vec2){ -1.0f + i, 8.0f };
+		b2BodyId crateId = b2CreateBody( worldId, &crateDef );
+		crateShapeId = b2CreatePolygonShape( crateId, &crateShapeDef, NULL );
+	}
+	b2DestroyGeometry( crateGeometryId );
+	b2Polygon bigCrate = b2MakeBox( 0.3f, 0.3f );
+	b2Shape_SetPolygon( crateShapeId, &bigCrate );
+
 	// A kinematic body to exercise SetType and SetTargetTransform
 	b2BodyDef kinematicDef = b2DefaultBodyDef();
 	kinematicDef.type = b2_kinematicBody;
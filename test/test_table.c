@@ -306,7 +306,12 @@ static int HashSetBytesTest( void )
 	b2HashSet set = b2CreateSet( 32 );
 
 	int bytes = b2GetHashSetBytes( &set );
+#if defined( BOX2D_SWISS_TABLE )
+	// One control byte per item
+	int expectedBytes = 32 * (int)( sizeof( b2SetItem ) + 1 );
+#else
 	int expectedBytes = 32 * (int)sizeof( b2SetItem );
+#endif
 	ENSURE( bytes == expectedBytes );
 
 	// Add some items and verify bytes calculation doesn't change
@@ -421,6 +426,264 @@ static int HashSetTest( void )
 	return 0;
 }
 
+#define LOAD_SHAPE_COUNT 50000
+#define LOAD_PAIRS_PER_SHAPE 10
+#define LOAD_KEY_COUNT ( LOAD_SHAPE_COUNT * LOAD_PAIRS_PER_SHAPE )
+
+// Each shape overlaps a few neighbors, like the pair set of a large pile
+static uint64_t LoadKey( int i )
+{
+	int shapeId = i / LOAD_PAIRS_PER_SHAPE;
+	int otherId = shapeId + 1 + i % LOAD_PAIRS_PER_SHAPE;
+	return B2_SHAPE_PAIR_KEY( shapeId, otherId );
+}
+
+// Fills a set with half a million pairs, then churns it with removes and adds like the broad-phase does
+static int HashSetLoadTest( void )
+{
+	b2HashSet set = b2CreateSet( 16 );
+
+	uint64_t ticks = b2GetTicks();
+	for ( int i = 0; i < LOAD_KEY_COUNT; ++i )
+	{
+		bool found = b2AddKey( &set, LoadKey( i ) );
+		ENSURE( found == false );
+	}
+	float addMs = b2GetMilliseconds( ticks );
+
+	ENSURE( b2GetSetCount( &set ) == LOAD_KEY_COUNT );
+
+#if B2_SNOOP_TABLE_COUNTERS
+	extern b2AtomicInt b2_probeCount;
+	b2AtomicStoreInt( &b2_probeCount, 0 );
+#endif
+
+	int foundCount = 0;
+	ticks = b2GetTicks();
+	for ( int i = 0; i < LOAD_KEY_COUNT; ++i )
+	{
+		foundCount += b2ContainsKey( &set, LoadKey( i ) ) ? 1 : 0;
+	}
+	float hitMs = b2GetMilliseconds( ticks );
+	ENSURE( foundCount == LOAD_KEY_COUNT );
+
+#if B2_SNOOP_TABLE_COUNTERS
+	int hitProbeCount = b2AtomicLoadInt( &b2_probeCount );
+	b2AtomicStoreInt( &b2_probeCount, 0 );
+#endif
+
+	// Pairs of shapes that are far apart
+	ticks = b2GetTicks();
+	for ( int i = 0; i < LOAD_KEY_COUNT; ++i )
+	{
+		foundCount += b2ContainsKey( &set, B2_SHAPE_PAIR_KEY( i, i + 2 * LOAD_PAIRS_PER_SHAPE ) ) ? 1 : 0;
+	}
+	float missMs = b2GetMilliseconds( ticks );
+	ENSURE( foundCount == LOAD_KEY_COUNT );
+
+	printf( "set: count = %d, capacity = %d, bytes = %d, add = %.3f ms, hit = %.3f ms, miss = %.3f ms\n", LOAD_KEY_COUNT,
+			b2GetSetCapacity( &set ), b2GetHashSetBytes( &set ), addMs, hitMs, missMs );
+
+#if B2_SNOOP_TABLE_COUNTERS
+	int missProbeCount = b2AtomicLoadInt( &b2_probeCount );
+	printf( "set: ave probe count hit = %.3f, miss = %.3f\n", (float)hitProbeCount / LOAD_KEY_COUNT,
+			(float)missProbeCount / LOAD_KEY_COUNT );
+#endif
+
+	// Pairs come and go while the count stays about the same. The set should not keep growing.
+	int capacity = b2GetSetCapacity( &set );
+	for ( int round = 0; round < 4; ++round )
+	{
+		for ( int i = round % 2; i < LOAD_KEY_COUNT; i += 2 )
+		{
+			ENSURE( b2RemoveKey( &set, LoadKey( i ) ) );
+		}
+
+		for ( int i = round % 2; i < LOAD_KEY_COUNT; i += 2 )
+		{
+			ENSURE( b2AddKey( &set, LoadKey( i ) ) == false );
+		}
+	}
+
+	ENSURE( b2GetSetCount( &set ) == LOAD_KEY_COUNT );
+	ENSURE( b2GetSetCapacity( &set ) == capacity );
+
+	for ( int i = 0; i < LOAD_KEY_COUNT; ++i )
+	{
+		ENSURE( b2ContainsKey( &set, LoadKey( i ) ) );
+	}
+
+	b2DestroySet( &set );
+	return 0;
+}
+
+#define CONCURRENT_THREAD_COUNT 4
+#define CONCURRENT_KEY_COUNT 20000
+
+typedef struct ConcurrentSetContext
+{
+	b2HashSet* set;
+	int threadIndex;
+	int addCount;
+	int missingCount;
+} ConcurrentSetContext;
+
+static uint64_t ConcurrentKey( int i )
+{
+	return B2_SHAPE_PAIR_KEY( i % 211, 1000 + i );
+}
+
+// Every thread adds all the keys, starting at a different place, so most adds race with another thread
+static void ConcurrentSetWorker( void* context )
+{
+	ConcurrentSetContext* setContext = context;
+	int start = setContext->threadIndex * CONCURRENT_KEY_COUNT / CONCURRENT_THREAD_COUNT;
+	for ( int i = 0; i < CONCURRENT_KEY_COUNT; ++i )
+	{
+		uint64_t key = ConcurrentKey( ( start + i ) % CONCURRENT_KEY_COUNT );
+		bool found = b2AddKeyConcurrent( setContext->set, key );
+		setContext->addCount += found ? 0 : 1;
+
+		if ( b2ContainsKeyConcurrent( setContext->set, key ) == false )
+		{
+			setContext->missingCount += 1;
+		}
+	}
+}
+
+static int ConcurrentHashSetTest( void )
+{
+	b2HashSet set = b2CreateSet( 16 );
+
+	// Some keys exist before the concurrent adds
+	for ( int i = 0; i < CONCURRENT_KEY_COUNT; i += 10 )
+	{
+		b2AddKey( &set, ConcurrentKey( i ) );
+	}
+
+	int existingCount = b2GetSetCount( &set );
+	b2ReserveSet( &set, CONCURRENT_KEY_COUNT );
+	ENSURE( b2GetSetRoom( &set ) >= CONCURRENT_KEY_COUNT );
+	ENSURE( b2GetSetCount( &set ) == existingCount );
+
+	ConcurrentSetContext contexts[CONCURRENT_THREAD_COUNT] = { 0 };
+	b2Thread* threads[CONCURRENT_THREAD_COUNT];
+	for ( int i = 0; i < CONCURRENT_THREAD_COUNT; ++i )
+	{
+		contexts[i].set = &set;
+		contexts[i].threadIndex = i;
+		threads[i] = b2CreateThread( ConcurrentSetWorker, contexts + i, "set test" );
+	}
+
+	int addCount = 0;
+	for ( int i = 0; i < CONCURRENT_THREAD_COUNT; ++i )
+	{
+		b2JoinThread( threads[i] );
+		addCount += contexts[i].addCount;
+		ENSURE( contexts[i].missingCount == 0 );
+	}
+
+	// Each key is added by exactly one thread
+	ENSURE( existingCount + addCount == CONCURRENT_KEY_COUNT );
+
+	b2FinishConcurrentAdds( &set, addCount );
+	ENSURE( b2GetSetCount( &set ) == CONCURRENT_KEY_COUNT );
+
+	for ( int i = 0; i < CONCURRENT_KEY_COUNT; ++i )
+	{
+		ENSURE( b2ContainsKey( &set, ConcurrentKey( i ) ) );
+	}
+
+	// Serial removal and growth still work on a set filled concurrently
+	for ( int i = 0; i < CONCURRENT_KEY_COUNT; i += 2 )
+	{
+		ENSURE( b2RemoveKey( &set, ConcurrentKey( i ) ) );
+	}
+
+	for ( int i = 0; i < CONCURRENT_KEY_COUNT; ++i )
+	{
+		ENSURE( b2ContainsKey( &set, ConcurrentKey( i ) ) == ( i % 2 == 1 ) );
+		ENSURE( b2ContainsKeyConcurrent( &set, ConcurrentKey( i ) ) == ( i % 2 == 1 ) );
+	}
+
+	for ( int i = 0; i < CONCURRENT_KEY_COUNT; i += 2 )
+	{
+		ENSURE( b2AddKey( &set, ConcurrentKey( i ) ) == false );
+	}
+
+	ENSURE( b2GetSetCount( &set ) == CONCURRENT_KEY_COUNT );
+
+	b2DestroySet( &set );
+	return 0;
+}
+
+// Compares the serial and concurrent set functions on a single thread
+static int ConcurrentHashSetTimingTest( void )
+{
+	const int N = SET_SPAN;
+	const uint32_t itemCount = ITEM_COUNT;
+
+	b2HashSet serialSet = b2CreateSet( 16 );
+	b2HashSet concurrentSet = b2CreateSet( 16 );
+	b2ReserveSet( &serialSet, itemCount );
+	b2ReserveSet( &concurrentSet, itemCount );
+
+	uint64_t ticks = b2GetTicks();
+	for ( int i = 0; i < N; ++i )
+	{
+		for ( int j = i + 1; j < N; ++j )
+		{
+			b2AddKey( &serialSet, B2_SHAPE_PAIR_KEY( i, j ) );
+		}
+	}
+	float serialAddMs = b2GetMilliseconds( ticks );
+
+	ticks = b2GetTicks();
+	int addCount = 0;
+	for ( int i = 0; i < N; ++i )
+	{
+		for ( int j = i + 1; j < N; ++j )
+		{
+			addCount += b2AddKeyConcurrent( &concurrentSet, B2_SHAPE_PAIR_KEY( i, j ) ) ? 0 : 1;
+		}
+	}
+	float concurrentAddMs = b2GetMilliseconds( ticks );
+
+	b2FinishConcurrentAdds( &concurrentSet, addCount );
+	ENSURE( b2GetSetCount( &serialSet ) == itemCount );
+	ENSURE( b2GetSetCount( &concurrentSet ) == itemCount );
+
+	int foundCount = 0;
+	ticks = b2GetTicks();
+	for ( int i = 0; i < N; ++i )
+	{
+		for ( int j = i + 1; j < N; ++j )
+		{
+			foundCount += b2ContainsKey( &serialSet, B2_SHAPE_PAIR_KEY( j, i ) ) ? 1 : 0;
+		}
+	}
+	float serialFindMs = b2GetMilliseconds( ticks );
+
+	ticks = b2GetTicks();
+	for ( int i = 0; i < N; ++i )
+	{
+		for ( int j = i + 1; j < N; ++j )
+		{
+			foundCount += b2ContainsKeyConcurrent( &concurrentSet, B2_SHAPE_PAIR_KEY( j, i ) ) ? 1 : 0;
+		}
+	}
+	float concurrentFindMs = b2GetMilliseconds( ticks );
+
+	ENSURE( foundCount == 2 * (int)itemCount );
+
+	printf( "set: count = %d, add serial = %.3f ms, concurrent = %.3f ms, find serial = %.3f ms, concurrent = %.3f ms\n",
+			itemCount, serialAddMs, concurrentAddMs, serialFindMs, concurrentFindMs );
+
+	b2DestroySet( &serialSet );
+	b2DestroySet( &concurrentSet );
+	return 0;
+}
+
 int TableTest( void )
 {
 	// Test helper functions first
@@ -442,6 +705,9 @@ int TableTest( void )
 	RUN_SUBTEST( HashSetShapePairKeyTest );
 	RUN_SUBTEST( HashSetBytesTest );
 	RUN_SUBTEST( HashSetTest );
+	RUN_SUBTEST( HashSetLoadTest );
+	RUN_SUBTEST( ConcurrentHashSetTest );
+	RUN_SUBTEST( ConcurrentHashSetTimingTest );
 
 	return 0;
 }
@@ -10,6 +10,7 @@
 #include "box2d/math_functions.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 
 // This is a simple example of building and running a simulation
 // using Box2D. Here we create a large ground box and a small dynamic
@@ -534,6 +535,532 @@ static int ChainSegmentShapeTest( void )
 	return 0;
 }
 
+#define MESH_POINT_COUNT 83
+
+// Build the same wavy ground as a chain and as a mesh. Dynamic shapes should come to rest
+// at the same place and rays should hit the same point.
+static b2WorldId CreateGroundWorld( const b2Vec2* points, bool useMesh, b2BodyId* bodyIds )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+	if ( useMesh )
+	{
+		b2ChainSegment segments[MESH_POINT_COUNT - 3];
+		for ( int i = 0; i < MESH_POINT_COUNT - 3; ++i )
+		{
+			segments[i].ghost1 = points[i];
+			segments[i].segment.point1 = points[i + 1];
+			segments[i].segment.point2 = points[i + 2];
+			segments[i].ghost2 = points[i + 3];
+			segments[i].chainId = B2_NULL_INDEX;
+		}
+
+		b2Mesh mesh = { segments, MESH_POINT_COUNT - 3 };
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		b2CreateMeshShape( groundId, &shapeDef, &mesh );
+	}
+	else
+	{
+		b2ChainDef chainDef = b2DefaultChainDef();
+		chainDef.points = points;
+		chainDef.count = MESH_POINT_COUNT;
+		b2CreateChain( groundId, &chainDef );
+	}
+
+	bodyDef.type = b2_dynamicBody;
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	bodyDef.position = (b2Vec2){ -6.0f, 3.0f };
+	bodyIds[0] = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2CreatePolygonShape( bodyIds[0], &shapeDef, &box );
+
+	bodyDef.position = (b2Vec2){ 0.3f, 3.0f };
+	bodyIds[1] = b2CreateBody( worldId, &bodyDef );
+	b2Circle circle = { { 0.0f, 0.0f }, 0.5f };
+	b2CreateCircleShape( bodyIds[1], &shapeDef, &circle );
+
+	bodyDef.position = (b2Vec2){ 7.0f, 3.0f };
+	bodyIds[2] = b2CreateBody( worldId, &bodyDef );
+	b2Capsule capsule = { { -0.5f, 0.0f }, { 0.5f, 0.0f }, 0.25f };
+	b2CreateCapsuleShape( bodyIds[2], &shapeDef, &capsule );
+
+	return worldId;
+}
+
+static int MeshShapeTest( void )
+{
+	// Points run right to left so the solid side is down
+	b2Vec2 points[MESH_POINT_COUNT];
+	for ( int i = 0; i < MESH_POINT_COUNT; ++i )
+	{
+		float x = 20.0f - 0.5f * i;
+		points[i] = (b2Vec2){ x, 0.25f * sinf( 0.2f * x ) };
+	}
+
+	b2BodyId chainBodies[3], meshBodies[3];
+	b2WorldId chainWorldId = CreateGroundWorld( points, false, chainBodies );
+	b2WorldId meshWorldId = CreateGroundWorld( points, true, meshBodies );
+
+	for ( int i = 0; i < 20; ++i )
+	{
+		b2Vec2 origin = { -17.3f + 1.7f * i, 2.0f };
+		b2Vec2 translation = { 0.0f, -4.0f };
+		b2RayResult chainResult = b2World_CastRayClosest( chainWorldId, origin, translation, b2DefaultQueryFilter() );
+		b2RayResult meshResult = b2World_CastRayClosest( meshWorldId, origin, translation, b2DefaultQueryFilter() );
+		ENSURE( chainResult.hit && meshResult.hit );
+		ENSURE( b2Shape_GetType( meshResult.shapeId ) == b2_meshShape );
+		ENSURE( b2Shape_GetMeshSegmentCount( meshResult.shapeId ) == MESH_POINT_COUNT - 3 );
+		ENSURE_SMALL( chainResult.point.y - meshResult.point.y, 1e-5f );
+		ENSURE_SMALL( chainResult.normal.x - meshResult.normal.x, 1e-5f );
+		ENSURE_SMALL( chainResult.normal.y - meshResult.normal.y, 1e-5f );
+	}
+
+	// Rays from below pass through the one-sided surface
+	b2RayResult below = b2World_CastRayClosest( meshWorldId, (b2Vec2){ 0.0f, -5.0f }, (b2Vec2){ 0.0f, 5.5f }, b2DefaultQueryFilter() );
+	ENSURE( below.hit == false );
+
+	for ( int i = 0; i < 180; ++i )
+	{
+		b2World_Step( chainWorldId, 1.0f / 60.0f, 4 );
+		b2World_Step( meshWorldId, 1.0f / 60.0f, 4 );
+	}
+
+	for ( int i = 0; i < 3; ++i )
+	{
+		b2Vec2 chainPosition = b2Body_GetPosition( chainBodies[i] );
+		b2Vec2 meshPosition = b2Body_GetPosition( meshBodies[i] );
+		ENSURE( meshPosition.y > 0.0f );
+		ENSURE_SMALL( chainPosition.x - meshPosition.x, 0.05f );
+		ENSURE_SMALL( chainPosition.y - meshPosition.y, 0.01f );
+	}
+
+	// A snapshot clones the mesh and the copy continues identically
+	int size = b2World_Snapshot( meshWorldId, NULL, 0 );
+	uint8_t* image = malloc( size );
+	ENSURE( b2World_Snapshot( meshWorldId, image, size ) == size );
+	b2WorldId copyWorldId = b2CreateWorldFromSnapshot( image, size, 1 );
+	ENSURE( B2_IS_NON_NULL( copyWorldId ) );
+
+	b2Body_SetLinearVelocity( meshBodies[1], (b2Vec2){ 4.0f, 2.0f } );
+	b2BodyId copyBodyId = { meshBodies[1].index1, (uint16_t)( copyWorldId.index1 - 1 ), meshBodies[1].generation };
+	b2Body_SetLinearVelocity( copyBodyId, (b2Vec2){ 4.0f, 2.0f } );
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( meshWorldId, 1.0f / 60.0f, 4 );
+		b2World_Step( copyWorldId, 1.0f / 60.0f, 4 );
+	}
+
+	b2Vec2 p1 = b2Body_GetPosition( meshBodies[1] );
+	b2Vec2 p2 = b2Body_GetPosition( copyBodyId );
+	ENSURE( p1.x == p2.x && p1.y == p2.y );
+
+	// Restoring over the live world replaces the mesh data
+	ENSURE( b2World_Restore( meshWorldId, image, size ) );
+	free( image );
+
+	b2DestroyWorld( copyWorldId );
+	b2DestroyWorld( chainWorldId );
+	b2DestroyWorld( meshWorldId );
+
+	return 0;
+}
+
+// Pushes a box into a concave corner and returns the deepest penetration once it has settled
+static float CornerPenetration( bool useMesh, b2Vec2 force )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+	// A wall on the right meeting a floor, the solid side is below and to the right
+	b2Vec2 points[5] = { { 0.0f, 12.0f }, { 0.0f, 10.0f }, { 0.0f, 0.0f }, { -10.0f, 0.0f }, { -12.0f, 0.0f } };
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	if ( useMesh )
+	{
+		b2ChainSegment segments[2];
+		for ( int i = 0; i < 2; ++i )
+		{
+			segments[i] = (b2ChainSegment){ points[i], { points[i + 1], points[i + 2] }, points[i + 3], B2_NULL_INDEX };
+		}
+
+		b2Mesh mesh = { segments, 2 };
+		b2CreateMeshShape( groundId, &shapeDef, &mesh );
+	}
+	else
+	{
+		b2ChainDef chainDef = b2DefaultChainDef();
+		chainDef.points = points;
+		chainDef.count = 5;
+		b2CreateChain( groundId, &chainDef );
+	}
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = (b2Vec2){ -1.0f, 0.6f };
+	b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2CreatePolygonShape( bodyId, &shapeDef, &box );
+
+	float maxPenetration = 0.0f;
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2Body_ApplyForceToCenter( bodyId, force, true );
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+		b2Transform transform = b2Body_GetTransform( bodyId );
+		for ( int j = 0; i >= 90 && j < box.count; ++j )
+		{
+			b2Vec2 p = b2TransformPoint( transform, box.vertices[j] );
+			maxPenetration = b2MaxFloat( maxPenetration, b2MaxFloat( -p.y, p.x ) );
+		}
+	}
+
+	b2DestroyWorld( worldId );
+	return maxPenetration;
+}
+
+static int MeshCornerTest( void )
+{
+	b2Vec2 forces[3] = { { 50.0f, 0.0f }, { 50.0f, -50.0f }, { 200.0f, -20.0f } };
+	for ( int i = 0; i < 3; ++i )
+	{
+		float chainPenetration = CornerPenetration( false, forces[i] );
+		float meshPenetration = CornerPenetration( true, forces[i] );
+
+		// Both faces of the corner must hold the box, like a chain does
+		ENSURE( meshPenetration < 2.0f * chainPenetration + 0.001f );
+		ENSURE( meshPenetration < 0.01f );
+	}
+
+	return 0;
+}
+
+// A mesh pair only gets a second contact while the shape touches two faces and reports a single event pair
+static int MeshChildContactTest( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+	b2Vec2 points[5] = { { 0.0f, 12.0f }, { 0.0f, 10.0f }, { 0.0f, 0.0f }, { -10.0f, 0.0f }, { -12.0f, 0.0f } };
+	b2ChainSegment segments[2];
+	for ( int i = 0; i < 2; ++i )
+	{
+		segments[i] = (b2ChainSegment){ points[i], { points[i + 1], points[i + 2] }, points[i + 3], B2_NULL_INDEX };
+	}
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enableContactEvents = true;
+	b2Mesh mesh = { segments, 2 };
+	b2CreateMeshShape( groundId, &shapeDef, &mesh );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = (b2Vec2){ -5.0f, 0.6f };
+	bodyDef.enableSleep = false;
+	b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2CreatePolygonShape( bodyId, &shapeDef, &box );
+
+	int beginCount = 0;
+	int endCount = 0;
+
+	// Resting on the floor
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		b2ContactEvents events = b2World_GetContactEvents( worldId );
+		beginCount += events.beginCount;
+		endCount += events.endCount;
+	}
+
+	ENSURE( b2World_GetCounters( worldId ).contactCount == 1 );
+	ENSURE( b2Body_GetContactCapacity( bodyId ) == 1 );
+
+	// Pushed into the corner
+	b2Body_SetTransform( bodyId, (b2Vec2){ -0.5f, 0.5f }, b2Rot_identity );
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2Body_ApplyForceToCenter( bodyId, (b2Vec2){ 50.0f, 0.0f }, true );
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		b2ContactEvents events = b2World_GetContactEvents( worldId );
+		beginCount += events.beginCount;
+		endCount += events.endCount;
+	}
+
+	ENSURE( b2World_GetCounters( worldId ).contactCount == 2 );
+
+	b2ContactData contactData[4];
+	int contactCount = b2Body_GetContactData( bodyId, contactData, 4 );
+	ENSURE( contactCount == 2 );
+	ENSURE( b2Dot( contactData[0].manifold.normal, contactData[1].manifold.normal ) < 0.5f );
+
+	// Back on the floor
+	b2Body_SetTransform( bodyId, (b2Vec2){ -5.0f, 0.5f }, b2Rot_identity );
+	b2Body_SetLinearVelocity( bodyId, b2Vec2_zero );
+	for ( int i = 0; i < 30; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		b2ContactEvents events = b2World_GetContactEvents( worldId );
+		beginCount += events.beginCount;
+		endCount += events.endCount;
+	}
+
+	ENSURE( b2World_GetCounters( worldId ).contactCount == 1 );
+	ENSURE( beginCount == 1 );
+	ENSURE( endCount == 0 );
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+static int HeightFieldShapeTest( void )
+{
+	float heights[41];
+	for ( int i = 0; i < 41; ++i )
+	{
+		float x = -10.0f + 0.5f * i;
+		heights[i] = 0.25f * sinf( 0.3f * x );
+	}
+
+	// The same surface as a chain. The heightfield extends the end cells linearly for the ghost vertices.
+	b2Vec2 points[43];
+	for ( int i = 0; i < 41; ++i )
+	{
+		points[41 - i] = (b2Vec2){ -10.0f + 0.5f * i, heights[i] };
+	}
+	points[0] = b2Add( points[1], b2Sub( points[1], points[2] ) );
+	points[42] = b2Add( points[41], b2Sub( points[41], points[40] ) );
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.position = (b2Vec2){ -10.0f, 0.0f };
+	b2BodyId heightFieldBodyId = b2CreateBody( worldId, &bodyDef );
+
+	b2HeightField heightField = { 0 };
+	heightField.heights = heights;
+	heightField.count = 41;
+	heightField.spacing = 0.5f;
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2ShapeId heightFieldShapeId = b2CreateHeightFieldShape( heightFieldBodyId, &shapeDef, &heightField );
+	ENSURE( B2_IS_NON_NULL( heightFieldShapeId ) );
+	ENSURE( b2Shape_GetType( heightFieldShapeId ) == b2_heightFieldShape );
+	ENSURE( b2Shape_GetHeightFieldCellCount( heightFieldShapeId ) == 40 );
+
+	b2ChainSegment cell = b2Shape_GetHeightFieldSegment( heightFieldShapeId, 7 );
+	ENSURE_SMALL( cell.segment.point1.x - 4.0f, 1e-6f );
+	ENSURE_SMALL( cell.segment.point2.x - 3.5f, 1e-6f );
+	ENSURE_SMALL( cell.ghost1.y - heights[9], 1e-6f );
+	ENSURE_SMALL( cell.ghost2.y - heights[6], 1e-6f );
+
+	// Put the chain below so the rays can be compared
+	b2WorldId chainWorldId = b2CreateWorld( &worldDef );
+	bodyDef.position = b2Vec2_zero;
+	b2BodyId chainBodyId = b2CreateBody( chainWorldId, &bodyDef );
+	b2ChainDef chainDef = b2DefaultChainDef();
+	chainDef.points = points;
+	chainDef.count = 43;
+	b2CreateChain( chainBodyId, &chainDef );
+
+	for ( int i = 0; i < 25; ++i )
+	{
+		b2Vec2 origin = { -12.0f + 1.0f * i, 2.0f };
+		b2Vec2 translation = { 0.7f, -4.0f };
+		b2RayResult chainResult = b2World_CastRayClosest( chainWorldId, origin, translation, b2DefaultQueryFilter() );
+		b2RayResult result = b2World_CastRayClosest( worldId, origin, translation, b2DefaultQueryFilter() );
+		ENSURE( chainResult.hit == result.hit );
+		if ( result.hit )
+		{
+			ENSURE_SMALL( chainResult.point.x - result.point.x, 1e-5f );
+			ENSURE_SMALL( chainResult.point.y - result.point.y, 1e-5f );
+		}
+
+		// Cast back up from below the surface
+		b2RayResult reverse = b2World_CastRayClosest( worldId, b2MulAdd( origin, 1.0f, translation ),
+													  b2MulSV( -1.0f, translation ), b2DefaultQueryFilter() );
+		ENSURE( reverse.hit == false );
+	}
+
+	b2DestroyWorld( chainWorldId );
+
+	// Shapes rest on the surface
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = (b2Vec2){ -3.0f, 2.0f };
+	b2BodyId boxId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2CreatePolygonShape( boxId, &shapeDef, &box );
+
+	bodyDef.position = (b2Vec2){ 2.0f, 2.0f };
+	b2BodyId capsuleId = b2CreateBody( worldId, &bodyDef );
+	b2Capsule capsule = { { -0.5f, 0.0f }, { 0.5f, 0.0f }, 0.25f };
+	b2CreateCapsuleShape( capsuleId, &shapeDef, &capsule );
+
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	ENSURE( b2Body_GetPosition( boxId ).y > 0.0f );
+	ENSURE( b2Body_GetPosition( capsuleId ).y > 0.0f );
+
+	// A snapshot clones the heightfield
+	int size = b2World_Snapshot( worldId, NULL, 0 );
+	uint8_t* image = malloc( size );
+	ENSURE( b2World_Snapshot( worldId, image, size ) == size );
+	ENSURE( b2World_Restore( worldId, image, size ) );
+	free( image );
+
+	ENSURE( b2Shape_GetHeightFieldCellCount( heightFieldShapeId ) == 40 );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2Body_GetPosition( boxId ).y > 0.0f );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// The material array must stay aligned for odd and even sample counts
+static int HeightFieldMaterialCase( int sampleCount )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	// Flat ground, ice on the left and rubber on the right
+	float heights[22] = { 0 };
+	uint8_t materialIndices[21];
+	ENSURE( sampleCount <= 22 );
+	for ( int i = 0; i < sampleCount - 1; ++i )
+	{
+		materialIndices[i] = i < 10 ? 0 : 1;
+	}
+
+	b2SurfaceMaterial materials[2] = { b2DefaultSurfaceMaterial(), b2DefaultSurfaceMaterial() };
+	materials[0].friction = 0.0f;
+	materials[1].friction = 1.0f;
+
+	b2HeightField heightField = { heights, sampleCount, 1.0f, materials, 2, materialIndices };
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.position = (b2Vec2){ -10.0f, 0.0f };
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2CreateHeightFieldShape( groundId, &shapeDef, &heightField );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.linearVelocity = (b2Vec2){ 2.0f, 0.0f };
+	bodyDef.position = (b2Vec2){ -8.0f, 0.5f };
+	b2BodyId iceBoxId = b2CreateBody( worldId, &bodyDef );
+	bodyDef.position = (b2Vec2){ 2.0f, 0.5f };
+	b2BodyId rubberBoxId = b2CreateBody( worldId, &bodyDef );
+
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2CreatePolygonShape( iceBoxId, &shapeDef, &box );
+	b2CreatePolygonShape( rubberBoxId, &shapeDef, &box );
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	ENSURE_SMALL( b2Body_GetLinearVelocity( iceBoxId ).x - 2.0f, 0.01f );
+	ENSURE( b2Body_GetLinearVelocity( rubberBoxId ).x < 0.1f );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+static int HeightFieldMaterialTest( void )
+{
+	ENSURE( HeightFieldMaterialCase( 21 ) == 0 );
+	ENSURE( HeightFieldMaterialCase( 22 ) == 0 );
+	return 0;
+}
+
+static int SharedGeometryTest( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2GeometryId geometryId = b2CreateGeometry( worldId, &box );
+	ENSURE( b2Geometry_IsValid( geometryId ) );
+	ENSURE( b2Geometry_GetShapeCount( geometryId ) == 0 );
+
+	enum
+	{
+		e_count = 10
+	};
+
+	b2ShapeId shapeIds[e_count];
+	bodyDef.type = b2_dynamicBody;
+	shapeDef.geometry = geometryId;
+	for ( int i = 0; i < e_count; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -10.0f + 2.0f * i, 0.5f + i };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		shapeIds[i] = b2CreatePolygonShape( bodyId, &shapeDef, NULL );
+	}
+
+	ENSURE( b2Geometry_GetShapeCount( geometryId ) == e_count );
+
+	// Shapes keep the geometry alive after the user reference is released
+	b2DestroyGeometry( geometryId );
+	ENSURE( b2Geometry_IsValid( geometryId ) == false );
+
+	b2Polygon polygon = b2Shape_GetPolygon( shapeIds[3] );
+	ENSURE( polygon.count == 4 );
+	ENSURE_SMALL( polygon.vertices[2].x - 0.5f, 1e-6f );
+
+	// Changing the polygon of one shape must not affect the others
+	b2Polygon bigBox = b2MakeBox( 1.0f, 1.0f );
+	b2Shape_SetPolygon( shapeIds[0], &bigBox );
+	ENSURE_SMALL( b2Shape_GetPolygon( shapeIds[0] ).vertices[2].x - 1.0f, 1e-6f );
+	ENSURE_SMALL( b2Shape_GetPolygon( shapeIds[1] ).vertices[2].x - 0.5f, 1e-6f );
+
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	// All boxes come to rest on the ground
+	for ( int i = 1; i < e_count; ++i )
+	{
+		b2BodyId bodyId = b2Shape_GetBody( shapeIds[i] );
+		ENSURE_SMALL( b2Body_GetPosition( bodyId ).y - 0.5f, 0.05f );
+	}
+
+	for ( int i = 0; i < e_count; ++i )
+	{
+		b2DestroyBody( b2Shape_GetBody( shapeIds[i] ) );
+	}
+
+	// A geometry held by the user is freed with the world
+	b2GeometryId leakedId = b2CreateGeometry( worldId, &box );
+	ENSURE( b2Geometry_IsValid( leakedId ) );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
 static int DeferredMassFlagSyncTest( void )
 {
 	b2WorldDef worldDef = b2DefaultWorldDef();
@@ -653,6 +1180,262 @@ static int SetBulletDriftTest( void )
 	return 0;
 }
 
+// Boxes and circles resting on a ground box, used by the batch query tests
+static b2WorldId CreateBatchQueryWorld( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	{
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		b2Polygon box = b2MakeBox( 40.0f, 1.0f );
+		b2CreatePolygonShape( groundId, &shapeDef, &box );
+	}
+
+	{
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		bodyDef.type = b2_dynamicBody;
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		b2Polygon box = b2MakeBox( 0.4f, 0.4f );
+		b2Circle circle = { { 0.0f, 0.0f }, 0.45f };
+
+		for ( int i = 0; i < 20; ++i )
+		{
+			for ( int j = 0; j < 10; ++j )
+			{
+				bodyDef.position = (b2Vec2){ -19.0f + 2.0f * i, 2.0f + 1.5f * j };
+				b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+				if ( ( i + j ) % 2 == 0 )
+				{
+					b2CreatePolygonShape( bodyId, &shapeDef, &box );
+				}
+				else
+				{
+					b2CreateCircleShape( bodyId, &shapeDef, &circle );
+				}
+			}
+		}
+	}
+
+	for ( int i = 0; i < 10; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	return worldId;
+}
+
+// Batched ray casts must match individual closest ray casts
+static int CastRayBatchTest( void )
+{
+	b2WorldId worldId = CreateBatchQueryWorld();
+
+	// Not a multiple of the packet size. Some rays start inside shapes and some miss everything.
+	enum
+	{
+		e_rayCount = 203
+	};
+
+	b2Vec2 origins[e_rayCount];
+	b2Vec2 translations[e_rayCount];
+	b2RayResult results[e_rayCount];
+
+	for ( int i = 0; i < e_rayCount; ++i )
+	{
+		float angle = 0.05f * i;
+		origins[i] = (b2Vec2){ -30.0f + 0.3f * i, 25.0f - 0.1f * i };
+		translations[i] = b2RotateVector( b2MakeRot( angle ), (b2Vec2){ 8.0f, -40.0f } );
+	}
+
+	b2QueryFilter filter = b2DefaultQueryFilter();
+	b2World_CastRayBatch( worldId, origins, translations, e_rayCount, filter, results );
+
+	int hitCount = 0;
+	for ( int i = 0; i < e_rayCount; ++i )
+	{
+		b2RayResult expected = b2World_CastRayClosest( worldId, origins[i], translations[i], filter );
+		ENSURE( results[i].hit == expected.hit );
+		if ( expected.hit )
+		{
+			ENSURE( B2_ID_EQUALS( results[i].shapeId, expected.shapeId ) );
+			ENSURE( results[i].fraction == expected.fraction );
+			ENSURE( results[i].point.x == expected.point.x && results[i].point.y == expected.point.y );
+			hitCount += 1;
+		}
+	}
+
+	ENSURE( hitCount > 0 );
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+typedef struct OverlapCollector
+{
+	b2ShapeId ids[256];
+	int count;
+} OverlapCollector;
+
+static bool CollectOverlap( b2ShapeId shapeId, void* context )
+{
+	OverlapCollector* collector = context;
+	if ( collector->count < 256 )
+	{
+		collector->ids[collector->count] = shapeId;
+	}
+	collector->count += 1;
+	return true;
+}
+
+// Batched overlaps must match individual overlap queries, in the same order
+static int OverlapBatchTest( void )
+{
+	b2WorldId worldId = CreateBatchQueryWorld();
+
+	enum
+	{
+		e_queryCount = 101,
+		e_capacity = 4096
+	};
+
+	b2AABB aabbs[e_queryCount];
+	b2ShapeProxy proxies[e_queryCount];
+	int offsets[e_queryCount + 1];
+	static b2ShapeId shapeIds[e_capacity];
+
+	for ( int i = 0; i < e_queryCount; ++i )
+	{
+		b2Vec2 center = { -25.0f + 0.5f * i, 0.2f * ( i % 40 ) };
+		b2Vec2 extent = { 0.5f + 0.05f * ( i % 7 ), 1.0f + 0.1f * ( i % 5 ) };
+		aabbs[i] = (b2AABB){ b2Sub( center, extent ), b2Add( center, extent ) };
+		proxies[i] = b2MakeProxy( &center, 1, 0.5f + 0.1f * ( i % 9 ) );
+	}
+
+	b2QueryFilter filter = b2DefaultQueryFilter();
+
+	for ( int pass = 0; pass < 2; ++pass )
+	{
+		int hitCount;
+		if ( pass == 0 )
+		{
+			hitCount = b2World_OverlapAABBBatch( worldId, aabbs, e_queryCount, filter, offsets, shapeIds, e_capacity );
+		}
+		else
+		{
+			hitCount = b2World_OverlapShapeBatch( worldId, proxies, e_queryCount, filter, offsets, shapeIds, e_capacity );
+		}
+
+		ENSURE( 0 < hitCount && hitCount <= e_capacity );
+		ENSURE( offsets[0] == 0 && offsets[e_queryCount] == hitCount );
+
+		for ( int i = 0; i < e_queryCount; ++i )
+		{
+			OverlapCollector collector = { 0 };
+			if ( pass == 0 )
+			{
+				b2World_OverlapAABB( worldId, aabbs[i], filter, CollectOverlap, &collector );
+			}
+			else
+			{
+				b2World_OverlapShape( worldId, proxies + i, filter, CollectOverlap, &collector );
+			}
+
+			ENSURE( offsets[i + 1] - offsets[i] == collector.count );
+			for ( int j = 0; j < collector.count; ++j )
+			{
+				ENSURE( B2_ID_EQUALS( shapeIds[offsets[i] + j], collector.ids[j] ) );
+			}
+		}
+
+		// Insufficient capacity still reports the full layout
+		int truncatedCount = 0;
+		if ( pass == 0 )
+		{
+			truncatedCount = b2World_OverlapAABBBatch( worldId, aabbs, e_queryCount, filter, offsets, shapeIds, 3 );
+		}
+		else
+		{
+			truncatedCount = b2World_OverlapShapeBatch( worldId, proxies, e_queryCount, filter, offsets, shapeIds, 3 );
+		}
+
+		ENSURE( truncatedCount == hitCount );
+		ENSURE( offsets[e_queryCount] == hitCount );
+	}
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+// The timeline records solver and parallel-for blocks from every worker
+static int TimelineTest( void )
+{
+	int workerCount = 4;
+	int timelineCapacity = 2048;
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = workerCount;
+	worldDef.timelineCapacity = timelineCapacity;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	CreateLargePyramid( worldId );
+
+	for ( int i = 0; i < 4; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	int eventCount = b2World_GetTimeline( worldId, NULL, 0 );
+	ENSURE( 0 < eventCount && eventCount <= workerCount * timelineCapacity );
+
+	b2TimelineEvent* events = malloc( eventCount * sizeof( b2TimelineEvent ) );
+	ENSURE( b2World_GetTimeline( worldId, events, eventCount ) == eventCount );
+
+	bool foundSolve = false;
+	bool foundCollide = false;
+	for ( int i = 0; i < eventCount; ++i )
+	{
+		b2TimelineEvent* event = events + i;
+		ENSURE( 0 <= event->workerIndex && event->workerIndex < workerCount );
+		ENSURE( 0 <= event->stage && event->stage < b2_timelineStageCount );
+		ENSURE( event->startTicks <= event->endTicks );
+		ENSURE( event->itemCount > 0 );
+		ENSURE( i == 0 || events[i - 1].startTicks <= event->startTicks );
+
+		foundSolve = foundSolve || event->stage == b2_timelineSolve;
+		foundCollide = foundCollide || event->stage == b2_timelineCollide;
+	}
+
+	ENSURE( foundSolve && foundCollide );
+
+	// A smaller request keeps the most recent events
+	ENSURE( b2World_GetTimeline( worldId, events, 10 ) == 10 );
+
+	free( events );
+
+	const char* path = "timeline_test.json";
+	ENSURE( b2World_SaveTimelineToFile( worldId, path ) );
+	remove( path );
+
+	b2World_ClearTimeline( worldId );
+	ENSURE( b2World_GetTimeline( worldId, NULL, 0 ) == 0 );
+
+	b2DestroyWorld( worldId );
+
+	// Disabled by default
+	worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = workerCount;
+	worldId = b2CreateWorld( &worldDef );
+	CreateJointGrid( worldId );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2World_GetTimeline( worldId, NULL, 0 ) == 0 );
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
 int WorldTest( void )
 {
 	RUN_SUBTEST( HelloWorld );
@@ -664,10 +1447,19 @@ int WorldTest( void )
 	RUN_SUBTEST( TestSensor );
 	RUN_SUBTEST( TestSetWorkerCount );
 	RUN_SUBTEST( ChainSegmentShapeTest );
+	RUN_SUBTEST( MeshShapeTest );
+	RUN_SUBTEST( MeshCornerTest );
+	RUN_SUBTEST( MeshChildContactTest );
+	RUN_SUBTEST( HeightFieldShapeTest );
+	RUN_SUBTEST( HeightFieldMaterialTest );
+	RUN_SUBTEST( SharedGeometryTest );
 	RUN_SUBTEST( SetBulletDriftTest );
 	RUN_SUBTEST( DeferredMassFlagSyncTest );
 	RUN_SUBTEST( EnableSleepFlagSyncTest );
 	RUN_SUBTEST( EnableContactRecyclingTest );
+	RUN_SUBTEST( CastRayBatchTest );
+	RUN_SUBTEST( OverlapBatchTest );
+	RUN_SUBTEST( TimelineTest );
 
 	return 0;
 }